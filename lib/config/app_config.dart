@@ -48,4 +48,15 @@ class AppConfig {
     if (base.endsWith('/')) return base + 'ai';
     return base + '/ai';
   }
+
+  /// Follower endpoint for a shared meeting's live transcript. Derived from
+  /// `serverWebSocketUrl` by swapping `/listen` for `/follow`.
+  static String get serverFollowWebSocketUrl {
+    var base = serverWebSocketUrl.trim();
+    if (base.endsWith('/listen')) {
+      return base.substring(0, base.length - '/listen'.length) + '/follow';
+    }
+    if (base.endsWith('/')) return base + 'follow';
+    return base + '/follow';
+  }
 }
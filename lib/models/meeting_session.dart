@@ -72,6 +72,7 @@ class MeetingSession {
             'text': b.text,
             'timestamp': b.timestamp.toIso8601String(),
             'isDraft': b.isDraft,
+            if (b.speakerId != null) 'speakerId': b.speakerId,
           }).toList(),
       'summary': summary,
       'insights': insights,
@@ -114,6 +115,7 @@ class MeetingSession {
               text: b['text'] as String,
               timestamp: timestamp,
               isDraft: b['isDraft'] as bool? ?? false,
+              speakerId: b['speakerId'] as int?,
             );
           })
           .toList(),
@@ -9,12 +9,16 @@ class TranscriptBubble {
   final String text;
   final DateTime timestamp;
   final bool isDraft;
+  /// Remote speaker label from native speaker change detection (system
+  /// source only); null when unknown.
+  final int? speakerId;
 
   const TranscriptBubble({
     required this.source,
     required this.text,
     required this.timestamp,
     this.isDraft = false,
+    this.speakerId,
   });
 
   TranscriptBubble copyWith({
@@ -22,12 +26,31 @@ class TranscriptBubble {
     String? text,
     DateTime? timestamp,
     bool? isDraft,
+    int? speakerId,
   }) {
     return TranscriptBubble(
       source: source ?? this.source,
       text: text ?? this.text,
       timestamp: timestamp ?? this.timestamp,
       isDraft: isDraft ?? this.isDraft,
+      speakerId: speakerId ?? this.speakerId,
     );
   }
 }
+
+/// Text of the live draft bubble split where the latest interim hypothesis
+/// diverged from the one before it. [stable] is unchanged since the previous
+/// interim and ends on a word boundary; [tail] is what changed.
+class TranscriptDraft {
+  final TranscriptSource source;
+  final String stable;
+  final String tail;
+
+  const TranscriptDraft({
+    required this.source,
+    required this.stable,
+    required this.tail,
+  });
+
+  String get text => stable + tail;
+}
@@ -407,6 +407,62 @@ class MeetingProvider extends ChangeNotifier {
     }
   }
 
+  /// Stores the recording's audio quality summary with the session so it is
+  /// uploaded alongside the transcript.
+  void setAudioQuality(Map<String, dynamic> quality) {
+    if (_currentSession == null || _isDisposed || quality.isEmpty) return;
+
+    final meta = Map<String, dynamic>.from(_currentSession!.metadata);
+    meta['audioQuality'] = quality;
+    _currentSession = _currentSession!.copyWith(
+      metadata: meta,
+      updatedAt: DateTime.now(),
+    );
+    notifyListeners();
+    _autoSaveSession();
+  }
+
+  /// Stores the recording's talk time, turn and overlap statistics with the
+  /// session; generateInsights() hands them to the model with the transcript.
+  void setConversationAnalytics(Map<String, dynamic> analytics) {
+    if (_currentSession == null || _isDisposed || analytics.isEmpty) return;
+
+    final meta = Map<String, dynamic>.from(_currentSession!.metadata);
+    meta['conversationAnalytics'] = analytics;
+    _currentSession = _currentSession!.copyWith(
+      metadata: meta,
+      updatedAt: DateTime.now(),
+    );
+    notifyListeners();
+    _autoSaveSession();
+  }
+
+  /// One line per side summarizing the stored conversation analytics, or
+  /// null when the session has none.
+  String? _conversationStatsText() {
+    final analytics = _currentSession?.metadata['conversationAnalytics'];
+    if (analytics is! Map) return null;
+
+    String side(String key, String label) {
+      final stats = analytics[key];
+      if (stats is! Map) return '$label: no data';
+      final speechS = ((stats['speechMs'] as num?) ?? 0) / 1000;
+      final wpm = ((stats['wordsPerMinute'] as num?) ?? 0).round();
+      final longestS = ((stats['longestTurnMs'] as num?) ?? 0) / 1000;
+      return '$label: ${speechS.toStringAsFixed(0)}s talking over ${stats['turns'] ?? 0} turns, '
+          'longest ${longestS.toStringAsFixed(0)}s, ${stats['interruptions'] ?? 0} interruptions, '
+          '$wpm words/min';
+    }
+
+    final elapsedS = ((analytics['elapsedMs'] as num?) ?? 0) / 1000;
+    if (elapsedS <= 0) return null;
+    final overlapS = ((analytics['overlapMs'] as num?) ?? 0) / 1000;
+    final micShare = (((analytics['micTalkRatio'] as num?) ?? 0) * 100).round();
+    return 'Measured from the audio over ${elapsedS.toStringAsFixed(0)}s: '
+        '${side('mic', 'MIC')}; ${side('system', 'SYSTEM')}; '
+        'both talking ${overlapS.toStringAsFixed(0)}s; MIC share of talk time $micShare%.';
+  }
+
   void addMarker(Map<String, dynamic> marker) {
     if (_currentSession == null) return;
 
@@ -579,6 +635,10 @@ class MeetingProvider extends ChangeNotifier {
         'source': b.source.toString().split('.').last,
         'text': b.text,
       }).toList();
+      // Talk-time balance, interruptions and pace come from the audio, which
+      // the transcript alone cannot show.
+      final stats = _conversationStatsText();
+      if (stats != null) turns.insert(0, {'source': 'stats', 'text': stats});
 
       print('[MeetingProvider] Generating insights with ${turns.length} turns');
       final insights = await _aiService!.generateInsights(turns: turns);
@@ -1,7 +1,10 @@
 import 'package:flutter/foundation.dart';
+import 'package:path_provider/path_provider.dart';
 import 'package:permission_handler/permission_handler.dart';
+import 'package:shared_preferences/shared_preferences.dart';
 import 'dart:async';
-import 'dart:io' show Platform;
+import 'dart:convert';
+import 'dart:io' show File, Platform;
 import '../services/transcription_service.dart';
 import '../services/audio_capture_service.dart';
 import '../services/windows_audio_service.dart';
@@ -14,11 +17,26 @@ class SpeechToTextProvider extends ChangeNotifier {
   AiService? _aiService;
   Timer? _mockAudioTimer;
   Timer? _systemAudioPollTimer;
+  Timer? _sessionReplayTimer;
   StreamSubscription? _transcriptSubscription;
+  StreamSubscription<bool>? _micCopySubscription;
+  StreamSubscription<NativePowerState>? _powerStateSubscription;
   bool _isSystemAudioCapturing = false;
   bool _useMic = true;
   bool _isStopping = false; // Prevent concurrent stop operations
   
+  // Native detector: the mic carries a digital copy of system audio
+  bool _micIsDigitalCopy = false;
+  // The detector needs a moment to notice the copy has ended, so the last
+  // second of mic audio it held back is kept and sent once it does.
+  static const _heldMicAudioMaxBytes = 32000; // 1 s of 16 kHz PCM16
+  final List<List<int>> _heldMicAudio = [];
+  int _heldMicAudioBytes = 0;
+
+  // While the window is hidden, system audio is pulled this often (ms) in
+  // one batch; 0 while visible.
+  int _audioDeliveryIntervalMs = 0;
+
   // Track when last system final transcript was received to suppress mic echo
   DateTime? _lastSystemFinalTime;
   // Increased window for gaming headphones (echo can be delayed)
@@ -47,6 +65,18 @@ class SpeechToTextProvider extends ChangeNotifier {
   String _aiErrorMessage = '';
   bool _isAiLoading = false;
   
+  // Live draft split into its stable prefix and changed tail. Interim edits
+  // that keep the draft bubble in place only update this, so the transcript
+  // view rebuilds the draft bubble instead of the whole page.
+  final ValueNotifier<TranscriptDraft?> _draft = ValueNotifier<TranscriptDraft?>(null);
+
+  // Last snapshot of native conversation analytics.
+  Map<String, dynamic> _conversationAnalytics = const <String, dynamic>{};
+  Map<String, dynamic> _audioQuality = const <String, dynamic>{};
+
+  // Remote speaker currently heard on the system stream (native detection).
+  int? _systemSpeakerId;
+
   // Auto ask callback - called when a question is detected from others
   Function(String)? _onQuestionDetected;
 
@@ -55,6 +85,110 @@ class SpeechToTextProvider extends ChangeNotifier {
   void setAutoAskCallback(Function(String)? callback) {
     _onQuestionDetected = callback;
   }
+
+  // Voice trigger ("ask AI" phrase) spotted natively in the mic stream.
+  static const _voiceTriggerPrefsKey = 'voice_trigger_templates';
+  static const _maxVoiceTriggerSamples = 4;
+  static const _voiceTriggerKeywordId = 0;
+  VoidCallback? _onVoiceTrigger;
+  int _voiceTriggerSamples = 0;
+
+  int get voiceTriggerSamples => _voiceTriggerSamples;
+
+  void setVoiceTriggerCallback(VoidCallback? callback) {
+    _onVoiceTrigger = callback;
+  }
+
+  // Native end-of-utterance detection: 0 off, 1..3 increasingly eager.
+  static const _endpointAggressivenessPrefsKey = 'endpoint_aggressiveness';
+  int _endpointAggressiveness = 2;
+
+  int get endpointAggressiveness => _endpointAggressiveness;
+
+  Future<void> setEndpointAggressiveness(int level) async {
+    _endpointAggressiveness = level.clamp(0, 3);
+    if (_useNativeAnalytics) {
+      await WindowsAudioService.setEndpointAggressiveness(_endpointAggressiveness);
+    }
+    final prefs = await SharedPreferences.getInstance();
+    await prefs.setInt(_endpointAggressivenessPrefsKey, _endpointAggressiveness);
+    notifyListeners();
+  }
+
+  // Live read-only sharing of this meeting's transcript; the relay hands out
+  // a share id that expires, and followers open it in FollowPage.
+  String? _shareId;
+  DateTime? _shareExpiresAt;
+  Completer<String?>? _shareReady;
+
+  String? get shareId => _shareId;
+  DateTime? get shareExpiresAt => _shareExpiresAt;
+  bool get isSharing => _shareId != null;
+
+  /// Starts sharing the running meeting; completes with the share id, or null
+  /// if the relay did not answer.
+  Future<String?> startSharing() async {
+    if (!_isRecording || _transcriptionService == null || _transcriptionService!.replaying) {
+      return null;
+    }
+    if (_shareId != null) return _shareId;
+    final ready = _shareReady ??= Completer<String?>();
+    _transcriptionService!.startSharing();
+    return ready.future.timeout(const Duration(seconds: 5), onTimeout: () {
+      if (identical(_shareReady, ready)) _shareReady = null;
+      return null;
+    });
+  }
+
+  void stopSharing() {
+    _transcriptionService?.stopSharing();
+    _onShareEnded();
+  }
+
+  void _onShareReady(String shareId, DateTime expiresAt) {
+    _shareId = shareId;
+    _shareExpiresAt = expiresAt;
+    _shareReady?.complete(shareId);
+    _shareReady = null;
+    if (!_isDisposed) notifyListeners();
+  }
+
+  void _onShareEnded() {
+    if (_shareId == null) return;
+    _shareId = null;
+    _shareExpiresAt = null;
+    if (!_isDisposed) notifyListeners();
+  }
+
+  // When on, every live recording is also written to a session capture file
+  // in the documents folder so the same load can be replayed later.
+  static const _sessionCapturePrefsKey = 'session_capture_enabled';
+  bool _sessionCaptureEnabled = false;
+  bool _isReplaying = false;
+  bool _isCapturingSession = false;
+
+  bool get sessionCaptureEnabled => _sessionCaptureEnabled;
+  bool get isReplaying => _isReplaying;
+
+  Future<void> setSessionCaptureEnabled(bool enabled) async {
+    _sessionCaptureEnabled = enabled;
+    final prefs = await SharedPreferences.getInstance();
+    await prefs.setBool(_sessionCapturePrefsKey, enabled);
+    notifyListeners();
+  }
+
+  // Past question/answer pairs, oldest first, mirrored into the native answer
+  // index so a repeated or paraphrased question shows an answer instantly
+  // while the live AI call streams.
+  static const _answerMemoryPrefsKey = 'ai_answer_memory';
+  static const _maxAnswerMemory = 200;
+  static const _instantAnswerMinScore = 0.8;
+  static const _answerIdPrefix = 'answer:';
+  final List<Map<String, String>> _answerMemory = [];
+  String _instantAnswer = '';
+  int _aiRequestSeq = 0; // Drops instant answers for an earlier question
+
+  String get instantAnswer => _instantAnswer;
   bool get isConnected => _isConnected;
   bool get isStopping => _isStopping;
   bool get useMic => _useMic;
@@ -220,8 +354,18 @@ class SpeechToTextProvider extends ChangeNotifier {
       }
     }
 
-    // If the last bubble is from the same source, merge into it to reduce fragmentation.
-    if (_bubbles.isNotEmpty && _bubbles.last.source == source) {
+    if (_useNativeAnalytics) {
+      final words = trimmed.split(RegExp(r'\s+')).where((w) => w.isNotEmpty).length;
+      WindowsAudioService.reportTranscriptWords(source: _sourceKey(source), words: words);
+    }
+
+    final speakerId = _speakerIdFor(source);
+
+    // If the last bubble is from the same source (and speaker), merge into it to reduce fragmentation.
+    // A draft is always finalized in place, even if the speaker changed mid-utterance.
+    if (_bubbles.isNotEmpty &&
+        _bubbles.last.source == source &&
+        (_bubbles.last.isDraft || _isSameSpeaker(_bubbles.last, speakerId))) {
       // If the last bubble is a draft, finalize it in-place.
       if (_bubbles.last.isDraft) {
         final finalText = trimmed;
@@ -229,6 +373,7 @@ class SpeechToTextProvider extends ChangeNotifier {
           text: finalText,
           isDraft: false,
           timestamp: DateTime.now(),
+          speakerId: speakerId,
         );
         // Check if finalized text is a question from system source (others asking)
         if (source == TranscriptSource.system && 
@@ -272,6 +417,7 @@ class SpeechToTextProvider extends ChangeNotifier {
       text: trimmed,
       timestamp: DateTime.now(),
       isDraft: false,
+      speakerId: speakerId,
     );
     _bubbles.add(newBubble);
     
@@ -298,17 +444,32 @@ class SpeechToTextProvider extends ChangeNotifier {
     }
   }
 
-  void _upsertDraftBubble({required TranscriptSource source, required String text}) {
+  /// Apply an interim hypothesis to the draft bubble of [source]. Returns true
+  /// when the bubble list changed shape (a new draft was appended) and
+  /// listeners must rebuild; edits to an existing draft only update [draft].
+  bool _upsertDraftBubble({required TranscriptSource source, required String text}) {
     final trimmed = text.trim();
-    if (trimmed.isEmpty) return;
+    if (trimmed.isEmpty) return false;
+
+    final speakerId = _speakerIdFor(source);
 
     // Update existing draft bubble for this source if it is the most recent.
+    // The edit is computed against the text the bubble actually holds.
     if (_bubbles.isNotEmpty && _bubbles.last.source == source && _bubbles.last.isDraft) {
+      final current = _bubbles.last.text;
+      if (current == trimmed) return false;
       _bubbles[_bubbles.length - 1] = _bubbles.last.copyWith(
         text: trimmed,
         timestamp: DateTime.now(),
+        speakerId: speakerId,
       );
-      return;
+      final keep = _stablePrefixLength(current, trimmed);
+      _draft.value = TranscriptDraft(
+        source: source,
+        stable: trimmed.substring(0, keep),
+        tail: trimmed.substring(keep),
+      );
+      return false;
     }
 
     // Otherwise append a new draft bubble (interleaved transcripts are expected).
@@ -318,8 +479,77 @@ class SpeechToTextProvider extends ChangeNotifier {
         text: trimmed,
         timestamp: DateTime.now(),
         isDraft: true,
+        speakerId: speakerId,
       ),
     );
+    _draft.value = TranscriptDraft(source: source, stable: '', tail: trimmed);
+    return true;
+  }
+
+  /// Length of the prefix [next] shares with [previous], cut back to the
+  /// last whitespace so a half-revised word is never treated as stable.
+  static int _stablePrefixLength(String previous, String next) {
+    final limit = previous.length < next.length ? previous.length : next.length;
+    var common = 0;
+    while (common < limit && previous.codeUnitAt(common) == next.codeUnitAt(common)) {
+      common++;
+    }
+    if (common == 0 || common == next.length) return common;
+    final space = next.lastIndexOf(' ', common - 1);
+    return space < 0 ? 0 : space + 1;
+  }
+
+  int? _speakerIdFor(TranscriptSource source) {
+    return source == TranscriptSource.system ? _systemSpeakerId : null;
+  }
+
+  /// Bubbles only merge when the native detector has not seen a different
+  /// remote speaker; unknown labels never split.
+  bool _isSameSpeaker(TranscriptBubble bubble, int? speakerId) {
+    if (bubble.speakerId == null || speakerId == null) return true;
+    return bubble.speakerId == speakerId;
+  }
+
+  bool get _useNativeAnalytics => !kIsWeb && Platform.isWindows;
+
+  /// Talk time, turns, overlap, pauses and speaking rate computed natively
+  /// from audio activity, refreshed when recording stops; empty when
+  /// unavailable. A new map on every refresh.
+  Map<String, dynamic> get conversationAnalytics => _conversationAnalytics;
+
+  Future<Map<String, dynamic>> refreshConversationAnalytics() async {
+    if (!_useNativeAnalytics) return const <String, dynamic>{};
+    _conversationAnalytics = Map.unmodifiable(await WindowsAudioService.getConversationAnalytics());
+    if (!_isDisposed) notifyListeners();
+    return _conversationAnalytics;
+  }
+
+  /// Per-stream input quality for the current meeting, refreshed when
+  /// recording stops; empty when unavailable. A new map on every refresh.
+  Map<String, dynamic> get audioQuality => _audioQuality;
+
+  Future<Map<String, dynamic>> refreshAudioQuality() async {
+    if (!_useNativeAnalytics) return const <String, dynamic>{};
+    _audioQuality = Map.unmodifiable(await WindowsAudioService.getAudioQuality());
+    if (!_isDisposed) notifyListeners();
+    return _audioQuality;
+  }
+
+  String _sourceKey(TranscriptSource source) {
+    return switch (source) {
+      TranscriptSource.mic => 'mic',
+      TranscriptSource.system => 'system',
+      TranscriptSource.unknown => 'unknown',
+    };
+  }
+
+  /// The live draft bubble's text, split into the prefix the last interim
+  /// left untouched and the changed tail; null when there is no draft.
+  ValueListenable<TranscriptDraft?> get draft => _draft;
+
+  /// Forget the draft of [source] once its final result arrives.
+  void _clearDraft(TranscriptSource source) {
+    if (_draft.value?.source == source) _draft.value = null;
   }
 
   Future<bool> requestPermissions() async {
@@ -329,6 +559,27 @@ class SpeechToTextProvider extends ChangeNotifier {
 
   Future<void> initialize({required String wsUrl, required String httpBaseUrl, String? authToken}) async {
     _transcriptionService = TranscriptionService(serverUrl: wsUrl, authToken: authToken);
+    _transcriptionService!.onShareReady = _onShareReady;
+    _transcriptionService!.onShareEnded = _onShareEnded;
+    if (_useNativeAnalytics) {
+      WindowsAudioService.setKeywordHandler(_onKeyword);
+      _micCopySubscription ??= WindowsAudioService.micCopyChanges.listen((copy) {
+        final wasCopy = _micIsDigitalCopy;
+        _micIsDigitalCopy = copy;
+        print('[SpeechToTextProvider] Mic ${copy ? 'is' : 'is no longer'} a copy of system audio');
+        if (wasCopy && !copy) {
+          _flushHeldMicAudio();
+        } else {
+          _clearHeldMicAudio();
+        }
+      });
+      _powerStateSubscription ??= WindowsAudioService.powerStateChanges.listen(_onPowerState);
+      WindowsAudioService.getPowerState().then(_onPowerState);
+      _loadVoiceTrigger();
+      _loadAnswerMemory();
+      _loadEndpointAggressiveness();
+      _loadSessionCapture();
+    }
     // Derive AI WS endpoint from the transcription WS endpoint (/listen -> /ai).
     String? aiWsUrl;
     try {
@@ -372,9 +623,11 @@ class SpeechToTextProvider extends ChangeNotifier {
         }
 
         if (result.isFinal) {
+          _clearDraft(source);
           _upsertFinalBubble(source: source, text: result.text);
-        } else {
-          _upsertDraftBubble(source: source, text: result.text);
+        } else if (!_upsertDraftBubble(source: source, text: result.text)) {
+          // Edits to the existing draft re-render only the draft bubble.
+          return;
         }
 
         // Only notify if still recording
@@ -477,8 +730,25 @@ class SpeechToTextProvider extends ChangeNotifier {
     _isAiLoading = true;
     _aiErrorMessage = '';
     _aiResponse = '';
+    _instantAnswer = '';
     notifyListeners();
 
+    // Look the question up alongside the live call rather than before it;
+    // a match only shows while no live token has arrived.
+    final requestSeq = ++_aiRequestSeq;
+    if (_useNativeAnalytics && finalQuestion != null) {
+      unawaited(WindowsAudioService.searchAnswers(
+        finalQuestion,
+        k: 1,
+        minScore: _instantAnswerMinScore,
+        prefix: _answerIdPrefix,
+      ).then((matches) {
+        if (matches.isEmpty || requestSeq != _aiRequestSeq || !_isAiLoading || _isDisposed) return;
+        _instantAnswer = matches.first.payload;
+        notifyListeners();
+      }));
+    }
+
     try {
       // If AI WS is configured, stream token deltas for a more responsive UI.
       if (ai.aiWsUrl != null) {
@@ -503,6 +773,9 @@ class SpeechToTextProvider extends ChangeNotifier {
         _aiResponse = text;
       }
       _aiErrorMessage = '';
+      if (finalQuestion != null && _aiResponse.trim().isNotEmpty) {
+        _rememberAnswer(finalQuestion, _aiResponse.trim());
+      }
     } catch (e) {
       _aiErrorMessage = e.toString();
     } finally {
@@ -522,6 +795,9 @@ class SpeechToTextProvider extends ChangeNotifier {
       // Reset suppression timestamps when starting recording
       _lastSystemFinalTime = null;
       _recentSystemTranscripts.clear();
+      _draft.value = null;
+      _systemSpeakerId = null;
+      _clearHeldMicAudio();
       
       // Set recording start time IMMEDIATELY at the start
       // This ensures initial suppression is active before any audio capture begins
@@ -532,6 +808,13 @@ class SpeechToTextProvider extends ChangeNotifier {
       // When resuming, preserve existing bubbles
       if (clearExisting) {
         _bubbles.clear();
+        _conversationAnalytics = const <String, dynamic>{};
+        _audioQuality = const <String, dynamic>{};
+        if (_useNativeAnalytics) {
+          WindowsAudioService.resetConversationAnalytics();
+          WindowsAudioService.resetAudioQuality();
+          _micIsDigitalCopy = false;
+        }
       }
       
       print('[SpeechToTextProvider] Permission granted, connecting to transcription service...');
@@ -573,9 +856,11 @@ class SpeechToTextProvider extends ChangeNotifier {
             }
 
             if (result.isFinal) {
+              _clearDraft(source);
               _upsertFinalBubble(source: source, text: result.text);
-            } else {
-              _upsertDraftBubble(source: source, text: result.text);
+            } else if (!_upsertDraftBubble(source: source, text: result.text)) {
+              // Edits to the existing draft re-render only the draft bubble.
+              return;
             }
 
             // Only notify if still recording and not stopping
@@ -630,44 +915,7 @@ class SpeechToTextProvider extends ChangeNotifier {
         }
         
         if (started) {
-          _systemAudioPollTimer?.cancel();
-          // Resource optimization: Adaptive polling frequency
-          // Use faster polling when system audio is active, slower when idle
-          final hasRecentSystemActivity = _recentSystemTranscripts.isNotEmpty;
-          final pollInterval = hasRecentSystemActivity 
-              ? const Duration(milliseconds: 50)  // Fast when active (20 Hz)
-              : const Duration(milliseconds: 100);  // Slower when idle (10 Hz) - saves CPU/battery
-          
-          _systemAudioPollTimer = Timer.periodic(
-            pollInterval,
-            (_) {
-              // Check if recording is still active and not stopping before processing
-              if (!_isRecording || _isStopping || _transcriptionService == null) {
-                return;
-              }
-              
-              // Note: We don't suppress system audio when mic finalizes because:
-              // 1. System audio is typically the original source (video calls, apps, etc.)
-              // 2. Suppressing system audio causes delays in transcription
-              // 3. Mic echo suppression is handled by suppressing mic audio instead
-              
-              // Pull ~50ms at 16kHz mono PCM16 => 16000*0.05*2 = 1600 bytes
-              WindowsAudioService.getSystemAudioFrame(lengthBytes: 1600).then((frame) {
-                // Double-check state after async operation - must check _isStopping too
-                if (!_isRecording || _isStopping || _transcriptionService == null) {
-                  return;
-                }
-                if (frame.isEmpty) return;
-                try {
-                  _transcriptionService?.sendAudio(frame, source: 'system');
-                } catch (e) {
-                  print('[SpeechToTextProvider] Error sending system audio: $e');
-                }
-              }).catchError((error) {
-                print('[SpeechToTextProvider] Error getting system audio frame: $error');
-              });
-            },
-          );
+          _startSystemAudioPoll();
         } else {
           print('[SpeechToTextProvider] System audio capture not available');
         }
@@ -689,6 +937,25 @@ class SpeechToTextProvider extends ChangeNotifier {
           onAudioData: (audioData) {
             // Only send mic audio if useMic is still true, recording is active, and not stopping
             if (!_useMic || !_isRecording || _isStopping) return;
+
+            // Native analysers see every mic frame, including ones suppressed below.
+            if (_useNativeAnalytics) {
+              WindowsAudioService.pushMicAudio(audioData).then((ended) {
+                // A copied mic sends nothing upstream, so there is no mic
+                // utterance to finalize.
+                if (ended && _isRecording && !_isStopping && !_micIsDigitalCopy) {
+                  _transcriptionService?.finalizeUtterance('mic');
+                }
+              });
+            }
+
+            // The system stream already carries what a copied mic repeats.
+            // Nothing goes upstream meanwhile; the relay's keepalive timer
+            // holds the mic stream open.
+            if (_micIsDigitalCopy) {
+              _holdMicAudio(audioData);
+              return;
+            }
             
             final now = DateTime.now();
             
@@ -793,6 +1060,9 @@ class SpeechToTextProvider extends ChangeNotifier {
       }
 
       _isRecording = true;
+      if (_sessionCaptureEnabled && !_isReplaying) {
+        _isCapturingSession = await startSessionCapture(await _newSessionCapturePath());
+      }
       notifyListeners();
       print('[SpeechToTextProvider] Recording started${_useMic ? ' with microphone' : ' without microphone'}');
     } catch (e) {
@@ -824,6 +1094,25 @@ class SpeechToTextProvider extends ChangeNotifier {
           onAudioData: (audioData) {
             // Only send mic audio if useMic is still true, recording is active, and not stopping
             if (!_useMic || !_isRecording || _isStopping) return;
+
+            // Native analysers see every mic frame, including ones suppressed below.
+            if (_useNativeAnalytics) {
+              WindowsAudioService.pushMicAudio(audioData).then((ended) {
+                // A copied mic sends nothing upstream, so there is no mic
+                // utterance to finalize.
+                if (ended && _isRecording && !_isStopping && !_micIsDigitalCopy) {
+                  _transcriptionService?.finalizeUtterance('mic');
+                }
+              });
+            }
+
+            // The system stream already carries what a copied mic repeats.
+            // Nothing goes upstream meanwhile; the relay's keepalive timer
+            // holds the mic stream open.
+            if (_micIsDigitalCopy) {
+              _holdMicAudio(audioData);
+              return;
+            }
             
             final now = DateTime.now();
             
@@ -960,6 +1249,8 @@ class SpeechToTextProvider extends ChangeNotifier {
       } catch (e) {
         print('[SpeechToTextProvider] Error canceling system audio poll timer: $e');
       }
+      _sessionReplayTimer?.cancel();
+      _sessionReplayTimer = null;
       
       // STEP 3: Cancel transcript subscription to stop processing incoming messages
       try {
@@ -984,6 +1275,20 @@ class SpeechToTextProvider extends ChangeNotifier {
       }
       
       print('[SpeechToTextProvider] Recording stopped. Processed $_audioFrameCount audio frames');
+
+      // Capture the final analytics for this recording (cheap, fixed-size snapshot).
+      refreshConversationAnalytics();
+      refreshAudioQuality();
+      if (_isCapturingSession) {
+        _isCapturingSession = false;
+        stopSessionCapture().then((stats) => print('[SpeechToTextProvider] Session capture saved: $stats'));
+      }
+      if (_isReplaying) {
+        // Stopped from the meeting view rather than by stopReplay().
+        _isReplaying = false;
+        WindowsAudioService.stopSessionReplay();
+        _transcriptionService?.setReplaying(false);
+      }
       
       // STEP 5: Do cleanup in background (non-blocking)
       // This allows UI to remain responsive while cleanup happens
@@ -1085,8 +1390,241 @@ class SpeechToTextProvider extends ChangeNotifier {
     }
   }
 
+  /// Record the audio and downlink messages of the current session to [path]
+  /// so it can be replayed later (Windows only).
+  Future<bool> startSessionCapture(String path) async {
+    if (kIsWeb || !Platform.isWindows) return false;
+    final started = await WindowsAudioService.startSessionCapture(path);
+    if (started) {
+      _transcriptionService?.onRawMessage = (message) {
+        WindowsAudioService.recordSessionMessage(message);
+      };
+    }
+    return started;
+  }
+
+  /// Finish the capture; returns {records, bytes, durationMs}.
+  Future<Map<String, dynamic>> stopSessionCapture() async {
+    if (kIsWeb || !Platform.isWindows) return <String, dynamic>{};
+    _transcriptionService?.onRawMessage = null;
+    return WindowsAudioService.stopSessionCapture();
+  }
+
+  /// Session capture files in the documents folder, newest first.
+  Future<List<File>> listSessionCaptures() async {
+    if (kIsWeb || !Platform.isWindows) return const <File>[];
+    final dir = await getApplicationDocumentsDirectory();
+    final files = await dir
+        .list()
+        .where((e) => e is File && e.path.endsWith('.hnsc'))
+        .cast<File>()
+        .toList();
+    files.sort((a, b) => b.path.compareTo(a.path));
+    return files;
+  }
+
+  Future<String> _newSessionCapturePath() async {
+    final dir = await getApplicationDocumentsDirectory();
+    final stamp = DateTime.now().millisecondsSinceEpoch;
+    return '${dir.path}${Platform.pathSeparator}hearnow-session-$stamp.hnsc';
+  }
+
+  Future<void> _loadSessionCapture() async {
+    final prefs = await SharedPreferences.getInstance();
+    _sessionCaptureEnabled = prefs.getBool(_sessionCapturePrefsKey) ?? false;
+  }
+
+  /// Run a recorded session through the app instead of live capture: system
+  /// audio comes out of the native replayer, mic audio is fed to the native
+  /// analysers and the recorded transcripts stand in for the server's.
+  /// Nothing is sent upstream. [speed] <= 0 replays as fast as it is consumed.
+  Future<bool> startReplay(String path, {double speed = 1.0}) async {
+    if (kIsWeb || !Platform.isWindows || _isRecording || _transcriptionService == null) {
+      return false;
+    }
+    if (!await WindowsAudioService.startSessionReplay(path, speed: speed)) {
+      _errorMessage = 'Could not open session capture';
+      notifyListeners();
+      return false;
+    }
+    _transcriptionService!.setReplaying(true);
+    _isReplaying = true;
+    await startRecording(clearExisting: true, useMic: false);
+    if (!_isRecording) {
+      await stopReplay();
+      return false;
+    }
+
+    var polling = false;
+    _sessionReplayTimer?.cancel();
+    _sessionReplayTimer = Timer.periodic(const Duration(milliseconds: 50), (_) async {
+      if (polling || !_isRecording || _isStopping) return;
+      polling = true;
+      try {
+        final batch = await WindowsAudioService.pollSessionReplay();
+        if (batch.mic.isNotEmpty && _useNativeAnalytics) {
+          WindowsAudioService.pushMicAudio(batch.mic);
+        }
+        for (final message in batch.messages) {
+          _transcriptionService?.replayMessage(message);
+        }
+        if (batch.done) {
+          print('[SpeechToTextProvider] Session replay finished');
+          await stopReplay();
+        }
+      } finally {
+        polling = false;
+      }
+    });
+    return true;
+  }
+
+  Future<void> stopReplay() async {
+    _sessionReplayTimer?.cancel();
+    _sessionReplayTimer = null;
+    if (_isRecording) {
+      await stopRecording();
+    }
+    await WindowsAudioService.stopSessionReplay();
+    _transcriptionService?.setReplaying(false);
+    _isReplaying = false;
+    if (!_isDisposed) notifyListeners();
+  }
+
+  void _onKeyword(int keywordId, double score) {
+    if (keywordId != _voiceTriggerKeywordId || !_isRecording || _isStopping) return;
+    print('[SpeechToTextProvider] Voice trigger spotted (score ${score.toStringAsFixed(2)})');
+    _onVoiceTrigger?.call();
+  }
+
+  Future<void> _loadVoiceTrigger() async {
+    final prefs = await SharedPreferences.getInstance();
+    final stored = prefs.getStringList(_voiceTriggerPrefsKey) ?? const <String>[];
+    var loaded = 0;
+    for (final sample in stored) {
+      if (await WindowsAudioService.addKeywordTemplate(
+        keywordId: _voiceTriggerKeywordId,
+        audio: base64Decode(sample),
+      )) {
+        loaded++;
+      }
+    }
+    _voiceTriggerSamples = loaded;
+    if (!_isDisposed) notifyListeners();
+  }
+
+  Future<void> _loadEndpointAggressiveness() async {
+    final prefs = await SharedPreferences.getInstance();
+    _endpointAggressiveness = (prefs.getInt(_endpointAggressivenessPrefsKey) ?? 2).clamp(0, 3);
+    await WindowsAudioService.setEndpointAggressiveness(_endpointAggressiveness);
+  }
+
+  void _holdMicAudio(List<int> audio) {
+    _heldMicAudio.add(audio);
+    _heldMicAudioBytes += audio.length;
+    while (_heldMicAudioBytes > _heldMicAudioMaxBytes && _heldMicAudio.length > 1) {
+      _heldMicAudioBytes -= _heldMicAudio.removeAt(0).length;
+    }
+  }
+
+  void _clearHeldMicAudio() {
+    _heldMicAudio.clear();
+    _heldMicAudioBytes = 0;
+  }
+
+  /// Sends the mic audio held back during copy mode, oldest first, ahead of
+  /// the frames that follow.
+  void _flushHeldMicAudio() {
+    final held = List<List<int>>.of(_heldMicAudio);
+    _clearHeldMicAudio();
+    if (!_isRecording || _isStopping || !_useMic || held.isEmpty) return;
+    print('[SpeechToTextProvider] Sending ${held.length} mic frames held during copy mode');
+    for (final audio in held) {
+      _transcriptionService?.sendAudio(audio, source: 'mic');
+    }
+  }
+
+  Future<void> _loadAnswerMemory() async {
+    final prefs = await SharedPreferences.getInstance();
+    final raw = prefs.getString(_answerMemoryPrefsKey);
+    if (raw == null) return;
+    try {
+      for (final entry in jsonDecode(raw) as List<dynamic>) {
+        final map = Map<String, dynamic>.from(entry as Map);
+        final question = (map['q'] as String?) ?? '';
+        final answer = (map['a'] as String?) ?? '';
+        if (question.isEmpty || answer.isEmpty) continue;
+        _answerMemory.add({'q': question, 'a': answer});
+        await WindowsAudioService.indexAnswer(id: _answerId(question), text: question, payload: answer);
+      }
+    } catch (e) {
+      print('[SpeechToTextProvider] Failed to load answer memory: $e');
+    }
+  }
+
+  String _answerId(String question) => '$_answerIdPrefix${question.trim().toLowerCase()}';
+
+  Future<void> _rememberAnswer(String question, String answer) async {
+    final id = _answerId(question);
+    _answerMemory.removeWhere((e) => _answerId(e['q']!) == id);
+    _answerMemory.add({'q': question, 'a': answer});
+    if (_useNativeAnalytics) {
+      await WindowsAudioService.indexAnswer(id: id, text: question, payload: answer);
+    }
+    while (_answerMemory.length > _maxAnswerMemory) {
+      final oldest = _answerMemory.removeAt(0);
+      if (_useNativeAnalytics) {
+        await WindowsAudioService.removeIndexedAnswer(_answerId(oldest['q']!));
+      }
+    }
+    final prefs = await SharedPreferences.getInstance();
+    await prefs.setString(_answerMemoryPrefsKey, jsonEncode(_answerMemory));
+  }
+
+  /// Enroll the last two seconds of mic audio as a sample of the voice
+  /// trigger phrase; say it right before calling. Keeps the newest few samples.
+  Future<bool> enrollVoiceTrigger() async {
+    if (!_useNativeAnalytics || !_isRecording || !_useMic) return false;
+    final audio = await WindowsAudioService.getAudioHistory(source: 'mic', seconds: 2);
+    if (audio.isEmpty) return false;
+
+    final prefs = await SharedPreferences.getInstance();
+    final stored = List<String>.from(prefs.getStringList(_voiceTriggerPrefsKey) ?? const <String>[]);
+    if (stored.length >= _maxVoiceTriggerSamples) {
+      // Re-enroll without the oldest sample to make room.
+      stored.removeAt(0);
+      await WindowsAudioService.removeKeyword(_voiceTriggerKeywordId);
+      for (final sample in stored) {
+        await WindowsAudioService.addKeywordTemplate(
+          keywordId: _voiceTriggerKeywordId,
+          audio: base64Decode(sample),
+        );
+      }
+    }
+    final ok = await WindowsAudioService.addKeywordTemplate(
+      keywordId: _voiceTriggerKeywordId,
+      audio: audio,
+    );
+    if (ok) stored.add(base64Encode(audio));
+    await prefs.setStringList(_voiceTriggerPrefsKey, stored);
+    _voiceTriggerSamples = stored.length;
+    if (!_isDisposed) notifyListeners();
+    return ok;
+  }
+
+  Future<void> clearVoiceTrigger() async {
+    final prefs = await SharedPreferences.getInstance();
+    await prefs.remove(_voiceTriggerPrefsKey);
+    if (_useNativeAnalytics) {
+      await WindowsAudioService.removeKeyword(_voiceTriggerKeywordId);
+    }
+    _voiceTriggerSamples = 0;
+    if (!_isDisposed) notifyListeners();
+  }
+
   void clearTranscript() {
     _bubbles.clear();
+    _draft.value = null;
     _errorMessage = '';
     _aiResponse = '';
     _aiErrorMessage = '';
@@ -1095,6 +1633,7 @@ class SpeechToTextProvider extends ChangeNotifier {
 
   void restoreBubbles(List<TranscriptBubble> bubbles) {
     _bubbles.clear();
+    _draft.value = null;
     // Resource optimization: Only restore recent bubbles to limit memory usage
     // If restoring a very long session, keep only the most recent bubbles
     if (bubbles.length > _maxBubblesInMemory) {
@@ -1106,15 +1645,114 @@ class SpeechToTextProvider extends ChangeNotifier {
     notifyListeners();
   }
 
+  void _onPowerState(NativePowerState state) {
+    if (_isDisposed || state.deliveryIntervalMs == _audioDeliveryIntervalMs) return;
+    _audioDeliveryIntervalMs = state.deliveryIntervalMs;
+    print('[SpeechToTextProvider] Power mode ${state.mode}, system audio every '
+        '${_audioDeliveryIntervalMs == 0 ? 'frame' : '${_audioDeliveryIntervalMs}ms'}');
+    if (_systemAudioPollTimer != null) _startSystemAudioPoll();
+  }
+
+  void _startSystemAudioPoll() {
+    _systemAudioPollTimer?.cancel();
+    // Resource optimization: Adaptive polling frequency
+    // Use faster polling when system audio is active, slower when idle
+    final hasRecentSystemActivity = _recentSystemTranscripts.isNotEmpty;
+    var pollInterval = hasRecentSystemActivity
+        ? const Duration(milliseconds: 50)  // Fast when active (20 Hz)
+        : const Duration(milliseconds: 100);  // Slower when idle (10 Hz) - saves CPU/battery
+    // Pull ~50ms at 16kHz mono PCM16 => 16000*0.05*2 = 1600 bytes
+    const pieceBytes = 1600;
+    var lengthBytes = pieceBytes;
+    int? batchPieceBytes;
+    if (_audioDeliveryIntervalMs > 0) {
+      // Hidden: one pull per delivery interval, sent on in the usual 50 ms
+      // pieces. The runner labels each piece with the speaker and utterance
+      // end a 50 ms pull would have seen, so finalize requests land after
+      // the same audio as when visible.
+      pollInterval = Duration(milliseconds: _audioDeliveryIntervalMs);
+      lengthBytes = _audioDeliveryIntervalMs * 32;
+      batchPieceBytes = pieceBytes;
+    }
+
+    _systemAudioPollTimer = Timer.periodic(
+      pollInterval,
+      (_) {
+        // Check if recording is still active and not stopping before processing
+        if (!_isRecording || _isStopping || _transcriptionService == null) {
+          return;
+        }
+
+        // Note: We don't suppress system audio when mic finalizes because:
+        // 1. System audio is typically the original source (video calls, apps, etc.)
+        // 2. Suppressing system audio causes delays in transcription
+        // 3. Mic echo suppression is handled by suppressing mic audio instead
+
+        WindowsAudioService.getSystemAudioFrameWithSpeaker(
+          lengthBytes: lengthBytes,
+          pieceBytes: batchPieceBytes,
+        ).then((frame) {
+          // Double-check state after async operation - must check _isStopping too
+          if (!_isRecording || _isStopping || _transcriptionService == null) {
+            return;
+          }
+          if (frame.pieces.isEmpty) {
+            // A single 50 ms pull, or a replay: the frame's speaker and end
+            // cover all of it.
+            if (frame.speakerId >= 0) {
+              _systemSpeakerId = frame.speakerId;
+            }
+            for (var offset = 0; offset < frame.audio.length; offset += pieceBytes) {
+              _sendSystemAudio(frame.audio, offset, pieceBytes);
+            }
+            if (frame.endOfUtterance) {
+              _transcriptionService?.finalizeUtterance('system');
+            }
+            return;
+          }
+          for (var i = 0; i < frame.pieces.length; i++) {
+            final piece = frame.pieces[i];
+            if (piece.speakerId >= 0) {
+              _systemSpeakerId = piece.speakerId;
+            }
+            _sendSystemAudio(frame.audio, i * pieceBytes, pieceBytes);
+            if (piece.endOfUtterance) {
+              _transcriptionService?.finalizeUtterance('system');
+            }
+          }
+        }).catchError((error) {
+          print('[SpeechToTextProvider] Error getting system audio frame: $error');
+        });
+      },
+    );
+  }
+
+  void _sendSystemAudio(List<int> audio, int offset, int length) {
+    if (offset >= audio.length) return;
+    final end = offset + length < audio.length ? offset + length : audio.length;
+    try {
+      _transcriptionService?.sendAudio(audio.sublist(offset, end), source: 'system');
+    } catch (e) {
+      print('[SpeechToTextProvider] Error sending system audio: $e');
+    }
+  }
+
   @override
   void dispose() {
     _isDisposed = true;
+    if (_useNativeAnalytics) {
+      WindowsAudioService.setKeywordHandler(null);
+    }
     _mockAudioTimer?.cancel();
     _systemAudioPollTimer?.cancel();
+    _sessionReplayTimer?.cancel();
     _transcriptSubscription?.cancel();
+    _micCopySubscription?.cancel();
+    _powerStateSubscription?.cancel();
     _audioCaptureService?.dispose();
     _transcriptionService?.dispose();
     _aiService?.dispose();
+    _draft.dispose();
     super.dispose();
   }
 }
@@ -0,0 +1,208 @@
+import 'dart:async';
+import 'package:flutter/material.dart';
+import 'package:provider/provider.dart';
+import '../config/app_config.dart';
+import '../providers/auth_provider.dart';
+import '../services/follow_service.dart';
+import '../services/transcription_service.dart';
+
+/// Read-only live view of a meeting someone else is sharing. Takes the share
+/// link (or bare id) they sent and shows the transcript as it arrives.
+class FollowPage extends StatefulWidget {
+  const FollowPage({super.key});
+
+  @override
+  State<FollowPage> createState() => _FollowPageState();
+}
+
+class _FollowLine {
+  final String source;
+  final String text;
+
+  const _FollowLine(this.source, this.text);
+}
+
+class _FollowPageState extends State<FollowPage> {
+  final TextEditingController _shareController = TextEditingController();
+  final ScrollController _scrollController = ScrollController();
+  FollowService? _service;
+  StreamSubscription<TranscriptionResult>? _subscription;
+  final List<_FollowLine> _finals = [];
+  final Map<String, String> _interims = {};
+  bool _following = false;
+  String? _status;
+
+  Future<void> _follow() async {
+    final shareId = FollowService.parseShareId(_shareController.text);
+    if (shareId == null) {
+      setState(() => _status = 'Paste the share link or id you were sent');
+      return;
+    }
+    _stop();
+    final service = FollowService(
+      serverUrl: AppConfig.serverFollowWebSocketUrl,
+      authToken: context.read<AuthProvider>().token,
+    );
+    service.onEnded = (reason) {
+      if (!mounted) return;
+      setState(() {
+        _following = false;
+        _status = reason;
+        _interims.clear();
+      });
+    };
+    _subscription = service.transcriptStream.listen(_onTranscript);
+    _service = service;
+    setState(() {
+      _finals.clear();
+      _interims.clear();
+      _following = true;
+      _status = 'Following';
+    });
+    await service.connect(shareId);
+  }
+
+  void _onTranscript(TranscriptionResult result) {
+    if (!mounted) return;
+    setState(() {
+      if (result.isFinal) {
+        _interims.remove(result.source);
+        _finals.add(_FollowLine(result.source, result.text));
+      } else {
+        _interims[result.source] = result.text;
+      }
+    });
+    WidgetsBinding.instance.addPostFrameCallback((_) {
+      if (_scrollController.hasClients) {
+        _scrollController.jumpTo(_scrollController.position.maxScrollExtent);
+      }
+    });
+  }
+
+  void _stop() {
+    _subscription?.cancel();
+    _subscription = null;
+    _service?.dispose();
+    _service = null;
+    _following = false;
+  }
+
+  @override
+  void dispose() {
+    _stop();
+    _shareController.dispose();
+    _scrollController.dispose();
+    super.dispose();
+  }
+
+  String _label(String source) => switch (source) {
+        'mic' => 'Host',
+        'system' => 'Others',
+        _ => 'Unknown',
+      };
+
+  Widget _buildLine(_FollowLine line, {bool interim = false}) {
+    final colorScheme = Theme.of(context).colorScheme;
+    return Padding(
+      padding: const EdgeInsets.symmetric(vertical: 4),
+      child: Row(
+        crossAxisAlignment: CrossAxisAlignment.start,
+        children: [
+          SizedBox(
+            width: 64,
+            child: Text(
+              _label(line.source),
+              style: TextStyle(fontWeight: FontWeight.bold, color: colorScheme.primary),
+            ),
+          ),
+          Expanded(
+            child: Text(
+              line.text,
+              style: TextStyle(
+                color: interim ? colorScheme.onSurface.withValues(alpha: 0.5) : colorScheme.onSurface,
+                fontStyle: interim ? FontStyle.italic : FontStyle.normal,
+              ),
+            ),
+          ),
+        ],
+      ),
+    );
+  }
+
+  @override
+  Widget build(BuildContext context) {
+    final colorScheme = Theme.of(context).colorScheme;
+    final lines = [
+      ..._finals.map((line) => _buildLine(line)),
+      ..._interims.entries.map((e) => _buildLine(_FollowLine(e.key, e.value), interim: true)),
+    ];
+    return Scaffold(
+      backgroundColor: colorScheme.surface,
+      appBar: AppBar(
+        title: const Text('Follow a Meeting'),
+      ),
+      body: Column(
+        children: [
+          Padding(
+            padding: const EdgeInsets.all(16),
+            child: Row(
+              children: [
+                Expanded(
+                  child: TextField(
+                    controller: _shareController,
+                    decoration: const InputDecoration(
+                      labelText: 'Share link or id',
+                      border: OutlineInputBorder(),
+                    ),
+                    onSubmitted: (_) => _follow(),
+                  ),
+                ),
+                const SizedBox(width: 12),
+                _following
+                    ? OutlinedButton.icon(
+                        onPressed: () => setState(() {
+                          _stop();
+                          _status = 'Stopped following';
+                        }),
+                        icon: const Icon(Icons.stop),
+                        label: const Text('Stop'),
+                      )
+                    : FilledButton.icon(
+                        onPressed: _follow,
+                        icon: const Icon(Icons.visibility),
+                        label: const Text('Follow'),
+                      ),
+              ],
+            ),
+          ),
+          if (_status != null)
+            Padding(
+              padding: const EdgeInsets.symmetric(horizontal: 16),
+              child: Align(
+                alignment: Alignment.centerLeft,
+                child: Text(
+                  _status!,
+                  style: TextStyle(fontSize: 13, color: colorScheme.onSurface.withValues(alpha: 0.7)),
+                ),
+              ),
+            ),
+          const Divider(height: 24),
+          Expanded(
+            child: lines.isEmpty
+                ? Center(
+                    child: Text(
+                      _following ? 'Waiting for the transcript...' : 'Nothing to show yet',
+                      style: TextStyle(color: colorScheme.onSurface.withValues(alpha: 0.6)),
+                    ),
+                  )
+                : ListView(
+                    controller: _scrollController,
+                    padding: const EdgeInsets.symmetric(horizontal: 16),
+                    children: lines,
+                  ),
+          ),
+        ],
+      ),
+    );
+  }
+}
@@ -5,6 +5,7 @@ import '../providers/meeting_provider.dart';
 import '../providers/auth_provider.dart';
 import '../providers/speech_to_text_provider.dart';
 import '../models/meeting_session.dart';
+import 'follow_page.dart';
 
 class _HoverableListTile extends StatefulWidget {
   final MeetingSession session;
@@ -720,6 +721,18 @@ class _HomePageState extends State<HomePage> {
                     ),
                   ),
                   const SizedBox(width: 16),
+                  OutlinedButton.icon(
+                    onPressed: () => Navigator.push(
+                      context,
+                      MaterialPageRoute(builder: (context) => const FollowPage()),
+                    ),
+                    icon: const Icon(Icons.visibility, size: 18),
+                    label: const Text('Follow', style: TextStyle(fontSize: 13)),
+                    style: OutlinedButton.styleFrom(
+                      padding: const EdgeInsets.symmetric(horizontal: 12, vertical: 12),
+                    ),
+                  ),
+                  const SizedBox(width: 8),
                   SizedBox(
                     width: 140,
                     child: FilledButton.icon(
@@ -3,6 +3,8 @@ import 'package:flutter/services.dart';
 import 'package:provider/provider.dart';
 import 'package:shared_preferences/shared_preferences.dart';
 import 'dart:async';
+import 'dart:io' show Platform;
+import 'package:flutter/foundation.dart' show kIsWeb;
 import '../config/app_config.dart';
 import '../providers/speech_to_text_provider.dart';
 import '../providers/meeting_provider.dart';
@@ -13,6 +15,7 @@ import '../models/transcript_bubble.dart';
 import '../services/meeting_question_service.dart';
 import '../services/meeting_mode_service.dart';
 import '../services/ai_service.dart';
+import '../services/windows_audio_service.dart';
 import '../providers/shortcuts_provider.dart';
 import 'manage_mode_page.dart';
 import 'manage_question_templates_page.dart';
@@ -39,6 +42,8 @@ class _MeetingPageEnhancedState extends State<MeetingPageEnhanced> {
   MeetingProvider? _meetingProvider;
   Timer? _recordingTimer;
   DateTime? _recordingStartedAt;
+  StreamSubscription<NativePowerState>? _powerStateSubscription;
+  bool _windowHidden = false; // Minimized, covered or locked; the clock stops ticking
   bool _showMarkers = true;
   bool _useMic = false;
   bool _autoAsk = false;
@@ -47,6 +52,8 @@ class _MeetingPageEnhancedState extends State<MeetingPageEnhanced> {
   bool _showConversationPanel = true;
   bool _showAiPanel = true;
   bool _isUpdatingBubbles = false; // Flag to prevent infinite loops
+  Map<String, dynamic>? _syncedAudioQuality;
+  Map<String, dynamic>? _syncedConversationAnalytics;
   MeetingModeService? _modeService;
   Future<List<ModeDisplay>>? _modeDisplaysFuture;
   VoidCallback? _modesVersionListener;
@@ -66,6 +73,18 @@ class _MeetingPageEnhancedState extends State<MeetingPageEnhanced> {
       }
     };
     MeetingModeService.customModesVersion.addListener(_modesVersionListener!);
+    if (!kIsWeb && (Platform.isWindows || Platform.isLinux)) {
+      _powerStateSubscription = WindowsAudioService.powerStateChanges.listen((state) {
+        if (!mounted || _windowHidden == !state.interactive) return;
+        _windowHidden = !state.interactive;
+        if (_windowHidden) {
+          _recordingTimer?.cancel();
+          _recordingTimer = null;
+        } else {
+          setState(() {}); // Restarts the clock from _recordingStartedAt
+        }
+      });
+    }
     WidgetsBinding.instance.addPostFrameCallback((_) async {
       final authProvider = context.read<AuthProvider>();
       _speechProvider = context.read<SpeechToTextProvider>();
@@ -135,6 +154,11 @@ class _MeetingPageEnhancedState extends State<MeetingPageEnhanced> {
       
       // Set up auto ask callback
       _updateAutoAskCallback();
+
+      // Saying the enrolled voice trigger acts like the Ask AI shortcut.
+      _speechProvider!.setVoiceTriggerCallback(() {
+        if (mounted) _askAiWithPrompt(_askAiController.text);
+      });
       
       // Load question templates
       _loadQuestionTemplates();
@@ -183,6 +207,29 @@ class _MeetingPageEnhancedState extends State<MeetingPageEnhanced> {
       if (hasChanged && mounted && _meetingProvider?.currentSession != null) {
         _meetingProvider!.updateCurrentSessionBubbles(currentBubbles);
       }
+
+      // The audio quality summary and the conversation analytics are
+      // refreshed when recording stops; keep each new one with the session.
+      final quality = _speechProvider!.audioQuality;
+      if (!identical(quality, _syncedAudioQuality) && mounted) {
+        _syncedAudioQuality = quality;
+        _isUpdatingBubbles = true;
+        try {
+          _meetingProvider!.setAudioQuality(quality);
+        } finally {
+          _isUpdatingBubbles = false;
+        }
+      }
+      final analytics = _speechProvider!.conversationAnalytics;
+      if (!identical(analytics, _syncedConversationAnalytics) && mounted) {
+        _syncedConversationAnalytics = analytics;
+        _isUpdatingBubbles = true;
+        try {
+          _meetingProvider!.setConversationAnalytics(analytics);
+        } finally {
+          _isUpdatingBubbles = false;
+        }
+      }
     } catch (e) {
       debugPrint('Error in _syncBubblesToSession: $e');
       // Don't rethrow - just log to prevent crashes
@@ -254,6 +301,7 @@ class _MeetingPageEnhancedState extends State<MeetingPageEnhanced> {
       MeetingModeService.customModesVersion.removeListener(listener);
     }
     _recordingTimer?.cancel();
+    _powerStateSubscription?.cancel();
     _transcriptScrollController.dispose();
     _askAiController.dispose();
     _aiResponseController.dispose();
@@ -286,6 +334,8 @@ class _MeetingPageEnhancedState extends State<MeetingPageEnhanced> {
       // If recording started time is not set, calculate it from session/bubbles
       // This ensures that when resuming a session, we continue from where we left off
       _recordingStartedAt ??= _calculateRecordingStartTime() ?? DateTime.now();
+      // Nobody sees the elapsed time while the window is hidden.
+      if (_windowHidden) return;
       _recordingTimer ??= Timer.periodic(const Duration(seconds: 1), (_) {
         if (!mounted) return;
         setState(() {});
@@ -350,6 +400,60 @@ class _MeetingPageEnhancedState extends State<MeetingPageEnhanced> {
     return null;
   }
 
+  /// Shares the running meeting read-only, or stops sharing it. The link is
+  /// shown with its expiry so it can be sent to followers.
+  Future<void> _toggleSharing(SpeechToTextProvider speechProvider) async {
+    if (speechProvider.isSharing) {
+      speechProvider.stopSharing();
+      return;
+    }
+    final shareId = await speechProvider.startSharing();
+    if (!mounted) return;
+    if (shareId == null) {
+      ScaffoldMessenger.of(context).showSnackBar(
+        const SnackBar(content: Text('Could not share the meeting')),
+      );
+      return;
+    }
+    final link = '${AppConfig.serverFollowWebSocketUrl}?share=$shareId';
+    final expiresAt = speechProvider.shareExpiresAt;
+    await showDialog<void>(
+      context: context,
+      builder: (context) => AlertDialog(
+        title: const Text('Meeting shared'),
+        content: Column(
+          mainAxisSize: MainAxisSize.min,
+          crossAxisAlignment: CrossAxisAlignment.start,
+          children: [
+            const Text('Anyone signed in with this link can follow the live transcript:'),
+            const SizedBox(height: 8),
+            SelectableText(link, style: const TextStyle(fontFamily: 'monospace')),
+            if (expiresAt != null) ...[
+              const SizedBox(height: 8),
+              Text(
+                'Expires at ${_formatWallTime(expiresAt)}',
+                style: TextStyle(fontSize: 12, color: Theme.of(context).colorScheme.onSurface.withValues(alpha: 0.7)),
+              ),
+            ],
+          ],
+        ),
+        actions: [
+          TextButton(
+            onPressed: () {
+              Clipboard.setData(ClipboardData(text: link));
+              Navigator.pop(context);
+            },
+            child: const Text('Copy link'),
+          ),
+          TextButton(
+            onPressed: () => Navigator.pop(context),
+            child: const Text('Close'),
+          ),
+        ],
+      ),
+    );
+  }
+
   Future<void> _markMoment() async {
     final meetingProvider = context.read<MeetingProvider>();
     
@@ -609,6 +713,7 @@ class _MeetingPageEnhancedState extends State<MeetingPageEnhanced> {
     required String text,
     required DateTime timestamp,
     DateTime? meetingStartTime,
+    TranscriptDraft? draft,
   }) {
     final isMe = source == TranscriptSource.mic;
     // Make bubbles more transparent - use black background with low opacity for better readability
@@ -616,6 +721,33 @@ class _MeetingPageEnhancedState extends State<MeetingPageEnhanced> {
         ? Colors.blue.shade600.withValues(alpha: 0.3) 
         : Colors.grey.shade800.withValues(alpha: 0.3);
     final textColor = isMe ? Colors.white : Colors.white;
+    final textStyle = TextStyle(
+      fontSize: 16,
+      color: textColor,
+      fontStyle: FontStyle.normal,
+      shadows: [
+        Shadow(
+          color: Colors.black.withValues(alpha: 0.9),
+          blurRadius: 5,
+          offset: const Offset(1, 1),
+        ),
+        Shadow(
+          color: Colors.black.withValues(alpha: 0.9),
+          blurRadius: 5,
+          offset: const Offset(-1, -1),
+        ),
+        Shadow(
+          color: Colors.black.withValues(alpha: 0.9),
+          blurRadius: 5,
+          offset: const Offset(1, -1),
+        ),
+        Shadow(
+          color: Colors.black.withValues(alpha: 0.9),
+          blurRadius: 5,
+          offset: const Offset(-1, 1),
+        ),
+      ],
+    );
     
     // Calculate relative time from meeting start
     String timeDisplay;
@@ -659,36 +791,17 @@ class _MeetingPageEnhancedState extends State<MeetingPageEnhanced> {
               crossAxisAlignment: CrossAxisAlignment.start,
               mainAxisSize: MainAxisSize.min,
               children: [
-                Text(
-                  text,
-                  style: TextStyle(
-                    fontSize: 16,
-                    color: textColor,
-                    fontStyle: FontStyle.normal,
-                    shadows: [
-                      Shadow(
-                        color: Colors.black.withValues(alpha: 0.9),
-                        blurRadius: 5,
-                        offset: const Offset(1, 1),
-                      ),
-                      Shadow(
-                        color: Colors.black.withValues(alpha: 0.9),
-                        blurRadius: 5,
-                        offset: const Offset(-1, -1),
-                      ),
-                      Shadow(
-                        color: Colors.black.withValues(alpha: 0.9),
-                        blurRadius: 5,
-                        offset: const Offset(1, -1),
-                      ),
-                      Shadow(
-                        color: Colors.black.withValues(alpha: 0.9),
-                        blurRadius: 5,
-                        offset: const Offset(-1, 1),
-                      ),
+                if (draft == null || draft.stable.isEmpty)
+                  Text(text, style: textStyle)
+                else
+                  // The stable prefix is its own paragraph, so interim edits
+                  // to the tail do not re-lay it out.
+                  Wrap(
+                    children: [
+                      RepaintBoundary(child: Text(draft.stable, style: textStyle)),
+                      Text(draft.tail, style: textStyle),
                     ],
                   ),
-                ),
                 const SizedBox(height: 4),
                 Align(
                   alignment: isMe ? Alignment.centerRight : Alignment.centerLeft,
@@ -1077,6 +1190,23 @@ class _MeetingPageEnhancedState extends State<MeetingPageEnhanced> {
         } else if (_recordingStartedAt != null) {
           meetingStartTime = _recordingStartedAt;
         }
+        if (b.isDraft && index == bubbles.length - 1) {
+          // Interim edits to the live draft notify only this listener.
+          return ValueListenableBuilder<TranscriptDraft?>(
+            valueListenable: speechProvider.draft,
+            builder: (context, draft, _) {
+              final live = draft != null && draft.source == b.source ? draft : null;
+              _maybeAutoScroll(speechProvider);
+              return _buildBubble(
+                source: b.source,
+                text: live?.text ?? b.text,
+                timestamp: b.timestamp,
+                meetingStartTime: meetingStartTime,
+                draft: live,
+              );
+            },
+          );
+        }
         return _buildBubble(
           source: b.source,
           text: b.text,
@@ -1368,6 +1498,13 @@ class _MeetingPageEnhancedState extends State<MeetingPageEnhanced> {
                               icon: const Icon(Icons.bookmark_add_outlined),
                               style: dockButtonStyle,
                             ),
+                            if (isRec || speechProvider.isSharing)
+                              IconButton.outlined(
+                                onPressed: () => _toggleSharing(speechProvider),
+                                tooltip: speechProvider.isSharing ? 'Stop sharing' : 'Share live transcript',
+                                icon: Icon(speechProvider.isSharing ? Icons.stop_screen_share : Icons.share),
+                                style: dockButtonStyle,
+                              ),
                             IconButton.outlined(
                               onPressed: isRec ? null : speechProvider.clearTranscript,
                               tooltip: 'Clear transcript',
@@ -1898,9 +2035,14 @@ class _MeetingPageEnhancedState extends State<MeetingPageEnhanced> {
       builder: (context, speechProvider, meetingProvider, child) {
         _maybeAutoScroll(speechProvider);
 
+        // A matching past answer stands in until the live response starts.
         final aiText = speechProvider.aiErrorMessage.isNotEmpty
             ? 'Error: ${speechProvider.aiErrorMessage}'
-            : speechProvider.aiResponse;
+            : speechProvider.isAiLoading &&
+                    speechProvider.aiResponse.isEmpty &&
+                    speechProvider.instantAnswer.isNotEmpty
+                ? speechProvider.instantAnswer
+                : speechProvider.aiResponse;
         if (_aiResponseController.text != aiText) {
           _aiResponseController.text = aiText;
           _aiResponseController.selection = TextSelection.collapsed(
@@ -2244,9 +2386,43 @@ class _MeetingPageEnhancedState extends State<MeetingPageEnhanced> {
                                       ],
                                     ),
                                   ),
+                                  if (!kIsWeb && Platform.isWindows) ...[
+                                    PopupMenuItem(
+                                      value: 'voiceTrigger',
+                                      enabled: speechProvider.isRecording && speechProvider.useMic,
+                                      child: Row(
+                                        children: [
+                                          const Icon(Icons.record_voice_over, size: 20),
+                                          const SizedBox(width: 8),
+                                          Text('Use last phrase as Ask AI trigger (${speechProvider.voiceTriggerSamples}/4)'),
+                                        ],
+                                      ),
+                                    ),
+                                    if (speechProvider.voiceTriggerSamples > 0)
+                                      const PopupMenuItem(
+                                        value: 'clearVoiceTrigger',
+                                        child: Row(
+                                          children: [
+                                            Icon(Icons.voice_over_off, size: 20),
+                                            SizedBox(width: 8),
+                                            Text('Clear Ask AI trigger'),
+                                          ],
+                                        ),
+                                      ),
+                                  ],
                                 ],
-                                onSelected: (value) {
-                                  if (value == 'sessions') {
+                                onSelected: (value) async {
+                                  if (value == 'voiceTrigger') {
+                                    final messenger = ScaffoldMessenger.of(context);
+                                    final ok = await speechProvider.enrollVoiceTrigger();
+                                    messenger.showSnackBar(SnackBar(
+                                      content: Text(ok
+                                          ? 'Ask AI trigger sample saved'
+                                          : 'No clear phrase in the last 2 seconds of mic audio'),
+                                    ));
+                                  } else if (value == 'clearVoiceTrigger') {
+                                    await speechProvider.clearVoiceTrigger();
+                                  } else if (value == 'sessions') {
                                     Navigator.push(
                                       context,
                                       MaterialPageRoute(
@@ -1,16 +1,21 @@
+import 'package:flutter/foundation.dart';
 import 'package:flutter/material.dart';
 import 'package:flutter/services.dart';
 import 'package:provider/provider.dart';
+import 'dart:async';
 import 'dart:io' show Platform;
+import 'package:path_provider/path_provider.dart';
 import 'package:record/record.dart';
 import 'package:shared_preferences/shared_preferences.dart';
 
 import '../config/app_config.dart';
 import '../providers/shortcuts_provider.dart';
 import '../providers/auth_provider.dart';
+import '../providers/speech_to_text_provider.dart';
 import '../providers/theme_provider.dart';
 import '../services/shortcuts_service.dart';
 import '../services/appearance_service.dart';
+import '../services/windows_audio_service.dart';
 import 'email_change_verification_dialog.dart';
 import 'manage_mode_page.dart';
 import 'manage_question_templates_page.dart';
@@ -249,12 +254,19 @@ class _AudioDeviceSettingsState extends State<_AudioDeviceSettings> {
   String? _selectedDeviceId;
   bool _isLoading = true;
   String? _errorMessage;
+  StreamSubscription<int>? _deviceChanges;
+
+  bool get _useNativeRegistry => !kIsWeb && Platform.isWindows;
 
   @override
   void initState() {
     super.initState();
     _loadDevices();
     _loadSelectedDevice();
+    if (_useNativeRegistry) {
+      // Plugged or unplugged devices show up without reopening the page.
+      _deviceChanges = WindowsAudioService.audioDeviceChanges.listen((_) => _loadDevices());
+    }
   }
 
   Future<void> _loadDevices() async {
@@ -264,7 +276,11 @@ class _AudioDeviceSettingsState extends State<_AudioDeviceSettings> {
     });
 
     try {
-      final devices = await _recorder.listInputDevices();
+      final devices = _useNativeRegistry
+          ? (await WindowsAudioService.getAudioDevices(flow: 'capture'))
+              .map((d) => InputDevice(id: d.id, label: d.name))
+              .toList()
+          : await _recorder.listInputDevices();
       if (mounted) {
         setState(() {
           _devices = devices;
@@ -318,10 +334,80 @@ class _AudioDeviceSettingsState extends State<_AudioDeviceSettings> {
 
   @override
   void dispose() {
+    _deviceChanges?.cancel();
     _recorder.dispose();
     super.dispose();
   }
 
+  Future<void> _pickReplay(SpeechToTextProvider speech) async {
+    final captures = await speech.listSessionCaptures();
+    if (!mounted) return;
+    if (captures.isEmpty) {
+      ScaffoldMessenger.of(context).showSnackBar(
+        const SnackBar(content: Text('No session captures yet. Turn on session capture and record a meeting.')),
+      );
+      return;
+    }
+    final path = await showDialog<String>(
+      context: context,
+      builder: (context) => SimpleDialog(
+        title: const Text('Replay a session capture'),
+        children: captures
+            .map((file) => SimpleDialogOption(
+                  onPressed: () => Navigator.of(context).pop(file.path),
+                  child: Text(file.uri.pathSegments.last),
+                ))
+            .toList(),
+      ),
+    );
+    if (path == null || !mounted) return;
+    final started = await speech.startReplay(path);
+    if (mounted) {
+      ScaffoldMessenger.of(context).showSnackBar(
+        SnackBar(
+          content: Text(started
+            ? 'Replaying the session; open the meeting view to watch it'
+            : 'Could not replay the session. Stop recording first.'),
+        ),
+      );
+    }
+  }
+
+  Widget _buildSessionCapture() {
+    return Consumer<SpeechToTextProvider>(
+      builder: (context, speech, child) {
+        return Card(
+          child: Column(
+            children: [
+              SwitchListTile(
+                title: const Text('Session Capture'),
+                subtitle: const Text(
+                  'Save the audio and transcripts of each recording to the documents folder for replay',
+                ),
+                value: speech.sessionCaptureEnabled,
+                onChanged: speech.setSessionCaptureEnabled,
+                secondary: const Icon(Icons.fiber_manual_record),
+              ),
+              ListTile(
+                leading: const Icon(Icons.replay),
+                title: const Text('Replay a Session Capture'),
+                subtitle: const Text('Run a saved session through the app instead of live audio'),
+                enabled: !speech.isRecording,
+                onTap: () => _pickReplay(speech),
+              ),
+              if (speech.isReplaying)
+                ListTile(
+                  leading: const Icon(Icons.stop),
+                  title: const Text('Stop Replay'),
+                  onTap: speech.stopReplay,
+                ),
+            ],
+          ),
+        );
+      },
+    );
+  }
+
   @override
   Widget build(BuildContext context) {
     return ListView(
@@ -462,6 +548,10 @@ class _AudioDeviceSettingsState extends State<_AudioDeviceSettings> {
             ),
           ),
         ),
+        if (_useNativeRegistry) ...[
+          const SizedBox(height: 16),
+          _buildSessionCapture(),
+        ],
       ],
     );
   }
@@ -1334,14 +1424,35 @@ class _AppearanceSettingsState extends State<_AppearanceSettings> {
     }
   }
 
+  // Hidden: a long press on the title takes a 30 s native CPU profile for a
+  // bug report.
+  Future<void> _startProfile() async {
+    final dir = await getApplicationDocumentsDirectory();
+    final stamp = DateTime.now().millisecondsSinceEpoch;
+    final path = '${dir.path}${Platform.pathSeparator}hearnow-$stamp.pb.gz';
+    final started = await WindowsAudioService.startProfile(path);
+    if (mounted) {
+      ScaffoldMessenger.of(context).showSnackBar(
+        SnackBar(
+          content: Text(started
+            ? 'Profiling for 30 s to $path'
+            : 'A profile is already being taken'),
+        ),
+      );
+    }
+  }
+
   @override
   Widget build(BuildContext context) {
     return ListView(
       padding: const EdgeInsets.all(16),
       children: [
-        const Text(
-          'Appearance',
-          style: TextStyle(fontSize: 18, fontWeight: FontWeight.bold),
+        GestureDetector(
+          onLongPress: _startProfile,
+          child: const Text(
+            'Appearance',
+            style: TextStyle(fontSize: 18, fontWeight: FontWeight.bold),
+          ),
         ),
         const SizedBox(height: 24),
         if (_isLoading)
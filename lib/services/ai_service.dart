@@ -2,8 +2,11 @@ import 'dart:async';
 import 'dart:convert';
 
 import 'package:http/http.dart' as http;
+import 'package:stream_channel/stream_channel.dart';
 import 'package:web_socket_channel/web_socket_channel.dart';
 
+import 'mux_connection_service.dart';
+
 /// AI client that can call the backend via HTTP or via WebSocket streaming.
 class AiService {
   final String httpBaseUrl;
@@ -13,11 +16,15 @@ class AiService {
   final String? aiWsUrl;
 
   String? _authToken;
-  WebSocketChannel? _aiChannel;
+  // A stream of the shared native connection where available, otherwise a
+  // WebSocket of its own.
+  StreamChannel<dynamic>? _aiChannel;
   StreamSubscription? _aiSub;
   final Map<String, StreamController<String>> _streams = {};
 
-  AiService({required this.httpBaseUrl, this.aiWsUrl, String? authToken}) : _authToken = authToken;
+  AiService({required this.httpBaseUrl, this.aiWsUrl, String? authToken}) : _authToken = authToken {
+    if (aiWsUrl != null) MuxConnectionService.prewarm(aiWsUrl!, authToken);
+  }
 
   void setAuthToken(String? token) {
     final tokenChanged = _authToken != token;
@@ -26,6 +33,14 @@ class AiService {
     if (tokenChanged && _aiChannel != null) {
       disconnectAi();
     }
+    if (tokenChanged && (token == null || token.isEmpty)) {
+      // Logged out: the shared connection still carries the old token.
+      MuxConnectionService.close();
+      return;
+    }
+    // Opens the shared connection now, so the first question does not wait
+    // for a handshake.
+    if (tokenChanged && aiWsUrl != null) MuxConnectionService.prewarm(aiWsUrl!, token);
   }
 
   Future<void> _ensureAiConnected() async {
@@ -40,17 +55,33 @@ class AiService {
       throw Exception('Authentication required');
     }
 
-    // Build WebSocket URL with auth token
-    var wsUrl = aiWsUrl!;
-    final uri = Uri.parse(wsUrl);
-    wsUrl = uri.replace(queryParameters: {
-      ...uri.queryParameters,
-      'token': _authToken!,
-    }).toString();
-
-    print('[AiService] Connecting to AI WebSocket: $wsUrl');
-    _aiChannel = WebSocketChannel.connect(Uri.parse(wsUrl));
-    print('[AiService] AI WebSocket connected (reused for multiple requests)');
+    final muxStream = await MuxConnectionService.open(
+      endpoint: aiWsUrl!,
+      token: _authToken,
+      kind: 'ai',
+      priority: 1,
+    );
+    // Another request may have connected while this one waited.
+    if (_aiChannel != null) {
+      muxStream?.sink.close();
+      return;
+    }
+    if (muxStream != null) {
+      print('[AiService] Using shared connection stream ${muxStream.id}');
+      _aiChannel = muxStream;
+    } else {
+      // Build WebSocket URL with auth token
+      var wsUrl = aiWsUrl!;
+      final uri = Uri.parse(wsUrl);
+      wsUrl = uri.replace(queryParameters: {
+        ...uri.queryParameters,
+        'token': _authToken!,
+      }).toString();
+
+      print('[AiService] Connecting to AI WebSocket: $wsUrl');
+      _aiChannel = WebSocketChannel.connect(Uri.parse(wsUrl));
+      print('[AiService] AI WebSocket connected (reused for multiple requests)');
+    }
     _aiSub = _aiChannel!.stream.listen(
       (message) {
         try {
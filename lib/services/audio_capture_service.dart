@@ -1,6 +1,9 @@
 import 'dart:async';
+import 'dart:io' show Platform;
+import 'package:flutter/foundation.dart';
 import 'package:record/record.dart';
 import 'package:shared_preferences/shared_preferences.dart';
+import 'windows_audio_service.dart';
 
 class AudioCaptureService {
   late final AudioRecorder _recorder;
@@ -52,7 +55,14 @@ class AudioCaptureService {
       
       // Try to find and use the selected device
       InputDevice? selectedDevice;
-      if (selectedDeviceId != null && selectedDeviceId.isNotEmpty) {
+      if (selectedDeviceId != null && selectedDeviceId.isNotEmpty && !kIsWeb && Platform.isWindows) {
+        // The native registry answers from its cache instead of enumerating.
+        final device = await WindowsAudioService.findAudioDevice(selectedDeviceId);
+        if (device != null && device.flow == 'capture') {
+          selectedDevice = InputDevice(id: device.id, label: device.name);
+          print('[AudioCaptureService] Using selected audio device: ${device.name} (${device.id})');
+        }
+      } else if (selectedDeviceId != null && selectedDeviceId.isNotEmpty) {
         try {
           final devices = await _recorder.listInputDevices();
           final device = devices.firstWhere(
@@ -0,0 +1,101 @@
+import 'dart:async';
+import 'dart:convert';
+
+import 'package:web_socket_channel/web_socket_channel.dart';
+
+import 'transcription_service.dart';
+
+/// Read-only connection to a meeting someone else is sharing
+/// (/follow?share=<id>). The relay replays the recent finals on join, then
+/// streams the live transcript until the publisher stops sharing, the share
+/// expires or the socket drops.
+class FollowService {
+  WebSocketChannel? _channel;
+  StreamSubscription? _channelSubscription;
+
+  final String serverUrl;
+  final String? authToken;
+  final StreamController<TranscriptionResult> _transcriptController =
+      StreamController<TranscriptionResult>.broadcast();
+
+  FollowService({required this.serverUrl, this.authToken});
+
+  Stream<TranscriptionResult> get transcriptStream => _transcriptController.stream;
+  bool get isConnected => _channel != null;
+
+  /// Called once when following ends, with a reason for the user.
+  void Function(String reason)? onEnded;
+
+  /// Accepts a bare share id or a full follow link.
+  static String? parseShareId(String input) {
+    final trimmed = input.trim();
+    if (trimmed.isEmpty) return null;
+    final uri = Uri.tryParse(trimmed);
+    final fromLink = uri?.queryParameters['share'];
+    if (fromLink != null && fromLink.isNotEmpty) return fromLink;
+    return RegExp(r'^[A-Za-z0-9_-]+$').hasMatch(trimmed) ? trimmed : null;
+  }
+
+  Future<void> connect(String shareId) async {
+    disconnect();
+    final uri = Uri.parse(serverUrl);
+    final url = uri.replace(queryParameters: {
+      ...uri.queryParameters,
+      'share': shareId,
+      if (authToken != null && authToken!.isNotEmpty) 'token': authToken!,
+    });
+    print('[FollowService] Following share $shareId');
+    final channel = WebSocketChannel.connect(url);
+    _channel = channel;
+    var ended = false;
+    void end(String reason) {
+      if (ended) return;
+      ended = true;
+      if (identical(_channel, channel)) _channel = null;
+      onEnded?.call(reason);
+    }
+
+    _channelSubscription = channel.stream.listen(
+      (message) {
+        if (message is! String) return;
+        final data = jsonDecode(message);
+        if (data['type'] == 'transcript') {
+          final text = (data['text'] as String?) ?? '';
+          if (text.trim().isEmpty) return;
+          _transcriptController.add(
+            TranscriptionResult(
+              text: text,
+              isFinal: data['is_final'] == true,
+              source: (data['source'] as String?) ?? 'unknown',
+              confidence: data['confidence']?.toDouble() ?? 0.0,
+            ),
+          );
+        } else if (data['type'] == 'share_ended') {
+          end(data['reason'] == 'expired' ? 'The share link has expired' : 'The meeting is no longer shared');
+        }
+      },
+      onError: (error) {
+        print('[FollowService] WebSocket error: $error');
+        end('Connection lost');
+      },
+      onDone: () {
+        end(channel.closeCode == 4404 ? 'Unknown or expired share link' : 'Connection closed');
+      },
+    );
+  }
+
+  void disconnect() {
+    _channelSubscription?.cancel();
+    _channelSubscription = null;
+    final channel = _channel;
+    _channel = null;
+    try {
+      channel?.sink.close();
+    } catch (_) {}
+  }
+
+  void dispose() {
+    disconnect();
+    _transcriptController.close();
+  }
+}
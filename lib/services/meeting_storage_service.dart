@@ -1,7 +1,11 @@
 import 'dart:convert';
+import 'dart:io' show Platform, ZLibEncoder;
+import 'package:flutter/foundation.dart' show kIsWeb;
 import 'package:http/http.dart' as http;
 import '../models/meeting_session.dart';
 import '../config/app_config.dart';
+import 'session_sync_dictionary.dart';
+import 'windows_audio_service.dart';
 
 class MeetingStorageService {
   String? _authToken;
@@ -29,14 +33,96 @@ class MeetingStorageService {
     return '$cleanBase$cleanPath';
   }
 
+  /// Incremental saves need the native delta encoder (Windows only).
+  bool get _useDeltaSync => !kIsWeb && Platform.isWindows;
+
+  /// Bubbles in the form the native delta encoder fingerprints and encodes.
+  /// Timestamps are wall-clock milliseconds, matching the offset-free ISO
+  /// strings a full save sends, so both paths store the same time.
+  static List<Map<String, dynamic>> _syncBubbles(MeetingSession session) {
+    return session.bubbles
+        .map((b) => <String, dynamic>{
+              'source': b.source.toString().split('.').last,
+              'text': b.text,
+              'timestamp': b.timestamp.millisecondsSinceEpoch + b.timestamp.timeZoneOffset.inMilliseconds,
+              'isDraft': b.isDraft,
+              if (b.speakerId != null) 'speakerId': b.speakerId,
+            })
+        .toList();
+  }
+
+  /// Non-bubble fields sent when they change. updatedAt is left out because
+  /// it changes on every save and the relay stamps it anyway.
+  static String _syncMeta(MeetingSession session) {
+    return jsonEncode({
+      'title': session.title,
+      'summary': session.summary,
+      'insights': session.insights,
+      'questions': session.questions,
+      'mode': session.modeKey,
+      'metadata': session.metadata,
+    });
+  }
+
+  /// Sends only the bubbles changed since the last acknowledged save.
+  /// Returns null when a full save is needed instead.
+  Future<MeetingSession?> _trySaveDelta(MeetingSession session) async {
+    final delta = await WindowsAudioService.encodeSessionDelta(
+      sessionId: session.id,
+      bubbles: _syncBubbles(session),
+      meta: _syncMeta(session),
+    );
+    if (delta == null) return null;
+    if (delta.isUnchanged) return session;
+    if (!delta.hasDelta) return null;
+
+    final body = ZLibEncoder(raw: true, level: 6, dictionary: sessionSyncDictionary)
+        .convert(delta.delta);
+    try {
+      final response = await http.patch(
+        Uri.parse(_getApiUrl('/api/sessions/${session.id}/delta')),
+        headers: {..._getHeaders(), 'Content-Type': 'application/octet-stream'},
+        body: body,
+      );
+      if (response.statusCode == 200) {
+        await WindowsAudioService.ackSessionDelta(sessionId: session.id, version: delta.version);
+        return session;
+      }
+      print('[MeetingStorageService] Delta save rejected (${response.statusCode}), sending full session');
+    } catch (e) {
+      print('[MeetingStorageService] Delta save failed, sending full session: $e');
+    }
+    await WindowsAudioService.resetSessionSync(session.id);
+    return null;
+  }
+
+  /// Makes a completed full save the base for the next delta.
+  Future<void> _setSyncBaseline(MeetingSession sent, Map<String, dynamic> saved) async {
+    if (!_useDeltaSync) return;
+    final id = saved['id'] as String?;
+    if (id == null) return;
+    await WindowsAudioService.setSessionSyncBaseline(
+      sessionId: id,
+      bubbles: _syncBubbles(sent),
+      meta: _syncMeta(sent),
+      version: (saved['syncVersion'] as int?) ?? 0,
+    );
+  }
+
   Future<MeetingSession> saveSession(MeetingSession session) async {
     try {
       final url = _getApiUrl('/api/sessions');
-      final body = session.toJson();
       
       // Check if session ID is a valid MongoDB ObjectId (24 hex characters)
       final isValidObjectId = session.id != null && 
           RegExp(r'^[0-9a-fA-F]{24}$').hasMatch(session.id!);
+
+      if (isValidObjectId && _useDeltaSync) {
+        final saved = await _trySaveDelta(session);
+        if (saved != null) return saved;
+      }
+
+      final body = session.toJson();
       
       if (isValidObjectId) {
         // Try to update existing session
@@ -49,6 +135,7 @@ class MeetingStorageService {
         if (response.statusCode == 201 || response.statusCode == 200) {
           // Successfully created or updated
           final data = jsonDecode(response.body) as Map<String, dynamic>;
+          await _setSyncBaseline(session, data);
           return MeetingSession.fromJson(data);
         } else if (response.statusCode == 404) {
           // Session doesn't exist, create it
@@ -63,6 +150,7 @@ class MeetingStorageService {
             throw Exception(error);
           }
           final data = jsonDecode(createResponse.body) as Map<String, dynamic>;
+          await _setSyncBaseline(session, data);
           return MeetingSession.fromJson(data);
         } else {
           final error = jsonDecode(response.body)['error'] ?? 'Failed to save session';
@@ -81,6 +169,7 @@ class MeetingStorageService {
           throw Exception(error);
         }
         final data = jsonDecode(createResponse.body) as Map<String, dynamic>;
+        await _setSyncBaseline(session, data);
         return MeetingSession.fromJson(data);
       }
     } catch (e) {
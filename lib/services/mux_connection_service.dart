@@ -0,0 +1,217 @@
+import 'dart:async';
+import 'dart:io' show Platform;
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart' show kIsWeb;
+import 'package:stream_channel/stream_channel.dart';
+
+import 'windows_audio_service.dart';
+
+/// The app's shared native connection to the server's /mux endpoint
+/// (windows/runner/mux_connection.h). The transcription session and AI
+/// requests each run as one stream of it instead of a WebSocket of their own,
+/// so an AI request starts on an already open, already warm connection and
+/// audio is always written ahead of AI traffic.
+///
+/// [open] returns null whenever the connection is not available (not Windows,
+/// no token, or a server without /mux); the caller then opens its own
+/// WebSocket as before.
+class MuxConnectionService {
+  static final bool supported = !kIsWeb && Platform.isWindows;
+
+  static const Duration _connectTimeout = Duration(seconds: 3);
+  // After a failed connect, callers use their own sockets for this long.
+  static const Duration _retryAfterFailure = Duration(minutes: 1);
+
+  static String? _url;
+  static bool _connected = false;
+  static DateTime? _failedAt;
+  static Completer<bool>? _connecting;
+  static StreamSubscription<MuxEvent>? _events;
+  static final Map<int, MuxStreamChannel> _streams = {};
+
+  /// The /mux URL next to a /listen or /ai [endpoint], carrying [token].
+  static String muxUrl(String endpoint, String token) {
+    final uri = Uri.parse(endpoint);
+    final path = uri.path.replaceFirst(RegExp(r'/(listen|ai)/?$'), '');
+    return uri.replace(path: '$path/mux', queryParameters: {
+      ...uri.queryParameters,
+      'token': token,
+    }).toString();
+  }
+
+  /// Connects in the background so the first stream does not wait for the
+  /// handshake.
+  static void prewarm(String endpoint, String? token) {
+    if (token == null || token.isEmpty) return;
+    ensureConnected(endpoint, token);
+  }
+
+  /// Starts the connection for [endpoint] and [token] if needed and waits
+  /// until it is up. False when it cannot be used right now.
+  static Future<bool> ensureConnected(String endpoint, String token) async {
+    if (!supported || token.isEmpty) return false;
+    final url = muxUrl(endpoint, token);
+    if (url == _url) {
+      if (_connected) return true;
+      final connecting = _connecting;
+      if (connecting != null) return connecting.future;
+      final failedAt = _failedAt;
+      if (failedAt != null && DateTime.now().difference(failedAt) < _retryAfterFailure) {
+        return false;
+      }
+    } else {
+      // A new token means a new connection; streams of the old one end.
+      _endAll();
+    }
+
+    _url = url;
+    _connected = false;
+    _events ??= WindowsAudioService.muxEvents.listen(_onEvent);
+    final connecting = _connecting = Completer<bool>();
+    if (!await WindowsAudioService.startMux(url)) {
+      if (!connecting.isCompleted) connecting.complete(false);
+    }
+    final ok = await connecting.future.timeout(_connectTimeout, onTimeout: () => false);
+    if (identical(_connecting, connecting)) _connecting = null;
+    if (ok) {
+      _failedAt = null;
+      return true;
+    }
+    print('[MuxConnectionService] /mux unavailable, using separate WebSockets');
+    _failedAt = DateTime.now();
+    if (_url == url) {
+      _connected = false;
+      await WindowsAudioService.stopMux();
+    }
+    return false;
+  }
+
+  /// Ends every stream and closes the connection, e.g. on logout; the next
+  /// [open] with a token connects again.
+  static Future<void> close() async {
+    if (!supported || _url == null) return;
+    _endAll();
+    _url = null;
+    _connected = false;
+    _failedAt = null;
+    final connecting = _connecting;
+    _connecting = null;
+    if (connecting != null && !connecting.isCompleted) connecting.complete(false);
+    await WindowsAudioService.stopMux();
+  }
+
+  /// Opens a stream of [kind] ('listen' or 'ai'); [priority] 0 is sent first.
+  static Future<MuxStreamChannel?> open({
+    required String endpoint,
+    required String? token,
+    required String kind,
+    int priority = 1,
+  }) async {
+    if (token == null || !await ensureConnected(endpoint, token)) return null;
+    final id = await WindowsAudioService.openMuxStream({'kind': kind}, priority: priority);
+    if (id == 0) return null;
+    final channel = MuxStreamChannel._(id);
+    _streams[id] = channel;
+    return channel;
+  }
+
+  static void _onEvent(MuxEvent event) {
+    switch (event.type) {
+      case 'connected':
+        _connected = true;
+        final connecting = _connecting;
+        if (connecting != null && !connecting.isCompleted) connecting.complete(true);
+      case 'disconnected':
+        _connected = false;
+      case 'text':
+        _streams[event.stream]?._receive(event.text);
+      case 'closed':
+        _streams.remove(event.stream)?._end();
+    }
+  }
+
+  static void _endAll() {
+    final streams = _streams.values.toList();
+    _streams.clear();
+    for (final stream in streams) {
+      stream._end();
+    }
+  }
+}
+
+/// One stream of the shared connection, used where a service would otherwise
+/// hold a WebSocketChannel: [stream] has the server's messages and [sink]
+/// sends strings. Closing the sink closes the stream.
+class MuxStreamChannel with StreamChannelMixin<dynamic> {
+  final int id;
+  final StreamController<dynamic> _incoming = StreamController<dynamic>();
+  late final _MuxSink _sink = _MuxSink(this);
+  bool _closed = false;
+
+  MuxStreamChannel._(this.id);
+
+  @override
+  Stream<dynamic> get stream => _incoming.stream;
+
+  @override
+  StreamSink<dynamic> get sink => _sink;
+
+  /// Sends PCM16 [audio] as a raw audio frame. False when it was not queued
+  /// (the stream is closed or its queue is full).
+  Future<bool> sendAudio(String source, Uint8List audio) {
+    if (_closed) return Future.value(false);
+    return WindowsAudioService.sendMuxAudio(id, source: source, audio: audio);
+  }
+
+  void _send(String text) {
+    if (_closed) return;
+    WindowsAudioService.sendMuxText(id, text);
+  }
+
+  void _close() {
+    if (_closed) return;
+    MuxConnectionService._streams.remove(id);
+    WindowsAudioService.closeMuxStream(id);
+    _end();
+  }
+
+  void _receive(String text) {
+    if (!_incoming.isClosed) _incoming.add(text);
+  }
+
+  void _end() {
+    _closed = true;
+    if (!_incoming.isClosed) _incoming.close();
+    if (!_sink._done.isCompleted) _sink._done.complete();
+  }
+}
+
+// Sends synchronously, so messages go out in the order they were added even
+// when audio is sent in between.
+class _MuxSink implements StreamSink<dynamic> {
+  final MuxStreamChannel _channel;
+  final Completer<void> _done = Completer<void>();
+
+  _MuxSink(this._channel);
+
+  @override
+  void add(dynamic data) {
+    if (data is String) _channel._send(data);
+  }
+
+  @override
+  void addError(Object error, [StackTrace? stackTrace]) {}
+
+  @override
+  Future<void> addStream(Stream<dynamic> stream) => stream.forEach(add);
+
+  @override
+  Future<void> close() {
+    _channel._close();
+    return done;
+  }
+
+  @override
+  Future<void> get done => _done.future;
+}
@@ -0,0 +1,21 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+/// Preset DEFLATE dictionary for session deltas: a hand-written sample of
+/// common meeting phrases and the session metadata JSON, not derived from
+/// real transcripts. Must stay byte-identical to
+/// server/src/sessionSyncDictionary.ts or the relay cannot inflate deltas.
+final Uint8List sessionSyncDictionary = Uint8List.fromList(utf8.encode(
+  'So what we are trying to figure out here is whether the timeline still works for the team. '
+  'Can you walk me through how you would approach this problem? Tell me about a time when you had to deal with a difficult situation at work. '
+  'I think the main thing is that we need to make sure everyone is on the same page before the next meeting. '
+  'Let me share my screen. Can everyone see my screen? Sorry, you are on mute. Can you hear me now? '
+  'The customer mentioned that the pricing was a concern, so we should follow up with a proposal by the end of the week. '
+  'What are the next steps? Who owns this action item? Let us schedule a follow up call for next Tuesday. '
+  'That makes sense. I agree with that. Good question. Thank you so much for your time today. '
+  'because actually probably definitely basically something everything anything really pretty important different experience project product '
+  'think know mean going want need like just about would could should people thing things time really right okay yeah '
+  '{"title":"Meeting","updatedAt":"2025-01-01T00:00:00.000","summary":null,"insights":null,"questions":null,"mode":"general","metadata":{}}'
+  'you know, I mean, kind of, sort of, a little bit, a lot of, at the end of the day, in terms of, to be honest, I think that, '
+  ' the and to of a in that is it for on with as was we you this be have are not but at they so what do if can will just there ',
+));
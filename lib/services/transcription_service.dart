@@ -1,14 +1,32 @@
 import 'dart:async';
 import 'dart:convert';
+import 'dart:io' show Platform;
 import 'dart:typed_data';
 
+import 'package:flutter/foundation.dart' show kIsWeb;
+import 'package:stream_channel/stream_channel.dart';
 import 'package:web_socket_channel/web_socket_channel.dart';
 
+import 'mux_connection_service.dart';
+import 'windows_audio_service.dart';
+
 class TranscriptionService {
-  WebSocketChannel? _channel;
+  // A stream of the shared native connection where available, otherwise a
+  // WebSocket of its own.
+  StreamChannel<dynamic>? _channel;
   StreamSubscription? _channelSubscription;
   bool _disconnecting = false;
 
+  /// A relay that is full refuses the session (HTTP 503, or an error with
+  /// `retryAfter` followed by close 1013 on a shared connection) and says
+  /// when to come back. The session is reopened then, a few times, before
+  /// the refusal is reported as an error.
+  static const int _maxAdmissionRetries = 5;
+  static const Duration _defaultRetryAfter = Duration(seconds: 5);
+  Duration? _retryAfter;
+  Timer? _retryTimer;
+  int _admissionRetries = 0;
+
   final String serverUrl;
   String? _authToken;
   final StreamController<TranscriptionResult> _transcriptController =
@@ -21,21 +39,62 @@ class TranscriptionService {
   }
 
   Stream<TranscriptionResult> get transcriptStream => _transcriptController.stream;
-  bool get isConnected => _channel != null;
+  bool get isConnected => _channel != null || _replaying;
+
+  /// Called with every raw downlink message, e.g. to record a session capture.
+  void Function(String message)? onRawMessage;
+
+  /// Called with the share id and its expiry once the relay publishes this
+  /// meeting to followers (see [startSharing]); they join at
+  /// /follow?share=<id> until it expires.
+  void Function(String shareId, DateTime expiresAt)? onShareReady;
+
+  /// Called when the relay stops sharing: on [stopSharing] or at expiry.
+  void Function()? onShareEnded;
+
+  /// While replaying a session capture no socket is opened: transcripts come
+  /// from [replayMessage] and outgoing audio is dropped.
+  bool _replaying = false;
+  bool get replaying => _replaying;
+
+  /// Audio goes over the native datagram uplink while the relay has offered
+  /// one and it stays healthy; otherwise (and for any frame it refuses) over
+  /// the WebSocket.
+  static final bool _datagramUplinkSupported = !kIsWeb && Platform.isWindows;
+  bool _uplinkActive = false;
+  bool get uplinkActive => _uplinkActive;
+
+  void setReplaying(bool replaying) {
+    if (replaying) disconnect();
+    _replaying = replaying;
+  }
 
   Future<void> connect() async {
+    if (_replaying) {
+      print('[TranscriptionService] Replaying session capture, not connecting');
+      return;
+    }
     try {
       print('[TranscriptionService] Connecting to: $serverUrl');
-      // Build WebSocket URL with auth token if available
-      var wsUrl = serverUrl;
-      if (_authToken != null && _authToken!.isNotEmpty) {
-        final uri = Uri.parse(wsUrl);
-        wsUrl = uri.replace(queryParameters: {
-          ...uri.queryParameters,
-          'token': _authToken!,
-        }).toString();
+      // Audio goes ahead of everything else on the shared connection.
+      _channel = await MuxConnectionService.open(
+        endpoint: serverUrl,
+        token: _authToken,
+        kind: 'listen',
+        priority: 0,
+      );
+      if (_channel == null) {
+        // Build WebSocket URL with auth token if available
+        var wsUrl = serverUrl;
+        if (_authToken != null && _authToken!.isNotEmpty) {
+          final uri = Uri.parse(wsUrl);
+          wsUrl = uri.replace(queryParameters: {
+            ...uri.queryParameters,
+            'token': _authToken!,
+          }).toString();
+        }
+        _channel = WebSocketChannel.connect(Uri.parse(wsUrl));
       }
-      _channel = WebSocketChannel.connect(Uri.parse(wsUrl));
 
       // Cancel any existing subscription first
       _channelSubscription?.cancel();
@@ -45,42 +104,19 @@ class TranscriptionService {
           if (_disconnecting || _channel == null) {
             return;
           }
-          
-          print('[TranscriptionService] Received: $message');
-          final data = jsonDecode(message);
-
-          if (data['type'] == 'transcript') {
-            final text = (data['text'] as String?) ?? '';
-            if (text.trim().isEmpty) return;
-            
-            final receivedSource = (data['source'] as String?) ?? 'unknown';
-            print('[TranscriptionService] Received transcript with source: "$receivedSource", text: "${text.substring(0, text.length > 50 ? 50 : text.length)}..."');
-
-            _transcriptController.add(
-              TranscriptionResult(
-                text: text,
-                isFinal: data['is_final'] == true,
-                source: receivedSource,
-                confidence: data['confidence']?.toDouble() ?? 0.0,
-              ),
-            );
-            return;
-          }
-
-          if (data['type'] == 'status') {
-            print('[TranscriptionService] Status: ${data['message']}');
-            return;
-          }
-
-          if (data['type'] == 'error') {
-            print('[TranscriptionService] Error from server: ${data['message']}');
-            _transcriptController.addError(data['message']);
-            return;
-          }
+          if (message is String) onRawMessage?.call(message);
+          _handleMessage(message);
         },
         onError: (error) {
           if (_disconnecting) return;
           print('[TranscriptionService] WebSocket error: $error');
+          // The handshake's Retry-After is not exposed; use the relay's usual one.
+          if (error.toString().contains('503')) _retryAfter ??= _defaultRetryAfter;
+          if (_retryAfter != null && _admissionRetries < _maxAdmissionRetries) {
+            _closeChannel();
+            _scheduleRetry();
+            return;
+          }
           if (!_transcriptController.isClosed) {
             _transcriptController.addError(error);
           }
@@ -89,12 +125,20 @@ class TranscriptionService {
         onDone: () {
           if (_disconnecting) return;
           print('[TranscriptionService] WebSocket closed');
+          if (_retryAfter != null) {
+            _closeChannel();
+            _scheduleRetry();
+            return;
+          }
           disconnect();
         },
       );
 
       print('[TranscriptionService] Connected, sending start message');
       _channel!.sink.add(jsonEncode({'type': 'start'}));
+      if (_datagramUplinkSupported && _authToken != null && _authToken!.isNotEmpty) {
+        _channel!.sink.add(jsonEncode({'type': 'udp_offer'}));
+      }
     } catch (e) {
       print('[TranscriptionService] Connection error: $e');
       _transcriptController.addError(e);
@@ -102,6 +146,96 @@ class TranscriptionService {
     }
   }
 
+  /// Feeds a downlink message recorded in a session capture through the same
+  /// handling as a live one. Only used while [replaying].
+  void replayMessage(String message) {
+    if (!_replaying) return;
+    _handleMessage(message);
+  }
+
+  void _handleMessage(dynamic message) {
+    print('[TranscriptionService] Received: $message');
+    final data = jsonDecode(message);
+    // Anything but an error means the relay admitted the session.
+    if (data['type'] != 'error') _admissionRetries = 0;
+
+    if (data['type'] == 'transcript') {
+      final text = (data['text'] as String?) ?? '';
+      if (text.trim().isEmpty) return;
+
+      final receivedSource = (data['source'] as String?) ?? 'unknown';
+      print('[TranscriptionService] Received transcript with source: "$receivedSource", text: "${text.substring(0, text.length > 50 ? 50 : text.length)}..."');
+
+      _transcriptController.add(
+        TranscriptionResult(
+          text: text,
+          isFinal: data['is_final'] == true,
+          source: receivedSource,
+          confidence: data['confidence']?.toDouble() ?? 0.0,
+        ),
+      );
+      return;
+    }
+
+    if (data['type'] == 'status') {
+      print('[TranscriptionService] Status: ${data['message']}');
+      if (data['message'] == 'share_stopped' || data['message'] == 'share_expired') {
+        onShareEnded?.call();
+      }
+      return;
+    }
+
+    if (data['type'] == 'error') {
+      print('[TranscriptionService] Error from server: ${data['message']}');
+      final retryAfter = data['retryAfter'];
+      if (retryAfter is num && !_replaying && _admissionRetries < _maxAdmissionRetries) {
+        // The close that follows reopens the session after the wait.
+        _retryAfter = Duration(milliseconds: (retryAfter * 1000).round());
+        return;
+      }
+      _transcriptController.addError(data['message']);
+      return;
+    }
+
+
+
+    if (data['type'] == 'share_ready') {
+      final shareId = data['shareId'] as String?;
+      final expiresAt = DateTime.tryParse((data['expiresAt'] as String?) ?? '')?.toLocal();
+      if (shareId != null && expiresAt != null) onShareReady?.call(shareId, expiresAt);
+      return;
+    }
+
+    if (data['type'] == 'udp_ready') {
+      if (!_replaying) _startUplink(data);
+      return;
+    }
+
+    if (data['type'] == 'udp_unavailable') {
+      print('[TranscriptionService] Relay has no datagram uplink, staying on WebSocket');
+      return;
+    }
+  }
+
+  Future<void> _startUplink(Map<String, dynamic> offer) async {
+    final token = _authToken;
+    if (token == null || _channel == null) return;
+    final started = await WindowsAudioService.startUplink(
+      host: Uri.parse(serverUrl).host,
+      port: (offer['port'] as num).toInt(),
+      sessionId: (offer['sessionId'] as num).toInt(),
+      token: token,
+      nonce: offer['nonce'] as String,
+    );
+    // The socket may have closed while the uplink was starting.
+    if (_channel == null) {
+      if (started) await WindowsAudioService.stopUplink();
+      return;
+    }
+    _uplinkActive = started;
+    print('[TranscriptionService] Datagram uplink ${started ? 'started' : 'unavailable'}');
+  }
+
   void sendAudio(dynamic audioData, {String source = 'mic'}) {
     final channel = _channel;
     if (channel == null) {
@@ -116,6 +250,59 @@ class TranscriptionService {
         _ => throw ArgumentError('Unexpected audio type: ${audioData.runtimeType}'),
       };
 
+      if (_uplinkActive) {
+        WindowsAudioService.sendUplinkAudio(source: source, audio: audioBytes).then((sent) {
+          if (!sent) _sendOverSocket(audioBytes, source);
+        });
+        return;
+      }
+      _sendOverSocket(audioBytes, source);
+    } catch (e) {
+      print('[TranscriptionService] Error sending audio: $e');
+    }
+  }
+
+  /// Ask the recognizer to finalize [source]'s pending speech now; sent when
+  /// the native endpointer has seen the utterance end.
+  ///
+  /// Over the datagram uplink the finalize goes the same way as the audio: a
+  /// WebSocket finalize could overtake audio still held in the relay's jitter
+  /// buffer and cut the utterance's last words. Platform channel calls run in
+  /// order, so it follows every chunk already handed to sendUplinkAudio.
+  void finalizeUtterance(String source) {
+    if (_uplinkActive) {
+      WindowsAudioService.finalizeUplink(source: source).then((sent) {
+        if (!sent) _sendFinalizeOverSocket(source);
+      });
+      return;
+    }
+    _sendFinalizeOverSocket(source);
+  }
+
+  void _sendFinalizeOverSocket(String source) {
+    _channel?.sink.add(jsonEncode({'type': 'finalize', 'source': source}));
+  }
+
+  /// Lets teammates follow this meeting's transcript live and read-only.
+  void startSharing() {
+    _channel?.sink.add(jsonEncode({'type': 'share_start'}));
+  }
+
+  void stopSharing() {
+    _channel?.sink.add(jsonEncode({'type': 'share_stop'}));
+  }
+
+  void _sendOverSocket(Uint8List audioBytes, String source) {
+    final channel = _channel;
+    if (channel == null) return;
+    if (channel is MuxStreamChannel) {
+      // Raw PCM in an audio frame; no base64 or JSON.
+      channel.sendAudio(source, audioBytes).then((sent) {
+        if (!sent) print('[TranscriptionService] Mux stream refused audio for "$source"');
+      });
+      return;
+    }
+    try {
       final base64Audio = base64Encode(audioBytes);
       print('[TranscriptionService] Sending audio with source: "$source"');
       channel.sink.add(
@@ -130,7 +317,28 @@ class TranscriptionService {
     }
   }
 
+  void _scheduleRetry() {
+    final delay = _retryAfter ?? _defaultRetryAfter;
+    _retryAfter = null;
+    _admissionRetries++;
+    print('[TranscriptionService] Relay is full, reconnecting in ${delay.inSeconds}s '
+        '(attempt $_admissionRetries of $_maxAdmissionRetries)');
+    _retryTimer?.cancel();
+    _retryTimer = Timer(delay, () {
+      _retryTimer = null;
+      connect().catchError((_) {});
+    });
+  }
+
   void disconnect() {
+    _retryTimer?.cancel();
+    _retryTimer = null;
+    _retryAfter = null;
+    _admissionRetries = 0;
+    _closeChannel();
+  }
+
+  void _closeChannel() {
     if (_disconnecting) return;
 
     final channel = _channel;
@@ -145,6 +353,13 @@ class TranscriptionService {
     _channelSubscription = null;
     
     _channel = null; // prevent re-entrancy from onDone/onError
+    // The relay closes any share with the socket.
+    onShareEnded?.call();
+
+    if (_uplinkActive) {
+      _uplinkActive = false;
+      WindowsAudioService.stopUplink();
+    }
 
     try {
       channel.sink.add(jsonEncode({'type': 'stop'}));
@@ -1,9 +1,44 @@
 import 'package:flutter/services.dart';
+import 'dart:async';
+import 'dart:convert';
 import 'dart:typed_data';
 
 class WindowsAudioService {
   static const platform = MethodChannel('com.hearnow/audio');
 
+  // Calls from native code (keyword hits, device changes) share one handler.
+  static void Function(int keywordId, double score)? _keywordHandler;
+  static final StreamController<int> _audioDeviceChanges = StreamController<int>.broadcast();
+  static final StreamController<MuxEvent> _muxEvents = StreamController<MuxEvent>.broadcast();
+  static final StreamController<bool> _micCopyChanges = StreamController<bool>.broadcast();
+  static final StreamController<NativePowerState> _powerStateChanges =
+      StreamController<NativePowerState>.broadcast();
+  static bool _callHandlerInstalled = false;
+
+  static void _ensureCallHandler() {
+    if (_callHandlerInstalled) return;
+    _callHandlerInstalled = true;
+    platform.setMethodCallHandler((call) async {
+      switch (call.method) {
+        case 'onKeyword':
+          final args = Map<String, dynamic>.from(call.arguments as Map);
+          _keywordHandler?.call((args['keywordId'] as int?) ?? 0, (args['score'] as num?)?.toDouble() ?? 0.0);
+        case 'onAudioDevicesChanged':
+          _audioDeviceChanges.add((call.arguments as int?) ?? 0);
+        case 'onMicCopyChanged':
+          final args = Map<String, dynamic>.from(call.arguments as Map);
+          _micCopyChanges.add((args['copy'] as bool?) ?? false);
+        case 'onPowerStateChanged':
+          _powerStateChanges.add(NativePowerState.fromMap(Map<String, dynamic>.from(call.arguments as Map)));
+        case 'onMuxEvents':
+          for (final event in (call.arguments as List?) ?? const []) {
+            _muxEvents.add(MuxEvent.fromMap(Map<String, dynamic>.from(event as Map)));
+          }
+      }
+      return null;
+    });
+  }
+
   /// Start capturing system audio (Windows Stereo Mix / Loopback)
   static Future<bool> startSystemAudioCapture() async {
     try {
@@ -41,6 +76,691 @@ class WindowsAudioService {
     }
   }
 
+  /// Get system audio data together with the native speaker label for the
+  /// start of the returned audio (-1 while unknown), and whether an
+  /// utterance ended within the system audio handed out so far. With
+  /// [pieceBytes], [SystemAudioFrame.pieces] labels each piece of that size
+  /// the way a pull of just that piece would have been labelled.
+  static Future<SystemAudioFrame> getSystemAudioFrameWithSpeaker({int? lengthBytes, int? pieceBytes}) async {
+    try {
+      final result = await platform.invokeMapMethod<String, dynamic>(
+        'getSystemAudioFrame',
+        <String, dynamic>{
+          if (lengthBytes != null) 'length': lengthBytes,
+          if (pieceBytes != null) 'pieceBytes': pieceBytes,
+          'withSpeaker': true,
+        },
+      );
+      final audio = result?['audio'] as Uint8List?;
+      final speakers = (result?['pieceSpeakers'] as List?)?.cast<int>() ?? const <int>[];
+      final ends = (result?['pieceEnds'] as List?)?.cast<bool>() ?? const <bool>[];
+      return SystemAudioFrame(
+        audio: audio?.toList() ?? <int>[],
+        speakerId: (result?['speakerId'] as int?) ?? -1,
+        endOfUtterance: result?['endOfUtterance'] == true,
+        pieces: [
+          for (var i = 0; i < speakers.length && i < ends.length; i++)
+            SystemAudioPiece(speakerId: speakers[i], endOfUtterance: ends[i]),
+        ],
+      );
+    } catch (e) {
+      print('[WindowsAudioService] Error getting system audio frame: $e');
+      return const SystemAudioFrame(audio: <int>[], speakerId: -1);
+    }
+  }
+
+  /// Push a microphone PCM16 frame (16kHz mono) to the native analysers.
+  /// True when a mic utterance ended within the pushed audio.
+  static Future<bool> pushMicAudio(List<int> audio) async {
+    try {
+      final result = await platform.invokeMethod<bool>(
+        'pushMicAudio',
+        audio is Uint8List ? audio : Uint8List.fromList(audio),
+      );
+      return result ?? false;
+    } catch (e) {
+      print('[WindowsAudioService] Error pushing mic audio: $e');
+      return false;
+    }
+  }
+
+  /// How eagerly the native endpointer declares an utterance over: 0 turns
+  /// it off, 1..3 trade more premature cuts for earlier finals.
+  static Future<void> setEndpointAggressiveness(int level) async {
+    try {
+      await platform.invokeMethod('setEndpointAggressiveness', {'level': level});
+    } catch (e) {
+      print('[WindowsAudioService] Error setting endpoint aggressiveness: $e');
+    }
+  }
+
+  /// The last [seconds] of 16kHz mono PCM16 audio for [source] ('mic' or
+  /// 'system') from the native history buffer, e.g. for clip export or to
+  /// replay after a reconnect. Empty if nothing is held.
+  static Future<Uint8List> getAudioHistory({required String source, int seconds = 10}) async {
+    try {
+      final result = await platform.invokeMethod<Uint8List>(
+        'getAudioHistory',
+        <String, dynamic>{'source': source, 'seconds': seconds},
+      );
+      return result ?? Uint8List(0);
+    } catch (e) {
+      print('[WindowsAudioService] Error getting audio history: $e');
+      return Uint8List(0);
+    }
+  }
+
+  /// Enroll one recording of a voice trigger phrase (16kHz mono PCM16).
+  /// Returns false when the audio holds no usable speech.
+  static Future<bool> addKeywordTemplate({required int keywordId, required Uint8List audio}) async {
+    try {
+      final result = await platform.invokeMethod<bool>(
+        'addKeywordTemplate',
+        <String, dynamic>{'keywordId': keywordId, 'audio': audio},
+      );
+      return result ?? false;
+    } catch (e) {
+      print('[WindowsAudioService] Error adding keyword template: $e');
+      return false;
+    }
+  }
+
+  static Future<void> removeKeyword(int keywordId) async {
+    try {
+      await platform.invokeMethod('removeKeyword', <String, dynamic>{'keywordId': keywordId});
+    } catch (e) {
+      print('[WindowsAudioService] Error removing keyword: $e');
+    }
+  }
+
+  /// Average frame distance a match must stay under (default 1.0; lower is stricter).
+  static Future<void> setKeywordThreshold(double threshold) async {
+    try {
+      await platform.invokeMethod('setKeywordThreshold', <String, dynamic>{'threshold': threshold});
+    } catch (e) {
+      print('[WindowsAudioService] Error setting keyword threshold: $e');
+    }
+  }
+
+  /// Receive voice trigger hits spotted natively in the mic stream.
+  static void setKeywordHandler(void Function(int keywordId, double score)? handler) {
+    _keywordHandler = handler;
+    if (handler != null) _ensureCallHandler();
+  }
+
+  /// Emits the registry version whenever an audio endpoint is added, removed
+  /// or changed, or the default input or output moves.
+  static Stream<int> get audioDeviceChanges {
+    _ensureCallHandler();
+    return _audioDeviceChanges.stream;
+  }
+
+  /// Whether the mic is a digital copy of system audio (virtual cable,
+  /// "listen to this device"), on every change. The copy is already
+  /// transcribed as system audio.
+  static Stream<bool> get micCopyChanges {
+    _ensureCallHandler();
+    return _micCopyChanges.stream;
+  }
+
+  /// {copy, lagMs, bitErrorRate, copyMs, changes} from the native copy
+  /// detector since the last [resetConversationAnalytics].
+  static Future<Map<String, dynamic>> getMicCopyStatus() async {
+    try {
+      final result = await platform.invokeMethod<Map>('getMicCopyStatus');
+      return result == null ? {} : Map<String, dynamic>.from(result);
+    } catch (e) {
+      print('[WindowsAudioService] Error getting mic copy status: $e');
+      return {};
+    }
+  }
+
+  /// The window's visibility and power source as the runner sees them, on
+  /// every change. Hidden, native work slows down and audio should be
+  /// collected every [NativePowerState.deliveryIntervalMs].
+  static Stream<NativePowerState> get powerStateChanges {
+    _ensureCallHandler();
+    return _powerStateChanges.stream;
+  }
+
+  /// The current power state; also answered by the Linux runner.
+  static Future<NativePowerState> getPowerState() async {
+    try {
+      final result = await platform.invokeMethod<Map>('getPowerState');
+      return result == null
+          ? const NativePowerState()
+          : NativePowerState.fromMap(Map<String, dynamic>.from(result));
+    } catch (e) {
+      print('[WindowsAudioService] Error getting power state: $e');
+      return const NativePowerState();
+    }
+  }
+
+  /// Audio endpoints from the native registry, optionally only 'capture' or
+  /// 'render' ones. No enumeration happens here; the list is kept current.
+  static Future<List<AudioDevice>> getAudioDevices({String? flow}) async {
+    try {
+      final result = await platform.invokeMethod<List>('getAudioDevices', {
+        if (flow != null) 'flow': flow,
+      });
+      if (result == null) return const <AudioDevice>[];
+      return result.map((e) => AudioDevice.fromMap(Map<String, dynamic>.from(e as Map))).toList();
+    } catch (e) {
+      print('[WindowsAudioService] Error getting audio devices: $e');
+      return const <AudioDevice>[];
+    }
+  }
+
+  /// The endpoint with [id], or null when it is not present (or unplugged).
+  static Future<AudioDevice?> findAudioDevice(String id) async {
+    try {
+      final result = await platform.invokeMethod<Map>('findAudioDevice', {'id': id});
+      return result == null ? null : AudioDevice.fromMap(Map<String, dynamic>.from(result));
+    } catch (e) {
+      print('[WindowsAudioService] Error finding audio device: $e');
+      return null;
+    }
+  }
+
+  /// Report the word count of a final transcript for speaking-rate stats.
+  static Future<void> reportTranscriptWords({required String source, required int words}) async {
+    try {
+      await platform.invokeMethod(
+        'reportTranscriptWords',
+        <String, dynamic>{'source': source, 'words': words},
+      );
+    } catch (e) {
+      print('[WindowsAudioService] Error reporting transcript words: $e');
+    }
+  }
+
+  /// Snapshot of the native conversation analytics (talk time, turns,
+  /// overlap, pauses, words per minute) computed from audio activity.
+  static Future<Map<String, dynamic>> getConversationAnalytics() async {
+    try {
+      final result = await platform.invokeMapMethod<String, dynamic>('getConversationAnalytics');
+      return result ?? <String, dynamic>{};
+    } catch (e) {
+      print('[WindowsAudioService] Error getting conversation analytics: $e');
+      return <String, dynamic>{};
+    }
+  }
+
+  /// Start conversation analytics and mic copy detection from zero (new
+  /// meeting).
+  static Future<void> resetConversationAnalytics() async {
+    try {
+      await platform.invokeMethod('resetConversationAnalytics');
+    } catch (e) {
+      print('[WindowsAudioService] Error resetting conversation analytics: $e');
+    }
+  }
+
+  /// Input quality per stream (`mic`, `system`) since the last reset: SNR
+  /// estimate, clip rate, level percentiles and histogram, DC offset,
+  /// dropouts and spectral tilt. Kept with the session when it is saved.
+  static Future<Map<String, dynamic>> getAudioQuality() async {
+    try {
+      final result = await platform.invokeMapMethod<String, dynamic>('getAudioQuality');
+      return <String, dynamic>{
+        for (final entry in (result ?? const <String, dynamic>{}).entries)
+          if (entry.value is Map) entry.key: Map<String, dynamic>.from(entry.value as Map),
+      };
+    } catch (e) {
+      print('[WindowsAudioService] Error getting audio quality: $e');
+      return <String, dynamic>{};
+    }
+  }
+
+  /// Start the audio quality statistics from zero (new meeting).
+  static Future<void> resetAudioQuality() async {
+    try {
+      await platform.invokeMethod('resetAudioQuality');
+    } catch (e) {
+      print('[WindowsAudioService] Error resetting audio quality: $e');
+    }
+  }
+
+  /// Encode [bubbles] (already in wire form: source, text, timestamp as epoch
+  /// ms, isDraft, speakerId) and the non-bubble [meta] JSON as a binary delta
+  /// against the last version acknowledged for [sessionId].
+  /// Returns null if the native encoder is unavailable.
+  static Future<SessionDelta?> encodeSessionDelta({
+    required String sessionId,
+    required List<Map<String, dynamic>> bubbles,
+    required String meta,
+  }) async {
+    try {
+      final result = await platform.invokeMapMethod<String, dynamic>(
+        'encodeSessionDelta',
+        <String, dynamic>{'sessionId': sessionId, 'bubbles': bubbles, 'meta': meta},
+      );
+      if (result == null) return null;
+      return SessionDelta.fromMap(result);
+    } catch (e) {
+      print('[WindowsAudioService] Error encoding session delta: $e');
+      return null;
+    }
+  }
+
+  /// The relay applied the delta for [sessionId] at [version].
+  static Future<void> ackSessionDelta({required String sessionId, required int version}) async {
+    try {
+      await platform.invokeMethod(
+        'ackSessionDelta',
+        <String, dynamic>{'sessionId': sessionId, 'version': version},
+      );
+    } catch (e) {
+      print('[WindowsAudioService] Error acknowledging session delta: $e');
+    }
+  }
+
+  /// Record a full save of [sessionId] as the base for the next delta.
+  static Future<void> setSessionSyncBaseline({
+    required String sessionId,
+    required List<Map<String, dynamic>> bubbles,
+    required String meta,
+    required int version,
+  }) async {
+    try {
+      await platform.invokeMethod(
+        'setSessionSyncBaseline',
+        <String, dynamic>{
+          'sessionId': sessionId,
+          'bubbles': bubbles,
+          'meta': meta,
+          'version': version,
+        },
+      );
+    } catch (e) {
+      print('[WindowsAudioService] Error setting session sync baseline: $e');
+    }
+  }
+
+  /// Forget delta state for [sessionId]; the next save is a full one.
+  static Future<void> resetSessionSync(String sessionId) async {
+    try {
+      await platform.invokeMethod('resetSessionSync', <String, dynamic>{'sessionId': sessionId});
+    } catch (e) {
+      print('[WindowsAudioService] Error resetting session sync: $e');
+    }
+  }
+
+  /// Start recording mic audio, system audio and downlink messages to [path].
+  static Future<bool> startSessionCapture(String path) async {
+    try {
+      final result = await platform.invokeMethod<bool>(
+        'startSessionCapture',
+        <String, dynamic>{'path': path},
+      );
+      return result ?? false;
+    } catch (e) {
+      print('[WindowsAudioService] Error starting session capture: $e');
+      return false;
+    }
+  }
+
+  /// Append a downlink message to the session capture in progress.
+  static Future<void> recordSessionMessage(String text) async {
+    try {
+      await platform.invokeMethod('recordSessionMessage', <String, dynamic>{'text': text});
+    } catch (e) {
+      print('[WindowsAudioService] Error recording session message: $e');
+    }
+  }
+
+  /// Finish the session capture; returns {records, bytes, durationMs,
+  /// dropped}.
+  static Future<Map<String, dynamic>> stopSessionCapture() async {
+    try {
+      final result = await platform.invokeMethod<Map>('stopSessionCapture');
+      return result == null ? <String, dynamic>{} : Map<String, dynamic>.from(result);
+    } catch (e) {
+      print('[WindowsAudioService] Error stopping session capture: $e');
+      return <String, dynamic>{};
+    }
+  }
+
+  /// Replay a session capture at [speed] times real time (<= 0: as fast as
+  /// it is consumed). System audio is then served by [getSystemAudioFrame].
+  static Future<bool> startSessionReplay(String path, {double speed = 1.0, int startMs = 0}) async {
+    try {
+      final result = await platform.invokeMethod<bool>(
+        'startSessionReplay',
+        <String, dynamic>{'path': path, 'speed': speed, 'startMs': startMs},
+      );
+      return result ?? false;
+    } catch (e) {
+      print('[WindowsAudioService] Error starting session replay: $e');
+      return false;
+    }
+  }
+
+  /// Mic audio and downlink messages that came due since the last poll.
+  static Future<SessionReplayBatch> pollSessionReplay() async {
+    try {
+      final result = await platform.invokeMethod<Map>('pollSessionReplay');
+      if (result == null) return SessionReplayBatch.done();
+      return SessionReplayBatch.fromMap(Map<String, dynamic>.from(result));
+    } catch (e) {
+      print('[WindowsAudioService] Error polling session replay: $e');
+      return SessionReplayBatch.done();
+    }
+  }
+
+  static Future<void> stopSessionReplay() async {
+    try {
+      await platform.invokeMethod('stopSessionReplay');
+    } catch (e) {
+      print('[WindowsAudioService] Error stopping session replay: $e');
+    }
+  }
+
+  /// Open the datagram audio uplink offered by the relay (`udp_ready`).
+  /// [nonce] is the relay's hex nonce; the packet key is derived from it and
+  /// [token], so the token itself is never sent over UDP.
+  static Future<bool> startUplink({
+    required String host,
+    required int port,
+    required int sessionId,
+    required String token,
+    required String nonce,
+  }) async {
+    try {
+      final result = await platform.invokeMethod<bool>('startUplink', {
+        'host': host,
+        'port': port,
+        'sessionId': sessionId,
+        'token': token,
+        'nonce': nonce,
+      });
+      return result ?? false;
+    } catch (e) {
+      print('[WindowsAudioService] Error starting uplink: $e');
+      return false;
+    }
+  }
+
+  /// Send 16kHz mono PCM16 over the datagram uplink. False when the link is
+  /// down and the audio must go over the WebSocket instead.
+  static Future<bool> sendUplinkAudio({required String source, required Uint8List audio}) async {
+    try {
+      final result = await platform.invokeMethod<bool>('sendUplinkAudio', {
+        'source': source,
+        'audio': audio,
+      });
+      return result ?? false;
+    } catch (e) {
+      print('[WindowsAudioService] Error sending uplink audio: $e');
+      return false;
+    }
+  }
+
+  /// End [source]'s utterance in-band, after the audio already sent over the
+  /// datagram uplink. False when the link is down and the finalize must go
+  /// over the WebSocket instead.
+  static Future<bool> finalizeUplink({required String source}) async {
+    try {
+      final result = await platform.invokeMethod<bool>('finalizeUplink', {'source': source});
+      return result ?? false;
+    } catch (e) {
+      print('[WindowsAudioService] Error finalizing uplink: $e');
+      return false;
+    }
+  }
+
+  /// Packets sent and the relay's received/recovered/lost counts.
+  static Future<Map<String, dynamic>> getUplinkStats() async {
+    try {
+      final result = await platform.invokeMethod<Map>('getUplinkStats');
+      return result == null ? {} : Map<String, dynamic>.from(result);
+    } catch (e) {
+      print('[WindowsAudioService] Error getting uplink stats: $e');
+      return {};
+    }
+  }
+
+  static Future<void> stopUplink() async {
+    try {
+      await platform.invokeMethod('stopUplink');
+    } catch (e) {
+      print('[WindowsAudioService] Error stopping uplink: $e');
+    }
+  }
+
+  /// Connection state changes and messages of the native multiplexed
+  /// connection, in arrival order.
+  static Stream<MuxEvent> get muxEvents {
+    _ensureCallHandler();
+    return _muxEvents.stream;
+  }
+
+  /// Start the native multiplexed connection to [url] (`ws(s)://host/mux?token=...`).
+  /// It connects in the background and reconnects until [stopMux]; a call
+  /// with the URL it already uses leaves it alone.
+  static Future<bool> startMux(String url) async {
+    try {
+      _ensureCallHandler();
+      final result = await platform.invokeMethod<bool>('startMux', {'url': url});
+      return result ?? false;
+    } catch (e) {
+      print('[WindowsAudioService] Error starting mux: $e');
+      return false;
+    }
+  }
+
+  static Future<void> stopMux() async {
+    try {
+      await platform.invokeMethod('stopMux');
+    } catch (e) {
+      print('[WindowsAudioService] Error stopping mux: $e');
+    }
+  }
+
+  /// Open a logical stream; [open] is the Open payload ({kind: listen|ai, ...})
+  /// and [priority] 0 is sent first. Returns the stream id, 0 on failure.
+  static Future<int> openMuxStream(Map<String, dynamic> open, {int priority = 1}) async {
+    try {
+      final result = await platform.invokeMethod<int>('openMuxStream', {
+        'open': jsonEncode(open),
+        'priority': priority,
+      });
+      return result ?? 0;
+    } catch (e) {
+      print('[WindowsAudioService] Error opening mux stream: $e');
+      return 0;
+    }
+  }
+
+  /// False when the stream is gone or its queue is full.
+  static Future<bool> sendMuxText(int stream, String text) async {
+    try {
+      final result = await platform.invokeMethod<bool>('sendMuxText', {'stream': stream, 'text': text});
+      return result ?? false;
+    } catch (e) {
+      print('[WindowsAudioService] Error sending mux text: $e');
+      return false;
+    }
+  }
+
+  /// Send 16kHz mono PCM16 as raw audio on a listen stream.
+  static Future<bool> sendMuxAudio(int stream, {required String source, required Uint8List audio}) async {
+    try {
+      final result = await platform.invokeMethod<bool>('sendMuxAudio', {
+        'stream': stream,
+        'source': source,
+        'audio': audio,
+      });
+      return result ?? false;
+    } catch (e) {
+      print('[WindowsAudioService] Error sending mux audio: $e');
+      return false;
+    }
+  }
+
+  static Future<void> closeMuxStream(int stream) async {
+    try {
+      await platform.invokeMethod('closeMuxStream', {'stream': stream});
+    } catch (e) {
+      print('[WindowsAudioService] Error closing mux stream: $e');
+    }
+  }
+
+  /// Connection counters, and frames, bytes and longest queue wait per priority.
+  static Future<Map<String, dynamic>> getMuxStats() async {
+    try {
+      final result = await platform.invokeMethod<Map>('getMuxStats');
+      return result == null ? {} : Map<String, dynamic>.from(result);
+    } catch (e) {
+      print('[WindowsAudioService] Error getting mux stats: $e');
+      return {};
+    }
+  }
+
+  /// Native counters, gauges and latency histograms: {counters: {name: n},
+  /// gauges: {name: n}, histograms: {name: {count, sum, min, max, mean, p50,
+  /// p90, p99, p999}}}. Durations are in the unit their name ends with.
+  static Future<Map<String, dynamic>> getMetrics() async {
+    try {
+      final result = await platform.invokeMethod<Map>('getMetrics');
+      return result == null ? {} : Map<String, dynamic>.from(result);
+    } catch (e) {
+      print('[WindowsAudioService] Error getting metrics: $e');
+      return {};
+    }
+  }
+
+  /// The same as [getMetrics], as JSON, e.g. to attach to a bug report.
+  static Future<String?> getMetricsJson() async {
+    try {
+      return await platform.invokeMethod<String>('getMetricsJson');
+    } catch (e) {
+      print('[WindowsAudioService] Error getting metrics JSON: $e');
+      return null;
+    }
+  }
+
+  /// Platform-thread stalls from the native watchdog: {thresholdMs,
+  /// handlerCalls, stalls, recent: [{kind, method, durationMs, atMs, stack}],
+  /// histograms}. Also answered by the Linux runner.
+  static Future<Map<String, dynamic>> getStallStats() async {
+    try {
+      final result = await platform.invokeMethod<Map>('getStallStats');
+      return result == null ? {} : Map<String, dynamic>.from(result);
+    } catch (e) {
+      print('[WindowsAudioService] Error getting stall stats: $e');
+      return {};
+    }
+  }
+
+  /// Profile native CPU use for [seconds] at [hz] samples a second, then
+  /// write a gzipped pprof profile to [path] (open it with `pprof`). False
+  /// when a profile is already being taken or written, or on Linux while
+  /// the Dart VM's own profiler holds SIGPROF (debug and profile builds).
+  static Future<bool> startProfile(String path, {int seconds = 30, int hz = 100}) async {
+    try {
+      final result = await platform.invokeMethod<bool>(
+          'startProfile', {'path': path, 'seconds': seconds, 'hz': hz});
+      return result ?? false;
+    } catch (e) {
+      print('[WindowsAudioService] Error starting profile: $e');
+      return false;
+    }
+  }
+
+  /// End the profile early; what was sampled is written in the background.
+  /// Returns the status as [getProfilerStatus] does, `running` until the
+  /// profile is written.
+  static Future<Map<String, dynamic>> stopProfile() async {
+    try {
+      final result = await platform.invokeMethod<Map>('stopProfile');
+      return result == null ? {} : Map<String, dynamic>.from(result);
+    } catch (e) {
+      print('[WindowsAudioService] Error stopping profile: $e');
+      return {};
+    }
+  }
+
+  /// {running, written, path, hz, samples, lost, samplingUs} for the current
+  /// or last profile.
+  static Future<Map<String, dynamic>> getProfilerStatus() async {
+    try {
+      final result = await platform.invokeMethod<Map>('getProfilerStatus');
+      return result == null ? {} : Map<String, dynamic>.from(result);
+    } catch (e) {
+      print('[WindowsAudioService] Error getting profiler status: $e');
+      return {};
+    }
+  }
+
+  /// Add or replace [text] under [id] in the native answer index; [payload]
+  /// comes back with matches (e.g. the stored answer).
+  static Future<void> indexAnswer({required String id, required String text, String payload = ''}) async {
+    try {
+      await platform.invokeMethod('indexAnswer', {'id': id, 'text': text, 'payload': payload});
+    } catch (e) {
+      print('[WindowsAudioService] Error indexing answer: $e');
+    }
+  }
+
+  static Future<void> removeIndexedAnswer(String id) async {
+    try {
+      await platform.invokeMethod('removeIndexedAnswer', {'id': id});
+    } catch (e) {
+      print('[WindowsAudioService] Error removing indexed answer: $e');
+    }
+  }
+
+  /// Up to [k] indexed entries nearest to [text] with a score (cosine
+  /// similarity) of at least [minScore], best first. With [prefix], only ids
+  /// starting with it are considered.
+  static Future<List<AnswerMatch>> searchAnswers(String text,
+      {int k = 3, double minScore = 0.0, String prefix = ''}) async {
+    try {
+      final result = await platform.invokeMethod<List>('searchAnswers', {
+        'text': text,
+        'k': k,
+        'minScore': minScore,
+        'prefix': prefix,
+      });
+      if (result == null) return const <AnswerMatch>[];
+      return result.map((e) => AnswerMatch.fromMap(Map<String, dynamic>.from(e as Map))).toList();
+    } catch (e) {
+      print('[WindowsAudioService] Error searching answers: $e');
+      return const <AnswerMatch>[];
+    }
+  }
+
+  static Future<void> clearAnswerIndex() async {
+    try {
+      await platform.invokeMethod('clearAnswerIndex');
+    } catch (e) {
+      print('[WindowsAudioService] Error clearing answer index: $e');
+    }
+  }
+
+  /// Cap the bytes held by native audio buffers; history shrinks before the
+  /// queues of audio still owed to Dart.
+  static Future<void> setMemoryBudget(int bytes) async {
+    try {
+      await platform.invokeMethod('setMemoryBudget', {'bytes': bytes});
+    } catch (e) {
+      print('[WindowsAudioService] Error setting memory budget: $e');
+    }
+  }
+
+  /// The native memory budget, bytes held, and per-buffer limit/used/peak
+  /// under `pools`, keyed by tag.
+  static Future<Map<String, dynamic>> getMemoryStats() async {
+    try {
+      final result = await platform.invokeMethod<Map>('getMemoryStats');
+      return result == null ? {} : Map<String, dynamic>.from(result);
+    } catch (e) {
+      print('[WindowsAudioService] Error getting memory stats: $e');
+      return {};
+    }
+  }
+
   /// Mix microphone and system audio
   static List<int> mixAudio(List<int> micAudio, List<int> systemAudio) {
     final length = micAudio.length;
@@ -75,3 +795,172 @@ class WindowsAudioService {
     return mixedAudio;
   }
 }
+
+/// System audio bytes plus the remote speaker detected natively.
+class SystemAudioFrame {
+  final List<int> audio;
+  final int speakerId;
+  final bool endOfUtterance;
+  // Per piece of a pull made with pieceBytes, in order; empty otherwise.
+  final List<SystemAudioPiece> pieces;
+
+  const SystemAudioFrame({
+    required this.audio,
+    required this.speakerId,
+    this.endOfUtterance = false,
+    this.pieces = const <SystemAudioPiece>[],
+  });
+}
+
+class SystemAudioPiece {
+  final int speakerId;
+  final bool endOfUtterance; // An utterance ended by the end of this piece
+
+  const SystemAudioPiece({required this.speakerId, required this.endOfUtterance});
+}
+
+/// Result of encoding a session save against the acknowledged version.
+class SessionDelta {
+  final String result; // 'delta', 'unchanged' or 'noBaseline'
+  final Uint8List delta;
+  final int version;
+
+  const SessionDelta({required this.result, required this.delta, required this.version});
+
+  bool get hasDelta => result == 'delta';
+  bool get isUnchanged => result == 'unchanged';
+
+  factory SessionDelta.fromMap(Map<String, dynamic> map) {
+    return SessionDelta(
+      result: (map['result'] as String?) ?? 'noBaseline',
+      delta: (map['delta'] as Uint8List?) ?? Uint8List(0),
+      version: (map['version'] as int?) ?? 0,
+    );
+  }
+}
+
+/// One poll's worth of a session replay.
+class SessionReplayBatch {
+  final Uint8List mic;
+  final List<String> messages;
+  final bool done;
+
+  const SessionReplayBatch({required this.mic, required this.messages, required this.done});
+
+  factory SessionReplayBatch.done() =>
+      SessionReplayBatch(mic: Uint8List(0), messages: const <String>[], done: true);
+
+  factory SessionReplayBatch.fromMap(Map<String, dynamic> map) {
+    return SessionReplayBatch(
+      mic: (map['mic'] as Uint8List?) ?? Uint8List(0),
+      messages: ((map['messages'] as List?) ?? const []).cast<String>(),
+      done: map['done'] == true,
+    );
+  }
+}
+
+/// An answer-index entry close to a searched question.
+class AnswerMatch {
+  final String id;
+  final double score;
+  final String payload;
+
+  const AnswerMatch({required this.id, required this.score, required this.payload});
+
+  factory AnswerMatch.fromMap(Map<String, dynamic> map) {
+    return AnswerMatch(
+      id: (map['id'] as String?) ?? '',
+      score: (map['score'] as num?)?.toDouble() ?? 0.0,
+      payload: (map['payload'] as String?) ?? '',
+    );
+  }
+}
+
+/// An audio endpoint and its shared-mode engine format.
+class AudioDevice {
+  final String id;
+  final String name;
+  final String flow; // 'capture' or 'render'
+  final bool isDefault;
+  final int sampleRate;
+  final int channels;
+  final int bitsPerSample;
+  final bool isFloat;
+
+  const AudioDevice({
+    required this.id,
+    required this.name,
+    required this.flow,
+    required this.isDefault,
+    required this.sampleRate,
+    required this.channels,
+    required this.bitsPerSample,
+    required this.isFloat,
+  });
+
+  factory AudioDevice.fromMap(Map<String, dynamic> map) {
+    return AudioDevice(
+      id: (map['id'] as String?) ?? '',
+      name: (map['name'] as String?) ?? '',
+      flow: (map['flow'] as String?) ?? 'capture',
+      isDefault: map['isDefault'] == true,
+      sampleRate: (map['sampleRate'] as int?) ?? 0,
+      channels: (map['channels'] as int?) ?? 0,
+      bitsPerSample: (map['bitsPerSample'] as int?) ?? 0,
+      isFloat: map['isFloat'] == true,
+    );
+  }
+}
+
+/// Something that happened on the native multiplexed connection.
+class MuxEvent {
+  final String type; // 'connected', 'disconnected', 'text' or 'closed'
+  final int stream;
+  final String text; // The message, or the close reason
+  final int code;
+
+  const MuxEvent({required this.type, required this.stream, required this.text, required this.code});
+
+  factory MuxEvent.fromMap(Map<String, dynamic> map) {
+    return MuxEvent(
+      type: (map['type'] as String?) ?? 'text',
+      stream: (map['stream'] as int?) ?? 0,
+      text: (map['text'] as String?) ?? '',
+      code: (map['code'] as int?) ?? 0,
+    );
+  }
+}
+
+class NativePowerState {
+  final String mode; // 'interactive', 'background' or 'saver'
+  final bool minimized;
+  final bool occluded;
+  final bool sessionIdle; // Locked, display off or user away
+  final bool onBattery;
+  final int batteryPercent; // -1 when unknown
+  final int deliveryIntervalMs; // 0: as audio arrives
+
+  const NativePowerState({
+    this.mode = 'interactive',
+    this.minimized = false,
+    this.occluded = false,
+    this.sessionIdle = false,
+    this.onBattery = false,
+    this.batteryPercent = -1,
+    this.deliveryIntervalMs = 0,
+  });
+
+  bool get interactive => mode == 'interactive';
+
+  factory NativePowerState.fromMap(Map<String, dynamic> map) {
+    return NativePowerState(
+      mode: (map['mode'] as String?) ?? 'interactive',
+      minimized: map['minimized'] == true,
+      occluded: map['occluded'] == true,
+      sessionIdle: map['sessionIdle'] == true,
+      onBattery: map['onBattery'] == true,
+      batteryPercent: (map['batteryPercent'] as int?) ?? -1,
+      deliveryIntervalMs: (map['deliveryIntervalMs'] as int?) ?? 0,
+    );
+  }
+}
@@ -5,20 +5,235 @@
 #include <gdk/gdkx.h>
 #endif
 
+#include <cstring>
+#include <string>
+
 #include "flutter/generated_plugin_registrant.h"
+#include "metrics.h"
+#include "power_state.h"
+#include "sampling_profiler.h"
+#include "stall_watchdog.h"
 
 struct _MyApplication {
   GtkApplication parent_instance;
   char** dart_entrypoint_arguments;
+  FlMethodChannel* audio_channel;
+  // Screen saver signals (org.freedesktop and org.gnome) and UPower.
+  GDBusConnection* session_bus;
+  guint screensaver_subscriptions[2];
+  GDBusProxy* upower;
+  GCancellable* cancellable;
 };
 
 G_DEFINE_TYPE(MyApplication, my_application, GTK_TYPE_APPLICATION)
 
+// Opt-in CPU profiler (startProfile); samples through SIGPROF here.
+static SamplingProfiler g_profiler;
+
 // Called when first Flutter frame received.
 static void first_frame_cb(MyApplication* self, FlView* view) {
   gtk_widget_show(gtk_widget_get_toplevel(GTK_WIDGET(view)));
 }
 
+// Heartbeat from the stall watchdog, run by the GTK main loop.
+static gboolean watchdog_ping_cb(gpointer user_data) {
+  PlatformWatchdog().OnPing();
+  return G_SOURCE_REMOVE;
+}
+
+static FlValue* histogram_to_value(const HistogramSnapshot& h) {
+  FlValue* out = fl_value_new_map();
+  fl_value_set_string_take(out, "count", fl_value_new_int(static_cast<int64_t>(h.count)));
+  fl_value_set_string_take(out, "max", fl_value_new_int(h.max));
+  fl_value_set_string_take(out, "mean", fl_value_new_float(h.Mean()));
+  fl_value_set_string_take(out, "p50", fl_value_new_int(h.Percentile(0.5)));
+  fl_value_set_string_take(out, "p90", fl_value_new_int(h.Percentile(0.9)));
+  fl_value_set_string_take(out, "p99", fl_value_new_int(h.Percentile(0.99)));
+  return out;
+}
+
+// The same shape as the Windows runner's getStallStats.
+static FlValue* stall_stats_to_value(const StallWatchdog::Stats& stats) {
+  FlValue* recent = fl_value_new_list();
+  for (const auto& stall : stats.recent) {
+    FlValue* stack = fl_value_new_list();
+    for (const auto& frame : stall.stack) {
+      fl_value_append_take(stack, fl_value_new_string(frame.c_str()));
+    }
+    FlValue* item = fl_value_new_map();
+    fl_value_set_string_take(item, "kind", fl_value_new_string(stall.kind.c_str()));
+    fl_value_set_string_take(item, "method", fl_value_new_string(stall.method.c_str()));
+    fl_value_set_string_take(item, "durationMs", fl_value_new_int(stall.duration_ms));
+    fl_value_set_string_take(item, "atMs", fl_value_new_int(stall.at_ms));
+    fl_value_set_string_take(item, "stack", stack);
+    fl_value_append_take(recent, item);
+  }
+  const MetricsRegistry::Snapshot metrics = Metrics().Take();
+  FlValue* histograms = fl_value_new_map();
+  for (const char* name :
+       {"platform.handler_us", "platform.loop_latency_us", "platform.stall_ms"}) {
+    auto it = metrics.histograms.find(name);
+    if (it != metrics.histograms.end()) {
+      fl_value_set_string_take(histograms, name, histogram_to_value(it->second));
+    }
+  }
+  FlValue* out = fl_value_new_map();
+  fl_value_set_string_take(out, "thresholdMs", fl_value_new_int(stats.threshold_ms));
+  fl_value_set_string_take(out, "handlerCalls",
+                           fl_value_new_int(static_cast<int64_t>(stats.handler_calls)));
+  fl_value_set_string_take(out, "stalls", fl_value_new_int(static_cast<int64_t>(stats.stalls)));
+  fl_value_set_string_take(out, "recent", recent);
+  fl_value_set_string_take(out, "histograms", histograms);
+  return out;
+}
+
+// The same shape as the Windows runner's getPowerState.
+static FlValue* power_state_to_value(const PowerState::Snapshot& state) {
+  FlValue* out = fl_value_new_map();
+  fl_value_set_string_take(out, "mode", fl_value_new_string(PowerState::ModeName(state.mode)));
+  fl_value_set_string_take(out, "minimized", fl_value_new_bool(state.minimized));
+  fl_value_set_string_take(out, "occluded", fl_value_new_bool(state.occluded));
+  fl_value_set_string_take(out, "sessionIdle", fl_value_new_bool(state.session_idle));
+  fl_value_set_string_take(out, "onBattery", fl_value_new_bool(state.on_battery));
+  fl_value_set_string_take(out, "batteryPercent", fl_value_new_int(state.battery_percent));
+  fl_value_set_string_take(out, "deliveryIntervalMs",
+                           fl_value_new_int(PowerState::DeliveryIntervalMs(state.mode)));
+  return out;
+}
+
+// The same shape as the Windows runner's getProfilerStatus.
+static FlValue* profiler_status_to_value(const SamplingProfiler::Status& status) {
+  FlValue* out = fl_value_new_map();
+  fl_value_set_string_take(out, "running", fl_value_new_bool(status.running));
+  fl_value_set_string_take(out, "written", fl_value_new_bool(status.written));
+  fl_value_set_string_take(out, "path", fl_value_new_string(status.path.c_str()));
+  fl_value_set_string_take(out, "hz", fl_value_new_int(status.hz));
+  fl_value_set_string_take(out, "samples", fl_value_new_int(static_cast<int64_t>(status.samples)));
+  fl_value_set_string_take(out, "lost", fl_value_new_int(static_cast<int64_t>(status.lost)));
+  fl_value_set_string_take(out, "samplingUs", fl_value_new_int(status.sampling_us));
+  return out;
+}
+
+// Reads |key| from a map argument, or |fallback| when absent or mistyped.
+static std::string string_argument(FlValue* args, const char* key) {
+  FlValue* value = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                       ? fl_value_lookup_string(args, key)
+                       : nullptr;
+  return value && fl_value_get_type(value) == FL_VALUE_TYPE_STRING ? fl_value_get_string(value)
+                                                                   : "";
+}
+
+static int64_t int_argument(FlValue* args, const char* key, int64_t fallback) {
+  FlValue* value = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                       ? fl_value_lookup_string(args, key)
+                       : nullptr;
+  return value && fl_value_get_type(value) == FL_VALUE_TYPE_INT ? fl_value_get_int(value)
+                                                                : fallback;
+}
+
+// Tells Dart when AppPowerState() changed.
+static void publish_power_state(MyApplication* self, gboolean changed) {
+  if (!changed || self->audio_channel == nullptr) return;
+  g_autoptr(FlValue) state = power_state_to_value(AppPowerState().snapshot());
+  fl_method_channel_invoke_method(self->audio_channel, "onPowerStateChanged", state, nullptr,
+                                  nullptr, nullptr);
+}
+
+static gboolean window_state_event_cb(GtkWidget* widget, GdkEventWindowState* event,
+                                      gpointer user_data) {
+  const GdkWindowState state = event->new_window_state;
+  gboolean changed = AppPowerState().SetMinimized((state & GDK_WINDOW_STATE_ICONIFIED) != 0);
+  if (event->changed_mask & GDK_WINDOW_STATE_WITHDRAWN) {
+    changed |= AppPowerState().SetOccluded((state & GDK_WINDOW_STATE_WITHDRAWN) != 0);
+  }
+  publish_power_state(MY_APPLICATION(user_data), changed);
+  return FALSE;
+}
+
+// Sent by X servers without a compositor; a composited window is never
+// reported as covered.
+static gboolean visibility_notify_event_cb(GtkWidget* widget, GdkEventVisibility* event,
+                                           gpointer user_data) {
+  publish_power_state(MY_APPLICATION(user_data),
+                      AppPowerState().SetOccluded(event->state == GDK_VISIBILITY_FULLY_OBSCURED));
+  return FALSE;
+}
+
+// ActiveChanged(b) from the screen saver: the session is locked or blanked.
+static void screensaver_signal_cb(GDBusConnection* connection, const gchar* sender,
+                                  const gchar* object_path, const gchar* interface,
+                                  const gchar* signal, GVariant* parameters,
+                                  gpointer user_data) {
+  if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(b)"))) return;
+  gboolean active = FALSE;
+  g_variant_get(parameters, "(b)", &active);
+  publish_power_state(MY_APPLICATION(user_data), AppPowerState().SetSessionIdle(active));
+}
+
+static void upower_update(MyApplication* self) {
+  g_autoptr(GVariant) on_battery = g_dbus_proxy_get_cached_property(self->upower, "OnBattery");
+  if (on_battery == nullptr || !g_variant_is_of_type(on_battery, G_VARIANT_TYPE_BOOLEAN)) return;
+  publish_power_state(self, AppPowerState().SetBattery(g_variant_get_boolean(on_battery), -1));
+}
+
+static void upower_properties_changed_cb(GDBusProxy* proxy, GVariant* changed,
+                                         GStrv invalidated, gpointer user_data) {
+  upower_update(MY_APPLICATION(user_data));
+}
+
+// Without UPower (no battery daemon, a container) the app counts as on mains.
+static void upower_ready_cb(GObject* source, GAsyncResult* result, gpointer user_data) {
+  g_autoptr(GError) error = nullptr;
+  GDBusProxy* proxy = g_dbus_proxy_new_for_bus_finish(result, &error);
+  if (proxy == nullptr) {
+    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+      g_message("UPower unavailable: %s", error->message);
+    }
+    return;
+  }
+  MyApplication* self = MY_APPLICATION(user_data);
+  self->upower = proxy;
+  g_signal_connect(proxy, "g-properties-changed", G_CALLBACK(upower_properties_changed_cb), self);
+  upower_update(self);
+}
+
+// Native audio is Windows-only; on Linux the channel answers diagnostics.
+static void audio_method_call_cb(FlMethodChannel* channel,
+                                 FlMethodCall* method_call,
+                                 gpointer user_data) {
+  const gchar* method = fl_method_call_get_name(method_call);
+  const StallWatchdog::Scope stall_scope(&PlatformWatchdog(), "audio", method);
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "getStallStats") == 0) {
+    g_autoptr(FlValue) result = stall_stats_to_value(PlatformWatchdog().stats());
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "getPowerState") == 0) {
+    g_autoptr(FlValue) result = power_state_to_value(AppPowerState().snapshot());
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "getMetricsJson") == 0) {
+    g_autoptr(FlValue) result = fl_value_new_string(Metrics().ToJson().c_str());
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "startProfile") == 0) {
+    // {path, seconds?, hz?}; writes a gzipped pprof profile to |path|.
+    FlValue* args = fl_method_call_get_args(method_call);
+    const bool started = g_profiler.Start(string_argument(args, "path"),
+                                          static_cast<int>(int_argument(args, "seconds", 30)),
+                                          static_cast<int>(int_argument(args, "hz", 100)));
+    g_autoptr(FlValue) result = fl_value_new_bool(started);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "stopProfile") == 0) {
+    g_profiler.Stop();
+    g_autoptr(FlValue) result = profiler_status_to_value(g_profiler.status());
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "getProfilerStatus") == 0) {
+    g_autoptr(FlValue) result = profiler_status_to_value(g_profiler.status());
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
 // Implements GApplication::activate.
 static void my_application_activate(GApplication* application) {
   MyApplication* self = MY_APPLICATION(application);
@@ -75,6 +290,39 @@ static void my_application_activate(GApplication* application) {
 
   fl_register_plugins(FL_PLUGIN_REGISTRY(view));
 
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  self->audio_channel = fl_method_channel_new(
+      fl_engine_get_binary_messenger(fl_view_get_engine(view)),
+      "com.hearnow/audio", FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(
+      self->audio_channel, audio_method_call_cb, self, nullptr);
+
+  // Times how long the GTK main loop takes to get to an invoked callback,
+  // and the channel handlers it runs.
+  PlatformWatchdog().Start([]() {
+    g_main_context_invoke(nullptr, watchdog_ping_cb, nullptr);
+  });
+
+  // Visibility, session and power source drive AppPowerState(); the native
+  // pipeline slows down while nobody can see the window.
+  gtk_widget_add_events(GTK_WIDGET(window), GDK_VISIBILITY_NOTIFY_MASK);
+  g_signal_connect(window, "window-state-event", G_CALLBACK(window_state_event_cb), self);
+  g_signal_connect(window, "visibility-notify-event", G_CALLBACK(visibility_notify_event_cb),
+                   self);
+  self->session_bus = g_bus_get_sync(G_BUS_TYPE_SESSION, nullptr, nullptr);
+  if (self->session_bus != nullptr) {
+    const gchar* interfaces[] = {"org.freedesktop.ScreenSaver", "org.gnome.ScreenSaver"};
+    for (int i = 0; i < 2; i++) {
+      self->screensaver_subscriptions[i] = g_dbus_connection_signal_subscribe(
+          self->session_bus, nullptr, interfaces[i], "ActiveChanged", nullptr, nullptr,
+          G_DBUS_SIGNAL_FLAGS_NONE, screensaver_signal_cb, self, nullptr);
+    }
+  }
+  self->cancellable = g_cancellable_new();
+  g_dbus_proxy_new_for_bus(G_BUS_TYPE_SYSTEM, G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START, nullptr,
+                           "org.freedesktop.UPower", "/org/freedesktop/UPower",
+                           "org.freedesktop.UPower", self->cancellable, upower_ready_cb, self);
+
   gtk_widget_grab_focus(GTK_WIDGET(view));
 }
 
@@ -113,6 +361,8 @@ static void my_application_shutdown(GApplication* application) {
   // MyApplication* self = MY_APPLICATION(object);
 
   // Perform any actions required at application shutdown.
+  PlatformWatchdog().Stop();
+  g_profiler.StopAndWait();
 
   G_APPLICATION_CLASS(my_application_parent_class)->shutdown(application);
 }
@@ -121,6 +371,20 @@ static void my_application_shutdown(GApplication* application) {
 static void my_application_dispose(GObject* object) {
   MyApplication* self = MY_APPLICATION(object);
   g_clear_pointer(&self->dart_entrypoint_arguments, g_strfreev);
+  g_clear_object(&self->audio_channel);
+  if (self->cancellable != nullptr) g_cancellable_cancel(self->cancellable);
+  g_clear_object(&self->cancellable);
+  if (self->upower != nullptr) {
+    g_signal_handlers_disconnect_by_data(self->upower, self);
+    g_clear_object(&self->upower);
+  }
+  if (self->session_bus != nullptr) {
+    for (guint& subscription : self->screensaver_subscriptions) {
+      if (subscription != 0) g_dbus_connection_signal_unsubscribe(self->session_bus, subscription);
+      subscription = 0;
+    }
+    g_clear_object(&self->session_bus);
+  }
   G_OBJECT_CLASS(my_application_parent_class)->dispose(object);
 }
 
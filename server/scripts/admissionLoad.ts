@@ -0,0 +1,193 @@
+import { ChildProcess } from 'child_process';
+import { WebSocket } from 'ws';
+import { generateToken } from '../src/auth.js';
+import { getJson, sleep, STAND_IN_CHUNK_BYTES, startRelayProcess, startStandInUpstream } from './localRelay.js';
+
+// Load generator for admission control (admission.ts): opens /listen sessions
+// at a steady rate until SESSIONS are open or refused, streams 100 ms chunks
+// on each (one second of tone, one of silence) and prints once a second how
+// many are live, queued behind the upgrade, refused with Retry-After or shed,
+// and the interim results they receive.
+//
+//   npm run load:admission -- [sessions] [opensPerSecond] [seconds] [url]
+//
+// Without a url it runs one gateway behind the router with the stand-in
+// upstream (localRelay.ts) and also prints the gateway's shedding level, so
+// the interim -> silence -> sessions steps can be watched as the gateway
+// saturates; ADMISSION_* variables pass through to it. With a url, e.g.
+// ws://localhost:3000/listen for server.ts, the target must accept a token
+// signed with this JWT_SECRET.
+
+const SESSIONS = Number(process.argv[2] ?? 400);
+const OPENS_PER_SECOND = Number(process.argv[3] ?? 20);
+const SECONDS = Number(process.argv[4] ?? 60);
+const TARGET = process.argv[5];
+const BASE_PORT = Number(process.env.DEMO_BASE_PORT ?? 4200);
+const UPSTREAM_PORT = BASE_PORT + 99;
+const CHUNK_MS = 100;
+
+const counters = {
+  opening: 0,
+  live: 0,
+  refused: 0,
+  shed: 0,
+  failed: 0,
+  interim: 0,
+  finals: 0,
+};
+const retryAfter = new Map<string, number>(); // Retry-After seconds -> count
+
+function countRetryAfter(value: unknown): void {
+  const key = value === undefined || value === null ? 'none' : String(value);
+  retryAfter.set(key, (retryAfter.get(key) ?? 0) + 1);
+}
+
+// Tone chunks carry a non-zero first word so the stand-in upstream answers
+// them; silent chunks are all zero, which admission may drop at 'silence'.
+function chunk(index: number): Buffer {
+  const audio = Buffer.alloc(STAND_IN_CHUNK_BYTES);
+  if (Math.floor((index * CHUNK_MS) / 1_000) % 2 === 1) return audio;
+  for (let i = 0; i < audio.length / 2; i++) {
+    audio.writeInt16LE(Math.round(8_000 * Math.sin((2 * Math.PI * 220 * i) / 16_000)), i * 2);
+  }
+  audio.writeUInt32LE(index + 1, 0);
+  return audio;
+}
+
+function openSession(url: string, session: number, deadline: number): void {
+  const ws = new WebSocket(`${url}?token=${generateToken(`load-${session}`, 'load@localhost')}&session=load${session}`);
+  let opened = false;
+  let timer: NodeJS.Timeout | undefined;
+  counters.opening++;
+
+  // server.ts and gateways refuse the upgrade itself with 503 + Retry-After.
+  ws.on('unexpected-response', (_req, res) => {
+    counters.opening--;
+    if (res.statusCode === 503) {
+      counters.refused++;
+      countRetryAfter(res.headers['retry-after']);
+    } else {
+      counters.failed++;
+    }
+    res.resume();
+    ws.terminate();
+  });
+  ws.on('error', () => {});
+  ws.on('open', () => {
+    counters.opening--;
+    counters.live++;
+    opened = true;
+    ws.send(JSON.stringify({ type: 'start' }));
+    let sent = 0;
+    timer = setInterval(() => {
+      if (Date.now() >= deadline) {
+        clearInterval(timer);
+        ws.send(JSON.stringify({ type: 'stop' }));
+        setTimeout(() => ws.close(), 500);
+        return;
+      }
+      ws.send(JSON.stringify({ type: 'audio', source: 'mic', audio: chunk(sent++).toString('base64') }));
+    }, CHUNK_MS);
+  });
+  ws.on('message', (data) => {
+    const event = JSON.parse(data.toString());
+    if (event.type === 'transcript') {
+      if (event.is_final) counters.finals++;
+      else counters.interim++;
+    } else if (event.type === 'error' && 'retryAfter' in event) {
+      // The router refuses once every gateway has, after the socket opened;
+      // a session shed under overload ends the same way.
+      countRetryAfter(event.retryAfter);
+      if (event.message === 'No relay gateway available') counters.refused++;
+      else counters.shed++;
+    }
+  });
+  ws.on('close', () => {
+    clearInterval(timer);
+    if (opened) counters.live--;
+  });
+}
+
+async function main(): Promise<void> {
+  const children: ChildProcess[] = [];
+  let url = TARGET;
+  let gatewayHealth = '';
+  if (!url) {
+    const upstream = startStandInUpstream(UPSTREAM_PORT);
+    children.push(
+      startRelayProcess(
+        'relayGateway',
+        {
+          DEEPGRAM_API_KEY: 'load',
+          DEEPGRAM_URL: `http://127.0.0.1:${UPSTREAM_PORT}`,
+          GATEWAY_ID: 'a',
+          GATEWAY_PORT: String(BASE_PORT + 1),
+        },
+        'gateway',
+        (line) => line.startsWith('[Admission] level') || line.startsWith('[Admission] shed'),
+      ),
+      startRelayProcess(
+        'relayRouter',
+        { RELAY_PORT: String(BASE_PORT), RELAY_GATEWAYS: `a=ws://127.0.0.1:${BASE_PORT + 1}` },
+        'router',
+        (line) => line.includes('Gateway'),
+      ),
+    );
+    process.on('exit', () => upstream.close());
+    gatewayHealth = `http://127.0.0.1:${BASE_PORT + 1}/healthz`;
+    url = `ws://127.0.0.1:${BASE_PORT}/listen`;
+    while ((await getJson(`http://127.0.0.1:${BASE_PORT}/health`))?.gateways?.length !== 1) await sleep(200);
+  }
+
+  const start = Date.now();
+  const deadline = start + SECONDS * 1_000;
+  let opened = 0;
+  const opener = setInterval(() => {
+    if (opened >= SESSIONS || Date.now() >= deadline) {
+      clearInterval(opener);
+      return;
+    }
+    openSession(url!, opened++, deadline);
+  }, 1_000 / OPENS_PER_SECOND);
+
+  console.log('   s  opened  upgrading  live  refused  shed  interim/s  finals/s  gateway');
+  let lastInterim = 0;
+  let lastFinals = 0;
+  while (Date.now() < deadline + 2_000) {
+    await sleep(1_000);
+    let gateway = '';
+    if (gatewayHealth) {
+      const stats = (await getJson(gatewayHealth))?.admission;
+      if (stats) {
+        gateway =
+          `${stats.level.padEnd(8)} load ${stats.load.toFixed(2)} cpu ${Math.round(stats.cpu * 100)}% ` +
+          `lag p99 ${stats.lagP99Ms} ms, dropped ${stats.droppedInterim} interim ${stats.droppedSilence} silence`;
+      }
+    }
+    console.log(
+      `${String(Math.round((Date.now() - start) / 1_000)).padStart(4)}  ${String(opened).padStart(6)}  ` +
+        `${String(counters.opening).padStart(9)}  ${String(counters.live).padStart(4)}  ` +
+        `${String(counters.refused).padStart(7)}  ${String(counters.shed).padStart(4)}  ` +
+        `${String(counters.interim - lastInterim).padStart(9)}  ${String(counters.finals - lastFinals).padStart(8)}  ${gateway}`,
+    );
+    lastInterim = counters.interim;
+    lastFinals = counters.finals;
+  }
+
+  console.log(
+    JSON.stringify({
+      opened,
+      refused: counters.refused,
+      shed: counters.shed,
+      failed: counters.failed,
+      retryAfterSec: Object.fromEntries(retryAfter),
+    }),
+  );
+  for (const child of children) child.kill('SIGTERM');
+  process.exit(0);
+}
+
+main().catch((error) => {
+  console.error(error);
+  process.exit(1);
+});
@@ -0,0 +1,113 @@
+import { ChildProcess, spawn } from 'child_process';
+import { randomUUID } from 'crypto';
+import { get } from 'http';
+import { fileURLToPath } from 'url';
+import { WebSocket, WebSocketServer } from 'ws';
+
+// Pieces shared by the scripts that run the relay on one machine.
+
+export const sleep = (ms: number) => new Promise((resolve) => setTimeout(resolve, ms));
+
+// Runs a relay entry point (src/<entry>.ts) with this process's loader flags,
+// so the scripts work under tsx. Its output is echoed with |tag| in front,
+// only the lines |filter| keeps if one is given.
+export function startRelayProcess(
+  entry: string,
+  env: Record<string, string>,
+  tag: string,
+  filter?: (line: string) => boolean,
+): ChildProcess {
+  const file = fileURLToPath(new URL(`../src/${entry}.ts`, import.meta.url));
+  const child = spawn(process.execPath, [...process.execArgv, file], {
+    env: { ...process.env, ...env },
+    stdio: ['ignore', 'pipe', 'pipe'],
+  });
+  const echo = (data: Buffer) => {
+    for (const line of data.toString().split('\n')) {
+      if (line && (!filter || filter(line))) console.log(`  ${tag}| ${line}`);
+    }
+  };
+  child.stdout!.on('data', echo);
+  child.stderr!.on('data', echo);
+  return child;
+}
+
+// GET |url| as JSON; null if it cannot be fetched or parsed.
+export function getJson(url: string): Promise<any> {
+  return new Promise((resolve) => {
+    get(url, (res) => {
+      let body = '';
+      res.on('data', (chunk) => (body += chunk));
+      res.on('end', () => {
+        try {
+          resolve(JSON.parse(body));
+        } catch (_) {
+          resolve(null);
+        }
+      });
+    }).on('error', () => resolve(null));
+  });
+}
+
+// Stand-in for Deepgram's live endpoint (point DEEPGRAM_URL at it). It "transcribes" 3200-byte
+// chunks (100 ms of linear16) whose first 4 bytes carry a word id: each chunk
+// gets an interim and every 10 chunks, or a Finalize, a final 40 ms after the
+// audio like a real recognizer. Chunks with id 0 are silence and carry no word.
+
+export const STAND_IN_CHUNK_BYTES = 3200;
+
+export interface StandInUpstream {
+  close(): void;
+  streams(): number;
+}
+
+export function startStandInUpstream(port: number): StandInUpstream {
+  const server = new WebSocketServer({ port, host: '127.0.0.1', path: '/v1/listen' });
+  let streams = 0;
+  server.on('connection', (ws) => {
+    streams++;
+    const requestId = randomUUID();
+    let buffered = Buffer.alloc(0);
+    let words: string[] = [];
+    let finalStart = 0;
+    const send = (result: object) => {
+      if (ws.readyState === WebSocket.OPEN) {
+        ws.send(JSON.stringify({ ...result, metadata: { request_id: requestId } }));
+      }
+    };
+    const result = (isFinal: boolean) => ({
+      channel: { alternatives: [{ transcript: words.join(' '), confidence: 0.9 }] },
+      is_final: isFinal,
+      start: finalStart,
+      duration: words.length * 0.1,
+    });
+    const final = () => {
+      if (!words.length) return;
+      const r = result(true);
+      finalStart += words.length * 0.1;
+      words = [];
+      setTimeout(() => send(r), 40);
+    };
+    ws.on('message', (data: Buffer, isBinary: boolean) => {
+      if (!isBinary) {
+        const message = JSON.parse(data.toString());
+        if (message.type === 'Finalize') final();
+        if (message.type === 'CloseStream') {
+          final();
+          setTimeout(() => ws.close(), 60);
+        }
+        return;
+      }
+      buffered = Buffer.concat([buffered, data]);
+      while (buffered.length >= STAND_IN_CHUNK_BYTES) {
+        const id = buffered.readUInt32LE(0);
+        buffered = buffered.subarray(STAND_IN_CHUNK_BYTES);
+        if (!id) continue;
+        words.push(`w${id}`);
+        if (words.length >= 10) final();
+        else send(result(false));
+      }
+    });
+  });
+  return { close: () => server.close(), streams: () => streams };
+}
@@ -0,0 +1,190 @@
+import { ChildProcess } from 'child_process';
+import { WebSocket } from 'ws';
+import { generateToken } from '../src/auth.js';
+import { getJson, sleep, STAND_IN_CHUNK_BYTES, startRelayProcess, startStandInUpstream } from './localRelay.js';
+
+// Multi-process demo of the scaled-out relay on one machine: a stand-in
+// upstream, three gateways and the router, with SESSIONS clients streaming
+// through the router while gateway a drains mid-stream, restarts, and then
+// gateway b drains. Each client checks that its finals hold every chunk it
+// sent exactly once and in order, which is what a migration must preserve.
+//
+//   npm run demo:relay -- [sessions] [chunks]
+//
+// Chunk n carries word id n for the stand-in upstream (localRelay.ts).
+// Exits non-zero if any session lost, repeated or reordered a chunk, or saw
+// its socket close.
+
+const SESSIONS = Number(process.argv[2] ?? 30);
+const CHUNKS = Number(process.argv[3] ?? 300);
+const BASE_PORT = Number(process.env.DEMO_BASE_PORT ?? 4100);
+const UPSTREAM_PORT = BASE_PORT + 99;
+const ROUTER_PORT = BASE_PORT;
+const GATEWAYS = ['a', 'b', 'c'];
+const RELAY_SECRET = 'demo';
+const CHUNK_INTERVAL_MS = 20;
+
+function startGateway(id: string): ChildProcess {
+  const port = BASE_PORT + 1 + GATEWAYS.indexOf(id);
+  return startRelayProcess(
+    'relayGateway',
+    {
+      DEEPGRAM_API_KEY: 'demo',
+      DEEPGRAM_URL: `http://127.0.0.1:${UPSTREAM_PORT}`,
+      RELAY_SECRET,
+      GATEWAY_ID: id,
+      GATEWAY_PORT: String(port),
+    },
+    `gateway ${id}`,
+  );
+}
+
+function routerHealth(): Promise<any> {
+  return getJson(`http://127.0.0.1:${ROUTER_PORT}/health`);
+}
+
+async function drain(id: string, child: ChildProcess): Promise<void> {
+  const start = Date.now();
+  const exited = new Promise((resolve) => child.once('exit', resolve));
+  child.kill('SIGTERM');
+  await exited;
+  console.log(`gateway ${id} drained in ${Date.now() - start} ms`);
+}
+
+interface SessionResult {
+  session: number;
+  finals: number;
+  missing: number;
+  repeated: number;
+  reordered: number;
+  unexpectedClose: boolean;
+  errors: number;
+  maxEventGapMs: number;
+}
+
+// One client: |CHUNKS| numbered chunks every 20 ms, then finalize and stop;
+// resolves once the socket has been idle after `stopped`.
+function runSession(session: number, token: string): Promise<SessionResult> {
+  return new Promise((resolve) => {
+    const ws = new WebSocket(`ws://127.0.0.1:${ROUTER_PORT}/listen?token=${token}&session=s${session}`);
+    const ids: number[] = [];
+    let sent = 0;
+    let stopped = false;
+    let errors = 0;
+    let lastEvent = 0;
+    let maxEventGapMs = 0;
+    let idle: NodeJS.Timeout | undefined;
+
+    ws.on('open', () => {
+      ws.send(JSON.stringify({ type: 'start' }));
+      const timer = setInterval(() => {
+        if (sent === CHUNKS) {
+          clearInterval(timer);
+          ws.send(JSON.stringify({ type: 'finalize', source: 'mic' }));
+          setTimeout(() => ws.send(JSON.stringify({ type: 'stop' })), 400);
+          return;
+        }
+        const chunk = Buffer.alloc(STAND_IN_CHUNK_BYTES);
+        chunk.writeUInt32LE(++sent, 0);
+        ws.send(JSON.stringify({ type: 'audio', source: 'mic', audio: chunk.toString('base64') }));
+      }, CHUNK_INTERVAL_MS);
+    });
+    ws.on('message', (data) => {
+      const now = Date.now();
+      if (lastEvent && sent < CHUNKS) maxEventGapMs = Math.max(maxEventGapMs, now - lastEvent);
+      lastEvent = now;
+      const event = JSON.parse(data.toString());
+      if (event.type === 'transcript' && event.is_final) {
+        for (const word of event.text.split(' ')) ids.push(Number(word.slice(1)));
+      }
+      if (event.type === 'error') errors++;
+      if (event.type === 'status' && event.message === 'stopped') stopped = true;
+      // Finals the upstream flushes after stop still count.
+      if (stopped) {
+        clearTimeout(idle);
+        idle = setTimeout(() => ws.close(), 1_500);
+      }
+    });
+    ws.on('close', () => {
+      const seen = new Set<number>();
+      let repeated = 0;
+      let reordered = 0;
+      ids.forEach((id, k) => {
+        if (seen.has(id)) repeated++;
+        seen.add(id);
+        if (k && id < ids[k - 1]) reordered++;
+      });
+      let missing = 0;
+      for (let id = 1; id <= CHUNKS; id++) if (!seen.has(id)) missing++;
+      resolve({
+        session,
+        finals: ids.length,
+        missing,
+        repeated,
+        reordered,
+        unexpectedClose: !stopped,
+        errors,
+        maxEventGapMs,
+      });
+    });
+  });
+}
+
+async function main(): Promise<void> {
+  const upstream = startStandInUpstream(UPSTREAM_PORT);
+  const gateways = new Map(GATEWAYS.map((id) => [id, startGateway(id)]));
+  const router = startRelayProcess(
+    'relayRouter',
+    {
+      RELAY_SECRET,
+      RELAY_PORT: String(ROUTER_PORT),
+      RELAY_GATEWAYS: GATEWAYS.map((id, i) => `${id}=ws://127.0.0.1:${BASE_PORT + 1 + i}`).join(','),
+    },
+    'router',
+  );
+  const deadline = Date.now() + 30_000;
+  while ((await routerHealth())?.gateways?.length !== GATEWAYS.length) {
+    if (Date.now() > deadline) throw new Error('gateways did not join the ring');
+    await sleep(200);
+  }
+
+  console.log(`${SESSIONS} sessions x ${CHUNKS} chunks through the router`);
+  const token = generateToken('relay-demo', 'relay-demo@localhost');
+  const sessions = Promise.all(Array.from({ length: SESSIONS }, (_, i) => runSession(i, token)));
+
+  await sleep(2_000);
+  await drain('a', gateways.get('a')!);
+  gateways.set('a', startGateway('a'));
+  await sleep(1_500);
+  await drain('b', gateways.get('b')!);
+  gateways.delete('b');
+
+  const results = await sessions;
+  const health = await routerHealth();
+  for (const child of [...gateways.values(), router]) child.kill('SIGTERM');
+  upstream.close();
+
+  const bad = results.filter((r) => r.missing || r.repeated || r.reordered || r.unexpectedClose || r.errors);
+  const gaps = results.map((r) => r.maxEventGapMs).sort((a, b) => a - b);
+  console.log(
+    JSON.stringify(
+      {
+        sessions: SESSIONS,
+        chunksEach: CHUNKS,
+        clean: SESSIONS - bad.length,
+        maxEventGapMs: { p50: gaps[gaps.length >> 1], max: gaps[gaps.length - 1] },
+        upstreamStreams: upstream.streams(),
+        router: health && { migrations: health.migrations, failovers: health.failovers, droppedPending: health.droppedPending },
+        bad: bad.slice(0, 5),
+      },
+      null,
+      2,
+    ),
+  );
+  process.exit(bad.length ? 1 : 0);
+}
+
+main().catch((error) => {
+  console.error(error);
+  process.exit(1);
+});
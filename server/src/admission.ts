@@ -0,0 +1,329 @@
+import { monitorEventLoopDelay } from 'perf_hooks';
+
+// Admission control and load shedding for the processes that run /listen
+// sessions (server.ts, relayGateway.ts).
+//
+// Every SAMPLE_MS the controller reads three signals: this process's CPU time
+// as a fraction of one core, the event loop's p99 delay, and live sessions
+// against maxSessions (each holds up to two Deepgram streams, so this is the
+// upstream capacity). CPU and delay, divided by their limits and smoothed
+// over a few samples, give the load; the load sets a shedding level, one step
+// at a time on the way down:
+//
+//   interim  (load >= 0.75)  interim results are not sent
+//   silence  (load >= 0.9)   silent audio frames are not sent upstream
+//   sessions (load >= 1)     one session is ended per sample, lowest
+//                            priority first and newest first within it
+//
+// A new session is admitted while there is room and shedding has not gone
+// past interim results. Otherwise it waits up to queueMs for room, higher
+// priority first, and is then refused with a Retry-After. Each level change,
+// queued session, refusal and ended session is logged with the signals that
+// caused it and kept in stats().recent.
+
+export type AdmissionLevel = 'none' | 'interim' | 'silence' | 'sessions';
+
+export interface AdmissionOptions {
+  maxSessions: number;
+  cpuLimit: number; // Fraction of one core treated as full load
+  lagLimitMs: number; // Event loop p99 delay treated as full load
+  queueMs: number; // How long a new session may wait for room
+  maxQueued: number;
+}
+
+export interface AdmissionStats {
+  level: AdmissionLevel;
+  load: number;
+  cpu: number;
+  lagP99Ms: number;
+  sessions: number;
+  maxSessions: number;
+  queued: number;
+  admitted: number;
+  waited: number;
+  rejected: number;
+  droppedInterim: number;
+  droppedSilence: number;
+  shedSessions: number;
+  recent: { at: string; decision: string; reason: string }[];
+}
+
+// Highest first: a shared meeting has followers depending on it; a client can
+// mark its own session as low priority (?priority=low).
+export const PRIORITY_SHARED = 2;
+export const PRIORITY_NORMAL = 1;
+export const PRIORITY_LOW = 0;
+
+export interface AdmissionTicket {
+  setPriority(priority: number): void;
+  release(): void;
+}
+
+export type AdmissionResult =
+  | { admitted: true; ticket: AdmissionTicket }
+  | { admitted: false; retryAfterSec: number; reason: string };
+
+const LEVELS: AdmissionLevel[] = ['none', 'interim', 'silence', 'sessions'];
+const LEVEL_LOAD = [0, 0.75, 0.9, 1];
+// Load must fall this far below a level's threshold to leave it.
+const HYSTERESIS = 0.1;
+const LOAD_SMOOTHING = 0.5; // Weight of the previous load in each sample
+const SAMPLE_MS = 1_000;
+const RECENT_DECISIONS = 32;
+const RETRY_FULL_SEC = 5;
+const RETRY_OVERLOADED_SEC = 15;
+
+interface Admitted {
+  priority: number;
+  admittedAt: number;
+  onShed: (retryAfterSec: number) => void;
+  released: boolean;
+}
+
+interface Waiter {
+  priority: number;
+  onShed: (retryAfterSec: number) => void;
+  resolve: (result: AdmissionResult) => void;
+  timer: NodeJS.Timeout;
+}
+
+export class AdmissionController {
+  private readonly sessions = new Set<Admitted>();
+  private readonly queue: Waiter[] = [];
+  private readonly delay = monitorEventLoopDelay({ resolution: 10 });
+  private level = 0;
+  private load = 0;
+  private cpu = 0;
+  private lagP99Ms = 0;
+  private lastCpu = process.cpuUsage();
+  private lastSample = process.hrtime.bigint();
+  private timer: NodeJS.Timeout | null = null;
+  private recent: AdmissionStats['recent'] = [];
+  private counters = {
+    admitted: 0,
+    waited: 0,
+    rejected: 0,
+    droppedInterim: 0,
+    droppedSilence: 0,
+    shedSessions: 0,
+  };
+
+  constructor(private readonly options: AdmissionOptions) {}
+
+  start(): void {
+    if (this.timer) return;
+    this.delay.enable();
+    this.timer = setInterval(() => this.sample(), SAMPLE_MS);
+    this.timer.unref();
+  }
+
+  close(): void {
+    if (this.timer) clearInterval(this.timer);
+    this.timer = null;
+    this.delay.disable();
+    for (const waiter of this.queue.splice(0)) {
+      clearTimeout(waiter.timer);
+      waiter.resolve({ admitted: false, retryAfterSec: RETRY_FULL_SEC, reason: 'shutting down' });
+    }
+  }
+
+  // Resolves once the session may start or has been refused. |onShed| ends
+  // the session if load shedding later picks it.
+  admit(priority: number, onShed: (retryAfterSec: number) => void): Promise<AdmissionResult> {
+    if (this.accepting()) {
+      this.counters.admitted++;
+      return Promise.resolve(this.grant(priority, onShed));
+    }
+    if (this.queue.length >= this.options.maxQueued) {
+      return Promise.resolve(this.refuse('queue full'));
+    }
+    return new Promise((resolve) => {
+      const waiter: Waiter = {
+        priority,
+        onShed,
+        resolve,
+        timer: setTimeout(() => {
+          const index = this.queue.indexOf(waiter);
+          if (index < 0) return;
+          this.queue.splice(index, 1);
+          resolve(this.refuse(`waited ${this.options.queueMs} ms`));
+        }, this.options.queueMs),
+      };
+      this.queue.push(waiter);
+      // Stable: equal priorities keep arrival order.
+      this.queue.sort((a, b) => b.priority - a.priority);
+      this.decide('queue', `${this.roomReason()}, ${this.queue.length} waiting`);
+    });
+  }
+
+  // Whether a new session would be admitted without waiting.
+  accepting(): boolean {
+    return this.queue.length === 0 && this.hasRoom();
+  }
+
+  // True when an interim result should not be sent; counts it.
+  dropInterim(): boolean {
+    if (this.level < 1) return false;
+    this.counters.droppedInterim++;
+    return true;
+  }
+
+  // True when |audio| is silent and should not be sent upstream; counts it.
+  dropSilence(audio: Buffer): boolean {
+    if (this.level < 2 || !isSilentPcm16(audio)) return false;
+    this.counters.droppedSilence++;
+    return true;
+  }
+
+  stats(): AdmissionStats {
+    return {
+      level: LEVELS[this.level],
+      load: round2(this.load),
+      cpu: round2(this.cpu),
+      lagP99Ms: Math.round(this.lagP99Ms),
+      sessions: this.sessions.size,
+      maxSessions: this.options.maxSessions,
+      queued: this.queue.length,
+      ...this.counters,
+      recent: [...this.recent],
+    };
+  }
+
+  private grant(priority: number, onShed: (retryAfterSec: number) => void): AdmissionResult {
+    const admitted: Admitted = { priority, admittedAt: Date.now(), onShed, released: false };
+    this.sessions.add(admitted);
+    return {
+      admitted: true,
+      ticket: {
+        setPriority: (value: number) => {
+          admitted.priority = value;
+        },
+        release: () => {
+          if (admitted.released) return;
+          admitted.released = true;
+          this.sessions.delete(admitted);
+          this.drainQueue();
+        },
+      },
+    };
+  }
+
+  private refuse(why: string): AdmissionResult {
+    const retryAfterSec = this.level >= 2 ? RETRY_OVERLOADED_SEC : RETRY_FULL_SEC;
+    const reason = `${why}: ${this.roomReason()}`;
+    this.counters.rejected++;
+    this.decide('reject', `${reason}, retry after ${retryAfterSec} s`);
+    return { admitted: false, retryAfterSec, reason };
+  }
+
+  private hasRoom(): boolean {
+    return this.sessions.size < this.options.maxSessions && this.level < 2;
+  }
+
+  private roomReason(): string {
+    if (this.sessions.size >= this.options.maxSessions) {
+      return `${this.sessions.size}/${this.options.maxSessions} sessions`;
+    }
+    return `shedding ${LEVELS[this.level]} (${this.signals()})`;
+  }
+
+  private drainQueue(): void {
+    while (this.queue.length > 0 && this.hasRoom()) {
+      const waiter = this.queue.shift()!;
+      clearTimeout(waiter.timer);
+      this.counters.admitted++;
+      this.counters.waited++;
+      waiter.resolve(this.grant(waiter.priority, waiter.onShed));
+    }
+  }
+
+  // CPU time as a fraction of one core and event-loop p99 delay since the
+  // last call. Tests override it to set the load.
+  protected readSignals(): { cpu: number; lagP99Ms: number } {
+    const now = process.hrtime.bigint();
+    const wallUs = Number(now - this.lastSample) / 1000;
+    const used = process.cpuUsage(this.lastCpu);
+    this.lastSample = now;
+    this.lastCpu = process.cpuUsage();
+    const lagP99Ms = this.delay.percentile(99) / 1e6;
+    this.delay.reset();
+    return { cpu: wallUs > 0 ? (used.user + used.system) / wallUs : 0, lagP99Ms };
+  }
+
+  private sample(): void {
+    ({ cpu: this.cpu, lagP99Ms: this.lagP99Ms } = this.readSignals());
+    // Smoothed so one slow sample does not end sessions.
+    const current = Math.max(this.cpu / this.options.cpuLimit, this.lagP99Ms / this.options.lagLimitMs);
+    this.load = LOAD_SMOOTHING * this.load + (1 - LOAD_SMOOTHING) * current;
+
+    let target = 0;
+    while (target + 1 < LEVELS.length && this.load >= LEVEL_LOAD[target + 1]) target++;
+    const previous = this.level;
+    if (target > this.level) {
+      this.level = target;
+    } else if (this.level > 0 && this.load < LEVEL_LOAD[this.level] - HYSTERESIS) {
+      this.level--;
+    }
+    if (this.level !== previous) {
+      this.decide(
+        'level',
+        `${LEVELS[previous]} -> ${LEVELS[this.level]} (${this.signals()})`,
+      );
+    }
+
+    if (this.level === 3) this.shedOne();
+    this.drainQueue();
+  }
+
+  private shedOne(): void {
+    let victim: Admitted | null = null;
+    for (const session of this.sessions) {
+      if (
+        !victim ||
+        session.priority < victim.priority ||
+        (session.priority === victim.priority && session.admittedAt > victim.admittedAt)
+      ) {
+        victim = session;
+      }
+    }
+    if (!victim) return;
+    victim.released = true;
+    this.sessions.delete(victim);
+    this.counters.shedSessions++;
+    this.decide(
+      'shed_session',
+      `priority ${victim.priority}, ${Math.round((Date.now() - victim.admittedAt) / 1000)} s old (${this.signals()})`,
+    );
+    victim.onShed(RETRY_OVERLOADED_SEC);
+  }
+
+  private signals(): string {
+    return (
+      `load ${round2(this.load)}: cpu ${Math.round(this.cpu * 100)}%/${Math.round(this.options.cpuLimit * 100)}%, ` +
+      `lag p99 ${Math.round(this.lagP99Ms)}/${this.options.lagLimitMs} ms, ` +
+      `${this.sessions.size}/${this.options.maxSessions} sessions`
+    );
+  }
+
+  private decide(decision: string, reason: string): void {
+    console.log(`[Admission] ${decision}: ${reason}`);
+    this.recent.push({ at: new Date().toISOString(), decision, reason });
+    if (this.recent.length > RECENT_DECISIONS) this.recent.shift();
+  }
+}
+
+// Linear16 audio whose RMS is below about -50 dBFS.
+function isSilentPcm16(audio: Buffer): boolean {
+  const samples = audio.length >> 1;
+  if (samples === 0) return true;
+  let sum = 0;
+  for (let i = 0; i < samples; i++) {
+    const s = audio.readInt16LE(i * 2);
+    sum += s * s;
+  }
+  return sum / samples < 100 * 100;
+}
+
+function round2(value: number): number {
+  return Math.round(value * 100) / 100;
+}
@@ -1,5 +1,6 @@
 import { MongoClient, Db, Collection, ObjectId } from 'mongodb';
 import crypto from 'crypto';
+import { SessionDelta, SessionDeltaBubble } from './sessionSync.js';
 
 // User type definition
 export interface User {
@@ -73,12 +74,14 @@ export interface MeetingSession {
     text: string;
     timestamp: Date | string;
     isDraft: boolean;
+    speakerId?: number; // Remote speaker label from on-device detection (system source)
   }>;
   summary?: string | null;
   insights?: string | null;
   questions?: string | null;
   modeKey?: string; // Mode key: built-in enum name (e.g. "general") or "custom:{id}" for custom modes
   metadata?: Record<string, any>;
+  syncVersion?: number; // Bumped by every delta and full save; never decreases
 }
 
 // Mode config per built-in mode (keyed by mode name, e.g. 'general', 'meeting')
@@ -264,12 +267,14 @@ const formatSessionForApi = (session: MeetingSession): any => {
       text: b.text,
       timestamp: formatDate(b.timestamp),
       isDraft: b.isDraft,
+      ...(b.speakerId !== undefined ? { speakerId: b.speakerId } : {}),
     })),
     summary: session.summary,
     insights: session.insights,
     questions: session.questions,
     modeKey: session.modeKey || 'general', // Default to 'general' if not set
     metadata: session.metadata || {},
+    syncVersion: session.syncVersion ?? 0,
   };
 };
 
@@ -702,21 +707,118 @@ export const getMeetingSession = async (sessionId: string, userId: string): Prom
 export const updateMeetingSession = async (
   sessionId: string,
   userId: string,
-  updates: Partial<Omit<MeetingSession, '_id' | 'id' | 'userId' | 'createdAt'>>
+  updates: Partial<Omit<MeetingSession, '_id' | 'id' | 'userId' | 'createdAt' | 'syncVersion'>>,
+  bumpSyncVersion = false
 ): Promise<boolean> => {
   const collection = getSessionsCollection();
+  const update: Record<string, any> = {
+    $set: {
+      ...updates,
+      updatedAt: new Date(),
+    },
+  };
+  // A full save is a new base for incremental saves. Bumping instead of
+  // resetting the version means no delta built before it can match again.
+  if (bumpSyncVersion) update.$inc = { syncVersion: 1 };
   const result = await collection.updateOne(
     { _id: new ObjectId(sessionId), userId },
-    {
-      $set: {
-        ...updates,
-        updatedAt: new Date(),
-      },
-    }
+    update
   );
   return result.matchedCount > 0;
 };
 
+// Applies an incremental save (see sessionSync.ts) without reading the stored
+// bubbles: a single pipeline update keeps every stored bubble the delta does
+// not touch, replaces the edited ones in place, appends the new ones and
+// truncates to the delta's count. Guarded by syncVersion and the stored
+// bubble count it was planned against, so a delta built against a stale base
+// or racing another save is rejected with 'conflict'.
+export const applyMeetingSessionDelta = async (
+  sessionId: string,
+  userId: string,
+  delta: SessionDelta
+): Promise<'applied' | 'not_found' | 'conflict'> => {
+  const collection = getSessionsCollection();
+  const _id = new ObjectId(sessionId);
+  const current = await collection.findOne(
+    { _id, userId },
+    { projection: { syncVersion: 1, bubbleCount: { $size: '$bubbles' } } }
+  );
+  if (!current) return 'not_found';
+  if ((current.syncVersion ?? 0) !== delta.baseVersion || delta.newVersion <= delta.baseVersion) {
+    return 'conflict';
+  }
+
+  const storedCount = (current as any).bubbleCount as number;
+  const keptCount = Math.min(storedCount, delta.bubbleCount);
+  const replaced = new Map<number, SessionDeltaBubble>();
+  const appended = new Map<number, SessionDeltaBubble>();
+  for (const { index, bubble } of delta.sets) {
+    if (index < keptCount) replaced.set(index, bubble);
+    else appended.set(index, bubble);
+  }
+  const pushed: SessionDeltaBubble[] = [];
+  for (let i = keptCount; i < delta.bubbleCount; i++) {
+    const bubble = appended.get(i);
+    if (!bubble) return 'conflict';
+    pushed.push(bubble);
+  }
+
+  const meta: Record<string, any> = {};
+  if (delta.meta) {
+    const { title, updatedAt, summary, insights, questions, mode, modeKey, metadata } = delta.meta;
+    if (title !== undefined) meta.title = String(title);
+    if (updatedAt) meta.updatedAt = new Date(updatedAt);
+    if (summary !== undefined) meta.summary = summary ? String(summary) : null;
+    if (insights !== undefined) meta.insights = insights ? String(insights) : null;
+    if (questions !== undefined) meta.questions = questions ? String(questions) : null;
+    if (modeKey !== undefined) meta.modeKey = modeKey ? String(modeKey) : 'general';
+    else if (mode !== undefined) meta.modeKey = mode ? String(mode) : 'general';
+    if (metadata !== undefined) meta.metadata = metadata && typeof metadata === 'object' ? metadata : {};
+  }
+
+  // Client values are wrapped in $literal: inside a pipeline a string that
+  // starts with '$' would otherwise be read as a field path.
+  let bubbles: any = { $slice: ['$bubbles', keptCount] };
+  if (replaced.size > 0) {
+    bubbles = {
+      $map: {
+        input: { $range: [0, keptCount] },
+        as: 'i',
+        in: {
+          $switch: {
+            branches: [...replaced].map(([index, bubble]) => ({
+              case: { $eq: ['$$i', index] },
+              then: { $literal: bubble },
+            })),
+            default: { $arrayElemAt: ['$bubbles', '$$i'] },
+          },
+        },
+      },
+    };
+  }
+  if (pushed.length > 0) bubbles = { $concatArrays: [bubbles, { $literal: pushed }] };
+
+  const $set: Record<string, any> = { updatedAt: new Date() };
+  for (const [key, value] of Object.entries(meta)) $set[key] = { $literal: value };
+  if (replaced.size > 0 || delta.bubbleCount !== storedCount) $set.bubbles = bubbles;
+  $set.syncVersion = delta.newVersion;
+
+  const baseFilter = delta.baseVersion === 0
+    ? { $in: [0, null] }
+    : delta.baseVersion;
+  const result = await collection.updateOne(
+    {
+      _id,
+      userId,
+      syncVersion: baseFilter,
+      $expr: { $eq: [{ $size: '$bubbles' }, storedCount] },
+    } as any,
+    [{ $set }] as any
+  );
+  return result.matchedCount === 0 ? 'conflict' : 'applied';
+};
+
 export const listMeetingSessions = async (
   userId: string,
   options?: {
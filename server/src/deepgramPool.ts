@@ -0,0 +1,219 @@
+import { LiveTranscriptionEvents } from '@deepgram/sdk';
+
+// Keeps a few authenticated Deepgram live sessions open so a client's `start`
+// can take one that has already finished its TLS/WebSocket handshake instead
+// of opening a fresh connection. Idle sessions are kept alive with KeepAlive
+// messages (Deepgram closes a stream after ~10 s without audio) and recycled
+// after maxIdleMs. Replenishment runs in the background through a token bucket
+// and backs off while the upstream is failing.
+
+export interface DeepgramPoolOptions {
+  size: number; // Warm sessions to hold; 0 disables the pool
+  maxOpensPerSecond: number; // Replenishment rate limit
+  burst: number; // Opens allowed back-to-back before the rate limit applies
+  keepAliveMs: number;
+  maxIdleMs: number;
+  connectTimeoutMs: number;
+}
+
+export interface DeepgramPoolStats {
+  ready: number;
+  connecting: number;
+  hits: number;
+  misses: number;
+  opened: number;
+  failed: number;
+}
+
+interface IdleSession {
+  live: any;
+  openedAt: number;
+  detach: () => void;
+}
+
+const MAX_BACKOFF_MS = 30_000;
+
+export class DeepgramPool {
+  private readonly ready: IdleSession[] = [];
+  private connecting = 0;
+  private tokens: number;
+  private lastRefill = Date.now();
+  private failures = 0;
+  private pumpTimer: NodeJS.Timeout | null = null;
+  private keepAliveTimer: NodeJS.Timeout | null = null;
+  private closed = false;
+  private counters = { hits: 0, misses: 0, opened: 0, failed: 0 };
+
+  constructor(
+    private readonly openLive: () => any,
+    private readonly options: DeepgramPoolOptions,
+  ) {
+    this.tokens = options.burst;
+  }
+
+  start(): void {
+    if (this.options.size <= 0 || this.keepAliveTimer) return;
+    this.keepAliveTimer = setInterval(() => this.maintain(), this.options.keepAliveMs);
+    this.keepAliveTimer.unref();
+    this.pump();
+  }
+
+  // Returns an open session, or null when none is ready (caller opens its own).
+  acquire(): any | null {
+    while (this.ready.length > 0) {
+      const session = this.ready.pop()!;
+      session.detach();
+      if (this.isOpen(session.live)) {
+        this.counters.hits++;
+        this.pump();
+        return session.live;
+      }
+      this.finish(session.live);
+    }
+    if (this.options.size > 0) this.counters.misses++;
+    this.pump();
+    return null;
+  }
+
+  stats(): DeepgramPoolStats {
+    return { ready: this.ready.length, connecting: this.connecting, ...this.counters };
+  }
+
+  close(): void {
+    this.closed = true;
+    if (this.pumpTimer) clearTimeout(this.pumpTimer);
+    if (this.keepAliveTimer) clearInterval(this.keepAliveTimer);
+    this.pumpTimer = null;
+    this.keepAliveTimer = null;
+    for (const session of this.ready.splice(0)) {
+      session.detach();
+      this.finish(session.live);
+    }
+  }
+
+  private isOpen(live: any): boolean {
+    return typeof live?.isConnected === 'function' ? live.isConnected() : true;
+  }
+
+  private finish(live: any): void {
+    try {
+      live.finish();
+    } catch (_) {}
+  }
+
+  private maintain(): void {
+    const now = Date.now();
+    for (let i = this.ready.length - 1; i >= 0; i--) {
+      const session = this.ready[i];
+      if (now - session.openedAt > this.options.maxIdleMs || !this.isOpen(session.live)) {
+        this.ready.splice(i, 1);
+        session.detach();
+        this.finish(session.live);
+        continue;
+      }
+      try {
+        session.live.keepAlive();
+      } catch (_) {}
+    }
+    this.pump();
+  }
+
+  private refill(): void {
+    const now = Date.now();
+    const earned = ((now - this.lastRefill) / 1000) * this.options.maxOpensPerSecond;
+    this.tokens = Math.min(this.options.burst, this.tokens + earned);
+    this.lastRefill = now;
+  }
+
+  private schedule(delayMs: number): void {
+    if (this.pumpTimer || this.closed) return;
+    this.pumpTimer = setTimeout(() => {
+      this.pumpTimer = null;
+      this.pump();
+    }, delayMs);
+    this.pumpTimer.unref();
+  }
+
+  private pump(): void {
+    if (this.closed || this.options.size <= 0 || this.pumpTimer) return;
+    this.refill();
+    while (this.ready.length + this.connecting < this.options.size && !this.pumpTimer) {
+      if (this.tokens < 1) {
+        this.schedule(((1 - this.tokens) / this.options.maxOpensPerSecond) * 1000);
+        return;
+      }
+      this.tokens -= 1;
+      this.openOne();
+    }
+  }
+
+  private openOne(): void {
+    let live: any;
+    try {
+      live = this.openLive();
+    } catch (error) {
+      console.error('[DeepgramPool] Failed to open session:', error);
+      this.onFailure();
+      return;
+    }
+    this.connecting++;
+
+    let settled = false;
+    const timeout = setTimeout(() => fail(), this.options.connectTimeoutMs);
+    timeout.unref();
+
+    const detach = () => {
+      live.removeListener(LiveTranscriptionEvents.Open, onOpen);
+      live.removeListener(LiveTranscriptionEvents.Error, onDrop);
+      live.removeListener(LiveTranscriptionEvents.Close, onDrop);
+    };
+    const settle = () => {
+      if (settled) return false;
+      settled = true;
+      clearTimeout(timeout);
+      this.connecting--;
+      return true;
+    };
+    const fail = () => {
+      if (!settle()) return;
+      detach();
+      this.finish(live);
+      this.onFailure();
+    };
+    const onOpen = () => {
+      if (!settle()) return;
+      if (this.closed) {
+        detach();
+        this.finish(live);
+        return;
+      }
+      this.failures = 0;
+      this.counters.opened++;
+      this.ready.push({ live, openedAt: Date.now(), detach });
+    };
+    // Dropped before or while idle in the pool.
+    const onDrop = () => {
+      if (!settled) {
+        fail();
+        return;
+      }
+      const index = this.ready.findIndex((s) => s.live === live);
+      if (index >= 0) {
+        this.ready.splice(index, 1);
+        detach();
+        this.pump();
+      }
+    };
+
+    live.on(LiveTranscriptionEvents.Open, onOpen);
+    live.on(LiveTranscriptionEvents.Error, onDrop);
+    live.on(LiveTranscriptionEvents.Close, onDrop);
+  }
+
+  private onFailure(): void {
+    this.counters.failed++;
+    this.failures++;
+    const delay = Math.min(MAX_BACKOFF_MS, 500 * 2 ** (this.failures - 1));
+    this.schedule(delay);
+  }
+}
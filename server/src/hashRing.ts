@@ -0,0 +1,67 @@
+import { createHash } from 'crypto';
+
+// Consistent-hash ring mapping session keys to relay gateways. Each node is
+// placed at VIRTUAL_NODES points so keys spread evenly, and adding or removing
+// a node only moves the keys that land on its points.
+
+const VIRTUAL_NODES = 128;
+
+function hash32(value: string): number {
+  return createHash('md5').update(value).digest().readUInt32BE(0);
+}
+
+export class HashRing {
+  private points: { hash: number; node: string }[] = [];
+  private readonly members = new Set<string>();
+
+  constructor(nodes: Iterable<string> = []) {
+    for (const node of nodes) this.add(node);
+  }
+
+  add(node: string): void {
+    if (this.members.has(node)) return;
+    this.members.add(node);
+    for (let i = 0; i < VIRTUAL_NODES; i++) {
+      this.points.push({ hash: hash32(`${node}#${i}`), node });
+    }
+    this.points.sort((a, b) => a.hash - b.hash || (a.node < b.node ? -1 : 1));
+  }
+
+  remove(node: string): void {
+    if (!this.members.delete(node)) return;
+    this.points = this.points.filter((point) => point.node !== node);
+  }
+
+  has(node: string): boolean {
+    return this.members.has(node);
+  }
+
+  nodes(): string[] {
+    return [...this.members];
+  }
+
+  // The owner of |key|, or null when the ring is empty.
+  lookup(key: string): string | null {
+    return this.preference(key, 1)[0] ?? null;
+  }
+
+  // Up to |count| distinct nodes in ring order from |key|: the owner first,
+  // then where the key would move if the nodes before failed.
+  preference(key: string, count: number): string[] {
+    const out: string[] = [];
+    if (this.points.length === 0) return out;
+    const target = hash32(key);
+    let lo = 0;
+    let hi = this.points.length;
+    while (lo < hi) {
+      const mid = (lo + hi) >>> 1;
+      if (this.points[mid].hash < target) lo = mid + 1;
+      else hi = mid;
+    }
+    for (let i = 0; i < this.points.length && out.length < count; i++) {
+      const node = this.points[(lo + i) % this.points.length].node;
+      if (!out.includes(node)) out.push(node);
+    }
+    return out;
+  }
+}
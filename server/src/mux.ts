@@ -0,0 +1,318 @@
+import { EventEmitter } from 'events';
+import { WebSocket, RawData } from 'ws';
+import { JWTPayload } from './auth.js';
+import { AdmissionTicket } from './admission.js';
+
+// Server side of the multiplexed client connection (/mux). The client is
+// windows/runner/mux_connection.cpp; the wire format is documented in
+// windows/runner/mux_protocol.h.
+//
+// One WebSocket carries the client's transcription session and AI requests as
+// logical streams. Each stream is handed to the existing /listen or /ai
+// handler as a MuxStream, which has the part of the ws WebSocket interface
+// those handlers use (send, close, readyState and the message and close
+// events), so a session behaves the same on its own socket and on the shared
+// one. Audio frames carry raw PCM and arrive as 'audio' events instead of
+// base64 JSON messages.
+//
+// Outgoing frames are queued per stream and written while the socket has less
+// than HIGH_WATER_BYTES unwritten: listen streams before AI streams, round
+// robin within each, and each only within its send window, which the client's
+// Credit frames reopen. Incoming bytes are credited back once the handler has
+// been given them, so a stream the server is slow to serve is throttled at the
+// client instead of queuing here.
+
+export type MuxStreamKind = 'listen' | 'ai';
+
+const FrameType = {
+  Open: 1,
+  Text: 2,
+  Audio: 3,
+  Credit: 4,
+  Close: 5,
+} as const;
+
+const HEADER_BYTES = 5;
+const INITIAL_WINDOW = 256 * 1024;
+const CREDIT_THRESHOLD = INITIAL_WINDOW / 2;
+const HIGH_WATER_BYTES = 64 * 1024;
+const MAX_STREAMS = 16;
+// A stream whose client stops returning credit is closed once this much is
+// queued for it.
+const MAX_QUEUED_BYTES = 4 * INITIAL_WINDOW;
+// Sent first: audio and transcripts, then AI tokens.
+const URGENCY: Record<MuxStreamKind, number> = { listen: 0, ai: 1 };
+const URGENCY_LEVELS = 2;
+const AUDIO_SOURCES = ['mic', 'system'] as const;
+
+export interface MuxStats {
+  connections: number;
+  streams: number;
+  framesSent: number;
+  framesReceived: number;
+  creditStalls: number;
+  slowStreamsClosed: number;
+}
+
+const counters = { framesSent: 0, framesReceived: 0, creditStalls: 0, slowStreamsClosed: 0 };
+const connections = new Set<MuxConnection>();
+
+export function muxStats(): MuxStats {
+  let streams = 0;
+  for (const connection of connections) streams += connection.streamCount();
+  return { connections: connections.size, streams, ...counters };
+}
+
+interface Queued {
+  frame: Buffer;
+  cost: number; // Payload bytes counted against the send window
+}
+
+export class MuxStream extends EventEmitter {
+  readyState: number = WebSocket.OPEN;
+  user?: JWTPayload;
+  token?: string;
+  admission?: AdmissionTicket;
+  priority?: number; // Admission priority, as on AuthenticatedWebSocket
+
+  // Owned by MuxConnection.
+  queue: Queued[] = [];
+  queuedBytes = 0;
+  sendWindow = INITIAL_WINDOW;
+  unacknowledged = 0;
+  stalled = false;
+  private held: { type: 'message' | 'audio'; args: unknown[] }[] | null = [];
+
+  constructor(
+    private readonly connection: MuxConnection,
+    readonly id: number,
+    readonly kind: MuxStreamKind,
+  ) {
+    super();
+  }
+
+  get urgency(): number {
+    return URGENCY[this.kind];
+  }
+
+  send(data: string | Buffer, cb?: (error?: Error) => void): void {
+    if (this.readyState !== WebSocket.OPEN) {
+      cb?.(new Error('stream closed'));
+      return;
+    }
+    const payload = typeof data === 'string' ? Buffer.from(data) : data;
+    this.connection.enqueue(this, frame(FrameType.Text, this.id, payload), payload.length);
+    cb?.();
+  }
+
+  close(code = 1000, reason = ''): void {
+    if (this.readyState !== WebSocket.OPEN) return;
+    this.readyState = WebSocket.CLOSING;
+    this.connection.enqueue(this, closeFrame(this.id, code, reason), 0);
+    this.ended(code, reason);
+  }
+
+  // Incoming messages wait until accept(), so nothing sent right after Open
+  // is lost while the handler is still being set up (e.g. in admission).
+  accept(): void {
+    const held = this.held;
+    this.held = null;
+    for (const event of held ?? []) this.deliver(event.type, event.args);
+  }
+
+  deliver(type: 'message' | 'audio', args: unknown[]): void {
+    if (this.readyState !== WebSocket.OPEN) return;
+    if (this.held) {
+      this.held.push({ type, args });
+      return;
+    }
+    this.emit(type, ...args);
+    const bytes = type === 'message' ? (args[0] as Buffer).length : 1 + (args[1] as Buffer).length;
+    this.connection.consumed(this, bytes);
+  }
+
+  ended(code: number, reason: string): void {
+    if (this.readyState === WebSocket.CLOSED) return;
+    this.readyState = WebSocket.CLOSED;
+    this.held = null;
+    process.nextTick(() => this.emit('close', code, Buffer.from(reason)));
+  }
+}
+
+export class MuxConnection {
+  private readonly streams = new Map<number, MuxStream>();
+  private readonly control: Buffer[] = [];
+  private readonly lastSent: number[] = new Array(URGENCY_LEVELS).fill(0);
+  private pumpScheduled = false;
+
+  constructor(
+    private readonly socket: WebSocket,
+    private readonly onOpen: (stream: MuxStream, open: Record<string, unknown>) => void,
+  ) {
+    connections.add(this);
+    socket.on('message', (data: RawData, isBinary: boolean) => {
+      if (!isBinary) return;
+      const buffer = Array.isArray(data) ? Buffer.concat(data) : Buffer.from(data as Buffer);
+      try {
+        this.onFrame(buffer);
+      } catch (error) {
+        console.error('[Mux] Error processing frame:', error);
+      }
+    });
+    socket.on('close', () => {
+      connections.delete(this);
+      for (const stream of this.streams.values()) stream.ended(1006, 'connection lost');
+      this.streams.clear();
+    });
+    socket.on('error', (error: Error) => console.error('[Mux] Socket error:', error.message));
+  }
+
+  streamCount(): number {
+    return this.streams.size;
+  }
+
+  enqueue(stream: MuxStream, data: Buffer, cost: number): void {
+    if (!this.streams.has(stream.id)) return;
+    if (stream.queuedBytes + cost > MAX_QUEUED_BYTES) {
+      // What is queued can never be delivered; the Close goes out at once.
+      counters.slowStreamsClosed++;
+      console.warn(`[Mux] Closing ${stream.kind} stream ${stream.id}: client stopped reading`);
+      this.streams.delete(stream.id);
+      stream.queue = [];
+      stream.queuedBytes = 0;
+      this.control.push(closeFrame(stream.id, 1013, 'slow reader'));
+      stream.ended(1013, 'slow reader');
+      this.schedulePump();
+      return;
+    }
+    stream.queue.push({ frame: data, cost });
+    stream.queuedBytes += cost;
+    this.schedulePump();
+  }
+
+  consumed(stream: MuxStream, bytes: number): void {
+    stream.unacknowledged += bytes;
+    if (stream.unacknowledged < CREDIT_THRESHOLD) return;
+    const payload = Buffer.alloc(4);
+    payload.writeUInt32LE(stream.unacknowledged, 0);
+    stream.unacknowledged = 0;
+    this.control.push(frame(FrameType.Credit, stream.id, payload));
+    this.schedulePump();
+  }
+
+  private onFrame(data: Buffer): void {
+    if (data.length < HEADER_BYTES) return;
+    counters.framesReceived++;
+    const type = data[0];
+    const id = data.readUInt32LE(1);
+    const payload = data.subarray(HEADER_BYTES);
+    const stream = this.streams.get(id);
+
+    switch (type) {
+      case FrameType.Open: {
+        let open: Record<string, unknown> = {};
+        try {
+          open = JSON.parse(payload.toString('utf8'));
+        } catch (_) {}
+        const kind = open?.kind === 'listen' || open?.kind === 'ai' ? (open.kind as MuxStreamKind) : null;
+        if (stream || id === 0 || !kind || this.streams.size >= MAX_STREAMS) {
+          this.refuse(id, stream ? 'duplicate stream' : 'cannot open stream');
+          return;
+        }
+        const created = new MuxStream(this, id, kind);
+        this.streams.set(id, created);
+        this.onOpen(created, open);
+        return;
+      }
+      case FrameType.Text:
+        stream?.deliver('message', [payload]);
+        return;
+      case FrameType.Audio:
+        if (payload.length > 1 && payload[0] < AUDIO_SOURCES.length) {
+          stream?.deliver('audio', [AUDIO_SOURCES[payload[0]], payload.subarray(1)]);
+        }
+        return;
+      case FrameType.Credit:
+        if (stream && payload.length >= 4) {
+          stream.sendWindow += payload.readUInt32LE(0);
+          this.schedulePump();
+        }
+        return;
+      case FrameType.Close:
+        if (!stream) return;
+        this.streams.delete(id);
+        stream.ended(payload.length >= 2 ? payload.readUInt16LE(0) : 1000, payload.subarray(2).toString('utf8'));
+        return;
+    }
+  }
+
+  private refuse(id: number, reason: string): void {
+    this.control.push(closeFrame(id, 1008, reason));
+    this.schedulePump();
+  }
+
+  private schedulePump(): void {
+    if (this.pumpScheduled) return;
+    this.pumpScheduled = true;
+    // One turn later, so frames queued together go out in priority order.
+    setImmediate(() => {
+      this.pumpScheduled = false;
+      this.pump();
+    });
+  }
+
+  private pump(): void {
+    while (this.socket.readyState === WebSocket.OPEN && this.socket.bufferedAmount < HIGH_WATER_BYTES) {
+      const next = this.nextFrame();
+      if (!next) return;
+      counters.framesSent++;
+      // Resumes once the socket has written this out, if it is still full.
+      this.socket.send(next, { binary: true }, () => {
+        if (this.socket.bufferedAmount < HIGH_WATER_BYTES) this.schedulePump();
+      });
+    }
+  }
+
+  private nextFrame(): Buffer | null {
+    const control = this.control.shift();
+    if (control) return control;
+    const ids = [...this.streams.keys()];
+    for (let urgency = 0; urgency < URGENCY_LEVELS; urgency++) {
+      // Round robin: start after the stream of this urgency that sent last.
+      const start = ids.findIndex((id) => id > this.lastSent[urgency]);
+      for (let n = 0; n < ids.length; n++) {
+        const stream = this.streams.get(ids[(Math.max(start, 0) + n) % ids.length])!;
+        if (stream.urgency !== urgency || stream.queue.length === 0) continue;
+        const head = stream.queue[0];
+        if (head.cost > 0 && stream.sendWindow <= 0) {
+          if (!stream.stalled) counters.creditStalls++;
+          stream.stalled = true;
+          continue;
+        }
+        stream.stalled = false;
+        stream.queue.shift();
+        stream.queuedBytes -= head.cost;
+        stream.sendWindow -= head.cost;
+        this.lastSent[urgency] = stream.id;
+        if (head.frame[0] === FrameType.Close) this.streams.delete(stream.id);
+        return head.frame;
+      }
+    }
+    return null;
+  }
+}
+
+function frame(type: number, stream: number, payload: Buffer): Buffer {
+  const out = Buffer.allocUnsafe(HEADER_BYTES + payload.length);
+  out[0] = type;
+  out.writeUInt32LE(stream >>> 0, 1);
+  payload.copy(out, HEADER_BYTES);
+  return out;
+}
+
+function closeFrame(stream: number, code: number, reason: string): Buffer {
+  const payload = Buffer.alloc(2 + Buffer.byteLength(reason));
+  payload.writeUInt16LE(code, 0);
+  payload.write(reason, 2);
+  return frame(FrameType.Close, stream, payload);
+}
@@ -0,0 +1,264 @@
+import 'dotenv/config';
+import { createServer, IncomingMessage, ServerResponse } from 'http';
+import { Socket } from 'net';
+import { timingSafeEqual } from 'crypto';
+import { WebSocketServer, WebSocket } from 'ws';
+import { createClient } from '@deepgram/sdk';
+import { AdmissionController, AdmissionTicket, PRIORITY_LOW, PRIORITY_NORMAL } from './admission.js';
+import { DeepgramPool } from './deepgramPool.js';
+import { DEEPGRAM_LIVE_OPTIONS, RelaySession, RelaySessionState } from './relaySession.js';
+
+// Relay gateway: runs /listen sessions for relayRouter.ts, which owns the
+// client sockets. Each routed session arrives as one WebSocket on /relay:
+// the router's first message is `relay_open` (with a snapshot when the
+// session is moving here from a draining node), then the client's own
+// messages follow unchanged. Events go back as binary frames of a 4-byte
+// big-endian sequence number followed by the JSON the client receives.
+//
+// Draining (SIGTERM or POST /drain) sends `relay_drain` on every link. The
+// router holds the client's messages from then on and answers `relay_fence`,
+// so once the fence arrives nothing is still in flight: the gateway
+// snapshots the session, hands the state over in `relay_migrate` and closes
+// the link, and the router resumes the session on another gateway while its
+// client stays connected. /healthz answers 503 from the start of a drain so
+// no new session lands here.
+//
+// Admission control (admission.ts) applies per gateway: a /relay upgrade it
+// refuses gets 503 with Retry-After, and /healthz also answers 503 while the
+// gateway would not admit a session at once, so the router sends new
+// sessions elsewhere. A session shed under overload gets an error event and
+// the link closes with 1013, which the router passes on to the client.
+//
+// Sharing and the datagram uplink need the client socket and stay with the
+// single-process server (server.ts).
+
+const PORT = Number(process.env.GATEWAY_PORT) || 3101;
+const GATEWAY_ID = process.env.GATEWAY_ID || `gateway-${PORT}`;
+const RELAY_SECRET = process.env.RELAY_SECRET || '';
+const DRAIN_TIMEOUT_MS = 10_000;
+// A router that has not answered relay_drain by then gets the snapshot
+// anyway; client messages it sends after that are lost.
+const FENCE_TIMEOUT_MS = 8_000;
+
+// DEEPGRAM_URL points the gateway at a stand-in upstream for local runs.
+const deepgram = createClient(
+  process.env.DEEPGRAM_API_KEY || '',
+  process.env.DEEPGRAM_URL ? { global: { url: process.env.DEEPGRAM_URL } } : {},
+);
+const deepgramPool = new DeepgramPool(() => deepgram.listen.live(DEEPGRAM_LIVE_OPTIONS), {
+  size: process.env.DEEPGRAM_API_KEY ? Number(process.env.DEEPGRAM_POOL_SIZE ?? 2) : 0,
+  maxOpensPerSecond: Number(process.env.DEEPGRAM_POOL_OPENS_PER_SECOND ?? 2),
+  burst: 2,
+  keepAliveMs: 5_000,
+  maxIdleMs: 5 * 60_000,
+  connectTimeoutMs: 10_000,
+});
+deepgramPool.start();
+
+const admission = new AdmissionController({
+  maxSessions: Number(process.env.ADMISSION_MAX_SESSIONS ?? 200),
+  cpuLimit: Number(process.env.ADMISSION_CPU_LIMIT ?? 0.85),
+  lagLimitMs: Number(process.env.ADMISSION_LAG_LIMIT_MS ?? 200),
+  queueMs: Number(process.env.ADMISSION_QUEUE_MS ?? 3_000),
+  maxQueued: 64,
+});
+admission.start();
+
+interface RoutedLink {
+  socket: WebSocket;
+  sessionKey: string;
+  session: RelaySession | null;
+  migrated: boolean;
+}
+
+const links = new Set<RoutedLink>();
+let draining = false;
+
+function isRelaySecret(value: string | undefined): boolean {
+  if (!RELAY_SECRET) return true; // Unset: trusted network only
+  const expected = Buffer.from(RELAY_SECRET);
+  const given = Buffer.from(value ?? '');
+  return given.length === expected.length && timingSafeEqual(given, expected);
+}
+
+function eventFrame(seq: number, payload: string): Buffer {
+  const body = Buffer.from(payload);
+  const frame = Buffer.allocUnsafe(4 + body.length);
+  frame.writeUInt32BE(seq >>> 0, 0);
+  body.copy(frame, 4);
+  return frame;
+}
+
+function openSession(link: RoutedLink, state: RelaySessionState | null): RelaySession {
+  const send = (payload: string, seq: number) => {
+    if (link.socket.readyState === WebSocket.OPEN) link.socket.send(eventFrame(seq, payload));
+  };
+  const options = {
+    openLive: () => deepgram.listen.live(DEEPGRAM_LIVE_OPTIONS),
+    pool: deepgramPool,
+    admission,
+    apiKeyConfigured: !!process.env.DEEPGRAM_API_KEY,
+    onEvent: send,
+    onError: send,
+  };
+  return state ? RelaySession.restore(state, options) : new RelaySession(options);
+}
+
+function onLinkMessage(link: RoutedLink, message: Buffer): void {
+  let data: any;
+  try {
+    data = JSON.parse(message.toString('utf8'));
+  } catch (_) {
+    return;
+  }
+
+  if (!link.session) {
+    if (data?.type !== 'relay_open') {
+      link.socket.close(4400, 'expected relay_open');
+      return;
+    }
+    link.session = openSession(link, data.state ?? null);
+    console.log(
+      `[RelayGateway] ${data.state ? 'Resumed' : 'Opened'} session ${link.sessionKey} on ${GATEWAY_ID}`,
+    );
+    return;
+  }
+
+  if (data.type === 'relay_fence') {
+    migrate(link);
+    return;
+  }
+  if (link.session.handleMessage(data)) return;
+  if (data.type === 'udp_offer') {
+    link.socket.send(eventFrame(0, JSON.stringify({ type: 'udp_unavailable' })));
+  } else if (data.type === 'share_start') {
+    link.socket.send(
+      eventFrame(0, JSON.stringify({ type: 'error', message: 'Sharing is not available on this server' })),
+    );
+  }
+}
+
+function migrate(link: RoutedLink): void {
+  if (link.migrated) return;
+  link.migrated = true;
+  // A link whose relay_open has not arrived yet has nothing to hand over.
+  const state = link.session?.snapshot() ?? null;
+  link.socket.send(JSON.stringify({ type: 'relay_migrate', from: GATEWAY_ID, state }), () =>
+    link.socket.close(1012, 'migrated'),
+  );
+}
+
+// Moves every session off this node. Resolves once all links are closed.
+function drain(): Promise<void> {
+  if (!draining) {
+    draining = true;
+    console.log(`[RelayGateway] Draining ${links.size} sessions from ${GATEWAY_ID}`);
+    for (const link of links) {
+      link.socket.send(JSON.stringify({ type: 'relay_drain' }));
+      setTimeout(() => migrate(link), FENCE_TIMEOUT_MS).unref();
+    }
+  }
+  return new Promise((resolve) => {
+    const started = Date.now();
+    const poll = () => {
+      if (links.size === 0 || Date.now() - started > DRAIN_TIMEOUT_MS) resolve();
+      else setTimeout(poll, 50);
+    };
+    poll();
+  });
+}
+
+const server = createServer((req: IncomingMessage, res: ServerResponse) => {
+  if (req.url === '/healthz') {
+    res.writeHead(draining || !admission.accepting() ? 503 : 200, { 'Content-Type': 'application/json' });
+    res.end(JSON.stringify({ id: GATEWAY_ID, draining, sessions: links.size, admission: admission.stats() }));
+    return;
+  }
+  if (req.url === '/drain' && req.method === 'POST') {
+    if (!isRelaySecret(req.headers['x-relay-secret'] as string | undefined)) {
+      res.writeHead(403).end();
+      return;
+    }
+    drain().then(() => res.writeHead(204).end());
+    return;
+  }
+  res.writeHead(404).end();
+});
+
+const wss = new WebSocketServer({ noServer: true });
+
+server.on('upgrade', (req: IncomingMessage, socket: Socket, head: Buffer) => {
+  const url = new URL(req.url ?? '', 'http://localhost');
+  const sessionKey = url.searchParams.get('session');
+  if (
+    url.pathname !== '/relay' ||
+    !sessionKey ||
+    draining ||
+    !isRelaySecret(req.headers['x-relay-secret'] as string | undefined)
+  ) {
+    socket.write(`HTTP/1.1 ${draining ? '503 Service Unavailable' : '403 Forbidden'}\r\n\r\n`);
+    socket.destroy();
+    return;
+  }
+  const priority = url.searchParams.get('priority') === 'low' ? PRIORITY_LOW : PRIORITY_NORMAL;
+  let admitted: RoutedLink | null = null;
+  const onShed = (retryAfterSec: number) => {
+    if (!admitted) {
+      socket.destroy();
+      return;
+    }
+    const message = { type: 'error', message: 'Server overloaded, please reconnect later', retryAfter: retryAfterSec };
+    admitted.socket.send(eventFrame(0, JSON.stringify(message)));
+    admitted.socket.close(1013, 'overloaded');
+  };
+  admission.admit(priority, onShed).then((result) => {
+    if (!result.admitted) {
+      socket.write(`HTTP/1.1 503 Service Unavailable\r\nRetry-After: ${result.retryAfterSec}\r\n\r\n`);
+      socket.destroy();
+      return;
+    }
+    if (socket.destroyed || draining) {
+      result.ticket.release();
+      socket.destroy();
+      return;
+    }
+    wss.handleUpgrade(req, socket, head, (ws: WebSocket) => {
+      admitted = acceptLink(ws, sessionKey, result.ticket);
+    });
+  });
+});
+
+function acceptLink(ws: WebSocket, sessionKey: string, ticket: AdmissionTicket): RoutedLink {
+  const link: RoutedLink = { socket: ws, sessionKey, session: null, migrated: false };
+  links.add(link);
+  ws.on('message', (message: Buffer) => {
+    try {
+      onLinkMessage(link, message);
+    } catch (error) {
+      console.error('[RelayGateway] Error processing message:', error);
+    }
+  });
+  ws.on('close', () => {
+    links.delete(link);
+    link.session?.close();
+    ticket.release();
+  });
+  ws.on('error', (error: Error) => {
+    console.error('[RelayGateway] Link error:', error);
+  });
+  return link;
+}
+
+server.listen(PORT, () => {
+  console.log(`[RelayGateway] ${GATEWAY_ID} listening on port ${PORT}`);
+  if (!RELAY_SECRET) console.warn('WARNING: RELAY_SECRET not set; /relay accepts any caller');
+});
+
+const shutdown = async () => {
+  await drain();
+  admission.close();
+  deepgramPool.close();
+  process.exit(0);
+};
+process.on('SIGINT', shutdown);
+process.on('SIGTERM', shutdown);
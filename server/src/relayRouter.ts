@@ -0,0 +1,290 @@
+import 'dotenv/config';
+import { createServer, get, IncomingMessage, ServerResponse } from 'http';
+import { Socket } from 'net';
+import { randomBytes, timingSafeEqual } from 'crypto';
+import { WebSocketServer, WebSocket, RawData } from 'ws';
+import { verifyToken, JWTPayload } from './auth.js';
+import { HashRing } from './hashRing.js';
+import { RelaySessionState } from './relaySession.js';
+
+// Front router of the scaled-out relay. Clients connect to /listen here
+// exactly as to server.ts; each session is consistently hashed (by the
+// `session` query parameter, or a random key) to one of the gateways in
+// RELAY_GATEWAYS and proxied over a /relay link (protocol in relayGateway.ts).
+//
+// A session stays on its gateway until that gateway drains: the router then
+// holds the client's messages, fences the link, receives the session's
+// snapshot and opens a link to the next gateway on the ring with it, so the
+// client keeps its socket and sees no gap. Events are forwarded in sequence
+// order and anything at or below the last forwarded sequence number is
+// dropped. If a gateway dies without draining, the session restarts on the
+// next gateway without its in-flight speech.
+//
+// Gateways are health-checked every HEALTH_INTERVAL_MS; one that is down,
+// draining or not admitting sessions leaves the ring until it answers again.
+// A gateway that refuses a link (503) is skipped; when every gateway has,
+// the client gets an error with the longest Retry-After they gave and close
+// 1013. A session a gateway sheds under overload closes the same way.
+
+const PORT = Number(process.env.RELAY_PORT) || 3100;
+const RELAY_SECRET = process.env.RELAY_SECRET || '';
+const HEALTH_INTERVAL_MS = 1_000;
+// Missed health checks before a gateway leaves the ring; a draining gateway
+// (503) leaves at once.
+const HEALTH_MISSES_DOWN = 2;
+const CONNECT_TIMEOUT_MS = 5_000;
+// Client messages held while the session has no gateway link.
+const MAX_PENDING_BYTES = 4 * 1024 * 1024;
+
+// RELAY_GATEWAYS=a=ws://10.0.0.1:3101,b=ws://10.0.0.2:3101
+const gateways = new Map<string, string>();
+for (const entry of (process.env.RELAY_GATEWAYS ?? '').split(',')) {
+  const [id, url] = entry.trim().split('=');
+  if (id && url) gateways.set(id, url.replace(/\/+$/, ''));
+}
+
+const ring = new HashRing();
+const counters = { sessions: 0, migrations: 0, failovers: 0, droppedPending: 0 };
+const healthMisses = new Map<string, number>();
+
+function checkHealth(): void {
+  for (const [id, url] of gateways) {
+    const request = get(`${url.replace(/^ws/, 'http')}/healthz`, { timeout: HEALTH_INTERVAL_MS }, (res) => {
+      res.resume();
+      if (res.statusCode === 200) {
+        healthMisses.set(id, 0);
+        if (!ring.has(id)) console.log(`[RelayRouter] Gateway ${id} joined`);
+        ring.add(id);
+      } else {
+        markDown(id);
+      }
+    });
+    request.on('timeout', () => request.destroy());
+    request.on('error', () => {
+      const misses = (healthMisses.get(id) ?? 0) + 1;
+      healthMisses.set(id, misses);
+      if (misses >= HEALTH_MISSES_DOWN) markDown(id);
+    });
+  }
+}
+
+// Session keys are only listed to callers holding RELAY_SECRET; with it
+// unset they are never listed.
+function isRelaySecret(value: string | undefined): boolean {
+  if (!RELAY_SECRET) return false;
+  const expected = Buffer.from(RELAY_SECRET);
+  const given = Buffer.from(value ?? '');
+  return given.length === expected.length && timingSafeEqual(given, expected);
+}
+
+function markDown(id: string): void {
+  if (!ring.has(id)) return;
+  console.log(`[RelayRouter] Gateway ${id} left`);
+  ring.remove(id);
+}
+
+class RoutedSession {
+  private link: WebSocket | null = null;
+  private node: string | null = null;
+  private pending: { data: RawData; binary: boolean }[] = [];
+  private pendingBytes = 0;
+  private lastSeq = 0;
+  private holding = false; // Between relay_drain and the next link opening
+  private closed = false;
+  private retryAfterSec = 0; // Longest Retry-After from a refusing gateway
+
+  constructor(
+    private readonly client: WebSocket,
+    private readonly key: string,
+    private readonly user: JWTPayload | undefined,
+    private readonly priority: string | null,
+  ) {
+    client.on('message', (data: RawData, binary: boolean) => this.fromClient(data, binary));
+    client.on('close', () => this.close());
+    client.on('error', (error: Error) => console.error('[RelayRouter] Client error:', error));
+    this.connect(null, []);
+  }
+
+  private fromClient(data: RawData, binary: boolean): void {
+    if (!this.holding && this.link?.readyState === WebSocket.OPEN) {
+      this.link.send(data, { binary });
+      return;
+    }
+    const size = Array.isArray(data) ? data.reduce((n, b) => n + b.length, 0) : data.byteLength;
+    this.pending.push({ data, binary });
+    this.pendingBytes += size;
+    while (this.pendingBytes > MAX_PENDING_BYTES && this.pending.length > 1) {
+      const dropped = this.pending.shift()!;
+      this.pendingBytes -= Array.isArray(dropped.data)
+        ? dropped.data.reduce((n, b) => n + b.length, 0)
+        : dropped.data.byteLength;
+      counters.droppedPending++;
+    }
+  }
+
+  // Opens a link to the session's owner, skipping |avoid|; |state| resumes a
+  // migrated session.
+  private connect(state: RelaySessionState | null, avoid: string[]): void {
+    if (this.closed) return;
+    // Gateways outside the ring are a last resort: a missed health check
+    // should not end the session.
+    const candidates = [...ring.preference(this.key, ring.nodes().length), ...gateways.keys()];
+    const node = candidates.find((id) => !avoid.includes(id));
+    // A session started afresh numbers its events from 1 again.
+    if (!state) this.lastSeq = 0;
+    if (!node) {
+      const retryAfter = this.retryAfterSec || undefined;
+      this.client.send(JSON.stringify({ type: 'error', message: 'No relay gateway available', retryAfter }));
+      this.client.close(1013, 'no gateway');
+      return;
+    }
+
+    let url = `${gateways.get(node)}/relay?session=${encodeURIComponent(this.key)}`;
+    if (this.priority) url += `&priority=${encodeURIComponent(this.priority)}`;
+    const link = new WebSocket(url, {
+      headers: { 'x-relay-secret': RELAY_SECRET },
+      handshakeTimeout: CONNECT_TIMEOUT_MS,
+    });
+    this.link = link;
+    this.node = node;
+    let opened = false;
+
+    link.on('open', () => {
+      opened = true;
+      this.holding = false;
+      link.send(JSON.stringify({ type: 'relay_open', user: this.user, state }));
+      for (const message of this.pending) link.send(message.data, { binary: message.binary });
+      this.pending = [];
+      this.pendingBytes = 0;
+    });
+    link.on('message', (data: RawData, binary: boolean) => {
+      if (this.link !== link) return;
+      if (binary) this.fromGateway(data as Buffer);
+      else this.onControl(node, data.toString());
+    });
+    link.on('unexpected-response', (_req: unknown, res: IncomingMessage) => {
+      const retryAfter = Number(res.headers['retry-after']);
+      if (Number.isFinite(retryAfter)) this.retryAfterSec = Math.max(this.retryAfterSec, retryAfter);
+      res.resume();
+      link.terminate(); // Closes as a link that never opened
+    });
+    link.on('close', (code: number) => {
+      if (this.link !== link || this.closed) return;
+      if (code === 1013) {
+        // Shed by the gateway; its error event has been forwarded.
+        this.link = null;
+        this.client.close(1013, 'overloaded');
+        return;
+      }
+      // Closed without handing the session over: start it again elsewhere.
+      // A link that never opened lost nothing, so a migration carries on.
+      this.link = null;
+      if (opened) {
+        counters.failovers++;
+        console.warn(`[RelayRouter] Lost gateway ${node} for session ${this.key}`);
+      } else {
+        console.warn(`[RelayRouter] Could not reach gateway ${node} for session ${this.key}`);
+      }
+      this.connect(opened ? null : state, [...avoid, node]);
+    });
+    link.on('error', (error: Error) => {
+      console.error(`[RelayRouter] Link to ${node} failed:`, error.message);
+    });
+  }
+
+  private fromGateway(frame: Buffer): void {
+    if (frame.length < 4) return;
+    const seq = frame.readUInt32BE(0);
+    // Sequence 0 marks replies outside the event stream.
+    if (seq !== 0) {
+      if (seq <= this.lastSeq) return;
+      this.lastSeq = seq;
+    }
+    if (this.client.readyState === WebSocket.OPEN) {
+      this.client.send(frame.subarray(4), { binary: false });
+    }
+  }
+
+  private onControl(node: string, text: string): void {
+    let data: any;
+    try {
+      data = JSON.parse(text);
+    } catch (_) {
+      return;
+    }
+    if (data?.type === 'relay_drain') {
+      // Hold the client's messages; the fence tells the gateway that
+      // everything before it has been sent.
+      markDown(node);
+      this.holding = true;
+      this.link?.send(JSON.stringify({ type: 'relay_fence' }));
+      return;
+    }
+    if (data?.type !== 'relay_migrate') return;
+    // The gateway is draining: take it out of the ring and move on with the
+    // state it handed over. Its close that follows is expected.
+    markDown(node);
+    counters.migrations++;
+    console.log(`[RelayRouter] Migrating session ${this.key} off ${node}`);
+    this.link = null;
+    this.connect(data.state ?? null, [node]);
+  }
+
+  private close(): void {
+    this.closed = true;
+    this.pending = [];
+    const link = this.link;
+    this.link = null;
+    link?.close(1000, 'client closed');
+  }
+
+  describe(): { key: string; node: string | null; lastSeq: number } {
+    return { key: this.key, node: this.node, lastSeq: this.lastSeq };
+  }
+}
+
+const sessions = new Set<RoutedSession>();
+
+const server = createServer((req: IncomingMessage, res: ServerResponse) => {
+  if (req.url === '/health') {
+    const routes = isRelaySecret(req.headers['x-relay-secret'] as string | undefined)
+      ? [...sessions].map((session) => session.describe())
+      : undefined;
+    res.writeHead(200, { 'Content-Type': 'application/json' });
+    res.end(JSON.stringify({ gateways: ring.nodes(), active: sessions.size, ...counters, routes }));
+    return;
+  }
+  res.writeHead(404).end();
+});
+
+const wss = new WebSocketServer({ noServer: true });
+
+server.on('upgrade', (req: IncomingMessage, socket: Socket, head: Buffer) => {
+  const url = new URL(req.url ?? '', 'http://localhost');
+  const token = url.searchParams.get('token') || req.headers.authorization?.replace('Bearer ', '');
+  const user = token ? verifyToken(token) : null;
+  if (!user) {
+    socket.write('HTTP/1.1 401 Unauthorized\r\n\r\n');
+    socket.destroy();
+    return;
+  }
+  if (url.pathname !== '/listen') {
+    socket.destroy();
+    return;
+  }
+  const key = url.searchParams.get('session') || randomBytes(12).toString('base64url');
+  wss.handleUpgrade(req, socket, head, (ws: WebSocket) => {
+    counters.sessions++;
+    const session = new RoutedSession(ws, key, user, url.searchParams.get('priority'));
+    sessions.add(session);
+    ws.on('close', () => sessions.delete(session));
+  });
+});
+
+checkHealth();
+setInterval(checkHealth, HEALTH_INTERVAL_MS).unref();
+
+server.listen(PORT, () => {
+  console.log(`[RelayRouter] Listening on port ${PORT} for ${gateways.size} gateways`);
+  if (gateways.size === 0) console.warn('WARNING: RELAY_GATEWAYS is empty');
+});
@@ -0,0 +1,366 @@
+import { LiveTranscriptionEvents } from '@deepgram/sdk';
+import { AdmissionController } from './admission.js';
+import { DeepgramPool } from './deepgramPool.js';
+import { HubEvent } from './transcriptHub.js';
+
+// One /listen client's transcription state: a Deepgram live session per
+// source, the events sent back, and enough recent audio to move the session
+// to another process. Used directly by server.ts and, in the scaled-out
+// relay, by relayGateway.ts behind relayRouter.ts.
+//
+// Every event gets the next sequence number. Each source keeps the audio
+// sent since its last final result (capped at REPLAY_MAX_BYTES); snapshot()
+// stops the session and returns that state, and RelaySession.restore() opens
+// new upstreams elsewhere and replays it, so speech that was in flight is
+// transcribed again rather than lost and nothing already final repeats.
+
+export type RelaySource = 'mic' | 'system';
+
+export const DEEPGRAM_LIVE_OPTIONS = {
+  model: 'nova-3',
+  language: 'en',
+  smart_format: true,
+  punctuate: true,
+  interim_results: true,
+  encoding: 'linear16',
+  sample_rate: 16000,
+};
+
+const BYTES_PER_SECOND = 16000 * 2; // linear16 mono at 16 kHz
+const REPLAY_MAX_BYTES = 30 * BYTES_PER_SECOND;
+// Deepgram closes a stream after ~10 s without audio. Clients send nothing
+// while their wake detector sleeps or the mic is a copy of system audio, so
+// every open stream checks once a second and sends KeepAlive after 5 s of
+// upstream silence.
+const KEEPALIVE_MS = 5_000;
+const KEEPALIVE_CHECK_MS = 1_000;
+const SOURCES: RelaySource[] = ['mic', 'system'];
+
+// What a migrating session carries; plain JSON.
+export interface RelaySessionState {
+  version: 1;
+  seq: number; // Last event sequence number sent
+  sources: Partial<Record<RelaySource, RelaySourceState>>;
+}
+
+export interface RelaySourceState {
+  // The upstream being replaced, for logs and support requests.
+  upstream: { requestId: string | null; openedAt: number; fromPool: boolean };
+  replayOffset: number; // Bytes of this source's audio before the replay
+  replay: string; // Base64 linear16 audio since the last final result
+}
+
+export interface RelaySessionOptions {
+  openLive: () => any;
+  pool?: DeepgramPool | null;
+  // Drops interim results and silent audio while the process is overloaded.
+  admission?: AdmissionController | null;
+  apiKeyConfigured: boolean;
+  // Transcript and status events (shared with followers by server.ts).
+  onEvent: (payload: string, seq: number, hubEvent?: HubEvent) => void;
+  // Errors for the client only.
+  onError: (payload: string, seq: number) => void;
+}
+
+interface SourceStream {
+  live: any;
+  detach: () => void;
+  requestId: string | null;
+  openedAt: number;
+  fromPool: boolean;
+  // Absolute offset of the audio the current upstream saw first.
+  upstreamOffset: number;
+  lastSentAt: number; // Audio or KeepAlive
+  keepAliveTimer: NodeJS.Timeout | null;
+  replay: Buffer[];
+  replayOffset: number;
+  replayBytes: number;
+}
+
+export class RelaySession {
+  private seq = 0;
+  private closed = false;
+  private readonly streams: Partial<Record<RelaySource, SourceStream>> = {};
+  // Audio offsets survive a restart of the upstream within the session.
+  private readonly sentBytes: Record<RelaySource, number> = { mic: 0, system: 0 };
+
+  constructor(private readonly options: RelaySessionOptions) {}
+
+  // Continues a snapshot taken on another node.
+  static restore(state: RelaySessionState, options: RelaySessionOptions): RelaySession {
+    const session = new RelaySession(options);
+    session.seq = state.seq;
+    for (const source of SOURCES) {
+      const saved = state.sources[source];
+      if (!saved) continue;
+      const replay = Buffer.from(saved.replay, 'base64');
+      session.sentBytes[source] = saved.replayOffset;
+      const stream = session.open(source, saved.replayOffset, true);
+      console.log(
+        `[RelaySession] Resuming ${source} (was request ${saved.upstream.requestId ?? 'unknown'}), ` +
+          `replaying ${replay.length} bytes`,
+      );
+      if (stream && replay.length > 0) session.forwardAudio(source, replay);
+    }
+    return session;
+  }
+
+  get lastSeq(): number {
+    return this.seq;
+  }
+
+  // Handles start/audio/finalize/stop; false for any other message type.
+  handleMessage(data: any): boolean {
+    if (data.type === 'start') {
+      if (!this.requireApiKey()) return true;
+      // Initialize Deepgram live connections (mic + system)
+      console.log('Starting Deepgram connections (mic + system)...');
+      try {
+        for (const source of SOURCES) this.finish(source);
+        for (const source of SOURCES) this.open(source, this.sentBytes[source], false);
+      } catch (error: any) {
+        console.error('Failed to start Deepgram connection:', error);
+        this.sendError('Failed to connect to Deepgram: ' + (error.message || 'Unknown error'));
+        for (const source of SOURCES) this.finish(source);
+      }
+      return true;
+    }
+    if (data.type === 'audio') {
+      // Validate and normalize source - must be exactly 'system' or 'mic'
+      const receivedSource = String(data.source || '').toLowerCase().trim();
+      if (receivedSource !== 'system' && receivedSource !== 'mic') {
+        console.error(`[ERROR] Invalid source received: "${data.source}", rejecting audio`);
+        return true;
+      }
+      this.forwardAudio(receivedSource, Buffer.from(data.audio, 'base64'));
+      return true;
+    }
+    if (data.type === 'finalize') {
+      if (data.source === 'system' || data.source === 'mic') this.finalize(data.source);
+      return true;
+    }
+    if (data.type === 'stop') {
+      console.log('Stopping transcription (mic + system)...');
+      for (const source of SOURCES) this.finish(source);
+      this.sendEvent({ type: 'status', message: 'stopped' });
+      return true;
+    }
+    return false;
+  }
+
+  // The client's endpointer saw the utterance end: have Deepgram flush its
+  // pending speech as a final now instead of at its own endpoint. Over the
+  // datagram uplink this comes in-band, after the utterance's audio.
+  finalize(source: RelaySource): void {
+    try {
+      this.streams[source]?.live.finalize();
+    } catch (error: any) {
+      console.error(`[ERROR] Error finalizing ${source} transcript:`, error);
+    }
+  }
+
+  // Sends client audio to the per-source Deepgram session, starting it if
+  // needed. Shared by WebSocket `audio` messages and the datagram uplink.
+  forwardAudio(source: RelaySource, audio: Buffer): void {
+    if (this.closed) return;
+    let stream = this.streams[source];
+    if (!stream) {
+      console.log(`[DEBUG] Auto-initializing ${source} connection (audio received before start)`);
+      if (!this.requireApiKey()) return;
+      try {
+        stream = this.open(source, this.sentBytes[source], false) ?? undefined;
+      } catch (error: any) {
+        console.error(`Failed to auto-start Deepgram ${source} connection:`, error);
+        this.sendError(
+          `Failed to initialize ${source} transcription: ` + (error.message || 'Unknown error'),
+        );
+        return;
+      }
+      if (!stream) return;
+    }
+
+    // Offsets count only audio the upstream was sent, so dropped silence does
+    // not shift result times against the replay.
+    // The keepalive timer covers the upstream while silence is dropped.
+    if (this.options.admission?.dropSilence(audio)) return;
+    try {
+      stream.live.send(audio);
+      stream.lastSentAt = Date.now();
+    } catch (error: any) {
+      console.error(`[ERROR] Error sending audio to Deepgram (${source}):`, error);
+      this.sendError('Error processing audio');
+      return;
+    }
+    this.sentBytes[source] += audio.length;
+    stream.replay.push(audio);
+    stream.replayBytes += audio.length;
+    while (stream.replayBytes > REPLAY_MAX_BYTES && stream.replay.length > 1) {
+      const dropped = stream.replay.shift()!;
+      stream.replayBytes -= dropped.length;
+      stream.replayOffset += dropped.length;
+    }
+  }
+
+  // Stops the session and returns what another node needs to continue it.
+  // Events the upstreams produce after this are dropped; their audio is in
+  // the replay.
+  snapshot(): RelaySessionState {
+    const state: RelaySessionState = { version: 1, seq: this.seq, sources: {} };
+    for (const source of SOURCES) {
+      const stream = this.streams[source];
+      if (!stream) continue;
+      state.sources[source] = {
+        upstream: {
+          requestId: stream.requestId,
+          openedAt: stream.openedAt,
+          fromPool: stream.fromPool,
+        },
+        replayOffset: stream.replayOffset,
+        replay: Buffer.concat(stream.replay).toString('base64'),
+      };
+    }
+    this.close();
+    return state;
+  }
+
+  close(): void {
+    this.closed = true;
+    for (const source of SOURCES) this.finish(source, true);
+  }
+
+  private open(source: RelaySource, offset: number, resumed: boolean): SourceStream | null {
+    if (this.closed) return null;
+    const warm = this.options.pool?.acquire() ?? null;
+    const live = warm ?? this.options.openLive();
+    const stream: SourceStream = {
+      live,
+      detach: () => {},
+      requestId: null,
+      openedAt: Date.now(),
+      fromPool: warm !== null,
+      upstreamOffset: offset,
+      lastSentAt: Date.now(),
+      keepAliveTimer: null,
+      replay: [],
+      replayOffset: offset,
+      replayBytes: 0,
+    };
+
+    const onOpen = () => {
+      console.log(`Deepgram connection opened (${source}${warm ? ', from pool' : ''})`);
+      // A resumed session told its client it was ready on the first node.
+      if (!resumed) this.sendEvent({ type: 'status', message: `ready:${source}` });
+    };
+
+    const onTranscript = (data: any) => {
+      stream.requestId = data.metadata?.request_id ?? stream.requestId;
+      if (data.is_final === true) this.trimReplay(stream, data);
+      const transcript = data.channel?.alternatives?.[0]?.transcript;
+      if (transcript) {
+        const isFinal = data.is_final === true;
+        const isInterim = data.is_final === false;
+        if (isInterim && this.options.admission?.dropInterim()) return;
+        console.log(`[DEBUG] Sending transcript from ${source} connection: "${transcript.substring(0, 50)}..."`);
+        this.sendEvent(
+          {
+            type: 'transcript',
+            source,
+            text: transcript,
+            is_final: isFinal,
+            is_interim: isInterim,
+            confidence: data.channel.alternatives[0].confidence || 0,
+          },
+          { source, interim: !isFinal },
+        );
+      }
+    };
+
+    const onError = (error: any) => {
+      console.error(`Deepgram error (${source}):`, error);
+      this.sendError(error.message || `Deepgram error (${source})`);
+    };
+
+    const onClose = () => {
+      console.log(`Deepgram connection closed (${source})`);
+      this.stopKeepAlive(stream);
+      if (this.streams[source] === stream) delete this.streams[source];
+    };
+
+    if (warm) {
+      // Already open; the Open event has fired.
+      onOpen();
+    } else {
+      live.on(LiveTranscriptionEvents.Open, onOpen);
+    }
+    live.on(LiveTranscriptionEvents.Transcript, onTranscript);
+    live.on(LiveTranscriptionEvents.Error, onError);
+    live.on(LiveTranscriptionEvents.Close, onClose);
+    stream.keepAliveTimer = setInterval(() => {
+      if (Date.now() - stream.lastSentAt < KEEPALIVE_MS) return;
+      stream.lastSentAt = Date.now();
+      try {
+        live.keepAlive();
+      } catch (_) {}
+    }, KEEPALIVE_CHECK_MS);
+    stream.keepAliveTimer.unref();
+    stream.detach = () => {
+      live.removeListener(LiveTranscriptionEvents.Open, onOpen);
+      live.removeListener(LiveTranscriptionEvents.Transcript, onTranscript);
+      live.removeListener(LiveTranscriptionEvents.Error, onError);
+      live.removeListener(LiveTranscriptionEvents.Close, onClose);
+    };
+    this.streams[source] = stream;
+    return stream;
+  }
+
+  // Ends the source's upstream. Results it still flushes reach the client
+  // unless |detach| is set, as it is once the session is closed.
+  private finish(source: RelaySource, detach = false): void {
+    const stream = this.streams[source];
+    if (!stream) return;
+    delete this.streams[source];
+    this.stopKeepAlive(stream);
+    if (detach) stream.detach();
+    try {
+      stream.live.finish();
+    } catch (_) {}
+  }
+
+  private stopKeepAlive(stream: SourceStream): void {
+    if (stream.keepAliveTimer) clearInterval(stream.keepAliveTimer);
+    stream.keepAliveTimer = null;
+  }
+
+  // Drops replay audio a final result has covered. Result times count from
+  // the start of the upstream's own stream.
+  private trimReplay(stream: SourceStream, data: any): void {
+    const end = Number(data.start) + Number(data.duration);
+    if (!Number.isFinite(end)) return;
+    const covered = stream.upstreamOffset + Math.floor((end * BYTES_PER_SECOND) / 2) * 2;
+    while (stream.replay.length > 0 && stream.replayOffset < covered) {
+      const head = stream.replay[0];
+      const cut = Math.min(head.length, covered - stream.replayOffset);
+      if (cut === head.length) stream.replay.shift();
+      else stream.replay[0] = head.subarray(cut);
+      stream.replayBytes -= cut;
+      stream.replayOffset += cut;
+    }
+  }
+
+  private requireApiKey(): boolean {
+    if (this.options.apiKeyConfigured) return true;
+    console.error('Deepgram API key not configured');
+    this.sendError(
+      'Server error: Deepgram API key not configured. Please set DEEPGRAM_API_KEY in .env file',
+    );
+    return false;
+  }
+
+  private sendEvent(event: Record<string, unknown>, hubEvent?: HubEvent): void {
+    this.options.onEvent(JSON.stringify(event), ++this.seq, hubEvent);
+  }
+
+  private sendError(message: string): void {
+    this.options.onError(JSON.stringify({ type: 'error', message }), ++this.seq);
+  }
+}
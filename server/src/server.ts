@@ -1,6 +1,6 @@
 import express, { Request, Response } from 'express';
 import { WebSocketServer, WebSocket } from 'ws';
-import { createClient, LiveTranscriptionEvents } from '@deepgram/sdk';
+import { createClient } from '@deepgram/sdk';
 import OpenAI from 'openai';
 import dotenv from 'dotenv';
 import cors from 'cors';
@@ -15,6 +15,7 @@ import {
   createMeetingSession,
   getMeetingSession,
   updateMeetingSession,
+  applyMeetingSessionDelta,
   listMeetingSessions,
   deleteMeetingSession,
   getModeConfigs,
@@ -30,6 +31,13 @@ import {
   getUserApiUsageStats,
   MeetingSession,
 } from './database.js';
+import { decodeSessionDelta, SessionDelta } from './sessionSync.js';
+import { DeepgramPool } from './deepgramPool.js';
+import { AdmissionController, PRIORITY_LOW, PRIORITY_NORMAL, PRIORITY_SHARED } from './admission.js';
+import { DEEPGRAM_LIVE_OPTIONS, RelaySession } from './relaySession.js';
+import { UdpAudioReceiver } from './udpAudio.js';
+import { TranscriptHub } from './transcriptHub.js';
+import { MuxConnection, MuxStream, muxStats } from './mux.js';
 import { fileURLToPath } from 'url';
 import { dirname, join } from 'path';
 import fs from 'fs';
@@ -80,7 +88,7 @@ app.use(express.static(publicDir));
 
 // Health check endpoint
 app.get('/health', (_req: Request, res: Response) => {
-  res.json({ status: 'ok', message: 'HearNow backend is running' });
+  res.json({ status: 'ok', message: 'HearNow backend is running', deepgramPool: deepgramPool.stats(), admission: admission.stats(), udpAudio: udpAudio?.stats() ?? null, transcriptHub: transcriptHub.stats(), mux: muxStats() });
 });
 
 // Authentication routes
@@ -106,6 +114,7 @@ app.post('/api/sessions', authenticate, async (req: AuthRequest, res: Response)
         text: String(b.text ?? ''),
         timestamp: new Date(b.timestamp),
         isDraft: Boolean(b.isDraft ?? false),
+        ...(Number.isInteger(b.speakerId) ? { speakerId: Number(b.speakerId) } : {}),
       })) : [],
       summary: summary ? String(summary) : null,
       insights: insights ? String(insights) : null,
@@ -190,6 +199,7 @@ app.put('/api/sessions/:id', authenticate, async (req: AuthRequest, res: Respons
           text: String(b.text ?? ''),
           timestamp: new Date(b.timestamp),
           isDraft: Boolean(b.isDraft ?? false),
+          ...(Number.isInteger(b.speakerId) ? { speakerId: Number(b.speakerId) } : {}),
         })) : [],
         summary: summary ? String(summary) : null,
         insights: insights ? String(insights) : null,
@@ -213,6 +223,7 @@ app.put('/api/sessions/:id', authenticate, async (req: AuthRequest, res: Respons
         text: String(b.text ?? ''),
         timestamp: new Date(b.timestamp),
         isDraft: Boolean(b.isDraft ?? false),
+        ...(Number.isInteger(b.speakerId) ? { speakerId: Number(b.speakerId) } : {}),
       })) : [];
     }
     if (summary !== undefined) updates.summary = summary ? String(summary) : null;
@@ -221,8 +232,7 @@ app.put('/api/sessions/:id', authenticate, async (req: AuthRequest, res: Respons
     if (modeKey !== undefined) updates.modeKey = modeKey ? String(modeKey) : 'general';
     else if (mode !== undefined) updates.modeKey = mode ? String(mode) : 'general'; // Support both 'mode' and 'modeKey' for backward compatibility
     if (metadata !== undefined) updates.metadata = metadata && typeof metadata === 'object' ? metadata : {};
-
-    const success = await updateMeetingSession(sessionId, userId, updates);
+    const success = await updateMeetingSession(sessionId, userId, updates, true);
     if (!success) {
       return res.status(404).json({ error: 'Session not found' });
     }
@@ -237,6 +247,44 @@ app.put('/api/sessions/:id', authenticate, async (req: AuthRequest, res: Respons
   }
 });
 
+// Incremental save: body is a compressed binary delta (see sessionSync.ts).
+app.patch(
+  '/api/sessions/:id/delta',
+  authenticate,
+  express.raw({ type: 'application/octet-stream', limit: '4mb' }),
+  async (req: AuthRequest, res: Response) => {
+    try {
+      const userId = req.user!.userId;
+      const sessionId = req.params.id;
+      if (!/^[0-9a-fA-F]{24}$/.test(sessionId)) {
+        return res.status(400).json({ error: 'Invalid session id' });
+      }
+      if (!Buffer.isBuffer(req.body) || req.body.length === 0) {
+        return res.status(400).json({ error: 'Missing session delta' });
+      }
+
+      let delta: SessionDelta;
+      try {
+        delta = decodeSessionDelta(req.body);
+      } catch (error: any) {
+        return res.status(400).json({ error: error.message || 'Invalid session delta' });
+      }
+
+      const outcome = await applyMeetingSessionDelta(sessionId, userId, delta);
+      if (outcome === 'not_found') {
+        return res.status(404).json({ error: 'Session not found' });
+      }
+      if (outcome === 'conflict') {
+        return res.status(409).json({ error: 'Session version mismatch' });
+      }
+      res.json({ id: sessionId, syncVersion: delta.newVersion });
+    } catch (error: any) {
+      console.error('Error applying session delta:', error);
+      res.status(500).json({ error: error.message || 'Failed to apply session delta' });
+    }
+  }
+);
+
 app.delete('/api/sessions/:id', authenticate, async (req: AuthRequest, res: Response) => {
   try {
     const userId = req.user!.userId;
@@ -609,10 +657,16 @@ const server = createServer(app);
 // can coexist safely on the same HTTP server).
 const wss = new WebSocketServer({ noServer: true });
 const aiWss = new WebSocketServer({ noServer: true });
+const followWss = new WebSocketServer({ noServer: true });
+const muxWss = new WebSocketServer({ noServer: true });
+
+// Live transcript fan-out from a shared /listen session to /follow sockets.
+const transcriptHub = new TranscriptHub();
 
 // Extend IncomingMessage to include user
 interface AuthenticatedIncomingMessage extends IncomingMessage {
   user?: JWTPayload;
+  token?: string;
 }
 
 server.on('upgrade', (req: AuthenticatedIncomingMessage, socket: Socket, head: Buffer) => {
@@ -638,6 +692,7 @@ server.on('upgrade', (req: AuthenticatedIncomingMessage, socket: Socket, head: B
         return;
       }
       req.user = decoded;
+      req.token = token;
     } else {
       // Require authentication for WebSocket connections
       socket.write('HTTP/1.1 401 Unauthorized\r\n\r\n');
@@ -646,10 +701,53 @@ server.on('upgrade', (req: AuthenticatedIncomingMessage, socket: Socket, head: B
     }
 
     if (pathname === '/listen') {
-      wss.handleUpgrade(req, socket, head, (ws: WebSocket) => {
+      // Admission may hold the upgrade for a while; a refused client is told
+      // when to retry, and a session shed later gets an error and close 1013.
+      const priority = url.searchParams.get('priority') === 'low' ? PRIORITY_LOW : PRIORITY_NORMAL;
+      let admittedWs: WebSocket | null = null;
+      const onShed = (retryAfterSec: number) => {
+        if (!admittedWs) {
+          socket.destroy();
+          return;
+        }
+        admittedWs.send(
+          JSON.stringify({ type: 'error', message: 'Server overloaded, please reconnect later', retryAfter: retryAfterSec }),
+        );
+        admittedWs.close(1013, 'overloaded');
+      };
+      admission.admit(priority, onShed).then((result) => {
+        if (!result.admitted) {
+          socket.write(`HTTP/1.1 503 Service Unavailable\r\nRetry-After: ${result.retryAfterSec}\r\n\r\n`);
+          socket.destroy();
+          return;
+        }
+        if (socket.destroyed) {
+          result.ticket.release();
+          return;
+        }
+        // A handshake the server rejects never reaches the callback; the
+        // socket closing is the only sign the ticket is free again.
+        socket.once('close', () => {
+          if (!admittedWs) result.ticket.release();
+        });
+        wss.handleUpgrade(req, socket, head, (ws: WebSocket) => {
+          const authWs = ws as AuthenticatedWebSocket;
+          authWs.user = req.user;
+          authWs.token = req.token;
+          authWs.admission = result.ticket;
+          authWs.priority = priority;
+          admittedWs = ws;
+          wss.emit('connection', authWs, req);
+        });
+      });
+      return;
+    }
+
+    if (pathname === '/follow') {
+      followWss.handleUpgrade(req, socket, head, (ws: WebSocket) => {
         const authWs = ws as AuthenticatedWebSocket;
         authWs.user = req.user;
-        wss.emit('connection', authWs, req);
+        followWss.emit('connection', authWs, req);
       });
       return;
     }
@@ -663,6 +761,14 @@ server.on('upgrade', (req: AuthenticatedIncomingMessage, socket: Socket, head: B
       return;
     }
 
+    if (pathname === '/mux') {
+      // One connection for the client's /listen and /ai streams (mux.ts).
+      muxWss.handleUpgrade(req, socket, head, (ws: WebSocket) => {
+        new MuxConnection(ws, (stream, open) => openMuxStream(stream, open, req));
+      });
+      return;
+    }
+
     socket.destroy();
   } catch (error) {
     console.error('WebSocket upgrade error:', error);
@@ -673,67 +779,97 @@ server.on('upgrade', (req: AuthenticatedIncomingMessage, socket: Socket, head: B
 // Deepgram client
 const deepgram = createClient(process.env.DEEPGRAM_API_KEY || '');
 
-wss.on('connection', (ws: WebSocket) => {
-  console.log('Client connected');
-
-  let deepgramMic: any = null;
-  let deepgramSystem: any = null;
-
-  const startDeepgram = (source: 'mic' | 'system') => {
-    const live = deepgram.listen.live({
-      model: 'nova-3',
-      language: 'en',
-      smart_format: true,
-      punctuate: true,
-      interim_results: true,
-      encoding: 'linear16',
-      sample_rate: 16000,
-    });
-
-    live.on(LiveTranscriptionEvents.Open, () => {
-      console.log(`Deepgram connection opened (${source})`);
-      ws.send(JSON.stringify({ type: 'status', message: `ready:${source}` }));
-    });
-
-    live.on(LiveTranscriptionEvents.Transcript, (data: any) => {
-      const transcript = data.channel?.alternatives?.[0]?.transcript;
-      if (transcript) {
-        const isFinal = data.is_final === true;
-        const isInterim = data.is_final === false;
-        // Ensure source is correctly preserved from closure
-        const transcriptSource = source; // Use closure variable to ensure correct source
-        console.log(`[DEBUG] Sending transcript from ${transcriptSource} connection: "${transcript.substring(0, 50)}..."`);
-        ws.send(
-          JSON.stringify({
-            type: 'transcript',
-            source: transcriptSource,
-            text: transcript,
-            is_final: isFinal,
-            is_interim: isInterim,
-            confidence: data.channel.alternatives[0].confidence || 0,
-          }),
-        );
-      }
-    });
-
-    live.on(LiveTranscriptionEvents.Error, (error: any) => {
-      console.error(`Deepgram error (${source}):`, error);
-      ws.send(
-        JSON.stringify({
-          type: 'error',
-          message: error.message || `Deepgram error (${source})`,
-        }),
-      );
-    });
+// Warm upstream sessions handed to clients on `start` (DEEPGRAM_POOL_SIZE=0 disables).
+const deepgramPool = new DeepgramPool(() => deepgram.listen.live(DEEPGRAM_LIVE_OPTIONS), {
+  size: process.env.DEEPGRAM_API_KEY ? Number(process.env.DEEPGRAM_POOL_SIZE ?? 2) : 0,
+  maxOpensPerSecond: Number(process.env.DEEPGRAM_POOL_OPENS_PER_SECOND ?? 2),
+  burst: 2,
+  keepAliveMs: 5_000,
+  maxIdleMs: 5 * 60_000,
+  connectTimeoutMs: 10_000,
+});
+deepgramPool.start();
+
+// Caps live /listen sessions and sheds load when this process saturates.
+const admission = new AdmissionController({
+  maxSessions: Number(process.env.ADMISSION_MAX_SESSIONS ?? 200),
+  cpuLimit: Number(process.env.ADMISSION_CPU_LIMIT ?? 0.85),
+  lagLimitMs: Number(process.env.ADMISSION_LAG_LIMIT_MS ?? 200),
+  queueMs: Number(process.env.ADMISSION_QUEUE_MS ?? 3_000),
+  maxQueued: 64,
+});
+admission.start();
+
+// Optional datagram uplink for client audio (UDP_AUDIO_PORT unset disables it;
+// clients then stay on the WebSocket). The port must be reachable from clients.
+const udpAudio = process.env.UDP_AUDIO_PORT
+  ? new UdpAudioReceiver({
+      port: Number(process.env.UDP_AUDIO_PORT),
+      jitterMs: Number(process.env.UDP_AUDIO_JITTER_MS ?? 80),
+      reportIntervalMs: 500,
+    })
+  : null;
+udpAudio?.start();
+
+// Hands a stream of a /mux connection to the /listen or /ai handler, with the
+// same authentication and admission as its own socket would get.
+function openMuxStream(stream: MuxStream, open: Record<string, unknown>, req: AuthenticatedIncomingMessage): void {
+  stream.user = req.user;
+  stream.token = req.token;
+  // MuxStream has the part of the WebSocket interface the handlers use.
+  const ws = stream as unknown as AuthenticatedWebSocket;
+  if (stream.kind === 'ai') {
+    aiWss.emit('connection', ws, req);
+    stream.accept();
+    return;
+  }
+  const priority = open.priority === 'low' ? PRIORITY_LOW : PRIORITY_NORMAL;
+  const refuse = (retryAfterSec: number) => {
+    stream.send(
+      JSON.stringify({ type: 'error', message: 'Server overloaded, please reconnect later', retryAfter: retryAfterSec }),
+    );
+    stream.close(1013, 'overloaded');
+  };
+  admission.admit(priority, refuse).then((result) => {
+    if (!result.admitted) {
+      refuse(result.retryAfterSec);
+      return;
+    }
+    if (stream.readyState !== WebSocket.OPEN) {
+      result.ticket.release();
+      return;
+    }
+    stream.admission = result.ticket;
+    stream.priority = priority;
+    wss.emit('connection', ws, req);
+    stream.accept();
+  });
+}
 
-    live.on(LiveTranscriptionEvents.Close, () => {
-      console.log(`Deepgram connection closed (${source})`);
-      if (source === 'mic') deepgramMic = null;
-      if (source === 'system') deepgramSystem = null;
-    });
+wss.on('connection', (ws: AuthenticatedWebSocket) => {
+  console.log('Client connected');
 
-    return live;
-  };
+  let udpSessionId: number | null = null;
+  let shareId: string | null = null;
+  let shareExpiresAt = 0;
+
+  const session = new RelaySession({
+    openLive: () => deepgram.listen.live(DEEPGRAM_LIVE_OPTIONS),
+    pool: deepgramPool,
+    admission,
+    apiKeyConfigured: !!process.env.DEEPGRAM_API_KEY,
+    // Sends an event to the client and, while the meeting is shared, to its
+    // followers; serialized once for both.
+    onEvent: (payload, _seq, hubEvent) => {
+      ws.send(payload);
+      if (shareId) transcriptHub.publish(shareId, payload, hubEvent);
+    },
+    onError: (payload) => ws.send(payload),
+  });
+  const forwardAudio = (source: 'mic' | 'system', audio: Buffer) =>
+    session.forwardAudio(source, audio);
+  // Raw PCM from a /mux stream.
+  ws.on('audio', forwardAudio);
 
   // Handle incoming messages from client
   ws.on('message', async (message: Buffer | string) => {
@@ -750,139 +886,44 @@ wss.on('connection', (ws: WebSocket) => {
 
       console.log('WS /listen message:', data?.type, data?.source ? `source=${data.source}` : '');
 
-      if (data.type === 'start') {
-        // Check if API key is set
-        if (!process.env.DEEPGRAM_API_KEY) {
-          console.error('Deepgram API key not configured');
-          ws.send(JSON.stringify({ 
-            type: 'error', 
-            message: 'Server error: Deepgram API key not configured. Please set DEEPGRAM_API_KEY in .env file' 
-          }));
-          return;
-        }
-
-        // Initialize Deepgram live connections (mic + system)
-        console.log('Starting Deepgram connections (mic + system)...');
-        
-        try {
-          if (deepgramMic) {
-            deepgramMic.finish();
-            deepgramMic = null;
-          }
-          if (deepgramSystem) {
-            deepgramSystem.finish();
-            deepgramSystem = null;
-          }
-
-          deepgramMic = startDeepgram('mic');
-          deepgramSystem = startDeepgram('system');
-        } catch (error: any) {
-          console.error('Failed to start Deepgram connection:', error);
-          ws.send(JSON.stringify({ type: 'error', message: 'Failed to connect to Deepgram: ' + (error.message || 'Unknown error') }));
-          deepgramMic = null;
-          deepgramSystem = null;
-        }
+      // start, audio, finalize and stop drive the Deepgram sessions.
+      if (session.handleMessage(data)) return;
 
-      } else if (data.type === 'audio') {
-        // Validate and normalize source - must be exactly 'system' or 'mic'
-        const receivedSource = String(data.source || '').toLowerCase().trim();
-        
-        // Strict validation - reject if source is not exactly 'system' or 'mic'
-        if (receivedSource !== 'system' && receivedSource !== 'mic') {
-          console.error(`[ERROR] Invalid source received: "${data.source}", rejecting audio`);
-          return;
-        }
-        
-        const source = receivedSource; // Use normalized source directly
-        
-        // Auto-initialize Deepgram connection if not already started
-        if (source === 'mic' && !deepgramMic) {
-          console.log('[DEBUG] Auto-initializing deepgramMic connection (audio received before start)');
-          try {
-            if (!process.env.DEEPGRAM_API_KEY) {
-              console.error('Deepgram API key not configured');
-              ws.send(JSON.stringify({ 
-                type: 'error', 
-                message: 'Server error: Deepgram API key not configured. Please set DEEPGRAM_API_KEY in .env file' 
-              }));
-              return;
-            }
-            deepgramMic = startDeepgram('mic');
-          } catch (error: any) {
-            console.error('Failed to auto-start Deepgram mic connection:', error);
-            ws.send(JSON.stringify({ type: 'error', message: 'Failed to initialize mic transcription: ' + (error.message || 'Unknown error') }));
-            return;
-          }
-        }
-        
-        if (source === 'system' && !deepgramSystem) {
-          console.log('[DEBUG] Auto-initializing deepgramSystem connection (audio received before start)');
-          try {
-            if (!process.env.DEEPGRAM_API_KEY) {
-              console.error('Deepgram API key not configured');
-              ws.send(JSON.stringify({ 
-                type: 'error', 
-                message: 'Server error: Deepgram API key not configured. Please set DEEPGRAM_API_KEY in .env file' 
-              }));
-              return;
-            }
-            deepgramSystem = startDeepgram('system');
-          } catch (error: any) {
-            console.error('Failed to auto-start Deepgram system connection:', error);
-            ws.send(JSON.stringify({ type: 'error', message: 'Failed to initialize system transcription: ' + (error.message || 'Unknown error') }));
-            return;
-          }
-        }
-        
-        // Debug logging with explicit checks
-        if (source === 'system') {
-          console.log(`[DEBUG] Routing SYSTEM audio - deepgramSystem available: ${!!deepgramSystem}, deepgramMic available: ${!!deepgramMic}`);
-          if (!deepgramSystem) {
-            console.error(`[ERROR] System audio received but deepgramSystem is not available!`);
-            return;
-          }
-        } else if (source === 'mic') {
-          console.log(`[DEBUG] Routing MIC audio - deepgramMic available: ${!!deepgramMic}, deepgramSystem available: ${!!deepgramSystem}`);
-          if (!deepgramMic) {
-            console.error(`[ERROR] Mic audio received but deepgramMic is not available!`);
-            return;
-          }
-        }
-        
-        // Explicit routing - ensure we use the correct connection
-        let target;
-        if (source === 'system') {
-          target = deepgramSystem;
-        } else {
-          target = deepgramMic;
-        }
-        
-        if (!target) {
-          console.error(`[ERROR] No Deepgram connection available for source: ${source} (received: "${data.source}")`);
+      if (data.type === 'udp_offer') {
+        // Client can send audio over UDP; it keeps the WebSocket as fallback.
+        if (!udpAudio || !ws.token) {
+          ws.send(JSON.stringify({ type: 'udp_unavailable' }));
           return;
         }
-
-        // Forward audio data to Deepgram (per-source session)
-        try {
-          const audioBuffer = Buffer.from(data.audio, 'base64');
-          console.log(`[DEBUG] Sending ${source} audio to ${source === 'system' ? 'deepgramSystem' : 'deepgramMic'} (${audioBuffer.length} bytes)`);
-          target.send(audioBuffer);
-        } catch (error: any) {
-          console.error(`[ERROR] Error sending audio to Deepgram (${source}):`, error);
-          ws.send(JSON.stringify({ type: 'error', message: 'Error processing audio' }));
-        }
-      } else if (data.type === 'stop') {
-        // Close Deepgram connections
-        console.log('Stopping transcription (mic + system)...');
-        if (deepgramMic) {
-          deepgramMic.finish();
-          deepgramMic = null;
-        }
-        if (deepgramSystem) {
-          deepgramSystem.finish();
-          deepgramSystem = null;
+        if (udpSessionId !== null) udpAudio.closeSession(udpSessionId);
+        const udpSession = udpAudio.createSession(ws.token, forwardAudio, (source) =>
+          session.finalize(source),
+        );
+        udpSessionId = udpSession.sessionId;
+        ws.send(JSON.stringify({ type: 'udp_ready', port: udpAudio.port, ...udpSession }));
+      } else if (data.type === 'share_start') {
+        // Lets others follow this meeting read-only via /follow?share=<id>
+        // until the share expires.
+        if (!shareId) {
+          const share = transcriptHub.openShare(() => {
+            shareId = null;
+            ws.admission?.setPriority(ws.priority ?? PRIORITY_NORMAL);
+            ws.send(JSON.stringify({ type: 'status', message: 'share_expired' }));
+          });
+          shareId = share.shareId;
+          shareExpiresAt = share.expiresAt;
         }
-        ws.send(JSON.stringify({ type: 'status', message: 'stopped' }));
+        ws.admission?.setPriority(PRIORITY_SHARED);
+        ws.send(JSON.stringify({
+          type: 'share_ready',
+          shareId,
+          expiresAt: new Date(shareExpiresAt).toISOString(),
+        }));
+      } else if (data.type === 'share_stop') {
+        if (shareId) transcriptHub.closeShare(shareId);
+        shareId = null;
+        ws.admission?.setPriority(ws.priority ?? PRIORITY_NORMAL);
+        ws.send(JSON.stringify({ type: 'status', message: 'share_stopped' }));
       }
     } catch (error: any) {
       console.error('Error processing message:', error);
@@ -894,8 +935,10 @@ wss.on('connection', (ws: WebSocket) => {
 
   ws.on('close', (code: number, reason: Buffer) => {
     console.log('Client disconnected', { code, reason: reason?.toString?.() ?? '' });
-    if (deepgramMic) deepgramMic.finish();
-    if (deepgramSystem) deepgramSystem.finish();
+    if (udpSessionId !== null) udpAudio?.closeSession(udpSessionId);
+    if (shareId) transcriptHub.closeShare(shareId);
+    session.close();
+    ws.admission?.release();
   });
 
   ws.on('error', (error: Error) => {
@@ -903,6 +946,22 @@ wss.on('connection', (ws: WebSocket) => {
   });
 });
 
+// Read-only followers of a shared meeting: /follow?share=<id>. They receive
+// the recent finals, then the live transcript and status events.
+followWss.on('connection', (ws: AuthenticatedWebSocket, req: IncomingMessage) => {
+  const shareId = new URL(req.url ?? '', 'http://localhost').searchParams.get('share');
+  const unsubscribe = shareId ? transcriptHub.subscribe(shareId, ws) : null;
+  if (!unsubscribe) {
+    ws.close(4404, 'Unknown share');
+    return;
+  }
+  console.log(`Follower joined share ${shareId} (user ${ws.user?.userId ?? 'unknown'})`);
+  ws.on('close', unsubscribe);
+  ws.on('error', (error: Error) => {
+    console.error('Follow WebSocket error:', error);
+  });
+});
+
 // AI WebSocket server (streams tokens to the client)
 aiWss.on('connection', (ws: WebSocket) => {
   console.log('AI client connected');
@@ -1153,6 +1212,7 @@ server.listen(PORT, () => {
   console.log(`Server running on port ${PORT}`);
   console.log(`WebSocket endpoint: ws://localhost:${PORT}/listen`);
   console.log(`AI WebSocket endpoint: ws://localhost:${PORT}/ai`);
+  console.log(`Multiplexed WebSocket endpoint: ws://localhost:${PORT}/mux`);
   console.log(`Frontend available at: http://localhost:${PORT}`);
   if (!process.env.DEEPGRAM_API_KEY) {
     console.warn('WARNING: DEEPGRAM_API_KEY environment variable not set!');
@@ -1170,12 +1230,18 @@ server.listen(PORT, () => {
 // Graceful shutdown
 process.on('SIGINT', async () => {
   console.log('\nShutting down gracefully...');
+  deepgramPool.close();
+  udpAudio?.close();
+  transcriptHub.close();
   await closeDB();
   process.exit(0);
 });
 
 process.on('SIGTERM', async () => {
   console.log('\nShutting down gracefully...');
+  deepgramPool.close();
+  udpAudio?.close();
+  transcriptHub.close();
   await closeDB();
   process.exit(0);
 });
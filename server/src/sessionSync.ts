@@ -0,0 +1,135 @@
+import { inflateRawSync } from 'zlib';
+import { SESSION_SYNC_DICTIONARY } from './sessionSyncDictionary.js';
+
+// Decoder for the incremental session save format produced by the Windows
+// client (windows/runner/session_sync_encoder.h documents the layout). The
+// body is raw DEFLATE with SESSION_SYNC_DICTIONARY as the preset dictionary.
+
+const FORMAT_VERSION = 1;
+const OP_SET = 0x01;
+const OP_META = 0x02;
+const FLAG_DRAFT = 0x01;
+const FLAG_SPEAKER = 0x02;
+const SOURCES = ['mic', 'system', 'unknown'];
+
+// Upper bound on the inflated size so a small body cannot expand unbounded.
+const MAX_INFLATED_BYTES = 16 * 1024 * 1024;
+
+// Bubble timestamps arrive as the client's wall-clock time in milliseconds,
+// the same instant the full save sends as an ISO string without an offset.
+// Parse them the way the full save parses that string so both paths store
+// the same Date.
+const wallClockDate = (ms: number): Date => new Date(new Date(ms).toISOString().slice(0, -1));
+
+export interface SessionDeltaBubble {
+  source: string;
+  text: string;
+  timestamp: Date;
+  isDraft: boolean;
+  speakerId?: number;
+}
+
+export interface SessionDelta {
+  baseVersion: number;
+  newVersion: number;
+  bubbleCount: number;
+  meta: Record<string, any> | null;
+  sets: Array<{ index: number; bubble: SessionDeltaBubble }>;
+}
+
+class Reader {
+  private offset = 0;
+
+  constructor(private readonly buf: Buffer) {}
+
+  byte(): number {
+    if (this.offset >= this.buf.length) throw new Error('Truncated session delta');
+    return this.buf[this.offset++];
+  }
+
+  varint(): number {
+    let result = 0;
+    let scale = 1;
+    for (let i = 0; i < 8; i++) {
+      const b = this.byte();
+      result += (b & 0x7f) * scale;
+      if ((b & 0x80) === 0) {
+        if (!Number.isSafeInteger(result)) throw new Error('Session delta varint overflow');
+        return result;
+      }
+      scale *= 128;
+    }
+    throw new Error('Session delta varint overflow');
+  }
+
+  signedVarint(): number {
+    const v = this.varint();
+    return v % 2 === 0 ? v / 2 : -(v + 1) / 2;
+  }
+
+  string(): string {
+    const length = this.varint();
+    if (this.offset + length > this.buf.length) throw new Error('Truncated session delta');
+    const s = this.buf.toString('utf8', this.offset, this.offset + length);
+    this.offset += length;
+    return s;
+  }
+
+  get done(): boolean {
+    return this.offset === this.buf.length;
+  }
+}
+
+export const decodeSessionDelta = (body: Buffer): SessionDelta => {
+  const buf = inflateRawSync(body, {
+    dictionary: SESSION_SYNC_DICTIONARY,
+    maxOutputLength: MAX_INFLATED_BYTES,
+  });
+  if (buf.length < 5 || buf.toString('latin1', 0, 4) !== 'HNSD') {
+    throw new Error('Not a session delta');
+  }
+  if (buf[4] !== FORMAT_VERSION) {
+    throw new Error(`Unsupported session delta format ${buf[4]}`);
+  }
+
+  const reader = new Reader(buf.subarray(5));
+  const delta: SessionDelta = {
+    baseVersion: reader.varint(),
+    newVersion: reader.varint(),
+    bubbleCount: reader.varint(),
+    meta: null,
+    sets: [],
+  };
+  const opCount = reader.varint();
+
+  let previousMs = 0;
+  for (let i = 0; i < opCount; i++) {
+    const op = reader.byte();
+    if (op === OP_META) {
+      const meta = JSON.parse(reader.string());
+      if (!meta || typeof meta !== 'object') throw new Error('Invalid session delta metadata');
+      delta.meta = meta;
+    } else if (op === OP_SET) {
+      const index = reader.varint();
+      if (index >= delta.bubbleCount) throw new Error('Session delta index out of range');
+      const source = SOURCES[reader.byte()] ?? 'unknown';
+      const flags = reader.byte();
+      const speakerId = flags & FLAG_SPEAKER ? reader.varint() : undefined;
+      previousMs += reader.signedVarint();
+      delta.sets.push({
+        index,
+        bubble: {
+          source,
+          text: reader.string(),
+          timestamp: wallClockDate(previousMs),
+          isDraft: (flags & FLAG_DRAFT) !== 0,
+          ...(speakerId !== undefined ? { speakerId } : {}),
+        },
+      });
+    } else {
+      throw new Error(`Unknown session delta op ${op}`);
+    }
+  }
+  if (!reader.done) throw new Error('Trailing bytes in session delta');
+  return delta;
+};
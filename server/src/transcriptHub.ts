@@ -0,0 +1,203 @@
+import { randomBytes } from 'crypto';
+
+// Fans one meeting's transcript and status events out to read-only followers
+// (/follow) without touching the publisher's path.
+//
+// Each event is serialized once into a Buffer and the same Buffer is handed to
+// every follower socket; ws frames it without copying the payload, so the
+// memory stays shared until the last socket has written it out.
+//
+// publish() only queues: the socket writes happen in slices of FLUSH_SLICE
+// followers per event-loop turn, so a large audience never holds up the
+// publisher's own socket for long. Queued finals and status events keep their
+// order; a queued interim result is kept only as the newest per source, since
+// a newer interim or the final supersedes it. A follower with more than
+// HIGH_WATER_BYTES not yet written to its socket gets nothing more until
+// those writes complete, and one that falls MAX_QUEUED_EVENTS behind is
+// disconnected.
+//
+// The share id is all a follower needs, so every share expires SHARE_TTL_MS
+// after it was opened; the publisher can open a new one to keep sharing.
+
+export interface HubSubscriber {
+  readonly readyState: number;
+  send(data: Buffer, options: { binary: boolean }, cb: (error?: Error) => void): void;
+  close(code?: number, reason?: string): void;
+}
+
+export interface HubEvent {
+  source?: string; // Interim results supersede each other per source
+  interim?: boolean;
+}
+
+export interface TranscriptHubStats {
+  shares: number;
+  followers: number;
+  published: number;
+  delivered: number;
+  droppedInterim: number;
+  disconnectedSlow: number;
+}
+
+const OPEN = 1; // WebSocket.OPEN
+const HIGH_WATER_BYTES = 64 * 1024;
+const MAX_QUEUED_EVENTS = 256;
+const FLUSH_SLICE = 128;
+// Finals replayed to a follower that joins mid-meeting.
+const HISTORY_EVENTS = 50;
+const SHARE_TTL_MS = 4 * 60 * 60 * 1000;
+
+interface Follower {
+  socket: HubSubscriber;
+  inFlight: number;
+  queued: Buffer[];
+  queuedInterim: Map<string, Buffer>;
+}
+
+interface Share {
+  followers: Set<Follower>;
+  history: Buffer[];
+  expiry: NodeJS.Timeout;
+}
+
+export class TranscriptHub {
+  private readonly shares = new Map<string, Share>();
+  private readonly dirty = new Set<Follower>();
+  private flushScheduled = false;
+  private counters = { published: 0, delivered: 0, droppedInterim: 0, disconnectedSlow: 0 };
+
+  // Starts sharing a meeting; the returned id is what followers join with.
+  // |onExpired| runs after the share has closed itself at |expiresAt|.
+  openShare(onExpired?: () => void, ttlMs = SHARE_TTL_MS): { shareId: string; expiresAt: number } {
+    const shareId = randomBytes(12).toString('base64url');
+    const expiry = setTimeout(() => {
+      this.closeShare(shareId, 'expired');
+      onExpired?.();
+    }, ttlMs);
+    expiry.unref();
+    this.shares.set(shareId, { followers: new Set(), history: [], expiry });
+    return { shareId, expiresAt: Date.now() + ttlMs };
+  }
+
+  closeShare(shareId: string, reason: 'ended' | 'expired' = 'ended'): void {
+    const share = this.shares.get(shareId);
+    if (!share) return;
+    clearTimeout(share.expiry);
+    this.shares.delete(shareId);
+    const ended = Buffer.from(JSON.stringify({ type: 'share_ended', reason }));
+    for (const follower of share.followers) {
+      this.dirty.delete(follower);
+      follower.socket.send(ended, { binary: false }, () => {});
+      follower.socket.close(1000, `share ${reason}`);
+    }
+  }
+
+  // Null when there is no such share; otherwise the unsubscribe function.
+  subscribe(shareId: string, socket: HubSubscriber): (() => void) | null {
+    const share = this.shares.get(shareId);
+    if (!share) return null;
+    const follower: Follower = { socket, inFlight: 0, queued: [], queuedInterim: new Map() };
+    share.followers.add(follower);
+    for (const data of share.history) this.enqueue(share, follower, data, {});
+    return () => {
+      share.followers.delete(follower);
+      this.dirty.delete(follower);
+    };
+  }
+
+  // |payload| is the already-serialized event the publisher itself sends.
+  publish(shareId: string, payload: string, event: HubEvent = {}): void {
+    const share = this.shares.get(shareId);
+    if (!share) return;
+    this.counters.published++;
+    const data = Buffer.from(payload);
+    if (!event.interim) {
+      share.history.push(data);
+      if (share.history.length > HISTORY_EVENTS) share.history.shift();
+    }
+    for (const follower of share.followers) {
+      this.enqueue(share, follower, data, event);
+    }
+  }
+
+  stats(): TranscriptHubStats {
+    let followers = 0;
+    for (const share of this.shares.values()) followers += share.followers.size;
+    return { shares: this.shares.size, followers, ...this.counters };
+  }
+
+  close(): void {
+    for (const shareId of [...this.shares.keys()]) this.closeShare(shareId);
+  }
+
+  private scheduleFlush(): void {
+    if (this.flushScheduled) return;
+    this.flushScheduled = true;
+    setImmediate(() => this.flush());
+  }
+
+  private flush(): void {
+    this.flushScheduled = false;
+    let budget = FLUSH_SLICE;
+    for (const follower of this.dirty) {
+      if (budget-- === 0) {
+        this.scheduleFlush();
+        return;
+      }
+      this.dirty.delete(follower);
+      this.drain(follower);
+    }
+  }
+
+  private enqueue(share: Share, follower: Follower, data: Buffer, event: HubEvent): void {
+    if (follower.socket.readyState !== OPEN) {
+      share.followers.delete(follower);
+      this.dirty.delete(follower);
+      return;
+    }
+    const source = event.source ?? '';
+    if (event.interim) {
+      if (follower.queuedInterim.has(source)) this.counters.droppedInterim++;
+      follower.queuedInterim.set(source, data);
+    } else {
+      // The final supersedes a queued interim of its source.
+      if (event.source !== undefined && follower.queuedInterim.delete(source)) {
+        this.counters.droppedInterim++;
+      }
+      if (follower.queued.length >= MAX_QUEUED_EVENTS) {
+        this.counters.disconnectedSlow++;
+        share.followers.delete(follower);
+        this.dirty.delete(follower);
+        follower.socket.close(1013, 'too slow');
+        return;
+      }
+      follower.queued.push(data);
+    }
+    this.dirty.add(follower);
+    this.scheduleFlush();
+  }
+
+  private write(follower: Follower, data: Buffer): void {
+    follower.inFlight += data.length;
+    follower.socket.send(data, { binary: false }, (error) => {
+      follower.inFlight -= data.length;
+      if (error) return;
+      this.counters.delivered++;
+      this.drain(follower);
+    });
+  }
+
+  private drain(follower: Follower): void {
+    while (follower.inFlight < HIGH_WATER_BYTES && follower.socket.readyState === OPEN) {
+      const next = follower.queued.shift();
+      if (next) {
+        this.write(follower, next);
+        continue;
+      }
+      const interim = follower.queuedInterim.entries().next();
+      if (interim.done) return;
+      follower.queuedInterim.delete(interim.value[0]);
+      this.write(follower, interim.value[1]);
+    }
+  }
+}
@@ -1,9 +1,13 @@
 import { WebSocket } from 'ws';
 import { JWTPayload } from './auth.js';
+import { AdmissionTicket } from './admission.js';
 
 // Extend WebSocket to include user info
 export interface AuthenticatedWebSocket extends WebSocket {
   user?: JWTPayload;
+  token?: string; // Kept for deriving datagram uplink keys
+  admission?: AdmissionTicket; // /listen sessions; released on close
+  priority?: number; // Admission priority the session connected with
 }
 
 // WebSocket message types
@@ -0,0 +1,433 @@
+import dgram from 'dgram';
+import { createHmac, randomBytes, timingSafeEqual } from 'crypto';
+
+// Receiving side of the optional datagram audio uplink (the sender is
+// windows/runner/audio_uplink.cpp; the wire format is documented in
+// windows/runner/uplink_protocol.h).
+//
+// A /listen client asks for a session with `udp_offer`; the reply carries a
+// session id and a nonce, and both ends derive the packet key from the
+// client's auth token and that nonce. Audio arrives sequenced per stream with
+// one XOR parity packet per group, goes through a small jitter buffer that
+// reorders, repairs single losses and skips gaps it cannot fill within
+// jitterMs, and is handed to the same forwarding path as WebSocket audio.
+// The client's finalize travels in the same sequence, so the recognizer is
+// flushed only after the utterance's audio has left the jitter buffer.
+// The client keeps the WebSocket as its fallback, so any failure here only
+// costs the latency gain.
+
+export type UdpAudioSource = 'mic' | 'system';
+export type UdpAudioHandler = (source: UdpAudioSource, audio: Buffer) => void;
+export type UdpFinalizeHandler = (source: UdpAudioSource) => void;
+
+export interface UdpAudioOptions {
+  port: number;
+  jitterMs: number; // How long a gap may hold back later audio
+  reportIntervalMs: number;
+}
+
+export interface JitterBufferStats {
+  received: number;
+  recovered: number;
+  lost: number;
+  late: number;
+  duplicates: number;
+}
+
+const MAGIC_0 = 0x48; // 'H'
+const MAGIC_1 = 0x55; // 'U'
+const VERSION = 1;
+const HEADER_BYTES = 20;
+const TAG_BYTES = 8;
+
+const PacketType = {
+  Hello: 1,
+  Welcome: 2,
+  Audio: 3,
+  Parity: 4,
+  Report: 5,
+  Bye: 6,
+  Finalize: 7,
+} as const;
+
+const STREAMS: UdpAudioSource[] = ['mic', 'system'];
+const TICK_MS = 10;
+// Packets stamped this much before the newest one seen are replays (or so
+// late they no longer matter) and are dropped even with a valid tag.
+const REPLAY_WINDOW_MS = 10000;
+// Delivered packets kept for parity repair of a later member of their group.
+const HISTORY_PACKETS = 16;
+
+export function deriveUplinkKey(token: string, nonce: Buffer): Buffer {
+  return createHmac('sha256', token)
+    .update(Buffer.concat([Buffer.from('hearnow-udp'), nonce]))
+    .digest();
+}
+
+interface UplinkHeader {
+  type: number;
+  session: number;
+  stream: number;
+  count: number;
+  seq: number;
+  timeMs: number;
+}
+
+export function buildUplinkPacket(key: Buffer, header: UplinkHeader, payload: Buffer): Buffer {
+  const packet = Buffer.alloc(HEADER_BYTES + payload.length + TAG_BYTES);
+  packet[0] = MAGIC_0;
+  packet[1] = MAGIC_1;
+  packet[2] = VERSION;
+  packet[3] = header.type;
+  packet.writeUInt32LE(header.session >>> 0, 4);
+  packet[8] = header.stream;
+  packet[9] = header.count;
+  packet.writeUInt16LE(payload.length, 10);
+  packet.writeUInt32LE(header.seq >>> 0, 12);
+  packet.writeUInt32LE(header.timeMs >>> 0, 16);
+  payload.copy(packet, HEADER_BYTES);
+  const body = packet.subarray(0, HEADER_BYTES + payload.length);
+  createHmac('sha256', key).update(body).digest().copy(packet, HEADER_BYTES + payload.length, 0, TAG_BYTES);
+  return packet;
+}
+
+function readHeader(packet: Buffer): UplinkHeader | null {
+  if (packet.length < HEADER_BYTES + TAG_BYTES) return null;
+  if (packet[0] !== MAGIC_0 || packet[1] !== MAGIC_1 || packet[2] !== VERSION) return null;
+  if (HEADER_BYTES + packet.readUInt16LE(10) + TAG_BYTES !== packet.length) return null;
+  return {
+    type: packet[3],
+    session: packet.readUInt32LE(4),
+    stream: packet[8],
+    count: packet[9],
+    seq: packet.readUInt32LE(12),
+    timeMs: packet.readUInt32LE(16),
+  };
+}
+
+function verifyTag(key: Buffer, packet: Buffer): boolean {
+  const bodyLength = packet.length - TAG_BYTES;
+  const expected = createHmac('sha256', key).update(packet.subarray(0, bodyLength)).digest().subarray(0, TAG_BYTES);
+  return timingSafeEqual(expected, packet.subarray(bodyLength));
+}
+
+interface BufferedPacket {
+  payload: Buffer;
+  arrivedAt: number;
+  rebuilt: boolean; // From parity, possibly ahead of a reordered original
+}
+
+interface ParityGroup {
+  count: number;
+  payload: Buffer;
+}
+
+// In-order delivery of one stream. Contiguous audio passes straight through;
+// only a gap holds later packets back, for at most delayMs after the first of
+// them arrived, while a reordered packet or the group's parity can fill it.
+// An utterance end is held like a packet and fires once everything before it
+// was delivered or given up.
+export class JitterBuffer {
+  private next = 0;
+  private readonly packets = new Map<number, BufferedPacket>();
+  private readonly parity = new Map<number, ParityGroup>();
+  private readonly ends = new Map<number, number>(); // seq -> arrival
+  private lastEnd = -1;
+  private readonly counters: JitterBufferStats = { received: 0, recovered: 0, lost: 0, late: 0, duplicates: 0 };
+
+  constructor(
+    private readonly delayMs: number,
+    private readonly deliver: (audio: Buffer) => void,
+    private readonly finalize: () => void = () => {},
+  ) {}
+
+  push(seq: number, payload: Buffer, now: number): void {
+    const existing = this.packets.get(seq);
+    if (existing) {
+      if (!existing.rebuilt) {
+        this.counters.duplicates++;
+      } else if (seq < this.next) {
+        this.counters.late++; // Its repair was played
+      } else {
+        existing.rebuilt = false; // The original caught up with its repair
+        this.counters.received++;
+      }
+      return;
+    }
+    if (seq < this.next) {
+      // Its gap was already skipped. Too late to play, but it may still help
+      // repair a later member of its group.
+      this.counters.late++;
+      if (seq < this.next - HISTORY_PACKETS) return;
+    } else {
+      this.counters.received++;
+    }
+    this.packets.set(seq, { payload, arrivedAt: now, rebuilt: false });
+    for (const [first, group] of this.parity) {
+      if (seq >= first && seq < first + group.count) this.repair(first, now);
+    }
+    this.flush(now);
+  }
+
+  pushParity(first: number, count: number, payload: Buffer, now: number): void {
+    if (count === 0 || payload.length < 2 || first + count <= this.next || this.parity.has(first)) return;
+    this.parity.set(first, { count, payload });
+    this.repair(first, now);
+    this.flush(now);
+  }
+
+  // The utterance ends before audio packet |seq|. Sent once; a lost one
+  // leaves the utterance to the recognizer's own endpointing.
+  pushFinalize(seq: number, now: number): void {
+    if (seq <= this.lastEnd || this.ends.has(seq)) return;
+    this.ends.set(seq, now);
+    this.flush(now);
+  }
+
+  // Delivers what is in order, and gives up on a gap once it is overdue.
+  flush(now: number): void {
+    for (;;) {
+      for (;;) {
+        this.endUtterances();
+        const packet = this.packets.get(this.next);
+        if (!packet) break;
+        if (packet.rebuilt) this.counters.recovered++;
+        this.deliver(packet.payload);
+        this.next++;
+      }
+      let firstWaiting = -1;
+      let oldestArrival = Infinity;
+      for (const [seq, packet] of this.packets) {
+        if (seq <= this.next) continue;
+        if (firstWaiting < 0 || seq < firstWaiting) firstWaiting = seq;
+        oldestArrival = Math.min(oldestArrival, packet.arrivedAt);
+      }
+      for (const [seq, arrivedAt] of this.ends) {
+        if (firstWaiting < 0 || seq < firstWaiting) firstWaiting = seq;
+        oldestArrival = Math.min(oldestArrival, arrivedAt);
+      }
+      if (firstWaiting < 0 || now - oldestArrival < this.delayMs) break;
+      this.counters.lost += firstWaiting - this.next;
+      this.next = firstWaiting;
+    }
+    this.prune();
+  }
+
+  stats(): JitterBufferStats {
+    return { ...this.counters };
+  }
+
+  private endUtterances(): void {
+    for (const seq of this.ends.keys()) {
+      if (seq > this.next) continue;
+      this.ends.delete(seq);
+      this.lastEnd = Math.max(this.lastEnd, seq);
+      this.finalize();
+    }
+  }
+
+  // Rebuilds the one missing member of a group from its parity.
+  private repair(first: number, now: number): void {
+    const group = this.parity.get(first);
+    if (!group) return;
+    let missing = -1;
+    for (let seq = first; seq < first + group.count; seq++) {
+      if (this.packets.has(seq)) continue;
+      if (missing >= 0) return; // Two or more lost: XOR cannot help
+      missing = seq;
+    }
+    this.parity.delete(first);
+    if (missing < this.next) return;
+
+    const rebuilt = Buffer.from(group.payload);
+    for (let seq = first; seq < first + group.count; seq++) {
+      if (seq === missing) continue;
+      const payload = this.packets.get(seq)!.payload;
+      rebuilt[0] ^= payload.length & 0xff;
+      rebuilt[1] ^= payload.length >> 8;
+      for (let i = 0; i < payload.length && i + 2 < rebuilt.length; i++) rebuilt[i + 2] ^= payload[i];
+    }
+    const length = rebuilt.readUInt16LE(0);
+    if (length > rebuilt.length - 2) return;
+    this.packets.set(missing, { payload: rebuilt.subarray(2, 2 + length), arrivedAt: now, rebuilt: true });
+  }
+
+  private prune(): void {
+    for (const seq of this.packets.keys()) {
+      if (seq < this.next - HISTORY_PACKETS) this.packets.delete(seq);
+    }
+    for (const [first, group] of this.parity) {
+      if (first + group.count <= this.next) this.parity.delete(first);
+    }
+  }
+}
+
+interface UdpSession {
+  id: number;
+  key: Buffer;
+  streams: JitterBuffer[];
+  peer: { address: string; port: number } | null;
+  // Newest sender timestamp seen. Only a packet newer than this may move
+  // the peer, so a captured packet replayed from another address cannot.
+  latestTimeMs: number | null;
+}
+
+export class UdpAudioReceiver {
+  private socket: dgram.Socket | null = null;
+  private readonly sessions = new Map<number, UdpSession>();
+  private tickTimer: NodeJS.Timeout | null = null;
+  private reportTimer: NodeJS.Timeout | null = null;
+  private counters = { packets: 0, rejected: 0 };
+
+  constructor(private readonly options: UdpAudioOptions) {}
+
+  get port(): number {
+    return this.options.port;
+  }
+
+  start(): void {
+    if (this.socket) return;
+    const socket = dgram.createSocket('udp4');
+    socket.on('message', (packet, rinfo) => this.onPacket(packet, rinfo));
+    socket.on('error', (error) => {
+      console.error('UDP audio socket error:', error);
+    });
+    socket.bind(this.options.port, () => {
+      console.log(`UDP audio uplink listening on port ${this.options.port}`);
+    });
+    this.socket = socket;
+
+    this.tickTimer = setInterval(() => {
+      const now = Date.now();
+      for (const session of this.sessions.values()) {
+        for (const stream of session.streams) stream.flush(now);
+      }
+    }, TICK_MS);
+    this.tickTimer.unref();
+    this.reportTimer = setInterval(() => this.sendReports(), this.options.reportIntervalMs);
+    this.reportTimer.unref();
+  }
+
+  // Opens a session for an authenticated /listen client. The nonce is sent
+  // back over that WebSocket; the token itself never leaves the server.
+  createSession(
+    token: string,
+    onAudio: UdpAudioHandler,
+    onFinalize: UdpFinalizeHandler,
+  ): { sessionId: number; nonce: string } {
+    let id = 0;
+    while (id === 0 || this.sessions.has(id)) id = randomBytes(4).readUInt32LE(0);
+    const nonce = randomBytes(16);
+    this.sessions.set(id, {
+      id,
+      key: deriveUplinkKey(token, nonce),
+      streams: STREAMS.map(
+        (source) =>
+          new JitterBuffer(
+            this.options.jitterMs,
+            (audio) => onAudio(source, audio),
+            () => onFinalize(source),
+          ),
+      ),
+      peer: null,
+      latestTimeMs: null,
+    });
+    return { sessionId: id, nonce: nonce.toString('hex') };
+  }
+
+  closeSession(id: number): void {
+    const session = this.sessions.get(id);
+    if (!session) return;
+    this.send(session, PacketType.Bye, Buffer.alloc(0));
+    session.streams.forEach((stream, index) => {
+      const stats = stream.stats();
+      console.log(`UDP audio session ${id} ${STREAMS[index]}:`, stats);
+    });
+    this.sessions.delete(id);
+  }
+
+  stats() {
+    return { sessions: this.sessions.size, ...this.counters };
+  }
+
+  close(): void {
+    for (const id of [...this.sessions.keys()]) this.closeSession(id);
+    if (this.tickTimer) clearInterval(this.tickTimer);
+    if (this.reportTimer) clearInterval(this.reportTimer);
+    this.tickTimer = null;
+    this.reportTimer = null;
+    this.socket?.close();
+    this.socket = null;
+  }
+
+  private onPacket(packet: Buffer, rinfo: dgram.RemoteInfo): void {
+    const header = readHeader(packet);
+    const session = header ? this.sessions.get(header.session) : undefined;
+    if (!header || !session || !verifyTag(session.key, packet)) {
+      this.counters.rejected++;
+      return;
+    }
+    // The sender's clock is a wrapping u32 of milliseconds; compare it as a
+    // signed distance from the newest packet.
+    const age = session.latestTimeMs === null ? -1 : (session.latestTimeMs - header.timeMs) | 0;
+    if (age > REPLAY_WINDOW_MS) {
+      this.counters.rejected++;
+      return;
+    }
+    this.counters.packets++;
+    const fresh = age < 0;
+    if (fresh) {
+      session.latestTimeMs = header.timeMs;
+      // Authenticated and newer than anything before it, so follow the
+      // client across NAT rebinding.
+      session.peer = { address: rinfo.address, port: rinfo.port };
+    }
+
+    const payload = packet.subarray(HEADER_BYTES, packet.length - TAG_BYTES);
+    const stream = session.streams[header.stream];
+    const now = Date.now();
+    switch (header.type) {
+      case PacketType.Hello:
+        this.send(session, PacketType.Welcome, Buffer.alloc(0));
+        break;
+      case PacketType.Audio:
+        stream?.push(header.seq, Buffer.from(payload), now);
+        break;
+      case PacketType.Parity:
+        stream?.pushParity(header.seq, header.count, Buffer.from(payload), now);
+        break;
+      case PacketType.Finalize:
+        stream?.pushFinalize(header.seq, now);
+        break;
+      case PacketType.Bye:
+        if (fresh) session.peer = null;
+        break;
+    }
+  }
+
+  // Per stream: received, recovered, lost. Doubles as the client's liveness
+  // signal for deciding when to fall back to the WebSocket.
+  private sendReports(): void {
+    for (const session of this.sessions.values()) {
+      if (!session.peer) continue;
+      const payload = Buffer.alloc(12 * STREAMS.length);
+      session.streams.forEach((stream, index) => {
+        const stats = stream.stats();
+        payload.writeUInt32LE(stats.received >>> 0, index * 12);
+        payload.writeUInt32LE(stats.recovered >>> 0, index * 12 + 4);
+        payload.writeUInt32LE(stats.lost >>> 0, index * 12 + 8);
+      });
+      this.send(session, PacketType.Report, payload);
+    }
+  }
+
+  private send(session: UdpSession, type: number, payload: Buffer): void {
+    if (!this.socket || !session.peer) return;
+    const packet = buildUplinkPacket(
+      session.key,
+      { type, session: session.id, stream: 0, count: 0, seq: 0, timeMs: Date.now() >>> 0 },
+      payload,
+    );
+    this.socket.send(packet, session.peer.port, session.peer.address);
+  }
+}
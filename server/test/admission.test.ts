@@ -0,0 +1,180 @@
+import { afterEach, beforeEach, mock, test } from 'node:test';
+import assert from 'node:assert/strict';
+
+import {
+  AdmissionController,
+  AdmissionOptions,
+  AdmissionResult,
+  AdmissionTicket,
+  PRIORITY_LOW,
+  PRIORITY_NORMAL,
+  PRIORITY_SHARED,
+} from '../src/admission.js';
+
+// Shedding order and refusals of the admission controller. The load is set
+// by the test instead of measured, and the one-second samples run on mocked
+// timers.
+
+class TestAdmission extends AdmissionController {
+  cpu = 0; // Fraction of one core the next samples report
+
+  protected readSignals(): { cpu: number; lagP99Ms: number } {
+    return { cpu: this.cpu, lagP99Ms: 0 };
+  }
+}
+
+const OPTIONS: AdmissionOptions = { maxSessions: 3, cpuLimit: 1, lagLimitMs: 100, queueMs: 2_000, maxQueued: 2 };
+const SILENT = Buffer.alloc(640);
+const SPEECH = Buffer.alloc(640, 0x40);
+
+let admission: TestAdmission;
+
+beforeEach(() => {
+  mock.timers.enable({ apis: ['setInterval', 'setTimeout', 'Date'] });
+  mock.method(console, 'log', () => {});
+  admission = new TestAdmission(OPTIONS);
+  admission.start();
+});
+
+afterEach(() => {
+  admission.close();
+  mock.timers.reset();
+  mock.restoreAll();
+});
+
+// Samples with the given load until the smoothed load is within 1% of it.
+function settle(load: number): void {
+  admission.cpu = load;
+  for (let i = 0; i < 8; i++) mock.timers.tick(1_000);
+}
+
+function levelChanges(): string[] {
+  return admission
+    .stats()
+    .recent.filter((entry) => entry.decision === 'level')
+    .map((entry) => entry.reason.split(' (')[0]);
+}
+
+async function admit(priority: number, shed: number[] = []): Promise<AdmissionTicket> {
+  const result = await admission.admit(priority, (retryAfterSec) => shed.push(retryAfterSec));
+  assert.ok(result.admitted);
+  return result.ticket;
+}
+
+test('rising load sheds interim results, then silence, then sessions', async () => {
+  const shed: Record<string, number[]> = { normal: [], newerNormal: [], shared: [] };
+  await admit(PRIORITY_SHARED, shed.shared);
+  await admit(PRIORITY_NORMAL, shed.normal);
+  mock.timers.tick(10);
+  await admit(PRIORITY_NORMAL, shed.newerNormal);
+
+  settle(0.5);
+  assert.equal(admission.stats().level, 'none');
+  assert.equal(admission.dropInterim(), false);
+
+  settle(0.8);
+  assert.equal(admission.stats().level, 'interim');
+  assert.equal(admission.dropInterim(), true);
+  assert.equal(admission.dropSilence(SILENT), false);
+
+  settle(0.95);
+  assert.equal(admission.stats().level, 'silence');
+  assert.equal(admission.dropInterim(), true);
+  assert.equal(admission.dropSilence(SILENT), true);
+  assert.equal(admission.dropSilence(SPEECH), false);
+  assert.equal(admission.stats().shedSessions, 0);
+
+  // A new session waits behind the overload and is refused at its end.
+  const low = admission.admit(PRIORITY_LOW, () => {});
+  assert.equal(admission.stats().queued, 1);
+  // At full load one session ends per sample: the newest of equal priority
+  // first, the shared meeting last.
+  admission.cpu = 1.2;
+  mock.timers.tick(1_000);
+  assert.equal(admission.stats().level, 'sessions');
+  assert.deepEqual(shed.newerNormal, [15]);
+  mock.timers.tick(1_000);
+  assert.deepEqual(shed.normal, [15]);
+  assert.deepEqual(shed.shared, []);
+  assert.deepEqual(await low, {
+    admitted: false,
+    retryAfterSec: 15,
+    reason: 'waited 2000 ms: shedding sessions (load 1.14: cpu 120%/100%, lag p99 0/100 ms, 1/3 sessions)',
+  });
+  mock.timers.tick(1_000);
+  assert.deepEqual(shed.shared, [15]);
+  assert.equal(admission.stats().shedSessions, 3);
+  assert.equal(admission.stats().sessions, 0);
+
+  // The way down is one level at a time.
+  settle(0);
+  assert.deepEqual(levelChanges(), [
+    'none -> interim',
+    'interim -> silence',
+    'silence -> sessions',
+    'sessions -> silence',
+    'silence -> interim',
+    'interim -> none',
+  ]);
+  assert.equal(admission.dropInterim(), false);
+  assert.equal(admission.dropSilence(SILENT), false);
+  const counts = admission.stats();
+  assert.equal(counts.droppedInterim, 2);
+  assert.equal(counts.droppedSilence, 1);
+});
+
+test('a full server queues new sessions, then refuses them with Retry-After', async () => {
+  const tickets = [await admit(PRIORITY_NORMAL), await admit(PRIORITY_NORMAL), await admit(PRIORITY_NORMAL)];
+  assert.equal(admission.accepting(), false);
+
+  let waited: AdmissionResult | null = null;
+  let timedOut: AdmissionResult | null = null;
+  admission.admit(PRIORITY_NORMAL, () => {}).then((result) => (waited = result));
+  admission.admit(PRIORITY_NORMAL, () => {}).then((result) => (timedOut = result));
+  const overflow = await admission.admit(PRIORITY_NORMAL, () => {});
+  assert.deepEqual(overflow, { admitted: false, retryAfterSec: 5, reason: 'queue full: 3/3 sessions' });
+
+  // A session ending lets the first waiter in.
+  tickets[0].release();
+  await Promise.resolve();
+  assert.equal((waited as AdmissionResult | null)?.admitted, true);
+  assert.equal(timedOut, null);
+
+  mock.timers.tick(2_000);
+  await Promise.resolve();
+  assert.deepEqual(timedOut, { admitted: false, retryAfterSec: 5, reason: 'waited 2000 ms: 3/3 sessions' });
+  const stats = admission.stats();
+  assert.equal(stats.admitted, 4);
+  assert.equal(stats.waited, 1);
+  assert.equal(stats.rejected, 2);
+  assert.deepEqual(
+    stats.recent.map((entry) => entry.decision),
+    ['queue', 'queue', 'reject', 'reject'],
+  );
+});
+
+test('an overloaded server refuses with the longer Retry-After', async () => {
+  settle(0.95);
+  assert.equal(admission.stats().level, 'silence');
+  assert.equal(admission.accepting(), false);
+
+  const pending = admission.admit(PRIORITY_SHARED, () => {});
+  mock.timers.tick(2_000);
+  const result = await pending;
+  assert.equal(result.admitted, false);
+  assert.equal(!result.admitted && result.retryAfterSec, 15);
+  assert.match(!result.admitted ? result.reason : '', /^waited 2000 ms: shedding silence \(load 0\.9\d/);
+});
+
+test('a queued session is admitted once the load falls', async () => {
+  settle(0.95);
+  let result: AdmissionResult | null = null;
+  admission.admit(PRIORITY_NORMAL, () => {}).then((r) => (result = r));
+  // One sample at no load brings the level below silence.
+  admission.cpu = 0;
+  mock.timers.tick(1_000);
+  await Promise.resolve();
+  assert.equal(admission.stats().level, 'interim');
+  assert.equal((result as AdmissionResult | null)?.admitted, true);
+  assert.equal(admission.stats().waited, 1);
+});
@@ -0,0 +1,205 @@
+import { test } from 'node:test';
+import assert from 'node:assert/strict';
+import { AddressInfo } from 'net';
+import { performance } from 'perf_hooks';
+import { WebSocket, WebSocketServer } from 'ws';
+
+import { HubSubscriber, TranscriptHub } from '../src/transcriptHub.js';
+
+// Fan-out, slow-follower backpressure and share expiry of the transcript hub.
+// The load test runs one publisher against 1000 real /follow-style sockets
+// on loopback and prints how long an event takes to reach all of them. The
+// followers' clients share the test's event loop, so its latencies are an
+// upper bound for the relay's.
+
+// A follower socket whose writes complete only when the test says so.
+class StalledSocket implements HubSubscriber {
+  readyState = 1;
+  sent: string[] = [];
+  closedWith: number | null = null;
+  private pending: (() => void)[] = [];
+
+  send(data: Buffer, _options: { binary: boolean }, cb: (error?: Error) => void): void {
+    this.sent.push(data.toString());
+    this.pending.push(() => cb());
+  }
+
+  close(code?: number): void {
+    this.readyState = 3;
+    this.closedWith = code ?? null;
+  }
+
+  completeWrites(): void {
+    const pending = this.pending;
+    this.pending = [];
+    for (const done of pending) done();
+  }
+}
+
+const tick = () => new Promise((resolve) => setImmediate(resolve));
+
+function final(i: number): string {
+  return JSON.stringify({ type: 'transcript', source: 'system', is_final: true, text: `final ${i}`.padEnd(2000, '.') });
+}
+
+test('a stalled follower is held at the high-water mark, then dropped', async () => {
+  const hub = new TranscriptHub();
+  const { shareId } = hub.openShare();
+  const slow = new StalledSocket();
+  const fast = new StalledSocket();
+  hub.subscribe(shareId, slow);
+  hub.subscribe(shareId, fast);
+
+  // 2 KB finals: 32 of them fill the 64 KB a follower may have unwritten.
+  for (let i = 0; i < 40; i++) {
+    hub.publish(shareId, final(i), { source: 'system' });
+    await tick();
+    fast.completeWrites();
+  }
+  assert.equal(slow.sent.length, 32);
+  assert.equal(fast.sent.length, 40);
+
+  // Interims queued behind the stall collapse to the newest per source, and
+  // the final replaces the one of its source.
+  for (let i = 0; i < 10; i++) {
+    hub.publish(shareId, JSON.stringify({ type: 'transcript', source: 'mic', text: `mic ${i}` }), {
+      source: 'mic',
+      interim: true,
+    });
+  }
+  hub.publish(shareId, JSON.stringify({ type: 'transcript', source: 'system', text: 'interim' }), {
+    source: 'system',
+    interim: true,
+  });
+  hub.publish(shareId, final(40), { source: 'system' });
+  await tick();
+  fast.completeWrites();
+  await tick();
+  // Ten for each follower: nine older mic interims and the system one.
+  assert.equal(hub.stats().droppedInterim, 20);
+
+  // Once the writes complete the backlog drains in order.
+  slow.completeWrites();
+  await tick();
+  slow.completeWrites();
+  await tick();
+  const texts = slow.sent.map((s) => JSON.parse(s).text as string);
+  assert.deepEqual(
+    texts.filter((t) => t.startsWith('final')).map((t) => t.replace(/\.+$/, '')),
+    Array.from({ length: 41 }, (_, i) => `final ${i}`),
+  );
+  assert.ok(texts.includes('mic 9') && !texts.includes('mic 8') && !texts.includes('interim'));
+
+  // A follower 256 events behind is disconnected; the others are not.
+  for (let i = 0; i < 32 + 256 + 1; i++) {
+    hub.publish(shareId, final(100 + i), { source: 'system' });
+    await tick();
+    fast.completeWrites();
+  }
+  assert.equal(slow.closedWith, 1013);
+  assert.equal(fast.closedWith, null);
+  assert.equal(hub.stats().disconnectedSlow, 1);
+  assert.equal(hub.stats().followers, 1);
+  hub.close();
+});
+
+test('a share expires and refuses new followers', async () => {
+  const hub = new TranscriptHub();
+  let expired = false;
+  const { shareId, expiresAt } = hub.openShare(() => (expired = true), 30);
+  assert.ok(expiresAt > Date.now());
+  const follower = new StalledSocket();
+  assert.ok(hub.subscribe(shareId, follower));
+
+  await new Promise((resolve) => setTimeout(resolve, 60));
+  assert.ok(expired);
+  assert.deepEqual(JSON.parse(follower.sent.at(-1)!), { type: 'share_ended', reason: 'expired' });
+  assert.equal(follower.closedWith, 1000);
+  assert.equal(hub.subscribe(shareId, new StalledSocket()), null);
+  assert.equal(hub.stats().shares, 0);
+});
+
+test('late followers get the recent finals', async () => {
+  const hub = new TranscriptHub();
+  const { shareId } = hub.openShare();
+  for (let i = 0; i < 60; i++) hub.publish(shareId, `{"n":${i}}`, { source: 'mic' });
+  hub.publish(shareId, '{"interim":true}', { source: 'mic', interim: true });
+  const late = new StalledSocket();
+  hub.subscribe(shareId, late);
+  await tick();
+  assert.deepEqual(
+    late.sent.map((s) => JSON.parse(s).n),
+    Array.from({ length: 50 }, (_, i) => i + 10),
+  );
+  hub.close();
+});
+
+test('fan-out of one publisher to 1000 followers over loopback', async () => {
+  const FOLLOWERS = 1000;
+  const EVENTS = 100;
+  const hub = new TranscriptHub();
+  const { shareId } = hub.openShare();
+
+  const wss = new WebSocketServer({ port: 0, host: '127.0.0.1' });
+  await new Promise((resolve) => wss.once('listening', resolve));
+  wss.on('connection', (ws) => hub.subscribe(shareId, ws));
+  const url = `ws://127.0.0.1:${(wss.address() as AddressInfo).port}`;
+
+  const received = new Array<number>(FOLLOWERS).fill(0);
+  const arrivals: number[][] = Array.from({ length: EVENTS }, () => []);
+  let outOfOrder = 0;
+  const clients: WebSocket[] = [];
+  for (let i = 0; i < FOLLOWERS; i += 100) {
+    const batch = Array.from({ length: Math.min(100, FOLLOWERS - i) }, (_, j) => {
+      const client = new WebSocket(url);
+      const index = i + j;
+      client.on('message', (data) => {
+        const event = JSON.parse(data.toString());
+        if (event.n !== received[index]) outOfOrder++;
+        received[index]++;
+        arrivals[event.n].push(performance.now());
+      });
+      clients.push(client);
+      return new Promise((resolve) => client.once('open', resolve));
+    });
+    await Promise.all(batch);
+  }
+  while (hub.stats().followers < FOLLOWERS) await tick();
+
+  // A final every 20 ms, about the rate of a busy meeting's finals and
+  // interims together.
+  const publishedAt: number[] = [];
+  const publishMs: number[] = [];
+  for (let n = 0; n < EVENTS; n++) {
+    const payload = JSON.stringify({ type: 'transcript', source: 'system', is_final: true, n, text: 'x'.repeat(200) });
+    publishedAt.push(performance.now());
+    const start = performance.now();
+    hub.publish(shareId, payload, { source: 'system' });
+    publishMs.push(performance.now() - start);
+    await new Promise((resolve) => setTimeout(resolve, 20));
+  }
+  const deadline = Date.now() + 10_000;
+  while (received.some((count) => count < EVENTS) && Date.now() < deadline) {
+    await new Promise((resolve) => setTimeout(resolve, 10));
+  }
+
+  const allReached = arrivals.map((times, n) => Math.max(...times) - publishedAt[n]).sort((a, b) => a - b);
+  const each = arrivals.flatMap((times, n) => times.map((t) => t - publishedAt[n])).sort((a, b) => a - b);
+  const pct = (values: number[], p: number) => values[Math.min(values.length - 1, Math.floor(values.length * p))];
+  publishMs.sort((a, b) => a - b);
+  const stats = hub.stats();
+  console.log(
+    `1 -> ${FOLLOWERS} followers, ${EVENTS} events: delivered ${stats.delivered}, ` +
+      `per follower p50 ${pct(each, 0.5).toFixed(1)} ms p99 ${pct(each, 0.99).toFixed(1)} ms, ` +
+      `last follower p50 ${pct(allReached, 0.5).toFixed(1)} ms p99 ${pct(allReached, 0.99).toFixed(1)} ms, ` +
+      `publish() p50 ${(pct(publishMs, 0.5) * 1000).toFixed(0)} us p99 ${(pct(publishMs, 0.99) * 1000).toFixed(0)} us`,
+  );
+
+  assert.ok(received.every((count) => count === EVENTS), 'every follower got every event');
+  assert.equal(outOfOrder, 0);
+  assert.equal(stats.disconnectedSlow, 0);
+
+  for (const client of clients) client.terminate();
+  hub.close();
+  await new Promise((resolve) => wss.close(resolve));
+});
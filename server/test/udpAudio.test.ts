@@ -0,0 +1,299 @@
+import { test } from 'node:test';
+import assert from 'node:assert/strict';
+import dgram from 'dgram';
+
+import { buildUplinkPacket, deriveUplinkKey, JitterBuffer, UdpAudioReceiver } from '../src/udpAudio.js';
+
+// The datagram uplink's receiving side under a local loss/delay emulator.
+// Packets are laid out the way windows/runner/audio_uplink.cpp sends them:
+// 50 ms of PCM per chunk split into at most 1024-byte packets, XOR parity
+// every 4 packets and a shorter one closing the group at an utterance end.
+// The emulator runs on a virtual clock, so the numbers do not depend on the
+// machine; the last test goes through real loopback sockets.
+
+const AUDIO = 3;
+const PARITY = 4;
+const FINALIZE = 7;
+const MAX_PAYLOAD = 1024;
+const FEC_GROUP = 4;
+const CHUNK_BYTES = 1600; // 50 ms of 16 kHz PCM16
+const CHUNK_MS = 50;
+const JITTER_MS = 80; // The relay's default UDP_AUDIO_JITTER_MS
+const TICK_MS = 10;
+const UTTERANCE_CHUNKS = 40;
+const UTTERANCE_SAMPLES = (UTTERANCE_CHUNKS * CHUNK_BYTES) / 2;
+
+interface Datagram {
+  type: number;
+  seq: number;
+  count: number;
+  payload: Buffer;
+}
+
+// Deterministic PRNG (mulberry32), so a failing profile can be replayed.
+function random(seed: number): () => number {
+  let state = seed >>> 0;
+  return () => {
+    state = (state + 0x6d2b79f5) >>> 0;
+    let t = state;
+    t = Math.imul(t ^ (t >>> 15), t | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+}
+
+// Audio whose every 16-bit sample is its own offset in the stream, so any
+// reordering, gap or corruption shows up in what is delivered.
+function ramp(offsetSamples: number, bytes: number): Buffer {
+  const audio = Buffer.alloc(bytes);
+  for (let i = 0; i < bytes / 2; i++) audio.writeUInt16LE((offsetSamples + i) & 0xffff, i * 2);
+  return audio;
+}
+
+class Sender {
+  private seq = 0;
+  private group: Buffer[] = [];
+  private first = 0;
+
+  send(audio: Buffer): Datagram[] {
+    const out: Datagram[] = [];
+    for (let offset = 0; offset < audio.length; offset += MAX_PAYLOAD) {
+      const payload = audio.subarray(offset, Math.min(audio.length, offset + MAX_PAYLOAD));
+      if (this.group.length === 0) this.first = this.seq;
+      out.push({ type: AUDIO, seq: this.seq++, count: 0, payload });
+      this.group.push(payload);
+      if (this.group.length === FEC_GROUP) out.push(this.closeGroup());
+    }
+    return out;
+  }
+
+  finalize(): Datagram[] {
+    const out = this.group.length > 0 ? [this.closeGroup()] : [];
+    out.push({ type: FINALIZE, seq: this.seq, count: 0, payload: Buffer.alloc(0) });
+    return out;
+  }
+
+  private closeGroup(): Datagram {
+    const parity = Buffer.alloc(2 + Math.max(...this.group.map((p) => p.length)));
+    for (const payload of this.group) {
+      parity[0] ^= payload.length & 0xff;
+      parity[1] ^= payload.length >> 8;
+      for (let i = 0; i < payload.length; i++) parity[i + 2] ^= payload[i];
+    }
+    const datagram = { type: PARITY, seq: this.first, count: this.group.length, payload: parity };
+    this.group = [];
+    return datagram;
+  }
+}
+
+interface ChannelProfile {
+  name: string;
+  loss: number; // Chance a datagram is dropped
+  burst: number; // Chance the next one is dropped too, after a drop
+  delayMs: number;
+  jitterMs: number; // Uniform extra delay, which also reorders
+}
+
+interface EmulatorResult {
+  deliveredFraction: number;
+  corruptSamples: number;
+  p50Ms: number;
+  p99Ms: number;
+  finalizesEarly: number;
+  stats: ReturnType<JitterBuffer['stats']>;
+}
+
+// Streams |seconds| of speech in 2-second utterances through the channel
+// into a JitterBuffer, all on a virtual clock.
+function emulate(profile: ChannelProfile, seconds: number, seed: number): EmulatorResult {
+  const rand = random(seed);
+  const sender = new Sender();
+  const arrivals: { at: number; datagram: Datagram }[] = [];
+  const sentAt = new Map<number, number>(); // First sample -> send time
+  let dropping = false;
+  const transmit = (now: number, datagrams: Datagram[]) => {
+    for (const datagram of datagrams) {
+      dropping = rand() < (dropping ? profile.burst : profile.loss);
+      if (dropping) continue;
+      arrivals.push({ at: now + profile.delayMs + rand() * profile.jitterMs, datagram });
+    }
+  };
+
+  const chunks = (seconds * 1000) / CHUNK_MS;
+  for (let i = 0; i < chunks; i++) {
+    const now = i * CHUNK_MS;
+    sentAt.set((i * CHUNK_BYTES) / 2, now);
+    transmit(now, sender.send(ramp((i * CHUNK_BYTES) / 2, CHUNK_BYTES)));
+    if ((i + 1) % UTTERANCE_CHUNKS === 0) transmit(now, sender.finalize());
+  }
+  arrivals.sort((a, b) => a.at - b.at);
+
+  let now = 0;
+  let expected = 0; // Next sample offset, mod 2^16
+  let delivered = 0;
+  let corrupt = 0;
+  let ended = 0; // Utterances finalized
+  let finalizesEarly = 0;
+  const latencies: number[] = [];
+  const buffer = new JitterBuffer(
+    JITTER_MS,
+    (audio) => {
+      const first = audio.readUInt16LE(0);
+      // Skipped gaps are whole packets; resynchronize on the first sample.
+      const offset = delivered + ((first - expected) & 0xffff);
+      for (let i = 0; i < audio.length / 2; i++) {
+        if (audio.readUInt16LE(i * 2) !== ((first + i) & 0xffff)) corrupt++;
+      }
+      const chunkStart = offset - (offset % (CHUNK_BYTES / 2));
+      const sent = sentAt.get(chunkStart);
+      if (sent !== undefined && offset === chunkStart) latencies.push(now - sent);
+      delivered = offset + audio.length / 2;
+      expected = (first + audio.length / 2) & 0xffff;
+      // No audio of an utterance may follow its end.
+      if (Math.floor(offset / UTTERANCE_SAMPLES) < ended) finalizesEarly++;
+    },
+    () => ended++,
+  );
+
+  let next = 0;
+  const end = seconds * 1000 + profile.delayMs + profile.jitterMs + JITTER_MS * 4;
+  for (now = 0; now <= end; now += TICK_MS) {
+    for (; next < arrivals.length && arrivals[next].at <= now; next++) {
+      const { datagram } = arrivals[next];
+      if (datagram.type === AUDIO) buffer.push(datagram.seq, datagram.payload, now);
+      else if (datagram.type === PARITY) buffer.pushParity(datagram.seq, datagram.count, datagram.payload, now);
+      else buffer.pushFinalize(datagram.seq, now);
+    }
+    buffer.flush(now);
+  }
+
+  const stats = buffer.stats();
+  latencies.sort((a, b) => a - b);
+  const totalPackets = chunks * Math.ceil(CHUNK_BYTES / MAX_PAYLOAD);
+  return {
+    deliveredFraction: (stats.received + stats.recovered) / totalPackets,
+    corruptSamples: corrupt,
+    p50Ms: latencies[Math.floor(latencies.length / 2)],
+    p99Ms: latencies[Math.floor(latencies.length * 0.99)],
+    finalizesEarly,
+    stats,
+  };
+}
+
+test('packets match the native wire format', () => {
+  // Same vector as windows/runner/tests/uplink_test.cpp.
+  const key = deriveUplinkKey('test-token', Buffer.from('000102030405060708090a0b0c0d0e0f', 'hex'));
+  const packet = buildUplinkPacket(
+    key,
+    { type: AUDIO, session: 0x01020304, stream: 1, count: 0, seq: 5, timeMs: 1000 },
+    Buffer.from('pcm!'),
+  );
+  assert.equal(packet.toString('hex'), '48550103040302010100040005000000e803000070636d210217b630e2d703d9');
+});
+
+test('jitter buffer under emulated loss and delay', () => {
+  const profiles: { profile: ChannelProfile; minDelivered: number }[] = [
+    { profile: { name: 'clean', loss: 0, burst: 0, delayMs: 20, jitterMs: 0 }, minDelivered: 1 },
+    { profile: { name: 'wifi', loss: 0.02, burst: 0.02, delayMs: 20, jitterMs: 30 }, minDelivered: 0.995 },
+    { profile: { name: 'lossy', loss: 0.05, burst: 0.05, delayMs: 40, jitterMs: 60 }, minDelivered: 0.985 },
+    { profile: { name: 'bursty', loss: 0.03, burst: 0.5, delayMs: 30, jitterMs: 40 }, minDelivered: 0.95 },
+  ];
+  for (const { profile, minDelivered } of profiles) {
+    const result = emulate(profile, 120, 7);
+    console.log(
+      `${profile.name.padEnd(6)} loss ${(profile.loss * 100).toFixed(0)}% ` +
+        `delay ${profile.delayMs}+${profile.jitterMs} ms: delivered ` +
+        `${(result.deliveredFraction * 100).toFixed(2)}%, recovered ${result.stats.recovered}, ` +
+        `lost ${result.stats.lost}, late ${result.stats.late}, latency p50 ${result.p50Ms} ms ` +
+        `p99 ${result.p99Ms} ms`,
+    );
+    assert.ok(result.deliveredFraction >= minDelivered, `${profile.name} delivered too little`);
+    assert.equal(result.corruptSamples, 0, `${profile.name} delivered corrupt audio`);
+    assert.equal(result.finalizesEarly, 0, `${profile.name} finalized before the utterance's audio`);
+    // A gap never holds audio back for much more than the jitter delay.
+    assert.ok(result.p99Ms <= profile.delayMs + profile.jitterMs + JITTER_MS + 2 * TICK_MS);
+  }
+});
+
+test('finalize waits for the audio it follows', () => {
+  const ends: string[] = [];
+  const buffer = new JitterBuffer(
+    JITTER_MS,
+    (audio) => ends.push(`audio ${audio[0]}`),
+    () => ends.push('finalize'),
+  );
+  // The finalize overtakes the utterance's last two packets.
+  buffer.push(0, Buffer.from([0]), 0);
+  buffer.pushFinalize(3, 5);
+  buffer.push(2, Buffer.from([2]), 10);
+  assert.deepEqual(ends, ['audio 0']);
+  buffer.push(1, Buffer.from([1]), 12);
+  assert.deepEqual(ends, ['audio 0', 'audio 1', 'audio 2', 'finalize']);
+
+  // A repeated finalize is ignored; one behind a lost packet fires once the
+  // gap is given up.
+  buffer.pushFinalize(3, 20);
+  buffer.pushFinalize(5, 20);
+  buffer.flush(20 + JITTER_MS - 1);
+  assert.equal(ends.length, 4);
+  buffer.flush(20 + JITTER_MS);
+  assert.deepEqual(ends.slice(4), ['finalize']);
+  assert.equal(buffer.stats().lost, 2);
+});
+
+test('receiver delivers audio and its finalize over loopback', async () => {
+  const probe = dgram.createSocket('udp4');
+  await new Promise<void>((resolve) => probe.bind(0, '127.0.0.1', resolve));
+  const port = probe.address().port;
+  probe.close();
+
+  const receiver = new UdpAudioReceiver({ port, jitterMs: JITTER_MS, reportIntervalMs: 50 });
+  receiver.start();
+  const events: string[] = [];
+  const { sessionId, nonce } = receiver.createSession(
+    'test-token',
+    (source, audio) => events.push(`${source} ${audio.length}`),
+    (source) => events.push(`${source} finalize`),
+  );
+  const key = deriveUplinkKey('test-token', Buffer.from(nonce, 'hex'));
+
+  const client = dgram.createSocket('udp4');
+  const welcomed = new Promise<void>((resolve) => client.once('message', () => resolve()));
+  await new Promise<void>((resolve) => client.bind(0, '127.0.0.1', resolve));
+  let timeMs = 1;
+  const send = (type: number, stream: number, datagram?: Datagram) =>
+    client.send(
+      buildUplinkPacket(
+        key,
+        { type, session: sessionId, stream, count: datagram?.count ?? 0, seq: datagram?.seq ?? 0, timeMs: timeMs++ },
+        datagram?.payload ?? Buffer.alloc(0),
+      ),
+      port,
+      '127.0.0.1',
+    );
+
+  await new Promise((resolve) => setTimeout(resolve, 20)); // Let the receiver bind
+  send(1, 0); // Hello
+  await welcomed;
+
+  const sender = new Sender();
+  const datagrams = [...sender.send(ramp(0, CHUNK_BYTES)), ...sender.finalize()];
+  // The finalize first, then the audio it ends, with its first packet lost
+  // and rebuilt from parity.
+  send(FINALIZE, 0, datagrams.find((d) => d.type === FINALIZE));
+  for (const datagram of datagrams.filter((d) => d.type !== FINALIZE && d.seq !== 0)) {
+    send(datagram.type, 0, datagram);
+  }
+  send(PARITY, 0, datagrams.find((d) => d.type === PARITY));
+  // A tampered packet is rejected.
+  const forged = buildUplinkPacket(key, { type: AUDIO, session: sessionId, stream: 1, count: 0, seq: 0, timeMs: timeMs++ }, Buffer.from('xx'));
+  forged[forged.length - 1] ^= 1;
+  client.send(forged, port, '127.0.0.1');
+
+  await new Promise((resolve) => setTimeout(resolve, 100));
+  assert.deepEqual(events, ['mic 1024', 'mic 576', 'mic finalize']);
+  assert.equal(receiver.stats().rejected, 1);
+
+  client.close();
+  receiver.close();
+});
@@ -0,0 +1,338 @@
+#include "answer_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <queue>
+
+namespace {
+
+constexpr float kWordWeight = 1.0f;
+constexpr float kPairWeight = 0.8f;
+constexpr float kTrigramWeight = 0.35f;
+// Function words still count a little: "what is" vs "what was" matters less
+// than the content words around them.
+constexpr float kStopWordScale = 0.25f;
+
+const char* const kStopWords[] = {
+    "a",    "about", "an",   "and",  "are",   "as",   "at",    "be",    "can",  "could",
+    "did",  "do",    "does", "for",  "from",  "have", "how",   "i",     "if",   "in",
+    "is",   "it",    "me",   "my",   "of",    "on",   "or",    "so",    "tell", "that",
+    "the",  "this",  "to",   "was",  "we",    "what", "when",  "where", "which", "who",
+    "why",  "will",  "with", "would", "you",  "your", "um",    "uh",    "like", "just",
+};
+
+static uint64_t Fnv1a(const char* data, size_t length, uint64_t seed) {
+  uint64_t hash = 1469598103934665603ull ^ seed;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= static_cast<uint8_t>(data[i]);
+    hash *= 1099511628211ull;
+  }
+  // Final avalanche so low bits (the bucket) depend on every byte.
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+static void AddFeature(const std::string& feature, uint64_t seed, float weight, float* acc) {
+  const uint64_t hash = Fnv1a(feature.data(), feature.size(), seed);
+  const int bucket = static_cast<int>(hash % kEmbeddingDims);
+  acc[bucket] += (hash >> 63) ? -weight : weight;
+}
+
+static bool IsStopWord(const std::string& word) {
+  for (const char* stop : kStopWords) {
+    if (word == stop) return true;
+  }
+  return false;
+}
+
+// Lowercased ASCII letters/digits and any non-ASCII bytes form words;
+// everything else separates them.
+static std::vector<std::string> Tokenize(const std::string& utf8) {
+  std::vector<std::string> words;
+  std::string current;
+  for (const char c : utf8) {
+    const uint8_t byte = static_cast<uint8_t>(c);
+    if (byte >= 0x80 || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z')) {
+      current.push_back(c);
+    } else if (c >= 'A' && c <= 'Z') {
+      current.push_back(static_cast<char>(c - 'A' + 'a'));
+    } else if (c == '\'') {
+      continue;  // "don't" == "dont"
+    } else if (!current.empty()) {
+      words.push_back(std::move(current));
+      current.clear();
+    }
+  }
+  if (!current.empty()) words.push_back(std::move(current));
+  return words;
+}
+
+}  // namespace
+
+void EmbedText(const std::string& utf8, TextEmbedding* out) {
+  float acc[kEmbeddingDims] = {};
+  const auto words = Tokenize(utf8);
+  std::vector<float> scale(words.size());
+  for (size_t i = 0; i < words.size(); i++) {
+    scale[i] = IsStopWord(words[i]) ? kStopWordScale : 1.0f;
+  }
+
+  for (size_t i = 0; i < words.size(); i++) {
+    const std::string& word = words[i];
+    AddFeature(word, 1, kWordWeight * scale[i], acc);
+    if (i + 1 < words.size()) {
+      AddFeature(word + ' ' + words[i + 1], 2, kPairWeight * (std::max)(scale[i], scale[i + 1]),
+                 acc);
+    }
+    // Trigrams of " word " tolerate ASR misspellings and inflections.
+    if (scale[i] == 1.0f) {
+      const std::string padded = ' ' + word + ' ';
+      for (size_t j = 0; j + 3 <= padded.size(); j++) {
+        AddFeature(padded.substr(j, 3), 3, kTrigramWeight, acc);
+      }
+    }
+  }
+
+  float max_abs = 0.0f;
+  for (const float v : acc) max_abs = (std::max)(max_abs, std::fabs(v));
+  float norm_sq = 0.0f;
+  for (int d = 0; d < kEmbeddingDims; d++) {
+    const float q = max_abs > 0.0f ? std::round(acc[d] * 127.0f / max_abs) : 0.0f;
+    out->values[d] = static_cast<int8_t>(q);
+    norm_sq += q * q;
+  }
+  out->norm = std::sqrt(norm_sq);
+}
+
+float EmbeddingSimilarity(const TextEmbedding& a, const TextEmbedding& b) {
+  if (a.norm == 0.0f || b.norm == 0.0f) return 0.0f;
+  int32_t dot = 0;
+  for (int d = 0; d < kEmbeddingDims; d++) {
+    dot += static_cast<int32_t>(a.values[d]) * static_cast<int32_t>(b.values[d]);
+  }
+  return static_cast<float>(dot) / (a.norm * b.norm);
+}
+
+AnswerIndex::AnswerIndex(int m, int ef_construction, int ef_search)
+    : m_((std::max)(2, m)),
+      ef_construction_((std::max)(m_, ef_construction)),
+      ef_search_(ef_search),
+      level_scale_(1.0 / std::log(static_cast<double>(m_))) {}
+
+float AnswerIndex::Distance(const TextEmbedding& query, uint32_t node) const {
+  return 1.0f - EmbeddingSimilarity(query, nodes_[node].embedding);
+}
+
+void AnswerIndex::Upsert(const std::string& id, const std::string& text,
+                         const std::string& payload) {
+  Remove(id);
+
+  Node node;
+  node.id = id;
+  node.payload = payload;
+  EmbedText(text, &node.embedding);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  const double u = (std::max)(1e-12, uniform(rng_));
+  const int level = (std::min)(16, static_cast<int>(-std::log(u) * level_scale_));
+  node.links.resize(level + 1);
+
+  const uint32_t index = static_cast<uint32_t>(nodes_.size());
+  nodes_.push_back(std::move(node));
+  visited_.push_back(0);
+  ids_[id] = index;
+  Insert(index);
+}
+
+void AnswerIndex::Insert(uint32_t node) {
+  const int level = static_cast<int>(nodes_[node].links.size()) - 1;
+  if (top_level_ < 0) {
+    entry_point_ = node;
+    top_level_ = level;
+    return;
+  }
+
+  const TextEmbedding& query = nodes_[node].embedding;
+  uint32_t entry = Descend(query, entry_point_, top_level_, level);
+  for (int l = (std::min)(level, top_level_); l >= 0; l--) {
+    const auto candidates = SearchLevel(query, entry, ef_construction_, l);
+    const size_t max_links = l == 0 ? 2 * m_ : m_;
+    for (const uint32_t neighbor : SelectNeighbors(candidates, max_links)) {
+      nodes_[node].links[l].push_back(neighbor);
+      Link(neighbor, node, l);
+    }
+    entry = candidates.front().node;
+  }
+  if (level > top_level_) {
+    entry_point_ = node;
+    top_level_ = level;
+  }
+}
+
+void AnswerIndex::Link(uint32_t from, uint32_t to, int level) {
+  auto& links = nodes_[from].links[level];
+  links.push_back(to);
+  const size_t max_links = level == 0 ? 2 * m_ : m_;
+  if (links.size() <= max_links) return;
+
+  // Over capacity: re-select from the current neighbours plus the new one.
+  std::vector<Candidate> candidates;
+  candidates.reserve(links.size());
+  for (const uint32_t neighbor : links) {
+    candidates.push_back({Distance(nodes_[from].embedding, neighbor), neighbor});
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate& a, const Candidate& b) { return a.distance < b.distance; });
+  links = SelectNeighbors(candidates, max_links);
+}
+
+std::vector<uint32_t> AnswerIndex::SelectNeighbors(const std::vector<Candidate>& candidates,
+                                                   size_t max_links) const {
+  std::vector<uint32_t> kept;
+  std::vector<uint32_t> skipped;
+  for (const Candidate& c : candidates) {
+    if (kept.size() >= max_links) break;
+    bool diverse = true;
+    for (const uint32_t k : kept) {
+      if (Distance(nodes_[c.node].embedding, k) < c.distance) {
+        diverse = false;
+        break;
+      }
+    }
+    (diverse ? kept : skipped).push_back(c.node);
+  }
+  // Fill up with the nearest skipped ones so small graphs stay connected.
+  for (size_t i = 0; i < skipped.size() && kept.size() < max_links; i++) {
+    kept.push_back(skipped[i]);
+  }
+  return kept;
+}
+
+uint32_t AnswerIndex::Descend(const TextEmbedding& query, uint32_t entry, int from_level,
+                              int to_level) {
+  float best = Distance(query, entry);
+  for (int l = from_level; l > to_level; l--) {
+    bool improved = true;
+    while (improved) {
+      improved = false;
+      for (const uint32_t neighbor : nodes_[entry].links[l]) {
+        const float d = Distance(query, neighbor);
+        if (d < best) {
+          best = d;
+          entry = neighbor;
+          improved = true;
+        }
+      }
+    }
+  }
+  return entry;
+}
+
+std::vector<AnswerIndex::Candidate> AnswerIndex::SearchLevel(const TextEmbedding& query,
+                                                             uint32_t entry, int ef, int level) {
+  auto nearer = [](const Candidate& a, const Candidate& b) { return a.distance > b.distance; };
+  auto farther = [](const Candidate& a, const Candidate& b) { return a.distance < b.distance; };
+  std::priority_queue<Candidate, std::vector<Candidate>, decltype(nearer)> frontier(nearer);
+  std::priority_queue<Candidate, std::vector<Candidate>, decltype(farther)> best(farther);
+
+  if (++visit_epoch_ == 0) {
+    std::fill(visited_.begin(), visited_.end(), 0);
+    visit_epoch_ = 1;
+  }
+  const Candidate start{Distance(query, entry), entry};
+  visited_[entry] = visit_epoch_;
+  frontier.push(start);
+  best.push(start);
+
+  while (!frontier.empty()) {
+    const Candidate current = frontier.top();
+    if (current.distance > best.top().distance && best.size() >= static_cast<size_t>(ef)) break;
+    frontier.pop();
+    for (const uint32_t neighbor : nodes_[current.node].links[level]) {
+      if (visited_[neighbor] == visit_epoch_) continue;
+      visited_[neighbor] = visit_epoch_;
+      const float d = Distance(query, neighbor);
+      if (best.size() < static_cast<size_t>(ef) || d < best.top().distance) {
+        frontier.push({d, neighbor});
+        best.push({d, neighbor});
+        if (best.size() > static_cast<size_t>(ef)) best.pop();
+      }
+    }
+  }
+
+  std::vector<Candidate> result(best.size());
+  for (size_t i = result.size(); i > 0; i--) {
+    result[i - 1] = best.top();
+    best.pop();
+  }
+  return result;
+}
+
+std::vector<AnswerIndex::Match> AnswerIndex::Search(const std::string& text, size_t k,
+                                                    float min_similarity,
+                                                    const std::string& id_prefix) {
+  TextEmbedding query;
+  EmbedText(text, &query);
+  return Search(query, k, min_similarity, id_prefix);
+}
+
+std::vector<AnswerIndex::Match> AnswerIndex::Search(const TextEmbedding& query, size_t k,
+                                                    float min_similarity,
+                                                    const std::string& id_prefix) {
+  std::vector<Match> matches;
+  if (top_level_ < 0 || k == 0 || query.norm == 0.0f) return matches;
+
+  const uint32_t entry = Descend(query, entry_point_, top_level_, 0);
+  // Removed entries still occupy result slots, so widen the beam by them.
+  const int ef = (std::max)(ef_search_, static_cast<int>(k)) +
+                 static_cast<int>((std::min)(deleted_, static_cast<size_t>(ef_search_)));
+  for (const Candidate& c : SearchLevel(query, entry, ef, 0)) {
+    const Node& node = nodes_[c.node];
+    if (node.deleted || node.id.compare(0, id_prefix.size(), id_prefix) != 0) continue;
+    const float similarity = 1.0f - c.distance;
+    if (similarity < min_similarity || matches.size() >= k) break;
+    matches.push_back({node.id, node.payload, similarity});
+  }
+  return matches;
+}
+
+bool AnswerIndex::Remove(const std::string& id) {
+  auto it = ids_.find(id);
+  if (it == ids_.end()) return false;
+  Node& node = nodes_[it->second];
+  node.deleted = true;
+  node.payload.clear();
+  node.payload.shrink_to_fit();
+  ids_.erase(it);
+  deleted_++;
+  if (deleted_ * 2 > nodes_.size()) Rebuild();
+  return true;
+}
+
+void AnswerIndex::Clear() {
+  nodes_.clear();
+  ids_.clear();
+  visited_.clear();
+  top_level_ = -1;
+  entry_point_ = 0;
+  deleted_ = 0;
+}
+
+void AnswerIndex::Rebuild() {
+  std::vector<Node> live;
+  live.reserve(nodes_.size() - deleted_);
+  for (auto& node : nodes_) {
+    if (node.deleted) continue;
+    for (auto& level : node.links) level.clear();
+    live.push_back(std::move(node));
+  }
+  Clear();
+  nodes_ = std::move(live);
+  visited_.assign(nodes_.size(), 0);
+  for (uint32_t i = 0; i < nodes_.size(); i++) {
+    ids_[nodes_[i].id] = i;
+    Insert(i);
+  }
+}
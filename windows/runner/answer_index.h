@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Text embedding for short questions: words, word pairs and character
+// trigrams hashed into kEmbeddingDims signed buckets (common function words
+// down-weighted), L2-normalized and quantized to int8, so an entry costs a
+// few hundred bytes and a comparison is one integer dot product.
+constexpr int kEmbeddingDims = 256;
+
+struct TextEmbedding {
+  int8_t values[kEmbeddingDims];
+  float norm = 0.0f;  // Of the quantized values; 0 for empty text
+};
+
+void EmbedText(const std::string& utf8, TextEmbedding* out);
+float EmbeddingSimilarity(const TextEmbedding& a, const TextEmbedding& b);
+
+// Nearest-neighbour index over prepared questions and past AI answers, so a
+// detected question can be matched to something already answered while the
+// live AI call is still in flight.
+//
+// An HNSW graph (hierarchical navigable small world): each entry links to its
+// closest few entries on level 0 and, with geometrically falling
+// probability, on sparser levels above, and a search descends greedily from
+// the top before a bounded best-first search on level 0. Entries are added
+// and removed one at a time; removed entries stay in the graph as waypoints
+// until they make up half of it, when it is rebuilt. Platform thread only.
+class AnswerIndex {
+ public:
+  struct Match {
+    std::string id;
+    std::string payload;
+    float similarity = 0.0f;  // Cosine, 1 for identical text
+  };
+
+  // |m| links per entry on the upper levels (2m on level 0).
+  explicit AnswerIndex(int m = 12, int ef_construction = 100, int ef_search = 48);
+
+  // Adds |text| under |id|, replacing any entry with that id. |payload| is
+  // handed back with matches (e.g. the stored answer).
+  void Upsert(const std::string& id, const std::string& text, const std::string& payload);
+  bool Remove(const std::string& id);
+  void Clear();
+
+  // Up to |k| entries with similarity >= |min_similarity|, best first. A
+  // non-empty |id_prefix| skips entries whose id does not start with it
+  // before they take one of the |k| slots.
+  std::vector<Match> Search(const std::string& text, size_t k, float min_similarity,
+                            const std::string& id_prefix = std::string());
+  std::vector<Match> Search(const TextEmbedding& query, size_t k, float min_similarity,
+                            const std::string& id_prefix = std::string());
+
+  size_t size() const { return ids_.size(); }
+  void set_ef_search(int ef) { ef_search_ = ef; }
+
+ private:
+  struct Node {
+    std::string id;
+    std::string payload;
+    TextEmbedding embedding;
+    bool deleted = false;
+    // links[level] for levels 0..top.
+    std::vector<std::vector<uint32_t>> links;
+  };
+
+  struct Candidate {
+    float distance;
+    uint32_t node;
+  };
+
+  float Distance(const TextEmbedding& query, uint32_t node) const;
+  void Insert(uint32_t node);
+  // Best-first search of one level from |entry|; returns up to |ef| nodes,
+  // nearest first.
+  std::vector<Candidate> SearchLevel(const TextEmbedding& query, uint32_t entry, int ef,
+                                     int level);
+  uint32_t Descend(const TextEmbedding& query, uint32_t entry, int from_level, int to_level);
+  // Keeps up to |max_links| of |candidates| that are not closer to an
+  // already kept neighbour than to the base node (HNSW's neighbour heuristic).
+  std::vector<uint32_t> SelectNeighbors(const std::vector<Candidate>& candidates,
+                                        size_t max_links) const;
+  void Link(uint32_t from, uint32_t to, int level);
+  void Rebuild();
+
+  int m_;
+  int ef_construction_;
+  int ef_search_;
+  double level_scale_;
+  std::mt19937 rng_{0x5eed};
+
+  std::vector<Node> nodes_;
+  std::unordered_map<std::string, uint32_t> ids_;  // Live entries only
+  uint32_t entry_point_ = 0;
+  int top_level_ = -1;
+  size_t deleted_ = 0;
+
+  // Visited marks for searches, by epoch so they need no clearing.
+  std::vector<uint32_t> visited_;
+  uint32_t visit_epoch_ = 0;
+};
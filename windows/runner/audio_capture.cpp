@@ -1,7 +1,11 @@
 #include "audio_capture.h"
+#include "audio_clock.h"
+#include "power_state.h"
+#include "tracepoints.h"
 #include <iostream>
 #include <cstring>
 #include <algorithm>
+#include <iterator>
 #include <vector>
 #include <Windows.h>
 #include <ksmedia.h>
@@ -141,8 +145,46 @@ AudioCapture::~AudioCapture() {
   CleanupWASAPI();
 }
 
+void AudioCapture::SetMemoryGovernor(MemoryGovernor* governor) {
+  queue_pool_.SetShrinkCallback([this](size_t) {
+    std::lock_guard<std::mutex> lock(frames_mutex_);
+    TrimQueueLocked(queue_pool_.limit());
+  });
+  history_pool_.SetShrinkCallback([this](size_t) {
+    std::lock_guard<std::mutex> lock(frames_mutex_);
+    history_.FitToPool(&history_pool_);
+  });
+  queue_pool_.Attach(governor);
+  history_pool_.Attach(governor);
+}
+
+void AudioCapture::TrimQueueLocked(size_t max_bytes) {
+  size_t dropped = 0;
+  while (audio_bytes_.size() > max_bytes) {
+    audio_bytes_.pop_front();
+    bytes_consumed_++;
+    dropped++;
+  }
+  queue_pool_.Reserve(audio_bytes_.size());
+  if (dropped > 0) {
+    HN_TRACE_BUFFER_OVERRUN(kTraceSystem, dropped, audio_bytes_.size());
+  }
+}
+
 bool AudioCapture::StartSystemAudio() {
   std::cout << "[AudioCapture] Starting system audio capture" << std::endl;
+
+  // Follow the default output if it changed since the client was set up
+  // (headphones plugged in, a call app switched devices).
+  AudioDeviceInfo default_render;
+  if (is_initialized_ && device_registry_ &&
+      device_registry_->Default(AudioDeviceFlow::kRender, &default_render) &&
+      default_render.id != loopback_device_id_) {
+    std::cout << "[AudioCapture] Default output changed to " << default_render.name
+              << std::endl;
+    CleanupWASAPI();
+    is_initialized_ = false;
+  }
   
   if (!is_initialized_) {
     if (!InitializeWASAPI()) {
@@ -157,6 +199,36 @@ bool AudioCapture::StartSystemAudio() {
     return false;
   }
 
+  {
+    std::lock_guard<std::mutex> lock(frames_mutex_);
+    audio_bytes_.clear();
+    queue_pool_.Reserve(0);
+    bytes_consumed_ = 0;
+    speaker_segments_.clear();
+    history_.Reset();
+    utterance_ends_.clear();
+  }
+  speaker_detector_.Reset();
+  system_vad_.Reset();
+  endpointer_.Reset();
+  vad_frames_ = 0;
+  stream_start_ms_ = SteadyNowMs();
+
+  // Start in the low-power tier; the first speech-like packets wake the
+  // full pipeline.
+  WakeDetector::SampleFormat wake_format = WakeDetector::kUnknownFormat;
+  if (IsFloatFormat(capture_format_)) {
+    wake_format = WakeDetector::kFloat32;
+  } else if (IsPcm16Format(capture_format_)) {
+    wake_format = WakeDetector::kPcm16;
+  }
+  wake_detector_.Configure(wake_format, capture_format_->nChannels,
+                           static_cast<int>(capture_format_->nSamplesPerSec));
+  preroll_.Configure(static_cast<size_t>(capture_format_->nAvgBytesPerSec) * kPreRollMs / 1000,
+                     capture_format_->nBlockAlign);
+  idle_frames_ = 0;
+  idle_remainder_ = 0;
+
   is_capturing_ = true;
   capture_thread_ = new std::thread(&AudioCapture::CaptureThreadProc, this);
 
@@ -192,28 +264,77 @@ void AudioCapture::StopSystemAudio() {
   }
 }
 
-std::vector<uint8_t> AudioCapture::GetSystemAudioFrame(size_t requested_bytes) {
+std::vector<uint8_t> AudioCapture::GetSystemAudioFrame(size_t requested_bytes,
+                                                       int* speaker_id,
+                                                       bool* end_of_utterance) {
+  std::vector<FramePiece> pieces;
+  std::vector<uint8_t> out = GetSystemAudioFrame(requested_bytes, requested_bytes, &pieces);
+  if (speaker_id && !pieces.empty()) *speaker_id = pieces.front().speaker_id;
+  if (end_of_utterance) *end_of_utterance = !pieces.empty() && pieces.front().end_of_utterance;
+  return out;
+}
+
+std::vector<uint8_t> AudioCapture::GetSystemAudioFrame(size_t requested_bytes,
+                                                       size_t piece_bytes,
+                                                       std::vector<FramePiece>* pieces) {
+  pieces->clear();
   if (requested_bytes == 0) {
     return std::vector<uint8_t>();
   }
+  piece_bytes = (std::max)(piece_bytes, size_t{2}) & ~size_t{1};
 
   std::lock_guard<std::mutex> lock(frames_mutex_);
 
-  const size_t available = audio_bytes_.size();
-  if (available == 0) {
+  const size_t to_copy = (std::min)(requested_bytes, audio_bytes_.size());
+  // Each piece is labelled as if it had been pulled on its own: the speaker
+  // at its start, and any utterance that ended by its end.
+  size_t offset = 0;
+  do {
+    const size_t piece_end = (std::min)(offset + piece_bytes, to_copy);
+    FramePiece piece;
+    piece.speaker_id =
+        SpeakerChangeDetector::SpeakerAt(speaker_segments_, (bytes_consumed_ + offset) / 2);
+    const uint64_t handed_out = (bytes_consumed_ + piece_end) / 2;
+    while (!utterance_ends_.empty() && utterance_ends_.front() <= handed_out) {
+      utterance_ends_.pop_front();
+      piece.end_of_utterance = true;
+    }
+    pieces->push_back(piece);
+    offset = piece_end;
+  } while (offset < to_copy);
+
+  if (to_copy == 0) {
     return std::vector<uint8_t>();
   }
 
-  const size_t to_copy = (std::min)(requested_bytes, available);
   std::vector<uint8_t> out;
   out.reserve(to_copy);
   for (size_t i = 0; i < to_copy; i++) {
     out.push_back(audio_bytes_.front());
     audio_bytes_.pop_front();
   }
+  HN_TRACE_FRAME_DELIVERED(kTraceSystem, bytes_consumed_, to_copy,
+                           audio_bytes_.size());
+  bytes_consumed_ += to_copy;
+  queue_pool_.Reserve(audio_bytes_.size());
   return out;
 }
 
+std::vector<uint8_t> AudioCapture::GetSystemAudioHistory(size_t max_samples) {
+  std::lock_guard<std::mutex> lock(frames_mutex_);
+  return history_.ReadLatestPcm16(max_samples);
+}
+
+AudioQualityMeter::Summary AudioCapture::GetQualitySummary() {
+  std::lock_guard<std::mutex> lock(quality_mutex_);
+  return quality_.GetSummary();
+}
+
+void AudioCapture::ResetQuality() {
+  std::lock_guard<std::mutex> lock(quality_mutex_);
+  quality_.Reset();
+}
+
 bool AudioCapture::InitializeWASAPI() {
   std::cout << "[AudioCapture] Initializing WASAPI..." << std::endl;
   
@@ -265,7 +386,7 @@ bool AudioCapture::InitializeWASAPI() {
   hr = audio_client_->Initialize(
       AUDCLNT_SHAREMODE_SHARED,
       AUDCLNT_STREAMFLAGS_LOOPBACK | AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
-      0, 0, capture_format_, nullptr);
+      kBufferDuration, 0, capture_format_, nullptr);
   
   if (FAILED(hr)) {
     std::cerr << "[AudioCapture] Failed to initialize audio client" << std::endl;
@@ -334,6 +455,17 @@ void AudioCapture::CleanupWASAPI() {
 HRESULT AudioCapture::FindLoopbackDevice() {
   // Use default render endpoint (speakers/headphones). Loopback flag will capture
   // what is being played through this endpoint.
+  loopback_device_id_.clear();
+  AudioDeviceInfo default_render;
+  if (device_registry_ &&
+      device_registry_->Default(AudioDeviceFlow::kRender, &default_render)) {
+    // Endpoint ids are ASCII ("{0.0.0.00000000}.{guid}").
+    const std::wstring id(default_render.id.begin(), default_render.id.end());
+    if (SUCCEEDED(device_enumerator_->GetDevice(id.c_str(), &loopback_device_))) {
+      loopback_device_id_ = default_render.id;
+      return S_OK;
+    }
+  }
   HRESULT hr = device_enumerator_->GetDefaultAudioEndpoint(eRender, eConsole, &loopback_device_);
   if (FAILED(hr)) {
     std::cerr << "[AudioCapture] Failed to get default render endpoint" << std::endl;
@@ -349,9 +481,20 @@ void AudioCapture::CaptureThreadProc() {
   CoInitializeEx(nullptr, COINIT_MULTITHREADED);
   
   const DWORD max_wait = 10000; // 10 seconds timeout
+  uint64_t packet_seq = 0;
+  std::vector<uint8_t> raw;
   
   while (is_capturing_) {
-    DWORD wait_result = WaitForSingleObject(audio_event_, max_wait);
+    // While idle, or while the window is hidden and Dart only collects audio
+    // in batches, drain the (500 ms) endpoint buffer every kIdlePollMs instead
+    // of waking for every 10 ms period. The packets are the same either way.
+    DWORD wait_result = WAIT_OBJECT_0;
+    if (wake_detector_.awake() && !AppPowerState().hidden()) {
+      wait_result = WaitForSingleObject(audio_event_, max_wait);
+    } else {
+      ::Sleep(kIdlePollMs);
+    }
+    wakeups_->Add();
     
     if (wait_result == WAIT_OBJECT_0) {
       UINT32 next_packet_size = 0;
@@ -371,38 +514,49 @@ void AudioCapture::CaptureThreadProc() {
           }
 
           const size_t bytes_available = static_cast<size_t>(frames_read) * capture_format_->nBlockAlign;
+          const uint64_t seq = packet_seq++;
+          HN_TRACE_PACKET_ARRIVAL(kTraceSystem, seq, bytes_available);
+          if (flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY) {
+            std::lock_guard<std::mutex> lock(quality_mutex_);
+            quality_.AddDiscontinuity();
+          }
           if (bytes_available > 0) {
-            // Pull raw bytes
-            std::vector<uint8_t> raw;
-            raw.resize(bytes_available);
-            if (flags & AUDCLNT_BUFFERFLAGS_SILENT) {
-              memset(raw.data(), 0, bytes_available);
-            } else {
-              memcpy(raw.data(), buffer, bytes_available);
-            }
-
-            // Convert to 16kHz mono PCM16 so Dart can mix with mic audio safely.
-            std::vector<float> mono;
-            std::vector<float> mono16k;
-            std::vector<uint8_t> outPcm16;
-
-            if (ToMonoFloat(capture_format_, raw.data(), frames_read, mono)) {
-              ResampleLinear(mono, capture_format_->nSamplesPerSec, 16000, mono16k);
-              MonoFloatToPcm16Bytes(mono16k, outPcm16);
+            const bool silent = (flags & AUDCLNT_BUFFERFLAGS_SILENT) != 0;
+            const bool was_awake = wake_detector_.awake();
+            const bool awake = silent ? wake_detector_.ProcessSilence(frames_read)
+                                      : wake_detector_.Process(buffer, frames_read);
+            if (awake != was_awake) {
+              HN_TRACE_POWER_TIER(kTraceSystem, awake ? 1 : 0);
             }
 
-            if (!outPcm16.empty()) {
-              std::lock_guard<std::mutex> lock(frames_mutex_);
-              // Append bytes.
-              for (const auto b : outPcm16) {
-                audio_bytes_.push_back(b);
+            if (!awake) {
+              // Low-power tier: keep the raw packet for pre-roll and move on.
+              preroll_.Push(silent ? nullptr : buffer, bytes_available);
+              idle_frames_ += frames_read;
+              if (idle_frames_ >= capture_format_->nSamplesPerSec + PreRollFrames()) {
+                AccountIdleFrames(idle_frames_ - PreRollFrames());
+              }
+            } else {
+              if (!was_awake) {
+                // Woke up: account the idle stretch, then run the pre-roll
+                // through the pipeline ahead of this packet.
+                AccountIdleFrames(idle_frames_ - (std::min)(idle_frames_, PreRollFrames()));
+                idle_frames_ = 0;
+                preroll_.Drain(&raw);
+                if (!raw.empty()) {
+                  ProcessPacket(raw.data(),
+                                static_cast<uint32_t>(raw.size() / capture_format_->nBlockAlign),
+                                seq);
+                }
               }
 
-              // Cap buffer to ~2 seconds of audio at 16kHz mono PCM16.
-              // 16000 samples/sec * 2 bytes/sample * 2 sec = 64000 bytes.
-              while (audio_bytes_.size() > 64000) {
-                audio_bytes_.pop_front();
+              raw.resize(bytes_available);
+              if (silent) {
+                memset(raw.data(), 0, bytes_available);
+              } else {
+                memcpy(raw.data(), buffer, bytes_available);
               }
+              ProcessPacket(raw.data(), frames_read, seq);
             }
           }
 
@@ -416,3 +570,117 @@ void AudioCapture::CaptureThreadProc() {
 
   CoUninitialize();
 }
+
+size_t AudioCapture::PreRollFrames() const {
+  return capture_format_ && capture_format_->nBlockAlign > 0
+             ? preroll_.size() / capture_format_->nBlockAlign
+             : 0;
+}
+
+void AudioCapture::AccountIdleFrames(size_t frames) {
+  if (frames == 0 || capture_format_ == nullptr) return;
+  idle_frames_ -= (std::min)(idle_frames_, frames);
+  {
+    std::lock_guard<std::mutex> lock(quality_mutex_);
+    quality_.AddIdle(static_cast<size_t>(static_cast<uint64_t>(frames) * 16000 /
+                                         capture_format_->nSamplesPerSec));
+  }
+  if (!analytics_) return;
+
+  // Idle audio is non-speech; advance the analytics clock past it in whole
+  // VAD frames so later speech keeps its timestamps.
+  const int frame_ms = system_vad_.frame_ms();
+  idle_remainder_ += frames;
+  const size_t frames_per_vad =
+      (std::max)(size_t{1}, static_cast<size_t>(capture_format_->nSamplesPerSec) * frame_ms / 1000);
+  const uint64_t vad_frames = idle_remainder_ / frames_per_vad;
+  idle_remainder_ %= frames_per_vad;
+  if (vad_frames == 0) return;
+
+  const int64_t t_ms = stream_start_ms_ + static_cast<int64_t>(vad_frames_) * frame_ms;
+  vad_frames_ += vad_frames;
+  analytics_->OnFrame(ConversationAnalytics::kSystem, t_ms,
+                      static_cast<int>(vad_frames * frame_ms), false);
+}
+
+void AudioCapture::ProcessPacket(const uint8_t* raw, uint32_t frames, uint64_t seq) {
+  const int64_t start_ns = SteadyNowNs();
+  // Convert to 16kHz mono PCM16 so Dart can mix with mic audio safely.
+  std::vector<float> mono;
+  std::vector<float> mono16k;
+  std::vector<uint8_t> outPcm16;
+
+  if (ToMonoFloat(capture_format_, raw, frames, mono)) {
+    ResampleLinear(mono, capture_format_->nSamplesPerSec, 16000, mono16k);
+    MonoFloatToPcm16Bytes(mono16k, outPcm16);
+  }
+  HN_TRACE_STAGE_DONE(kTraceSystem, kTraceStageConvert, seq, mono16k.size());
+
+  if (analytics_ && !mono16k.empty()) {
+    const int frame_ms = system_vad_.frame_ms();
+    system_vad_.Process(mono16k.data(), mono16k.size(), [&](bool speech) {
+      const int64_t t_ms =
+          stream_start_ms_ + static_cast<int64_t>(vad_frames_) * frame_ms;
+      vad_frames_++;
+      analytics_->OnFrame(ConversationAnalytics::kSystem, t_ms, frame_ms, speech);
+    });
+    HN_TRACE_STAGE_DONE(kTraceSystem, kTraceStageVad, seq, mono16k.size());
+  }
+
+  if (copy_detector_ && !mono16k.empty()) {
+    copy_detector_->PushSystem(mono16k.data(), mono16k.size(), SteadyNowMs());
+  }
+
+  bool utterance_ended = false;
+  if (!mono16k.empty()) {
+    endpointer_.set_aggressiveness(endpoint_aggressiveness_.load(std::memory_order_relaxed));
+    utterance_ended = endpointer_.Process(mono16k.data(), mono16k.size());
+  }
+
+  // Speaker analysis (FFT and MFCCs) runs before the lock is taken; only
+  // the segments it opened are published under it.
+  if (!mono16k.empty()) {
+    speaker_detector_.Process(mono16k.data(), mono16k.size());
+    HN_TRACE_STAGE_DONE(kTraceSystem, kTraceStageSpeaker, seq, mono16k.size());
+    std::lock_guard<std::mutex> lock(quality_mutex_);
+    quality_.Process(mono16k.data(), mono16k.size());
+  }
+
+  if (!outPcm16.empty()) {
+    std::lock_guard<std::mutex> lock(frames_mutex_);
+    const auto& segments = speaker_detector_.segments();
+    auto first_new = segments.end();
+    while (first_new != segments.begin() &&
+           (speaker_segments_.empty() ||
+            std::prev(first_new)->start_sample > speaker_segments_.back().start_sample)) {
+      --first_new;
+    }
+    speaker_segments_.insert(speaker_segments_.end(), first_new, segments.end());
+    while (speaker_segments_.size() > SpeakerChangeDetector::kMaxSegments) {
+      speaker_segments_.pop_front();
+    }
+    if (utterance_ended) {
+      // Reported once the audio up to the detection has been handed out, so
+      // the finalize request follows the audio it refers to.
+      if (utterance_ends_.size() >= 32) utterance_ends_.pop_front();  // Nobody is asking
+      utterance_ends_.push_back((bytes_consumed_ + audio_bytes_.size()) / 2 + mono16k.size());
+    }
+
+    history_.FitToPool(&history_pool_);
+    history_.AppendPcm16(outPcm16.data(), outPcm16.size());
+
+    // Append bytes.
+    for (const auto b : outPcm16) {
+      audio_bytes_.push_back(b);
+    }
+
+    // Cap the buffer to its grant: ~2 seconds of audio at 16kHz mono PCM16
+    // (64000 bytes) unless the memory budget is tight. When the budget
+    // refuses growth the queue stays at what it already holds.
+    const size_t wanted = (std::min)(queue_pool_.limit(), audio_bytes_.size());
+    TrimQueueLocked(queue_pool_.Reserve(wanted) ? wanted : queue_pool_.used());
+    HN_TRACE_STAGE_DONE(kTraceSystem, kTraceStageQueued, seq, mono16k.size());
+    queued_bytes_->Set(static_cast<int64_t>(audio_bytes_.size()));
+  }
+  packet_ns_->Record(SteadyNowNs() - start_ns);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <flutter/standard_method_codec.h>
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <deque>
@@ -11,14 +12,70 @@
 #include <mmdeviceapi.h>
 #include <mmreg.h>
 
+#include "audio_device_registry.h"
+#include "audio_history.h"
+#include "audio_quality.h"
+#include "conversation_analytics.h"
+#include "digital_copy_detector.h"
+#include "memory_governor.h"
+#include "metrics.h"
+#include "speaker_change_detector.h"
+#include "speech_activity.h"
+#include "utterance_endpointer.h"
+#include "wake_detector.h"
+
 class AudioCapture {
  public:
   AudioCapture();
   ~AudioCapture();
 
+  // Receives system speech activity; must outlive the capture.
+  void SetConversationAnalytics(ConversationAnalytics* analytics) {
+    analytics_ = analytics;
+  }
+
+  // Receives the system side of copy detection; must outlive the capture.
+  void SetCopyDetector(DigitalCopyDetector* detector) { copy_detector_ = detector; }
+
+  // Source of the default render endpoint; must outlive the capture. Without
+  // one the endpoint is looked up on every initialization.
+  void SetDeviceRegistry(AudioDeviceRegistry* registry) { device_registry_ = registry; }
+
+  // Budgets the Dart-facing queue and the history; must outlive the capture.
+  // Call from the platform thread.
+  void SetMemoryGovernor(MemoryGovernor* governor);
+
   bool StartSystemAudio();
   void StopSystemAudio();
-  std::vector<uint8_t> GetSystemAudioFrame(size_t requested_bytes);
+  // Pops up to |requested_bytes| of 16kHz mono PCM16. When |speaker_id| is
+  // given it receives the speaker label at the start of the returned audio
+  // (-1 while unknown). When |end_of_utterance| is given it is set if an
+  // utterance ended within the audio handed out so far.
+  std::vector<uint8_t> GetSystemAudioFrame(size_t requested_bytes,
+                                           int* speaker_id = nullptr,
+                                           bool* end_of_utterance = nullptr);
+  // What one GetSystemAudioFrame call of |piece_bytes| would have reported,
+  // for each piece of a larger pull.
+  struct FramePiece {
+    int speaker_id = -1;
+    bool end_of_utterance = false;
+  };
+  // As above, split into |piece_bytes| pieces (the last may be shorter);
+  // |pieces| gets one entry per piece, and one for an empty pull.
+  std::vector<uint8_t> GetSystemAudioFrame(size_t requested_bytes, size_t piece_bytes,
+                                           std::vector<FramePiece>* pieces);
+  // 0..UtteranceEndpointer::kMaxAggressiveness; applied from the next packet.
+  void SetEndpointAggressiveness(int aggressiveness) {
+    endpoint_aggressiveness_ = aggressiveness;
+  }
+  // The last |max_samples| of system audio as 16kHz mono PCM16, including
+  // audio already handed to Dart.
+  std::vector<uint8_t> GetSystemAudioHistory(size_t max_samples);
+  // Input quality of the system stream since the last ResetQuality(). Idle
+  // stretches the wake detector skips are not measured; device-reported
+  // discontinuities always are.
+  AudioQualityMeter::Summary GetQualitySummary();
+  void ResetQuality();
 
  private:
   bool is_capturing_ = false;
@@ -27,6 +84,9 @@ class AudioCapture {
   // WASAPI components
   IMMDeviceEnumerator* device_enumerator_ = nullptr;
   IMMDevice* loopback_device_ = nullptr;
+  AudioDeviceRegistry* device_registry_ = nullptr;
+  // Registry id of loopback_device_, to notice when the default output moved.
+  std::string loopback_device_id_;
   IAudioClient* audio_client_ = nullptr;
   IAudioCaptureClient* capture_client_ = nullptr;
     WAVEFORMATEX* capture_format_ = nullptr;
@@ -36,12 +96,77 @@ class AudioCapture {
   // Audio byte buffer (16kHz mono PCM16)
   std::deque<uint8_t> audio_bytes_;
   std::mutex frames_mutex_;
+  // Absolute byte offset of audio_bytes_.front() since capture started.
+  uint64_t bytes_consumed_ = 0;
+
+  // Labels the system stream by speaker (capture thread only). Its segments
+  // are published to speaker_segments_ for GetSystemAudioFrame (guarded by
+  // frames_mutex_), so the analysis never holds the lock.
+  SpeakerChangeDetector speaker_detector_;
+  std::deque<SpeakerChangeDetector::Segment> speaker_segments_;
+  // Input quality statistics. Their own lock, so the per-sample pass never
+  // holds frames_mutex_ against GetSystemAudioFrame.
+  std::mutex quality_mutex_;
+  AudioQualityMeter quality_;
+
+  // Up to the last minute of system audio, ADPCM-compressed, sized by
+  // history_pool_ (guarded by frames_mutex_).
+  AudioHistory history_{AudioHistory::kSamplesPerBlock};
+
+  // Speech activity for conversation analytics (capture thread only).
+  EnergyVad system_vad_;
+  ConversationAnalytics* analytics_ = nullptr;
+  DigitalCopyDetector* copy_detector_ = nullptr;
+  int64_t stream_start_ms_ = 0;
+  uint64_t vad_frames_ = 0;
+
+  // End-of-utterance detection (capture thread only). Detected ends are
+  // queued as sample offsets into the stream and reported once the audio up
+  // to them has been handed out (guarded by frames_mutex_).
+  UtteranceEndpointer endpointer_;
+  std::atomic<int> endpoint_aggressiveness_{2};
+  std::deque<uint64_t> utterance_ends_;
+
+  // Two-tier power mode (capture thread only). While the wake detector sees
+  // no speech, packets only feed it and the raw pre-roll ring; conversion,
+  // analysis and the Dart-facing buffer run once it wakes.
+  static constexpr DWORD kIdlePollMs = 100;
+  // Five poll intervals, so a late wakeup from Sleep never overruns the
+  // endpoint buffer. Event-driven capture still wakes every device period.
+  static constexpr REFERENCE_TIME kBufferDuration = 5000000;  // 500 ms
+  static constexpr size_t kPreRollMs = 300;
+  WakeDetector wake_detector_;
+  PreRollRing preroll_;
+  size_t idle_frames_ = 0;     // Idle source frames not yet accounted
+  size_t idle_remainder_ = 0;  // Accounted frames short of a whole VAD frame
+
+  // Pipeline cost per packet, and what waits for Dart.
+  Histogram* packet_ns_ = Metrics().GetHistogram("audio.system.packet_ns");
+  Gauge* queued_bytes_ = Metrics().GetGauge("audio.system.queued_bytes");
+  // Capture thread wakeups, to compare the power tiers.
+  Counter* wakeups_ = Metrics().GetCounter("audio.system.wakeups");
   
   // Capture thread function
   void CaptureThreadProc();
+  // Full pipeline for one packet of |frames| mix-format frames.
+  void ProcessPacket(const uint8_t* raw, uint32_t frames, uint64_t seq);
+  size_t PreRollFrames() const;
+  // Drops the oldest queued audio past |max_bytes| and records what is left
+  // with queue_pool_. Requires frames_mutex_.
+  void TrimQueueLocked(size_t max_bytes);
+  void AccountIdleFrames(size_t frames);
   
   // Helper functions
   bool InitializeWASAPI();
   void CleanupWASAPI();
   HRESULT FindLoopbackDevice();
+
+  // Budgets for audio_bytes_ (about two seconds unconstrained) and history_.
+  // Declared last so they detach before the buffers they guard go away.
+  MemoryPool queue_pool_{"system_queue", MemoryGovernor::kPriorityQueue, 16000, 64000,
+                         sizeof(int16_t)};
+  MemoryPool history_pool_{"system_history", MemoryGovernor::kPriorityHistory,
+                           AudioHistory::BytesForSamples(16000 * 10),
+                           AudioHistory::BytesForSamples(16000 * 60),
+                           AudioHistory::kBlockBytes};
 };
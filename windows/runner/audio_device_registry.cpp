@@ -0,0 +1,155 @@
+#include "audio_device_registry.h"
+
+#include <algorithm>
+#include <iostream>
+
+AudioDeviceRegistry::AudioDeviceRegistry(std::unique_ptr<AudioDeviceBackend> backend)
+    : backend_(std::move(backend)) {}
+
+AudioDeviceRegistry::~AudioDeviceRegistry() {
+  Stop();
+}
+
+bool AudioDeviceRegistry::Start() {
+  std::vector<AudioDeviceInfo> devices;
+  std::string defaults[2];
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (started_) return true;
+    // Subscribe first so a change during the enumeration is not missed; it
+    // just marks a freshly listed device stale.
+    if (!backend_->Subscribe(this)) {
+      std::cerr << "[AudioDeviceRegistry] Failed to register for device notifications"
+                << std::endl;
+      return false;
+    }
+    started_ = true;
+  }
+
+  if (!backend_->Enumerate(&devices, &defaults[0], &defaults[1])) {
+    std::cerr << "[AudioDeviceRegistry] Failed to enumerate audio endpoints" << std::endl;
+    Stop();
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& device : devices) {
+      const std::string id = device.id;
+      devices_[id] = std::move(device);
+    }
+    default_ids_[0] = std::move(defaults[0]);
+    default_ids_[1] = std::move(defaults[1]);
+    version_++;
+  }
+  std::cout << "[AudioDeviceRegistry] " << devices.size() << " audio endpoints" << std::endl;
+  return true;
+}
+
+void AudioDeviceRegistry::Stop() {
+  bool was_started = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    was_started = started_;
+    started_ = false;
+  }
+  // Outside the lock: unsubscribing waits for notifications in flight, which
+  // take the lock themselves.
+  if (was_started) backend_->Unsubscribe();
+  std::lock_guard<std::mutex> lock(mutex_);
+  devices_.clear();
+  stale_.clear();
+  default_ids_[0].clear();
+  default_ids_[1].clear();
+}
+
+void AudioDeviceRegistry::SetChangeCallback(std::function<void(uint64_t)> callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  on_change_ = std::move(callback);
+}
+
+uint64_t AudioDeviceRegistry::version() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return version_;
+}
+
+void AudioDeviceRegistry::RefreshLocked(const std::string& id) {
+  if (stale_.erase(id) == 0) return;
+  AudioDeviceInfo device;
+  if (backend_->Query(id, &device)) {
+    devices_[id] = std::move(device);
+  } else {
+    devices_.erase(id);
+  }
+}
+
+bool AudioDeviceRegistry::Find(const std::string& id, AudioDeviceInfo* device) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  RefreshLocked(id);
+  auto it = devices_.find(id);
+  if (it == devices_.end()) return false;
+  *device = it->second;
+  device->is_default = id == default_ids_[static_cast<int>(device->flow)];
+  return true;
+}
+
+bool AudioDeviceRegistry::Default(AudioDeviceFlow flow, AudioDeviceInfo* device) {
+  std::string id;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    id = default_ids_[static_cast<int>(flow)];
+  }
+  return !id.empty() && Find(id, device);
+}
+
+std::vector<AudioDeviceInfo> AudioDeviceRegistry::Snapshot() {
+  std::vector<AudioDeviceInfo> out;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!stale_.empty()) {
+      const std::string id = *stale_.begin();  // RefreshLocked erases it
+      RefreshLocked(id);
+    }
+    out.reserve(devices_.size());
+    for (const auto& entry : devices_) {
+      out.push_back(entry.second);
+      out.back().is_default = entry.first == default_ids_[static_cast<int>(entry.second.flow)];
+    }
+  }
+  std::sort(out.begin(), out.end(), [](const AudioDeviceInfo& a, const AudioDeviceInfo& b) {
+    if (a.flow != b.flow) return a.flow < b.flow;
+    return a.name < b.name;
+  });
+  return out;
+}
+
+void AudioDeviceRegistry::OnDeviceChanged(const std::string& id) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!started_) return;
+    stale_.insert(id);
+  }
+  NotifyChanged();
+}
+
+void AudioDeviceRegistry::OnDefaultChanged(AudioDeviceFlow flow, const std::string& id) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!started_) return;
+    default_ids_[static_cast<int>(flow)] = id;
+    // A device can become the default as it appears.
+    if (!id.empty() && devices_.count(id) == 0) stale_.insert(id);
+  }
+  NotifyChanged();
+}
+
+void AudioDeviceRegistry::NotifyChanged() {
+  std::function<void(uint64_t)> callback;
+  uint64_t version = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    version = ++version_;
+    callback = on_change_;
+  }
+  if (callback) callback(version);
+}
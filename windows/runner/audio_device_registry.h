@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+enum class AudioDeviceFlow { kCapture = 0, kRender = 1 };
+
+// The endpoint's shared-mode engine format, read once when the device is
+// listed so nothing has to activate an audio client just to describe it.
+struct AudioDeviceFormat {
+  int sample_rate = 0;
+  int channels = 0;
+  int bits_per_sample = 0;
+  bool is_float = false;
+};
+
+struct AudioDeviceInfo {
+  std::string id;  // Endpoint id (UTF-8), as the record plugin reports it
+  std::string name;
+  AudioDeviceFlow flow = AudioDeviceFlow::kCapture;
+  bool is_default = false;  // Filled in by the registry
+  AudioDeviceFormat format;
+};
+
+// Where the registry gets its devices from: WASAPI on Windows, a fake in
+// tests and benchmarks. Observer calls may come from any thread and must not
+// call back into the backend; the registry only records them.
+class AudioDeviceBackend {
+ public:
+  class Observer {
+   public:
+    virtual ~Observer() = default;
+    // Added, removed, enabled, disabled or with changed properties.
+    virtual void OnDeviceChanged(const std::string& id) = 0;
+    // |id| is empty when no device of |flow| is left.
+    virtual void OnDefaultChanged(AudioDeviceFlow flow, const std::string& id) = 0;
+  };
+
+  virtual ~AudioDeviceBackend() = default;
+
+  // Active devices and the default id per flow (empty when none).
+  virtual bool Enumerate(std::vector<AudioDeviceInfo>* devices,
+                         std::string* default_capture,
+                         std::string* default_render) = 0;
+  // False when |id| is gone or no longer active.
+  virtual bool Query(const std::string& id, AudioDeviceInfo* device) = 0;
+  virtual bool Subscribe(Observer* observer) = 0;
+  virtual void Unsubscribe() = 0;
+};
+
+// Input and output endpoints, enumerated once and kept current from the
+// backend's change notifications, so starting a recording resolves the
+// selected or default device with a hash lookup instead of an enumeration.
+// A notification only marks the device stale; it is re-queried on the next
+// lookup or snapshot, on the caller's thread. Thread-safe.
+class AudioDeviceRegistry : private AudioDeviceBackend::Observer {
+ public:
+  explicit AudioDeviceRegistry(std::unique_ptr<AudioDeviceBackend> backend);
+  ~AudioDeviceRegistry() override;
+
+  bool Start();
+  void Stop();
+
+  // Called after each change with the new version, on the notifying thread.
+  void SetChangeCallback(std::function<void(uint64_t version)> callback);
+
+  bool Find(const std::string& id, AudioDeviceInfo* device);
+  bool Default(AudioDeviceFlow flow, AudioDeviceInfo* device);
+  // All devices, capture first, each flow in name order.
+  std::vector<AudioDeviceInfo> Snapshot();
+
+  // Bumped on every change notification.
+  uint64_t version() const;
+
+ private:
+  void OnDeviceChanged(const std::string& id) override;
+  void OnDefaultChanged(AudioDeviceFlow flow, const std::string& id) override;
+
+  // Re-queries |id| if stale. Requires mutex_.
+  void RefreshLocked(const std::string& id);
+  void NotifyChanged();
+
+  std::unique_ptr<AudioDeviceBackend> backend_;
+  mutable std::mutex mutex_;
+  bool started_ = false;
+  std::unordered_map<std::string, AudioDeviceInfo> devices_;
+  std::unordered_set<std::string> stale_;
+  std::string default_ids_[2];
+  uint64_t version_ = 0;
+  std::function<void(uint64_t)> on_change_;
+};
@@ -0,0 +1,152 @@
+#include "audio_features.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+static double HzToMel(double hz) {
+  return 2595.0 * std::log10(1.0 + hz / 700.0);
+}
+
+static double MelToHz(double mel) {
+  return 700.0 * (std::pow(10.0, mel / 2595.0) - 1.0);
+}
+
+}  // namespace
+
+LogMelExtractor::LogMelExtractor(int sample_rate,
+                                 int frame_length,
+                                 int fft_size,
+                                 int mel_bands)
+    : sample_rate_(sample_rate),
+      frame_length_(frame_length),
+      fft_size_(fft_size),
+      mel_bands_(mel_bands) {
+  window_.resize(frame_length_);
+  for (int i = 0; i < frame_length_; i++) {
+    window_[i] = static_cast<float>(
+        0.54 - 0.46 * std::cos(2.0 * kPi * i / (frame_length_ - 1)));
+  }
+
+  re_.assign(fft_size_, 0.0f);
+  im_.assign(fft_size_, 0.0f);
+  cos_table_.resize(fft_size_ / 2);
+  sin_table_.resize(fft_size_ / 2);
+  for (int i = 0; i < fft_size_ / 2; i++) {
+    cos_table_[i] = static_cast<float>(std::cos(2.0 * kPi * i / fft_size_));
+    sin_table_[i] = static_cast<float>(std::sin(2.0 * kPi * i / fft_size_));
+  }
+
+  int bits = 0;
+  while ((1 << bits) < fft_size_) bits++;
+  bit_reverse_.resize(fft_size_);
+  for (int i = 0; i < fft_size_; i++) {
+    size_t r = 0;
+    for (int b = 0; b < bits; b++) {
+      if (i & (1 << b)) r |= static_cast<size_t>(1) << (bits - 1 - b);
+    }
+    bit_reverse_[i] = r;
+  }
+
+  const int bins = fft_size_ / 2 + 1;
+  power_.assign(bins, 0.0f);
+
+  const double mel_lo = HzToMel(20.0);
+  const double mel_hi = HzToMel(sample_rate_ / 2.0);
+  std::vector<double> edges(mel_bands_ + 2);
+  for (int i = 0; i < mel_bands_ + 2; i++) {
+    const double hz = MelToHz(mel_lo + (mel_hi - mel_lo) * i / (mel_bands_ + 1));
+    edges[i] = hz * fft_size_ / sample_rate_;
+  }
+  filter_start_.resize(mel_bands_);
+  filter_weights_.resize(mel_bands_);
+  for (int m = 0; m < mel_bands_; m++) {
+    const double left = edges[m];
+    const double center = edges[m + 1];
+    const double right = edges[m + 2];
+    const int first = (std::max)(0, static_cast<int>(std::ceil(left)));
+    const int last = (std::min)(bins - 1, static_cast<int>(std::floor(right)));
+    filter_start_[m] = first;
+    for (int k = first; k <= last; k++) {
+      double w = 0.0;
+      if (k <= center) {
+        w = center > left ? (k - left) / (center - left) : 1.0;
+      } else {
+        w = right > center ? (right - k) / (right - center) : 1.0;
+      }
+      filter_weights_[m].push_back(static_cast<float>((std::max)(0.0, w)));
+    }
+  }
+
+  dct_.resize(static_cast<size_t>(mel_bands_) * mel_bands_);
+  for (int c = 0; c < mel_bands_; c++) {
+    for (int m = 0; m < mel_bands_; m++) {
+      dct_[static_cast<size_t>(c) * mel_bands_ + m] = static_cast<float>(
+          std::cos(kPi * c * (m + 0.5) / mel_bands_));
+    }
+  }
+}
+
+float LogMelExtractor::Compute(const float* frame, float* out_log_mel) {
+  double energy = 0.0;
+  for (int i = 0; i < fft_size_; i++) {
+    const float s = i < frame_length_ ? frame[i] * window_[i] : 0.0f;
+    re_[bit_reverse_[i]] = s;
+    im_[bit_reverse_[i]] = 0.0f;
+    energy += static_cast<double>(s) * s;
+  }
+  Fft();
+
+  const int bins = fft_size_ / 2 + 1;
+  for (int k = 0; k < bins; k++) {
+    power_[k] = re_[k] * re_[k] + im_[k] * im_[k];
+  }
+  for (int m = 0; m < mel_bands_; m++) {
+    double sum = 0.0;
+    const auto& weights = filter_weights_[m];
+    for (size_t j = 0; j < weights.size(); j++) {
+      sum += weights[j] * power_[filter_start_[m] + j];
+    }
+    out_log_mel[m] = static_cast<float>(std::log(sum + 1e-10));
+  }
+  return static_cast<float>(std::log(energy + 1e-10));
+}
+
+void LogMelExtractor::Cepstrum(const float* log_mel,
+                               float* out_cepstrum,
+                               int count) const {
+  count = (std::min)(count, mel_bands_);
+  for (int c = 0; c < count; c++) {
+    const float* row = &dct_[static_cast<size_t>(c) * mel_bands_];
+    float sum = 0.0f;
+    for (int m = 0; m < mel_bands_; m++) {
+      sum += row[m] * log_mel[m];
+    }
+    out_cepstrum[c] = sum;
+  }
+}
+
+// In-place iterative radix-2 FFT; input is already in bit-reversed order.
+void LogMelExtractor::Fft() {
+  for (int size = 2; size <= fft_size_; size <<= 1) {
+    const int half = size / 2;
+    const int step = fft_size_ / size;
+    for (int start = 0; start < fft_size_; start += size) {
+      for (int k = 0; k < half; k++) {
+        const float wr = cos_table_[k * step];
+        const float wi = -sin_table_[k * step];
+        const int a = start + k;
+        const int b = a + half;
+        const float tr = re_[b] * wr - im_[b] * wi;
+        const float ti = re_[b] * wi + im_[b] * wr;
+        re_[b] = re_[a] - tr;
+        im_[b] = im_[a] - ti;
+        re_[a] += tr;
+        im_[a] += ti;
+      }
+    }
+  }
+}
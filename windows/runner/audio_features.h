@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Short-time spectral features for 16kHz mono float audio. Shared by the
+// native analysers that run on the capture thread; no allocation after
+// construction.
+class LogMelExtractor {
+ public:
+  // |frame_length| samples are windowed and zero-padded to |fft_size|
+  // (power of two). |mel_bands| triangular filters span 20 Hz..sample_rate/2.
+  LogMelExtractor(int sample_rate = 16000,
+                  int frame_length = 400,
+                  int fft_size = 512,
+                  int mel_bands = 24);
+
+  int frame_length() const { return frame_length_; }
+  int mel_bands() const { return mel_bands_; }
+
+  // Computes log mel energies of one frame of |frame_length()| samples into
+  // |out_log_mel| (mel_bands() values). Returns the frame log energy.
+  float Compute(const float* frame, float* out_log_mel);
+
+  // DCT-II of |log_mel| into |out_cepstrum| (|count| coefficients, c0 first).
+  void Cepstrum(const float* log_mel, float* out_cepstrum, int count) const;
+
+  // Power spectrum of the last computed frame (fft_size / 2 + 1 bins).
+  const std::vector<float>& power_spectrum() const { return power_; }
+
+ private:
+  void Fft();
+
+  int sample_rate_;
+  int frame_length_;
+  int fft_size_;
+  int mel_bands_;
+
+  std::vector<float> window_;
+  std::vector<float> re_;
+  std::vector<float> im_;
+  std::vector<float> cos_table_;
+  std::vector<float> sin_table_;
+  std::vector<size_t> bit_reverse_;
+  std::vector<float> power_;
+  // Sparse triangular filters: first bin and weights per band.
+  std::vector<int> filter_start_;
+  std::vector<std::vector<float>> filter_weights_;
+  std::vector<float> dct_;  // mel_bands_ x mel_bands_, row-major.
+};
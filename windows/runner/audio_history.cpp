@@ -0,0 +1,232 @@
+#include "audio_history.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
+#include "memory_governor.h"
+
+namespace {
+
+constexpr int kStepTable[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
+    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+    876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+    5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+constexpr int kIndexTable[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+struct AdpcmState {
+  int predictor = 0;
+  int index = 0;
+};
+
+// Reconstructs the sample for |code| and advances the state. Shared by the
+// encoder and decoder so both stay in lockstep.
+static int16_t Step(AdpcmState& state, uint8_t code) {
+  const int step = kStepTable[state.index];
+  int diff = step >> 3;
+  if (code & 4) diff += step;
+  if (code & 2) diff += step >> 1;
+  if (code & 1) diff += step >> 2;
+  state.predictor += (code & 8) ? -diff : diff;
+  state.predictor = (std::max)(-32768, (std::min)(32767, state.predictor));
+  state.index = (std::max)(0, (std::min)(88, state.index + kIndexTable[code & 7]));
+  return static_cast<int16_t>(state.predictor);
+}
+
+static uint8_t Quantize(const AdpcmState& state, int sample) {
+  const int step = kStepTable[state.index];
+  int diff = sample - state.predictor;
+  uint8_t code = 0;
+  if (diff < 0) {
+    code = 8;
+    diff = -diff;
+  }
+  if (diff >= step) {
+    code |= 4;
+    diff -= step;
+  }
+  if (diff >= step >> 1) {
+    code |= 2;
+    diff -= step >> 1;
+  }
+  if (diff >= step >> 2) {
+    code |= 1;
+  }
+  return code;
+}
+
+}  // namespace
+
+AudioHistory::AudioHistory(size_t capacity_samples)
+    : max_blocks_((std::max)(size_t{1},
+                             (capacity_samples + kSamplesPerBlock - 1) / kSamplesPerBlock)) {
+  ring_.resize(max_blocks_ * kBlockBytes);
+  open_block_.reserve(kSamplesPerBlock);
+}
+
+void AudioHistory::Reset() {
+  oldest_slot_ = 0;
+  block_count_ = 0;
+  open_block_.clear();
+  first_sample_ = 0;
+  total_samples_ = 0;
+}
+
+size_t AudioHistory::memory_bytes() const {
+  return block_count_ * kBlockBytes + open_block_.size() * sizeof(int16_t);
+}
+
+void AudioHistory::FitToPool(MemoryPool* pool) {
+  const size_t target = (std::max)(size_t{1}, pool->limit() / kBlockBytes);
+  if (target == max_blocks_ && pool->used() == ring_.size()) return;
+  if (target < max_blocks_) {
+    SetCapacityBlocks(target);
+  } else if (target > max_blocks_ && pool->Reserve(target * kBlockBytes)) {
+    SetCapacityBlocks(target);
+  }
+  pool->Reserve(ring_.size());
+}
+
+void AudioHistory::SetCapacityBlocks(size_t blocks) {
+  blocks = (std::max)(size_t{1}, blocks);
+  if (blocks == max_blocks_) return;
+  const size_t keep = (std::min)(block_count_, blocks);
+  const size_t skip = block_count_ - keep;
+  std::vector<uint8_t> ring(blocks * kBlockBytes);
+  for (size_t i = 0; i < keep; i++) {
+    const size_t slot = (oldest_slot_ + skip + i) % max_blocks_;
+    std::copy_n(&ring_[slot * kBlockBytes], kBlockBytes, &ring[i * kBlockBytes]);
+  }
+  ring_.swap(ring);
+  max_blocks_ = blocks;
+  oldest_slot_ = 0;
+  block_count_ = keep;
+  first_sample_ += skip * kSamplesPerBlock;
+}
+
+void AudioHistory::AppendPcm16(const uint8_t* data, size_t length) {
+  int16_t chunk[256];
+  const size_t samples = length / 2;
+  for (size_t done = 0; done < samples;) {
+    const size_t n = (std::min)(samples - done, std::size(chunk));
+    for (size_t i = 0; i < n; i++) {
+      const uint8_t* p = data + (done + i) * 2;
+      chunk[i] = static_cast<int16_t>(p[0] | (p[1] << 8));
+    }
+    Append(chunk, n);
+    done += n;
+  }
+}
+
+void AudioHistory::Append(const int16_t* samples, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    open_block_.push_back(samples[i]);
+    total_samples_++;
+    if (open_block_.size() < kSamplesPerBlock) continue;
+
+    size_t slot;
+    if (block_count_ < max_blocks_) {
+      slot = (oldest_slot_ + block_count_) % max_blocks_;
+      block_count_++;
+    } else {
+      // Overwrite the oldest block.
+      slot = oldest_slot_;
+      oldest_slot_ = (oldest_slot_ + 1) % max_blocks_;
+      first_sample_ += kSamplesPerBlock;
+    }
+    EncodeBlock(open_block_.data(), &ring_[slot * kBlockBytes]);
+    open_block_.clear();
+  }
+}
+
+void AudioHistory::EncodeBlock(const int16_t* samples, uint8_t* out) {
+  AdpcmState state;
+  state.predictor = samples[0];
+  // Start each block from the step size that best fits its opening slope.
+  const int slope = std::abs(static_cast<int>(samples[1]) - samples[0]);
+  while (state.index < 88 && kStepTable[state.index] < slope) state.index++;
+
+  out[0] = static_cast<uint8_t>(samples[0] & 0xFF);
+  out[1] = static_cast<uint8_t>((samples[0] >> 8) & 0xFF);
+  out[2] = static_cast<uint8_t>(state.index);
+  out[3] = 0;
+
+  uint8_t* codes = out + 4;
+  for (size_t i = 1; i < kSamplesPerBlock; i++) {
+    const uint8_t code = Quantize(state, samples[i]);
+    Step(state, code);
+    const size_t n = i - 1;
+    if (n % 2 == 0) {
+      codes[n / 2] = code;
+    } else {
+      codes[n / 2] |= static_cast<uint8_t>(code << 4);
+    }
+  }
+}
+
+void AudioHistory::DecodeBlock(const uint8_t* block, int16_t* out) {
+  AdpcmState state;
+  state.predictor = static_cast<int16_t>(block[0] | (block[1] << 8));
+  state.index = (std::min)(88, static_cast<int>(block[2]));
+  out[0] = static_cast<int16_t>(state.predictor);
+
+  const uint8_t* codes = block + 4;
+  for (size_t i = 1; i < kSamplesPerBlock; i++) {
+    const size_t n = i - 1;
+    const uint8_t code = (n % 2 == 0) ? (codes[n / 2] & 0x0F) : (codes[n / 2] >> 4);
+    out[i] = Step(state, code);
+  }
+}
+
+uint64_t AudioHistory::Read(uint64_t start,
+                            size_t count,
+                            std::vector<int16_t>* out) const {
+  out->clear();
+  const uint64_t begin = (std::max)(start, first_sample_);
+  const uint64_t end = (std::min)(start + count, total_samples_);
+  if (begin >= end) return begin;
+  out->reserve(static_cast<size_t>(end - begin));
+
+  const uint64_t open_start = total_samples_ - open_block_.size();
+  int16_t decoded[kSamplesPerBlock];
+  uint64_t pos = begin;
+  while (pos < end && pos < open_start) {
+    const size_t block = static_cast<size_t>((pos - first_sample_) / kSamplesPerBlock);
+    const uint64_t block_start = first_sample_ + block * kSamplesPerBlock;
+    const size_t slot = (oldest_slot_ + block) % max_blocks_;
+    DecodeBlock(&ring_[slot * kBlockBytes], decoded);
+
+    const size_t from = static_cast<size_t>(pos - block_start);
+    const size_t to = static_cast<size_t>(
+        (std::min)(end, block_start + kSamplesPerBlock) - block_start);
+    out->insert(out->end(), decoded + from, decoded + to);
+    pos = block_start + to;
+  }
+  if (pos < end) {
+    const size_t from = static_cast<size_t>(pos - open_start);
+    const size_t to = static_cast<size_t>(end - open_start);
+    out->insert(out->end(), open_block_.begin() + from, open_block_.begin() + to);
+  }
+  return begin;
+}
+
+std::vector<uint8_t> AudioHistory::ReadLatestPcm16(size_t max_samples) const {
+  const uint64_t held = total_samples_ - first_sample_;
+  const size_t count = static_cast<size_t>((std::min)(held, uint64_t{max_samples}));
+  std::vector<int16_t> samples;
+  Read(total_samples_ - count, count, &samples);
+
+  std::vector<uint8_t> out(samples.size() * 2);
+  for (size_t i = 0; i < samples.size(); i++) {
+    out[i * 2 + 0] = static_cast<uint8_t>(samples[i] & 0xFF);
+    out[i * 2 + 1] = static_cast<uint8_t>((samples[i] >> 8) & 0xFF);
+  }
+  return out;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class MemoryPool;
+
+// Bounded history of a 16kHz mono PCM16 stream, held as IMA-ADPCM.
+//
+// Audio is encoded in independent 505-sample blocks (the WAV IMA-ADPCM block
+// layout: a 4-byte header with the first sample and step index, then 4-bit
+// codes), so 1010 bytes of PCM cost 256 bytes and any block can be decoded on
+// its own. Samples are addressed by their absolute index since the last
+// Reset(); once the ring is full the oldest block is overwritten. Decoding
+// only happens in Read(). Not thread-safe.
+class AudioHistory {
+ public:
+  static constexpr size_t kSamplesPerBlock = 505;
+  static constexpr size_t kBlockBytes = 256;
+
+  explicit AudioHistory(size_t capacity_samples);
+
+  // Ring bytes needed to hold |samples|.
+  static constexpr size_t BytesForSamples(size_t samples) {
+    return (samples + kSamplesPerBlock - 1) / kSamplesPerBlock * kBlockBytes;
+  }
+
+  void Append(const int16_t* samples, size_t count);
+  // Little-endian PCM16 bytes, as queued for Dart.
+  void AppendPcm16(const uint8_t* data, size_t length);
+
+  // Decodes samples [start, start + count) that are still held into |out|
+  // and returns the index of the first one (later than |start| if the
+  // beginning has already been overwritten).
+  uint64_t Read(uint64_t start, size_t count, std::vector<int16_t>* out) const;
+
+  // The newest |max_samples| as little-endian PCM16 bytes.
+  std::vector<uint8_t> ReadLatestPcm16(size_t max_samples) const;
+
+  // Oldest held sample and one past the newest.
+  uint64_t begin_sample() const { return first_sample_; }
+  uint64_t end_sample() const { return total_samples_; }
+
+  // Bytes currently used for audio (encoded blocks plus the open block).
+  size_t memory_bytes() const;
+  // Bytes allocated for encoded blocks.
+  size_t capacity_bytes() const { return ring_.size(); }
+
+  // Follows |pool|'s limit: shrinks to it, dropping the oldest blocks, or
+  // grows toward it as far as the pool admits. Cheap when nothing changed.
+  void FitToPool(MemoryPool* pool);
+
+  void Reset();
+
+ private:
+  void EncodeBlock(const int16_t* samples, uint8_t* out);
+  static void DecodeBlock(const uint8_t* block, int16_t* out);
+  // Reallocates the ring for |blocks| (at least one), keeping the newest.
+  void SetCapacityBlocks(size_t blocks);
+
+  size_t max_blocks_;
+  std::vector<uint8_t> ring_;  // max_blocks_ * kBlockBytes
+  size_t oldest_slot_ = 0;
+  size_t block_count_ = 0;
+
+  // Samples of the block being filled, kept as PCM until it is complete.
+  std::vector<int16_t> open_block_;
+
+  uint64_t first_sample_ = 0;
+  uint64_t total_samples_ = 0;
+};
@@ -0,0 +1,136 @@
+#include "audio_quality.h"
+
+#include <algorithm>
+#include <cmath>
+
+AudioQualityMeter::AudioQualityMeter() { Reset(); }
+
+void AudioQualityMeter::Reset() {
+  samples_ = 0;
+  idle_samples_ = 0;
+  clipped_ = 0;
+  sum_ = 0.0;
+  frame_count_ = 0;
+  frame_energy_ = 0.0;
+  frame_lag1_ = 0.0;
+  frame_nonzero_ = false;
+  previous_ = 0.0f;
+  level_bins_.fill(0);
+  level_frames_ = 0;
+  tilt_r0_ = 0.0;
+  tilt_r1_ = 0.0;
+  zero_run_ = 0;
+  seen_signal_ = false;
+  dropouts_ = 0;
+  dropout_samples_ = 0;
+  silence_samples_ = 0;
+  discontinuities_ = 0;
+}
+
+void AudioQualityMeter::Process(const float* samples, size_t count) {
+  double sum = 0.0;
+  uint64_t clipped = 0;
+  for (size_t i = 0; i < count; i++) {
+    const float x = samples[i];
+    sum += x;
+    if (std::fabs(x) >= kClipLevel) clipped++;
+
+    if (x == 0.0f) {
+      zero_run_++;
+    } else {
+      if (zero_run_ > 0) EndZeroRun();
+      seen_signal_ = true;
+      frame_nonzero_ = true;
+    }
+
+    frame_energy_ += static_cast<double>(x) * x;
+    frame_lag1_ += static_cast<double>(x) * previous_;
+    previous_ = x;
+    if (++frame_count_ == kFrameSamples) EndFrame();
+  }
+  samples_ += count;
+  clipped_ += clipped;
+  sum_ += sum;
+}
+
+void AudioQualityMeter::AddIdle(size_t count) {
+  // The audio on either side of the gap is not contiguous, so a zero run
+  // does not continue across it.
+  if (zero_run_ > 0) EndZeroRun();
+  idle_samples_ += count;
+}
+
+void AudioQualityMeter::EndFrame() {
+  if (frame_nonzero_) {
+    const double energy = frame_energy_ / kFrameSamples;
+    const double level_db = 10.0 * std::log10(energy + 1e-10);
+    const int bin = (std::min)(kLevelBins - 1,
+                               (std::max)(0, static_cast<int>(std::floor(level_db)) - kMinLevelDb));
+    level_bins_[bin]++;
+    level_frames_++;
+    if (level_db >= kTiltFloorDb) {
+      tilt_r0_ += frame_energy_;
+      tilt_r1_ += frame_lag1_;
+    }
+  }
+  frame_count_ = 0;
+  frame_energy_ = 0.0;
+  frame_lag1_ = 0.0;
+  frame_nonzero_ = false;
+}
+
+void AudioQualityMeter::EndZeroRun() {
+  // Zeros before the first signal are the stream starting, not a dropout.
+  if (!seen_signal_) {
+    silence_samples_ += zero_run_;
+  } else if (zero_run_ > kDropoutMaxSamples) {
+    silence_samples_ += zero_run_;
+  } else if (zero_run_ >= kDropoutMinSamples) {
+    dropouts_++;
+    dropout_samples_ += zero_run_;
+  }
+  zero_run_ = 0;
+}
+
+double AudioQualityMeter::LevelPercentile(double fraction) const {
+  if (level_frames_ == 0) return static_cast<double>(kMinLevelDb);
+  const double target = fraction * static_cast<double>(level_frames_);
+  uint64_t seen = 0;
+  for (int i = 0; i < kLevelBins; i++) {
+    seen += level_bins_[i];
+    if (static_cast<double>(seen) >= target) return static_cast<double>(kMinLevelDb + i) + 0.5;
+  }
+  return 0.0;
+}
+
+AudioQualityMeter::Summary AudioQualityMeter::GetSummary() const {
+  Summary summary;
+  summary.samples = samples_;
+  summary.seconds = static_cast<double>(samples_ + idle_samples_) / 16000.0;
+  summary.idle_ms = static_cast<double>(idle_samples_) / 16.0;
+  if (samples_ > 0) {
+    summary.clip_rate = static_cast<double>(clipped_) / static_cast<double>(samples_);
+    summary.dc_offset = sum_ / static_cast<double>(samples_);
+  }
+  summary.level_p10_db = LevelPercentile(0.10);
+  summary.level_p50_db = LevelPercentile(0.50);
+  summary.level_p95_db = LevelPercentile(0.95);
+  summary.snr_db = level_frames_ > 0 ? summary.level_p95_db - summary.level_p10_db : 0.0;
+
+  // A zero run still open counts once it is long enough to be silence.
+  uint64_t silence = silence_samples_;
+  if (zero_run_ > kDropoutMaxSamples || !seen_signal_) silence += zero_run_;
+  summary.dropouts = dropouts_;
+  summary.dropout_ms = static_cast<double>(dropout_samples_) / 16.0;
+  summary.digital_silence_ms = static_cast<double>(silence) / 16.0;
+  summary.discontinuities = discontinuities_;
+
+  const double low = tilt_r0_ + tilt_r1_;
+  const double high = tilt_r0_ - tilt_r1_;
+  if (low > 0.0 && high > 0.0) summary.spectral_tilt_db = 10.0 * std::log10(high / low);
+
+  for (int i = 0; i < kLevelBins; i++) {
+    summary.level_histogram[i / kSummaryBinDb] += level_bins_[i];
+  }
+  return summary;
+}
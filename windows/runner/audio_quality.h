@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Input quality statistics for one 16kHz mono float stream, kept in constant
+// memory so they can run for a whole session: clipping, DC offset, the
+// distribution of 10 ms frame levels, an SNR estimate from that distribution,
+// dropouts (short runs of exact zeros inside the signal) and spectral tilt.
+// Not thread-safe; the owner serializes Process() and GetSummary().
+class AudioQualityMeter {
+ public:
+  // Frame levels are kept in 1 dB bins from kMinLevelDb to 0 dBFS.
+  static constexpr int kMinLevelDb = -90;
+  static constexpr int kLevelBins = -kMinLevelDb + 1;
+  // The summary's coarse level histogram uses this bin width.
+  static constexpr int kSummaryBinDb = 6;
+  static constexpr int kSummaryBins = (kLevelBins + kSummaryBinDb - 1) / kSummaryBinDb;
+
+  struct Summary {
+    uint64_t samples = 0;            // Analysed samples
+    double seconds = 0.0;            // Analysed and idle time
+    double idle_ms = 0.0;            // Skipped by a wake gate, not analysed
+    double clip_rate = 0.0;          // Fraction of samples at full scale
+    double dc_offset = 0.0;          // Mean sample value, full scale = 1
+    // Frame level percentiles (dBFS) over frames that are not digital silence.
+    double level_p10_db = 0.0;
+    double level_p50_db = 0.0;
+    double level_p95_db = 0.0;
+    // Loud frames (p95) over the quiet floor (p10).
+    double snr_db = 0.0;
+    uint64_t dropouts = 0;           // Zero runs of 5..200 ms inside signal
+    double dropout_ms = 0.0;
+    double digital_silence_ms = 0.0; // Longer zero runs
+    uint64_t discontinuities = 0;    // Reported by the capture device
+    // High-band over low-band energy of a first-order split of the frames
+    // above kTiltFloorDb: about 0 dB for white noise, strongly negative for
+    // muffled input, rising towards 0 with hiss.
+    double spectral_tilt_db = 0.0;
+    std::array<uint32_t, kSummaryBins> level_histogram{};  // From kMinLevelDb up
+  };
+
+  AudioQualityMeter();
+
+  void Process(const float* samples, size_t count);
+  // |count| samples passed without speech and were not analysed (the capture
+  // wake gate skipped them). They count towards the session length only.
+  void AddIdle(size_t count);
+  // The device reported a gap in the stream (e.g. a WASAPI discontinuity).
+  void AddDiscontinuity() { discontinuities_++; }
+
+  Summary GetSummary() const;
+  void Reset();
+
+ private:
+  static constexpr int kFrameSamples = 160;             // 10 ms
+  static constexpr uint32_t kDropoutMinSamples = 80;    // 5 ms
+  static constexpr uint32_t kDropoutMaxSamples = 3200;  // 200 ms
+  static constexpr float kClipLevel = 0.99f;
+  static constexpr float kTiltFloorDb = -45.0f;
+
+  void EndFrame();
+  void EndZeroRun();
+  double LevelPercentile(double fraction) const;
+
+  uint64_t samples_ = 0;
+  uint64_t idle_samples_ = 0;
+  uint64_t clipped_ = 0;
+  double sum_ = 0.0;
+
+  // Current frame.
+  int frame_count_ = 0;
+  double frame_energy_ = 0.0;
+  double frame_lag1_ = 0.0;
+  bool frame_nonzero_ = false;
+  float previous_ = 0.0f;
+
+  std::array<uint32_t, kLevelBins> level_bins_{};
+  uint64_t level_frames_ = 0;
+
+  // Tilt accumulators over loud frames.
+  double tilt_r0_ = 0.0;
+  double tilt_r1_ = 0.0;
+
+  uint32_t zero_run_ = 0;
+  bool seen_signal_ = false;
+  uint64_t dropouts_ = 0;
+  uint64_t dropout_samples_ = 0;
+  uint64_t silence_samples_ = 0;
+  uint64_t discontinuities_ = 0;
+};
@@ -0,0 +1,357 @@
+#include "audio_uplink.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <iostream>
+
+#include "audio_clock.h"
+#include "tracepoints.h"
+
+namespace {
+
+#if defined(_WIN32)
+using SocketHandle = SOCKET;
+#else
+using SocketHandle = int;
+#endif
+
+// Hello is repeated at this interval until the relay answers.
+constexpr int kHelloIntervalMs = 250;
+// Without a relay datagram for this long the link is considered down.
+constexpr int64_t kSilenceTimeoutMs = 2000;
+constexpr int kReceiveTimeoutMs = 100;
+// Report payload: per stream u32 received, recovered, lost.
+constexpr size_t kReportBytes = 12;
+
+static SocketHandle AsSocket(intptr_t handle) {
+  return static_cast<SocketHandle>(handle);
+}
+
+static void CloseSocket(intptr_t handle) {
+#if defined(_WIN32)
+  closesocket(AsSocket(handle));
+#else
+  close(AsSocket(handle));
+#endif
+}
+
+static uint32_t ReadU32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static bool DecodeHex(const std::string& hex, std::vector<uint8_t>* out) {
+  if (hex.empty() || hex.size() % 2 != 0) return false;
+  auto nibble = [](char c) -> int {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  };
+  out->clear();
+  for (size_t i = 0; i < hex.size(); i += 2) {
+    const int hi = nibble(hex[i]);
+    const int lo = nibble(hex[i + 1]);
+    if (hi < 0 || lo < 0) return false;
+    out->push_back(static_cast<uint8_t>((hi << 4) | lo));
+  }
+  return true;
+}
+
+}  // namespace
+
+AudioUplink::AudioUplink() {}
+
+AudioUplink::~AudioUplink() {
+  Stop();
+}
+
+bool AudioUplink::Start(const std::string& host, int port, uint32_t session_id,
+                        const std::string& token, const std::string& nonce_hex) {
+  Stop();
+
+  std::vector<uint8_t> nonce;
+  if (host.empty() || port <= 0 || port > 65535 || token.empty() ||
+      !DecodeHex(nonce_hex, &nonce)) {
+    std::cerr << "[AudioUplink] Invalid session parameters" << std::endl;
+    return false;
+  }
+
+#if defined(_WIN32)
+  WSADATA wsa_data;
+  if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+    std::cerr << "[AudioUplink] WSAStartup failed" << std::endl;
+    return false;
+  }
+#endif
+
+  // Resolving can block for seconds, so it happens on the receive thread;
+  // until that thread has connected and the relay answered, healthy() is
+  // false and audio keeps going over the WebSocket.
+  host_ = host;
+  port_ = port;
+  key_ = uplink::DeriveKey(token, nonce.data(), nonce.size());
+  session_id_ = session_id;
+  for (int s = 0; s < kStreams; s++) {
+    next_seq_[s] = 0;
+    parity_[s].Reset();
+  }
+  packets_sent_ = 0;
+  parity_sent_ = 0;
+  bytes_sent_ = 0;
+  received_ = 0;
+  recovered_ = 0;
+  lost_ = 0;
+  welcomed_ = false;
+  last_heard_ms_ = 0;
+  running_ = true;
+  receive_thread_ = new std::thread(&AudioUplink::ReceiveThreadProc, this);
+
+  std::cout << "[AudioUplink] Session " << session_id << " to " << host << ":" << port
+            << std::endl;
+  return true;
+}
+
+bool AudioUplink::Connect() {
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_protocol = IPPROTO_UDP;
+  addrinfo* result = nullptr;
+  const std::string service = std::to_string(port_);
+  if (getaddrinfo(host_.c_str(), service.c_str(), &hints, &result) != 0 || !result) {
+    std::cerr << "[AudioUplink] Cannot resolve " << host_ << std::endl;
+    return false;
+  }
+
+  // A connected UDP socket: send()/recv() only talk to the relay.
+  intptr_t connected = -1;
+  for (addrinfo* ai = result; ai && running_; ai = ai->ai_next) {
+    SocketHandle s = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+#if defined(_WIN32)
+    if (s == INVALID_SOCKET) continue;
+#else
+    if (s < 0) continue;
+#endif
+    if (connect(s, ai->ai_addr, static_cast<int>(ai->ai_addrlen)) == 0) {
+      connected = static_cast<intptr_t>(s);
+      break;
+    }
+    CloseSocket(static_cast<intptr_t>(s));
+  }
+  freeaddrinfo(result);
+  if (connected == -1) {
+    if (running_) {
+      std::cerr << "[AudioUplink] Cannot open socket to " << host_ << ":" << port_ << std::endl;
+    }
+    return false;
+  }
+
+#if defined(_WIN32)
+  DWORD timeout = kReceiveTimeoutMs;
+  setsockopt(AsSocket(connected), SOL_SOCKET, SO_RCVTIMEO,
+             reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+#else
+  timeval timeout = {};
+  timeout.tv_usec = kReceiveTimeoutMs * 1000;
+  setsockopt(AsSocket(connected), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+  // Published before any Welcome can set welcomed_, which is what lets the
+  // platform thread send on it.
+  socket_ = connected;
+  return true;
+}
+
+void AudioUplink::Stop() {
+  if (!running_) return;
+
+  running_ = false;
+  if (receive_thread_) {
+    receive_thread_->join();
+    delete receive_thread_;
+    receive_thread_ = nullptr;
+  }
+  if (socket_ != -1) {
+    uplink::Header bye;
+    bye.type = uplink::kBye;
+    bye.session = session_id_;
+    bye.time_ms = static_cast<uint32_t>(SteadyNowMs());
+    SendPacket(bye, nullptr, 0, &packet_);
+    CloseSocket(socket_);
+    socket_ = -1;
+  }
+  welcomed_ = false;
+#if defined(_WIN32)
+  WSACleanup();
+#endif
+
+  std::cout << "[AudioUplink] Stopped after " << packets_sent_ << " packets (" << parity_sent_
+            << " parity), relay lost " << lost_ << ", recovered " << recovered_ << std::endl;
+}
+
+bool AudioUplink::healthy() const {
+  return running_ && welcomed_ && SteadyNowMs() - last_heard_ms_ < kSilenceTimeoutMs;
+}
+
+bool AudioUplink::SendPacket(const uplink::Header& header, const uint8_t* payload,
+                             size_t length, std::vector<uint8_t>* buffer) {
+  uplink::BuildPacket(key_, header, payload, length, buffer);
+  const int sent = send(AsSocket(socket_), reinterpret_cast<const char*>(buffer->data()),
+                        static_cast<int>(buffer->size()), 0);
+  return sent == static_cast<int>(buffer->size());
+}
+
+bool AudioUplink::Send(uint8_t stream, const uint8_t* data, size_t length) {
+  if (stream >= kStreams || !healthy()) return false;
+  if (!data || length == 0) return true;
+
+  uplink::Header header;
+  header.session = session_id_;
+  header.stream = stream;
+  header.time_ms = static_cast<uint32_t>(SteadyNowMs());
+
+  // Once the first chunk is out the rest goes the same way; a failed send
+  // after that is just loss for the FEC and jitter buffer to absorb.
+  bool any_sent = false;
+  for (size_t offset = 0; offset < length; offset += uplink::kMaxAudioPayload) {
+    const size_t chunk = (std::min)(uplink::kMaxAudioPayload, length - offset);
+    header.type = uplink::kAudio;
+    header.count = 0;
+    header.seq = next_seq_[stream];
+    if (!SendPacket(header, data + offset, chunk, &packet_)) {
+      if (!any_sent) return false;
+    } else {
+      packets_sent_++;
+      bytes_sent_ += packet_.size();
+      HN_TRACE_SOCKET_SEND(stream, header.seq, packet_.size());
+    }
+    any_sent = true;
+    next_seq_[stream]++;
+
+    uint32_t first_seq = 0;
+    uint8_t count = 0;
+    if (parity_[stream].Add(header.seq, data + offset, chunk, &parity_payload_, &first_seq,
+                            &count)) {
+      SendParity(header, first_seq, count);
+    }
+  }
+  return true;
+}
+
+bool AudioUplink::Finalize(uint8_t stream) {
+  if (stream >= kStreams || !healthy()) return false;
+
+  uplink::Header header;
+  header.session = session_id_;
+  header.stream = stream;
+  header.time_ms = static_cast<uint32_t>(SteadyNowMs());
+
+  // The utterance's last packets would otherwise wait for a group that the
+  // next utterance completes, seconds later.
+  uint32_t first_seq = 0;
+  uint8_t count = 0;
+  if (parity_[stream].Flush(&parity_payload_, &first_seq, &count)) {
+    SendParity(header, first_seq, count);
+  }
+
+  header.type = uplink::kFinalize;
+  header.seq = next_seq_[stream];
+  return SendPacket(header, nullptr, 0, &packet_);
+}
+
+void AudioUplink::SendParity(const uplink::Header& audio, uint32_t first_seq, uint8_t count) {
+  uplink::Header parity = audio;
+  parity.type = uplink::kParity;
+  parity.seq = first_seq;
+  parity.count = count;
+  if (SendPacket(parity, parity_payload_.data(), parity_payload_.size(), &packet_)) {
+    parity_sent_++;
+    bytes_sent_ += packet_.size();
+  }
+}
+
+AudioUplink::Stats AudioUplink::stats() const {
+  Stats stats;
+  stats.packets_sent = packets_sent_;
+  stats.parity_sent = parity_sent_;
+  stats.bytes_sent = bytes_sent_;
+  stats.received = received_;
+  stats.recovered = recovered_;
+  stats.lost = lost_;
+  return stats;
+}
+
+void AudioUplink::ReceiveThreadProc() {
+  // The link stays down, and Send() keeps refusing, if the relay cannot be
+  // reached; Stop() still joins normally.
+  if (!Connect()) return;
+
+  std::vector<uint8_t> buffer(1500);
+  std::vector<uint8_t> hello_packet;
+  int64_t last_hello_ms = 0;
+
+  while (running_) {
+    // (Re)introduce ourselves until the relay answers; also re-opens NAT
+    // bindings after the link has gone quiet.
+    const int64_t now = SteadyNowMs();
+    if (!healthy() && now - last_hello_ms >= kHelloIntervalMs) {
+      uplink::Header hello;
+      hello.type = uplink::kHello;
+      hello.session = session_id_;
+      hello.time_ms = static_cast<uint32_t>(now);
+      SendPacket(hello, nullptr, 0, &hello_packet);
+      last_hello_ms = now;
+    }
+
+    const int received = recv(AsSocket(socket_), reinterpret_cast<char*>(buffer.data()),
+                              static_cast<int>(buffer.size()), 0);
+    if (received <= 0) continue;  // Timeout, or ICMP unreachable from a closed port
+
+    uplink::Header header;
+    const uint8_t* payload = nullptr;
+    size_t payload_length = 0;
+    if (!uplink::ParsePacket(key_, buffer.data(), static_cast<size_t>(received), &header,
+                             &payload, &payload_length) ||
+        header.session != session_id_) {
+      continue;
+    }
+
+    switch (header.type) {
+      case uplink::kWelcome:
+        if (!welcomed_) std::cout << "[AudioUplink] Relay accepted session" << std::endl;
+        welcomed_ = true;
+        last_heard_ms_ = SteadyNowMs();
+        break;
+      case uplink::kReport:
+        last_heard_ms_ = SteadyNowMs();
+        if (payload_length >= kReportBytes * kStreams) {
+          uint32_t received_total = 0, recovered_total = 0, lost_total = 0;
+          for (int s = 0; s < kStreams; s++) {
+            received_total += ReadU32(payload + s * kReportBytes);
+            recovered_total += ReadU32(payload + s * kReportBytes + 4);
+            lost_total += ReadU32(payload + s * kReportBytes + 8);
+          }
+          received_ = received_total;
+          recovered_ = recovered_total;
+          lost_ = lost_total;
+        }
+        break;
+      case uplink::kBye:
+        std::cout << "[AudioUplink] Relay closed session" << std::endl;
+        welcomed_ = false;
+        break;
+      default:
+        break;
+    }
+  }
+}
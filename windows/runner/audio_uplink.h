@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "uplink_protocol.h"
+
+// Optional datagram uplink for mic and system audio to the relay.
+//
+// The WebSocket stays the control channel and the fallback: the relay offers
+// a UDP session over it (udp_ready), and Dart routes audio here only while
+// Send() accepts it. Packets are sequenced per stream and protected by one
+// XOR parity packet per uplink::kFecGroup, so a single loss per group is
+// repaired by the relay's jitter buffer without a retransmit round trip.
+//
+// The link counts as healthy once the relay has answered the Hello and for as
+// long as its reports (every 500 ms) keep arriving. Send() returns false while
+// it is not, and the caller sends that audio over the WebSocket instead.
+//
+// Start/Stop/Send run on the platform thread; a receive thread resolves the
+// relay, then handles the handshake and the relay's reports.
+class AudioUplink {
+ public:
+  // Relay-side counters from the latest report.
+  struct Stats {
+    uint64_t packets_sent = 0;
+    uint64_t parity_sent = 0;
+    uint64_t bytes_sent = 0;
+    uint32_t received = 0;
+    uint32_t recovered = 0;
+    uint32_t lost = 0;
+  };
+
+  AudioUplink();
+  ~AudioUplink();
+
+  // |nonce_hex| is the relay's per-session nonce, hex encoded.
+  bool Start(const std::string& host, int port, uint32_t session_id,
+             const std::string& token, const std::string& nonce_hex);
+  void Stop();
+  bool active() const { return running_; }
+  bool healthy() const;
+
+  // Sends 16kHz mono PCM16 for |stream| (0 mic, 1 system). False when the
+  // link is down and the audio was not sent.
+  bool Send(uint8_t stream, const uint8_t* data, size_t length);
+
+  // Marks the end of |stream|'s utterance after the audio sent so far, for
+  // the relay to finalize once that audio is out of its jitter buffer. False
+  // when the link is down; the caller then finalizes over the WebSocket.
+  bool Finalize(uint8_t stream);
+
+  Stats stats() const;
+
+ private:
+  static constexpr int kStreams = 2;
+
+  // Receive thread: resolves |host_| and opens |socket_|.
+  bool Connect();
+  void ReceiveThreadProc();
+  bool SendPacket(const uplink::Header& header, const uint8_t* payload,
+                  size_t length, std::vector<uint8_t>* buffer);
+  void SendParity(const uplink::Header& audio, uint32_t first_seq, uint8_t count);
+
+  std::atomic<intptr_t> socket_{-1};  // SOCKET or fd; set by the receive thread
+  std::string host_;
+  int port_ = 0;
+  uplink::Key key_{};
+  uint32_t session_id_ = 0;
+  std::thread* receive_thread_ = nullptr;
+  std::atomic<bool> running_{false};
+  std::atomic<bool> welcomed_{false};
+  std::atomic<int64_t> last_heard_ms_{0};
+
+  // Platform thread only.
+  uint32_t next_seq_[kStreams] = {};
+  uplink::ParityBuilder parity_[kStreams];
+  std::vector<uint8_t> packet_;
+  std::vector<uint8_t> parity_payload_;
+  uint64_t packets_sent_ = 0;
+  uint64_t parity_sent_ = 0;
+  uint64_t bytes_sent_ = 0;
+
+  // From the receive thread.
+  std::atomic<uint32_t> received_{0};
+  std::atomic<uint32_t> recovered_{0};
+  std::atomic<uint32_t> lost_{0};
+};
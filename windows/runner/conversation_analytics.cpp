@@ -0,0 +1,141 @@
+#include "conversation_analytics.h"
+
+#include <algorithm>
+
+namespace {
+
+// Silence longer than this ends a turn.
+constexpr int64_t kTurnGapMs = 1500;
+// Gaps shorter than this are treated as part of continuous speech.
+constexpr int64_t kMinPauseMs = 200;
+// The other side must have been talking this long for a new turn to count as
+// an interruption rather than a simultaneous start or a backchannel.
+constexpr int64_t kInterruptAfterMs = 1000;
+// How far back speech intervals are kept for overlap; far more than the lag
+// between the mic and system streams.
+constexpr int64_t kIntervalWindowMs = 30000;
+// Bounds the interval history if a stream flaps between speech and silence.
+constexpr size_t kMaxIntervals = 1024;
+
+static int PauseBucket(int64_t gap_ms) {
+  if (gap_ms < 500) return 0;
+  if (gap_ms < 1000) return 1;
+  if (gap_ms < 2000) return 2;
+  if (gap_ms < 5000) return 3;
+  return 4;
+}
+
+}  // namespace
+
+bool ConversationAnalytics::SpeakingAt(const ChannelState& state, int64_t t_ms) {
+  if (state.recent.empty()) return false;
+  for (auto it = state.recent.rbegin(); it != state.recent.rend(); ++it) {
+    if (it->end_ms <= t_ms) break;
+    if (it->start_ms <= t_ms) return true;
+  }
+  return t_ms >= state.reported_until_ms &&
+         state.recent.back().end_ms == state.reported_until_ms;
+}
+
+void ConversationAnalytics::OnFrame(Channel channel,
+                                    int64_t t_ms,
+                                    int duration_ms,
+                                    bool speech) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  const int64_t end_ms = t_ms + duration_ms;
+  if (!started_) {
+    started_ = true;
+    first_ms_ = t_ms;
+  }
+  first_ms_ = (std::min)(first_ms_, t_ms);
+  last_ms_ = (std::max)(last_ms_, end_ms);
+
+  ChannelState& self = state_[channel];
+  const ChannelState& other = state_[channel == kMic ? kSystem : kMic];
+  // Read before this frame moves the reported edge.
+  const bool other_speaking = speech && SpeakingAt(other, t_ms);
+  self.reported_until_ms = (std::max)(self.reported_until_ms, end_ms);
+
+  if (!speech) return;
+
+  if (!self.has_speech || t_ms - self.last_speech_end_ms > kTurnGapMs) {
+    if (self.has_speech) {
+      self.stats.pauses[PauseBucket(t_ms - self.last_speech_end_ms)]++;
+    }
+    self.stats.turns++;
+    self.turn_start_ms = t_ms;
+    if (other_speaking && t_ms - other.turn_start_ms >= kInterruptAfterMs) {
+      self.stats.interruptions++;
+    }
+  } else if (t_ms - self.last_speech_end_ms >= kMinPauseMs) {
+    self.stats.pauses[PauseBucket(t_ms - self.last_speech_end_ms)]++;
+  }
+
+  self.has_speech = true;
+  self.last_speech_end_ms = (std::max)(self.last_speech_end_ms, end_ms);
+  self.stats.speech_ms += duration_ms;
+  self.stats.current_turn_ms = self.last_speech_end_ms - self.turn_start_ms;
+  self.stats.longest_turn_ms =
+      (std::max)(self.stats.longest_turn_ms, self.stats.current_turn_ms);
+
+  // Count overlap with the part of the other side's speech it has already
+  // reported; the rest is counted when the other side reports it.
+  for (auto it = other.recent.rbegin(); it != other.recent.rend(); ++it) {
+    if (it->end_ms <= t_ms) break;
+    const int64_t from = (std::max)(it->start_ms, t_ms);
+    const int64_t to = (std::min)(it->end_ms, end_ms);
+    if (to > from) overlap_ms_ += to - from;
+  }
+
+  if (!self.recent.empty() && self.recent.back().end_ms >= t_ms) {
+    self.recent.back().end_ms = (std::max)(self.recent.back().end_ms, end_ms);
+  } else {
+    self.recent.push_back({t_ms, end_ms});
+  }
+  while (self.recent.size() > kMaxIntervals ||
+         (!self.recent.empty() && self.recent.front().end_ms < end_ms - kIntervalWindowMs)) {
+    self.recent.pop_front();
+  }
+}
+
+void ConversationAnalytics::AddWords(Channel channel, int64_t words) {
+  if (words <= 0) return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  state_[channel].stats.words += words;
+}
+
+ConversationAnalytics::Snapshot ConversationAnalytics::GetSnapshot() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  Snapshot snapshot;
+  int64_t talk_ms = 0;
+  for (int c = 0; c < kChannelCount; c++) {
+    ChannelStats stats = state_[c].stats;
+    if (stats.speech_ms > 0) {
+      stats.words_per_minute = stats.words * 60000.0 / stats.speech_ms;
+    }
+    // A turn only stays current while its silence is shorter than the gap.
+    if (state_[c].has_speech && last_ms_ - state_[c].last_speech_end_ms > kTurnGapMs) {
+      stats.current_turn_ms = 0;
+    }
+    talk_ms += stats.speech_ms;
+    snapshot.channels[c] = stats;
+  }
+  snapshot.overlap_ms = overlap_ms_;
+  snapshot.elapsed_ms = started_ ? last_ms_ - first_ms_ : 0;
+  if (talk_ms > 0) {
+    snapshot.mic_talk_ratio =
+        static_cast<double>(snapshot.channels[kMic].speech_ms) / talk_ms;
+  }
+  return snapshot;
+}
+
+void ConversationAnalytics::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  state_ = {};
+  overlap_ms_ = 0;
+  started_ = false;
+  first_ms_ = 0;
+  last_ms_ = 0;
+}
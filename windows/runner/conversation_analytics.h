@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// Running conversation statistics for the two talkers of a meeting: the local
+// user (mic) and everyone on the call (system).
+//
+// Driven by frame-level speech activity with millisecond timestamps on a
+// shared clock; everything is accumulated in fixed-size counters so a snapshot
+// costs the same after five minutes or five hours. Thread-safe: mic frames
+// arrive on the platform thread and system frames on the capture thread.
+//
+// Timestamps are capture times, but the two channels do not report them at
+// the same moment: mic frames come through Dart pushes and trail the system
+// frames by a push or more. Each channel therefore keeps its recent speech
+// intervals, and overlap is counted once, by whichever side reports a
+// stretch of time second, so the result does not depend on arrival order.
+class ConversationAnalytics {
+ public:
+  enum Channel { kMic = 0, kSystem = 1, kChannelCount = 2 };
+
+  // Pause buckets (ms): [200,500) [500,1000) [1000,2000) [2000,5000) [5000,inf)
+  static constexpr int kPauseBuckets = 5;
+
+  struct ChannelStats {
+    int64_t speech_ms = 0;
+    int64_t turns = 0;
+    int64_t current_turn_ms = 0;
+    int64_t longest_turn_ms = 0;
+    int64_t interruptions = 0;  // Turns started while the other side talked.
+    int64_t words = 0;
+    double words_per_minute = 0.0;
+    std::array<int64_t, kPauseBuckets> pauses{};
+  };
+
+  struct Snapshot {
+    std::array<ChannelStats, kChannelCount> channels;
+    int64_t overlap_ms = 0;
+    int64_t elapsed_ms = 0;
+    // Share of talk time taken by the mic side (0..1).
+    double mic_talk_ratio = 0.0;
+  };
+
+  ConversationAnalytics() = default;
+
+  // Reports one activity frame of |duration_ms| starting at |t_ms|.
+  void OnFrame(Channel channel, int64_t t_ms, int duration_ms, bool speech);
+
+  // Adds words from a final transcript for speaking-rate estimation.
+  void AddWords(Channel channel, int64_t words);
+
+  Snapshot GetSnapshot() const;
+  void Reset();
+
+ private:
+  struct Interval {
+    int64_t start_ms;
+    int64_t end_ms;
+  };
+
+  struct ChannelState {
+    ChannelStats stats;
+    bool has_speech = false;
+    int64_t turn_start_ms = 0;
+    int64_t last_speech_end_ms = 0;
+    // End of the latest frame reported, speech or not.
+    int64_t reported_until_ms = 0;
+    // Merged speech intervals of the last kIntervalWindowMs.
+    std::deque<Interval> recent;
+  };
+
+  // True if |state| was speaking at |t_ms|, or has not reported that far yet
+  // and was still speaking at the end of what it has reported.
+  static bool SpeakingAt(const ChannelState& state, int64_t t_ms);
+
+  mutable std::mutex mutex_;
+  std::array<ChannelState, kChannelCount> state_;
+  int64_t overlap_ms_ = 0;
+  bool started_ = false;
+  int64_t first_ms_ = 0;
+  int64_t last_ms_ = 0;
+};
@@ -0,0 +1,225 @@
+#include "digital_copy_detector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+// One-pole low-pass at about 400 Hz for the low band; the high band is the
+// first difference.
+constexpr float kLowCoefficient = 0.145f;
+// Mean square of a block with anything in it (about -70 dBFS).
+constexpr double kActiveFloor = 1e-7;
+// Relative difference below which a comparison is treated as a tie.
+constexpr double kReliableMargin = 0.1;
+constexpr int64_t kReanchorMs = 200;
+constexpr double kEnterBitErrorRate = 0.15;
+constexpr double kLeaveBitErrorRate = 0.30;
+
+static int CountBits(uint8_t bits) {
+  int count = 0;
+  for (; bits != 0; bits &= static_cast<uint8_t>(bits - 1)) count++;
+  return count;
+}
+
+}  // namespace
+
+template <typename Emit>
+void DigitalCopyDetector::Coder::Push(const float* samples, size_t count, int64_t end_ms,
+                                      Emit emit) {
+  if (count == 0) return;
+  const int64_t start_ms = end_ms - static_cast<int64_t>(count / 16);
+  if (anchored_ &&
+      std::llabs(start_ms - (anchor_ms_ + static_cast<int64_t>(samples_ / 16))) > kReanchorMs) {
+    anchored_ = false;
+  }
+  if (!anchored_) {
+    Reset();
+    anchored_ = true;
+    anchor_ms_ = start_ms;
+  }
+  samples_ += count;
+
+  for (size_t i = 0; i < count; i++) {
+    const float x = samples[i];
+    low_ += kLowCoefficient * (x - low_);
+    const float high = x - previous_;
+    previous_ = x;
+    energy_ += x * x;
+    low_energy_ += low_ * low_;
+    high_energy_ += high * high;
+    if (++filled_ < kBlockSamples) continue;
+
+    // Every bit compares two energies of this stream, so gain cancels. A
+    // comparison within kReliableMargin of a tie is unreliable: either stream
+    // can land on either side of it.
+    uint8_t code = 0;
+    uint8_t reliable = 0;
+    const double comparisons[kCodeBits][2] = {
+        {energy_, last_energy_},
+        {low_energy_, last_low_},
+        {high_energy_, last_high_},
+        {low_energy_ * last_energy_, last_low_ * energy_},
+        {high_energy_ * last_energy_, last_high_ * energy_},
+    };
+    for (int bit = 0; bit < kCodeBits; bit++) {
+      const double a = comparisons[bit][0];
+      const double b = comparisons[bit][1];
+      if (a > b) code |= static_cast<uint8_t>(1 << bit);
+      if (std::fabs(a - b) > kReliableMargin * (std::max)(a, b)) {
+        reliable |= static_cast<uint8_t>(1 << bit);
+      }
+    }
+
+    Block block;
+    block.index = anchor_ms_ / 10 + blocks_++;
+    block.code = code;
+    block.reliable = reliable;
+    block.active = energy_ / kBlockSamples > kActiveFloor;
+    key_ = ((key_ << kCodeBits) | code) & ((1u << (kCodeBits * kKeyBlocks)) - 1);
+    run_ = block.active ? (std::min)(run_ + 1, kKeyBlocks) : 0;
+    emit(block, key_, run_ == kKeyBlocks);
+
+    last_energy_ = energy_;
+    last_low_ = low_energy_;
+    last_high_ = high_energy_;
+    energy_ = low_energy_ = high_energy_ = 0.0;
+    filled_ = 0;
+  }
+}
+
+void DigitalCopyDetector::Coder::Reset() {
+  *this = Coder();
+}
+
+DigitalCopyDetector::DigitalCopyDetector() {
+  Reset();
+}
+
+void DigitalCopyDetector::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  system_coder_.Reset();
+  mic_coder_.Reset();
+  system_history_.fill(Block{-1, 0, 0, false});
+  table_.fill(TableEntry{0, -1});
+  votes_.fill(0);
+  mic_blocks_since_decay_ = 0;
+  best_lag_ = 0;
+  lag_ = 0;
+  ClearWindow();
+  status_ = Status();
+}
+
+void DigitalCopyDetector::PushSystem(const float* samples, size_t count, int64_t end_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  system_coder_.Push(samples, count, end_ms, [this](const Block& block, uint32_t key, bool has_key) {
+    OnSystemBlock(block, key, has_key);
+  });
+}
+
+bool DigitalCopyDetector::PushMic(const float* samples, size_t count, int64_t end_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  mic_coder_.Push(samples, count, end_ms, [this](const Block& block, uint32_t key, bool has_key) {
+    OnMicBlock(block, key, has_key);
+  });
+  return status_.copy;
+}
+
+bool DigitalCopyDetector::is_copy() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return status_.copy;
+}
+
+DigitalCopyDetector::Status DigitalCopyDetector::status() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return status_;
+}
+
+size_t DigitalCopyDetector::Slot(uint32_t key) {
+  return static_cast<size_t>((key * 2654435761u) >> (32 - kTableBits));
+}
+
+void DigitalCopyDetector::ClearWindow() {
+  window_.fill(WindowEntry{0, 0});
+  window_count_ = 0;
+  window_next_ = 0;
+  window_bits_ = 0;
+  window_errors_ = 0;
+}
+
+void DigitalCopyDetector::OnSystemBlock(const Block& block, uint32_t key, bool has_key) {
+  system_history_[static_cast<size_t>(block.index) & (kHistoryBlocks - 1)] = block;
+  if (has_key) table_[Slot(key)] = TableEntry{key, block.index};
+}
+
+void DigitalCopyDetector::OnMicBlock(const Block& block, uint32_t key, bool has_key) {
+  if (has_key) {
+    const TableEntry& entry = table_[Slot(key)];
+    const int64_t lag = block.index - entry.index;
+    if (entry.index >= 0 && entry.key == key && std::llabs(lag) <= kMaxLagBlocks) {
+      uint16_t& votes = votes_[static_cast<size_t>(lag + kMaxLagBlocks)];
+      if (votes < UINT16_MAX) votes++;
+      if (votes > votes_[static_cast<size_t>(best_lag_ + kMaxLagBlocks)]) {
+        best_lag_ = static_cast<int>(lag);
+      }
+    }
+  }
+  if (++mic_blocks_since_decay_ >= kVoteDecayBlocks) {
+    for (uint16_t& votes : votes_) votes /= 2;
+    best_lag_ = static_cast<int>(std::max_element(votes_.begin(), votes_.end()) - votes_.begin()) -
+                kMaxLagBlocks;
+    mic_blocks_since_decay_ = 0;
+  }
+
+  // Follow the offset with the most votes; while a copy, only a clearly
+  // better one, so a stray match cannot reset the evidence.
+  const uint16_t best = votes_[static_cast<size_t>(best_lag_ + kMaxLagBlocks)];
+  const uint16_t current = votes_[static_cast<size_t>(lag_ + kMaxLagBlocks)];
+  if (best_lag_ != lag_ && best >= kMinVotes &&
+      (!status_.copy || best >= 2 * current + kMinVotes)) {
+    lag_ = best_lag_;
+    if (status_.copy) status_.lag_ms = lag_ * 10;
+    ClearWindow();
+  }
+
+  // Silence says nothing either way.
+  if (!block.active) return;
+  if (!status_.copy && votes_[static_cast<size_t>(lag_ + kMaxLagBlocks)] < kMinVotes) return;
+
+  const int64_t system_index = block.index - lag_;
+  const Block& system = system_history_[static_cast<size_t>(system_index) & (kHistoryBlocks - 1)];
+  WindowEntry entry = {kCodeBits, kCodeBits};
+  if (system.index == system_index && system.active) {
+    // Only bits both streams are sure of are compared.
+    const uint8_t compared = system.reliable & block.reliable;
+    entry.bits = static_cast<uint8_t>(CountBits(compared));
+    entry.errors = static_cast<uint8_t>(CountBits((system.code ^ block.code) & compared));
+  }
+  window_bits_ += entry.bits - window_[window_next_].bits;
+  window_errors_ += entry.errors - window_[window_next_].errors;
+  window_[window_next_] = entry;
+  window_next_ = (window_next_ + 1) % kWindowBlocks;
+  window_count_ = (std::min)(window_count_ + 1, kWindowBlocks);
+
+  if (window_count_ >= kWindowBlocks / 2 && window_bits_ > 0) {
+    status_.bit_error_rate =
+        static_cast<double>(window_errors_) / static_cast<double>(window_bits_);
+    const bool copy = status_.copy ? status_.bit_error_rate < kLeaveBitErrorRate
+                                   : status_.bit_error_rate <= kEnterBitErrorRate;
+    if (copy != status_.copy) {
+      status_.copy = copy;
+      status_.lag_ms = lag_ * 10;
+      status_.changes++;
+      std::cout << "[DigitalCopyDetector] Mic " << (copy ? "is" : "is no longer")
+                << " a copy of system audio (lag " << status_.lag_ms << " ms, "
+                << static_cast<int>(status_.bit_error_rate * 100) << "% bits differ)"
+                << std::endl;
+    }
+  }
+  if (status_.copy) {
+    status_.copy_ms += 10;
+    copy_ms_counter_->Add(10);
+  }
+}
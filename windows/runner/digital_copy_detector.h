@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "metrics.h"
+
+// Notices when the mic stream is a digital copy of the system stream, as with
+// a virtual audio cable or "listen to this device" looping meeting audio into
+// the mic, so the mic need not be transcribed a second time.
+//
+// Both 16kHz streams are cut into 10 ms blocks. Each block gets a 5-bit code:
+// whether the full-band, low-band and high-band energies rose since the last
+// block, and whether the low- and high-band shares of the energy rose. Every
+// bit compares energies of one stream with each other, so the code does not
+// depend on gain, and coarse energies survive the two streams going through
+// different resamplers.
+//
+// Four consecutive codes form a 20-bit rolling key. System keys go into a
+// small hash table. Each mic key found there votes for the offset between the
+// streams, which absorbs the delay of the copy path and the error in the
+// streams' timestamps. At the winning offset, the detector compares mic
+// codes with the system codes over the last second of mic activity, leaving
+// out bits that were a near tie in either stream. The mic is a copy while at
+// most 15% of the compared bits differ, and stops being one above 30%.
+// Independent audio differs in about half. A mic block with activity
+// and no matching system activity counts as entirely different, so speech
+// into a real mic ends copy mode within about a second.
+//
+// Thread-safe: the system stream pushes from the capture thread, the mic from
+// the platform thread.
+class DigitalCopyDetector {
+ public:
+  static constexpr int kBlockSamples = 160;  // 10 ms
+  static constexpr int kMaxLagBlocks = 200;  // Streams up to 2 s apart
+
+  struct Status {
+    bool copy = false;
+    int lag_ms = 0;         // Mic behind system; valid while |copy|
+    double bit_error_rate = 0.5;  // Over the last second compared
+    uint64_t copy_ms = 0;   // Mic audio flagged as a copy since Reset()
+    uint64_t changes = 0;   // Times |copy| changed since Reset()
+  };
+
+  DigitalCopyDetector();
+
+  // |end_ms| is the steady-clock time at the end of the samples; a stream
+  // jumping by more than 200 ms from where its sample count puts it is
+  // re-anchored there.
+  void PushSystem(const float* samples, size_t count, int64_t end_ms);
+  // Returns true while the mic is a copy of the system stream.
+  bool PushMic(const float* samples, size_t count, int64_t end_ms);
+
+  bool is_copy() const;
+  Status status() const;
+  void Reset();
+
+ private:
+  static constexpr int kKeyBlocks = 4;
+  static constexpr int kCodeBits = 5;
+  static constexpr int kHistoryBlocks = 512;  // Power of two, over 2 * kMaxLagBlocks
+  static constexpr int kTableBits = 12;
+  static constexpr int kWindowBlocks = 100;
+  static constexpr int kVoteDecayBlocks = 100;
+  static constexpr int kMinVotes = 3;
+
+  struct Block {
+    int64_t index;  // Steady-clock time / 10 ms
+    uint8_t code;
+    uint8_t reliable;  // Bits of |code| not decided by a near tie
+    bool active;
+  };
+
+  // Cuts one stream into blocks and codes them.
+  class Coder {
+   public:
+    // Calls |emit(block, key, has_key)| for every completed block.
+    template <typename Emit>
+    void Push(const float* samples, size_t count, int64_t end_ms, Emit emit);
+    void Reset();
+
+   private:
+    bool anchored_ = false;
+    int64_t anchor_ms_ = 0;
+    uint64_t samples_ = 0;  // Since the anchor
+    int64_t blocks_ = 0;    // Since the anchor
+    int filled_ = 0;
+    float low_ = 0.0f;
+    float previous_ = 0.0f;
+    double energy_ = 0.0;
+    double low_energy_ = 0.0;
+    double high_energy_ = 0.0;
+    double last_energy_ = 0.0;
+    double last_low_ = 0.0;
+    double last_high_ = 0.0;
+    uint32_t key_ = 0;
+    int run_ = 0;  // Consecutive active blocks in |key_|
+  };
+
+  struct TableEntry {
+    uint32_t key;
+    int64_t index;  // -1 when empty
+  };
+
+  void OnSystemBlock(const Block& block, uint32_t key, bool has_key);
+  void OnMicBlock(const Block& block, uint32_t key, bool has_key);
+  static size_t Slot(uint32_t key);
+  void ClearWindow();
+
+  mutable std::mutex mutex_;
+  Coder system_coder_;
+  Coder mic_coder_;
+  std::array<Block, kHistoryBlocks> system_history_;
+  std::array<TableEntry, size_t{1} << kTableBits> table_;
+  std::array<uint16_t, 2 * kMaxLagBlocks + 1> votes_;
+  int mic_blocks_since_decay_ = 0;
+  int best_lag_ = 0;  // Offset with the most votes, in blocks
+  int lag_ = 0;  // Offset being verified, in blocks
+  // Per compared mic block: bits compared and how many of them differ.
+  struct WindowEntry {
+    uint8_t bits;
+    uint8_t errors;
+  };
+  std::array<WindowEntry, kWindowBlocks> window_;
+  int window_count_ = 0;
+  int window_next_ = 0;
+  int window_bits_ = 0;
+  int window_errors_ = 0;
+  Status status_;
+
+  Counter* copy_ms_counter_ = Metrics().GetCounter("audio.mic.copy_ms");
+};
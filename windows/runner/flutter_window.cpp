@@ -1,15 +1,40 @@
 #include "flutter_window.h"
 
+#include <algorithm>
+#include <chrono>
+#include <iostream>
 #include <optional>
 
+#include <dwmapi.h>
 #include <flutter/encodable_value.h>
 #include <flutter/method_channel.h>
 #include <flutter/standard_method_codec.h>
 #include <winuser.h>
+#include <wtsapi32.h>
 
 #include "flutter/generated_plugin_registrant.h"
+#include "answer_index.h"
 #include "audio_capture.h"
+#include "audio_device_registry.h"
+#include "audio_quality.h"
+#include "audio_uplink.h"
+#include "conversation_analytics.h"
+#include "digital_copy_detector.h"
+#include "memory_governor.h"
+#include "metrics.h"
+#include "mic_stream.h"
+#include "mux_connection.h"
+#include "power_state.h"
+#include "sampling_profiler.h"
+#include "session_capture.h"
+#include "session_replayer.h"
+#include "session_sync_encoder.h"
+#include "stall_watchdog.h"
+#include "wasapi_device_backend.h"
 #include "win32_window.h"
+#include "winhttp_mux_transport.h"
+
+#pragma comment(lib, "wtsapi32.lib")
 
 #ifndef WDA_EXCLUDEFROMCAPTURE
 #define WDA_EXCLUDEFROMCAPTURE 0x00000011
@@ -17,10 +42,411 @@
 #ifndef WDA_NONE
 #define WDA_NONE 0x00000000
 #endif
+#ifndef EVENT_OBJECT_CLOAKED
+#define EVENT_OBJECT_CLOAKED 0x8017
+#define EVENT_OBJECT_UNCLOAKED 0x8018
+#endif
+
+// Budget for the native audio buffers. Declared first so it outlives every
+// pool; changed from the platform thread only.
+MemoryGovernor g_memory_governor;
+
+// Talk-time / turn statistics fed by both streams. Declared before the capture
+// so it outlives the capture thread at shutdown.
+ConversationAnalytics g_conversation_analytics;
+
+// Whether the mic is a digital copy of system audio. Declared before both
+// streams, which feed it.
+DigitalCopyDetector g_copy_detector;
+
+// Input and output endpoints, kept current from OS notifications. Declared
+// before the capture, which looks up the default output in it.
+AudioDeviceRegistry g_device_registry(std::make_unique<WasapiDeviceBackend>());
 
 // Global audio capture instance
 std::unique_ptr<AudioCapture> g_audio_capture;
 
+// Mic audio pushed from Dart (platform thread only)
+MicStream g_mic_stream(&g_conversation_analytics, &g_memory_governor);
+// The copy state last reported to Dart (platform thread only)
+bool g_mic_copy_reported = false;
+
+// Delta state for incremental session saves (platform thread only)
+SessionSyncEncoder g_session_sync;
+
+// Session capture recording and replay for profiling (platform thread only)
+SessionRecorder g_session_recorder;
+SessionReplayer g_session_replayer(&g_memory_governor);
+
+// Optional datagram uplink to the relay (platform thread only)
+AudioUplink g_audio_uplink;
+
+// Prepared questions and past answers for instant matches (platform thread only)
+AnswerIndex g_answer_index;
+
+// Persistent server connection carrying transcription and AI streams
+MuxConnection g_mux_connection(std::make_unique<WinHttpMuxTransport>());
+
+// Opt-in CPU profiler, started from a hidden setting (platform thread only)
+SamplingProfiler g_profiler;
+
+// The top-level window whose cloaking is watched (platform thread only)
+HWND g_power_window = nullptr;
+
+namespace {
+
+// Posted by the device registry from its notification thread; handled on the
+// platform thread, where the channel may be used.
+constexpr UINT kAudioDevicesChangedMessage = WM_APP + 1;
+// Posted by the mux connection's I/O thread when stream events are waiting.
+constexpr UINT kMuxEventsMessage = WM_APP + 2;
+// Posted by the cloak event hook when DWM hides or shows the window, as for
+// another virtual desktop.
+constexpr UINT kWindowCloakedMessage = WM_APP + 4;
+
+// Returns the value stored under |key| when the call arguments are a map.
+const flutter::EncodableValue* FindArgument(
+    const flutter::MethodCall<flutter::EncodableValue>& call, const char* key) {
+  if (!call.arguments() ||
+      !std::holds_alternative<flutter::EncodableMap>(*call.arguments())) {
+    return nullptr;
+  }
+  const auto& args = std::get<flutter::EncodableMap>(*call.arguments());
+  auto it = args.find(flutter::EncodableValue(key));
+  return it == args.end() ? nullptr : &it->second;
+}
+
+std::string GetStringArgument(
+    const flutter::MethodCall<flutter::EncodableValue>& call, const char* key,
+    const std::string& fallback = std::string()) {
+  const auto* value = FindArgument(call, key);
+  if (value && std::holds_alternative<std::string>(*value)) {
+    return std::get<std::string>(*value);
+  }
+  return fallback;
+}
+
+int64_t GetIntArgument(const flutter::MethodCall<flutter::EncodableValue>& call,
+                       const char* key, int64_t fallback = 0) {
+  const auto* value = FindArgument(call, key);
+  if (value && std::holds_alternative<int32_t>(*value)) {
+    return std::get<int32_t>(*value);
+  }
+  if (value && std::holds_alternative<int64_t>(*value)) {
+    return std::get<int64_t>(*value);
+  }
+  return fallback;
+}
+
+// Audio bytes passed either directly or as {"audio": Uint8List}.
+const std::vector<uint8_t>* GetAudioArgument(
+    const flutter::MethodCall<flutter::EncodableValue>& call) {
+  if (call.arguments() &&
+      std::holds_alternative<std::vector<uint8_t>>(*call.arguments())) {
+    return &std::get<std::vector<uint8_t>>(*call.arguments());
+  }
+  const auto* value = FindArgument(call, "audio");
+  if (value && std::holds_alternative<std::vector<uint8_t>>(*value)) {
+    return &std::get<std::vector<uint8_t>>(*value);
+  }
+  return nullptr;
+}
+
+flutter::EncodableMap ConversationChannelToMap(
+    const ConversationAnalytics::ChannelStats& stats) {
+  flutter::EncodableList pauses;
+  for (const int64_t count : stats.pauses) {
+    pauses.push_back(flutter::EncodableValue(count));
+  }
+  flutter::EncodableMap out;
+  out[flutter::EncodableValue("speechMs")] = flutter::EncodableValue(stats.speech_ms);
+  out[flutter::EncodableValue("turns")] = flutter::EncodableValue(stats.turns);
+  out[flutter::EncodableValue("currentTurnMs")] =
+      flutter::EncodableValue(stats.current_turn_ms);
+  out[flutter::EncodableValue("longestTurnMs")] =
+      flutter::EncodableValue(stats.longest_turn_ms);
+  out[flutter::EncodableValue("interruptions")] =
+      flutter::EncodableValue(stats.interruptions);
+  out[flutter::EncodableValue("words")] = flutter::EncodableValue(stats.words);
+  out[flutter::EncodableValue("wordsPerMinute")] =
+      flutter::EncodableValue(stats.words_per_minute);
+  out[flutter::EncodableValue("pauses")] = flutter::EncodableValue(pauses);
+  return out;
+}
+
+flutter::EncodableMap AudioQualityToMap(const AudioQualityMeter::Summary& summary) {
+  flutter::EncodableList histogram;
+  for (const uint32_t count : summary.level_histogram) {
+    histogram.push_back(flutter::EncodableValue(static_cast<int64_t>(count)));
+  }
+  flutter::EncodableMap out;
+  out[flutter::EncodableValue("seconds")] = flutter::EncodableValue(summary.seconds);
+  out[flutter::EncodableValue("idleMs")] = flutter::EncodableValue(summary.idle_ms);
+  out[flutter::EncodableValue("clipRate")] = flutter::EncodableValue(summary.clip_rate);
+  out[flutter::EncodableValue("dcOffset")] = flutter::EncodableValue(summary.dc_offset);
+  out[flutter::EncodableValue("levelP10Db")] = flutter::EncodableValue(summary.level_p10_db);
+  out[flutter::EncodableValue("levelP50Db")] = flutter::EncodableValue(summary.level_p50_db);
+  out[flutter::EncodableValue("levelP95Db")] = flutter::EncodableValue(summary.level_p95_db);
+  out[flutter::EncodableValue("snrDb")] = flutter::EncodableValue(summary.snr_db);
+  out[flutter::EncodableValue("dropouts")] =
+      flutter::EncodableValue(static_cast<int64_t>(summary.dropouts));
+  out[flutter::EncodableValue("dropoutMs")] = flutter::EncodableValue(summary.dropout_ms);
+  out[flutter::EncodableValue("digitalSilenceMs")] =
+      flutter::EncodableValue(summary.digital_silence_ms);
+  out[flutter::EncodableValue("discontinuities")] =
+      flutter::EncodableValue(static_cast<int64_t>(summary.discontinuities));
+  out[flutter::EncodableValue("spectralTiltDb")] =
+      flutter::EncodableValue(summary.spectral_tilt_db);
+  out[flutter::EncodableValue("levelHistogramMinDb")] =
+      flutter::EncodableValue(AudioQualityMeter::kMinLevelDb);
+  out[flutter::EncodableValue("levelHistogramBinDb")] =
+      flutter::EncodableValue(AudioQualityMeter::kSummaryBinDb);
+  out[flutter::EncodableValue("levelHistogram")] = flutter::EncodableValue(histogram);
+  return out;
+}
+
+flutter::EncodableMap AudioDeviceToMap(const AudioDeviceInfo& device) {
+  flutter::EncodableMap out;
+  out[flutter::EncodableValue("id")] = flutter::EncodableValue(device.id);
+  out[flutter::EncodableValue("name")] = flutter::EncodableValue(device.name);
+  out[flutter::EncodableValue("flow")] = flutter::EncodableValue(
+      device.flow == AudioDeviceFlow::kRender ? "render" : "capture");
+  out[flutter::EncodableValue("isDefault")] = flutter::EncodableValue(device.is_default);
+  out[flutter::EncodableValue("sampleRate")] = flutter::EncodableValue(device.format.sample_rate);
+  out[flutter::EncodableValue("channels")] = flutter::EncodableValue(device.format.channels);
+  out[flutter::EncodableValue("bitsPerSample")] =
+      flutter::EncodableValue(device.format.bits_per_sample);
+  out[flutter::EncodableValue("isFloat")] = flutter::EncodableValue(device.format.is_float);
+  return out;
+}
+
+flutter::EncodableMap MuxEventToMap(const MuxConnection::Event& event) {
+  const char* type = "text";
+  switch (event.type) {
+    case MuxConnection::EventType::kConnected:
+      type = "connected";
+      break;
+    case MuxConnection::EventType::kDisconnected:
+      type = "disconnected";
+      break;
+    case MuxConnection::EventType::kText:
+      break;
+    case MuxConnection::EventType::kClosed:
+      type = "closed";
+      break;
+  }
+  flutter::EncodableMap out;
+  out[flutter::EncodableValue("type")] = flutter::EncodableValue(type);
+  out[flutter::EncodableValue("stream")] =
+      flutter::EncodableValue(static_cast<int64_t>(event.stream));
+  out[flutter::EncodableValue("text")] = flutter::EncodableValue(event.text);
+  out[flutter::EncodableValue("code")] = flutter::EncodableValue(event.code);
+  return out;
+}
+
+flutter::EncodableMap MuxStatsToMap(const MuxConnection::Stats& stats) {
+  flutter::EncodableList priorities;
+  for (int p = 0; p < MuxConnection::kPriorities; p++) {
+    flutter::EncodableMap entry;
+    entry[flutter::EncodableValue("framesSent")] =
+        flutter::EncodableValue(static_cast<int64_t>(stats.frames_sent[p]));
+    entry[flutter::EncodableValue("bytesSent")] =
+        flutter::EncodableValue(static_cast<int64_t>(stats.bytes_sent[p]));
+    entry[flutter::EncodableValue("maxWaitUs")] = flutter::EncodableValue(stats.max_wait_us[p]);
+    priorities.push_back(flutter::EncodableValue(entry));
+  }
+  flutter::EncodableMap out;
+  out[flutter::EncodableValue("connected")] = flutter::EncodableValue(stats.connected);
+  out[flutter::EncodableValue("connects")] =
+      flutter::EncodableValue(static_cast<int64_t>(stats.connects));
+  out[flutter::EncodableValue("connectFailures")] =
+      flutter::EncodableValue(static_cast<int64_t>(stats.connect_failures));
+  out[flutter::EncodableValue("streamsOpened")] =
+      flutter::EncodableValue(static_cast<int64_t>(stats.streams_opened));
+  out[flutter::EncodableValue("openStreams")] =
+      flutter::EncodableValue(static_cast<int64_t>(stats.open_streams));
+  out[flutter::EncodableValue("framesReceived")] =
+      flutter::EncodableValue(static_cast<int64_t>(stats.frames_received));
+  out[flutter::EncodableValue("bytesReceived")] =
+      flutter::EncodableValue(static_cast<int64_t>(stats.bytes_received));
+  out[flutter::EncodableValue("creditStalls")] =
+      flutter::EncodableValue(static_cast<int64_t>(stats.credit_stalls));
+  out[flutter::EncodableValue("refused")] =
+      flutter::EncodableValue(static_cast<int64_t>(stats.refused));
+  out[flutter::EncodableValue("priorities")] = flutter::EncodableValue(priorities);
+  return out;
+}
+
+flutter::EncodableMap HistogramToMap(const HistogramSnapshot& h) {
+  flutter::EncodableMap out;
+  out[flutter::EncodableValue("count")] = flutter::EncodableValue(static_cast<int64_t>(h.count));
+  out[flutter::EncodableValue("sum")] = flutter::EncodableValue(h.sum);
+  out[flutter::EncodableValue("min")] = flutter::EncodableValue(h.min);
+  out[flutter::EncodableValue("max")] = flutter::EncodableValue(h.max);
+  out[flutter::EncodableValue("mean")] = flutter::EncodableValue(h.Mean());
+  out[flutter::EncodableValue("p50")] = flutter::EncodableValue(h.Percentile(0.5));
+  out[flutter::EncodableValue("p90")] = flutter::EncodableValue(h.Percentile(0.9));
+  out[flutter::EncodableValue("p99")] = flutter::EncodableValue(h.Percentile(0.99));
+  out[flutter::EncodableValue("p999")] = flutter::EncodableValue(h.Percentile(0.999));
+  return out;
+}
+
+flutter::EncodableMap MetricsToMap(const MetricsRegistry::Snapshot& snapshot) {
+  flutter::EncodableMap counters;
+  for (const auto& entry : snapshot.counters) {
+    counters[flutter::EncodableValue(entry.first)] = flutter::EncodableValue(entry.second);
+  }
+  flutter::EncodableMap gauges;
+  for (const auto& entry : snapshot.gauges) {
+    gauges[flutter::EncodableValue(entry.first)] = flutter::EncodableValue(entry.second);
+  }
+  flutter::EncodableMap histograms;
+  for (const auto& entry : snapshot.histograms) {
+    histograms[flutter::EncodableValue(entry.first)] =
+        flutter::EncodableValue(HistogramToMap(entry.second));
+  }
+  flutter::EncodableMap out;
+  out[flutter::EncodableValue("counters")] = flutter::EncodableValue(counters);
+  out[flutter::EncodableValue("gauges")] = flutter::EncodableValue(gauges);
+  out[flutter::EncodableValue("histograms")] = flutter::EncodableValue(histograms);
+  return out;
+}
+
+flutter::EncodableMap MicCopyStatusToMap(const DigitalCopyDetector::Status& status) {
+  flutter::EncodableMap out;
+  out[flutter::EncodableValue("copy")] = flutter::EncodableValue(status.copy);
+  out[flutter::EncodableValue("lagMs")] = flutter::EncodableValue(status.lag_ms);
+  out[flutter::EncodableValue("bitErrorRate")] = flutter::EncodableValue(status.bit_error_rate);
+  out[flutter::EncodableValue("copyMs")] =
+      flutter::EncodableValue(static_cast<int64_t>(status.copy_ms));
+  out[flutter::EncodableValue("changes")] =
+      flutter::EncodableValue(static_cast<int64_t>(status.changes));
+  return out;
+}
+
+flutter::EncodableMap PowerStateToMap(const PowerState::Snapshot& state) {
+  flutter::EncodableMap out;
+  out[flutter::EncodableValue("mode")] =
+      flutter::EncodableValue(std::string(PowerState::ModeName(state.mode)));
+  out[flutter::EncodableValue("minimized")] = flutter::EncodableValue(state.minimized);
+  out[flutter::EncodableValue("occluded")] = flutter::EncodableValue(state.occluded);
+  out[flutter::EncodableValue("sessionIdle")] = flutter::EncodableValue(state.session_idle);
+  out[flutter::EncodableValue("onBattery")] = flutter::EncodableValue(state.on_battery);
+  out[flutter::EncodableValue("batteryPercent")] = flutter::EncodableValue(state.battery_percent);
+  out[flutter::EncodableValue("deliveryIntervalMs")] =
+      flutter::EncodableValue(PowerState::DeliveryIntervalMs(state.mode));
+  return out;
+}
+
+// Cloaked by DWM or not shown at all. Being covered by other windows is not
+// reported to the window, so it is not detected.
+bool IsWindowOccluded(HWND hwnd) {
+  DWORD cloaked = 0;
+  if (SUCCEEDED(DwmGetWindowAttribute(hwnd, DWMWA_CLOAKED, &cloaked, sizeof(cloaked))) &&
+      cloaked != 0) {
+    return true;
+  }
+  return !IsWindowVisible(hwnd);
+}
+
+bool UpdateBattery(PowerState* power) {
+  SYSTEM_POWER_STATUS status;
+  if (!GetSystemPowerStatus(&status)) return false;
+  return power->SetBattery(status.ACLineStatus == 0,
+                           status.BatteryLifePercent == 255 ? -1 : status.BatteryLifePercent);
+}
+
+void CALLBACK OnCloakEvent(HWINEVENTHOOK, DWORD, HWND hwnd, LONG object, LONG, DWORD, DWORD) {
+  if (object == OBJID_WINDOW && hwnd != nullptr && hwnd == g_power_window) {
+    PostMessage(hwnd, kWindowCloakedMessage, 0, 0);
+  }
+}
+
+// Stall counts and recent stalls, plus the platform.* histograms.
+flutter::EncodableMap StallStatsToMap(const StallWatchdog::Stats& stats) {
+  flutter::EncodableList recent;
+  for (const auto& stall : stats.recent) {
+    flutter::EncodableList stack;
+    for (const auto& frame : stall.stack) stack.push_back(flutter::EncodableValue(frame));
+    flutter::EncodableMap item;
+    item[flutter::EncodableValue("kind")] = flutter::EncodableValue(stall.kind);
+    item[flutter::EncodableValue("method")] = flutter::EncodableValue(stall.method);
+    item[flutter::EncodableValue("durationMs")] = flutter::EncodableValue(stall.duration_ms);
+    item[flutter::EncodableValue("atMs")] = flutter::EncodableValue(stall.at_ms);
+    item[flutter::EncodableValue("stack")] = flutter::EncodableValue(stack);
+    recent.push_back(flutter::EncodableValue(item));
+  }
+  const MetricsRegistry::Snapshot metrics = Metrics().Take();
+  flutter::EncodableMap histograms;
+  for (const char* name : {"platform.handler_us", "platform.loop_latency_us", "platform.stall_ms"}) {
+    auto it = metrics.histograms.find(name);
+    if (it != metrics.histograms.end()) {
+      histograms[flutter::EncodableValue(name)] = flutter::EncodableValue(HistogramToMap(it->second));
+    }
+  }
+  flutter::EncodableMap out;
+  out[flutter::EncodableValue("thresholdMs")] = flutter::EncodableValue(stats.threshold_ms);
+  out[flutter::EncodableValue("handlerCalls")] =
+      flutter::EncodableValue(static_cast<int64_t>(stats.handler_calls));
+  out[flutter::EncodableValue("stalls")] = flutter::EncodableValue(static_cast<int64_t>(stats.stalls));
+  out[flutter::EncodableValue("recent")] = flutter::EncodableValue(recent);
+  out[flutter::EncodableValue("histograms")] = flutter::EncodableValue(histograms);
+  return out;
+}
+
+flutter::EncodableMap ProfilerStatusToMap(const SamplingProfiler::Status& status) {
+  flutter::EncodableMap out;
+  out[flutter::EncodableValue("running")] = flutter::EncodableValue(status.running);
+  out[flutter::EncodableValue("written")] = flutter::EncodableValue(status.written);
+  out[flutter::EncodableValue("path")] = flutter::EncodableValue(status.path);
+  out[flutter::EncodableValue("hz")] = flutter::EncodableValue(status.hz);
+  out[flutter::EncodableValue("samples")] =
+      flutter::EncodableValue(static_cast<int64_t>(status.samples));
+  out[flutter::EncodableValue("lost")] = flutter::EncodableValue(static_cast<int64_t>(status.lost));
+  out[flutter::EncodableValue("samplingUs")] = flutter::EncodableValue(status.sampling_us);
+  return out;
+}
+
+// Reads {"bubbles": [{source, text, timestamp, isDraft, speakerId?}, ...]}.
+// |timestamp| is milliseconds since the epoch.
+std::vector<SyncBubble> GetSyncBubbles(
+    const flutter::MethodCall<flutter::EncodableValue>& call) {
+  std::vector<SyncBubble> bubbles;
+  const auto* value = FindArgument(call, "bubbles");
+  if (!value || !std::holds_alternative<flutter::EncodableList>(*value)) {
+    return bubbles;
+  }
+  const auto& list = std::get<flutter::EncodableList>(*value);
+  bubbles.reserve(list.size());
+  for (const auto& item : list) {
+    SyncBubble bubble;
+    if (std::holds_alternative<flutter::EncodableMap>(item)) {
+      const auto& map = std::get<flutter::EncodableMap>(item);
+      for (const auto& [k, v] : map) {
+        if (!std::holds_alternative<std::string>(k)) continue;
+        const auto& key = std::get<std::string>(k);
+        if (key == "source" && std::holds_alternative<std::string>(v)) {
+          bubble.source = std::get<std::string>(v);
+        } else if (key == "text" && std::holds_alternative<std::string>(v)) {
+          bubble.text = std::get<std::string>(v);
+        } else if (key == "timestamp" && std::holds_alternative<int64_t>(v)) {
+          bubble.timestamp_ms = std::get<int64_t>(v);
+        } else if (key == "timestamp" && std::holds_alternative<int32_t>(v)) {
+          bubble.timestamp_ms = std::get<int32_t>(v);
+        } else if (key == "isDraft" && std::holds_alternative<bool>(v)) {
+          bubble.is_draft = std::get<bool>(v);
+        } else if (key == "speakerId" && std::holds_alternative<int32_t>(v)) {
+          bubble.speaker_id = std::get<int32_t>(v);
+        }
+      }
+    }
+    bubbles.push_back(std::move(bubble));
+  }
+  return bubbles;
+}
+
+}  // namespace
+
 FlutterWindow::FlutterWindow(const flutter::DartProject& project)
     : project_(project) {}
 
@@ -45,18 +471,30 @@ bool FlutterWindow::OnCreate() {
   SetChildContent(flutter_controller_->view()->GetNativeWindow());
 
   // Setup method channel for audio
-  auto audioChannel =
+  audio_channel_ =
       std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
           flutter_controller_->engine()->messenger(), "com.hearnow/audio",
           &flutter::StandardMethodCodec::GetInstance());
 
-  audioChannel->SetMethodCallHandler(
-      [](const flutter::MethodCall<flutter::EncodableValue>& call,
+  audio_channel_->SetMethodCallHandler(
+      [this](const flutter::MethodCall<flutter::EncodableValue>& call,
          std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>>
              result) {
+        const StallWatchdog::Scope stall_scope(&PlatformWatchdog(), "audio", call.method_name());
         if (call.method_name().compare("startSystemAudio") == 0) {
+          if (g_session_replayer.active()) {
+            // System audio comes from the capture file.
+            result->Success(flutter::EncodableValue(true));
+            return;
+          }
           if (!g_audio_capture) {
             g_audio_capture = std::make_unique<AudioCapture>();
+            g_audio_capture->SetConversationAnalytics(&g_conversation_analytics);
+            g_audio_capture->SetCopyDetector(&g_copy_detector);
+            g_audio_capture->SetDeviceRegistry(&g_device_registry);
+            g_audio_capture->SetMemoryGovernor(&g_memory_governor);
+            g_audio_capture->SetEndpointAggressiveness(
+                g_mic_stream.endpointer().aggressiveness());
           }
           bool success = g_audio_capture->StartSystemAudio();
           result->Success(flutter::EncodableValue(success));
@@ -66,7 +504,7 @@ bool FlutterWindow::OnCreate() {
           }
           result->Success();
         } else if (call.method_name().compare("getSystemAudioFrame") == 0) {
-          if (g_audio_capture) {
+          if (g_audio_capture || g_session_replayer.active()) {
             size_t requested = 0;
             if (call.arguments()) {
               // Expect either an int directly or a map {"length": int}
@@ -86,16 +524,472 @@ bool FlutterWindow::OnCreate() {
               requested = 1280;
             }
 
-            auto frame = g_audio_capture->GetSystemAudioFrame(requested);
+            // {pieceBytes} labels each piece of a batched pull as its own
+            // pull would have been: pieceSpeakers and pieceEnds, in order.
+            const int64_t piece_bytes = GetIntArgument(call, "pieceBytes");
+            int speaker_id = -1;
+            bool end_of_utterance = false;
+            std::vector<AudioCapture::FramePiece> pieces;
+            std::vector<uint8_t> frame;
+            if (g_session_replayer.active()) {
+              frame = g_session_replayer.TakeSystemAudio(requested);
+            } else {
+              if (piece_bytes > 0) {
+                frame = g_audio_capture->GetSystemAudioFrame(
+                    requested, static_cast<size_t>(piece_bytes), &pieces);
+                if (!pieces.empty()) speaker_id = pieces.front().speaker_id;
+                for (const auto& piece : pieces) end_of_utterance |= piece.end_of_utterance;
+              } else {
+                frame = g_audio_capture->GetSystemAudioFrame(requested, &speaker_id,
+                                                             &end_of_utterance);
+              }
+              if (g_session_recorder.active() && !frame.empty()) {
+                g_session_recorder.WriteAudio(session_capture::kSystem, frame.data(),
+                                              frame.size());
+              }
+            }
+
+            const auto* with_speaker = FindArgument(call, "withSpeaker");
+            if (with_speaker && std::holds_alternative<bool>(*with_speaker) &&
+                std::get<bool>(*with_speaker)) {
+              flutter::EncodableMap out;
+              out[flutter::EncodableValue("audio")] = flutter::EncodableValue(frame);
+              out[flutter::EncodableValue("speakerId")] = flutter::EncodableValue(speaker_id);
+              out[flutter::EncodableValue("endOfUtterance")] =
+                  flutter::EncodableValue(end_of_utterance);
+              if (piece_bytes > 0) {
+                flutter::EncodableList speakers;
+                flutter::EncodableList ends;
+                for (const auto& piece : pieces) {
+                  speakers.push_back(flutter::EncodableValue(piece.speaker_id));
+                  ends.push_back(flutter::EncodableValue(piece.end_of_utterance));
+                }
+                out[flutter::EncodableValue("pieceSpeakers")] = flutter::EncodableValue(speakers);
+                out[flutter::EncodableValue("pieceEnds")] = flutter::EncodableValue(ends);
+              }
+              result->Success(flutter::EncodableValue(out));
+              return;
+            }
+
             result->Success(flutter::EncodableValue(frame));
           } else {
             result->Success(flutter::EncodableValue(std::vector<uint8_t>()));
           }
+        } else if (call.method_name().compare("getAudioDevices") == 0) {
+          // {flow?: "capture" | "render"} -> [{id, name, flow, isDefault, format...}]
+          const std::string flow = GetStringArgument(call, "flow");
+          flutter::EncodableList out;
+          for (const auto& device : g_device_registry.Snapshot()) {
+            if (flow == "capture" && device.flow != AudioDeviceFlow::kCapture) continue;
+            if (flow == "render" && device.flow != AudioDeviceFlow::kRender) continue;
+            out.push_back(flutter::EncodableValue(AudioDeviceToMap(device)));
+          }
+          result->Success(flutter::EncodableValue(out));
+        } else if (call.method_name().compare("findAudioDevice") == 0) {
+          // {id} -> device map, or null when it is not (or no longer) present.
+          AudioDeviceInfo device;
+          if (g_device_registry.Find(GetStringArgument(call, "id"), &device)) {
+            result->Success(flutter::EncodableValue(AudioDeviceToMap(device)));
+          } else {
+            result->Success();
+          }
+        } else if (call.method_name().compare("getAudioHistory") == 0) {
+          // {source: "mic" | "system", seconds}; newest audio last.
+          const std::string source = GetStringArgument(call, "source");
+          const int64_t seconds = (std::max)(int64_t{0}, GetIntArgument(call, "seconds", 10));
+          const size_t samples = static_cast<size_t>(seconds) * 16000;
+          std::vector<uint8_t> audio;
+          if (source == "mic") {
+            audio = g_mic_stream.history().ReadLatestPcm16(samples);
+          } else if (source == "system" && g_audio_capture) {
+            audio = g_audio_capture->GetSystemAudioHistory(samples);
+          }
+          result->Success(flutter::EncodableValue(audio));
+        } else if (call.method_name().compare("pushMicAudio") == 0) {
+          const auto* audio = GetAudioArgument(call);
+          if (audio && !audio->empty()) {
+            g_mic_stream.PushPcm16(audio->data(), audio->size());
+            if (g_session_recorder.active()) {
+              g_session_recorder.WriteAudio(session_capture::kMic, audio->data(),
+                                            audio->size());
+            }
+          }
+          // True when a mic utterance ended; Dart then asks for its final.
+          result->Success(flutter::EncodableValue(g_mic_stream.TakeEndOfUtterance()));
+
+          // Dart stops transcribing the mic while it repeats system audio.
+          if (g_copy_detector.is_copy() != g_mic_copy_reported) {
+            g_mic_copy_reported = !g_mic_copy_reported;
+            audio_channel_->InvokeMethod(
+                "onMicCopyChanged", std::make_unique<flutter::EncodableValue>(
+                                        MicCopyStatusToMap(g_copy_detector.status())));
+          }
+
+          // Voice triggers go straight back to Dart, ahead of any transcript.
+          KeywordSpotter::Hit hit;
+          while (g_mic_stream.keyword_spotter().PollHit(&hit)) {
+            flutter::EncodableMap event;
+            event[flutter::EncodableValue("keywordId")] = flutter::EncodableValue(hit.keyword_id);
+            event[flutter::EncodableValue("score")] =
+                flutter::EncodableValue(static_cast<double>(hit.score));
+            audio_channel_->InvokeMethod(
+                "onKeyword", std::make_unique<flutter::EncodableValue>(event));
+          }
+        } else if (call.method_name().compare("setEndpointAggressiveness") == 0) {
+          // {level: 0 (off) .. 3}; applies to both streams.
+          const int level = static_cast<int>(GetIntArgument(call, "level", 2));
+          g_mic_stream.endpointer().set_aggressiveness(level);
+          if (g_audio_capture) {
+            g_audio_capture->SetEndpointAggressiveness(level);
+          }
+          result->Success();
+        } else if (call.method_name().compare("addKeywordTemplate") == 0) {
+          // {keywordId, audio: 16kHz mono PCM16 of the phrase}
+          const auto* audio = GetAudioArgument(call);
+          const bool ok =
+              audio && g_mic_stream.keyword_spotter().AddTemplate(
+                           static_cast<int>(GetIntArgument(call, "keywordId")),
+                           audio->data(), audio->size());
+          result->Success(flutter::EncodableValue(ok));
+        } else if (call.method_name().compare("removeKeyword") == 0) {
+          g_mic_stream.keyword_spotter().RemoveKeyword(
+              static_cast<int>(GetIntArgument(call, "keywordId", -1)));
+          result->Success();
+        } else if (call.method_name().compare("setKeywordThreshold") == 0) {
+          const auto* threshold = FindArgument(call, "threshold");
+          if (threshold && std::holds_alternative<double>(*threshold)) {
+            g_mic_stream.keyword_spotter().set_threshold(
+                static_cast<float>(std::get<double>(*threshold)));
+          }
+          result->Success();
+        } else if (call.method_name().compare("startSessionCapture") == 0) {
+          // {path}; replaces any capture in progress.
+          const auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                  std::chrono::system_clock::now().time_since_epoch())
+                                  .count();
+          const bool ok = g_session_recorder.Open(GetStringArgument(call, "path"),
+                                                  static_cast<uint64_t>(now_ms));
+          if (!ok) {
+            std::cerr << "[FlutterWindow] Could not open session capture file" << std::endl;
+          }
+          result->Success(flutter::EncodableValue(ok));
+        } else if (call.method_name().compare("recordSessionMessage") == 0) {
+          if (g_session_recorder.active()) {
+            g_session_recorder.WriteMessage(GetStringArgument(call, "text"));
+          }
+          result->Success();
+        } else if (call.method_name().compare("stopSessionCapture") == 0) {
+          flutter::EncodableMap out;
+          out[flutter::EncodableValue("records")] =
+              flutter::EncodableValue(static_cast<int64_t>(g_session_recorder.records()));
+          out[flutter::EncodableValue("bytes")] =
+              flutter::EncodableValue(static_cast<int64_t>(g_session_recorder.bytes_written()));
+          out[flutter::EncodableValue("durationMs")] =
+              flutter::EncodableValue(static_cast<int64_t>(g_session_recorder.duration_us() / 1000));
+          out[flutter::EncodableValue("dropped")] =
+              flutter::EncodableValue(static_cast<int64_t>(g_session_recorder.dropped()));
+          g_session_recorder.Close();
+          result->Success(flutter::EncodableValue(out));
+        } else if (call.method_name().compare("startSessionReplay") == 0) {
+          // {path, speed (<= 0: as fast as consumed), startMs}
+          double speed = 1.0;
+          const auto* speed_value = FindArgument(call, "speed");
+          if (speed_value && std::holds_alternative<double>(*speed_value)) {
+            speed = std::get<double>(*speed_value);
+          }
+          const bool ok = g_session_replayer.Start(
+              GetStringArgument(call, "path"), speed,
+              static_cast<uint64_t>((std::max)(int64_t{0}, GetIntArgument(call, "startMs"))));
+          if (!ok) {
+            std::cerr << "[FlutterWindow] Could not open session capture for replay" << std::endl;
+          }
+          result->Success(flutter::EncodableValue(ok));
+        } else if (call.method_name().compare("pollSessionReplay") == 0) {
+          auto batch = g_session_replayer.Poll();
+          flutter::EncodableList messages;
+          for (auto& message : batch.messages) {
+            messages.push_back(flutter::EncodableValue(std::move(message)));
+          }
+          flutter::EncodableMap out;
+          out[flutter::EncodableValue("mic")] = flutter::EncodableValue(std::move(batch.mic));
+          out[flutter::EncodableValue("messages")] = flutter::EncodableValue(messages);
+          out[flutter::EncodableValue("done")] = flutter::EncodableValue(batch.done);
+          result->Success(flutter::EncodableValue(out));
+        } else if (call.method_name().compare("stopSessionReplay") == 0) {
+          g_session_replayer.Stop();
+          result->Success();
+        } else if (call.method_name().compare("startUplink") == 0) {
+          // {host, port, sessionId, token, nonce} from the relay's udp_ready.
+          const bool ok = g_audio_uplink.Start(
+              GetStringArgument(call, "host"), static_cast<int>(GetIntArgument(call, "port")),
+              static_cast<uint32_t>(GetIntArgument(call, "sessionId")),
+              GetStringArgument(call, "token"), GetStringArgument(call, "nonce"));
+          result->Success(flutter::EncodableValue(ok));
+        } else if (call.method_name().compare("sendUplinkAudio") == 0) {
+          // {source: mic|system, audio}; false means send it over the WebSocket.
+          const auto* audio = GetAudioArgument(call);
+          const uint8_t stream = GetStringArgument(call, "source") == "system" ? 1 : 0;
+          const bool sent = audio && g_audio_uplink.Send(stream, audio->data(), audio->size());
+          result->Success(flutter::EncodableValue(sent));
+        } else if (call.method_name().compare("finalizeUplink") == 0) {
+          // {source: mic|system}; false means finalize over the WebSocket.
+          const uint8_t stream = GetStringArgument(call, "source") == "system" ? 1 : 0;
+          result->Success(flutter::EncodableValue(g_audio_uplink.Finalize(stream)));
+        } else if (call.method_name().compare("getUplinkStats") == 0) {
+          const auto stats = g_audio_uplink.stats();
+          flutter::EncodableMap out;
+          out[flutter::EncodableValue("healthy")] = flutter::EncodableValue(g_audio_uplink.healthy());
+          out[flutter::EncodableValue("packetsSent")] =
+              flutter::EncodableValue(static_cast<int64_t>(stats.packets_sent));
+          out[flutter::EncodableValue("paritySent")] =
+              flutter::EncodableValue(static_cast<int64_t>(stats.parity_sent));
+          out[flutter::EncodableValue("bytesSent")] =
+              flutter::EncodableValue(static_cast<int64_t>(stats.bytes_sent));
+          out[flutter::EncodableValue("received")] =
+              flutter::EncodableValue(static_cast<int64_t>(stats.received));
+          out[flutter::EncodableValue("recovered")] =
+              flutter::EncodableValue(static_cast<int64_t>(stats.recovered));
+          out[flutter::EncodableValue("lost")] =
+              flutter::EncodableValue(static_cast<int64_t>(stats.lost));
+          result->Success(flutter::EncodableValue(out));
+        } else if (call.method_name().compare("stopUplink") == 0) {
+          g_audio_uplink.Stop();
+          result->Success();
+        } else if (call.method_name().compare("startMux") == 0) {
+          // {url: ws(s)://host/mux?token=...}; keeps a running connection to
+          // the same URL, events arrive through onMuxEvents.
+          const std::string url = GetStringArgument(call, "url");
+          bool ok = g_mux_connection.started() && g_mux_connection.url() == url;
+          if (!ok) ok = g_mux_connection.Start(url);
+          result->Success(flutter::EncodableValue(ok));
+        } else if (call.method_name().compare("stopMux") == 0) {
+          g_mux_connection.Stop();
+          result->Success();
+        } else if (call.method_name().compare("openMuxStream") == 0) {
+          // {open: JSON Open payload, priority: 0 (audio) ..}; returns the id, 0 on failure.
+          const uint32_t id = g_mux_connection.OpenStream(
+              GetStringArgument(call, "open"), static_cast<int>(GetIntArgument(call, "priority", 1)));
+          result->Success(flutter::EncodableValue(static_cast<int64_t>(id)));
+        } else if (call.method_name().compare("sendMuxText") == 0) {
+          const bool sent = g_mux_connection.SendText(
+              static_cast<uint32_t>(GetIntArgument(call, "stream")), GetStringArgument(call, "text"));
+          result->Success(flutter::EncodableValue(sent));
+        } else if (call.method_name().compare("sendMuxAudio") == 0) {
+          // {stream, source: mic|system, audio}
+          const auto* audio = GetAudioArgument(call);
+          const uint8_t source = GetStringArgument(call, "source") == "system" ? 1 : 0;
+          const bool sent =
+              audio && g_mux_connection.SendAudio(static_cast<uint32_t>(GetIntArgument(call, "stream")),
+                                                  source, audio->data(), audio->size());
+          result->Success(flutter::EncodableValue(sent));
+        } else if (call.method_name().compare("closeMuxStream") == 0) {
+          g_mux_connection.CloseStream(static_cast<uint32_t>(GetIntArgument(call, "stream")));
+          result->Success();
+        } else if (call.method_name().compare("getMuxStats") == 0) {
+          result->Success(flutter::EncodableValue(MuxStatsToMap(g_mux_connection.stats())));
+        } else if (call.method_name().compare("getMetrics") == 0) {
+          // Every registered counter, gauge and histogram (metrics.h).
+          result->Success(flutter::EncodableValue(MetricsToMap(Metrics().Take())));
+        } else if (call.method_name().compare("getMetricsJson") == 0) {
+          result->Success(flutter::EncodableValue(Metrics().ToJson()));
+        } else if (call.method_name().compare("startProfile") == 0) {
+          // {path, seconds?, hz?}; writes a gzipped pprof profile to |path|
+          // when the window ends or stopProfile is called.
+          const bool started = g_profiler.Start(
+              GetStringArgument(call, "path"), static_cast<int>(GetIntArgument(call, "seconds", 30)),
+              static_cast<int>(GetIntArgument(call, "hz", 100)));
+          result->Success(flutter::EncodableValue(started));
+        } else if (call.method_name().compare("stopProfile") == 0) {
+          // Returns while the profile is still being written.
+          g_profiler.Stop();
+          result->Success(flutter::EncodableValue(ProfilerStatusToMap(g_profiler.status())));
+        } else if (call.method_name().compare("getProfilerStatus") == 0) {
+          result->Success(flutter::EncodableValue(ProfilerStatusToMap(g_profiler.status())));
+        } else if (call.method_name().compare("getStallStats") == 0) {
+          // Platform-thread stalls over the threshold (stall_watchdog.h).
+          result->Success(flutter::EncodableValue(StallStatsToMap(PlatformWatchdog().stats())));
+        } else if (call.method_name().compare("indexAnswer") == 0) {
+          // {id, text, payload?}; replaces any entry with the same id.
+          g_answer_index.Upsert(GetStringArgument(call, "id"), GetStringArgument(call, "text"),
+                                GetStringArgument(call, "payload"));
+          result->Success();
+        } else if (call.method_name().compare("removeIndexedAnswer") == 0) {
+          result->Success(
+              flutter::EncodableValue(g_answer_index.Remove(GetStringArgument(call, "id"))));
+        } else if (call.method_name().compare("searchAnswers") == 0) {
+          // {text, k?, minScore?, prefix?} -> [{id, score, payload}], best
+          // first, counting only ids that start with |prefix|.
+          float min_score = 0.0f;
+          const auto* min_value = FindArgument(call, "minScore");
+          if (min_value && std::holds_alternative<double>(*min_value)) {
+            min_score = static_cast<float>(std::get<double>(*min_value));
+          }
+          const int64_t k = GetIntArgument(call, "k", 3);
+          flutter::EncodableList out;
+          for (const auto& match : g_answer_index.Search(
+                   GetStringArgument(call, "text"), static_cast<size_t>((std::max)(k, int64_t{0})),
+                   min_score, GetStringArgument(call, "prefix"))) {
+            flutter::EncodableMap entry;
+            entry[flutter::EncodableValue("id")] = flutter::EncodableValue(match.id);
+            entry[flutter::EncodableValue("score")] =
+                flutter::EncodableValue(static_cast<double>(match.similarity));
+            entry[flutter::EncodableValue("payload")] = flutter::EncodableValue(match.payload);
+            out.push_back(flutter::EncodableValue(std::move(entry)));
+          }
+          result->Success(flutter::EncodableValue(out));
+        } else if (call.method_name().compare("clearAnswerIndex") == 0) {
+          g_answer_index.Clear();
+          result->Success();
+        } else if (call.method_name().compare("reportTranscriptWords") == 0) {
+          const std::string source = GetStringArgument(call, "source");
+          const int64_t words = GetIntArgument(call, "words");
+          if (source == "mic") {
+            g_conversation_analytics.AddWords(ConversationAnalytics::kMic, words);
+          } else if (source == "system") {
+            g_conversation_analytics.AddWords(ConversationAnalytics::kSystem, words);
+          }
+          result->Success();
+        } else if (call.method_name().compare("getConversationAnalytics") == 0) {
+          const auto snapshot = g_conversation_analytics.GetSnapshot();
+          flutter::EncodableMap out;
+          out[flutter::EncodableValue("mic")] = flutter::EncodableValue(
+              ConversationChannelToMap(snapshot.channels[ConversationAnalytics::kMic]));
+          out[flutter::EncodableValue("system")] = flutter::EncodableValue(
+              ConversationChannelToMap(snapshot.channels[ConversationAnalytics::kSystem]));
+          out[flutter::EncodableValue("overlapMs")] =
+              flutter::EncodableValue(snapshot.overlap_ms);
+          out[flutter::EncodableValue("elapsedMs")] =
+              flutter::EncodableValue(snapshot.elapsed_ms);
+          out[flutter::EncodableValue("micTalkRatio")] =
+              flutter::EncodableValue(snapshot.mic_talk_ratio);
+          result->Success(flutter::EncodableValue(out));
+        } else if (call.method_name().compare("resetConversationAnalytics") == 0) {
+          g_conversation_analytics.Reset();
+          g_mic_stream.Reset();
+          g_copy_detector.Reset();
+          g_mic_copy_reported = false;
+          result->Success();
+        } else if (call.method_name().compare("getMicCopyStatus") == 0) {
+          result->Success(flutter::EncodableValue(MicCopyStatusToMap(g_copy_detector.status())));
+        } else if (call.method_name().compare("getPowerState") == 0) {
+          // Changes also arrive as onPowerStateChanged.
+          result->Success(flutter::EncodableValue(PowerStateToMap(AppPowerState().snapshot())));
+        } else if (call.method_name().compare("getAudioQuality") == 0) {
+          // Per-stream input quality, summarized for upload with the session.
+          flutter::EncodableMap out;
+          out[flutter::EncodableValue("mic")] =
+              flutter::EncodableValue(AudioQualityToMap(g_mic_stream.quality().GetSummary()));
+          if (g_audio_capture) {
+            out[flutter::EncodableValue("system")] =
+                flutter::EncodableValue(AudioQualityToMap(g_audio_capture->GetQualitySummary()));
+          }
+          result->Success(flutter::EncodableValue(out));
+        } else if (call.method_name().compare("resetAudioQuality") == 0) {
+          g_mic_stream.ResetQuality();
+          if (g_audio_capture) g_audio_capture->ResetQuality();
+          result->Success();
+        } else if (call.method_name().compare("encodeSessionDelta") == 0) {
+          const std::string session_id = GetStringArgument(call, "sessionId");
+          std::vector<uint8_t> delta;
+          uint64_t version = 0;
+          const auto encoded = g_session_sync.Encode(
+              session_id, GetSyncBubbles(call), GetStringArgument(call, "meta"),
+              &delta, &version);
+          flutter::EncodableMap out;
+          if (encoded == SessionSyncEncoder::Result::kDelta) {
+            out[flutter::EncodableValue("result")] = flutter::EncodableValue("delta");
+            out[flutter::EncodableValue("delta")] = flutter::EncodableValue(delta);
+            out[flutter::EncodableValue("version")] =
+                flutter::EncodableValue(static_cast<int64_t>(version));
+          } else {
+            out[flutter::EncodableValue("result")] = flutter::EncodableValue(
+                encoded == SessionSyncEncoder::Result::kUnchanged ? "unchanged"
+                                                                  : "noBaseline");
+          }
+          result->Success(flutter::EncodableValue(out));
+        } else if (call.method_name().compare("ackSessionDelta") == 0) {
+          g_session_sync.Acknowledge(
+              GetStringArgument(call, "sessionId"),
+              static_cast<uint64_t>(GetIntArgument(call, "version")));
+          result->Success();
+        } else if (call.method_name().compare("setSessionSyncBaseline") == 0) {
+          g_session_sync.SetBaseline(
+              GetStringArgument(call, "sessionId"), GetSyncBubbles(call),
+              GetStringArgument(call, "meta"),
+              static_cast<uint64_t>(GetIntArgument(call, "version")));
+          result->Success();
+        } else if (call.method_name().compare("resetSessionSync") == 0) {
+          g_session_sync.Forget(GetStringArgument(call, "sessionId"));
+          result->Success();
+        } else if (call.method_name().compare("setMemoryBudget") == 0) {
+          // {bytes}; lower-priority buffers shrink right away to fit.
+          const int64_t bytes = GetIntArgument(call, "bytes", 0);
+          if (bytes <= 0) {
+            result->Error("INVALID_ARGUMENT", "bytes must be positive");
+            return;
+          }
+          g_memory_governor.SetBudget(static_cast<size_t>(bytes));
+          result->Success();
+        } else if (call.method_name().compare("getMemoryStats") == 0) {
+          // {budget, used, pools: [{tag, priority, floor, want, limit, used, peak, refused}]}
+          flutter::EncodableList pools;
+          for (const auto& pool : g_memory_governor.Stats()) {
+            flutter::EncodableMap entry;
+            entry[flutter::EncodableValue("tag")] = flutter::EncodableValue(pool.tag);
+            entry[flutter::EncodableValue("priority")] = flutter::EncodableValue(pool.priority);
+            entry[flutter::EncodableValue("floor")] =
+                flutter::EncodableValue(static_cast<int64_t>(pool.floor_bytes));
+            entry[flutter::EncodableValue("want")] =
+                flutter::EncodableValue(static_cast<int64_t>(pool.want_bytes));
+            entry[flutter::EncodableValue("limit")] =
+                flutter::EncodableValue(static_cast<int64_t>(pool.limit_bytes));
+            entry[flutter::EncodableValue("used")] =
+                flutter::EncodableValue(static_cast<int64_t>(pool.used_bytes));
+            entry[flutter::EncodableValue("peak")] =
+                flutter::EncodableValue(static_cast<int64_t>(pool.peak_bytes));
+            entry[flutter::EncodableValue("refused")] =
+                flutter::EncodableValue(static_cast<int64_t>(pool.refused));
+            pools.push_back(flutter::EncodableValue(entry));
+          }
+          flutter::EncodableMap out;
+          out[flutter::EncodableValue("budget")] =
+              flutter::EncodableValue(static_cast<int64_t>(g_memory_governor.budget()));
+          out[flutter::EncodableValue("used")] =
+              flutter::EncodableValue(static_cast<int64_t>(g_memory_governor.used()));
+          out[flutter::EncodableValue("pools")] = flutter::EncodableValue(pools);
+          result->Success(flutter::EncodableValue(out));
         } else {
           result->NotImplemented();
         }
       });
 
+  // Enumerate audio endpoints once; later changes arrive as notifications.
+  g_mic_stream.SetCopyDetector(&g_copy_detector);
+
+  HWND window = GetHandle();
+  g_device_registry.SetChangeCallback([window](uint64_t) {
+    PostMessage(window, kAudioDevicesChangedMessage, 0, 0);
+  });
+  g_device_registry.Start();
+
+  g_mux_connection.SetEventCallback([window]() {
+    PostMessage(window, kMuxEventsMessage, 0, 0);
+  });
+
+  // Visibility, session and power source drive AppPowerState(); each change
+  // arrives as a message below.
+  g_power_window = window;
+  cloak_hook_ = SetWinEventHook(EVENT_OBJECT_CLOAKED, EVENT_OBJECT_UNCLOAKED, nullptr,
+                                OnCloakEvent, GetCurrentProcessId(), 0, WINEVENT_OUTOFCONTEXT);
+  WTSRegisterSessionNotification(window, NOTIFY_FOR_THIS_SESSION);
+  const GUID* power_settings[] = {&GUID_CONSOLE_DISPLAY_STATE, &GUID_SESSION_USER_PRESENCE,
+                                  &GUID_ACDC_POWER_SOURCE};
+  for (size_t i = 0; i < 3; i++) {
+    power_notifications_[i] =
+        RegisterPowerSettingNotification(window, power_settings[i], DEVICE_NOTIFY_WINDOW_HANDLE);
+  }
+  UpdateBattery(&AppPowerState());
+
   // Setup method channel for window settings
   auto windowChannel =
       std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
@@ -106,6 +1000,7 @@ bool FlutterWindow::OnCreate() {
       [this](const flutter::MethodCall<flutter::EncodableValue>& call,
          std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>>
              result) {
+        const StallWatchdog::Scope stall_scope(&PlatformWatchdog(), "window", call.method_name());
         if (call.method_name().compare("setUndetectable") == 0) {
           bool value = false;
           if (call.arguments()) {
@@ -156,6 +1051,23 @@ bool FlutterWindow::OnCreate() {
 }
 
 void FlutterWindow::OnDestroy() {
+  if (cloak_hook_) {
+    UnhookWinEvent(cloak_hook_);
+    cloak_hook_ = nullptr;
+  }
+  for (HPOWERNOTIFY& notification : power_notifications_) {
+    if (notification) UnregisterPowerSettingNotification(notification);
+    notification = nullptr;
+  }
+  // GetHandle() is already cleared when this runs from WM_DESTROY.
+  if (g_power_window) WTSUnRegisterSessionNotification(g_power_window);
+  g_power_window = nullptr;
+  g_device_registry.SetChangeCallback(nullptr);
+  g_device_registry.Stop();
+  g_mux_connection.SetEventCallback(nullptr);
+  g_mux_connection.Stop();
+  g_profiler.StopAndWait();
+  audio_channel_ = nullptr;
   if (flutter_controller_) {
     flutter_controller_ = nullptr;
   }
@@ -167,6 +1079,9 @@ LRESULT
 FlutterWindow::MessageHandler(HWND hwnd, UINT const message,
                               WPARAM const wparam,
                               LPARAM const lparam) noexcept {
+  // Only observes; the message is still handled below.
+  ObservePowerMessage(hwnd, message, wparam, lparam);
+
   // Give Flutter, including plugins, an opportunity to handle window messages.
   if (flutter_controller_) {
     std::optional<LRESULT> result =
@@ -181,7 +1096,80 @@ FlutterWindow::MessageHandler(HWND hwnd, UINT const message,
     case WM_FONTCHANGE:
       flutter_controller_->engine()->ReloadSystemFonts();
       break;
+    case kAudioDevicesChangedMessage:
+      if (audio_channel_) {
+        audio_channel_->InvokeMethod(
+            "onAudioDevicesChanged",
+            std::make_unique<flutter::EncodableValue>(
+                static_cast<int64_t>(g_device_registry.version())));
+      }
+      return 0;
+    case kWatchdogPingMessage:
+      PlatformWatchdog().OnPing();
+      return 0;
+    case kWindowCloakedMessage:
+      return 0;
+    case kMuxEventsMessage:
+      if (audio_channel_) {
+        flutter::EncodableList events;
+        for (const auto& event : g_mux_connection.TakeEvents()) {
+          events.push_back(flutter::EncodableValue(MuxEventToMap(event)));
+        }
+        if (!events.empty()) {
+          audio_channel_->InvokeMethod("onMuxEvents",
+                                       std::make_unique<flutter::EncodableValue>(events));
+        }
+      }
+      return 0;
   }
 
   return Win32Window::MessageHandler(hwnd, message, wparam, lparam);
 }
+
+void FlutterWindow::ObservePowerMessage(HWND hwnd, UINT message, WPARAM wparam,
+                                        LPARAM lparam) {
+  PowerState& power = AppPowerState();
+  bool changed = false;
+  switch (message) {
+    case WM_SIZE:
+      changed = power.SetMinimized(wparam == SIZE_MINIMIZED);
+      break;
+    case WM_SHOWWINDOW:
+    case WM_WINDOWPOSCHANGED:
+    case kWindowCloakedMessage:
+      changed = power.SetOccluded(IsWindowOccluded(hwnd));
+      break;
+    case WM_WTSSESSION_CHANGE:
+      if (wparam == WTS_SESSION_LOCK || wparam == WTS_SESSION_UNLOCK) {
+        session_locked_ = wparam == WTS_SESSION_LOCK;
+        changed = power.SetSessionIdle(session_locked_ || display_off_ || user_away_);
+      }
+      break;
+    case WM_POWERBROADCAST:
+      if (wparam == PBT_APMPOWERSTATUSCHANGE) {
+        changed = UpdateBattery(&power);
+      } else if (wparam == PBT_POWERSETTINGCHANGE) {
+        const auto* setting = reinterpret_cast<const POWERBROADCAST_SETTING*>(lparam);
+        if (setting->DataLength < sizeof(DWORD)) break;
+        const DWORD value = *reinterpret_cast<const DWORD*>(setting->Data);
+        if (IsEqualGUID(setting->PowerSetting, GUID_CONSOLE_DISPLAY_STATE)) {
+          display_off_ = value == 0;  // 1 on, 2 dimmed
+        } else if (IsEqualGUID(setting->PowerSetting, GUID_SESSION_USER_PRESENCE)) {
+          user_away_ = value != PowerUserPresent;
+        } else if (IsEqualGUID(setting->PowerSetting, GUID_ACDC_POWER_SOURCE)) {
+          changed = UpdateBattery(&power);
+          break;
+        }
+        changed = power.SetSessionIdle(session_locked_ || display_off_ || user_away_);
+      }
+      break;
+  }
+  if (changed) PublishPowerState();
+}
+
+void FlutterWindow::PublishPowerState() {
+  if (!audio_channel_) return;
+  audio_channel_->InvokeMethod(
+      "onPowerStateChanged",
+      std::make_unique<flutter::EncodableValue>(PowerStateToMap(AppPowerState().snapshot())));
+}
@@ -2,7 +2,9 @@
 #define RUNNER_FLUTTER_WINDOW_H_
 
 #include <flutter/dart_project.h>
+#include <flutter/encodable_value.h>
 #include <flutter/flutter_view_controller.h>
+#include <flutter/method_channel.h>
 
 #include <memory>
 
@@ -15,6 +17,10 @@ class FlutterWindow : public Win32Window {
   explicit FlutterWindow(const flutter::DartProject& project);
   virtual ~FlutterWindow();
 
+  // Posted to the window by the platform stall watchdog's heartbeat
+  // (stall_watchdog.h); answered when the message loop gets to it.
+  static constexpr UINT kWatchdogPingMessage = WM_APP + 3;
+
  protected:
   // Win32Window:
   bool OnCreate() override;
@@ -28,6 +34,22 @@ class FlutterWindow : public Win32Window {
 
   // The Flutter instance hosted by this window.
   std::unique_ptr<flutter::FlutterViewController> flutter_controller_;
+
+  // Kept alive so native code can send events (e.g. onKeyword) to Dart.
+  std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>> audio_channel_;
+
+  // Feeds AppPowerState() from window, session and power messages; tells
+  // Dart when it changed.
+  void ObservePowerMessage(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam);
+  void PublishPowerState();
+
+  // Parts of the session being idle, each from its own notification.
+  bool session_locked_ = false;
+  bool display_off_ = false;
+  bool user_away_ = false;
+  // Display state, user presence and AC/DC power source registrations.
+  HPOWERNOTIFY power_notifications_[3] = {};
+  HWINEVENTHOOK cloak_hook_ = nullptr;
 };
 
 #endif  // RUNNER_FLUTTER_WINDOW_H_
@@ -0,0 +1,268 @@
+#include "keyword_spotter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr int kSlots = KeywordSpotter::kMaxKeywords * KeywordSpotter::kMaxTemplates;
+constexpr int kFrameLength = 400;  // 25 ms
+constexpr int kMelBands = 24;
+// Frames quieter than this (windowed log energy, about -45 dBFS) carry no
+// spectral shape worth matching.
+constexpr float kMinLogEnergy = -7.0f;
+// Enrollment keeps frames within this much (log energy) of the loudest one.
+constexpr float kTrimRange = 5.5f;
+constexpr int kMinTemplateFrames = 20;
+// Distance charged for a quiet input frame, about that of unrelated speech.
+constexpr float kQuietDistance = 2.0f;
+// Brings a typical distance between frames of the same sound under 1.
+constexpr float kFeatureScale = 0.018f;
+// A match may run between these multiples of the template's duration.
+constexpr float kMinWarp = 0.6f;
+constexpr float kMaxWarp = 1.6f;
+// Frames a below-threshold match must stay the best one before it fires.
+constexpr int kConfirmFrames = 3;
+// After a hit the keyword stays silent for 1 s.
+constexpr int kRefractoryFrames = 100;
+constexpr float kInf = std::numeric_limits<float>::infinity();
+
+}  // namespace
+
+KeywordSpotter::KeywordSpotter(float threshold)
+    : threshold_(threshold),
+      mel_(16000, kFrameLength, 512, kMelBands),
+      log_mel_(kMelBands),
+      cepstrum_(kCepstra + 1),
+      frame_(kFrameLength) {
+  // Sinusoidal lifter so the higher cepstra count about as much as c1.
+  for (int c = 0; c < kCepstra; c++) {
+    lifter_[c] = kFeatureScale *
+                 (1.0f + 6.0f * static_cast<float>(std::sin(3.14159265358979 * (c + 1) / 12.0)));
+  }
+  const size_t frames = static_cast<size_t>(kSlots) * kMaxTemplateFrames;
+  feature_pool_.assign(frames * kCepstra, 0.0f);
+  cost_pool_.assign(frames, kInf);
+  length_pool_.assign(frames, 0);
+  scratch_cost_.assign(kMaxTemplateFrames, kInf);
+  scratch_length_.assign(kMaxTemplateFrames, 0);
+  scratch_features_.assign(static_cast<size_t>(kMaxTemplateFrames) * 4 * kCepstra, 0.0f);
+  for (int s = 0; s < kSlots; s++) {
+    const size_t base = static_cast<size_t>(s) * kMaxTemplateFrames;
+    templates_[s].features = &feature_pool_[base * kCepstra];
+    templates_[s].cost = &cost_pool_[base];
+    templates_[s].length = &length_pool_[base];
+  }
+}
+
+bool KeywordSpotter::FrameFeatures(const float* frame, float* out, float* log_energy) {
+  const float energy = mel_.Compute(frame, log_mel_.data());
+  if (log_energy) *log_energy = energy;
+  if (energy < kMinLogEnergy) return false;
+  mel_.Cepstrum(log_mel_.data(), cepstrum_.data(), kCepstra + 1);
+  // Drop c0 (overall level), which makes the match independent of gain.
+  for (int c = 0; c < kCepstra; c++) {
+    out[c] = cepstrum_[c + 1] * lifter_[c];
+  }
+  return true;
+}
+
+bool KeywordSpotter::AddTemplate(int keyword_id, const uint8_t* pcm16, size_t length) {
+  if (keyword_id < 0 || keyword_id >= kMaxKeywords || !pcm16) return false;
+
+  int slot = -1;
+  int existing = 0;
+  for (int s = 0; s < kSlots; s++) {
+    if (templates_[s].keyword_id == keyword_id) existing++;
+    if (slot < 0 && templates_[s].keyword_id < 0) slot = s;
+  }
+  if (slot < 0 || existing >= kMaxTemplates) return false;
+
+  // Frame the recording; enrollment may span up to four template lengths
+  // before trimming.
+  const size_t samples = length / 2;
+  const int max_frames = kMaxTemplateFrames * 4;
+  std::vector<float> energies;
+  energies.reserve(max_frames);
+  int frames = 0;
+  for (size_t start = 0; start + kFrameLength <= samples && frames < max_frames;
+       start += kHopSamples) {
+    for (int i = 0; i < kFrameLength; i++) {
+      const size_t k = (start + i) * 2;
+      frame_[i] = static_cast<int16_t>(pcm16[k] | (pcm16[k + 1] << 8)) / 32768.0f;
+    }
+    float* out = &scratch_features_[static_cast<size_t>(frames) * kCepstra];
+    float energy = 0.0f;
+    const bool voiced = FrameFeatures(frame_.data(), out, &energy);
+    energies.push_back(voiced ? energy : -kInf);
+    frames++;
+  }
+  if (frames == 0) return false;
+
+  const float peak = *std::max_element(energies.begin(), energies.end());
+  if (peak == -kInf) return false;
+  int first = 0;
+  int last = frames - 1;
+  while (first < frames && energies[first] < peak - kTrimRange) first++;
+  while (last > first && energies[last] < peak - kTrimRange) last--;
+  const int count = last - first + 1;
+  if (count < kMinTemplateFrames || count > kMaxTemplateFrames) return false;
+
+  Template& t = templates_[slot];
+  t.keyword_id = keyword_id;
+  t.frames = count;
+  for (int j = 0; j < count; j++) {
+    const float* src = &scratch_features_[static_cast<size_t>(first + j) * kCepstra];
+    float* dst = &t.features[static_cast<size_t>(j) * kCepstra];
+    const bool voiced = energies[first + j] != -kInf;
+    for (int c = 0; c < kCepstra; c++) dst[c] = voiced ? src[c] : 0.0f;
+  }
+  std::fill(t.cost, t.cost + kMaxTemplateFrames, kInf);
+  std::fill(t.length, t.length + kMaxTemplateFrames, 0);
+  t.candidate = kInf;
+  template_count_++;
+  return true;
+}
+
+void KeywordSpotter::RemoveKeyword(int keyword_id) {
+  for (auto& t : templates_) {
+    if (t.keyword_id == keyword_id && keyword_id >= 0) {
+      t.keyword_id = -1;
+      t.frames = 0;
+      template_count_--;
+    }
+  }
+}
+
+void KeywordSpotter::Clear() {
+  for (int k = 0; k < kMaxKeywords; k++) RemoveKeyword(k);
+  Reset();
+}
+
+void KeywordSpotter::Reset() {
+  frame_fill_ = 0;
+  samples_ = 0;
+  for (int k = 0; k < kMaxKeywords; k++) {
+    ResetKeyword(k);
+    refractory_[k] = 0;
+  }
+  pending_head_ = 0;
+  pending_count_ = 0;
+}
+
+void KeywordSpotter::ResetKeyword(int keyword_id) {
+  for (auto& t : templates_) {
+    if (t.keyword_id != keyword_id) continue;
+    std::fill(t.cost, t.cost + kMaxTemplateFrames, kInf);
+    std::fill(t.length, t.length + kMaxTemplateFrames, 0);
+    t.candidate = kInf;
+  }
+}
+
+void KeywordSpotter::Process(const float* samples, size_t count) {
+  if (empty()) {
+    samples_ += count;
+    return;
+  }
+  float feature[kCepstra];
+  for (size_t i = 0; i < count; i++) {
+    frame_[frame_fill_++] = samples[i];
+    samples_++;
+    if (frame_fill_ < frame_.size()) continue;
+
+    const bool voiced = FrameFeatures(frame_.data(), feature);
+    Step(voiced ? feature : nullptr);
+
+    // Slide by one hop.
+    std::copy(frame_.begin() + kHopSamples, frame_.end(), frame_.begin());
+    frame_fill_ = frame_.size() - kHopSamples;
+  }
+}
+
+// One input frame of open-begin DTW against every template. Steps advance the
+// input by one frame and the template by 0, 1 or 2 frames; predecessors are
+// compared by average cost so long and short paths compete fairly.
+void KeywordSpotter::Step(const float* feature) {
+  for (int k = 0; k < kMaxKeywords; k++) {
+    if (refractory_[k] > 0) refractory_[k]--;
+  }
+
+  int fired = -1;
+  for (auto& t : templates_) {
+    if (t.keyword_id < 0 || refractory_[t.keyword_id] > 0 || t.keyword_id == fired) {
+      continue;
+    }
+    const int m = t.frames;
+    for (int j = 0; j < m; j++) {
+      float d = kQuietDistance;
+      if (feature) {
+        const float* ref = &t.features[static_cast<size_t>(j) * kCepstra];
+        float sum = 0.0f;
+        for (int c = 0; c < kCepstra; c++) {
+          const float diff = feature[c] - ref[c];
+          sum += diff * diff;
+        }
+        d = std::sqrt(sum);
+      }
+
+      float best_cost = kInf;
+      int best_length = 0;
+      float best_avg = kInf;
+      auto consider = [&](float cost, int length) {
+        if (cost == kInf) return;
+        const float avg = (cost + d) / static_cast<float>(length + 1);
+        if (avg < best_avg) {
+          best_avg = avg;
+          best_cost = cost + d;
+          best_length = length + 1;
+        }
+      };
+      if (j == 0) {
+        consider(0.0f, 0);  // Match starts here
+      } else {
+        consider(t.cost[j - 1], t.length[j - 1]);
+        if (j >= 2) consider(t.cost[j - 2], t.length[j - 2]);
+      }
+      consider(t.cost[j], t.length[j]);
+      if (best_length > kMaxWarp * m) best_cost = kInf;  // Too slow to be the phrase
+      scratch_cost_[j] = best_cost;
+      scratch_length_[j] = best_length;
+    }
+    std::copy(scratch_cost_.begin(), scratch_cost_.begin() + m, t.cost);
+    std::copy(scratch_length_.begin(), scratch_length_.begin() + m, t.length);
+
+    // Hold the best match below the threshold for a few frames so a partial
+    // match does not fire ahead of the complete one.
+    const float end_cost = t.cost[m - 1];
+    const int end_length = t.length[m - 1];
+    const float score = end_cost != kInf && end_length >= kMinWarp * m
+                            ? end_cost / static_cast<float>(end_length)
+                            : kInf;
+    if (score < threshold_ && score < t.candidate) {
+      t.candidate = score;
+      t.candidate_age = 0;
+      t.candidate_end = samples_;
+    } else if (t.candidate != kInf && ++t.candidate_age >= kConfirmFrames) {
+      if (pending_count_ < kMaxPendingHits) {
+        Hit& hit = pending_[(pending_head_ + pending_count_++) % kMaxPendingHits];
+        hit.keyword_id = t.keyword_id;
+        hit.score = t.candidate;
+        hit.end_sample = t.candidate_end;
+      }
+      fired = t.keyword_id;
+    }
+  }
+  if (fired >= 0) {
+    refractory_[fired] = kRefractoryFrames;
+    ResetKeyword(fired);
+  }
+}
+
+bool KeywordSpotter::PollHit(Hit* hit) {
+  if (pending_count_ == 0) return false;
+  *hit = pending_[pending_head_];
+  pending_head_ = (pending_head_ + 1) % kMaxPendingHits;
+  pending_count_--;
+  return true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "audio_features.h"
+
+// On-device keyword spotting for the 16kHz mono mic stream by template
+// matching.
+//
+// A keyword is enrolled from a few short recordings of the user saying it.
+// Each recording is trimmed to its voiced part and kept as a sequence of
+// 10 ms liftered cepstral frames (c1..c12 of 24 log-mel bands; without c0 the
+// match ignores gain). Incoming audio runs a streaming open-begin DTW against
+// every template, and a hit fires 30 ms after the end of a template is
+// reached with an average frame distance under the threshold, i.e. as soon as
+// the phrase has been said. All storage is allocated up front, and the work
+// per 10 ms is one FFT plus one DTW column per template.
+class KeywordSpotter {
+ public:
+  static constexpr int kMaxKeywords = 4;
+  static constexpr int kMaxTemplates = 4;         // Per keyword
+  static constexpr int kMaxTemplateFrames = 150;  // 1.5 s
+  static constexpr int kCepstra = 12;
+  static constexpr int kHopSamples = 160;  // 10 ms
+
+  struct Hit {
+    int keyword_id = -1;
+    float score = 0.0f;       // Average frame distance of the match
+    uint64_t end_sample = 0;  // Samples processed when the match ended
+  };
+
+  explicit KeywordSpotter(float threshold = 1.0f);
+
+  // Adds a template for |keyword_id| (0..kMaxKeywords-1) from 16kHz mono
+  // PCM16 of the phrase. False when the audio holds no usable speech or the
+  // keyword already has kMaxTemplates.
+  bool AddTemplate(int keyword_id, const uint8_t* pcm16, size_t length);
+  void RemoveKeyword(int keyword_id);
+  void Clear();
+  bool empty() const { return template_count_ == 0; }
+
+  void set_threshold(float threshold) { threshold_ = threshold; }
+  float threshold() const { return threshold_; }
+
+  // Feeds mono 16kHz float samples in stream order.
+  void Process(const float* samples, size_t count);
+  // Pops the oldest undelivered hit.
+  bool PollHit(Hit* hit);
+
+  // Restarts the stream; templates are kept.
+  void Reset();
+
+ private:
+  struct Template {
+    int keyword_id = -1;
+    int frames = 0;
+    float* features = nullptr;  // frames x kCepstra, into feature_pool_
+    float* cost = nullptr;      // Accumulated cost per template frame
+    int* length = nullptr;      // Path length per template frame
+    // Best complete match under the threshold, waiting to be confirmed.
+    float candidate = 0.0f;
+    int candidate_age = 0;
+    uint64_t candidate_end = 0;
+  };
+
+  // Features of one 25 ms frame; false when it is too quiet to judge.
+  bool FrameFeatures(const float* frame, float* out, float* log_energy = nullptr);
+  void Step(const float* feature);
+  void ResetKeyword(int keyword_id);
+
+  float threshold_;
+  LogMelExtractor mel_;
+  std::vector<float> log_mel_;
+  std::vector<float> cepstrum_;
+  std::vector<float> frame_;
+  float lifter_[kCepstra] = {};
+  size_t frame_fill_ = 0;
+  uint64_t samples_ = 0;
+
+  std::vector<float> feature_pool_;
+  std::vector<float> cost_pool_;
+  std::vector<int> length_pool_;
+  std::vector<float> scratch_cost_;
+  std::vector<int> scratch_length_;
+  std::vector<float> scratch_features_;
+  Template templates_[kMaxKeywords * kMaxTemplates];
+  int template_count_ = 0;
+
+  // Frames left before each keyword may fire again.
+  int refractory_[kMaxKeywords] = {};
+
+  // Small FIFO of hits between Process() and PollHit().
+  static constexpr int kMaxPendingHits = 8;
+  Hit pending_[kMaxPendingHits];
+  int pending_head_ = 0;
+  int pending_count_ = 0;
+};
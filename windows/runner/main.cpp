@@ -3,6 +3,8 @@
 #include <windows.h>
 
 #include "flutter_window.h"
+#include "stall_watchdog.h"
+#include "tracepoints.h"
 #include "utils.h"
 
 int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
@@ -17,6 +19,8 @@ int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
   // plugins.
   ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
 
+  RegisterTracepoints();
+
   flutter::DartProject project(L"data");
 
   std::vector<std::string> command_line_arguments =
@@ -32,12 +36,22 @@ int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
   }
   window.SetQuitOnClose(true);
 
+  // Times how long the loop below takes to get to a posted message, and the
+  // channel handlers it runs.
+  HWND hwnd = window.GetHandle();
+  PlatformWatchdog().Start([hwnd]() {
+    ::PostMessage(hwnd, FlutterWindow::kWatchdogPingMessage, 0, 0);
+  });
+
   ::MSG msg;
   while (::GetMessage(&msg, nullptr, 0, 0)) {
     ::TranslateMessage(&msg);
     ::DispatchMessage(&msg);
   }
 
+  PlatformWatchdog().Stop();
+
+  UnregisterTracepoints();
   ::CoUninitialize();
   return EXIT_SUCCESS;
 }
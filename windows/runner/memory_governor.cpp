@@ -0,0 +1,174 @@
+#include "memory_governor.h"
+
+#include <algorithm>
+
+namespace {
+
+static size_t RoundDown(size_t bytes, size_t unit) {
+  return bytes - bytes % unit;
+}
+
+}  // namespace
+
+MemoryGovernor::MemoryGovernor(size_t budget_bytes) : budget_(budget_bytes) {}
+
+MemoryGovernor::~MemoryGovernor() {
+  std::vector<MemoryPool*> pools;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pools.swap(pools_);
+  }
+  for (MemoryPool* pool : pools) {
+    std::lock_guard<std::mutex> lock(pool->reserve_mutex_);
+    pool->governor_ = nullptr;
+  }
+}
+
+void MemoryGovernor::SetBudget(size_t budget_bytes) {
+  budget_ = budget_bytes;
+  Rebalance();
+}
+
+std::vector<MemoryGovernor::PoolStats> MemoryGovernor::Stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<PoolStats> out;
+  out.reserve(pools_.size());
+  for (const MemoryPool* pool : pools_) {
+    PoolStats stats;
+    stats.tag = pool->tag_;
+    stats.priority = pool->priority_;
+    stats.floor_bytes = pool->floor_bytes_;
+    stats.want_bytes = pool->want_bytes_;
+    stats.limit_bytes = pool->limit();
+    stats.used_bytes = pool->used();
+    stats.peak_bytes = pool->peak_.load(std::memory_order_relaxed);
+    stats.refused = pool->refused_.load(std::memory_order_relaxed);
+    out.push_back(std::move(stats));
+  }
+  return out;
+}
+
+void MemoryGovernor::Attach(MemoryPool* pool, size_t held) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pools_.push_back(pool);
+  // Whatever the pool took before joining is already allocated; count it
+  // even past the budget so the next rebalance can claw it back.
+  used_ += held;
+}
+
+void MemoryGovernor::Detach(MemoryPool* pool, size_t held) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pools_.erase(std::remove(pools_.begin(), pools_.end(), pool), pools_.end());
+  Uncharge(held);
+}
+
+void MemoryGovernor::Rebalance() {
+  std::vector<std::pair<std::function<void(size_t)>, size_t>> shrinks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<MemoryPool*> order(pools_);
+    std::stable_sort(order.begin(), order.end(), [](const MemoryPool* a, const MemoryPool* b) {
+      return a->priority_ > b->priority_;
+    });
+
+    // Floors first, then the rest of each want, both in priority order.
+    // Grants are rounded down to the pool's unit; the remainder stays
+    // available to the pools after it.
+    size_t remaining = budget();
+    std::vector<size_t> limits(order.size(), 0);
+    for (size_t i = 0; i < order.size(); i++) {
+      const size_t floor = (std::min)(order[i]->floor_bytes_, order[i]->want_bytes_);
+      limits[i] = RoundDown((std::min)(floor, remaining), order[i]->unit_bytes_);
+      remaining -= limits[i];
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+      const size_t grant = (std::min)(order[i]->want_bytes_, limits[i] + remaining);
+      const size_t extra = RoundDown(grant, order[i]->unit_bytes_) - limits[i];
+      limits[i] += extra;
+      remaining -= extra;
+    }
+
+    for (size_t i = 0; i < order.size(); i++) {
+      MemoryPool* pool = order[i];
+      pool->limit_ = limits[i];
+      if (pool->used() > limits[i] && pool->on_shrink_) {
+        shrinks.emplace_back(pool->on_shrink_, limits[i]);
+      }
+    }
+  }
+  // Outside the lock: owners shrink by calling Reserve, which charges here.
+  for (auto& shrink : shrinks) shrink.first(shrink.second);
+}
+
+bool MemoryGovernor::Charge(size_t bytes) {
+  size_t used = used_.load(std::memory_order_relaxed);
+  do {
+    if (used + bytes > budget()) return false;
+  } while (!used_.compare_exchange_weak(used, used + bytes, std::memory_order_relaxed));
+  return true;
+}
+
+void MemoryGovernor::Uncharge(size_t bytes) {
+  used_.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+MemoryPool::MemoryPool(const char* tag, int priority, size_t floor_bytes, size_t want_bytes,
+                       size_t unit_bytes)
+    : tag_(tag),
+      priority_(priority),
+      floor_bytes_(floor_bytes),
+      want_bytes_(want_bytes),
+      unit_bytes_((std::max)(unit_bytes, size_t{1})),
+      limit_(RoundDown(want_bytes, (std::max)(unit_bytes, size_t{1}))) {}
+
+MemoryPool::~MemoryPool() {
+  Detach();
+}
+
+void MemoryPool::Attach(MemoryGovernor* governor) {
+  Detach();
+  if (!governor) return;
+  {
+    // Reserve may be running on another thread: it must see either no
+    // governor or one that has counted what this pool holds.
+    std::lock_guard<std::mutex> lock(reserve_mutex_);
+    governor_ = governor;
+    governor->Attach(this, used());
+  }
+  // Outside the lock: the rebalance may ask this pool to shrink.
+  governor->Rebalance();
+}
+
+void MemoryPool::Detach() {
+  MemoryGovernor* governor = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(reserve_mutex_);
+    if (!governor_) return;
+    governor = governor_;
+    governor_ = nullptr;
+    governor->Detach(this, used());
+    limit_ = RoundDown(want_bytes_, unit_bytes_);
+  }
+  governor->Rebalance();
+}
+
+void MemoryPool::SetShrinkCallback(std::function<void(size_t limit)> callback) {
+  on_shrink_ = std::move(callback);
+}
+
+bool MemoryPool::Reserve(size_t bytes) {
+  std::lock_guard<std::mutex> lock(reserve_mutex_);
+  const size_t held = used();
+  if (bytes <= held) {
+    used_ = bytes;
+    if (governor_) governor_->Uncharge(held - bytes);
+    return true;
+  }
+  if (bytes > limit() || (governor_ && !governor_->Charge(bytes - held))) {
+    refused_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  used_ = bytes;
+  if (bytes > peak_.load(std::memory_order_relaxed)) peak_ = bytes;
+  return true;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class MemoryPool;
+
+// Per-process budget for the native audio buffers. Each buffer owner holds a
+// MemoryPool tagged with a name and a priority; the governor grants every
+// pool a limit so the limits fit the budget, highest priority first, and
+// admits growth against both the pool's limit and the budget, so the bytes
+// held by all pools never exceed it. When the budget drops or a pool joins,
+// lower-priority pools lose their grant first and are asked to shrink.
+//
+// Attach, Detach and SetBudget must be called from one thread (the platform
+// thread); shrink callbacks run there. Reserve may be called from any thread.
+class MemoryGovernor {
+ public:
+  static constexpr size_t kDefaultBudgetBytes = 2 * 1024 * 1024;
+
+  // Pool priorities: audio still owed to Dart outranks history kept for
+  // replays and clips.
+  static constexpr int kPriorityHistory = 1;
+  static constexpr int kPriorityQueue = 2;
+
+  struct PoolStats {
+    std::string tag;
+    int priority = 0;
+    size_t floor_bytes = 0;
+    size_t want_bytes = 0;
+    size_t limit_bytes = 0;
+    size_t used_bytes = 0;
+    size_t peak_bytes = 0;
+    uint64_t refused = 0;  // Growth requests turned down
+  };
+
+  explicit MemoryGovernor(size_t budget_bytes = kDefaultBudgetBytes);
+  ~MemoryGovernor();
+
+  void SetBudget(size_t budget_bytes);
+  size_t budget() const { return budget_.load(std::memory_order_relaxed); }
+  // Bytes held by all pools.
+  size_t used() const { return used_.load(std::memory_order_relaxed); }
+
+  // One entry per attached pool, in attach order.
+  std::vector<PoolStats> Stats() const;
+
+ private:
+  friend class MemoryPool;
+
+  // Add or remove |pool| and the |held| bytes it has charged; the pool
+  // calls these under its reserve lock and rebalances after releasing it.
+  void Attach(MemoryPool* pool, size_t held);
+  void Detach(MemoryPool* pool, size_t held);
+  // Recomputes every pool's limit and asks pools over it to shrink.
+  void Rebalance();
+  // Admits |bytes| more against the budget.
+  bool Charge(size_t bytes);
+  void Uncharge(size_t bytes);
+
+  mutable std::mutex mutex_;
+  std::vector<MemoryPool*> pools_;
+  std::atomic<size_t> budget_;
+  std::atomic<size_t> used_{0};
+};
+
+// One buffer's share of a MemoryGovernor. The owner keeps its buffer within
+// limit() and reports what it holds through Reserve(). Until it is attached
+// a pool may grow up to its want.
+class MemoryPool {
+ public:
+  // |floor_bytes| is granted before any lower-priority pool gets more than
+  // its own floor; |want_bytes| is what the buffer would hold unconstrained.
+  // Limits are whole multiples of |unit_bytes|, the buffer's frame or block
+  // size, so trimming to one never splits a sample.
+  MemoryPool(const char* tag, int priority, size_t floor_bytes, size_t want_bytes,
+             size_t unit_bytes = 1);
+  ~MemoryPool();
+
+  MemoryPool(const MemoryPool&) = delete;
+  MemoryPool& operator=(const MemoryPool&) = delete;
+
+  void Attach(MemoryGovernor* governor);
+  void Detach();
+
+  // Called with the new limit when it drops below what the pool holds.
+  void SetShrinkCallback(std::function<void(size_t limit)> callback);
+
+  // Sets the bytes held to |bytes|. Shrinking always succeeds; growth is
+  // refused (and nothing changes) past the limit or the budget.
+  bool Reserve(size_t bytes);
+
+  size_t limit() const { return limit_.load(std::memory_order_relaxed); }
+  size_t used() const { return used_.load(std::memory_order_relaxed); }
+
+ private:
+  friend class MemoryGovernor;
+
+  const std::string tag_;
+  const int priority_;
+  const size_t floor_bytes_;
+  const size_t want_bytes_;
+  const size_t unit_bytes_;
+  MemoryGovernor* governor_ = nullptr;  // Guarded by reserve_mutex_
+  std::function<void(size_t)> on_shrink_;
+  std::atomic<size_t> limit_;
+  std::atomic<size_t> used_{0};
+  std::atomic<size_t> peak_{0};
+  std::atomic<uint64_t> refused_{0};
+  // Serializes Reserve calls on this pool against each other and against
+  // attaching or detaching it. Taken before the governor's mutex, never after.
+  std::mutex reserve_mutex_;
+};
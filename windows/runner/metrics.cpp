@@ -0,0 +1,230 @@
+#include "metrics.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+struct ShardPool {
+  std::mutex mutex;
+  std::vector<size_t> free;
+
+  ShardPool() {
+    for (size_t shard = kSharedMetricShard; shard-- > 0;) free.push_back(shard);
+  }
+};
+
+// Function-local so it exists before any thread asks for a shard.
+static ShardPool& Pool() {
+  static ShardPool pool;
+  return pool;
+}
+
+static void AppendQuoted(std::string* out, const std::string& text) {
+  out->push_back('"');
+  for (const char c : text) {
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out->append(escaped);
+    } else {
+      out->push_back(c);
+    }
+  }
+  out->push_back('"');
+}
+
+static void AppendField(std::string* out, const char* name, int64_t value, bool first = false) {
+  if (!first) out->push_back(',');
+  out->push_back('"');
+  out->append(name);
+  out->append("\":");
+  out->append(std::to_string(value));
+}
+
+}  // namespace
+
+MetricShardLease::MetricShardLease() : shard_(kSharedMetricShard) {
+  ShardPool& pool = Pool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  if (!pool.free.empty()) {
+    shard_ = pool.free.back();
+    pool.free.pop_back();
+  }
+}
+
+MetricShardLease::~MetricShardLease() {
+  if (shard_ == kSharedMetricShard) return;
+  // The mutex also hands this thread's writes to the next owner.
+  ShardPool& pool = Pool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  pool.free.push_back(shard_);
+}
+
+int64_t Counter::Value() const {
+  int64_t total = 0;
+  for (const Cell& cell : cells_) total += cell.value.load(std::memory_order_relaxed);
+  return total;
+}
+
+void HistogramSnapshot::Merge(const HistogramSnapshot& other) {
+  if (other.count == 0) return;
+  if (count == 0) {
+    *this = other;
+    return;
+  }
+  for (size_t i = 0; i < counts.size(); i++) counts[i] += other.counts[i];
+  count += other.count;
+  sum += other.sum;
+  min = (std::min)(min, other.min);
+  max = (std::max)(max, other.max);
+}
+
+double HistogramSnapshot::Mean() const {
+  return count == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(count);
+}
+
+int64_t HistogramSnapshot::Percentile(double q) const {
+  if (count == 0) return 0;
+  const double clamped = (std::min)(1.0, (std::max)(0.0, q));
+  // The rank of the value wanted, 1-based: p50 of 10 values is the 5th.
+  const uint64_t rank = (std::max)(
+      uint64_t{1}, static_cast<uint64_t>(std::ceil(clamped * static_cast<double>(count))));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts.size(); i++) {
+    seen += counts[i];
+    if (seen >= rank) return (std::max)(min, (std::min)(max, Histogram::BucketTop(i)));
+  }
+  return max;
+}
+
+Histogram::~Histogram() {
+  for (std::atomic<Shard*>& slot : shards_) delete slot.load(std::memory_order_relaxed);
+}
+
+Histogram::Shard* Histogram::InstallShard(std::atomic<Shard*>* slot) {
+  // Value-initialized, so the buckets start at zero.
+  Shard* fresh = new Shard();
+  Shard* expected = nullptr;
+  if (slot->compare_exchange_strong(expected, fresh, std::memory_order_acq_rel)) return fresh;
+  // Another thread with the same shard got there first.
+  delete fresh;
+  return expected;
+}
+
+int64_t Histogram::BucketTop(size_t index) {
+  constexpr size_t kHalf = size_t{1} << (kSubBucketBits - 1);
+  if (index < (size_t{1} << kSubBucketBits)) return static_cast<int64_t>(index);
+  const size_t shift = index / kHalf - 1;
+  const uint64_t sub = index - shift * kHalf;
+  return static_cast<int64_t>(((sub + 1) << shift) - 1);
+}
+
+HistogramSnapshot Histogram::Snapshot() const {
+  HistogramSnapshot snapshot;
+  int64_t min = INT64_MAX;
+  int64_t max = INT64_MIN;
+  for (const std::atomic<Shard*>& slot : shards_) {
+    const Shard* shard = slot.load(std::memory_order_acquire);
+    if (!shard) continue;
+    if (snapshot.counts.empty()) snapshot.counts.assign(kBuckets, 0);
+    for (size_t i = 0; i < kBuckets; i++) {
+      const uint64_t n = shard->counts[i].load(std::memory_order_relaxed);
+      snapshot.counts[i] += n;
+      snapshot.count += n;
+    }
+    snapshot.sum += shard->sum.load(std::memory_order_relaxed);
+    min = (std::min)(min, shard->min.load(std::memory_order_relaxed));
+    max = (std::max)(max, shard->max.load(std::memory_order_relaxed));
+  }
+  if (snapshot.count == 0) return HistogramSnapshot();
+  snapshot.min = min;
+  snapshot.max = max;
+  return snapshot;
+}
+
+Counter* MetricsRegistry::GetCounter(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unique_ptr<Counter>& metric = counters_[name];
+  if (!metric) metric = std::make_unique<Counter>();
+  return metric.get();
+}
+
+Gauge* MetricsRegistry::GetGauge(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unique_ptr<Gauge>& metric = gauges_[name];
+  if (!metric) metric = std::make_unique<Gauge>();
+  return metric.get();
+}
+
+Histogram* MetricsRegistry::GetHistogram(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unique_ptr<Histogram>& metric = histograms_[name];
+  if (!metric) metric = std::make_unique<Histogram>();
+  return metric.get();
+}
+
+MetricsRegistry::Snapshot MetricsRegistry::Take() const {
+  // Only the maps are guarded; the values are read without the lock.
+  std::lock_guard<std::mutex> lock(mutex_);
+  Snapshot snapshot;
+  for (const auto& entry : counters_) snapshot.counters[entry.first] = entry.second->Value();
+  for (const auto& entry : gauges_) snapshot.gauges[entry.first] = entry.second->Value();
+  for (const auto& entry : histograms_) {
+    snapshot.histograms[entry.first] = entry.second->Snapshot();
+  }
+  return snapshot;
+}
+
+std::string MetricsRegistry::ToJson() const {
+  const Snapshot snapshot = Take();
+  std::string out = "{\"counters\":{";
+  bool first = true;
+  for (const auto& entry : snapshot.counters) {
+    if (!first) out.push_back(',');
+    first = false;
+    AppendQuoted(&out, entry.first);
+    out.push_back(':');
+    out.append(std::to_string(entry.second));
+  }
+  out.append("},\"gauges\":{");
+  first = true;
+  for (const auto& entry : snapshot.gauges) {
+    if (!first) out.push_back(',');
+    first = false;
+    AppendQuoted(&out, entry.first);
+    out.push_back(':');
+    out.append(std::to_string(entry.second));
+  }
+  out.append("},\"histograms\":{");
+  first = true;
+  for (const auto& entry : snapshot.histograms) {
+    if (!first) out.push_back(',');
+    first = false;
+    const HistogramSnapshot& h = entry.second;
+    AppendQuoted(&out, entry.first);
+    out.append(":{");
+    AppendField(&out, "count", static_cast<int64_t>(h.count), true);
+    AppendField(&out, "sum", h.sum);
+    AppendField(&out, "min", h.min);
+    AppendField(&out, "max", h.max);
+    char mean[32];
+    snprintf(mean, sizeof(mean), ",\"mean\":%.1f", h.Mean());
+    out.append(mean);
+    AppendField(&out, "p50", h.Percentile(0.5));
+    AppendField(&out, "p90", h.Percentile(0.9));
+    AppendField(&out, "p99", h.Percentile(0.99));
+    AppendField(&out, "p999", h.Percentile(0.999));
+    out.push_back('}');
+  }
+  out.append("}}");
+  return out;
+}
+
+MetricsRegistry& Metrics() {
+  static MetricsRegistry registry;
+  return registry;
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Process-wide counters, gauges and latency histograms for the native
+// components; Dart reads them with getMetrics / getMetricsJson.
+//
+// Recording is lock-free and uncontended: a thread leases a shard on first
+// use and is then the only writer of its cache line of each counter and its
+// bucket array of each histogram, so it updates them with a plain load and
+// store instead of a locked read-modify-write. Shards go back to the pool
+// when their thread exits. Threads beyond the pool share the last shard and
+// use atomic adds there. Registration takes a lock, so components look their
+// metrics up once and keep the pointer. Metrics are never removed.
+//
+// A snapshot sums the shards with relaxed loads: every value in it is one
+// that was recorded, but a value recorded while the snapshot runs can be in
+// a histogram's buckets and not yet in its sum.
+
+constexpr size_t kMetricShards = 16;
+// Written by every thread that found no free shard.
+constexpr size_t kSharedMetricShard = kMetricShards - 1;
+
+// Holds a thread's shard for as long as the thread runs.
+class MetricShardLease {
+ public:
+  MetricShardLease();
+  ~MetricShardLease();
+  size_t shard() const { return shard_; }
+
+ private:
+  size_t shard_;
+};
+
+// The calling thread's shard.
+inline size_t MetricShard() {
+  thread_local const MetricShardLease lease;
+  return lease.shard();
+}
+
+// Adds |n| to a cell of |shard|: only its owner writes an exclusive cell, so
+// no locked instruction is needed there.
+template <typename T>
+inline void MetricAdd(std::atomic<T>* cell, T n, size_t shard) {
+  if (shard != kSharedMetricShard) {
+    cell->store(cell->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  } else {
+    cell->fetch_add(n, std::memory_order_relaxed);
+  }
+}
+
+class Counter {
+ public:
+  void Add(int64_t n = 1) {
+    const size_t shard = MetricShard();
+    MetricAdd(&cells_[shard].value, n, shard);
+  }
+  int64_t Value() const;
+
+ private:
+  // One cache line per shard, so two shards never share one.
+  struct Cell {
+    std::atomic<int64_t> value{0};
+    char padding[64 - sizeof(std::atomic<int64_t>)];
+  };
+  Cell cells_[kMetricShards];
+};
+
+// A last-value metric such as a queue depth. A single atomic: gauges are set
+// far less often than counters are bumped.
+class Gauge {
+ public:
+  void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  void Add(int64_t delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+  int64_t Value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+struct HistogramSnapshot {
+  std::vector<uint64_t> counts;  // Per bucket; empty when nothing was recorded
+  uint64_t count = 0;
+  int64_t sum = 0;
+  int64_t min = 0;
+  int64_t max = 0;
+
+  void Merge(const HistogramSnapshot& other);
+  double Mean() const;
+  // The value at quantile |q| (0..1): the top of the bucket it falls in,
+  // capped at max, so within 1/64 above the true value.
+  int64_t Percentile(double q) const;
+};
+
+// HDR-style histogram of non-negative values (e.g. latency in ns or us):
+// exact below 128, then 64 linear buckets per power of two, so any value is
+// within 1/64 of its bucket, up to 2^36 (above that, the top bucket). Bucket
+// arrays are allocated per shard on first use, at most kMetricShards of
+// kBuckets counters each.
+class Histogram {
+ public:
+  static constexpr int kSubBucketBits = 7;
+  static constexpr int kMaxValueBits = 36;
+  static constexpr size_t kBuckets =
+      static_cast<size_t>(kMaxValueBits - kSubBucketBits + 2) << (kSubBucketBits - 1);
+
+  Histogram() = default;
+  ~Histogram();
+  Histogram(const Histogram&) = delete;
+  Histogram& operator=(const Histogram&) = delete;
+
+  void Record(int64_t value) {
+    const size_t index = MetricShard();
+    Shard* shard = ShardAt(index);
+    MetricAdd(&shard->counts[BucketIndex(value)], uint64_t{1}, index);
+    MetricAdd(&shard->sum, value, index);
+    // Extremes rarely move once a few values are in, so this is mostly a load.
+    int64_t seen = shard->min.load(std::memory_order_relaxed);
+    while (value < seen &&
+           !shard->min.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+    seen = shard->max.load(std::memory_order_relaxed);
+    while (value > seen &&
+           !shard->max.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  HistogramSnapshot Snapshot() const;
+
+  static size_t BucketIndex(int64_t value) {
+    if (value < (int64_t{1} << kSubBucketBits)) return value < 0 ? 0 : static_cast<size_t>(value);
+    const uint64_t v = (std::min)(static_cast<uint64_t>(value), kMaxValue);
+    const int shift = HighestBit(v) - kSubBucketBits + 1;
+    return (static_cast<size_t>(shift) << (kSubBucketBits - 1)) + static_cast<size_t>(v >> shift);
+  }
+  // The highest value that falls in bucket |index|.
+  static int64_t BucketTop(size_t index);
+
+ private:
+  static constexpr uint64_t kMaxValue = (uint64_t{1} << kMaxValueBits) - 1;
+
+  struct Shard {
+    std::atomic<uint64_t> counts[kBuckets];
+    std::atomic<int64_t> sum{0};
+    std::atomic<int64_t> min{INT64_MAX};
+    std::atomic<int64_t> max{INT64_MIN};
+  };
+
+  static int HighestBit(uint64_t v) {
+#if defined(_MSC_VER)
+    unsigned long bit = 0;
+    _BitScanReverse64(&bit, v);
+    return static_cast<int>(bit);
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+  }
+
+  Shard* ShardAt(size_t index) {
+    std::atomic<Shard*>& slot = shards_[index];
+    Shard* shard = slot.load(std::memory_order_acquire);
+    return shard ? shard : InstallShard(&slot);
+  }
+  Shard* InstallShard(std::atomic<Shard*>* slot);
+
+  std::atomic<Shard*> shards_[kMetricShards] = {};
+};
+
+class MetricsRegistry {
+ public:
+  struct Snapshot {
+    std::map<std::string, int64_t> counters;
+    std::map<std::string, int64_t> gauges;
+    std::map<std::string, HistogramSnapshot> histograms;
+  };
+
+  // Returns the metric called |name|, creating it on first use. The pointer
+  // stays valid for the life of the process.
+  Counter* GetCounter(const std::string& name);
+  Gauge* GetGauge(const std::string& name);
+  Histogram* GetHistogram(const std::string& name);
+
+  Snapshot Take() const;
+  // {"counters": {name: value}, "gauges": {...}, "histograms": {name:
+  // {count, sum, min, max, mean, p50, p90, p99, p999}}}
+  std::string ToJson() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::map<std::string, std::unique_ptr<Counter>> counters_;
+  std::map<std::string, std::unique_ptr<Gauge>> gauges_;
+  std::map<std::string, std::unique_ptr<Histogram>> histograms_;
+};
+
+// The registry every native component records into.
+MetricsRegistry& Metrics();
@@ -0,0 +1,75 @@
+#include "mic_stream.h"
+
+#include "audio_clock.h"
+#include "tracepoints.h"
+
+MicStream::MicStream(ConversationAnalytics* analytics, MemoryGovernor* governor)
+    : analytics_(analytics) {
+  history_pool_.SetShrinkCallback([this](size_t) { history_.FitToPool(&history_pool_); });
+  history_pool_.Attach(governor);
+}
+
+void MicStream::Reset() {
+  vad_.Reset();
+  quality_.Reset();
+  history_.Reset();
+  keywords_.Reset();
+  endpointer_.Reset();
+  end_of_utterance_ = false;
+  started_ = false;
+  start_ms_ = 0;
+  pushed_samples_ = 0;
+  frames_ = 0;
+  pushes_ = 0;
+}
+
+void MicStream::PushPcm16(const uint8_t* data, size_t length) {
+  const size_t samples = length / 2;
+  if (samples == 0) return;
+  const uint64_t seq = pushes_++;
+  HN_TRACE_PACKET_ARRIVAL(kTraceMic, seq, length);
+  const int64_t start_ns = SteadyNowNs();
+  bytes_->Add(static_cast<int64_t>(length));
+  history_.FitToPool(&history_pool_);
+  history_.AppendPcm16(data, samples * 2);
+
+  // Pushes trail capture by a varying delay, so no single push dates the
+  // stream. Every push bounds the capture start from above (its audio ended
+  // no later than now); keep the tightest bound so mic frames line up with
+  // the system frames, which are dated at capture.
+  pushed_samples_ += samples;
+  const int64_t start_bound = SteadyNowMs() - static_cast<int64_t>(pushed_samples_ / 16);
+  if (!started_ || start_bound < start_ms_) {
+    started_ = true;
+    start_ms_ = start_bound;
+  }
+
+  scratch_.resize(samples);
+  for (size_t i = 0; i < samples; i++) {
+    const int16_t s = static_cast<int16_t>(data[i * 2] | (data[i * 2 + 1] << 8));
+    scratch_[i] = static_cast<float>(s) / 32768.0f;
+  }
+
+  quality_.Process(scratch_.data(), samples);
+  if (copy_detector_) copy_detector_->PushMic(scratch_.data(), samples, SteadyNowMs());
+
+  const int frame_ms = vad_.frame_ms();
+  vad_.Process(scratch_.data(), samples, [&](bool speech) {
+    const int64_t t_ms = start_ms_ + static_cast<int64_t>(frames_) * frame_ms;
+    frames_++;
+    if (analytics_) {
+      analytics_->OnFrame(ConversationAnalytics::kMic, t_ms, frame_ms, speech);
+    }
+  });
+  HN_TRACE_STAGE_DONE(kTraceMic, kTraceStageVad, seq, samples);
+
+  keywords_.Process(scratch_.data(), samples);
+  if (endpointer_.Process(scratch_.data(), samples)) end_of_utterance_ = true;
+  push_ns_->Record(SteadyNowNs() - start_ns);
+}
+
+bool MicStream::TakeEndOfUtterance() {
+  const bool ended = end_of_utterance_;
+  end_of_utterance_ = false;
+  return ended;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "audio_history.h"
+#include "audio_quality.h"
+#include "conversation_analytics.h"
+#include "digital_copy_detector.h"
+#include "keyword_spotter.h"
+#include "memory_governor.h"
+#include "metrics.h"
+#include "speech_activity.h"
+#include "utterance_endpointer.h"
+
+// Native processing for microphone audio. The mic is captured on the Dart
+// side (record plugin) and its 16kHz mono PCM16 frames are pushed here over
+// the audio channel, so mic analysis shares the native code used for the
+// system stream. Called from the platform thread only.
+class MicStream {
+ public:
+  // |governor| budgets the history; it must outlive the stream.
+  MicStream(ConversationAnalytics* analytics, MemoryGovernor* governor);
+
+  // Receives the mic side of copy detection; must outlive the stream.
+  void SetCopyDetector(DigitalCopyDetector* detector) { copy_detector_ = detector; }
+
+  void PushPcm16(const uint8_t* data, size_t length);
+
+  // Restarts the stream clock; the next push is treated as time zero.
+  void Reset();
+
+  // Up to the last minute of mic audio, ADPCM-compressed.
+  const AudioHistory& history() const { return history_; }
+
+  // Input quality of the pushed audio since the last Reset().
+  const AudioQualityMeter& quality() const { return quality_; }
+  void ResetQuality() { quality_.Reset(); }
+
+  // Voice triggers spotted in the pushed audio.
+  KeywordSpotter& keyword_spotter() { return keywords_; }
+
+  // End-of-utterance detection on the pushed audio.
+  UtteranceEndpointer& endpointer() { return endpointer_; }
+  // True once per utterance end detected since the last call.
+  bool TakeEndOfUtterance();
+
+ private:
+  ConversationAnalytics* analytics_;
+  DigitalCopyDetector* copy_detector_ = nullptr;
+  EnergyVad vad_;
+  AudioQualityMeter quality_;
+  AudioHistory history_{AudioHistory::kSamplesPerBlock};  // Sized by history_pool_
+  KeywordSpotter keywords_;
+  UtteranceEndpointer endpointer_;
+  bool end_of_utterance_ = false;
+  std::vector<float> scratch_;
+  bool started_ = false;
+  int64_t start_ms_ = 0;  // Capture time of the first pushed sample
+  uint64_t pushed_samples_ = 0;
+  uint64_t frames_ = 0;
+  uint64_t pushes_ = 0;
+  Histogram* push_ns_ = Metrics().GetHistogram("audio.mic.push_ns");
+  Counter* bytes_ = Metrics().GetCounter("audio.mic.bytes");
+  // Declared last so it detaches before history_ goes away.
+  MemoryPool history_pool_{"mic_history", MemoryGovernor::kPriorityHistory,
+                           AudioHistory::BytesForSamples(16000 * 10),
+                           AudioHistory::BytesForSamples(16000 * 60),
+                           AudioHistory::kBlockBytes};
+};
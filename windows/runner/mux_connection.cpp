@@ -0,0 +1,374 @@
+#include "mux_connection.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "audio_clock.h"
+
+namespace {
+
+constexpr int64_t kMinBackoffMs = 250;
+constexpr int64_t kMaxBackoffMs = 5000;
+// Close code reported for streams lost with the connection.
+constexpr int kConnectionLostCode = 1006;
+
+}  // namespace
+
+MuxConnection::MuxConnection(std::unique_ptr<MuxTransport> transport)
+    : transport_(std::move(transport)) {}
+
+MuxConnection::~MuxConnection() {
+  Stop();
+}
+
+bool MuxConnection::Start(const std::string& url) {
+  if (url.empty()) return false;
+  Stop();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    url_ = url;
+    running_ = true;
+    connected_ = false;
+    stats_ = Stats();
+  }
+  io_thread_ = new std::thread(&MuxConnection::IoThreadProc, this);
+  writer_thread_ = new std::thread(&MuxConnection::WriterThreadProc, this);
+  return true;
+}
+
+void MuxConnection::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) return;
+    running_ = false;
+  }
+  wake_.notify_all();
+  transport_->Close();
+  for (std::thread** thread : {&io_thread_, &writer_thread_}) {
+    if (*thread) {
+      (*thread)->join();
+      delete *thread;
+      *thread = nullptr;
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  connected_ = false;
+  streams_.clear();
+  control_.clear();
+  events_.clear();
+}
+
+bool MuxConnection::started() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return running_;
+}
+
+bool MuxConnection::connected() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return connected_;
+}
+
+void MuxConnection::SetEventCallback(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  on_events_ = std::move(callback);
+}
+
+uint32_t MuxConnection::OpenStream(const std::string& open_json, int priority) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!running_) return 0;
+  const uint32_t id = next_stream_++;
+  if (next_stream_ == 0) next_stream_ = 1;
+  Stream& stream = streams_[id];
+  stream.priority = (std::min)(kPriorities - 1, (std::max)(0, priority));
+  Pending open;
+  mux::BuildFrame(mux::kOpen, id, reinterpret_cast<const uint8_t*>(open_json.data()),
+                  open_json.size(), &open.frame);
+  open.queued_us = SteadyNowUs();
+  stream.queue.push_back(std::move(open));
+  stats_.streams_opened++;
+  lock.unlock();
+  wake_.notify_all();
+  return id;
+}
+
+bool MuxConnection::EnqueueLocked(uint32_t id, Pending pending) {
+  auto it = streams_.find(id);
+  if (it == streams_.end() || it->second.closing) return false;
+  Stream& stream = it->second;
+  if (stream.queued_bytes + pending.cost > kMaxQueuedBytes) {
+    stats_.refused++;
+    return false;
+  }
+  pending.queued_us = SteadyNowUs();
+  stream.queued_bytes += pending.cost;
+  stream.queue.push_back(std::move(pending));
+  return true;
+}
+
+bool MuxConnection::SendText(uint32_t stream, const std::string& text) {
+  Pending pending;
+  mux::BuildFrame(mux::kText, stream, reinterpret_cast<const uint8_t*>(text.data()),
+                  text.size(), &pending.frame);
+  pending.cost = static_cast<uint32_t>(text.size());
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!EnqueueLocked(stream, std::move(pending))) return false;
+  lock.unlock();
+  wake_.notify_all();
+  return true;
+}
+
+bool MuxConnection::SendAudio(uint32_t stream, uint8_t source, const uint8_t* data,
+                              size_t length) {
+  if (!data || length == 0) return true;
+  Pending pending;
+  mux::BuildAudioFrame(stream, source, data, length, &pending.frame);
+  pending.cost = static_cast<uint32_t>(length + 1);
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!EnqueueLocked(stream, std::move(pending))) return false;
+  lock.unlock();
+  wake_.notify_all();
+  return true;
+}
+
+void MuxConnection::CloseStream(uint32_t stream, uint16_t code) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = streams_.find(stream);
+  if (it == streams_.end() || it->second.closing) return;
+  it->second.closing = true;
+  if (!it->second.announced && it->second.queue.size() <= 1) {
+    // Never reached the server: nothing to tell it.
+    streams_.erase(it);
+    return;
+  }
+  Pending close;
+  mux::BuildCloseFrame(stream, code, std::string(), &close.frame);
+  close.queued_us = SteadyNowUs();
+  it->second.queue.push_back(std::move(close));
+  lock.unlock();
+  wake_.notify_all();
+}
+
+std::vector<MuxConnection::Event> MuxConnection::TakeEvents() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::vector<Event> events;
+  events.swap(events_);
+  bool credit = false;
+  for (const Event& event : events) {
+    if (event.type != EventType::kText) continue;
+    auto it = streams_.find(event.stream);
+    if (it == streams_.end()) continue;
+    it->second.consumed += static_cast<uint32_t>(event.text.size());
+    if (it->second.consumed >= mux::kCreditThreshold) {
+      control_.emplace_back();
+      mux::BuildCreditFrame(event.stream, it->second.consumed, &control_.back());
+      it->second.consumed = 0;
+      credit = true;
+    }
+  }
+  lock.unlock();
+  if (credit) wake_.notify_all();
+  return events;
+}
+
+MuxConnection::Stats MuxConnection::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.connected = connected_;
+  stats.open_streams = streams_.size();
+  return stats;
+}
+
+void MuxConnection::PushEventLocked(Event event, bool* notify) {
+  if (events_.empty()) *notify = true;
+  events_.push_back(std::move(event));
+}
+
+void MuxConnection::Notify(bool notify) {
+  if (!notify) return;
+  std::function<void()> callback;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    callback = on_events_;
+  }
+  if (callback) callback();
+}
+
+void MuxConnection::DropStreamsLocked(bool* notify) {
+  for (auto it = streams_.begin(); it != streams_.end();) {
+    if (!it->second.announced) {
+      ++it;
+      continue;
+    }
+    if (!it->second.closing) {
+      Event event;
+      event.type = EventType::kClosed;
+      event.stream = it->first;
+      event.code = kConnectionLostCode;
+      event.text = "connection lost";
+      PushEventLocked(std::move(event), notify);
+    }
+    it = streams_.erase(it);
+  }
+  control_.clear();
+}
+
+void MuxConnection::IoThreadProc() {
+  int64_t backoff_ms = kMinBackoffMs;
+  std::vector<uint8_t> message;
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!running_) return;
+    }
+    if (!transport_->Connect(url_)) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stats_.connect_failures++;
+      wake_.wait_for(lock, std::chrono::milliseconds(backoff_ms), [this] { return !running_; });
+      backoff_ms = (std::min)(backoff_ms * 2, kMaxBackoffMs);
+      continue;
+    }
+
+    bool notify = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!running_) {
+        transport_->Close();
+        return;
+      }
+      connected_ = true;
+      stats_.connects++;
+      Event event;
+      event.type = EventType::kConnected;
+      PushEventLocked(std::move(event), &notify);
+    }
+    std::cout << "[MuxConnection] Connected" << std::endl;
+    wake_.notify_all();
+    Notify(notify);
+    backoff_ms = kMinBackoffMs;
+
+    while (transport_->Receive(&message)) {
+      mux::Frame frame;
+      if (!mux::ParseFrame(message.data(), message.size(), &frame)) continue;
+      HandleFrame(frame);
+    }
+    transport_->Close();
+
+    notify = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      connected_ = false;
+      DropStreamsLocked(&notify);
+      Event event;
+      event.type = EventType::kDisconnected;
+      PushEventLocked(std::move(event), &notify);
+      if (!running_) return;
+    }
+    std::cerr << "[MuxConnection] Connection lost, reconnecting" << std::endl;
+    Notify(notify);
+  }
+}
+
+void MuxConnection::HandleFrame(const mux::Frame& frame) {
+  bool notify = false;
+  bool wake = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.frames_received++;
+    stats_.bytes_received += frame.length + mux::kHeaderBytes;
+    auto it = streams_.find(frame.stream);
+    if (it == streams_.end()) return;  // Closed here already
+    switch (frame.type) {
+      case mux::kText: {
+        Event event;
+        event.type = EventType::kText;
+        event.stream = frame.stream;
+        event.text.assign(reinterpret_cast<const char*>(frame.payload), frame.length);
+        PushEventLocked(std::move(event), &notify);
+        break;
+      }
+      case mux::kCredit: {
+        uint32_t bytes = 0;
+        if (mux::ParseCredit(frame, &bytes)) {
+          it->second.send_window += bytes;
+          wake = true;
+        }
+        break;
+      }
+      case mux::kClose: {
+        uint16_t code = 0;
+        Event event;
+        mux::ParseClose(frame, &code, &event.text);
+        event.type = EventType::kClosed;
+        event.stream = frame.stream;
+        event.code = code;
+        if (!it->second.closing) PushEventLocked(std::move(event), &notify);
+        streams_.erase(it);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  if (wake) wake_.notify_all();
+  Notify(notify);
+}
+
+bool MuxConnection::NextFrameLocked(std::vector<uint8_t>* frame, int* priority) {
+  if (!control_.empty()) {
+    *frame = std::move(control_.front());
+    control_.pop_front();
+    *priority = 0;
+    return true;
+  }
+  for (int p = 0; p < kPriorities; p++) {
+    // Round robin: start after the stream of this priority sent last.
+    auto start = streams_.upper_bound(last_sent_[p]);
+    for (size_t n = 0; n < streams_.size(); n++, ++start) {
+      if (start == streams_.end()) start = streams_.begin();
+      Stream& stream = start->second;
+      if (stream.priority != p || stream.queue.empty()) continue;
+      Pending& head = stream.queue.front();
+      if (head.cost > 0 && stream.send_window <= 0) {
+        if (!stream.stalled) stats_.credit_stalls++;
+        stream.stalled = true;
+        continue;
+      }
+      stream.stalled = false;
+      const uint32_t id = start->first;
+      const bool is_close = head.frame[0] == mux::kClose;
+      if (head.frame[0] == mux::kOpen) stream.announced = true;
+      stream.send_window -= head.cost;
+      stream.queued_bytes -= head.cost;
+      const int64_t wait_us = SteadyNowUs() - head.queued_us;
+      stats_.max_wait_us[p] = (std::max)(stats_.max_wait_us[p], wait_us);
+      queue_wait_us_[p]->Record(wait_us);
+      *frame = std::move(head.frame);
+      stream.queue.pop_front();
+      last_sent_[p] = id;
+      *priority = p;
+      if (is_close) streams_.erase(start);
+      return true;
+    }
+  }
+  return false;
+}
+
+void MuxConnection::WriterThreadProc() {
+  std::vector<uint8_t> frame;
+  for (;;) {
+    int priority = 0;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] {
+        return !running_ || (connected_ && NextFrameLocked(&frame, &priority));
+      });
+      if (!running_) return;
+      stats_.frames_sent[priority]++;
+      stats_.bytes_sent[priority] += frame.size();
+    }
+    if (!transport_->Send(frame.data(), frame.size())) {
+      // The I/O thread sees the socket close and reconnects.
+      transport_->Close();
+    }
+  }
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "metrics.h"
+#include "mux_protocol.h"
+
+// Where the connection's WebSocket comes from: WinHTTP on Windows, a plain
+// socket client in tests and benchmarks. Send() and Receive() run on
+// different threads at the same time; Close() may come from a third thread
+// and must make both return.
+class MuxTransport {
+ public:
+  virtual ~MuxTransport() = default;
+
+  // Opens a WebSocket to |url| (ws:// or wss://), replacing any previous one.
+  virtual bool Connect(const std::string& url) = 0;
+  // Sends one binary message.
+  virtual bool Send(const uint8_t* data, size_t length) = 0;
+  // Blocks for the next binary message; false once the socket is gone.
+  virtual bool Receive(std::vector<uint8_t>* message) = 0;
+  virtual void Close() = 0;
+};
+
+// One persistent connection to the server carrying the transcription session
+// and AI requests as logical streams (wire format in mux_protocol.h), so they
+// share one handshake, one TLS session and one keepalive, and an AI request
+// never waits for a connection to open.
+//
+// Each stream has a priority, 0 first: the writer always sends the oldest
+// frame of the most urgent stream that has both data and send window, round
+// robin among streams of equal priority, so audio is never queued behind an
+// AI request and a stalled stream does not block the others. Credit frames
+// go ahead of everything.
+//
+// The connection reconnects on its own with backoff. Streams do not survive a
+// reconnect: each open stream gets a kClosed event (code 1006) and its owner
+// opens a new one, as it would after losing its own WebSocket.
+//
+// OpenStream/Send*/CloseStream/TakeEvents are called from the platform thread;
+// an I/O thread connects and reads, a writer thread sends.
+class MuxConnection {
+ public:
+  static constexpr int kPriorities = 3;
+
+  enum class EventType { kConnected, kDisconnected, kText, kClosed };
+
+  struct Event {
+    EventType type = EventType::kText;
+    uint32_t stream = 0;
+    std::string text;  // kText: the message; kClosed: the reason
+    int code = 0;      // kClosed
+  };
+
+  struct Stats {
+    bool connected = false;
+    uint64_t connects = 0;
+    uint64_t connect_failures = 0;
+    uint64_t streams_opened = 0;
+    size_t open_streams = 0;
+    uint64_t frames_received = 0;
+    uint64_t bytes_received = 0;
+    // Times a stream had data queued but no send window left.
+    uint64_t credit_stalls = 0;
+    // Sends refused because the stream's queue was full.
+    uint64_t refused = 0;
+    // Per priority: frames and bytes written, and the longest time a frame
+    // waited in its queue.
+    uint64_t frames_sent[kPriorities] = {};
+    uint64_t bytes_sent[kPriorities] = {};
+    int64_t max_wait_us[kPriorities] = {};
+  };
+
+  explicit MuxConnection(std::unique_ptr<MuxTransport> transport);
+  ~MuxConnection();
+
+  // Connects to |url| in the background and keeps reconnecting until Stop().
+  bool Start(const std::string& url);
+  void Stop();
+  bool started() const;
+  bool connected() const;
+  const std::string& url() const { return url_; }
+
+  // Called on the I/O thread when events arrive while none are waiting; the
+  // callee should arrange for TakeEvents() on the platform thread.
+  void SetEventCallback(std::function<void()> callback);
+
+  // Opens a stream with |open_json| as the Open payload. Returns its id, or 0
+  // when the connection is not started. A stream opened while disconnected
+  // is announced once the connection is up.
+  uint32_t OpenStream(const std::string& open_json, int priority);
+  // False when the stream is unknown or its queue is full; the caller drops
+  // the data or sends it another way.
+  bool SendText(uint32_t stream, const std::string& text);
+  bool SendAudio(uint32_t stream, uint8_t source, const uint8_t* data, size_t length);
+  // Sends Close after anything still queued on the stream.
+  void CloseStream(uint32_t stream, uint16_t code = 1000);
+
+  // Events since the last call. Text handed out here counts as consumed and
+  // returns send window to the server.
+  std::vector<Event> TakeEvents();
+
+  Stats stats() const;
+
+ private:
+  // Queued bytes beyond which Send* refuses: one window, e.g. 8 s of audio.
+  static constexpr size_t kMaxQueuedBytes = mux::kInitialWindow;
+
+  struct Pending {
+    std::vector<uint8_t> frame;
+    uint32_t cost = 0;  // Payload bytes counted against the window
+    int64_t queued_us = 0;
+  };
+
+  struct Stream {
+    int priority = 0;
+    std::deque<Pending> queue;
+    size_t queued_bytes = 0;
+    int64_t send_window = mux::kInitialWindow;
+    uint32_t consumed = 0;  // Received bytes not yet returned as credit
+    bool announced = false; // Open is out on the current connection
+    bool closing = false;   // CloseStream called; no more sends
+    bool stalled = false;   // Counted in credit_stalls
+  };
+
+  void IoThreadProc();
+  void WriterThreadProc();
+  void HandleFrame(const mux::Frame& frame);
+  // Picks the next frame to write and updates the window. Requires mutex_.
+  bool NextFrameLocked(std::vector<uint8_t>* frame, int* priority);
+  bool EnqueueLocked(uint32_t id, Pending pending);
+  void PushEventLocked(Event event, bool* notify);
+  // Fails every announced stream after the connection dropped. Requires mutex_.
+  void DropStreamsLocked(bool* notify);
+  void Notify(bool notify);
+
+  std::unique_ptr<MuxTransport> transport_;
+  std::string url_;
+  std::thread* io_thread_ = nullptr;
+  std::thread* writer_thread_ = nullptr;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  bool running_ = false;
+  bool connected_ = false;
+  uint32_t next_stream_ = 1;
+  std::map<uint32_t, Stream> streams_;
+  std::deque<std::vector<uint8_t>> control_;  // Credit frames
+  uint32_t last_sent_[kPriorities] = {};      // Round-robin position
+  std::vector<Event> events_;
+  std::function<void()> on_events_;
+  Stats stats_;
+  // Time each frame spent queued, per priority.
+  Histogram* queue_wait_us_[kPriorities] = {
+      Metrics().GetHistogram("mux.queue_wait_us.p0"),
+      Metrics().GetHistogram("mux.queue_wait_us.p1"),
+      Metrics().GetHistogram("mux.queue_wait_us.p2"),
+  };
+};
@@ -0,0 +1,80 @@
+#include "mux_protocol.h"
+
+#include <algorithm>
+
+namespace mux {
+
+namespace {
+
+static void PutU32(uint8_t* p, uint32_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+  p[2] = static_cast<uint8_t>(v >> 16);
+  p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+static uint32_t GetU32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static void PutHeader(FrameType type, uint32_t stream, size_t payload_length,
+                      std::vector<uint8_t>* out) {
+  out->resize(kHeaderBytes + payload_length);
+  (*out)[0] = type;
+  PutU32(out->data() + 1, stream);
+}
+
+}  // namespace
+
+void BuildFrame(FrameType type, uint32_t stream, const uint8_t* payload, size_t length,
+                std::vector<uint8_t>* out) {
+  PutHeader(type, stream, length, out);
+  if (length > 0) std::copy(payload, payload + length, out->begin() + kHeaderBytes);
+}
+
+void BuildAudioFrame(uint32_t stream, uint8_t source, const uint8_t* pcm, size_t length,
+                     std::vector<uint8_t>* out) {
+  PutHeader(kAudio, stream, 1 + length, out);
+  (*out)[kHeaderBytes] = source;
+  if (length > 0) std::copy(pcm, pcm + length, out->begin() + kHeaderBytes + 1);
+}
+
+void BuildCreditFrame(uint32_t stream, uint32_t bytes, std::vector<uint8_t>* out) {
+  PutHeader(kCredit, stream, 4, out);
+  PutU32(out->data() + kHeaderBytes, bytes);
+}
+
+void BuildCloseFrame(uint32_t stream, uint16_t code, const std::string& reason,
+                     std::vector<uint8_t>* out) {
+  PutHeader(kClose, stream, 2 + reason.size(), out);
+  (*out)[kHeaderBytes] = static_cast<uint8_t>(code);
+  (*out)[kHeaderBytes + 1] = static_cast<uint8_t>(code >> 8);
+  std::copy(reason.begin(), reason.end(), out->begin() + kHeaderBytes + 2);
+}
+
+bool ParseFrame(const uint8_t* data, size_t length, Frame* frame) {
+  if (!data || length < kHeaderBytes) return false;
+  if (data[0] < kOpen || data[0] > kClose) return false;
+  frame->type = static_cast<FrameType>(data[0]);
+  frame->stream = GetU32(data + 1);
+  frame->payload = data + kHeaderBytes;
+  frame->length = length - kHeaderBytes;
+  return frame->stream != 0;
+}
+
+bool ParseCredit(const Frame& frame, uint32_t* bytes) {
+  if (frame.type != kCredit || frame.length < 4) return false;
+  *bytes = GetU32(frame.payload);
+  return true;
+}
+
+void ParseClose(const Frame& frame, uint16_t* code, std::string* reason) {
+  *code = 1000;
+  reason->clear();
+  if (frame.length < 2) return;
+  *code = static_cast<uint16_t>(frame.payload[0] | (frame.payload[1] << 8));
+  reason->assign(reinterpret_cast<const char*>(frame.payload + 2), frame.length - 2);
+}
+
+}  // namespace mux
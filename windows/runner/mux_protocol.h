@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Wire format of the multiplexed server connection (see server/src/mux.ts for
+// the server side). Every WebSocket binary message is one frame; integers are
+// little-endian.
+//
+//   0  u8 type      Open, Text, Audio, Credit, Close
+//   1  u32 stream   chosen by the client when it opens the stream, never 0
+//   5  payload
+//
+//   Open    JSON {"kind": "listen" | "ai", ...}; other fields are the query
+//           parameters the stream's own endpoint takes (e.g. "priority")
+//   Text    one UTF-8 message, exactly as /listen or /ai would carry it
+//   Audio   u8 source (0 mic, 1 system) + 16kHz mono PCM16
+//   Credit  u32 bytes added to the receiver's send window for the stream
+//   Close   u16 code + UTF-8 reason; either side, ends the stream
+//
+// Flow control is per stream and direction: Text and Audio payload bytes use
+// up a window that starts at kInitialWindow, and the receiving side returns
+// credit as its reader consumes them. A stream whose reader stalls stops at
+// about one window of buffered data instead of queuing without bound, and
+// does not hold up the other streams on the connection.
+namespace mux {
+
+enum FrameType : uint8_t {
+  kOpen = 1,
+  kText = 2,
+  kAudio = 3,
+  kCredit = 4,
+  kClose = 5,
+};
+
+constexpr size_t kHeaderBytes = 5;
+constexpr uint32_t kInitialWindow = 256 * 1024;
+// Credit is returned once this much of the window has been consumed.
+constexpr uint32_t kCreditThreshold = kInitialWindow / 2;
+
+struct Frame {
+  FrameType type = kText;
+  uint32_t stream = 0;
+  const uint8_t* payload = nullptr;
+  size_t length = 0;
+};
+
+// Builds a frame into |out|.
+void BuildFrame(FrameType type, uint32_t stream, const uint8_t* payload, size_t length,
+                std::vector<uint8_t>* out);
+void BuildAudioFrame(uint32_t stream, uint8_t source, const uint8_t* pcm, size_t length,
+                     std::vector<uint8_t>* out);
+void BuildCreditFrame(uint32_t stream, uint32_t bytes, std::vector<uint8_t>* out);
+void BuildCloseFrame(uint32_t stream, uint16_t code, const std::string& reason,
+                     std::vector<uint8_t>* out);
+
+// Checks the header; |frame| points into |data|.
+bool ParseFrame(const uint8_t* data, size_t length, Frame* frame);
+// Credit frame payload; false when malformed.
+bool ParseCredit(const Frame& frame, uint32_t* bytes);
+// Close frame payload; a missing code reads as 1000.
+void ParseClose(const Frame& frame, uint16_t* code, std::string* reason);
+
+}  // namespace mux
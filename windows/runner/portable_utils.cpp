@@ -0,0 +1,25 @@
+#include "portable_utils.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+std::FILE* OpenUtf8File(const std::string& utf8_path, const char* mode) {
+#ifdef _WIN32
+  auto widen = [](const std::string& s) {
+    const int length = ::MultiByteToWideChar(CP_UTF8, 0, s.data(),
+                                             static_cast<int>(s.size()), nullptr, 0);
+    std::wstring out(length, L'\0');
+    ::MultiByteToWideChar(CP_UTF8, 0, s.data(), static_cast<int>(s.size()),
+                          out.data(), length);
+    return out;
+  };
+  std::FILE* file = nullptr;
+  if (_wfopen_s(&file, widen(utf8_path).c_str(), widen(mode).c_str()) != 0) {
+    return nullptr;
+  }
+  return file;
+#else
+  return std::fopen(utf8_path.c_str(), mode);
+#endif
+}
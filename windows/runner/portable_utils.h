@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+// Helpers for the sources shared with the Linux runner. utils.h needs
+// Flutter and Windows; these build everywhere.
+
+// Opens |utf8_path| with fopen semantics, accepting non-ASCII paths on Windows.
+std::FILE* OpenUtf8File(const std::string& utf8_path, const char* mode);
@@ -0,0 +1,85 @@
+#include "power_state.h"
+
+#include <iostream>
+
+bool PowerState::SetMinimized(bool minimized) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (snapshot_.minimized == minimized) return false;
+  snapshot_.minimized = minimized;
+  UpdateModeLocked();
+  return true;
+}
+
+bool PowerState::SetOccluded(bool occluded) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (snapshot_.occluded == occluded) return false;
+  snapshot_.occluded = occluded;
+  UpdateModeLocked();
+  return true;
+}
+
+bool PowerState::SetSessionIdle(bool idle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (snapshot_.session_idle == idle) return false;
+  snapshot_.session_idle = idle;
+  UpdateModeLocked();
+  return true;
+}
+
+bool PowerState::SetBattery(bool on_battery, int percent) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (snapshot_.on_battery == on_battery && snapshot_.battery_percent == percent) return false;
+  snapshot_.on_battery = on_battery;
+  snapshot_.battery_percent = percent;
+  UpdateModeLocked();
+  return true;
+}
+
+PowerState::Snapshot PowerState::snapshot() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return snapshot_;
+}
+
+int PowerState::DeliveryIntervalMs(PowerMode mode) {
+  switch (mode) {
+    case PowerMode::kBackground:
+      return 200;
+    case PowerMode::kSaver:
+      // Well inside the half second the system queue keeps at its floor.
+      return 400;
+    default:
+      return 0;
+  }
+}
+
+const char* PowerState::ModeName(PowerMode mode) {
+  switch (mode) {
+    case PowerMode::kBackground:
+      return "background";
+    case PowerMode::kSaver:
+      return "saver";
+    default:
+      return "interactive";
+  }
+}
+
+void PowerState::UpdateModeLocked() {
+  const bool hidden = snapshot_.minimized || snapshot_.occluded || snapshot_.session_idle;
+  const PowerMode mode = !hidden ? PowerMode::kInteractive
+                         : snapshot_.on_battery ? PowerMode::kSaver
+                                                : PowerMode::kBackground;
+  if (mode == snapshot_.mode) return;
+  snapshot_.mode = mode;
+  snapshot_.changes++;
+  mode_.store(mode, std::memory_order_relaxed);
+  mode_gauge_->Set(static_cast<int64_t>(mode));
+  change_count_->Add();
+  std::cout << "[PowerState] " << ModeName(mode) << " (minimized " << snapshot_.minimized
+            << ", occluded " << snapshot_.occluded << ", idle " << snapshot_.session_idle
+            << ", battery " << snapshot_.on_battery << ")" << std::endl;
+}
+
+PowerState& AppPowerState() {
+  static PowerState state;
+  return state;
+}
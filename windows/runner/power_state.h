@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "metrics.h"
+
+// Whether anyone can see the app and what it runs on, as the runner reports
+// it: the Win32 window messages or the GTK window and D-Bus signals. Native
+// components read mode() to decide how often to wake up.
+//
+// The window is hidden while it is minimized, fully covered or cloaked, or
+// while the session is locked, the display is off or the user is away. A
+// hidden app switches to a batched cadence: capture drains the endpoint
+// buffer on a timer instead of on every period, Dart pulls audio in larger
+// pieces, and work nobody looks at (the stall heartbeat, UI timers) slows
+// down or stops. The audio itself is unchanged, so transcripts are too;
+// only their latency grows. On battery the batches get longer still.
+//
+// Setters run on the platform thread; mode() may be read from any thread.
+enum class PowerMode {
+  kInteractive = 0,  // Visible: full rate
+  kBackground = 1,   // Hidden, on mains power
+  kSaver = 2,        // Hidden, on battery
+};
+
+class PowerState {
+ public:
+  struct Snapshot {
+    bool minimized = false;
+    bool occluded = false;      // Covered, cloaked or withdrawn
+    bool session_idle = false;  // Locked, display off or user away
+    bool on_battery = false;
+    int battery_percent = -1;   // -1 when unknown
+    PowerMode mode = PowerMode::kInteractive;
+    uint64_t changes = 0;       // Mode changes since start
+  };
+
+  // Each returns true when the snapshot changed, so the runner can tell Dart.
+  bool SetMinimized(bool minimized);
+  bool SetOccluded(bool occluded);
+  bool SetSessionIdle(bool idle);
+  bool SetBattery(bool on_battery, int percent);
+
+  Snapshot snapshot() const;
+  PowerMode mode() const { return mode_.load(std::memory_order_relaxed); }
+  bool hidden() const { return mode() != PowerMode::kInteractive; }
+
+  // How often audio is handed over in |mode|; 0 means as it arrives.
+  static int DeliveryIntervalMs(PowerMode mode);
+  static const char* ModeName(PowerMode mode);
+
+ private:
+  // Caller holds |mutex_| and has changed |snapshot_|.
+  void UpdateModeLocked();
+
+  mutable std::mutex mutex_;
+  Snapshot snapshot_;
+  std::atomic<PowerMode> mode_{PowerMode::kInteractive};
+  Gauge* mode_gauge_ = Metrics().GetGauge("power.mode");
+  Counter* change_count_ = Metrics().GetCounter("power.mode_changes");
+};
+
+// The power state of this process.
+PowerState& AppPowerState();
@@ -0,0 +1,221 @@
+#include "pprof_writer.h"
+
+#include <algorithm>
+#include <array>
+
+namespace pprof {
+
+namespace {
+
+// profile.proto field numbers.
+enum ProfileField {
+  kSampleType = 1,
+  kSample = 2,
+  kMapping = 3,
+  kLocation = 4,
+  kFunction = 5,
+  kStringTable = 6,
+  kTimeNanos = 9,
+  kDurationNanos = 10,
+  kPeriodType = 11,
+  kPeriod = 12,
+};
+
+static void PutVarint(std::string* out, uint64_t value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+static void PutTag(std::string* out, int field, int wire_type) {
+  PutVarint(out, (static_cast<uint64_t>(field) << 3) | static_cast<uint64_t>(wire_type));
+}
+
+// Zero values are left out, as proto3 does.
+static void PutInt(std::string* out, int field, uint64_t value) {
+  if (value == 0) return;
+  PutTag(out, field, 0);
+  PutVarint(out, value);
+}
+
+static void PutBytes(std::string* out, int field, const std::string& bytes) {
+  PutTag(out, field, 2);
+  PutVarint(out, bytes.size());
+  out->append(bytes);
+}
+
+static void PutPacked(std::string* out, int field, const std::vector<uint64_t>& values) {
+  if (values.empty()) return;
+  std::string packed;
+  for (const uint64_t value : values) PutVarint(&packed, value);
+  PutBytes(out, field, packed);
+}
+
+static std::string ValueType(int64_t type, int64_t unit) {
+  std::string out;
+  PutInt(&out, 1, static_cast<uint64_t>(type));
+  PutInt(&out, 2, static_cast<uint64_t>(unit));
+  return out;
+}
+
+static uint32_t Crc32(const std::string& data) {
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> entries = {};
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      entries[i] = c;
+    }
+    return entries;
+  }();
+  uint32_t crc = 0xffffffffu;
+  for (const char byte : data) {
+    crc = table[(crc ^ static_cast<uint8_t>(byte)) & 0xff] ^ (crc >> 8);
+  }
+  return crc ^ 0xffffffffu;
+}
+
+static void PutU32(std::string* out, uint32_t value) {
+  for (int i = 0; i < 4; i++) out->push_back(static_cast<char>(value >> (8 * i)));
+}
+
+}  // namespace
+
+ProfileBuilder::ProfileBuilder(int64_t period_ns, int64_t time_ns, int64_t duration_ns)
+    : period_ns_(period_ns), time_ns_(time_ns), duration_ns_(duration_ns) {
+  StringId("");  // Index 0 must be the empty string
+}
+
+int64_t ProfileBuilder::StringId(const std::string& text) {
+  auto it = string_ids_.find(text);
+  if (it != string_ids_.end()) return it->second;
+  const int64_t id = static_cast<int64_t>(strings_.size());
+  strings_.push_back(text);
+  string_ids_.emplace(text, id);
+  return id;
+}
+
+uint64_t ProfileBuilder::AddMapping(const Mapping& mapping) {
+  const uint64_t id = mappings_.size() + 1;
+  mappings_.emplace_back(id, mapping);
+  return id;
+}
+
+uint64_t ProfileBuilder::AddLocation(uint64_t address, uint64_t mapping_id,
+                                     const std::string& function, const std::string& file) {
+  auto it = locations_.find(address);
+  if (it != locations_.end()) return it->second.id;
+  Location location = {locations_.size() + 1, mapping_id, address, 0};
+  if (!function.empty()) {
+    const std::pair<int64_t, int64_t> key(StringId(function), StringId(file));
+    auto fn = functions_.find(key);
+    if (fn == functions_.end()) {
+      fn = functions_.emplace(key, Function{functions_.size() + 1, key.first, key.second}).first;
+    }
+    location.function_id = fn->second.id;
+  }
+  locations_.emplace(address, location);
+  return location.id;
+}
+
+void ProfileBuilder::AddSample(const std::vector<uint64_t>& location_ids, int64_t count,
+                               int64_t thread_id) {
+  samples_.push_back(Sample{location_ids, count, thread_id});
+}
+
+std::string ProfileBuilder::Serialize() {
+  const int64_t samples = StringId("samples");
+  const int64_t count = StringId("count");
+  const int64_t cpu = StringId("cpu");
+  const int64_t nanoseconds = StringId("nanoseconds");
+  const int64_t thread_id = StringId("thread_id");
+
+  std::string out;
+  PutBytes(&out, kSampleType, ValueType(samples, count));
+  PutBytes(&out, kSampleType, ValueType(cpu, nanoseconds));
+
+  for (const Sample& sample : samples_) {
+    std::string message;
+    PutPacked(&message, 1, sample.location_ids);
+    PutPacked(&message, 2,
+              {static_cast<uint64_t>(sample.count),
+               static_cast<uint64_t>(sample.count * period_ns_)});
+    std::string label;
+    PutInt(&label, 1, static_cast<uint64_t>(thread_id));
+    // Written even when 0, so the label is never empty.
+    PutTag(&label, 3, 0);
+    PutVarint(&label, static_cast<uint64_t>(sample.thread_id));
+    PutBytes(&message, 3, label);
+    PutBytes(&out, kSample, message);
+  }
+
+  for (const auto& entry : mappings_) {
+    const Mapping& mapping = entry.second;
+    std::string message;
+    PutInt(&message, 1, entry.first);
+    PutInt(&message, 2, mapping.start);
+    PutInt(&message, 3, mapping.limit);
+    PutInt(&message, 4, mapping.file_offset);
+    PutInt(&message, 5, static_cast<uint64_t>(StringId(mapping.file)));
+    PutInt(&message, 6, static_cast<uint64_t>(StringId(mapping.build_id)));
+    PutInt(&message, 7, mapping.has_functions ? 1 : 0);
+    PutBytes(&out, kMapping, message);
+  }
+
+  for (const auto& entry : locations_) {
+    const Location& location = entry.second;
+    std::string message;
+    PutInt(&message, 1, location.id);
+    PutInt(&message, 2, location.mapping_id);
+    PutInt(&message, 3, location.address);
+    if (location.function_id != 0) {
+      std::string line;
+      PutInt(&line, 1, location.function_id);
+      PutBytes(&message, 4, line);
+    }
+    PutBytes(&out, kLocation, message);
+  }
+
+  for (const auto& entry : functions_) {
+    const Function& function = entry.second;
+    std::string message;
+    PutInt(&message, 1, function.id);
+    PutInt(&message, 2, static_cast<uint64_t>(function.name));
+    PutInt(&message, 3, static_cast<uint64_t>(function.name));
+    PutInt(&message, 4, static_cast<uint64_t>(function.file));
+    PutBytes(&out, kFunction, message);
+  }
+
+  // Last, so every string above is in the table.
+  for (const std::string& text : strings_) PutBytes(&out, kStringTable, text);
+  PutInt(&out, kTimeNanos, static_cast<uint64_t>(time_ns_));
+  PutInt(&out, kDurationNanos, static_cast<uint64_t>(duration_ns_));
+  PutBytes(&out, kPeriodType, ValueType(cpu, nanoseconds));
+  PutInt(&out, kPeriod, static_cast<uint64_t>(period_ns_));
+  return out;
+}
+
+std::string Gzip(const std::string& data) {
+  constexpr size_t kMaxStoredBlock = 65535;
+  // Header: magic, deflate, no flags, no mtime, no extra flags, unknown OS.
+  std::string out("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff", 10);
+  size_t offset = 0;
+  do {
+    const size_t length = (std::min)(kMaxStoredBlock, data.size() - offset);
+    const bool last = offset + length == data.size();
+    out.push_back(static_cast<char>(last ? 1 : 0));  // BFINAL, BTYPE 00 (stored)
+    out.push_back(static_cast<char>(length & 0xff));
+    out.push_back(static_cast<char>(length >> 8));
+    out.push_back(static_cast<char>(~length & 0xff));
+    out.push_back(static_cast<char>((~length >> 8) & 0xff));
+    out.append(data, offset, length);
+    offset += length;
+  } while (offset < data.size());
+  PutU32(&out, Crc32(data));
+  PutU32(&out, static_cast<uint32_t>(data.size()));
+  return out;
+}
+
+}  // namespace pprof
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Encodes CPU samples as a pprof profile (profile.proto from
+// github.com/google/pprof), gzipped, so `pprof` and tools that read its
+// format open it directly.
+//
+// The profile has two sample types, samples/count and cpu/nanoseconds, and a
+// numeric "thread_id" label per sample. Locations carry the address and,
+// when it was resolved, one line naming the function; mappings carry the
+// module path and build id so pprof can symbolize the rest from binaries.
+namespace pprof {
+
+struct Mapping {
+  uint64_t start = 0;
+  uint64_t limit = 0;
+  uint64_t file_offset = 0;
+  std::string file;
+  std::string build_id;
+  bool has_functions = false;
+};
+
+class ProfileBuilder {
+ public:
+  ProfileBuilder(int64_t period_ns, int64_t time_ns, int64_t duration_ns);
+
+  // Returns the mapping's id.
+  uint64_t AddMapping(const Mapping& mapping);
+  // Returns the id of the location at |address|, adding it the first time.
+  // |mapping_id| may be 0 and |function| empty when unknown.
+  uint64_t AddLocation(uint64_t address, uint64_t mapping_id, const std::string& function,
+                       const std::string& file);
+  // |location_ids| leaf first.
+  void AddSample(const std::vector<uint64_t>& location_ids, int64_t count, int64_t thread_id);
+
+  // The serialized Profile message, not compressed. Adds the strings it needs
+  // to the table, so it is called once, after everything else.
+  std::string Serialize();
+
+ private:
+  int64_t StringId(const std::string& text);
+
+  struct Location {
+    uint64_t id;
+    uint64_t mapping_id;
+    uint64_t address;
+    uint64_t function_id;  // 0 when not symbolized
+  };
+  struct Sample {
+    std::vector<uint64_t> location_ids;
+    int64_t count;
+    int64_t thread_id;
+  };
+  struct Function {
+    uint64_t id;
+    int64_t name;
+    int64_t file;
+  };
+
+  int64_t period_ns_;
+  int64_t time_ns_;
+  int64_t duration_ns_;
+  std::vector<std::string> strings_;
+  std::map<std::string, int64_t> string_ids_;
+  std::vector<std::pair<uint64_t, Mapping>> mappings_;
+  std::map<uint64_t, Location> locations_;  // By address
+  std::map<std::pair<int64_t, int64_t>, Function> functions_;  // By (name, file)
+  std::vector<Sample> samples_;
+};
+
+// Wraps |data| in a gzip member using stored (uncompressed) deflate blocks:
+// valid for any gzip reader, and profiles are small enough that compressing
+// them is not worth carrying a deflate implementation.
+std::string Gzip(const std::string& data);
+
+}  // namespace pprof
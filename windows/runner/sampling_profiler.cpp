@@ -0,0 +1,757 @@
+#include "sampling_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include "audio_clock.h"
+#include "portable_utils.h"
+#include "pprof_writer.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <dbghelp.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+
+#pragma comment(lib, "dbghelp.lib")
+#pragma comment(lib, "psapi.lib")
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <link.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#endif
+
+namespace {
+
+constexpr int kMaxHz = 1000;
+constexpr int kMaxSeconds = 600;
+
+static int64_t WallNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// An executable image in the process, for mappings and build ids.
+struct Module {
+  uint64_t start = 0;
+  uint64_t limit = 0;
+  uint64_t file_offset = 0;
+  std::string file;
+  std::string build_id;
+};
+
+static const Module* FindModule(const std::vector<Module>& modules, uint64_t address) {
+  for (const Module& module : modules) {
+    if (address >= module.start && address < module.limit) return &module;
+  }
+  return nullptr;
+}
+
+#if defined(_WIN32)
+
+// Stacks deeper than this are not sampled; 1 MB is the default reservation.
+constexpr size_t kMaxStackCopy = 1024 * 1024;
+constexpr DWORD kThreadAccess =
+    THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION;
+
+struct SampledThread {
+  HANDLE handle = nullptr;
+  DWORD id = 0;
+  ULONG64 cycles = 0;
+  uintptr_t stack_base = 0;
+};
+
+static std::string ToUtf8(const std::wstring& wide) {
+  if (wide.empty()) return std::string();
+  const int length = WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), static_cast<int>(wide.size()),
+                                         nullptr, 0, nullptr, nullptr);
+  std::string utf8(length, '\0');
+  WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), static_cast<int>(wide.size()), &utf8[0],
+                      length, nullptr, nullptr);
+  return utf8;
+}
+
+// NT_TIB::StackBase from the thread's TEB.
+static uintptr_t StackBaseOf(HANDLE thread) {
+  struct ThreadBasicInformation {
+    LONG exit_status;
+    PVOID teb;
+    HANDLE process_id;
+    HANDLE thread_id;
+    ULONG_PTR affinity;
+    LONG priority;
+    LONG base_priority;
+  };
+  using QueryFn = LONG(WINAPI*)(HANDLE, int, PVOID, ULONG, PULONG);
+  static const QueryFn query = reinterpret_cast<QueryFn>(
+      GetProcAddress(GetModuleHandleW(L"ntdll.dll"), "NtQueryInformationThread"));
+  ThreadBasicInformation info = {};
+  if (!query || query(thread, 0, &info, sizeof(info), nullptr) != 0 || !info.teb) return 0;
+  return reinterpret_cast<uintptr_t>(static_cast<NT_TIB*>(info.teb)->StackBase);
+}
+
+// Keeps handles to the process's threads other than the caller, opening new
+// ones and closing those of threads that exited.
+static void RefreshThreads(std::vector<SampledThread>* threads) {
+  HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+  if (snapshot == INVALID_HANDLE_VALUE) return;
+  const DWORD process = GetCurrentProcessId();
+  const DWORD self = GetCurrentThreadId();
+  std::vector<SampledThread> current;
+  THREADENTRY32 entry = {};
+  entry.dwSize = sizeof(entry);
+  for (BOOL more = Thread32First(snapshot, &entry); more; more = Thread32Next(snapshot, &entry)) {
+    if (entry.th32OwnerProcessID != process || entry.th32ThreadID == self) continue;
+    auto known = std::find_if(threads->begin(), threads->end(), [&](const SampledThread& t) {
+      return t.id == entry.th32ThreadID;
+    });
+    if (known != threads->end()) {
+      current.push_back(*known);
+      known->handle = nullptr;
+      continue;
+    }
+    SampledThread thread;
+    thread.id = entry.th32ThreadID;
+    thread.handle = OpenThread(kThreadAccess, FALSE, thread.id);
+    if (!thread.handle) continue;
+    thread.stack_base = StackBaseOf(thread.handle);
+    QueryThreadCycleTime(thread.handle, &thread.cycles);
+    current.push_back(thread);
+  }
+  CloseHandle(snapshot);
+  for (const SampledThread& gone : *threads) {
+    if (gone.handle) CloseHandle(gone.handle);
+  }
+  threads->swap(current);
+}
+
+static uintptr_t StackPointer(const CONTEXT& context) {
+#if defined(_M_X64)
+  return static_cast<uintptr_t>(context.Rsp);
+#elif defined(_M_ARM64)
+  return static_cast<uintptr_t>(context.Sp);
+#else
+  return 0;
+#endif
+}
+
+// Copies |thread|'s registers and live stack. Between suspend and resume
+// nothing allocates or takes a lock: the thread may be holding one.
+static bool CaptureThread(const SampledThread& thread, CONTEXT* context, uint8_t* copy,
+                          size_t* copied, uintptr_t* stack_pointer) {
+  if (thread.stack_base == 0 || SuspendThread(thread.handle) == static_cast<DWORD>(-1)) {
+    return false;
+  }
+  bool ok = false;
+  context->ContextFlags = CONTEXT_FULL;
+  if (GetThreadContext(thread.handle, context)) {
+    const uintptr_t sp = StackPointer(*context);
+    if (sp != 0 && sp < thread.stack_base && thread.stack_base - sp <= kMaxStackCopy) {
+      *copied = thread.stack_base - sp;
+      *stack_pointer = sp;
+      std::memcpy(copy, reinterpret_cast<const void*>(sp), *copied);
+      ok = true;
+    }
+  }
+  ResumeThread(thread.handle);
+  return ok;
+}
+
+// The copy is unwound in place of the live stack, so values pointing into the
+// live stack (saved frame pointers, the stack pointer) move by the offset.
+static void RebaseOntoCopy(uintptr_t sp, size_t size, uint8_t* copy, CONTEXT* context) {
+  const uintptr_t high = sp + size;
+  const uintptr_t delta = reinterpret_cast<uintptr_t>(copy) - sp;  // Wraps as intended
+  auto rebase = [&](DWORD64* value) {
+    if (*value >= sp && *value < high) *value += delta;
+  };
+  for (size_t offset = 0; offset + sizeof(DWORD64) <= size; offset += sizeof(DWORD64)) {
+    DWORD64 value;
+    std::memcpy(&value, copy + offset, sizeof(value));
+    rebase(&value);
+    std::memcpy(copy + offset, &value, sizeof(value));
+  }
+#if defined(_M_X64)
+  for (DWORD64* reg : {&context->Rsp, &context->Rbp, &context->Rbx, &context->Rsi, &context->Rdi,
+                       &context->R12, &context->R13, &context->R14, &context->R15}) {
+    rebase(reg);
+  }
+#elif defined(_M_ARM64)
+  rebase(&context->Sp);
+  rebase(&context->Fp);
+#endif
+}
+
+// Walks the copied stack [low, high); returns the frame count, leaf first.
+static int Unwind(CONTEXT* context, uintptr_t low, uintptr_t high, uint64_t* frames) {
+  int depth = 0;
+#if defined(_M_X64)
+  while (depth < SamplingProfiler::kMaxFrames) {
+    frames[depth++] = context->Rip;
+    DWORD64 image_base = 0;
+    PRUNTIME_FUNCTION function = RtlLookupFunctionEntry(context->Rip, &image_base, nullptr);
+    if (function) {
+      PVOID handler_data = nullptr;
+      DWORD64 establisher = 0;
+      RtlVirtualUnwind(UNW_FLAG_NHANDLER, image_base, context->Rip, function, context,
+                       &handler_data, &establisher, nullptr);
+    } else {
+      // A leaf without unwind data: the return address is on top.
+      if (context->Rsp < low || context->Rsp + sizeof(DWORD64) > high) break;
+      std::memcpy(&context->Rip, reinterpret_cast<const void*>(context->Rsp), sizeof(DWORD64));
+      context->Rsp += sizeof(DWORD64);
+    }
+    if (context->Rip == 0 || context->Rsp < low || context->Rsp >= high) break;
+  }
+#elif defined(_M_ARM64)
+  // ARM64 Windows code always keeps the frame pointer chain.
+  frames[depth++] = context->Pc;
+  uintptr_t fp = static_cast<uintptr_t>(context->Fp);
+  while (depth < SamplingProfiler::kMaxFrames && fp >= low && fp + 16 <= high && fp % 8 == 0) {
+    uint64_t next[2];
+    std::memcpy(next, reinterpret_cast<const void*>(fp), sizeof(next));
+    if (next[1] == 0) break;
+    frames[depth++] = next[1];
+    if (next[0] <= fp) break;
+    fp = static_cast<uintptr_t>(next[0]);
+  }
+#else
+  (void)low;
+  (void)high;
+  frames[depth++] = static_cast<uint64_t>(StackPointer(*context));
+#endif
+  return depth;
+}
+
+// The PDB GUID and age from the image's CodeView record, as symbol servers
+// key them.
+static std::string PdbBuildId(const uint8_t* base) {
+  const auto* dos = reinterpret_cast<const IMAGE_DOS_HEADER*>(base);
+  if (dos->e_magic != IMAGE_DOS_SIGNATURE) return std::string();
+  const auto* nt = reinterpret_cast<const IMAGE_NT_HEADERS*>(base + dos->e_lfanew);
+  const IMAGE_DATA_DIRECTORY& directory =
+      nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_DEBUG];
+  const auto* entries =
+      reinterpret_cast<const IMAGE_DEBUG_DIRECTORY*>(base + directory.VirtualAddress);
+  const size_t count = directory.Size / sizeof(IMAGE_DEBUG_DIRECTORY);
+  for (size_t i = 0; directory.VirtualAddress != 0 && i < count; i++) {
+    if (entries[i].Type != IMAGE_DEBUG_TYPE_CODEVIEW || entries[i].AddressOfRawData == 0) {
+      continue;
+    }
+    const uint8_t* record = base + entries[i].AddressOfRawData;
+    if (std::memcmp(record, "RSDS", 4) != 0) continue;
+    GUID guid;
+    DWORD age;
+    std::memcpy(&guid, record + 4, sizeof(guid));
+    std::memcpy(&age, record + 4 + sizeof(guid), sizeof(age));
+    char id[64];
+    snprintf(id, sizeof(id), "%08lX%04X%04X%02X%02X%02X%02X%02X%02X%02X%02X%lX", guid.Data1,
+             guid.Data2, guid.Data3, guid.Data4[0], guid.Data4[1], guid.Data4[2], guid.Data4[3],
+             guid.Data4[4], guid.Data4[5], guid.Data4[6], guid.Data4[7], age);
+    return id;
+  }
+  return std::string();
+}
+
+static std::vector<Module> LoadedModules() {
+  std::vector<Module> modules;
+  HMODULE handles[1024];
+  DWORD needed = 0;
+  if (!EnumProcessModules(GetCurrentProcess(), handles, sizeof(handles), &needed)) return modules;
+  const size_t count = (std::min)(static_cast<size_t>(needed) / sizeof(HMODULE),
+                                  sizeof(handles) / sizeof(HMODULE));
+  for (size_t i = 0; i < count; i++) {
+    MODULEINFO info = {};
+    if (!GetModuleInformation(GetCurrentProcess(), handles[i], &info, sizeof(info))) continue;
+    wchar_t path[MAX_PATH];
+    const DWORD length = GetModuleFileNameW(handles[i], path, MAX_PATH);
+    Module module;
+    module.start = reinterpret_cast<uint64_t>(info.lpBaseOfDll);
+    module.limit = module.start + info.SizeOfImage;
+    module.file = ToUtf8(std::wstring(path, length));
+    module.build_id = PdbBuildId(static_cast<const uint8_t*>(info.lpBaseOfDll));
+    modules.push_back(module);
+  }
+  return modules;
+}
+
+// Function names through DbgHelp: from the PDB where one is found next to
+// the module, otherwise exports.
+class Symbolizer {
+ public:
+  Symbolizer() {
+    SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
+    ready_ = SymInitialize(GetCurrentProcess(), nullptr, TRUE) != FALSE;
+  }
+  ~Symbolizer() {
+    if (ready_) SymCleanup(GetCurrentProcess());
+  }
+  std::string Name(uint64_t address) {
+    if (!ready_) return std::string();
+    alignas(SYMBOL_INFO) char buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME];
+    auto* symbol = reinterpret_cast<SYMBOL_INFO*>(buffer);
+    std::memset(buffer, 0, sizeof(SYMBOL_INFO));
+    symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+    symbol->MaxNameLen = MAX_SYM_NAME;
+    DWORD64 displacement = 0;
+    if (!SymFromAddr(GetCurrentProcess(), address, &displacement, symbol)) return std::string();
+    return std::string(symbol->Name, symbol->NameLen);
+  }
+
+ private:
+  bool ready_ = false;
+};
+
+#else
+
+constexpr int kRingSlots = 1024;
+
+enum SlotState { kSlotEmpty = 0, kSlotWriting = 1, kSlotFull = 2 };
+
+struct RingSlot {
+  std::atomic<int> state{kSlotEmpty};
+  uint64_t thread_id = 0;
+  int depth = 0;
+  uint64_t frames[SamplingProfiler::kMaxFrames];
+};
+
+// Shared with the signal handler, which may run on any thread.
+std::atomic<RingSlot*> g_ring{nullptr};
+std::atomic<uint32_t> g_ring_next{0};
+std::atomic<uint64_t> g_ring_lost{0};
+std::atomic<int> g_in_handler{0};
+std::atomic<int64_t> g_handler_ns{0};
+
+// Whether SIGPROF runs someone else's handler, as it does while the Dart
+// VM's own profiler is on (debug and profile builds). Taking the signal
+// would break that profiler and feed it our timer's ticks.
+static bool RunsHandler(const struct sigaction& action) {
+  return (action.sa_flags & SA_SIGINFO) != 0 ||
+         (action.sa_handler != SIG_DFL && action.sa_handler != SIG_IGN);
+}
+
+static bool SigprofHandled() {
+  struct sigaction current = {};
+  return sigaction(SIGPROF, nullptr, &current) == 0 && RunsHandler(current);
+}
+
+static uint64_t InterruptedPc(void* ucontext) {
+#if defined(__x86_64__)
+  return static_cast<uint64_t>(static_cast<ucontext_t*>(ucontext)->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__aarch64__)
+  return static_cast<uint64_t>(static_cast<ucontext_t*>(ucontext)->uc_mcontext.pc);
+#else
+  (void)ucontext;
+  return 0;
+#endif
+}
+
+// Async-signal context: only atomics, the preallocated ring and backtrace(),
+// whose unwinder was loaded before the timer started.
+static void OnProfilingSignal(int, siginfo_t*, void* ucontext) {
+  const int saved_errno = errno;
+  g_in_handler.fetch_add(1);
+  RingSlot* ring = g_ring.load();
+  if (ring) {
+    const int64_t start_ns = SteadyNowNs();
+    RingSlot& slot = ring[g_ring_next.fetch_add(1, std::memory_order_relaxed) % kRingSlots];
+    int expected = kSlotEmpty;
+    if (slot.state.compare_exchange_strong(expected, kSlotWriting, std::memory_order_acquire)) {
+      void* raw[SamplingProfiler::kMaxFrames + 4];
+      const int count = backtrace(raw, SamplingProfiler::kMaxFrames + 4);
+      // Frames above the interrupted instruction are this handler and the
+      // signal trampoline.
+      const uint64_t pc = InterruptedPc(ucontext);
+      int first = 0;
+      while (first < count && reinterpret_cast<uint64_t>(raw[first]) != pc) first++;
+      int depth = 0;
+      if (first == count) {
+        slot.frames[depth++] = pc;
+        first = (std::min)(2, count);
+      }
+      for (int i = first; i < count && depth < SamplingProfiler::kMaxFrames; i++) {
+        slot.frames[depth++] = reinterpret_cast<uint64_t>(raw[i]);
+      }
+      slot.depth = depth;
+      slot.thread_id = static_cast<uint64_t>(syscall(SYS_gettid));
+      slot.state.store(kSlotFull, std::memory_order_release);
+    } else {
+      g_ring_lost.fetch_add(1, std::memory_order_relaxed);
+    }
+    g_handler_ns.fetch_add(SteadyNowNs() - start_ns, std::memory_order_relaxed);
+  }
+  g_in_handler.fetch_sub(1);
+  errno = saved_errno;
+}
+
+struct ModuleList {
+  std::vector<Module>* modules;
+};
+
+static std::string BuildIdOf(const dl_phdr_info* info) {
+  for (int i = 0; i < info->dlpi_phnum; i++) {
+    const ElfW(Phdr)& header = info->dlpi_phdr[i];
+    if (header.p_type != PT_NOTE) continue;
+    const uint8_t* note = reinterpret_cast<const uint8_t*>(info->dlpi_addr + header.p_vaddr);
+    const uint8_t* end = note + header.p_memsz;
+    while (note + sizeof(ElfW(Nhdr)) <= end) {
+      const auto* nhdr = reinterpret_cast<const ElfW(Nhdr)*>(note);
+      const uint8_t* name = note + sizeof(ElfW(Nhdr));
+      const uint8_t* desc = name + ((nhdr->n_namesz + 3) & ~3u);
+      if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 &&
+          std::memcmp(name, "GNU", 4) == 0) {
+        std::string id;
+        char hex[3];
+        for (uint32_t k = 0; k < nhdr->n_descsz; k++) {
+          snprintf(hex, sizeof(hex), "%02x", desc[k]);
+          id.append(hex);
+        }
+        return id;
+      }
+      note = desc + ((nhdr->n_descsz + 3) & ~3u);
+    }
+  }
+  return std::string();
+}
+
+static std::vector<Module> LoadedModules() {
+  std::vector<Module> modules;
+  dl_iterate_phdr(
+      [](dl_phdr_info* info, size_t, void* data) {
+        auto* out = static_cast<std::vector<Module>*>(data);
+        std::string file = info->dlpi_name ? info->dlpi_name : "";
+        if (file.empty()) {
+          char path[PATH_MAX];
+          const ssize_t length = readlink("/proc/self/exe", path, sizeof(path));
+          if (length > 0) file.assign(path, static_cast<size_t>(length));
+        }
+        const std::string build_id = BuildIdOf(info);
+        for (int i = 0; i < info->dlpi_phnum; i++) {
+          const ElfW(Phdr)& header = info->dlpi_phdr[i];
+          if (header.p_type != PT_LOAD || !(header.p_flags & PF_X)) continue;
+          Module module;
+          module.start = info->dlpi_addr + header.p_vaddr;
+          module.limit = module.start + header.p_memsz;
+          module.file_offset = header.p_offset;
+          module.file = file;
+          module.build_id = build_id;
+          out->push_back(module);
+        }
+        return 0;
+      },
+      &modules);
+  return modules;
+}
+
+// Names from the dynamic symbol table; pprof resolves the rest from the
+// binaries named in the mappings.
+class Symbolizer {
+ public:
+  std::string Name(uint64_t address) {
+    Dl_info info;
+    if (!dladdr(reinterpret_cast<void*>(address), &info) || !info.dli_sname) {
+      return std::string();
+    }
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    std::string name = status == 0 && demangled ? demangled : info.dli_sname;
+    std::free(demangled);
+    return name;
+  }
+};
+
+#endif
+
+}  // namespace
+
+SamplingProfiler::SamplingProfiler() {}
+
+SamplingProfiler::~SamplingProfiler() {
+  StopAndWait();
+}
+
+bool SamplingProfiler::Start(const std::string& path, int seconds, int hz) {
+  if (path.empty() || seconds <= 0 || hz <= 0) return false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (status_.running) return false;
+  }
+#if !defined(_WIN32)
+  if (SigprofHandled()) {
+    std::cerr << "[SamplingProfiler] SIGPROF has another handler (the Dart VM profiler?)"
+              << std::endl;
+    return false;
+  }
+#endif
+  // A finished window's thread has exited but is still joinable.
+  if (thread_) {
+    thread_->join();
+    delete thread_;
+    thread_ = nullptr;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = false;
+    status_ = Status();
+    status_.running = true;
+    status_.path = path;
+    status_.hz = (std::min)(hz, kMaxHz);
+  }
+  stacks_.clear();
+  thread_ = new std::thread(&SamplingProfiler::ThreadProc, this,
+                            static_cast<int64_t>((std::min)(seconds, kMaxSeconds)) * 1000);
+  return true;
+}
+
+void SamplingProfiler::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+}
+
+void SamplingProfiler::StopAndWait() {
+  Stop();
+  if (thread_) {
+    thread_->join();
+    delete thread_;
+    thread_ = nullptr;
+  }
+}
+
+SamplingProfiler::Status SamplingProfiler::status() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return status_;
+}
+
+bool SamplingProfiler::WaitForStop(int64_t ms) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return wake_.wait_for(lock, std::chrono::milliseconds((std::max)(int64_t{0}, ms)),
+                        [this] { return stop_; });
+}
+
+void SamplingProfiler::ThreadProc(int64_t window_ms) {
+  const int64_t start_ns = WallNowNs();
+  const int64_t start_ms = SteadyNowMs();
+  std::cout << "[SamplingProfiler] Profiling for " << window_ms / 1000 << " s" << std::endl;
+  SampleUntil(start_ms + window_ms);
+  const bool written = WriteProfile(start_ns, (SteadyNowMs() - start_ms) * 1000000);
+  std::lock_guard<std::mutex> lock(mutex_);
+  status_.running = false;
+  status_.written = written;
+  std::cout << "[SamplingProfiler] " << status_.samples << " samples ("
+            << status_.lost << " lost, " << status_.sampling_us / 1000 << " ms sampling)"
+            << (written ? " written to " + status_.path : std::string(", not written"))
+            << std::endl;
+}
+
+void SamplingProfiler::AddSample(uint64_t thread_id, const uint64_t* frames, int depth) {
+  if (depth <= 0) return;
+  StackKey key;
+  key.thread_id = thread_id;
+  key.frames.assign(frames, frames + depth);
+  stacks_[key]++;
+  std::lock_guard<std::mutex> lock(mutex_);
+  status_.samples++;
+}
+
+#if defined(_WIN32)
+
+void SamplingProfiler::SampleUntil(int64_t deadline_ms) {
+  const int64_t interval_us = 1000000 / status().hz;
+  // High resolution needs Windows 10 1803; before that ticks round up to the
+  // scheduler's period.
+  HANDLE timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                        TIMER_ALL_ACCESS);
+  if (!timer) timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+  if (!timer) {
+    std::cerr << "[SamplingProfiler] No timer: " << GetLastError() << std::endl;
+    return;
+  }
+  std::vector<SampledThread> threads;
+  std::unique_ptr<uint8_t[]> copy(new uint8_t[kMaxStackCopy]);
+  uint64_t frames[kMaxFrames];
+  int64_t next_refresh_ms = 0;
+  LARGE_INTEGER due;
+  due.QuadPart = -interval_us * 10;  // Relative, in 100 ns units
+
+  while (SteadyNowMs() < deadline_ms) {
+    SetWaitableTimer(timer, &due, 0, nullptr, nullptr, FALSE);
+    WaitForSingleObject(timer, INFINITE);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stop_) break;
+    }
+    const int64_t tick_us = SteadyNowUs();
+    if (tick_us / 1000 >= next_refresh_ms) {
+      RefreshThreads(&threads);
+      next_refresh_ms = tick_us / 1000 + 1000;
+    }
+    uint64_t lost = 0;
+    for (SampledThread& thread : threads) {
+      // Only threads that ran since the last tick: this is a CPU profile.
+      ULONG64 cycles = 0;
+      if (!QueryThreadCycleTime(thread.handle, &cycles) || cycles == thread.cycles) continue;
+      thread.cycles = cycles;
+      CONTEXT context;
+      size_t copied = 0;
+      uintptr_t sp = 0;
+      if (!CaptureThread(thread, &context, copy.get(), &copied, &sp)) {
+        lost++;
+        continue;
+      }
+      RebaseOntoCopy(sp, copied, copy.get(), &context);
+      const uintptr_t low = reinterpret_cast<uintptr_t>(copy.get());
+      AddSample(thread.id, frames, Unwind(&context, low, low + copied, frames));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_.lost += lost;
+    status_.sampling_us += SteadyNowUs() - tick_us;
+  }
+
+  for (const SampledThread& thread : threads) CloseHandle(thread.handle);
+  CloseHandle(timer);
+}
+
+#else
+
+void SamplingProfiler::SampleUntil(int64_t deadline_ms) {
+  std::unique_ptr<RingSlot[]> ring(new RingSlot[kRingSlots]);
+  RingSlot* expected = nullptr;
+  if (!g_ring.compare_exchange_strong(expected, ring.get())) {
+    std::cerr << "[SamplingProfiler] Another profiler owns SIGPROF" << std::endl;
+    return;
+  }
+  // backtrace() loads its unwinder on first use, which the handler must not.
+  void* warm[1];
+  backtrace(warm, 1);
+  g_handler_ns = 0;
+  g_ring_lost = 0;
+
+  struct sigaction action = {};
+  struct sigaction previous = {};
+  action.sa_sigaction = OnProfilingSignal;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGPROF, &action, &previous);
+  if (RunsHandler(previous)) {
+    // Installed since Start() looked.
+    sigaction(SIGPROF, &previous, nullptr);
+    g_ring.store(nullptr);
+    std::cerr << "[SamplingProfiler] SIGPROF has another handler" << std::endl;
+    return;
+  }
+  const int64_t interval_us = 1000000 / status().hz;
+  itimerval timer = {};
+  timer.it_interval.tv_sec = static_cast<time_t>(interval_us / 1000000);
+  timer.it_interval.tv_usec = static_cast<suseconds_t>(interval_us % 1000000);
+  timer.it_value = timer.it_interval;
+  setitimer(ITIMER_PROF, &timer, nullptr);
+
+  auto drain = [&] {
+    for (int i = 0; i < kRingSlots; i++) {
+      RingSlot& slot = ring[i];
+      if (slot.state.load(std::memory_order_acquire) != kSlotFull) continue;
+      AddSample(slot.thread_id, slot.frames, slot.depth);
+      slot.state.store(kSlotEmpty, std::memory_order_release);
+    }
+  };
+  // 1024 slots drained every 50 ms hold bursts from many busy threads.
+  while (!WaitForStop((std::min)(int64_t{50}, deadline_ms - SteadyNowMs()))) {
+    drain();
+    if (SteadyNowMs() >= deadline_ms) break;
+  }
+
+  const itimerval off = {};
+  setitimer(ITIMER_PROF, &off, nullptr);
+  // The timer is off, but a SIGPROF it sent may still be pending for the
+  // process, and the default action exits. Blocked here, it can be taken
+  // before the previous action is back; a thread it was already delivered
+  // to runs our handler.
+  sigset_t sigprof;
+  sigemptyset(&sigprof);
+  sigaddset(&sigprof, SIGPROF);
+  sigset_t mask;
+  pthread_sigmask(SIG_BLOCK, &sigprof, &mask);
+  const timespec no_wait = {};
+  while (sigtimedwait(&sigprof, nullptr, &no_wait) == SIGPROF) {
+  }
+  sigaction(SIGPROF, &previous, nullptr);
+  pthread_sigmask(SIG_SETMASK, &mask, nullptr);
+  g_ring.store(nullptr);
+  // A handler that saw the ring before it was cleared may still be writing.
+  while (g_in_handler.load() != 0) std::this_thread::yield();
+  drain();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  status_.lost += g_ring_lost.exchange(0);
+  status_.sampling_us += g_handler_ns.exchange(0) / 1000;
+}
+
+#endif
+
+bool SamplingProfiler::WriteProfile(int64_t start_ns, int64_t duration_ns) {
+  const Status status = this->status();
+  pprof::ProfileBuilder builder(1000000000LL / status.hz, start_ns, duration_ns);
+  const std::vector<Module> modules = LoadedModules();
+  std::map<const Module*, uint64_t> mapping_ids;
+  Symbolizer symbolizer;
+  std::vector<uint64_t> location_ids;
+
+  for (const auto& entry : stacks_) {
+    location_ids.clear();
+    for (size_t i = 0; i < entry.first.frames.size(); i++) {
+      // Callers are return addresses; one byte back is inside the call.
+      const uint64_t address = entry.first.frames[i] - (i > 0 ? 1 : 0);
+      const Module* module = FindModule(modules, address);
+      uint64_t mapping_id = 0;
+      if (module) {
+        auto it = mapping_ids.find(module);
+        if (it == mapping_ids.end()) {
+          pprof::Mapping mapping;
+          mapping.start = module->start;
+          mapping.limit = module->limit;
+          mapping.file_offset = module->file_offset;
+          mapping.file = module->file;
+          mapping.build_id = module->build_id;
+          it = mapping_ids.emplace(module, builder.AddMapping(mapping)).first;
+        }
+        mapping_id = it->second;
+      }
+      location_ids.push_back(builder.AddLocation(address, mapping_id, symbolizer.Name(address),
+                                                 module ? module->file : std::string()));
+    }
+    builder.AddSample(location_ids, static_cast<int64_t>(entry.second),
+                      static_cast<int64_t>(entry.first.thread_id));
+  }
+
+  const std::string data = pprof::Gzip(builder.Serialize());
+  std::FILE* file = OpenUtf8File(status.path, "wb");
+  if (!file) {
+    std::cerr << "[SamplingProfiler] Cannot write " << status.path << std::endl;
+    return false;
+  }
+  const bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+  return std::fclose(file) == 0 && ok;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Opt-in, in-process CPU profiler for diagnosing a user's machine without
+// attaching an external one. For a fixed window it samples the stacks of
+// threads that are using CPU, then writes a gzipped pprof profile
+// (pprof_writer.h) and stops.
+//
+// Windows: a sampler thread wakes |hz| times a second, and for each thread
+// whose cycle count moved since the last tick suspends it, copies its
+// context and the live part of its stack, resumes it, and unwinds the copy
+// afterwards. Nothing that could take a lock runs while a thread is
+// suspended, so a thread holding the heap or loader lock cannot stall it.
+//
+// Linux: ITIMER_PROF delivers SIGPROF per |hz| of process CPU time to the
+// running thread, whose handler records its stack into a preallocated ring
+// that the profiler thread drains. SIGPROF must be free: while the Dart VM's
+// profiler handles it, Start() fails.
+//
+// Addresses are only resolved when the profile is written: function names
+// where the platform has them (DbgHelp with the PDB, or dladdr), and module
+// mappings with build ids for everything else, so pprof can symbolize from
+// the binaries later.
+class SamplingProfiler {
+ public:
+  static constexpr int kMaxFrames = 64;
+
+  struct Status {
+    bool running = false;
+    bool written = false;  // The last window's profile is at |path|
+    std::string path;
+    int hz = 0;
+    uint64_t samples = 0;
+    // Samples not taken: ring full, or a thread that could not be read.
+    uint64_t lost = 0;
+    // Time the sampler spent taking samples, to judge its overhead.
+    int64_t sampling_us = 0;
+  };
+
+  SamplingProfiler();
+  ~SamplingProfiler();
+
+  // Profiles for |seconds| (at most 600) at |hz| (at most 1000), then writes
+  // the profile to |path|. False when a window is already running (or still
+  // being written), an argument is not positive or SIGPROF is taken;
+  // status() tells whether the profile was written.
+  bool Start(const std::string& path, int seconds, int hz);
+  // Ends the window early and returns at once. The profiler thread still
+  // symbolizes and writes what was collected; status().running stays true
+  // until it has.
+  void Stop();
+  // Stop(), then waits for the profile to be written (at shutdown).
+  void StopAndWait();
+  Status status() const;
+
+ private:
+  struct StackKey {
+    uint64_t thread_id;
+    std::vector<uint64_t> frames;  // Leaf first
+    bool operator<(const StackKey& other) const {
+      return thread_id != other.thread_id ? thread_id < other.thread_id
+                                          : frames < other.frames;
+    }
+  };
+
+  void ThreadProc(int64_t window_ms);
+  // Platform sampling loop; returns when the window ends or Stop() is called.
+  void SampleUntil(int64_t deadline_ms);
+  void AddSample(uint64_t thread_id, const uint64_t* frames, int depth);
+  bool WriteProfile(int64_t start_ns, int64_t duration_ns);
+  // Waits up to |ms| for Stop(); true once stopping.
+  bool WaitForStop(int64_t ms);
+
+  std::thread* thread_ = nullptr;
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+  Status status_;
+  std::map<StackKey, uint64_t> stacks_;  // Profiler thread only
+};
@@ -0,0 +1,270 @@
+#include "session_capture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+#include "audio_clock.h"
+#include "portable_utils.h"
+
+namespace {
+
+using namespace session_capture;
+
+static void Put16(uint8_t* p, uint16_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+static void Put32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; i++) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+static void Put64(uint8_t* p, uint64_t v) {
+  for (int i = 0; i < 8; i++) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+static uint16_t Get16(const uint8_t* p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t Get32(const uint8_t* p) {
+  uint32_t v = 0;
+  for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+static uint64_t Get64(const uint8_t* p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+static bool SeekTo(std::FILE* file, uint64_t offset) {
+#ifdef _WIN32
+  return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+static uint64_t FileSize(std::FILE* file) {
+#ifdef _WIN32
+  _fseeki64(file, 0, SEEK_END);
+  return static_cast<uint64_t>(_ftelli64(file));
+#else
+  fseeko(file, 0, SEEK_END);
+  return static_cast<uint64_t>(ftello(file));
+#endif
+}
+
+}  // namespace
+
+SessionRecorder::~SessionRecorder() {
+  Close();
+}
+
+bool SessionRecorder::Open(const std::string& utf8_path, uint64_t start_unix_ms) {
+  Close();
+  file_ = OpenUtf8File(utf8_path, "wb");
+  if (!file_) return false;
+
+  uint8_t header[kHeaderBytes];
+  std::memcpy(header, "HNSC", 4);
+  Put16(header + 4, kVersion);
+  Put16(header + 6, 0);
+  Put64(header + 8, start_unix_ms);
+  std::fwrite(header, 1, sizeof(header), file_);
+
+  start_us_ = SteadyNowUs();
+  offset_ = kHeaderBytes;
+  records_ = 0;
+  dropped_ = 0;
+  last_us_ = 0;
+  next_index_us_ = 0;
+  index_.clear();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = false;
+    queue_.clear();
+  }
+  writer_ = new std::thread(&SessionRecorder::WriterProc, this);
+  return true;
+}
+
+void SessionRecorder::Close() {
+  if (!file_) return;
+
+  // The writer drains the queue before it exits.
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  if (writer_) {
+    writer_->join();
+    delete writer_;
+    writer_ = nullptr;
+  }
+
+  const uint64_t index_offset = offset_;
+  uint8_t entry[16];
+  for (const auto& [t_us, offset] : index_) {
+    Put64(entry, t_us);
+    Put64(entry + 8, offset);
+    std::fwrite(entry, 1, sizeof(entry), file_);
+  }
+  uint8_t trailer[kTrailerBytes];
+  Put64(trailer, index_offset);
+  Put32(trailer + 8, static_cast<uint32_t>(index_.size()));
+  std::memcpy(trailer + 12, "HNSI", 4);
+  std::fwrite(trailer, 1, sizeof(trailer), file_);
+
+  std::fclose(file_);
+  file_ = nullptr;
+  if (dropped_ > 0) {
+    std::cerr << "[SessionRecorder] Dropped " << dropped_
+              << " records while the disk was behind" << std::endl;
+  }
+}
+
+void SessionRecorder::WriteAudio(session_capture::Stream stream,
+                                 const uint8_t* data,
+                                 size_t length) {
+  Write(kAudio, stream, data, length);
+}
+
+void SessionRecorder::WriteMessage(const std::string& text) {
+  Write(kMessage, kMic, reinterpret_cast<const uint8_t*>(text.data()), text.size());
+}
+
+void SessionRecorder::Write(session_capture::RecordType type,
+                            session_capture::Stream stream,
+                            const uint8_t* data,
+                            size_t length) {
+  if (!file_ || length > UINT32_MAX) return;
+
+  // Records stay in time order even if the clock is read out of order.
+  const uint64_t t_us =
+      (std::max)(last_us_, static_cast<uint64_t>((std::max)(int64_t{0}, SteadyNowUs() - start_us_)));
+
+  uint8_t header[kRecordHeaderBytes];
+  header[0] = type;
+  header[1] = stream;
+  Put16(header + 2, 0);
+  Put32(header + 4, static_cast<uint32_t>(length));
+  Put64(header + 8, t_us);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Skipping a whole record keeps the file readable; the index below only
+    // ever points at records that were queued.
+    if (queue_.size() + sizeof(header) + length > kMaxQueuedBytes) {
+      dropped_++;
+      return;
+    }
+    queue_.insert(queue_.end(), header, header + sizeof(header));
+    if (length > 0) queue_.insert(queue_.end(), data, data + length);
+  }
+  wake_.notify_one();
+
+  if (t_us >= next_index_us_) {
+    index_.emplace_back(t_us, offset_);
+    next_index_us_ = (t_us / kIndexIntervalUs + 1) * kIndexIntervalUs;
+  }
+  offset_ += kRecordHeaderBytes + length;
+  records_++;
+  last_us_ = t_us;
+}
+
+void SessionRecorder::WriterProc() {
+  std::vector<uint8_t> batch;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wake_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) break;  // Stopped and drained
+    batch.swap(queue_);
+    lock.unlock();
+    std::fwrite(batch.data(), 1, batch.size(), file_);
+    batch.clear();
+    lock.lock();
+  }
+}
+
+SessionReader::~SessionReader() {
+  Close();
+}
+
+void SessionReader::Close() {
+  if (file_) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+  index_.clear();
+}
+
+bool SessionReader::Open(const std::string& utf8_path) {
+  Close();
+  file_ = OpenUtf8File(utf8_path, "rb");
+  if (!file_) return false;
+
+  uint8_t header[kHeaderBytes];
+  if (std::fread(header, 1, sizeof(header), file_) != sizeof(header) ||
+      std::memcmp(header, "HNSC", 4) != 0 || Get16(header + 4) != kVersion) {
+    Close();
+    return false;
+  }
+  start_unix_ms_ = Get64(header + 8);
+
+  // Use the index when the trailer is intact.
+  const uint64_t size = FileSize(file_);
+  records_end_ = size;
+  uint8_t trailer[kTrailerBytes];
+  if (size >= kHeaderBytes + kTrailerBytes && SeekTo(file_, size - kTrailerBytes) &&
+      std::fread(trailer, 1, sizeof(trailer), file_) == sizeof(trailer) &&
+      std::memcmp(trailer + 12, "HNSI", 4) == 0) {
+    const uint64_t index_offset = Get64(trailer);
+    const uint32_t count = Get32(trailer + 8);
+    if (index_offset + static_cast<uint64_t>(count) * 16 + kTrailerBytes == size &&
+        SeekTo(file_, index_offset)) {
+      index_.reserve(count);
+      uint8_t entry[16];
+      for (uint32_t i = 0; i < count; i++) {
+        if (std::fread(entry, 1, sizeof(entry), file_) != sizeof(entry)) break;
+        index_.emplace_back(Get64(entry), Get64(entry + 8));
+      }
+      records_end_ = index_offset;
+    }
+  }
+  return Seek(0);
+}
+
+bool SessionReader::Seek(uint64_t t_us) {
+  if (!file_) return false;
+  uint64_t offset = kHeaderBytes;
+  auto it = std::upper_bound(
+      index_.begin(), index_.end(), t_us,
+      [](uint64_t t, const std::pair<uint64_t, uint64_t>& e) { return t < e.first; });
+  if (it != index_.begin()) offset = std::prev(it)->second;
+  offset_ = offset;
+  return SeekTo(file_, offset);
+}
+
+bool SessionReader::Next(session_capture::Record* record) {
+  if (!file_ || offset_ + kRecordHeaderBytes > records_end_) return false;
+
+  uint8_t header[kRecordHeaderBytes];
+  if (std::fread(header, 1, sizeof(header), file_) != sizeof(header)) return false;
+  const uint32_t length = Get32(header + 4);
+  if (offset_ + kRecordHeaderBytes + length > records_end_) return false;
+
+  record->type = static_cast<RecordType>(header[0]);
+  record->stream = static_cast<Stream>(header[1]);
+  record->t_us = Get64(header + 8);
+  record->payload.resize(length);
+  if (length > 0 && std::fread(record->payload.data(), 1, length, file_) != length) {
+    return false;
+  }
+  offset_ += kRecordHeaderBytes + length;
+  return true;
+}
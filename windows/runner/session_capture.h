@@ -0,0 +1,116 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Session capture files ("HNSC"): everything the app received during a
+// meeting, so the same load can be replayed while profiling.
+//
+//   header   "HNSC" u16:version=1 u16:reserved u64:start_unix_ms
+//   record   u8:type u8:stream u16:reserved u32:length u64:t_us payload
+//   index    { u64:t_us u64:offset } per second of capture
+//   trailer  u64:index_offset u32:index_count "HNSI"
+//
+// All integers are little-endian. |t_us| is relative to the start of the
+// capture. Audio payloads are 16kHz mono PCM16 (stream 0 mic, 1 system);
+// message payloads are downlink WebSocket messages as received (UTF-8).
+// The index and trailer are written by Close(); a file cut short by a crash
+// is still readable front to back.
+namespace session_capture {
+
+enum RecordType : uint8_t { kAudio = 1, kMessage = 2 };
+enum Stream : uint8_t { kMic = 0, kSystem = 1 };
+
+constexpr uint16_t kVersion = 1;
+constexpr size_t kHeaderBytes = 16;
+constexpr size_t kRecordHeaderBytes = 16;
+constexpr size_t kTrailerBytes = 16;
+constexpr uint64_t kIndexIntervalUs = 1000000;
+
+struct Record {
+  RecordType type = kAudio;
+  Stream stream = kMic;
+  uint64_t t_us = 0;
+  std::vector<uint8_t> payload;
+};
+
+}  // namespace session_capture
+
+// Appends records to a capture file. Called from the platform thread only:
+// records are stamped and queued there, and a writer thread does the file
+// I/O so a slow disk never stalls a channel handler.
+class SessionRecorder {
+ public:
+  ~SessionRecorder();
+
+  bool Open(const std::string& utf8_path, uint64_t start_unix_ms);
+  // Flushes the queue, writes the index and trailer and closes the file.
+  void Close();
+  bool active() const { return file_ != nullptr; }
+
+  void WriteAudio(session_capture::Stream stream, const uint8_t* data, size_t length);
+  void WriteMessage(const std::string& text);
+
+  uint64_t records() const { return records_; }
+  uint64_t bytes_written() const { return offset_; }
+  uint64_t duration_us() const { return last_us_; }
+  // Records dropped because the writer fell more than kMaxQueuedBytes behind.
+  uint64_t dropped() const { return dropped_; }
+
+ private:
+  static constexpr size_t kMaxQueuedBytes = 16 * 1024 * 1024;
+
+  void Write(session_capture::RecordType type,
+             session_capture::Stream stream,
+             const uint8_t* data,
+             size_t length);
+  void WriterProc();
+
+  std::FILE* file_ = nullptr;
+  std::thread* writer_ = nullptr;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;             // Guarded by |mutex_|
+  std::vector<uint8_t> queue_;    // Guarded by |mutex_|; encoded records
+
+  // Platform thread: the file layout as queued, so offsets and the index
+  // are known without waiting for the writer.
+  int64_t start_us_ = 0;
+  uint64_t offset_ = 0;
+  uint64_t records_ = 0;
+  uint64_t dropped_ = 0;
+  uint64_t last_us_ = 0;
+  uint64_t next_index_us_ = 0;
+  std::vector<std::pair<uint64_t, uint64_t>> index_;
+};
+
+// Sequential reader with index-based seeking.
+class SessionReader {
+ public:
+  ~SessionReader();
+
+  bool Open(const std::string& utf8_path);
+  void Close();
+
+  // Positions the reader at the first indexed record at or before |t_us|
+  // (the start of the file without an index).
+  bool Seek(uint64_t t_us);
+  // Reads the next record; false at the end of the records.
+  bool Next(session_capture::Record* record);
+
+  uint64_t start_unix_ms() const { return start_unix_ms_; }
+  bool has_index() const { return !index_.empty(); }
+
+ private:
+  std::FILE* file_ = nullptr;
+  uint64_t start_unix_ms_ = 0;
+  uint64_t records_end_ = 0;  // Offset of the index, or the file size
+  uint64_t offset_ = 0;
+  std::vector<std::pair<uint64_t, uint64_t>> index_;
+};
@@ -0,0 +1,108 @@
+#include "session_replayer.h"
+
+#include <algorithm>
+
+#include "audio_clock.h"
+
+namespace {
+
+// In as-fast-as-possible mode each Advance() releases at most this much
+// capture time, so one poll never has to carry minutes of audio.
+constexpr uint64_t kUnpacedStepUs = 500000;
+
+}  // namespace
+
+SessionReplayer::SessionReplayer(MemoryGovernor* governor) {
+  system_pool_.SetShrinkCallback([this](size_t limit) { TrimSystem(limit); });
+  system_pool_.Attach(governor);
+}
+
+bool SessionReplayer::Start(const std::string& utf8_path, double speed, uint64_t start_ms) {
+  Stop();
+  if (!reader_.Open(utf8_path)) return false;
+
+  media_start_us_ = start_ms * 1000;
+  if (media_start_us_ > 0) reader_.Seek(media_start_us_);
+  media_pos_us_ = media_start_us_;
+  wall_start_us_ = SteadyNowUs();
+  speed_ = speed;
+  eof_ = false;
+  has_pending_ = false;
+  active_ = true;
+  return true;
+}
+
+void SessionReplayer::Stop() {
+  reader_.Close();
+  active_ = false;
+  mic_.clear();
+  messages_.clear();
+  system_.clear();
+  system_pool_.Reserve(0);
+}
+
+void SessionReplayer::Advance() {
+  if (!active_ || eof_) return;
+
+  if (speed_ > 0) {
+    const double elapsed = static_cast<double>(SteadyNowUs() - wall_start_us_);
+    media_pos_us_ = media_start_us_ + static_cast<uint64_t>(elapsed * speed_);
+  } else {
+    media_pos_us_ += kUnpacedStepUs;
+  }
+
+  while (true) {
+    if (!has_pending_) {
+      if (!reader_.Next(&pending_)) {
+        eof_ = true;
+        return;
+      }
+      has_pending_ = true;
+    }
+    // Records before a seek point are skipped, later ones wait their turn.
+    if (pending_.t_us < media_start_us_) {
+      has_pending_ = false;
+      continue;
+    }
+    if (pending_.t_us > media_pos_us_) return;
+
+    if (pending_.type == session_capture::kMessage) {
+      messages_.emplace_back(pending_.payload.begin(), pending_.payload.end());
+    } else if (pending_.stream == session_capture::kSystem) {
+      system_.insert(system_.end(), pending_.payload.begin(), pending_.payload.end());
+      // Paced replay drops like live capture; unpaced replay waits instead,
+      // unless the memory budget refuses to hold more.
+      const size_t wanted = speed_ > 0 ? (std::min)(system_pool_.limit(), system_.size())
+                                       : system_.size();
+      TrimSystem(system_pool_.Reserve(wanted) ? wanted : system_pool_.used());
+    } else {
+      mic_.insert(mic_.end(), pending_.payload.begin(), pending_.payload.end());
+    }
+    has_pending_ = false;
+  }
+}
+
+SessionReplayer::Batch SessionReplayer::Poll() {
+  if (speed_ > 0 || system_.size() < system_pool_.limit() / 2) Advance();
+  Batch batch;
+  batch.mic.swap(mic_);
+  batch.messages.swap(messages_);
+  batch.done = !active_ || (eof_ && system_.empty());
+  return batch;
+}
+
+std::vector<uint8_t> SessionReplayer::TakeSystemAudio(size_t requested_bytes) {
+  if (speed_ > 0) Advance();
+  const size_t n = (std::min)(requested_bytes, system_.size());
+  std::vector<uint8_t> out(system_.begin(), system_.begin() + n);
+  system_.erase(system_.begin(), system_.begin() + n);
+  system_pool_.Reserve(system_.size());
+  return out;
+}
+
+void SessionReplayer::TrimSystem(size_t max_bytes) {
+  if (system_.size() > max_bytes) {
+    system_.erase(system_.begin(), system_.end() - max_bytes);
+  }
+  system_pool_.Reserve(system_.size());
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "memory_governor.h"
+#include "session_capture.h"
+
+// Plays a session capture back with its original timing, at |speed| times
+// real time, or as fast as the app consumes it (speed <= 0).
+//
+// Pull-based, like live capture: replayed system audio is served through
+// TakeSystemAudio() in place of the WASAPI buffer, while Poll() returns the
+// mic audio and downlink messages that have come due since the last call.
+// Called from the platform thread only.
+class SessionReplayer {
+ public:
+  struct Batch {
+    std::vector<uint8_t> mic;
+    std::vector<std::string> messages;
+    bool done = false;
+  };
+
+  // |governor| budgets the replayed system audio; it must outlive the
+  // replayer.
+  explicit SessionReplayer(MemoryGovernor* governor);
+
+  bool Start(const std::string& utf8_path, double speed, uint64_t start_ms = 0);
+  void Stop();
+  bool active() const { return active_; }
+
+  Batch Poll();
+  std::vector<uint8_t> TakeSystemAudio(size_t requested_bytes);
+
+ private:
+  // Reads every record due at the current replay position.
+  void Advance();
+  // Drops the oldest system audio past |max_bytes| and records what is left
+  // with system_pool_.
+  void TrimSystem(size_t max_bytes);
+
+  SessionReader reader_;
+  bool active_ = false;
+  bool eof_ = false;
+  double speed_ = 1.0;
+  int64_t wall_start_us_ = 0;
+  uint64_t media_start_us_ = 0;
+  uint64_t media_pos_us_ = 0;
+
+  bool has_pending_ = false;
+  session_capture::Record pending_;
+
+  std::vector<uint8_t> mic_;
+  std::vector<std::string> messages_;
+  std::deque<uint8_t> system_;
+  // Budget for system_, as for live capture. Declared last so it detaches
+  // before system_ goes away.
+  MemoryPool system_pool_{"replay_queue", MemoryGovernor::kPriorityQueue, 16000, 64000,
+                          sizeof(int16_t)};
+};
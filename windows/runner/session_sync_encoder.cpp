@@ -0,0 +1,160 @@
+#include "session_sync_encoder.h"
+
+#include <iterator>
+
+namespace {
+
+constexpr char kMagic[] = {'H', 'N', 'S', 'D'};
+constexpr uint8_t kOpSet = 0x01;
+constexpr uint8_t kOpMeta = 0x02;
+constexpr uint8_t kFlagDraft = 0x01;
+constexpr uint8_t kFlagSpeaker = 0x02;
+
+static uint64_t Fnv1a(uint64_t hash, const void* data, size_t length) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < length; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+static uint64_t Fingerprint(const SyncBubble& b) {
+  uint64_t h = 14695981039346656037ULL;
+  h = Fnv1a(h, b.source.data(), b.source.size());
+  h = Fnv1a(h, "\0", 1);
+  h = Fnv1a(h, b.text.data(), b.text.size());
+  h = Fnv1a(h, &b.timestamp_ms, sizeof(b.timestamp_ms));
+  const uint8_t draft = b.is_draft ? 1 : 0;
+  h = Fnv1a(h, &draft, 1);
+  h = Fnv1a(h, &b.speaker_id, sizeof(b.speaker_id));
+  return h;
+}
+
+static uint64_t Fingerprint(const std::string& s) {
+  return Fnv1a(14695981039346656037ULL, s.data(), s.size());
+}
+
+static void PutVarint(std::vector<uint8_t>* out, uint64_t v) {
+  while (v >= 0x80) {
+    out->push_back(static_cast<uint8_t>(v | 0x80));
+    v >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(v));
+}
+
+static void PutSignedVarint(std::vector<uint8_t>* out, int64_t v) {
+  PutVarint(out, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+static void PutString(std::vector<uint8_t>* out, const std::string& s) {
+  PutVarint(out, s.size());
+  out->insert(out->end(), s.begin(), s.end());
+}
+
+static uint8_t SourceCode(const std::string& source) {
+  if (source == "mic") return 0;
+  if (source == "system") return 1;
+  return 2;
+}
+
+}  // namespace
+
+SessionSyncEncoder::Result SessionSyncEncoder::Encode(
+    const std::string& session_id,
+    const std::vector<SyncBubble>& bubbles,
+    const std::string& meta_json,
+    std::vector<uint8_t>* out,
+    uint64_t* new_version) {
+  auto it = sessions_.find(session_id);
+  if (it == sessions_.end()) {
+    return Result::kNoBaseline;
+  }
+  SessionState& state = it->second;
+  const Snapshot& acked = state.acked;
+
+  Snapshot next;
+  next.version = acked.version + 1;
+  next.fingerprints.reserve(bubbles.size());
+  for (const auto& b : bubbles) {
+    next.fingerprints.push_back(Fingerprint(b));
+  }
+  next.meta_fingerprint = Fingerprint(meta_json);
+
+  std::vector<size_t> changed;
+  for (size_t i = 0; i < bubbles.size(); i++) {
+    if (i >= acked.fingerprints.size() || acked.fingerprints[i] != next.fingerprints[i]) {
+      changed.push_back(i);
+    }
+  }
+  const bool meta_changed = next.meta_fingerprint != acked.meta_fingerprint;
+
+  if (changed.empty() && !meta_changed && bubbles.size() == acked.fingerprints.size()) {
+    state.has_pending = false;
+    return Result::kUnchanged;
+  }
+
+  out->assign(std::begin(kMagic), std::end(kMagic));
+  out->push_back(kFormatVersion);
+  PutVarint(out, acked.version);
+  PutVarint(out, next.version);
+  PutVarint(out, bubbles.size());
+  PutVarint(out, changed.size() + (meta_changed ? 1 : 0));
+
+  if (meta_changed) {
+    out->push_back(kOpMeta);
+    PutString(out, meta_json);
+  }
+
+  int64_t previous_ms = 0;
+  for (const size_t i : changed) {
+    const SyncBubble& b = bubbles[i];
+    out->push_back(kOpSet);
+    PutVarint(out, i);
+    out->push_back(SourceCode(b.source));
+    uint8_t flags = b.is_draft ? kFlagDraft : 0;
+    if (b.speaker_id >= 0) flags |= kFlagSpeaker;
+    out->push_back(flags);
+    if (b.speaker_id >= 0) {
+      PutVarint(out, static_cast<uint64_t>(b.speaker_id));
+    }
+    PutSignedVarint(out, b.timestamp_ms - previous_ms);
+    previous_ms = b.timestamp_ms;
+    PutString(out, b.text);
+  }
+
+  state.pending = std::move(next);
+  state.has_pending = true;
+  *new_version = state.pending.version;
+  return Result::kDelta;
+}
+
+void SessionSyncEncoder::Acknowledge(const std::string& session_id,
+                                     uint64_t version) {
+  auto it = sessions_.find(session_id);
+  if (it == sessions_.end() || !it->second.has_pending ||
+      it->second.pending.version != version) {
+    return;
+  }
+  it->second.acked = std::move(it->second.pending);
+  it->second.has_pending = false;
+}
+
+void SessionSyncEncoder::SetBaseline(const std::string& session_id,
+                                     const std::vector<SyncBubble>& bubbles,
+                                     const std::string& meta_json,
+                                     uint64_t version) {
+  SessionState& state = sessions_[session_id];
+  state.acked.version = version;
+  state.acked.fingerprints.clear();
+  state.acked.fingerprints.reserve(bubbles.size());
+  for (const auto& b : bubbles) {
+    state.acked.fingerprints.push_back(Fingerprint(b));
+  }
+  state.acked.meta_fingerprint = Fingerprint(meta_json);
+  state.has_pending = false;
+}
+
+void SessionSyncEncoder::Forget(const std::string& session_id) {
+  sessions_.erase(session_id);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// One transcript bubble as synced to the backend.
+struct SyncBubble {
+  std::string source;  // "mic", "system" or anything else (unknown)
+  std::string text;
+  int64_t timestamp_ms = 0;
+  bool is_draft = false;
+  int speaker_id = -1;  // -1 when not labelled
+};
+
+// Incremental encoder for meeting session saves.
+//
+// Remembers a fingerprint of every bubble in the last version the backend
+// acknowledged and turns the next save into a compact binary delta of the
+// bubbles that were appended or edited since. The wire format (v1, all
+// integers LEB128, signed ones zigzag-encoded):
+//
+//   "HNSD" u8:format=1
+//   varint:base_version varint:new_version varint:bubble_count varint:op_count
+//   op 0x01 SET    varint:index bubble
+//   op 0x02 META   varint:length utf8-json   (title, summary, metadata, ...)
+//
+//   bubble := u8:source(0 mic, 1 system, 2 unknown) u8:flags(1 draft, 2 speaker)
+//             [varint:speaker] svarint:timestamp_delta_ms varint:length utf8-text
+//
+// Timestamps are delta-coded against the previous SET in the same delta. The
+// relay truncates or extends the stored bubble list to |bubble_count| and
+// applies ops in order, so it never needs to parse the whole session.
+// Called from the platform thread only.
+class SessionSyncEncoder {
+ public:
+  enum class Result {
+    kNoBaseline,  // Nothing acknowledged yet; caller must send a full save.
+    kUnchanged,   // Identical to the acknowledged version.
+    kDelta,       // |out| holds a delta; Acknowledge() once the relay applied it.
+  };
+
+  static constexpr uint8_t kFormatVersion = 1;
+
+  Result Encode(const std::string& session_id,
+                const std::vector<SyncBubble>& bubbles,
+                const std::string& meta_json,
+                std::vector<uint8_t>* out,
+                uint64_t* new_version);
+
+  // Marks the pending delta for |session_id| at |version| as applied.
+  void Acknowledge(const std::string& session_id, uint64_t version);
+
+  // Records a full save as the acknowledged state.
+  void SetBaseline(const std::string& session_id,
+                   const std::vector<SyncBubble>& bubbles,
+                   const std::string& meta_json,
+                   uint64_t version);
+
+  // Drops all state for |session_id| (e.g. after the relay rejected a delta).
+  void Forget(const std::string& session_id);
+
+ private:
+  struct Snapshot {
+    uint64_t version = 0;
+    std::vector<uint64_t> fingerprints;
+    uint64_t meta_fingerprint = 0;
+  };
+
+  struct SessionState {
+    Snapshot acked;
+    Snapshot pending;
+    bool has_pending = false;
+  };
+
+  std::map<std::string, SessionState> sessions_;
+};
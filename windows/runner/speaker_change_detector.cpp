@@ -0,0 +1,198 @@
+#include "speaker_change_detector.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 25 ms frames every 10 ms, one embedding per second of audio.
+constexpr int kHop = 160;
+constexpr int kFramesPerWindow = 100;
+// A window needs this many voiced frames to say anything about the speaker.
+constexpr int kMinVoicedFrames = 30;
+// Frames this far above the noise floor (natural log energy) count as voiced.
+constexpr float kVoicedMargin = 2.0f;
+// Centroids keep adapting but never weigh more than this many windows.
+constexpr int kMaxCentroidWeight = 30;
+
+}  // namespace
+
+SpeakerChangeDetector::SpeakerChangeDetector(float similarity_threshold,
+                                             int max_speakers)
+    : similarity_threshold_(similarity_threshold),
+      max_speakers_(max_speakers) {
+  pending_.reserve(features_.frame_length() * 2);
+  log_mel_.resize(features_.mel_bands());
+}
+
+void SpeakerChangeDetector::Reset() {
+  pending_.clear();
+  samples_processed_ = 0;
+  frames_seen_ = 0;
+  noise_floor_ = 0.0f;
+  noise_floor_ready_ = false;
+  window_start_sample_ = 0;
+  window_frames_ = 0;
+  window_voiced_ = 0;
+  sum_.fill(0.0);
+  sum_sq_.fill(0.0);
+  global_mean_.fill(0.0f);
+  embeddings_seen_ = 0;
+  centroids_.clear();
+  centroid_counts_.clear();
+  current_speaker_ = -1;
+  has_candidate_ = false;
+  segments_.clear();
+}
+
+void SpeakerChangeDetector::Process(const float* samples, size_t count) {
+  const size_t frame_length = static_cast<size_t>(features_.frame_length());
+  for (size_t i = 0; i < count; i++) {
+    pending_.push_back(samples[i]);
+    if (pending_.size() >= frame_length) {
+      ProcessFrame(pending_.data());
+      pending_.erase(pending_.begin(), pending_.begin() + kHop);
+    }
+  }
+  samples_processed_ += count;
+}
+
+void SpeakerChangeDetector::ProcessFrame(const float* frame) {
+  const float log_energy = features_.Compute(frame, log_mel_.data());
+  frames_seen_++;
+
+  // Track the floor quickly downwards and slowly upwards.
+  if (!noise_floor_ready_) {
+    noise_floor_ = log_energy;
+    noise_floor_ready_ = true;
+  } else if (log_energy < noise_floor_) {
+    noise_floor_ = log_energy;
+  } else {
+    noise_floor_ += 0.002f * (log_energy - noise_floor_);
+  }
+
+  if (log_energy > noise_floor_ + kVoicedMargin) {
+    float cepstrum[kCepstra + 1];
+    features_.Cepstrum(log_mel_.data(), cepstrum, kCepstra + 1);
+    // Skip c0 so playback volume does not separate speakers.
+    for (int c = 0; c < kCepstra; c++) {
+      const double v = cepstrum[c + 1];
+      sum_[c] += v;
+      sum_sq_[c] += v * v;
+    }
+    window_voiced_++;
+  }
+
+  window_frames_++;
+  if (window_frames_ >= kFramesPerWindow) {
+    CloseWindow();
+  }
+}
+
+void SpeakerChangeDetector::CloseWindow() {
+  const uint64_t start = window_start_sample_;
+  window_start_sample_ = frames_seen_ * kHop;
+
+  if (window_voiced_ >= kMinVoicedFrames) {
+    Embedding embedding;
+    for (int c = 0; c < kCepstra; c++) {
+      const double mean = sum_[c] / window_voiced_;
+      const double var = (std::max)(0.0, sum_sq_[c] / window_voiced_ - mean * mean);
+      embedding[c] = static_cast<float>(mean);
+      embedding[kCepstra + c] = static_cast<float>(std::sqrt(var));
+    }
+
+    const int speaker = Assign(embedding);
+    if (speaker != current_speaker_) {
+      current_speaker_ = speaker;
+      segments_.push_back(Segment{start, speaker});
+      if (segments_.size() > kMaxSegments) {
+        segments_.pop_front();
+      }
+    }
+  }
+
+  window_frames_ = 0;
+  window_voiced_ = 0;
+  sum_.fill(0.0);
+  sum_sq_.fill(0.0);
+}
+
+int SpeakerChangeDetector::Assign(const Embedding& embedding) {
+  embeddings_seen_++;
+  const float alpha = 1.0f / static_cast<float>((std::min)(embeddings_seen_, 100));
+  for (int i = 0; i < kEmbeddingSize; i++) {
+    global_mean_[i] += alpha * (embedding[i] - global_mean_[i]);
+  }
+
+  auto similarity = [this](const Embedding& a, const Embedding& b) {
+    double dot = 0.0, na = 0.0, nb = 0.0;
+    for (int i = 0; i < kEmbeddingSize; i++) {
+      const double x = a[i] - global_mean_[i];
+      const double y = b[i] - global_mean_[i];
+      dot += x * y;
+      na += x * x;
+      nb += y * y;
+    }
+    if (na <= 0.0 || nb <= 0.0) return 1.0;
+    return dot / std::sqrt(na * nb);
+  };
+
+  int best = -1;
+  double best_similarity = -2.0;
+  for (size_t i = 0; i < centroids_.size(); i++) {
+    double s = similarity(embedding, centroids_[i]);
+    // Hysteresis: favour staying with the current speaker.
+    if (static_cast<int>(i) == current_speaker_) s += 0.05;
+    if (s > best_similarity) {
+      best_similarity = s;
+      best = static_cast<int>(i);
+    }
+  }
+
+  // Until the channel mean settles every window looks alike; hold the first
+  // speaker rather than spawning clusters from noise.
+  const bool warming_up = embeddings_seen_ <= 3;
+  if (best < 0) {
+    centroids_.push_back(embedding);
+    centroid_counts_.push_back(1);
+    return 0;
+  }
+  if (!warming_up && best_similarity < similarity_threshold_ &&
+      static_cast<int>(centroids_.size()) < max_speakers_) {
+    // A window straddling a turn matches nobody; only open a new speaker once
+    // two consecutive unmatched windows agree with each other.
+    if (has_candidate_ && similarity(candidate_, embedding) >= similarity_threshold_) {
+      Embedding merged;
+      for (int i = 0; i < kEmbeddingSize; i++) {
+        merged[i] = 0.5f * (candidate_[i] + embedding[i]);
+      }
+      has_candidate_ = false;
+      centroids_.push_back(merged);
+      centroid_counts_.push_back(2);
+      return static_cast<int>(centroids_.size()) - 1;
+    }
+    candidate_ = embedding;
+    has_candidate_ = true;
+    return current_speaker_;
+  }
+  has_candidate_ = false;
+
+  Embedding& centroid = centroids_[best];
+  int& weight = centroid_counts_[best];
+  weight = (std::min)(weight + 1, kMaxCentroidWeight);
+  for (int i = 0; i < kEmbeddingSize; i++) {
+    centroid[i] += (embedding[i] - centroid[i]) / static_cast<float>(weight);
+  }
+  return best;
+}
+
+int SpeakerChangeDetector::SpeakerAt(const std::deque<Segment>& segments, uint64_t sample) {
+  int speaker = segments.empty() ? -1 : segments.front().speaker_id;
+  for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+    if (it->start_sample <= sample) {
+      return it->speaker_id;
+    }
+  }
+  return speaker;
+}
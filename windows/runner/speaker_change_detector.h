@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "audio_features.h"
+
+// Lightweight speaker change detection for the 16kHz mono system stream.
+//
+// Every second of audio is reduced to a compact embedding (mean and standard
+// deviation of 12 MFCCs over voiced frames). Embeddings are assigned to
+// speakers by online clustering on cosine similarity, and each assignment
+// opens a segment keyed by absolute sample index so frames handed to Dart can
+// be labelled. Runs on the capture thread; callers provide locking.
+class SpeakerChangeDetector {
+ public:
+  static constexpr int kCepstra = 12;
+  static constexpr int kEmbeddingSize = kCepstra * 2;
+  // Keep about ten minutes of segment history for late frame lookups.
+  static constexpr size_t kMaxSegments = 600;
+
+  struct Segment {
+    uint64_t start_sample = 0;
+    int speaker_id = -1;
+  };
+
+  explicit SpeakerChangeDetector(float similarity_threshold = 0.6f,
+                                 int max_speakers = 8);
+
+  // Feeds mono 16kHz float samples in stream order.
+  void Process(const float* samples, size_t count);
+
+  // Speaker active at |sample| (absolute index since Reset), or -1 if no
+  // speech has been labelled yet.
+  int SpeakerAt(uint64_t sample) const { return SpeakerAt(segments_, sample); }
+  // The same lookup over segments published elsewhere, oldest first.
+  static int SpeakerAt(const std::deque<Segment>& segments, uint64_t sample);
+  // Labelled segments, oldest first.
+  const std::deque<Segment>& segments() const { return segments_; }
+  int current_speaker() const { return current_speaker_; }
+  int speaker_count() const { return static_cast<int>(centroids_.size()); }
+  uint64_t samples_processed() const { return samples_processed_; }
+
+  void Reset();
+
+ private:
+  using Embedding = std::array<float, kEmbeddingSize>;
+
+  void ProcessFrame(const float* frame);
+  void CloseWindow();
+  int Assign(const Embedding& embedding);
+
+  const float similarity_threshold_;
+  const int max_speakers_;
+
+  LogMelExtractor features_;
+  std::vector<float> pending_;
+  std::vector<float> log_mel_;
+  uint64_t samples_processed_ = 0;
+  uint64_t frames_seen_ = 0;
+
+  // Adaptive noise floor (log energy) used to gate voiced frames.
+  float noise_floor_ = 0.0f;
+  bool noise_floor_ready_ = false;
+
+  // Per-window accumulators.
+  uint64_t window_start_sample_ = 0;
+  int window_frames_ = 0;
+  int window_voiced_ = 0;
+  std::array<double, kCepstra> sum_{};
+  std::array<double, kCepstra> sum_sq_{};
+
+  // Running mean of all embeddings; subtracted before comparison so the
+  // channel (codec, room, playback device) does not dominate similarity.
+  Embedding global_mean_{};
+  int embeddings_seen_ = 0;
+
+  std::vector<Embedding> centroids_;
+  std::vector<int> centroid_counts_;
+  int current_speaker_ = -1;
+
+  // Unmatched embedding waiting for confirmation before it opens a speaker.
+  Embedding candidate_{};
+  bool has_candidate_ = false;
+
+  std::deque<Segment> segments_;
+};
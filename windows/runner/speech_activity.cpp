@@ -0,0 +1,65 @@
+#include "speech_activity.h"
+
+#include <algorithm>
+#include <cmath>
+
+EnergyVad::EnergyVad(int sample_rate,
+                     int frame_ms,
+                     float threshold_db,
+                     int hangover_ms)
+    : frame_ms_(frame_ms),
+      frame_samples_(sample_rate * frame_ms / 1000),
+      threshold_db_(threshold_db),
+      hangover_frames_((std::max)(0, hangover_ms / frame_ms)),
+      window_frames_((std::max)(1, kFloorWindowMs / frame_ms)) {
+  pending_.assign(frame_samples_, 0.0f);
+}
+
+void EnergyVad::Reset() {
+  pending_count_ = 0;
+  level_db_ = -100.0f;
+  noise_db_ = -60.0f;
+  noise_ready_ = false;
+  hangover_left_ = 0;
+  window_min_db_ = 0.0f;
+  window_count_ = 0;
+}
+
+bool EnergyVad::ProcessFrame(const float* frame) {
+  double energy = 0.0;
+  for (int i = 0; i < frame_samples_; i++) {
+    energy += static_cast<double>(frame[i]) * frame[i];
+  }
+  energy /= frame_samples_;
+  level_db_ = static_cast<float>(10.0 * std::log10(energy + 1e-10));
+
+  // Follow the floor down immediately and up slowly (about 3 dB/s), but
+  // only on frames that are not speech: otherwise a long stretch of talk
+  // creeps the floor up under the voice until the talk stops registering.
+  if (!noise_ready_) {
+    noise_db_ = level_db_;
+    noise_ready_ = true;
+  } else if (level_db_ < noise_db_) {
+    noise_db_ = level_db_;
+  } else if (level_db_ <= noise_db_ + threshold_db_) {
+    noise_db_ = (std::min)(level_db_, noise_db_ + 0.03f * frame_ms_ / 10.0f);
+  }
+
+  // Speech always pauses within a few seconds. A level that stays above the
+  // floor for a whole window is new background noise (a fan, a louder
+  // room), so the floor jumps to the quietest frame of that window.
+  window_min_db_ = window_count_ == 0 ? level_db_ : (std::min)(window_min_db_, level_db_);
+  if (++window_count_ >= window_frames_) {
+    if (window_min_db_ > noise_db_ + threshold_db_) noise_db_ = window_min_db_;
+    window_count_ = 0;
+  }
+  // Digital silence would otherwise pin the floor at -100 dB.
+  noise_db_ = (std::max)(noise_db_, -75.0f);
+
+  if (level_db_ > noise_db_ + threshold_db_) {
+    hangover_left_ = hangover_frames_ + 1;
+  } else if (hangover_left_ > 0) {
+    hangover_left_--;
+  }
+  return hangover_left_ > 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Frame-level energy voice activity detector for 16kHz mono float audio.
+//
+// Each 10 ms frame is compared against an adaptive noise floor; speech is
+// declared above |threshold_db| over the floor and held for |hangover_ms| to
+// bridge short gaps between words. The floor only rises on non-speech frames,
+// or when nothing in a whole window came near it. Cheap enough to run on
+// every stream.
+class EnergyVad {
+ public:
+  explicit EnergyVad(int sample_rate = 16000,
+                     int frame_ms = 10,
+                     float threshold_db = 9.0f,
+                     int hangover_ms = 200);
+
+  int frame_samples() const { return frame_samples_; }
+  int frame_ms() const { return frame_ms_; }
+
+  // Classifies one frame of frame_samples() samples.
+  bool ProcessFrame(const float* frame);
+
+  // Splits |samples| into frames (carrying the remainder over between calls)
+  // and calls |on_frame(bool speech)| once per complete frame.
+  template <typename Callback>
+  void Process(const float* samples, size_t count, Callback&& on_frame) {
+    for (size_t i = 0; i < count; i++) {
+      pending_[pending_count_++] = samples[i];
+      if (pending_count_ == pending_.size()) {
+        pending_count_ = 0;
+        on_frame(ProcessFrame(pending_.data()));
+      }
+    }
+  }
+
+  float level_db() const { return level_db_; }
+  float noise_db() const { return noise_db_; }
+  bool speaking() const { return hangover_left_ > 0; }
+
+  void Reset();
+
+ private:
+  static constexpr int kFloorWindowMs = 10000;
+
+  const int frame_ms_;
+  const int frame_samples_;
+  const float threshold_db_;
+  const int hangover_frames_;
+  const int window_frames_;
+
+  std::vector<float> pending_;
+  size_t pending_count_ = 0;
+
+  float level_db_ = -100.0f;
+  float noise_db_ = -60.0f;
+  bool noise_ready_ = false;
+  int hangover_left_ = 0;
+
+  // Quietest level over the current window of |window_frames_| frames.
+  float window_min_db_ = 0.0f;
+  int window_count_ = 0;
+};
@@ -0,0 +1,292 @@
+#include "stall_watchdog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+#include "audio_clock.h"
+#include "power_state.h"
+
+#if !defined(_WIN32)
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <signal.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#endif
+
+namespace {
+
+constexpr int64_t kPingIntervalNs = 100 * 1000000LL;
+// While the window is hidden a dropped frame is not seen; a slow heartbeat
+// still notices a wedged loop.
+constexpr int64_t kHiddenPingIntervalNs = 1000 * 1000000LL;
+constexpr size_t kMaxRecentStalls = 32;
+
+static int64_t WallNowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+#if !defined(_WIN32)
+
+constexpr int kMaxStackFrames = 48;
+
+enum StackState { kStackIdle = 0, kStackRequested = 1, kStackWriting = 2, kStackDone = 3 };
+
+// Shared with the signal handler on the platform thread.
+std::atomic<int> g_stack_state{kStackIdle};
+void* g_stack_frames[kMaxStackFrames];
+int g_stack_depth = 0;
+
+// Not used by GLib or the Dart VM, which profiles with SIGPROF.
+static int StackSignal() {
+  return SIGRTMIN + 4;
+}
+
+static void OnStackSignal(int) {
+  int expected = kStackRequested;
+  if (!g_stack_state.compare_exchange_strong(expected, kStackWriting)) return;
+  const int saved_errno = errno;
+  g_stack_depth = backtrace(g_stack_frames, kMaxStackFrames);
+  errno = saved_errno;
+  g_stack_state.store(kStackDone, std::memory_order_release);
+}
+
+static std::string Symbolize(void* address) {
+  char text[512];
+  Dl_info info;
+  if (!dladdr(address, &info)) {
+    snprintf(text, sizeof(text), "%p", address);
+    return text;
+  }
+  const uintptr_t pc = reinterpret_cast<uintptr_t>(address);
+  if (info.dli_sname) {
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    snprintf(text, sizeof(text), "%s+0x%zx", status == 0 && demangled ? demangled : info.dli_sname,
+             static_cast<size_t>(pc - reinterpret_cast<uintptr_t>(info.dli_saddr)));
+    std::free(demangled);
+    return text;
+  }
+  const char* module = info.dli_fname ? std::strrchr(info.dli_fname, '/') : nullptr;
+  snprintf(text, sizeof(text), "%s+0x%zx",
+           module ? module + 1 : (info.dli_fname ? info.dli_fname : "?"),
+           static_cast<size_t>(pc - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+  return text;
+}
+
+#endif
+
+}  // namespace
+
+StallWatchdog::Scope::Scope(StallWatchdog* watchdog, const char* channel,
+                            const std::string& method)
+    : watchdog_(watchdog) {
+  watchdog_->BeginHandler(channel, method);
+}
+
+StallWatchdog::Scope::~Scope() {
+  watchdog_->EndHandler();
+}
+
+StallWatchdog::StallWatchdog()
+    : handler_us_(Metrics().GetHistogram("platform.handler_us")),
+      loop_latency_us_(Metrics().GetHistogram("platform.loop_latency_us")),
+      stall_ms_(Metrics().GetHistogram("platform.stall_ms")),
+      stall_count_(Metrics().GetCounter("platform.stalls")),
+      wakeups_(Metrics().GetCounter("platform.watchdog_wakeups")) {}
+
+StallWatchdog::~StallWatchdog() {
+  Stop();
+}
+
+bool StallWatchdog::Start(std::function<void()> post_ping, int64_t threshold_ms) {
+  if (thread_ || !post_ping || threshold_ms <= 0) return false;
+  post_ping_ = std::move(post_ping);
+  threshold_ns_ = threshold_ms * 1000000;
+  stop_ = false;
+#if !defined(_WIN32)
+  platform_thread_ = pthread_self();
+  // backtrace() loads its unwinder on first use, which the handler must not.
+  void* warm[1];
+  backtrace(warm, 1);
+  struct sigaction action = {};
+  action.sa_handler = OnStackSignal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(StackSignal(), &action, nullptr);
+#endif
+  thread_ = new std::thread(&StallWatchdog::ThreadProc, this);
+  return true;
+}
+
+void StallWatchdog::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  if (thread_) {
+    thread_->join();
+    delete thread_;
+    thread_ = nullptr;
+  }
+}
+
+void StallWatchdog::BeginHandler(const char* channel, const std::string& method) {
+  const int64_t now = SteadyNowNs();
+  std::lock_guard<std::mutex> lock(mutex_);
+  method_.assign(channel);
+  method_.push_back('.');
+  method_.append(method);
+  handler_start_ns_ = now;
+}
+
+void StallWatchdog::EndHandler() {
+  const int64_t now = SteadyNowNs();
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int64_t start = handler_start_ns_;
+  handler_start_ns_ = 0;
+  if (start == 0) return;
+  handler_calls_++;
+  last_handler_end_ns_ = now;
+  handler_us_->Record((now - start) / 1000);
+  if (now - start >= threshold_ns_) {
+    RecordLocked("handler", start, now);
+    // The heartbeat waited on this handler; it is not a stall of its own.
+    handler_stall_end_ns_ = now;
+    sampled_ = false;
+  }
+}
+
+void StallWatchdog::OnPing() {
+  const int64_t now = SteadyNowNs();
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int64_t sent = ping_sent_ns_;
+  ping_sent_ns_ = 0;
+  if (sent == 0) return;
+  loop_latency_us_->Record((now - sent) / 1000);
+  if (now - sent >= threshold_ns_ && handler_stall_end_ns_ < sent) {
+    RecordLocked("loop", sent, now);
+  }
+  pending_stack_.clear();
+  sampled_ = false;
+}
+
+void StallWatchdog::RecordLocked(const char* kind, int64_t start_ns, int64_t end_ns) {
+  Stall stall;
+  stall.kind = kind;
+  // A loop stall names the handler only when one ran inside it.
+  if (stall.kind == "handler" || last_handler_end_ns_ >= start_ns) stall.method = method_;
+  stall.duration_ms = (end_ns - start_ns) / 1000000;
+  stall.at_ms = WallNowMs() - (SteadyNowNs() - start_ns) / 1000000;
+  stall.stack.swap(pending_stack_);
+  stall_ms_->Record(stall.duration_ms);
+  stall_count_->Add();
+  stalls_++;
+  std::cerr << "[StallWatchdog] " << stall.kind << " stall " << stall.duration_ms << " ms"
+            << (stall.method.empty() ? std::string() : " in " + stall.method) << std::endl;
+  recent_.push_back(std::move(stall));
+  if (recent_.size() > kMaxRecentStalls) recent_.pop_front();
+}
+
+StallWatchdog::Stats StallWatchdog::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats;
+  stats.threshold_ms = threshold_ns_ / 1000000;
+  stats.handler_calls = handler_calls_;
+  stats.stalls = stalls_;
+  stats.recent.assign(recent_.begin(), recent_.end());
+  return stats;
+}
+
+void StallWatchdog::ThreadProc() {
+  // Twice per threshold, so a stall is seen while it is still in progress.
+  // Hidden, only as often as the heartbeat.
+  const int64_t check_ns = (std::max)(threshold_ns_ / 2, int64_t{5000000});
+  while (true) {
+    const bool hidden = AppPowerState().hidden();
+    const int64_t ping_interval_ns = hidden ? kHiddenPingIntervalNs : kPingIntervalNs;
+    const auto period = std::chrono::nanoseconds(hidden ? ping_interval_ns : check_ns);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (wake_.wait_for(lock, period, [this] { return stop_; })) break;
+    }
+    wakeups_->Add();
+    const int64_t now = SteadyNowNs();
+    bool post = false;
+    int64_t stalled_since = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // A ping delayed by a handler stall belongs to that stall.
+      int64_t since = handler_start_ns_;
+      if (ping_sent_ns_ != 0 && ping_sent_ns_ > handler_stall_end_ns_ &&
+          (since == 0 || ping_sent_ns_ < since)) {
+        since = ping_sent_ns_;
+      }
+      if (since != 0 && now - since >= threshold_ns_ && !sampled_) {
+        sampled_ = true;
+        stalled_since = since;
+      }
+      if (ping_sent_ns_ == 0 && now - last_ping_ns_ >= ping_interval_ns) {
+        ping_sent_ns_ = now;
+        last_ping_ns_ = now;
+        post = true;
+      }
+    }
+    if (post) post_ping_();
+    if (stalled_since != 0) {
+      std::vector<std::string> stack = SampleStack();
+      std::lock_guard<std::mutex> lock(mutex_);
+      // Kept only if that stall is still going on.
+      if (handler_start_ns_ == stalled_since || ping_sent_ns_ == stalled_since) {
+        pending_stack_.swap(stack);
+      }
+    }
+  }
+}
+
+#if defined(_WIN32)
+
+std::vector<std::string> StallWatchdog::SampleStack() {
+  return std::vector<std::string>();
+}
+
+#else
+
+std::vector<std::string> StallWatchdog::SampleStack() {
+  g_stack_state.store(kStackRequested);
+  if (pthread_kill(platform_thread_, StackSignal()) != 0) {
+    g_stack_state.store(kStackIdle);
+    return std::vector<std::string>();
+  }
+  const int64_t deadline = SteadyNowMs() + 100;
+  while (g_stack_state.load(std::memory_order_acquire) != kStackDone &&
+         SteadyNowMs() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  int expected = kStackRequested;
+  if (g_stack_state.compare_exchange_strong(expected, kStackIdle)) {
+    return std::vector<std::string>();  // Blocked with the signal masked
+  }
+  while (g_stack_state.load(std::memory_order_acquire) != kStackDone) std::this_thread::yield();
+  std::vector<std::string> stack;
+  // The first two frames are the handler and the signal trampoline.
+  for (int i = 2; i < g_stack_depth; i++) stack.push_back(Symbolize(g_stack_frames[i]));
+  g_stack_state.store(kStackIdle);
+  return stack;
+}
+
+#endif
+
+StallWatchdog& PlatformWatchdog() {
+  static StallWatchdog watchdog;
+  return watchdog;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "metrics.h"
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+// Measures how long the platform (UI) thread is unavailable. Method-channel
+// handlers run synchronously on it, so a slow one drops frames.
+//
+// Two signals:
+// - Handler scopes: each handler is timed from entry to exit into
+//   platform.handler_us.
+// - Heartbeat: a watchdog thread posts a ping into the platform message loop
+//   (the Win32 loop in main.cpp through the window, or the GTK main context),
+//   and the time until the loop runs it goes into platform.loop_latency_us.
+//   This catches stalls outside handlers too: engine tasks, plugins, window
+//   messages.
+//
+// Either one over the threshold is a stall. It goes into platform.stall_ms
+// and the platform.stalls counter, and is kept with the handler that was
+// running (or last ran) for stats(). On Linux the watchdog also signals the
+// platform thread while the stall is still in progress and records its
+// stack. On Windows, use the sampling profiler for stacks.
+//
+// While AppPowerState() is hidden the heartbeat slows to once a second.
+class StallWatchdog {
+ public:
+  struct Stall {
+    std::string kind;    // "handler" or "loop"
+    std::string method;  // "channel.method"; empty for a loop stall outside handlers
+    int64_t duration_ms = 0;
+    int64_t at_ms = 0;  // Start, ms since the epoch
+    std::vector<std::string> stack;  // Platform thread mid-stall, leaf first
+  };
+
+  struct Stats {
+    int64_t threshold_ms = 0;
+    uint64_t handler_calls = 0;
+    uint64_t stalls = 0;
+    std::vector<Stall> recent;  // Oldest first
+  };
+
+  // Times one handler call; create it first thing in the handler.
+  class Scope {
+   public:
+    Scope(StallWatchdog* watchdog, const char* channel, const std::string& method);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    StallWatchdog* watchdog_;
+  };
+
+  StallWatchdog();
+  ~StallWatchdog();
+
+  // Called on the platform thread. |post_ping| is called from the watchdog
+  // thread and must arrange for OnPing() to run on the platform thread.
+  bool Start(std::function<void()> post_ping, int64_t threshold_ms = 50);
+  void Stop();
+  // Platform thread: the heartbeat posted by |post_ping| arrived.
+  void OnPing();
+
+  Stats stats() const;
+
+ private:
+  void BeginHandler(const char* channel, const std::string& method);
+  void EndHandler();
+  void ThreadProc();
+  // Stack of the platform thread, symbolized; empty where not supported.
+  std::vector<std::string> SampleStack();
+  // Caller holds |mutex_|.
+  void RecordLocked(const char* kind, int64_t start_ns, int64_t end_ns);
+
+  std::function<void()> post_ping_;
+  std::thread* thread_ = nullptr;
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+  int64_t threshold_ns_ = 0;
+
+  // Guarded by |mutex_|.
+  std::string method_;             // Running or last handler
+  int64_t handler_start_ns_ = 0;   // 0 when no handler is running
+  int64_t ping_sent_ns_ = 0;       // 0 when no ping is outstanding
+  int64_t last_ping_ns_ = 0;
+  int64_t last_handler_end_ns_ = 0;
+  int64_t handler_stall_end_ns_ = 0;
+  bool sampled_ = false;           // The current stall's stack was taken
+  std::vector<std::string> pending_stack_;
+  uint64_t handler_calls_ = 0;
+  uint64_t stalls_ = 0;
+  std::deque<Stall> recent_;
+
+  Histogram* handler_us_;
+  Histogram* loop_latency_us_;
+  Histogram* stall_ms_;
+  Counter* stall_count_;
+  Counter* wakeups_;
+
+#if !defined(_WIN32)
+  pthread_t platform_thread_ = {};  // The thread that called Start()
+#endif
+};
+
+// The watchdog for the platform thread of this process.
+StallWatchdog& PlatformWatchdog();
@@ -0,0 +1,159 @@
+// AnswerIndex recall and latency against brute-force search over the same
+// embeddings, at 1k and 10k entries.
+//
+// Entries are synthetic interview questions (a frame, a subject, a context
+// and a tag). Queries ask a stored question in other words, with one
+// character dropped as a transcription slip. Afterwards 60% of the entries
+// are removed and every remaining one must still find itself (or its
+// duplicate: at 10k some questions are drawn twice).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "answer_index.h"
+#include "test_support.h"
+
+namespace {
+
+const char* const kFrames[] = {
+    "tell me about",        "can you explain",     "how would you handle",
+    "describe",             "what do you think of", "walk me through",
+    "how do you approach",  "give an example of",  "why does",
+    "what is your view on"};
+// kFrames reworded, index for index.
+const char* const kParaphrasedFrames[] = {
+    "could you tell me about", "explain",           "how do you deal with",
+    "talk about",              "your thoughts on",  "take me through",
+    "what's your approach to", "share an example of", "why is",
+    "how do you feel about"};
+const char* const kSubjects[] = {
+    "your experience",   "a conflict with a coworker", "your greatest weakness",
+    "a project you led", "microservices",              "database indexing",
+    "the CAP theorem",   "garbage collection",         "REST versus GraphQL",
+    "unit testing",      "code review",                "deadlines",
+    "a failed project",  "kubernetes",                 "caching strategies",
+    "load balancing",    "your career goals",          "team leadership",
+    "mentoring juniors", "technical debt",             "agile sprints",
+    "react hooks",       "memory leaks",               "SQL joins",
+    "concurrency bugs",  "system design",              "customer complaints",
+    "salary expectations", "remote work",              "security vulnerabilities"};
+const char* const kContexts[] = {
+    "",                " in production",    " at scale",        " in your last role",
+    " on a small team", " under pressure",  " with legacy code", " for a startup",
+    " in a bank",      " with python",      " with java",       " across regions",
+    " during an outage", " in a migration", " for mobile apps"};
+
+constexpr int kQueries = 500;
+constexpr float kRecallAt1Floor = 0.95f;
+
+struct Question {
+  size_t frame;
+  size_t subject;
+  size_t context;
+  size_t tag;
+
+  std::string Text(const char* const* frames) const {
+    return std::string(frames[frame]) + " " + kSubjects[subject] + kContexts[context] + " case " +
+           std::to_string(tag);
+  }
+};
+
+std::string Id(size_t i) {
+  return "q" + std::to_string(i);
+}
+
+double Percentile(std::vector<double> values, double p) {
+  std::sort(values.begin(), values.end());
+  return values[static_cast<size_t>(p * (values.size() - 1))];
+}
+
+void Run(size_t entries) {
+  std::mt19937 rng(7);
+  std::vector<Question> questions;
+  std::vector<std::string> texts;
+  for (size_t i = 0; i < entries; i++) {
+    const Question q = {rng() % std::size(kFrames), rng() % std::size(kSubjects),
+                        rng() % std::size(kContexts), i % 97};
+    questions.push_back(q);
+    texts.push_back(q.Text(kFrames));
+  }
+
+  AnswerIndex index;
+  const auto build_start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < entries; i++) index.Upsert(Id(i), texts[i], "answer");
+  const double build_ms = test_support::SecondsSince(build_start) * 1000;
+
+  std::vector<TextEmbedding> embeddings(entries);
+  for (size_t i = 0; i < entries; i++) EmbedText(texts[i], &embeddings[i]);
+
+  int hits_at_1 = 0;
+  int hits_at_5 = 0;
+  std::vector<double> index_us;
+  std::vector<double> brute_us;
+  for (int q = 0; q < kQueries; q++) {
+    const size_t source = rng() % entries;
+    std::string text = questions[source].Text(kParaphrasedFrames);
+    const size_t slip = rng() % text.size();
+    if (text[slip] != ' ') text.erase(slip, 1);
+
+    auto start = std::chrono::steady_clock::now();
+    TextEmbedding query;
+    EmbedText(text, &query);
+    std::vector<std::pair<float, size_t>> exact;
+    exact.reserve(entries);
+    for (size_t j = 0; j < entries; j++) {
+      exact.push_back({-EmbeddingSimilarity(query, embeddings[j]), j});
+    }
+    std::partial_sort(exact.begin(), exact.begin() + 5, exact.end());
+    brute_us.push_back(test_support::SecondsSince(start) * 1e6);
+
+    start = std::chrono::steady_clock::now();
+    const std::vector<AnswerIndex::Match> matches = index.Search(text, 5, 0.0f);
+    index_us.push_back(test_support::SecondsSince(start) * 1e6);
+
+    // Ties with the exact best count.
+    if (!matches.empty() && matches[0].similarity >= -exact[0].first - 1e-6f) hits_at_1++;
+    for (int k = 0; k < 5; k++) {
+      for (const AnswerIndex::Match& match : matches) {
+        if (match.id == Id(exact[k].second)) {
+          hits_at_5++;
+          break;
+        }
+      }
+    }
+  }
+  const float recall_at_1 = static_cast<float>(hits_at_1) / kQueries;
+  const float recall_at_5 = static_cast<float>(hits_at_5) / (5 * kQueries);
+
+  // Removed entries stay as waypoints, then force a rebuild.
+  const size_t removed = entries * 6 / 10;
+  for (size_t i = 0; i < removed; i++) EXPECT_TRUE(index.Remove(Id(i)));
+  EXPECT_EQ(index.size(), entries - removed);
+  int self_hits = 0;
+  for (size_t i = removed; i < entries; i++) {
+    const std::vector<AnswerIndex::Match> matches = index.Search(texts[i], 1, 0.0f);
+    if (!matches.empty() && texts[std::stoul(matches[0].id.substr(1))] == texts[i]) self_hits++;
+  }
+
+  std::printf("%6zu entries: build %.0f ms, recall@1 %.3f recall@5 %.3f, search p50 %.0f us "
+              "p99 %.0f us, brute force p50 %.0f us; after removing 60%% %d/%zu find themselves\n",
+              entries, build_ms, recall_at_1, recall_at_5, Percentile(index_us, 0.5),
+              Percentile(index_us, 0.99), Percentile(brute_us, 0.5), self_hits,
+              entries - removed);
+  EXPECT_TRUE(recall_at_1 >= kRecallAt1Floor);
+  EXPECT_EQ(static_cast<size_t>(self_hits), entries - removed);
+}
+
+}  // namespace
+
+int main() {
+  Run(1000);
+  Run(10000);
+  return test_support::TestResult();
+}
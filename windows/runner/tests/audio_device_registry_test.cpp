@@ -0,0 +1,145 @@
+// AudioDeviceRegistry against a fake backend: lookups, defaults, hot-plug
+// and default changes, and lookups racing a stream of notifications.
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "audio_device_registry.h"
+#include "fake_audio_device_backend.h"
+#include "test_support.h"
+
+namespace {
+
+const std::string kCapturePrefix = "{0.0.1.00000000}.";
+const std::string kRenderPrefix = "{0.0.0.00000000}.";
+
+struct Fixture {
+  Fixture() {
+    auto backend = std::make_unique<FakeAudioDeviceBackend>();
+    fake = backend.get();
+    fake->Add(kCapturePrefix + "array", "Microphone Array", AudioDeviceFlow::kCapture);
+    fake->Add(kCapturePrefix + "headset", "Headset Microphone", AudioDeviceFlow::kCapture);
+    fake->Add(kRenderPrefix + "speakers", "Speakers", AudioDeviceFlow::kRender);
+    fake->SetDefault(AudioDeviceFlow::kCapture, kCapturePrefix + "array");
+    fake->SetDefault(AudioDeviceFlow::kRender, kRenderPrefix + "speakers");
+    registry = std::make_unique<AudioDeviceRegistry>(std::move(backend));
+    registry->SetChangeCallback([this](uint64_t) { changes++; });
+  }
+
+  FakeAudioDeviceBackend* fake = nullptr;
+  std::unique_ptr<AudioDeviceRegistry> registry;
+  std::atomic<int> changes{0};
+};
+
+void TestLookups() {
+  Fixture f;
+  EXPECT_TRUE(f.registry->Start());
+  EXPECT_EQ(f.fake->enumerations.load(), 1);
+
+  AudioDeviceInfo device;
+  EXPECT_TRUE(f.registry->Find(kCapturePrefix + "headset", &device));
+  EXPECT_EQ(device.name, std::string("Headset Microphone"));
+  EXPECT_TRUE(!device.is_default);
+  EXPECT_EQ(device.format.sample_rate, 48000);
+  EXPECT_TRUE(f.registry->Default(AudioDeviceFlow::kCapture, &device));
+  EXPECT_EQ(device.id, kCapturePrefix + "array");
+  EXPECT_TRUE(device.is_default);
+  EXPECT_TRUE(!f.registry->Find(kCapturePrefix + "missing", &device));
+
+  // Capture first, then by name.
+  const auto snapshot = f.registry->Snapshot();
+  EXPECT_EQ(snapshot.size(), 3u);
+  if (snapshot.size() == 3) {
+    EXPECT_EQ(snapshot[0].name, std::string("Headset Microphone"));
+    EXPECT_EQ(snapshot[1].name, std::string("Microphone Array"));
+    EXPECT_TRUE(snapshot[1].is_default);
+    EXPECT_EQ(snapshot[2].flow, AudioDeviceFlow::kRender);
+  }
+
+  // Cached: no further backend reads.
+  EXPECT_EQ(f.fake->enumerations.load(), 1);
+  EXPECT_EQ(f.fake->queries.load(), 0);
+}
+
+void TestChanges() {
+  Fixture f;
+  EXPECT_TRUE(f.registry->Start());
+  const uint64_t started = f.registry->version();
+  AudioDeviceInfo device;
+
+  // A USB mic is plugged in and becomes the default as it appears.
+  f.fake->Add(kCapturePrefix + "usb", "USB Mic", AudioDeviceFlow::kCapture);
+  f.fake->SetDefault(AudioDeviceFlow::kCapture, kCapturePrefix + "usb");
+  EXPECT_EQ(f.changes.load(), 2);
+  EXPECT_EQ(f.registry->version(), started + 2);
+  EXPECT_TRUE(f.registry->Default(AudioDeviceFlow::kCapture, &device));
+  EXPECT_EQ(device.name, std::string("USB Mic"));
+  // Only the changed device was re-read.
+  EXPECT_EQ(f.fake->queries.load(), 1);
+
+  // A renamed device is re-read on the next lookup.
+  f.fake->Add(kCapturePrefix + "headset", "Headset (2)", AudioDeviceFlow::kCapture);
+  EXPECT_TRUE(f.registry->Find(kCapturePrefix + "headset", &device));
+  EXPECT_EQ(device.name, std::string("Headset (2)"));
+
+  // Unplugged, and no capture device left as the default.
+  f.fake->Remove(kCapturePrefix + "usb");
+  f.fake->SetDefault(AudioDeviceFlow::kCapture, "");
+  EXPECT_TRUE(!f.registry->Find(kCapturePrefix + "usb", &device));
+  EXPECT_TRUE(!f.registry->Default(AudioDeviceFlow::kCapture, &device));
+  EXPECT_EQ(f.registry->Snapshot().size(), 3u);
+
+  // Stopped: notifications are ignored and the cache is empty.
+  f.registry->Stop();
+  const int changes = f.changes.load();
+  f.fake->Add(kCapturePrefix + "late", "Late", AudioDeviceFlow::kCapture);
+  EXPECT_EQ(f.changes.load(), changes);
+  EXPECT_TRUE(f.registry->Snapshot().empty());
+}
+
+void TestChurn() {
+  Fixture f;
+  EXPECT_TRUE(f.registry->Start());
+  std::atomic<bool> stop{false};
+  std::thread churn([&] {
+    for (int i = 0; !stop; i++) {
+      const std::string id = kCapturePrefix + "hot" + std::to_string(i % 4);
+      if (i % 2) {
+        f.fake->Remove(id);
+      } else {
+        f.fake->Add(id, "Hot", AudioDeviceFlow::kCapture);
+      }
+      if (i % 7 == 0) f.fake->SetDefault(AudioDeviceFlow::kRender, kRenderPrefix + "speakers");
+    }
+  });
+
+  // A device no notification is about stays found throughout.
+  constexpr int kLookups = 20000;
+  int found = 0;
+  for (int i = 0; i < kLookups; i++) {
+    AudioDeviceInfo device;
+    if (f.registry->Find(kCapturePrefix + "headset", &device)) found++;
+    const auto snapshot = f.registry->Snapshot();
+    EXPECT_TRUE(snapshot.size() >= 3 && snapshot.size() <= 7);
+  }
+  stop = true;
+  churn.join();
+  EXPECT_EQ(found, kLookups);
+
+  // Once quiet, the cache matches the backend again.
+  std::vector<AudioDeviceInfo> listed;
+  std::string defaults[2];
+  f.fake->Enumerate(&listed, &defaults[0], &defaults[1]);
+  EXPECT_EQ(f.registry->Snapshot().size(), listed.size());
+}
+
+}  // namespace
+
+int main() {
+  TestLookups();
+  TestChanges();
+  TestChurn();
+  return test_support::TestResult();
+}
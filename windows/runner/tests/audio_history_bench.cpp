@@ -0,0 +1,57 @@
+// Memory and CPU cost of AudioHistory against holding the same minute of
+// 16 kHz PCM16, for speech-like audio appended in 20 ms frames.
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "audio_history.h"
+#include "synthetic_audio.h"
+#include "test_support.h"
+
+namespace {
+
+constexpr size_t kSeconds = 60;
+constexpr size_t kSamples = kSeconds * synthetic_audio::kSampleRate;
+constexpr size_t kFrameSamples = 320;
+constexpr int kRounds = 20;
+
+}  // namespace
+
+int main() {
+  const std::vector<int16_t> input = synthetic_audio::Speech(kSamples, 11);
+  AudioHistory history(kSamples);
+
+  const auto encode_start = std::chrono::steady_clock::now();
+  for (int round = 0; round < kRounds; round++) {
+    history.Reset();
+    for (size_t i = 0; i < kSamples; i += kFrameSamples) {
+      history.Append(input.data() + i, kFrameSamples);
+    }
+  }
+  const double encode_seconds = test_support::SecondsSince(encode_start);
+
+  std::vector<int16_t> decoded;
+  const auto decode_start = std::chrono::steady_clock::now();
+  for (int round = 0; round < kRounds; round++) {
+    history.Read(0, kSamples, &decoded);
+  }
+  const double decode_seconds = test_support::SecondsSince(decode_start);
+
+  const size_t pcm_bytes = kSamples * sizeof(int16_t);
+  const double ratio = static_cast<double>(pcm_bytes) / history.memory_bytes();
+  const double audio_seconds = static_cast<double>(kSeconds) * kRounds;
+  EXPECT_EQ(decoded.size(), kSamples);
+  EXPECT_TRUE(ratio > 3.5);
+
+  std::printf("%zu s of audio: PCM16 %zu bytes, history %zu bytes (%.2fx smaller)\n", kSeconds,
+              pcm_bytes, history.memory_bytes(), ratio);
+  std::printf("encode %.0fx realtime (%.2f us per 20 ms frame)\n",
+              audio_seconds / encode_seconds,
+              encode_seconds * 1e6 / (kRounds * (kSamples / kFrameSamples)));
+  std::printf("decode %.0fx realtime (%.2f ms per minute read)\n",
+              audio_seconds / decode_seconds, decode_seconds * 1e3 / kRounds);
+  std::printf("round trip SNR %.1f dB\n",
+              synthetic_audio::SnrDb(input.data(), decoded.data(), decoded.size()));
+  return test_support::TestResult();
+}
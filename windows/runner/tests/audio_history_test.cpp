@@ -0,0 +1,134 @@
+// Round trip of AudioHistory: ADPCM quality, block-granular random access,
+// ring overwrite and pool-driven shrinking.
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "audio_history.h"
+#include "memory_governor.h"
+#include "synthetic_audio.h"
+#include "test_support.h"
+
+namespace {
+
+constexpr size_t kSeconds = 10;
+constexpr size_t kSamples = kSeconds * synthetic_audio::kSampleRate;
+
+void TestRoundTrip() {
+  const std::vector<int16_t> input = synthetic_audio::Speech(kSamples, 1);
+  AudioHistory history(kSamples);
+  history.Append(input.data(), input.size());
+  EXPECT_EQ(history.begin_sample(), 0u);
+  EXPECT_EQ(history.end_sample(), kSamples);
+
+  std::vector<int16_t> decoded;
+  EXPECT_EQ(history.Read(0, kSamples, &decoded), 0u);
+  EXPECT_EQ(decoded.size(), kSamples);
+  const double snr = synthetic_audio::SnrDb(input.data(), decoded.data(), decoded.size());
+  std::printf("round trip SNR %.1f dB\n", snr);
+  EXPECT_TRUE(snr > 20.0);
+
+  // Samples of the open block are still PCM and come back exactly.
+  const size_t open = kSamples % AudioHistory::kSamplesPerBlock;
+  EXPECT_TRUE(open > 0);
+  EXPECT_TRUE(std::equal(input.end() - open, input.end(), decoded.end() - open));
+
+  // Block headers carry the first sample verbatim.
+  for (size_t i = 0; i + AudioHistory::kSamplesPerBlock <= kSamples;
+       i += AudioHistory::kSamplesPerBlock) {
+    EXPECT_EQ(decoded[i], input[i]);
+  }
+}
+
+void TestRandomAccess() {
+  const std::vector<int16_t> input = synthetic_audio::Speech(kSamples, 2);
+  AudioHistory history(kSamples);
+  history.Append(input.data(), input.size());
+  std::vector<int16_t> all;
+  history.Read(0, kSamples, &all);
+
+  // Reads starting and ending mid-block decode the same samples as a full read.
+  const size_t starts[] = {1, 504, 505, 1234, 50000, kSamples - 600};
+  for (const size_t start : starts) {
+    std::vector<int16_t> part;
+    EXPECT_EQ(history.Read(start, 777, &part), start);
+    EXPECT_EQ(part.size(), std::min<size_t>(777, kSamples - start));
+    EXPECT_TRUE(std::equal(part.begin(), part.end(), all.begin() + start));
+  }
+
+  // Reads past the end are clipped.
+  std::vector<int16_t> tail;
+  history.Read(kSamples - 10, 100, &tail);
+  EXPECT_EQ(tail.size(), 10u);
+
+  // Little-endian byte input and output match the sample API.
+  std::vector<uint8_t> bytes(input.size() * 2);
+  for (size_t i = 0; i < input.size(); i++) {
+    bytes[i * 2] = static_cast<uint8_t>(input[i] & 0xFF);
+    bytes[i * 2 + 1] = static_cast<uint8_t>((input[i] >> 8) & 0xFF);
+  }
+  AudioHistory from_bytes(kSamples);
+  from_bytes.AppendPcm16(bytes.data(), bytes.size());
+  const std::vector<uint8_t> latest = from_bytes.ReadLatestPcm16(1000);
+  EXPECT_EQ(latest.size(), 2000u);
+  for (size_t i = 0; i < 1000; i++) {
+    const int16_t s = static_cast<int16_t>(latest[i * 2] | (latest[i * 2 + 1] << 8));
+    EXPECT_EQ(s, all[kSamples - 1000 + i]);
+  }
+}
+
+void TestRingOverwrite() {
+  const size_t capacity = synthetic_audio::kSampleRate;  // 1 s
+  const std::vector<int16_t> input = synthetic_audio::Speech(kSamples, 3);
+  AudioHistory history(capacity);
+  for (size_t i = 0; i < input.size(); i += 320) {
+    history.Append(input.data() + i, std::min<size_t>(320, input.size() - i));
+  }
+  const size_t blocks = (capacity + AudioHistory::kSamplesPerBlock - 1) /
+                        AudioHistory::kSamplesPerBlock;
+  EXPECT_EQ(history.capacity_bytes(), blocks * AudioHistory::kBlockBytes);
+  EXPECT_EQ(history.end_sample(), kSamples);
+  EXPECT_EQ(history.begin_sample() % AudioHistory::kSamplesPerBlock, 0u);
+  EXPECT_TRUE(history.end_sample() - history.begin_sample() >= capacity);
+
+  // Reading from an overwritten index starts at the oldest sample held.
+  std::vector<int16_t> out;
+  EXPECT_EQ(history.Read(0, kSamples, &out), history.begin_sample());
+  EXPECT_EQ(out.size(), history.end_sample() - history.begin_sample());
+  const size_t begin = static_cast<size_t>(history.begin_sample());
+  EXPECT_TRUE(synthetic_audio::SnrDb(input.data() + begin, out.data(), out.size()) > 20.0);
+
+  history.Reset();
+  EXPECT_EQ(history.end_sample(), 0u);
+  EXPECT_EQ(history.memory_bytes(), 0u);
+}
+
+void TestFitToPool() {
+  const std::vector<int16_t> input = synthetic_audio::Speech(kSamples, 4);
+  AudioHistory history(kSamples);
+  history.Append(input.data(), input.size());
+  const uint64_t end = history.end_sample();
+
+  // A pool limited to 8 blocks shrinks the ring and keeps the newest audio.
+  MemoryPool pool("history", MemoryGovernor::kPriorityHistory, 0,
+                  8 * AudioHistory::kBlockBytes, AudioHistory::kBlockBytes);
+  history.FitToPool(&pool);
+  EXPECT_EQ(history.capacity_bytes(), 8 * AudioHistory::kBlockBytes);
+  EXPECT_EQ(pool.used(), history.capacity_bytes());
+  EXPECT_EQ(history.end_sample(), end);
+  std::vector<int16_t> out;
+  history.Read(0, kSamples, &out);
+  const size_t begin = static_cast<size_t>(history.begin_sample());
+  EXPECT_TRUE(synthetic_audio::SnrDb(input.data() + begin, out.data(), out.size()) > 20.0);
+}
+
+}  // namespace
+
+int main() {
+  TestRoundTrip();
+  TestRandomAccess();
+  TestRingOverwrite();
+  TestFitToPool();
+  return test_support::TestResult();
+}
@@ -0,0 +1,181 @@
+// AudioQualityMeter accuracy against signals whose answers are known:
+// clipping and DC offset, SNR of a tone over a noise floor at several ratios,
+// dropouts and digital silence of given lengths, the spectral tilt of white
+// and muffled noise, and a summary that does not depend on how the stream is
+// chunked.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "audio_quality.h"
+#include "test_support.h"
+
+namespace {
+
+constexpr int kSampleRate = 16000;
+constexpr double kPi = 3.14159265358979323846;
+
+bool Near(double value, double expected, double tolerance) {
+  return std::fabs(value - expected) <= tolerance;
+}
+
+AudioQualityMeter::Summary Measure(const std::vector<float>& audio, size_t chunk = 640) {
+  AudioQualityMeter meter;
+  for (size_t i = 0; i < audio.size(); i += chunk) {
+    meter.Process(&audio[i], (std::min)(chunk, audio.size() - i));
+  }
+  return meter.GetSummary();
+}
+
+// White noise at |rms|; never exactly zero, so it contains no zero runs.
+std::vector<float> Noise(size_t samples, double rms, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> noise(0.0, rms);
+  std::vector<float> out(samples);
+  for (float& s : out) {
+    s = static_cast<float>(noise(rng));
+    if (s == 0.0f) s = 1e-6f;
+  }
+  return out;
+}
+
+void AddTone(std::vector<float>* audio, size_t start, size_t count, double rms, double hz) {
+  for (size_t i = 0; i < count; i++) {
+    (*audio)[start + i] += static_cast<float>(rms * std::sqrt(2.0) *
+                                              std::sin(2 * kPi * hz * i / kSampleRate));
+  }
+}
+
+void TestClippingAndDc() {
+  // A 1.2 amplitude sine clipped at full scale, at a frequency the sample
+  // rate does not divide: at or above 0.99 while |sin| >= 0.99 / 1.2.
+  std::vector<float> audio(kSampleRate * 2);
+  for (size_t i = 0; i < audio.size(); i++) {
+    const double x = 1.2 * std::sin(2 * kPi * 313.7 * i / kSampleRate);
+    audio[i] = static_cast<float>((std::max)(-1.0, (std::min)(1.0, x)));
+  }
+  const double expected_clip = 1 - 2 / kPi * std::asin(0.99 / 1.2);
+  AudioQualityMeter::Summary summary = Measure(audio);
+  std::printf("clip rate %.4f (expected %.4f)\n", summary.clip_rate, expected_clip);
+  EXPECT_TRUE(Near(summary.clip_rate, expected_clip, 0.005));
+  EXPECT_TRUE(Near(summary.dc_offset, 0.0, 1e-3));
+
+  audio = Noise(kSampleRate * 2, 0.05, 1);
+  for (float& s : audio) s += 0.04f;
+  summary = Measure(audio);
+  std::printf("dc offset %.4f (expected 0.0400)\n", summary.dc_offset);
+  EXPECT_TRUE(Near(summary.dc_offset, 0.04, 1e-3));
+  EXPECT_EQ(summary.clip_rate, 0.0);
+}
+
+// Half the time a -20 dBFS tone over the floor, half the floor alone: p95 is
+// the tone, p10 the floor and the SNR their difference.
+void TestSnr() {
+  for (const double snr : {10.0, 20.0, 30.0, 40.0, 50.0}) {
+    const double tone_db = -20;
+    std::vector<float> audio = Noise(kSampleRate * 20, std::pow(10.0, (tone_db - snr) / 20), 2);
+    for (size_t second = 0; second < 20; second += 2) {
+      AddTone(&audio, second * kSampleRate, kSampleRate, std::pow(10.0, tone_db / 20), 440);
+    }
+    const AudioQualityMeter::Summary summary = Measure(audio);
+    // The tone frames carry the floor too.
+    const double expected_p95 = 10 * std::log10(std::pow(10.0, tone_db / 10) +
+                                                std::pow(10.0, (tone_db - snr) / 10));
+    std::printf("snr %2.0f dB: estimated %5.1f dB, p95 %6.1f (expected %6.1f), p10 %6.1f (expected %6.1f)\n",
+                snr, summary.snr_db, summary.level_p95_db, expected_p95, summary.level_p10_db,
+                tone_db - snr);
+    // Levels are kept in 1 dB bins; a frame of noise varies by about a dB.
+    EXPECT_TRUE(Near(summary.level_p95_db, expected_p95, 1.0));
+    EXPECT_TRUE(Near(summary.level_p10_db, tone_db - snr, 1.5));
+    EXPECT_TRUE(Near(summary.snr_db, snr, 2.0));
+  }
+}
+
+void TestDropoutsAndSilence() {
+  // Zero runs inside the signal: 2 ms is too short to count, 10/50/150 ms
+  // are dropouts, 300 ms is digital silence, as are the leading 100 ms.
+  const int run_ms[] = {2, 10, 50, 150, 300};
+  std::vector<float> audio(kSampleRate / 10, 0.0f);
+  for (const int ms : run_ms) {
+    const std::vector<float> signal = Noise(kSampleRate / 2, 0.05, ms);
+    audio.insert(audio.end(), signal.begin(), signal.end());
+    audio.insert(audio.end(), static_cast<size_t>(ms) * kSampleRate / 1000, 0.0f);
+  }
+  const std::vector<float> tail = Noise(kSampleRate / 2, 0.05, 99);
+  audio.insert(audio.end(), tail.begin(), tail.end());
+
+  AudioQualityMeter meter;
+  meter.Process(audio.data(), audio.size());
+  meter.AddDiscontinuity();
+  meter.AddIdle(kSampleRate);
+  const AudioQualityMeter::Summary summary = meter.GetSummary();
+  std::printf("dropouts %llu, %.0f ms (expected 3, 210 ms); digital silence %.0f ms (expected 400 ms)\n",
+              static_cast<unsigned long long>(summary.dropouts), summary.dropout_ms,
+              summary.digital_silence_ms);
+  EXPECT_EQ(summary.dropouts, 3u);
+  EXPECT_TRUE(Near(summary.dropout_ms, 210, 0.1));
+  EXPECT_TRUE(Near(summary.digital_silence_ms, 400, 0.1));
+  EXPECT_EQ(summary.discontinuities, 1u);
+  EXPECT_TRUE(Near(summary.idle_ms, 1000, 0.1));
+  EXPECT_TRUE(Near(summary.seconds, static_cast<double>(audio.size()) / kSampleRate + 1, 1e-9));
+}
+
+void TestSpectralTilt() {
+  const std::vector<float> white = Noise(kSampleRate * 5, 0.05, 3);
+  // One-pole low-pass: most energy far below a few hundred Hz.
+  std::vector<float> muffled(white.size());
+  float state = 0.0f;
+  for (size_t i = 0; i < white.size(); i++) {
+    state = 0.95f * state + 0.05f * white[i] * 4;
+    muffled[i] = state;
+  }
+  std::vector<float> hissy = muffled;
+  const std::vector<float> hiss = Noise(hissy.size(), 0.01, 4);
+  for (size_t i = 0; i < hissy.size(); i++) hissy[i] += hiss[i];
+
+  const double white_tilt = Measure(white).spectral_tilt_db;
+  const double muffled_tilt = Measure(muffled).spectral_tilt_db;
+  const double hissy_tilt = Measure(hissy).spectral_tilt_db;
+  std::printf("spectral tilt: white %.1f dB, muffled %.1f dB, muffled with hiss %.1f dB\n",
+              white_tilt, muffled_tilt, hissy_tilt);
+  EXPECT_TRUE(Near(white_tilt, 0.0, 0.5));
+  // A one-pole low-pass at a = 0.95: high/low energy of (1-a)/(1+a), -15.9 dB.
+  EXPECT_TRUE(Near(muffled_tilt, 10 * std::log10(0.05 / 1.95), 1.0));
+  EXPECT_TRUE(hissy_tilt > muffled_tilt + 3 && hissy_tilt < -1);
+}
+
+// The same stream in 1-sample, odd-sized and whole chunks gives one summary.
+void TestChunking() {
+  std::vector<float> audio = Noise(kSampleRate * 3, 0.01, 5);
+  AddTone(&audio, kSampleRate, kSampleRate, 0.2, 300);
+  for (size_t i = 2 * kSampleRate; i < 2 * kSampleRate + 800; i++) audio[i] = 0.0f;
+
+  const AudioQualityMeter::Summary whole = Measure(audio, audio.size());
+  for (const size_t chunk : {size_t{1}, size_t{37}, size_t{160}, size_t{1001}}) {
+    const AudioQualityMeter::Summary summary = Measure(audio, chunk);
+    EXPECT_EQ(summary.samples, whole.samples);
+    EXPECT_EQ(summary.level_histogram, whole.level_histogram);
+    EXPECT_EQ(summary.dropouts, whole.dropouts);
+    EXPECT_TRUE(Near(summary.spectral_tilt_db, whole.spectral_tilt_db, 1e-6));
+    EXPECT_TRUE(Near(summary.dc_offset, whole.dc_offset, 1e-9));
+  }
+  EXPECT_EQ(whole.dropouts, 1u);
+  // Every 10 ms frame but the five of digital silence has a level.
+  uint32_t frames = 0;
+  for (const uint32_t count : whole.level_histogram) frames += count;
+  EXPECT_EQ(frames, static_cast<uint32_t>(audio.size() / 160 - 5));
+}
+
+}  // namespace
+
+int main() {
+  TestClippingAndDc();
+  TestSnr();
+  TestDropoutsAndSilence();
+  TestSpectralTilt();
+  TestChunking();
+  return test_support::TestResult();
+}
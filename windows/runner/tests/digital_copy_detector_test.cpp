@@ -0,0 +1,206 @@
+// DigitalCopyDetector on synthetic streams: system audio looped into the mic
+// at another gain, a delay and through a different resampler, with a noise
+// floor and jittery timestamps, is a copy at the right lag; a second talker
+// on the mic is not; speech into a real mic ends copy mode within about a
+// second; and a gap in the mic stream does not lose the copy.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "digital_copy_detector.h"
+#include "formant_speech.h"
+#include "test_support.h"
+
+namespace {
+
+constexpr int kSamplesPerMs = formant_speech::kSampleRate / 1000;
+constexpr int64_t kStartMs = 1000000;
+
+// |seconds| of words with short pauses between them.
+std::vector<float> Talk(uint32_t seed, double seconds) {
+  formant_speech::Synthesizer synthesizer(seed);
+  const formant_speech::Voice voice = synthesizer.RandomVoice();
+  std::vector<float> out;
+  const size_t samples = static_cast<size_t>(seconds * formant_speech::kSampleRate);
+  while (out.size() < samples) {
+    synthesizer.Say(synthesizer.RandomWord({}), voice, &out);
+    synthesizer.Pause(synthesizer.Uniform(0.05f, 0.4f), &out);
+  }
+  out.resize(samples);
+  return out;
+}
+
+// What a loopback path does to |audio|: |delay_ms| later, at |gain|, shifted
+// by a fraction of a sample through a linear-interpolating resampler, over
+// a noise floor at |noise| RMS.
+std::vector<float> CopyPath(const std::vector<float>& audio, int delay_ms, float gain, float noise,
+                            uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> floor(0.0f, noise);
+  const size_t delay = static_cast<size_t>(delay_ms) * kSamplesPerMs;
+  const float fraction = 0.37f;
+  std::vector<float> out(audio.size());
+  for (size_t i = 0; i < out.size(); i++) {
+    float x = 0.0f;
+    if (i > delay && i - delay < audio.size()) {
+      const size_t j = i - delay;
+      x = (1 - fraction) * audio[j] + fraction * audio[j - 1];
+    }
+    out[i] = gain * x + floor(rng);
+  }
+  return out;
+}
+
+// The detector's status after every mic buffer.
+struct Trace {
+  std::vector<int64_t> ms;
+  std::vector<DigitalCopyDetector::Status> status;
+
+  // First time from |from_ms| on at which |copy| held; -1 if never.
+  int64_t FirstAt(bool copy, int64_t from_ms = 0) const {
+    for (size_t i = 0; i < ms.size(); i++) {
+      if (ms[i] >= from_ms && status[i].copy == copy) return ms[i];
+    }
+    return -1;
+  }
+  bool AlwaysFrom(bool copy, int64_t from_ms) const {
+    for (size_t i = 0; i < ms.size(); i++) {
+      if (ms[i] >= from_ms && status[i].copy != copy) return false;
+    }
+    return true;
+  }
+};
+
+// Feeds both streams as their capture threads would: the system in 10 ms
+// buffers, the mic in 30 ms ones, each stamped with its end time plus a few
+// ms of jitter. Mic samples from |mic_skip_at| on are dropped for
+// |mic_skip_ms|, with the clock running on. Records the status after every
+// mic buffer.
+Trace Run(DigitalCopyDetector* detector, const std::vector<float>& system,
+          const std::vector<float>& mic, int64_t mic_skip_at = -1, int64_t mic_skip_ms = 0) {
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> jitter(-3, 3);
+  Trace trace;
+  const size_t system_chunk = 10 * kSamplesPerMs;
+  const size_t mic_chunk = 30 * kSamplesPerMs;
+  size_t system_done = 0;
+  size_t mic_done = 0;
+  for (int64_t ms = 10; mic_done + mic_chunk <= mic.size(); ms += 10) {
+    const size_t due = static_cast<size_t>(ms) * kSamplesPerMs;
+    for (; system_done + system_chunk <= (std::min)(due, system.size()); system_done += system_chunk) {
+      detector->PushSystem(&system[system_done], system_chunk,
+                           kStartMs + static_cast<int64_t>((system_done + system_chunk) / kSamplesPerMs) +
+                               jitter(rng));
+    }
+    for (; mic_done + mic_chunk <= (std::min)(due, mic.size()); mic_done += mic_chunk) {
+      const int64_t end_ms = static_cast<int64_t>((mic_done + mic_chunk) / kSamplesPerMs);
+      if (mic_skip_at >= 0 && end_ms > mic_skip_at && end_ms <= mic_skip_at + mic_skip_ms) continue;
+      detector->PushMic(&mic[mic_done], mic_chunk, kStartMs + end_ms + jitter(rng));
+      trace.ms.push_back(ms);
+      trace.status.push_back(detector->status());
+    }
+  }
+  return trace;
+}
+
+void TestLoopedSystemAudio() {
+  for (const int delay_ms : {0, 40, 120, 350, 900}) {
+    for (const float gain : {0.05f, 1.6f}) {
+      const std::vector<float> system = Talk(1 + delay_ms, 12);
+      const std::vector<float> mic = CopyPath(system, delay_ms, gain, 0.0003f * gain, 2);
+      DigitalCopyDetector detector;
+      const Trace trace = Run(&detector, system, mic);
+      const int64_t detected = trace.FirstAt(true);
+      const DigitalCopyDetector::Status status = detector.status();
+      std::printf("copy at %3d ms, gain %.2f: detected after %5lld ms, lag %3d ms, %4.1f%% bits differ\n",
+                  delay_ms, gain, static_cast<long long>(detected), status.lag_ms,
+                  status.bit_error_rate * 100);
+      EXPECT_TRUE(detected > 0 && detected <= 4000);
+      EXPECT_TRUE(trace.AlwaysFrom(true, detected));
+      EXPECT_TRUE(std::abs(status.lag_ms - delay_ms) <= 10);
+      EXPECT_TRUE(status.bit_error_rate <= 0.15);
+      EXPECT_EQ(status.changes, 1u);
+      EXPECT_TRUE(status.copy_ms > 0);
+    }
+  }
+}
+
+void TestIndependentTalker() {
+  for (uint32_t seed = 10; seed < 14; seed++) {
+    const std::vector<float> system = Talk(seed, 20);
+    const std::vector<float> mic = Talk(seed + 100, 20);
+    DigitalCopyDetector detector;
+    const Trace trace = Run(&detector, system, mic);
+    const DigitalCopyDetector::Status status = detector.status();
+    std::printf("independent talker %u: copy %s, %4.1f%% bits differ\n", seed,
+                trace.FirstAt(true) < 0 ? "never" : "seen", status.bit_error_rate * 100);
+    EXPECT_EQ(trace.FirstAt(true), -1);
+    EXPECT_EQ(status.changes, 0u);
+    EXPECT_EQ(status.copy_ms, 0u);
+  }
+}
+
+// The loop is switched off after 8 s and the user speaks into the mic.
+void TestRealSpeechEndsCopy() {
+  const std::vector<float> system = Talk(20, 16);
+  std::vector<float> mic = CopyPath(system, 60, 0.8f, 0.0003f, 3);
+  const std::vector<float> user = Talk(21, 8);
+  const size_t switch_at = 8 * formant_speech::kSampleRate;
+  std::copy(user.begin(), user.end(), mic.begin() + switch_at);
+
+  DigitalCopyDetector detector;
+  const Trace trace = Run(&detector, system, mic);
+  const int64_t ended = trace.FirstAt(false, 8000);
+  std::printf("real speech at 8000 ms: copy from %lld ms, ended at %lld ms\n",
+              static_cast<long long>(trace.FirstAt(true)), static_cast<long long>(ended));
+  EXPECT_TRUE(trace.FirstAt(true) > 0 && trace.FirstAt(true) < 8000);
+  EXPECT_TRUE(ended >= 8000 && ended <= 9500);
+  EXPECT_TRUE(trace.AlwaysFrom(false, ended));
+  EXPECT_EQ(detector.status().changes, 2u);
+}
+
+// Half a second of mic buffers lost mid-copy: the mic clock jumps, its coder
+// re-anchors on the new timestamps and the lag is unchanged.
+void TestMicGap() {
+  const std::vector<float> system = Talk(30, 14);
+  const std::vector<float> mic = CopyPath(system, 200, 0.5f, 0.0003f, 4);
+  DigitalCopyDetector detector;
+  const Trace trace = Run(&detector, system, mic, 6000, 500);
+  const DigitalCopyDetector::Status status = detector.status();
+  std::printf("mic gap at 6000 ms: copy from %lld ms, lag %d ms, %llu changes\n",
+              static_cast<long long>(trace.FirstAt(true)), status.lag_ms,
+              static_cast<unsigned long long>(status.changes));
+  EXPECT_TRUE(trace.FirstAt(true) > 0 && trace.FirstAt(true) < 6000);
+  EXPECT_TRUE(trace.AlwaysFrom(true, trace.FirstAt(true)));
+  EXPECT_TRUE(std::abs(status.lag_ms - 200) <= 10);
+  EXPECT_EQ(status.changes, 1u);
+}
+
+// Silence on both sides says nothing; Reset forgets a detected copy.
+void TestSilenceAndReset() {
+  const std::vector<float> system = Talk(40, 8);
+  DigitalCopyDetector detector;
+  Run(&detector, system, CopyPath(system, 30, 1.0f, 0.0003f, 5));
+  EXPECT_TRUE(detector.is_copy());
+  const std::vector<float> silence(4 * formant_speech::kSampleRate, 0.0f);
+  detector.PushSystem(silence.data(), silence.size(), kStartMs + 12000);
+  EXPECT_TRUE(detector.PushMic(silence.data(), silence.size(), kStartMs + 12030));
+  detector.Reset();
+  EXPECT_TRUE(!detector.is_copy());
+  EXPECT_EQ(detector.status().copy_ms, 0u);
+}
+
+}  // namespace
+
+int main() {
+  TestLoopedSystemAudio();
+  TestIndependentTalker();
+  TestRealSpeechEndsCopy();
+  TestMicGap();
+  TestSilenceAndReset();
+  return test_support::TestResult();
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "audio_device_registry.h"
+
+// In-memory AudioDeviceBackend for the registry's test and benchmark. Each
+// endpoint read (per device in Enumerate, and every Query) busy-waits
+// |read_cost_us| to model the property-store reads of the WASAPI backend.
+// Add, Remove and SetDefault notify like the OS would, on the caller's thread.
+class FakeAudioDeviceBackend : public AudioDeviceBackend {
+ public:
+  explicit FakeAudioDeviceBackend(int read_cost_us = 0) : read_cost_us_(read_cost_us) {}
+
+  bool Enumerate(std::vector<AudioDeviceInfo>* devices, std::string* default_capture,
+                 std::string* default_render) override {
+    enumerations++;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : devices_) {
+      Spin();
+      devices->push_back(entry.second);
+    }
+    *default_capture = defaults_[0];
+    *default_render = defaults_[1];
+    return true;
+  }
+
+  bool Query(const std::string& id, AudioDeviceInfo* device) override {
+    queries++;
+    Spin();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = devices_.find(id);
+    if (it == devices_.end()) return false;
+    *device = it->second;
+    return true;
+  }
+
+  bool Subscribe(Observer* observer) override {
+    observer_ = observer;
+    return true;
+  }
+  void Unsubscribe() override { observer_ = nullptr; }
+
+  void Add(const std::string& id, const std::string& name, AudioDeviceFlow flow) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      AudioDeviceInfo& device = devices_[id];
+      device.id = id;
+      device.name = name;
+      device.flow = flow;
+      device.format = {48000, 2, 32, true};
+    }
+    if (Observer* observer = observer_) observer->OnDeviceChanged(id);
+  }
+
+  void Remove(const std::string& id) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      devices_.erase(id);
+    }
+    if (Observer* observer = observer_) observer->OnDeviceChanged(id);
+  }
+
+  void SetDefault(AudioDeviceFlow flow, const std::string& id) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      defaults_[static_cast<int>(flow)] = id;
+    }
+    if (Observer* observer = observer_) observer->OnDefaultChanged(flow, id);
+  }
+
+  std::atomic<int> enumerations{0};
+  std::atomic<int> queries{0};
+
+ private:
+  void Spin() const {
+    const auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(read_cost_us_);
+    while (std::chrono::steady_clock::now() < until) {
+    }
+  }
+
+  const int read_cost_us_;
+  std::mutex mutex_;
+  std::map<std::string, AudioDeviceInfo> devices_;
+  std::string defaults_[2];
+  std::atomic<Observer*> observer_{nullptr};
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Deterministic formant-synthesized speech for the keyword spotter
+// evaluation: phone sequences rendered by a glottal pulse train (or noise
+// for fricatives) through three resonators, with coarticulated formant
+// transitions and a per-speaker pitch, vocal-tract scale, tempo and level.
+// Crude next to real speech, but it has the spectral structure the
+// detectors key on and any amount of it can be generated reproducibly.
+namespace formant_speech {
+
+constexpr int kSampleRate = 16000;
+constexpr double kPi = 3.14159265358979323846;
+
+struct Phone {
+  float f1, f2, f3;  // Formants in Hz
+  bool voiced;
+};
+
+// A small vowel and fricative inventory; words are index sequences.
+constexpr Phone kPhones[] = {
+    {730, 1090, 2440, true},  {270, 2290, 3010, true}, {300, 870, 2240, true},
+    {530, 1840, 2480, true},  {570, 840, 2410, true},  {660, 1720, 2410, true},
+    {490, 1350, 1690, true},  {440, 1020, 2240, true}, {0, 4500, 6000, false},
+    {0, 2500, 3500, false},   {390, 1990, 2550, true}, {640, 1190, 2390, true}};
+constexpr int kPhoneCount = static_cast<int>(sizeof(kPhones) / sizeof(kPhones[0]));
+
+struct Voice {
+  float pitch = 130.0f;  // Hz
+  float formant_scale = 1.0f;
+  float tempo = 1.0f;  // Phone duration factor
+  float level = 1.0f;
+};
+
+class Synthesizer {
+ public:
+  explicit Synthesizer(uint32_t seed) : rng_(seed) {}
+
+  float Uniform(float lo, float hi) { return std::uniform_real_distribution<float>(lo, hi)(rng_); }
+  uint32_t Next() { return rng_(); }
+
+  // A random speaker.
+  Voice RandomVoice() {
+    return Voice{Uniform(90, 220), Uniform(0.9f, 1.12f), Uniform(0.8f, 1.2f), Uniform(0.6f, 1.2f)};
+  }
+  // |v| on another take: slightly different pitch, tract, tempo and level.
+  Voice Near(const Voice& v) {
+    return Voice{v.pitch * Uniform(0.9f, 1.1f), v.formant_scale * Uniform(0.97f, 1.03f),
+                 v.tempo * Uniform(0.85f, 1.15f), Uniform(0.5f, 1.5f)};
+  }
+
+  // 3-6 random phones, never equal to |avoid|.
+  std::vector<int> RandomWord(const std::vector<int>& avoid) {
+    std::vector<int> word(3 + Next() % 4);
+    for (int& p : word) p = static_cast<int>(Next() % kPhoneCount);
+    if (word == avoid) word[0] = (word[0] + 1) % kPhoneCount;
+    return word;
+  }
+
+  // Appends |phones| spoken by |voice| to |out| (float, full scale 1.0).
+  void Say(const std::vector<int>& phones, const Voice& voice, std::vector<float>* out) {
+    double phase = 0.0;
+    float state[3][2] = {};
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    for (size_t k = 0; k < phones.size(); k++) {
+      const Phone& phone = kPhones[phones[k]];
+      const Phone& next = kPhones[phones[(std::min)(k + 1, phones.size() - 1)]];
+      const int length = static_cast<int>(kSampleRate * 0.12f * voice.tempo * Uniform(0.9f, 1.1f));
+      for (int i = 0; i < length; i++) {
+        const float a = static_cast<float>(i) / length;
+        // Glide into the next phone over the last 30%.
+        const float blend = a > 0.7f ? (a - 0.7f) / 0.3f : 0.0f;
+        const float formants[3] = {
+            (phone.f1 * (1 - blend) + next.f1 * blend) * voice.formant_scale,
+            (phone.f2 * (1 - blend) + next.f2 * blend) * voice.formant_scale,
+            (phone.f3 * (1 - blend) + next.f3 * blend) * voice.formant_scale};
+        float source;
+        if (phone.voiced) {
+          phase += voice.pitch * (1.0f + 0.05f * std::sin(i * 0.002f)) / kSampleRate;
+          source = (phase - std::floor(phase)) < 0.1 ? 1.0f : -0.11f;
+        } else {
+          source = 0.3f * noise(rng_);
+        }
+        float sample = 0.0f;
+        for (int r = 0; r < 3; r++) {
+          if (formants[r] <= 0) continue;
+          const float bandwidth = 80.0f + r * 40.0f;
+          const float radius = std::exp(-static_cast<float>(kPi) * bandwidth / kSampleRate);
+          const float theta = 2.0f * static_cast<float>(kPi) * formants[r] / kSampleRate;
+          const float y = source + 2 * radius * std::cos(theta) * state[r][0] -
+                          radius * radius * state[r][1];
+          state[r][1] = state[r][0];
+          state[r][0] = y;
+          sample += y * (r == 0 ? 1.0f : 0.5f);
+        }
+        const float envelope = (std::min)(1.0f, (std::min)(a * 8, (1 - a) * 8) + 0.6f);
+        out->push_back(0.02f * voice.level * sample * envelope);
+      }
+    }
+  }
+
+  // Appends |seconds| of a low noise floor.
+  void Pause(float seconds, std::vector<float>* out) {
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    const int length = static_cast<int>(kSampleRate * seconds);
+    for (int i = 0; i < length; i++) out->push_back(0.0005f * noise(rng_));
+  }
+
+  void AddNoise(float level, std::vector<float>* audio) {
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    for (float& x : *audio) x += level * noise(rng_);
+  }
+
+ private:
+  std::mt19937 rng_;
+};
+
+inline std::vector<uint8_t> ToPcm16(const std::vector<float>& audio) {
+  std::vector<uint8_t> out(audio.size() * 2);
+  for (size_t i = 0; i < audio.size(); i++) {
+    const int s = static_cast<int>((std::max)(-32768.0f, (std::min)(32767.0f, audio[i] * 32767)));
+    out[i * 2] = static_cast<uint8_t>(s & 0xFF);
+    out[i * 2 + 1] = static_cast<uint8_t>((s >> 8) & 0xFF);
+  }
+  return out;
+}
+
+}  // namespace formant_speech
@@ -0,0 +1,144 @@
+// Offline false-reject / false-accept and CPU evaluation of KeywordSpotter
+// on formant-synthesized fixtures:
+//  - enrollment: 3 takes of the keyword by the user's voice;
+//  - positives: 200 keyword utterances by that voice in babble, each after
+//    three random words from random speakers;
+//  - negatives: an hour of keyword-free babble, a third of it in the
+//    user's voice.
+// Optional argv[1] overrides the threshold; argv[2] the negative minutes.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "formant_speech.h"
+#include "keyword_spotter.h"
+#include "test_support.h"
+
+namespace {
+
+using formant_speech::kSampleRate;
+
+constexpr int kPositives = 200;
+constexpr size_t kFeedSamples = 1600;  // 100 ms pushes, like MicStream
+// A hit counts for a keyword when it lands between the middle of the phrase
+// and 500 ms after its end.
+constexpr size_t kLateSamples = kSampleRate / 2;
+
+const std::vector<int> kKeyword = {4, 8, 3, 7, 1};
+
+struct Run {
+  std::vector<uint64_t> hit_ends;
+  double cpu_seconds = 0.0;
+};
+
+Run Detect(KeywordSpotter* spotter, const std::vector<float>& audio) {
+  Run run;
+  spotter->Reset();
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < audio.size(); i += kFeedSamples) {
+    spotter->Process(audio.data() + i, (std::min)(kFeedSamples, audio.size() - i));
+    KeywordSpotter::Hit hit;
+    while (spotter->PollHit(&hit)) run.hit_ends.push_back(hit.end_sample);
+  }
+  run.cpu_seconds = test_support::SecondsSince(start);
+  return run;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const bool custom_threshold = argc > 1;
+  const float threshold = custom_threshold ? static_cast<float>(std::atof(argv[1])) : 1.0f;
+  const int negative_minutes = argc > 2 ? std::atoi(argv[2]) : 60;
+
+  formant_speech::Synthesizer synth(7);
+  const formant_speech::Voice user;
+
+  KeywordSpotter spotter(threshold);
+  for (int take = 0; take < 3; take++) {
+    std::vector<float> audio;
+    synth.Pause(0.3f, &audio);
+    formant_speech::Voice voice = user;
+    voice.pitch *= synth.Uniform(0.95f, 1.05f);
+    voice.tempo *= synth.Uniform(0.9f, 1.1f);
+    synth.Say(kKeyword, voice, &audio);
+    synth.Pause(0.3f, &audio);
+    const std::vector<uint8_t> pcm = formant_speech::ToPcm16(audio);
+    EXPECT_TRUE(spotter.AddTemplate(0, pcm.data(), pcm.size()));
+  }
+
+  std::vector<float> positives;
+  std::vector<std::pair<size_t, size_t>> spans;
+  for (int i = 0; i < kPositives; i++) {
+    for (int w = 0; w < 3; w++) {
+      synth.Say(synth.RandomWord(kKeyword), synth.RandomVoice(), &positives);
+      synth.Pause(synth.Uniform(0.05f, 0.4f), &positives);
+    }
+    const size_t begin = positives.size();
+    synth.Say(kKeyword, synth.Near(user), &positives);
+    spans.emplace_back(begin, positives.size());
+    synth.Pause(synth.Uniform(0.2f, 0.6f), &positives);
+  }
+
+  std::vector<float> negatives;
+  const size_t negative_samples = static_cast<size_t>(negative_minutes) * 60 * kSampleRate;
+  while (negatives.size() < negative_samples) {
+    const bool own_voice = synth.Next() % 3 == 0;
+    synth.Say(synth.RandomWord(kKeyword), own_voice ? synth.Near(user) : synth.RandomVoice(),
+              &negatives);
+    synth.Pause(synth.Uniform(0.05f, 0.5f), &negatives);
+  }
+  synth.AddNoise(0.001f, &positives);
+  synth.AddNoise(0.001f, &negatives);
+
+  const Run positive_run = Detect(&spotter, positives);
+  const Run negative_run = Detect(&spotter, negatives);
+
+  std::vector<bool> found(spans.size(), false);
+  int detected = 0;
+  size_t stray = 0;
+  double latency_ms = 0.0;
+  for (const uint64_t end : positive_run.hit_ends) {
+    bool matched = false;
+    for (size_t k = 0; k < spans.size(); k++) {
+      const auto& span = spans[k];
+      if (end < span.first + (span.second - span.first) / 2 || end > span.second + kLateSamples) {
+        continue;
+      }
+      if (!found[k]) {
+        found[k] = true;
+        detected++;
+        latency_ms += (static_cast<double>(end) - span.second) * 1000.0 / kSampleRate;
+      }
+      matched = true;
+      break;
+    }
+    if (!matched) stray++;
+  }
+
+  const double negative_hours = negatives.size() / (3600.0 * kSampleRate);
+  const double false_reject = 100.0 * (kPositives - detected) / kPositives;
+  const double false_accepts_per_hour = negative_run.hit_ends.size() / negative_hours;
+  const double cpu_percent =
+      100.0 * negative_run.cpu_seconds / (negatives.size() / static_cast<double>(kSampleRate));
+
+  std::printf("threshold %.2f: false reject %.1f%% (%d/%d), false accept %.1f per hour "
+              "(%zu in %.2f h, +%zu stray in the positive stream)\n",
+              threshold, false_reject, kPositives - detected, kPositives, false_accepts_per_hour,
+              negative_run.hit_ends.size(), negative_hours, stray);
+  // The last phone fades out, so hits can land before the rendered end.
+  std::printf("hits land %+.0f ms from the end of the phrase on average, CPU %.2f%% of one core\n",
+              detected > 0 ? latency_ms / detected : 0.0, cpu_percent);
+
+  if (!custom_threshold) {
+    // Bounds at the default threshold, with room for platform float drift.
+    EXPECT_TRUE(false_reject <= 5.0);
+    EXPECT_TRUE(false_accepts_per_hour <= 3.0);
+    EXPECT_TRUE(detected > 0 && latency_ms / detected <= 100.0);
+  }
+  return test_support::TestResult();
+}
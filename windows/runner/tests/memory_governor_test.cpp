@@ -0,0 +1,91 @@
+// MemoryGovernor grants and accounting: priority order under a shrinking
+// budget, and pools reserving on their own threads while the platform thread
+// attaches and detaches them.
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "memory_governor.h"
+#include "test_support.h"
+
+namespace {
+
+void TestGrants() {
+  MemoryGovernor governor(1000);
+  MemoryPool queue("queue", MemoryGovernor::kPriorityQueue, 300, 600, 10);
+  MemoryPool history("history", MemoryGovernor::kPriorityHistory, 200, 800, 100);
+  size_t history_shrunk_to = 0;
+  history.SetShrinkCallback([&](size_t limit) {
+    history_shrunk_to = limit;
+    history.Reserve(limit);
+  });
+
+  // Unattached, a pool may grow to its want.
+  EXPECT_TRUE(history.Reserve(800));
+  history.Attach(&governor);
+  queue.Attach(&governor);
+  // The queue outranks history: its whole want first, history the rest.
+  EXPECT_EQ(queue.limit(), 600u);
+  EXPECT_EQ(history.limit(), 400u);
+  EXPECT_EQ(history_shrunk_to, 400u);
+  EXPECT_EQ(governor.used(), 400u);
+
+  EXPECT_TRUE(queue.Reserve(600));
+  EXPECT_TRUE(!queue.Reserve(610));
+  EXPECT_EQ(governor.used(), 1000u);
+
+  // Floors hold before anything above them.
+  governor.SetBudget(500);
+  EXPECT_EQ(queue.limit(), 300u);
+  EXPECT_EQ(history.limit(), 200u);
+
+  queue.Reserve(0);
+  queue.Detach();
+  EXPECT_EQ(history.limit(), 500u);
+  EXPECT_EQ(governor.used(), history.used());
+  EXPECT_EQ(governor.Stats().size(), 1u);
+}
+
+// Reserve on worker threads while the platform thread attaches and detaches
+// the pools: the governor's count must end equal to what the pools hold.
+void TestConcurrentReserve() {
+  constexpr size_t kBudget = 64 * 1024;
+  MemoryGovernor governor(kBudget);
+  MemoryPool pools[] = {
+      {"a", MemoryGovernor::kPriorityQueue, 4096, 32 * 1024},
+      {"b", MemoryGovernor::kPriorityHistory, 4096, 48 * 1024},
+  };
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> workers;
+  for (MemoryPool& pool : pools) {
+    workers.emplace_back([&] {
+      for (size_t i = 0; !stop; i++) {
+        pool.Reserve((i * 7919) % (48 * 1024));
+      }
+    });
+  }
+  for (int i = 0; i < 200000; i++) {
+    MemoryPool& pool = pools[i % 2];
+    if (i % 4 < 2) {
+      pool.Attach(&governor);
+    } else {
+      pool.Detach();
+    }
+  }
+  for (MemoryPool& pool : pools) pool.Attach(&governor);
+  stop = true;
+  for (std::thread& worker : workers) worker.join();
+
+  EXPECT_EQ(governor.used(), pools[0].used() + pools[1].used());
+  for (MemoryPool& pool : pools) pool.Detach();
+  EXPECT_EQ(governor.used(), 0u);
+}
+
+}  // namespace
+
+int main() {
+  TestGrants();
+  TestConcurrentReserve();
+  return test_support::TestResult();
+}
@@ -0,0 +1,169 @@
+// Bytes per meeting save: a full JSON save against the binary delta, raw and
+// deflated with and without the preset dictionary the relay inflates with.
+//
+// Replays a synthetic 30-minute meeting saved every 5 seconds. Each save
+// extends the live draft or finalizes it and opens the next bubble, like the
+// app's autosave does mid-speech. The dictionary is read from
+// server/src/sessionSyncDictionary.ts (path in argv[1]).
+
+#include <zlib.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "session_sync_encoder.h"
+#include "test_support.h"
+
+namespace {
+
+constexpr int kMeetingSeconds = 30 * 60;
+constexpr int kSaveIntervalSeconds = 5;
+constexpr int64_t kStartMs = 1760000000000;
+
+const char* const kWords[] = {
+    "we",      "should",   "ship",     "the",      "migration", "before",  "Friday",
+    "because", "customer", "asked",    "about",    "pricing",   "latency", "numbers",
+    "I",       "think",    "rollout",  "needs",    "a",         "canary",  "first",
+    "can",     "you",      "share",    "dashboard", "again",    "yeah",    "so",
+    "memory",  "budget",   "on",       "older",    "laptops",   "is",      "tight",
+    "let's",   "follow",   "up",       "with",     "design",    "review",  "notes",
+    "what",    "blocked",  "last",     "sprint",   "honestly",  "QA",      "cycle"};
+
+// The string literals of sessionSyncDictionary.ts, concatenated.
+std::string LoadDictionary(const char* path) {
+  std::ifstream file(path);
+  std::string dictionary;
+  std::string line;
+  while (std::getline(file, line)) {
+    const size_t open = line.find('\'');
+    const size_t close = line.rfind('\'');
+    if (open == std::string::npos || close <= open) continue;
+    const std::string literal = line.substr(open + 1, close - open - 1);
+    if (literal == "utf8") continue;
+    dictionary += literal;
+  }
+  return dictionary;
+}
+
+size_t DeflatedSize(const std::vector<uint8_t>& data, const std::string& dictionary) {
+  z_stream stream{};
+  // Raw deflate at level 6, as ZLibEncoder(raw: true, level: 6) on the client.
+  if (deflateInit2(&stream, 6, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return 0;
+  if (!dictionary.empty()) {
+    deflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dictionary.data()),
+                         static_cast<uInt>(dictionary.size()));
+  }
+  std::vector<uint8_t> out(deflateBound(&stream, static_cast<uLong>(data.size())) + 16);
+  stream.next_in = const_cast<Bytef*>(data.data());
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = out.data();
+  stream.avail_out = static_cast<uInt>(out.size());
+  const int status = deflate(&stream, Z_FINISH);
+  const size_t size = out.size() - stream.avail_out;
+  deflateEnd(&stream);
+  return status == Z_STREAM_END ? size : 0;
+}
+
+void AppendJsonString(std::string* out, const std::string& s) {
+  out->push_back('"');
+  for (const char c : s) {
+    if (c == '"' || c == '\\') out->push_back('\\');
+    out->push_back(c);
+  }
+  out->push_back('"');
+}
+
+// The body MeetingSession.toJson() PUTs for a full save.
+size_t FullSaveBytes(const std::vector<SyncBubble>& bubbles, const std::string& meta) {
+  std::string json = "{\"id\":\"65f0c0ffee0000000000beef\",\"createdAt\":\"2025-10-09T10:00:00.000\","
+                     "\"updatedAt\":\"2025-10-09T10:30:00.000\",\"bubbles\":[";
+  for (size_t i = 0; i < bubbles.size(); i++) {
+    const SyncBubble& b = bubbles[i];
+    if (i > 0) json += ',';
+    json += "{\"source\":";
+    AppendJsonString(&json, b.source);
+    json += ",\"text\":";
+    AppendJsonString(&json, b.text);
+    json += ",\"timestamp\":\"2025-10-09T10:12:34.567\",\"isDraft\":";
+    json += b.is_draft ? "true" : "false";
+    if (b.speaker_id >= 0) json += ",\"speakerId\":" + std::to_string(b.speaker_id);
+    json += '}';
+  }
+  json += "],";
+  // |meta| is a JSON object; splice its fields into the session object.
+  json += meta.substr(1);
+  return json.size();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string dictionary = argc > 1 ? LoadDictionary(argv[1]) : std::string();
+  EXPECT_TRUE(!dictionary.empty());
+
+  const std::string meta =
+      "{\"title\":\"Weekly sync\",\"summary\":null,\"insights\":null,"
+      "\"questions\":null,\"mode\":\"meeting\",\"metadata\":{}}";
+  const std::string session = "65f0c0ffee0000000000beef";
+
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<size_t> word(0, std::size(kWords) - 1);
+  std::uniform_int_distribution<int> words_per_save(4, 14);
+  std::uniform_int_distribution<int> finalize(0, 2);
+
+  SessionSyncEncoder encoder;
+  std::vector<SyncBubble> bubbles;
+  encoder.SetBaseline(session, bubbles, meta, 1);
+
+  size_t saves = 0;
+  size_t full_bytes = 0;
+  size_t delta_bytes = 0;
+  size_t deflated_bytes = 0;
+  size_t dictionary_bytes = 0;
+  for (int t = kSaveIntervalSeconds; t <= kMeetingSeconds; t += kSaveIntervalSeconds) {
+    if (bubbles.empty() || !bubbles.back().is_draft) {
+      SyncBubble next;
+      next.source = bubbles.size() % 3 == 0 ? "mic" : "system";
+      next.speaker_id = next.source == "system" ? static_cast<int>(bubbles.size() % 2) : -1;
+      next.is_draft = true;
+      bubbles.push_back(next);
+    }
+    SyncBubble& live = bubbles.back();
+    for (int i = words_per_save(rng); i > 0; i--) {
+      if (!live.text.empty()) live.text += ' ';
+      live.text += kWords[word(rng)];
+    }
+    live.timestamp_ms = kStartMs + t * 1000;
+    if (finalize(rng) == 0) live.is_draft = false;
+
+    std::vector<uint8_t> delta;
+    uint64_t version = 0;
+    if (encoder.Encode(session, bubbles, meta, &delta, &version) !=
+        SessionSyncEncoder::Result::kDelta) {
+      continue;
+    }
+    encoder.Acknowledge(session, version);
+    saves++;
+    full_bytes += FullSaveBytes(bubbles, meta);
+    delta_bytes += delta.size();
+    deflated_bytes += DeflatedSize(delta, std::string());
+    dictionary_bytes += DeflatedSize(delta, dictionary);
+  }
+
+  EXPECT_TRUE(saves > 0);
+  EXPECT_TRUE(delta_bytes < full_bytes);
+  EXPECT_TRUE(dictionary_bytes > 0 && dictionary_bytes <= deflated_bytes);
+  if (saves == 0) return test_support::TestResult();
+
+  std::printf("%zu saves over %d min, %zu bubbles at the end\n", saves, kMeetingSeconds / 60,
+              bubbles.size());
+  std::printf("bytes per save: full JSON %zu, delta %zu, deflated %zu, deflated+dictionary %zu\n",
+              full_bytes / saves, delta_bytes / saves, deflated_bytes / saves,
+              dictionary_bytes / saves);
+  return test_support::TestResult();
+}
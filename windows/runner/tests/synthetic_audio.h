@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Deterministic 16 kHz test signals for the audio tests and benchmarks.
+namespace synthetic_audio {
+
+constexpr int kSampleRate = 16000;
+constexpr double kPi = 3.14159265358979323846;
+
+// Voiced-speech stand-in: a harmonic series on a wandering pitch under a
+// syllable-rate envelope, over low background noise. |seed| varies the
+// pitch track and noise.
+inline std::vector<int16_t> Speech(size_t samples, uint32_t seed, double level = 0.3) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> noise(0.0, 0.003);
+  std::uniform_real_distribution<double> wander(-0.5, 0.5);
+  std::vector<int16_t> out(samples);
+  double pitch = 110.0 + 60.0 * (seed % 5) / 4.0;
+  double phase = 0.0;
+  for (size_t i = 0; i < samples; i++) {
+    if (i % 160 == 0) pitch = (std::max)(80.0, (std::min)(260.0, pitch + wander(rng)));
+    phase += 2.0 * kPi * pitch / kSampleRate;
+    const double t = static_cast<double>(i) / kSampleRate;
+    const double envelope = 0.55 + 0.45 * std::sin(2.0 * kPi * 4.0 * t);
+    double v = 0.0;
+    for (int h = 1; h <= 8; h++) v += std::sin(h * phase) / h;
+    const double sample = level * envelope * v / 2.0 + noise(rng);
+    out[i] = static_cast<int16_t>((std::max)(-1.0, (std::min)(1.0, sample)) * 32767.0);
+  }
+  return out;
+}
+
+// White noise at |level| RMS (full scale 1.0).
+inline std::vector<int16_t> Noise(size_t samples, uint32_t seed, double level) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> noise(0.0, level);
+  std::vector<int16_t> out(samples);
+  for (auto& s : out) {
+    s = static_cast<int16_t>((std::max)(-1.0, (std::min)(1.0, noise(rng))) * 32767.0);
+  }
+  return out;
+}
+
+// Signal-to-error ratio of |decoded| against |reference| in dB.
+inline double SnrDb(const int16_t* reference, const int16_t* decoded, size_t count) {
+  double signal = 0.0;
+  double error = 0.0;
+  for (size_t i = 0; i < count; i++) {
+    const double d = static_cast<double>(reference[i]) - decoded[i];
+    signal += static_cast<double>(reference[i]) * reference[i];
+    error += d * d;
+  }
+  if (error == 0.0) return 200.0;
+  return 10.0 * std::log10(signal / error);
+}
+
+}  // namespace synthetic_audio
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+// Minimal checks for the runner's portable tests and benchmarks. A failed
+// check logs its location and the test keeps running; main returns
+// TestResult() so CTest sees the failure.
+
+namespace test_support {
+
+inline int& Failures() {
+  static int failures = 0;
+  return failures;
+}
+
+inline int TestResult() {
+  if (Failures() > 0) {
+    std::fprintf(stderr, "%d check(s) failed\n", Failures());
+    return 1;
+  }
+  return 0;
+}
+
+// Seconds since |start| on the steady clock.
+inline double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace test_support
+
+#define EXPECT_TRUE(cond)                                                   \
+  do {                                                                      \
+    if (!(cond)) {                                                          \
+      std::fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #cond); \
+      ++test_support::Failures();                                           \
+    }                                                                       \
+  } while (0)
+
+#define EXPECT_EQ(a, b)                                                        \
+  do {                                                                         \
+    if (!((a) == (b))) {                                                       \
+      std::fprintf(stderr, "%s:%d: expected %s == %s\n", __FILE__, __LINE__, #a, \
+                   #b);                                                        \
+      ++test_support::Failures();                                              \
+    }                                                                          \
+  } while (0)
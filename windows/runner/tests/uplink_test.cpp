@@ -0,0 +1,303 @@
+// The datagram uplink's sending side on loopback: wire format against a
+// vector the relay's TypeScript produces, tag and length checks, parity of
+// full and flushed groups, and AudioUplink talking to a stand-in relay that
+// answers the handshake, reports, and records what arrives.
+//
+// The relay's jitter buffer under loss and delay is covered by
+// server/test/udpAudio.test.ts.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "audio_clock.h"
+#include "audio_uplink.h"
+#include "test_support.h"
+#include "uplink_protocol.h"
+
+namespace {
+
+const char kToken[] = "test-token";
+const char kNonceHex[] = "000102030405060708090a0b0c0d0e0f";
+const uint8_t kNonce[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+// buildUplinkPacket(deriveUplinkKey('test-token', kNonce), {Audio, session
+// 0x01020304, stream 1, seq 5, time 1000}, 'pcm!') in server/src/udpAudio.ts.
+const char kGoldenPacket[] =
+    "48550103040302010100040005000000e803000070636d210217b630e2d703d9";
+
+std::string Hex(const std::vector<uint8_t>& bytes) {
+  static const char kDigits[] = "0123456789abcdef";
+  std::string hex;
+  for (const uint8_t b : bytes) {
+    hex.push_back(kDigits[b >> 4]);
+    hex.push_back(kDigits[b & 15]);
+  }
+  return hex;
+}
+
+void TestWireFormat() {
+  const uplink::Key key = uplink::DeriveKey(kToken, kNonce, sizeof(kNonce));
+  uplink::Header header;
+  header.type = uplink::kAudio;
+  header.session = 0x01020304;
+  header.stream = 1;
+  header.seq = 5;
+  header.time_ms = 1000;
+  const uint8_t pcm[] = {'p', 'c', 'm', '!'};
+  std::vector<uint8_t> packet;
+  uplink::BuildPacket(key, header, pcm, sizeof(pcm), &packet);
+  EXPECT_EQ(Hex(packet), std::string(kGoldenPacket));
+
+  uplink::Header parsed;
+  const uint8_t* payload = nullptr;
+  size_t length = 0;
+  EXPECT_TRUE(uplink::ParsePacket(key, packet.data(), packet.size(), &parsed, &payload, &length));
+  EXPECT_EQ(parsed.type, uplink::kAudio);
+  EXPECT_EQ(parsed.session, 0x01020304u);
+  EXPECT_EQ(parsed.stream, 1);
+  EXPECT_EQ(parsed.seq, 5u);
+  EXPECT_EQ(parsed.time_ms, 1000u);
+  EXPECT_EQ(length, sizeof(pcm));
+  EXPECT_TRUE(length == sizeof(pcm) && std::memcmp(payload, pcm, length) == 0);
+
+  // Any flipped bit, a truncation or another key fails the check.
+  for (size_t i = 0; i < packet.size(); i++) {
+    std::vector<uint8_t> bad = packet;
+    bad[i] ^= 0x10;
+    EXPECT_TRUE(!uplink::ParsePacket(key, bad.data(), bad.size(), &parsed, &payload, &length));
+  }
+  EXPECT_TRUE(!uplink::ParsePacket(key, packet.data(), packet.size() - 1, &parsed, &payload,
+                                   &length));
+  const uplink::Key other = uplink::DeriveKey("other-token", kNonce, sizeof(kNonce));
+  EXPECT_TRUE(!uplink::ParsePacket(other, packet.data(), packet.size(), &parsed, &payload,
+                                   &length));
+}
+
+// XORs a group's [u16 length][payload] records back out of |parity|, leaving
+// the record of |missing|.
+std::vector<uint8_t> Rebuild(std::vector<uint8_t> parity,
+                             const std::vector<std::vector<uint8_t>>& group, size_t missing) {
+  for (size_t i = 0; i < group.size(); i++) {
+    if (i == missing) continue;
+    parity[0] ^= static_cast<uint8_t>(group[i].size());
+    parity[1] ^= static_cast<uint8_t>(group[i].size() >> 8);
+    for (size_t j = 0; j < group[i].size(); j++) parity[j + 2] ^= group[i][j];
+  }
+  const size_t length = parity[0] | (parity[1] << 8);
+  if (length + 2 > parity.size()) return {};
+  return std::vector<uint8_t>(parity.begin() + 2, parity.begin() + 2 + length);
+}
+
+void TestParity() {
+  std::vector<std::vector<uint8_t>> group;
+  for (size_t i = 0; i < uplink::kFecGroup; i++) {
+    std::vector<uint8_t> payload(100 + i * 37);
+    for (size_t j = 0; j < payload.size(); j++) payload[j] = static_cast<uint8_t>(i * 31 + j);
+    group.push_back(payload);
+  }
+
+  uplink::ParityBuilder builder;
+  std::vector<uint8_t> parity;
+  uint32_t first = 0;
+  uint8_t count = 0;
+  for (size_t i = 0; i < group.size(); i++) {
+    const bool complete =
+        builder.Add(static_cast<uint32_t>(40 + i), group[i].data(), group[i].size(), &parity,
+                    &first, &count);
+    EXPECT_EQ(complete, i + 1 == group.size());
+  }
+  EXPECT_EQ(first, 40u);
+  EXPECT_EQ(count, uplink::kFecGroup);
+  for (size_t missing = 0; missing < group.size(); missing++) {
+    EXPECT_TRUE(Rebuild(parity, group, missing) == group[missing]);
+  }
+  EXPECT_TRUE(!builder.Flush(&parity, &first, &count));
+
+  // A group closed early at an utterance end covers just its members.
+  builder.Add(44, group[0].data(), group[0].size(), &parity, &first, &count);
+  builder.Add(45, group[3].data(), group[3].size(), &parity, &first, &count);
+  EXPECT_TRUE(builder.Flush(&parity, &first, &count));
+  EXPECT_EQ(first, 44u);
+  EXPECT_EQ(count, 2);
+  const std::vector<std::vector<uint8_t>> partial = {group[0], group[3]};
+  EXPECT_TRUE(Rebuild(parity, partial, 0) == group[0]);
+  EXPECT_TRUE(Rebuild(parity, partial, 1) == group[3]);
+}
+
+// Answers Hello with Welcome, reports every 50 ms and keeps what arrives.
+class StandInRelay {
+ public:
+  static constexpr uint32_t kSession = 0x01020304;
+
+  StandInRelay() : key_(uplink::DeriveKey(kToken, kNonce, sizeof(kNonce))) {
+    socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(socket_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    socklen_t length = sizeof(addr);
+    getsockname(socket_, reinterpret_cast<sockaddr*>(&addr), &length);
+    port_ = ntohs(addr.sin_port);
+    timeval timeout = {};
+    timeout.tv_usec = 20000;
+    setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    thread_ = std::thread(&StandInRelay::Run, this);
+  }
+
+  ~StandInRelay() {
+    running_ = false;
+    thread_.join();
+    close(socket_);
+  }
+
+  int port() const { return port_; }
+
+  std::vector<uplink::Header> packets() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return packets_;
+  }
+
+ private:
+  void Reply(uplink::PacketType type, const sockaddr_in& to) {
+    uplink::Header header;
+    header.type = type;
+    header.session = kSession;
+    header.time_ms = static_cast<uint32_t>(SteadyNowMs());
+    // received, recovered, lost per stream: 7 and 1 lost on the mic.
+    std::vector<uint8_t> payload;
+    if (type == uplink::kReport) payload = {7, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,
+                                            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    std::vector<uint8_t> packet;
+    uplink::BuildPacket(key_, header, payload.data(), payload.size(), &packet);
+    sendto(socket_, packet.data(), packet.size(), 0, reinterpret_cast<const sockaddr*>(&to),
+           sizeof(to));
+  }
+
+  void Run() {
+    std::vector<uint8_t> buffer(1500);
+    sockaddr_in peer = {};
+    bool have_peer = false;
+    int64_t last_report = 0;
+    while (running_) {
+      if (have_peer && SteadyNowMs() - last_report >= 50) {
+        Reply(uplink::kReport, peer);
+        last_report = SteadyNowMs();
+      }
+      sockaddr_in from = {};
+      socklen_t from_length = sizeof(from);
+      const ssize_t received = recvfrom(socket_, buffer.data(), buffer.size(), 0,
+                                        reinterpret_cast<sockaddr*>(&from), &from_length);
+      if (received <= 0) continue;
+      uplink::Header header;
+      const uint8_t* payload = nullptr;
+      size_t length = 0;
+      if (!uplink::ParsePacket(key_, buffer.data(), static_cast<size_t>(received), &header,
+                               &payload, &length)) {
+        continue;
+      }
+      peer = from;
+      have_peer = true;
+      if (header.type == uplink::kHello) Reply(uplink::kWelcome, peer);
+      std::lock_guard<std::mutex> lock(mutex_);
+      packets_.push_back(header);
+    }
+  }
+
+  const uplink::Key key_;
+  int socket_ = -1;
+  int port_ = 0;
+  std::thread thread_;
+  std::atomic<bool> running_{true};
+  std::mutex mutex_;
+  std::vector<uplink::Header> packets_;
+};
+
+bool WaitFor(const std::function<bool()>& done) {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+  while (!done()) {
+    if (std::chrono::steady_clock::now() > deadline) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return true;
+}
+
+void TestLoopback() {
+  StandInRelay relay;
+  AudioUplink uplink;
+  std::vector<uint8_t> pcm(1600);  // 50 ms, two packets
+
+  // Nothing is accepted before the relay's Welcome.
+  EXPECT_TRUE(!uplink.Finalize(0));
+  EXPECT_TRUE(uplink.Start("127.0.0.1", relay.port(), StandInRelay::kSession, kToken,
+                           kNonceHex));
+  EXPECT_TRUE(WaitFor([&] { return uplink.healthy(); }));
+
+  // Five chunks of mic audio: one full FEC group, then two packets closed
+  // early by the finalize.
+  for (int i = 0; i < 3; i++) EXPECT_TRUE(uplink.Send(0, pcm.data(), pcm.size()));
+  EXPECT_TRUE(uplink.Finalize(0));
+  EXPECT_TRUE(uplink.Send(1, pcm.data(), 640));
+  EXPECT_TRUE(WaitFor([&] {
+    const auto packets = relay.packets();
+    return !packets.empty() && packets.back().stream == 1 && uplink.stats().received == 7;
+  }));
+  uplink.Stop();
+
+  std::vector<uint32_t> mic_audio;
+  std::vector<std::pair<uint32_t, int>> mic_parity;
+  uint32_t finalize_seq = 0;
+  int finalizes = 0;
+  int system_audio = 0;
+  for (const auto& p : relay.packets()) {
+    if (p.type == uplink::kAudio && p.stream == 0) mic_audio.push_back(p.seq);
+    if (p.type == uplink::kAudio && p.stream == 1) system_audio++;
+    if (p.type == uplink::kParity && p.stream == 0) mic_parity.push_back({p.seq, p.count});
+    if (p.type == uplink::kFinalize) {
+      EXPECT_EQ(p.stream, 0);
+      finalize_seq = p.seq;
+      finalizes++;
+    }
+  }
+  EXPECT_EQ(mic_audio.size(), 6u);
+  EXPECT_EQ(system_audio, 1);
+  EXPECT_EQ(mic_parity.size(), 2u);
+  if (mic_parity.size() == 2) {
+    EXPECT_TRUE(mic_parity[0] == std::make_pair(0u, uplink::kFecGroup));
+    EXPECT_TRUE(mic_parity[1] == std::make_pair(4u, 2));
+  }
+  // The utterance ends before the next audio packet.
+  EXPECT_EQ(finalizes, 1);
+  EXPECT_EQ(finalize_seq, 6u);
+
+  const AudioUplink::Stats stats = uplink.stats();
+  EXPECT_EQ(stats.packets_sent, 7u);
+  EXPECT_EQ(stats.parity_sent, 2u);
+  EXPECT_EQ(stats.received, 7u);
+  EXPECT_EQ(stats.lost, 1u);
+  std::printf("loopback: %llu packets, %llu parity, %llu bytes\n",
+              static_cast<unsigned long long>(stats.packets_sent),
+              static_cast<unsigned long long>(stats.parity_sent),
+              static_cast<unsigned long long>(stats.bytes_sent));
+}
+
+}  // namespace
+
+int main() {
+  TestWireFormat();
+  TestParity();
+  TestLoopback();
+  return test_support::TestResult();
+}
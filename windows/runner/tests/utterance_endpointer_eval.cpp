@@ -0,0 +1,217 @@
+// Offline evaluation of UtteranceEndpointer: latency saved against premature
+// cuts, per aggressiveness, compared with a VAD-only fixed silence wait.
+//
+// No speech corpus is available, so the audio is synthesized prosody: a
+// harmonic source shaped into syllables, 400 utterances of 1-3 phrases with
+// 150-700 ms pauses between phrases, and endings that fall like a statement,
+// rise like a question or stop flat at full level like a cut-off. A cut is
+// premature when the endpointer fires inside an utterance (in a phrase
+// pause); latency runs from the end of the last syllable to the detection.
+//
+// The fixed wait with the same mean latency shows what the prosody cues buy:
+// it would cut every phrase pause at least that long.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "test_support.h"
+#include "utterance_endpointer.h"
+
+namespace {
+
+constexpr int kSampleRate = 16000;
+constexpr double kPi = 3.14159265358979323846;
+constexpr int kUtterances = 400;
+// Longest wait per aggressiveness (utterance_endpointer.cpp), in ms.
+constexpr int kMaxWaitMs[] = {0, 1000, 800, 600};
+
+struct Utterance {
+  size_t start;
+  size_t end;
+  std::vector<std::pair<size_t, size_t>> pauses;  // Between phrases
+};
+
+class ProsodySynth {
+ public:
+  explicit ProsodySynth(uint32_t seed) : rng_(seed) {}
+
+  double Uniform(double lo, double hi) {
+    return std::uniform_real_distribution<double>(lo, hi)(rng_);
+  }
+  uint32_t Next() { return rng_(); }
+
+  void Silence(size_t n) {
+    for (size_t i = 0; i < n; i++) audio_.push_back(static_cast<float>(noise_(rng_) * kNoise));
+  }
+
+  // A syllable of |n| samples whose pitch glides from |f_start| to |f_end| Hz
+  // and level from |db_start| to |db_end|, opening with a short consonant.
+  void Syllable(size_t n, double f_start, double f_end, double db_start, double db_end) {
+    const size_t consonant = static_cast<size_t>(Uniform(0.02, 0.05) * kSampleRate);
+    for (size_t i = 0; i < n; i++) {
+      const double t = static_cast<double>(i) / n;
+      const double f = f_start * std::pow(f_end / f_start, t);
+      phase_ += 2 * kPi * f / kSampleRate;
+      const double envelope = (std::min)(1.0, (std::min)(i / 160.0, (n - i) / 240.0));
+      const double level = std::pow(10.0, (db_start + (db_end - db_start) * t) / 20);
+      double s = 0;
+      for (int k = 1; k <= 20 && k * f < 7000; k++) s += std::sin(k * phase_) / k;
+      s *= 0.5;
+      if (i < consonant) s = noise_(rng_) * 0.3;
+      audio_.push_back(static_cast<float>(s * level * envelope + noise_(rng_) * kNoise));
+    }
+  }
+
+  const std::vector<float>& audio() const { return audio_; }
+  size_t size() const { return audio_.size(); }
+
+ private:
+  const double kNoise = std::pow(10.0, -55 / 20.0);
+
+  std::mt19937 rng_;
+  std::normal_distribution<double> noise_{0.0, 1.0};
+  std::vector<float> audio_;
+  double phase_ = 0;
+};
+
+double Semitones(double s) {
+  return std::pow(2.0, s / 12);
+}
+
+std::vector<Utterance> Synthesize(ProsodySynth* synth, int endings[3]) {
+  std::vector<Utterance> utterances;
+  synth->Silence(kSampleRate);
+  for (int u = 0; u < kUtterances; u++) {
+    Utterance utterance;
+    utterance.start = synth->size();
+    const double f0 = synth->Uniform(0, 1) < 0.5 ? synth->Uniform(95, 140) : synth->Uniform(180, 240);
+    const double level = synth->Uniform(-26, -14);
+    const int phrases = 1 + synth->Next() % 3;
+    for (int p = 0; p < phrases; p++) {
+      const bool last_phrase = p == phrases - 1;
+      const int words = 2 + synth->Next() % 5;
+      for (int w = 0; w < words; w++) {
+        const bool last_word = w == words - 1;
+        size_t n = static_cast<size_t>(synth->Uniform(0.15, 0.28) * kSampleRate);
+        const double f_start = f0 * Semitones(synth->Uniform(-1, 1));
+        double f_end = f_start * Semitones(synth->Uniform(-1, 1));
+        double db_end = level + synth->Uniform(-2, 2);
+        if (last_word && last_phrase) {
+          const int kind = synth->Uniform(0, 1) < 0.6 ? 0 : (synth->Uniform(0, 1) < 0.6 ? 1 : 2);
+          endings[kind]++;
+          n = static_cast<size_t>(synth->Uniform(0.25, 0.4) * kSampleRate);
+          if (kind == 0) {  // Statement: falls and fades
+            f_end = f_start * Semitones(-synth->Uniform(3, 7));
+            db_end = level - synth->Uniform(8, 16);
+          } else if (kind == 1) {  // Question: rises
+            f_end = f_start * Semitones(synth->Uniform(4, 9));
+            db_end = level - synth->Uniform(3, 10);
+          } else {  // Cut off: flat, at full level
+            f_end = f_start;
+            db_end = level;
+          }
+        } else if (last_word) {  // Phrase boundary: continuation rise
+          n = static_cast<size_t>(synth->Uniform(0.2, 0.3) * kSampleRate);
+          f_end = f_start * Semitones(synth->Uniform(-1, 3));
+          db_end = level - synth->Uniform(0, 5);
+        }
+        synth->Syllable(n, f_start, f_end, level + synth->Uniform(-2, 2), db_end);
+        if (!last_word) synth->Silence(static_cast<size_t>(synth->Uniform(0.02, 0.08) * kSampleRate));
+      }
+      if (!last_phrase) {
+        const size_t pause_start = synth->size();
+        synth->Silence(static_cast<size_t>(synth->Uniform(0.15, 0.7) * kSampleRate));
+        utterance.pauses.push_back({pause_start, synth->size()});
+      }
+    }
+    utterance.end = synth->size();
+    utterances.push_back(utterance);
+    synth->Silence(static_cast<size_t>(synth->Uniform(1.5, 3.0) * kSampleRate));
+  }
+  return utterances;
+}
+
+// VAD-only endpointing that waits |wait_ms|: cuts every longer phrase pause.
+int FixedWaitPrematureCuts(const std::vector<Utterance>& utterances, double wait_ms) {
+  int cuts = 0;
+  for (const Utterance& u : utterances) {
+    for (const auto& pause : u.pauses) {
+      if ((pause.second - pause.first) * 1000.0 / kSampleRate >= wait_ms) cuts++;
+    }
+  }
+  return cuts;
+}
+
+}  // namespace
+
+int main() {
+  ProsodySynth synth(42);
+  int endings[3] = {};
+  const std::vector<Utterance> utterances = Synthesize(&synth, endings);
+  const std::vector<float>& audio = synth.audio();
+  size_t pauses = 0;
+  for (const Utterance& u : utterances) pauses += u.pauses.size();
+  std::printf("%zu utterances, %.0f s: %d falling, %d rising, %d flat endings; %zu phrase pauses\n",
+              utterances.size(), audio.size() / static_cast<double>(kSampleRate), endings[0],
+              endings[1], endings[2], pauses);
+  std::printf("level  detected  premature  latency mean/p50/p90   cpu     fixed wait at same mean\n");
+
+  for (int aggressiveness = 1; aggressiveness <= UtteranceEndpointer::kMaxAggressiveness;
+       aggressiveness++) {
+    UtteranceEndpointer endpointer(aggressiveness);
+    std::vector<uint64_t> fires;
+    const size_t chunk = 640;  // 40 ms, as the mic stream delivers
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < audio.size(); i += chunk) {
+      if (endpointer.Process(&audio[i], (std::min)(chunk, audio.size() - i))) {
+        fires.push_back(endpointer.samples_seen());
+      }
+    }
+    const double cpu = test_support::SecondsSince(start) /
+                       (audio.size() / static_cast<double>(kSampleRate));
+
+    // A detection within 1.5 s after an utterance's end is its endpoint.
+    int detected = 0;
+    int premature = 0;
+    std::vector<double> latency_ms;
+    size_t f = 0;
+    for (const Utterance& u : utterances) {
+      bool found = false;
+      while (f < fires.size() && fires[f] < u.start) f++;
+      for (; f < fires.size() && fires[f] < u.end + kSampleRate * 3 / 2; f++) {
+        if (fires[f] < u.end) {
+          premature++;
+        } else if (!found) {
+          found = true;
+          detected++;
+          latency_ms.push_back((fires[f] - u.end) * 1000.0 / kSampleRate);
+        }
+      }
+    }
+    std::sort(latency_ms.begin(), latency_ms.end());
+    double mean = 0;
+    for (const double l : latency_ms) mean += l;
+    mean /= (std::max)(size_t{1}, latency_ms.size());
+    const double p50 = latency_ms.empty() ? 0 : latency_ms[latency_ms.size() / 2];
+    const double p90 = latency_ms.empty() ? 0 : latency_ms[latency_ms.size() * 9 / 10];
+    const int fixed_cuts = FixedWaitPrematureCuts(utterances, mean);
+
+    std::printf("%5d  %4d/%zu  %9d  %4.0f/%4.0f/%4.0f ms     %.2f%%   %d cuts (vs %d at %d ms)\n",
+                aggressiveness, detected, utterances.size(), premature, mean, p50, p90,
+                cpu * 100, fixed_cuts, FixedWaitPrematureCuts(utterances, kMaxWaitMs[aggressiveness]),
+                kMaxWaitMs[aggressiveness]);
+
+    EXPECT_TRUE(detected >= kUtterances * 95 / 100);
+    EXPECT_TRUE(mean < kMaxWaitMs[aggressiveness]);
+    // The cues have to beat the fixed wait that is just as fast.
+    EXPECT_TRUE(premature < fixed_cuts);
+    // The default level cuts at most 5% of utterances early.
+    if (aggressiveness == 2) EXPECT_TRUE(premature <= kUtterances * 5 / 100);
+  }
+  return test_support::TestResult();
+}
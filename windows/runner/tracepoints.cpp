@@ -0,0 +1,40 @@
+#include "tracepoints.h"
+
+#if defined(_WIN32)
+
+// {b38df485-bc93-5925-3e92-530004be91b6}, the EventSource-style hash of the
+// name, so tools that accept "*HearNow.Audio" resolve the same provider.
+TRACELOGGING_DEFINE_PROVIDER(
+    g_hearnow_trace_provider, "HearNow.Audio",
+    (0xb38df485, 0xbc93, 0x5925, 0x3e, 0x92, 0x53, 0x00, 0x04, 0xbe, 0x91, 0xb6));
+
+void RegisterTracepoints() {
+  TraceLoggingRegister(g_hearnow_trace_provider);
+}
+
+void UnregisterTracepoints() {
+  TraceLoggingUnregister(g_hearnow_trace_provider);
+}
+
+#else
+
+#if defined(HN_TRACE_HAVE_SDT)
+// Semaphores live in .probes so the SDT notes can point at them.
+#define HN_TRACE_SEMAPHORE(name) \
+  __attribute__((section(".probes"), used)) volatile unsigned short \
+      hearnow_##name##_semaphore = 0;
+extern "C" {
+HN_TRACE_SEMAPHORE(packet_arrival)
+HN_TRACE_SEMAPHORE(stage_done)
+HN_TRACE_SEMAPHORE(buffer_overrun)
+HN_TRACE_SEMAPHORE(frame_delivered)
+HN_TRACE_SEMAPHORE(socket_send)
+HN_TRACE_SEMAPHORE(power_tier)
+}
+#endif
+
+void RegisterTracepoints() {}
+
+void UnregisterTracepoints() {}
+
+#endif
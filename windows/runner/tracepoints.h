@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+
+#include "audio_clock.h"
+
+// Static tracepoints in the native audio pipeline, for attaching perf /
+// bpftrace (Linux USDT, provider "hearnow") or any ETW consumer (Windows
+// TraceLogging, provider "HearNow.Audio") to a running release build.
+//
+// Probe arguments are only evaluated while a tracer is attached: SDT probes
+// are guarded by their semaphores and TraceLoggingWrite checks the provider
+// first, so a disabled probe costs one predictable branch.
+//
+//   packet_arrival   stream, seq, bytes, t_us
+//   stage_done       stream, stage, seq, samples, t_us
+//   buffer_overrun   stream, dropped_bytes, queued_bytes, t_us
+//   frame_delivered  stream, offset_bytes, bytes, queued_bytes, t_us
+//   socket_send      stream, seq, bytes, t_us
+//   power_tier       stream, awake (0 low-power, 1 full pipeline), t_us
+//
+// |t_us| is SteadyNowUs(). Example bpftrace scripts live in tools/tracing.
+
+enum TraceStream : uint32_t { kTraceMic = 0, kTraceSystem = 1 };
+
+enum TraceStage : uint32_t {
+  kTraceStageConvert = 0,  // Downmix + resample to 16kHz
+  kTraceStageVad = 1,      // Speech activity / analytics
+  kTraceStageSpeaker = 2,  // Speaker change detection
+  kTraceStageQueued = 3,   // Appended to the buffer Dart reads from
+};
+
+// Registers the ETW provider (no-op elsewhere). Call once at startup.
+void RegisterTracepoints();
+void UnregisterTracepoints();
+
+#if defined(_WIN32)
+
+#include <windows.h>
+#include <TraceLoggingProvider.h>
+
+TRACELOGGING_DECLARE_PROVIDER(g_hearnow_trace_provider);
+
+#define HN_TRACE_PACKET_ARRIVAL(stream, seq, bytes)                          \
+  TraceLoggingWrite(g_hearnow_trace_provider, "PacketArrival",               \
+                    TraceLoggingUInt32(static_cast<UINT32>(stream), "Stream"), \
+                    TraceLoggingUInt64(static_cast<UINT64>(seq), "Seq"),     \
+                    TraceLoggingUInt64(static_cast<UINT64>(bytes), "Bytes"), \
+                    TraceLoggingInt64(SteadyNowUs(), "TimeUs"))
+
+#define HN_TRACE_STAGE_DONE(stream, stage, seq, samples)                      \
+  TraceLoggingWrite(g_hearnow_trace_provider, "StageDone",                    \
+                    TraceLoggingUInt32(static_cast<UINT32>(stream), "Stream"),  \
+                    TraceLoggingUInt32(static_cast<UINT32>(stage), "Stage"),    \
+                    TraceLoggingUInt64(static_cast<UINT64>(seq), "Seq"),        \
+                    TraceLoggingUInt64(static_cast<UINT64>(samples), "Samples"), \
+                    TraceLoggingInt64(SteadyNowUs(), "TimeUs"))
+
+#define HN_TRACE_BUFFER_OVERRUN(stream, dropped, queued)                       \
+  TraceLoggingWrite(g_hearnow_trace_provider, "BufferOverrun",                 \
+                    TraceLoggingUInt32(static_cast<UINT32>(stream), "Stream"),   \
+                    TraceLoggingUInt64(static_cast<UINT64>(dropped), "Dropped"), \
+                    TraceLoggingUInt64(static_cast<UINT64>(queued), "Queued"),   \
+                    TraceLoggingInt64(SteadyNowUs(), "TimeUs"))
+
+#define HN_TRACE_FRAME_DELIVERED(stream, offset, bytes, queued)               \
+  TraceLoggingWrite(g_hearnow_trace_provider, "FrameDelivered",               \
+                    TraceLoggingUInt32(static_cast<UINT32>(stream), "Stream"),  \
+                    TraceLoggingUInt64(static_cast<UINT64>(offset), "Offset"),  \
+                    TraceLoggingUInt64(static_cast<UINT64>(bytes), "Bytes"),    \
+                    TraceLoggingUInt64(static_cast<UINT64>(queued), "Queued"),  \
+                    TraceLoggingInt64(SteadyNowUs(), "TimeUs"))
+
+#define HN_TRACE_SOCKET_SEND(stream, seq, bytes)                             \
+  TraceLoggingWrite(g_hearnow_trace_provider, "SocketSend",                  \
+                    TraceLoggingUInt32(static_cast<UINT32>(stream), "Stream"), \
+                    TraceLoggingUInt64(static_cast<UINT64>(seq), "Seq"),     \
+                    TraceLoggingUInt64(static_cast<UINT64>(bytes), "Bytes"), \
+                    TraceLoggingInt64(SteadyNowUs(), "TimeUs"))
+
+#define HN_TRACE_POWER_TIER(stream, awake)                                   \
+  TraceLoggingWrite(g_hearnow_trace_provider, "PowerTier",                   \
+                    TraceLoggingUInt32(static_cast<UINT32>(stream), "Stream"), \
+                    TraceLoggingUInt32(static_cast<UINT32>(awake), "Awake"), \
+                    TraceLoggingInt64(SteadyNowUs(), "TimeUs"))
+
+#elif defined(__linux__) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define HN_TRACE_HAVE_SDT 1
+#endif
+#endif
+
+#if defined(HN_TRACE_HAVE_SDT)
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+// Bumped by the kernel while a uprobe is attached to the matching probe.
+extern "C" {
+extern volatile unsigned short hearnow_packet_arrival_semaphore;
+extern volatile unsigned short hearnow_stage_done_semaphore;
+extern volatile unsigned short hearnow_buffer_overrun_semaphore;
+extern volatile unsigned short hearnow_frame_delivered_semaphore;
+extern volatile unsigned short hearnow_socket_send_semaphore;
+extern volatile unsigned short hearnow_power_tier_semaphore;
+}
+
+#define HN_TRACE_SDT(name, ...)                                 \
+  do {                                                          \
+    if (__builtin_expect(hearnow_##name##_semaphore != 0, 0)) { \
+      STAP_PROBEV(hearnow, name, __VA_ARGS__);                  \
+    }                                                           \
+  } while (0)
+
+#define HN_TRACE_PACKET_ARRIVAL(stream, seq, bytes)                      \
+  HN_TRACE_SDT(packet_arrival, static_cast<uint32_t>(stream),            \
+               static_cast<uint64_t>(seq), static_cast<uint64_t>(bytes), \
+               SteadyNowUs())
+#define HN_TRACE_STAGE_DONE(stream, stage, seq, samples)                    \
+  HN_TRACE_SDT(stage_done, static_cast<uint32_t>(stream),                   \
+               static_cast<uint32_t>(stage), static_cast<uint64_t>(seq),    \
+               static_cast<uint64_t>(samples), SteadyNowUs())
+#define HN_TRACE_BUFFER_OVERRUN(stream, dropped, queued)                       \
+  HN_TRACE_SDT(buffer_overrun, static_cast<uint32_t>(stream),                  \
+               static_cast<uint64_t>(dropped), static_cast<uint64_t>(queued),  \
+               SteadyNowUs())
+#define HN_TRACE_FRAME_DELIVERED(stream, offset, bytes, queued)                \
+  HN_TRACE_SDT(frame_delivered, static_cast<uint32_t>(stream),                 \
+               static_cast<uint64_t>(offset), static_cast<uint64_t>(bytes),    \
+               static_cast<uint64_t>(queued), SteadyNowUs())
+#define HN_TRACE_SOCKET_SEND(stream, seq, bytes)                         \
+  HN_TRACE_SDT(socket_send, static_cast<uint32_t>(stream),               \
+               static_cast<uint64_t>(seq), static_cast<uint64_t>(bytes), \
+               SteadyNowUs())
+#define HN_TRACE_POWER_TIER(stream, awake)                                  \
+  HN_TRACE_SDT(power_tier, static_cast<uint32_t>(stream),                   \
+               static_cast<uint32_t>(awake), SteadyNowUs())
+
+#elif !defined(_WIN32)
+
+// Arguments are named inside sizeof so they count as used but never run.
+#define HN_TRACE_UNUSED(x) ((void)sizeof(x))
+#define HN_TRACE_PACKET_ARRIVAL(stream, seq, bytes) \
+  (HN_TRACE_UNUSED(stream), HN_TRACE_UNUSED(seq), HN_TRACE_UNUSED(bytes))
+#define HN_TRACE_STAGE_DONE(stream, stage, seq, samples)                   \
+  (HN_TRACE_UNUSED(stream), HN_TRACE_UNUSED(stage), HN_TRACE_UNUSED(seq), \
+   HN_TRACE_UNUSED(samples))
+#define HN_TRACE_BUFFER_OVERRUN(stream, dropped, queued) \
+  (HN_TRACE_UNUSED(stream), HN_TRACE_UNUSED(dropped), HN_TRACE_UNUSED(queued))
+#define HN_TRACE_FRAME_DELIVERED(stream, offset, bytes, queued)              \
+  (HN_TRACE_UNUSED(stream), HN_TRACE_UNUSED(offset), HN_TRACE_UNUSED(bytes), \
+   HN_TRACE_UNUSED(queued))
+#define HN_TRACE_SOCKET_SEND(stream, seq, bytes) \
+  (HN_TRACE_UNUSED(stream), HN_TRACE_UNUSED(seq), HN_TRACE_UNUSED(bytes))
+#define HN_TRACE_POWER_TIER(stream, awake) \
+  (HN_TRACE_UNUSED(stream), HN_TRACE_UNUSED(awake))
+
+#endif
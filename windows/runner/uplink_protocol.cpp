@@ -0,0 +1,251 @@
+#include "uplink_protocol.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace uplink {
+
+namespace {
+
+constexpr uint32_t kSha256Init[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+constexpr uint32_t kSha256Rounds[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t Rotr(uint32_t x, int n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+class Sha256 {
+ public:
+  Sha256() { std::memcpy(state_, kSha256Init, sizeof(state_)); }
+
+  void Update(const uint8_t* data, size_t length) {
+    total_ += length;
+    while (length > 0) {
+      const size_t take = (std::min)(length, sizeof(block_) - fill_);
+      std::memcpy(block_ + fill_, data, take);
+      fill_ += take;
+      data += take;
+      length -= take;
+      if (fill_ == sizeof(block_)) {
+        Compress();
+        fill_ = 0;
+      }
+    }
+  }
+
+  void Final(uint8_t out[32]) {
+    const uint64_t bits = total_ * 8;
+    const uint8_t pad = 0x80;
+    const uint8_t zero = 0;
+    Update(&pad, 1);
+    while (fill_ != 56) Update(&zero, 1);
+    uint8_t length[8];
+    for (int i = 0; i < 8; i++) length[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+    Update(length, 8);
+    for (int i = 0; i < 8; i++) {
+      out[i * 4 + 0] = static_cast<uint8_t>(state_[i] >> 24);
+      out[i * 4 + 1] = static_cast<uint8_t>(state_[i] >> 16);
+      out[i * 4 + 2] = static_cast<uint8_t>(state_[i] >> 8);
+      out[i * 4 + 3] = static_cast<uint8_t>(state_[i]);
+    }
+  }
+
+ private:
+  void Compress() {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+      w[i] = (static_cast<uint32_t>(block_[i * 4]) << 24) |
+             (static_cast<uint32_t>(block_[i * 4 + 1]) << 16) |
+             (static_cast<uint32_t>(block_[i * 4 + 2]) << 8) |
+             static_cast<uint32_t>(block_[i * 4 + 3]);
+    }
+    for (int i = 16; i < 64; i++) {
+      const uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      const uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+    uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+    for (int i = 0; i < 64; i++) {
+      const uint32_t s1 = Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25);
+      const uint32_t ch = (e & f) ^ (~e & g);
+      const uint32_t t1 = h + s1 + ch + kSha256Rounds[i] + w[i];
+      const uint32_t s0 = Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22);
+      const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+      const uint32_t t2 = s0 + maj;
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+    state_[5] += f;
+    state_[6] += g;
+    state_[7] += h;
+  }
+
+  uint32_t state_[8];
+  uint8_t block_[64] = {};
+  size_t fill_ = 0;
+  uint64_t total_ = 0;
+};
+
+static void PutU16(uint8_t* p, uint16_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+static void PutU32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; i++) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+static uint16_t GetU16(const uint8_t* p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t GetU32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+}  // namespace
+
+void HmacSha256(const uint8_t* key, size_t key_length,
+                const uint8_t* data, size_t length,
+                uint8_t out[32]) {
+  uint8_t block[64] = {};
+  if (key_length > sizeof(block)) {
+    Sha256 hash;
+    hash.Update(key, key_length);
+    hash.Final(block);
+  } else if (key_length > 0) {
+    std::memcpy(block, key, key_length);
+  }
+
+  uint8_t pad[64];
+  for (int i = 0; i < 64; i++) pad[i] = block[i] ^ 0x36;
+  Sha256 inner;
+  inner.Update(pad, sizeof(pad));
+  inner.Update(data, length);
+  uint8_t inner_digest[32];
+  inner.Final(inner_digest);
+
+  for (int i = 0; i < 64; i++) pad[i] = block[i] ^ 0x5c;
+  Sha256 outer;
+  outer.Update(pad, sizeof(pad));
+  outer.Update(inner_digest, sizeof(inner_digest));
+  outer.Final(out);
+}
+
+Key DeriveKey(const std::string& token, const uint8_t* nonce, size_t nonce_length) {
+  static const char kLabel[] = "hearnow-udp";
+  std::vector<uint8_t> message(kLabel, kLabel + sizeof(kLabel) - 1);
+  message.insert(message.end(), nonce, nonce + nonce_length);
+  Key key{};
+  HmacSha256(reinterpret_cast<const uint8_t*>(token.data()), token.size(),
+             message.data(), message.size(), key.data());
+  return key;
+}
+
+void BuildPacket(const Key& key, const Header& header,
+                 const uint8_t* payload, size_t length,
+                 std::vector<uint8_t>* out) {
+  out->resize(kHeaderBytes + length + kTagBytes);
+  uint8_t* p = out->data();
+  p[0] = 'H';
+  p[1] = 'U';
+  p[2] = kVersion;
+  p[3] = header.type;
+  PutU32(p + 4, header.session);
+  p[8] = header.stream;
+  p[9] = header.count;
+  PutU16(p + 10, static_cast<uint16_t>(length));
+  PutU32(p + 12, header.seq);
+  PutU32(p + 16, header.time_ms);
+  if (length > 0) std::memcpy(p + kHeaderBytes, payload, length);
+
+  uint8_t tag[32];
+  HmacSha256(key.data(), key.size(), p, kHeaderBytes + length, tag);
+  std::memcpy(p + kHeaderBytes + length, tag, kTagBytes);
+}
+
+bool ParsePacket(const Key& key, const uint8_t* data, size_t length,
+                 Header* header, const uint8_t** payload, size_t* payload_length) {
+  if (length < kHeaderBytes + kTagBytes) return false;
+  if (data[0] != 'H' || data[1] != 'U' || data[2] != kVersion) return false;
+  const size_t body = GetU16(data + 10);
+  if (kHeaderBytes + body + kTagBytes != length) return false;
+
+  uint8_t tag[32];
+  HmacSha256(key.data(), key.size(), data, kHeaderBytes + body, tag);
+  uint8_t diff = 0;
+  for (size_t i = 0; i < kTagBytes; i++) diff |= tag[i] ^ data[kHeaderBytes + body + i];
+  if (diff != 0) return false;
+
+  header->type = static_cast<PacketType>(data[3]);
+  header->session = GetU32(data + 4);
+  header->stream = data[8];
+  header->count = data[9];
+  header->seq = GetU32(data + 12);
+  header->time_ms = GetU32(data + 16);
+  *payload = data + kHeaderBytes;
+  *payload_length = body;
+  return true;
+}
+
+bool ParityBuilder::Add(uint32_t seq, const uint8_t* payload, size_t length,
+                        std::vector<uint8_t>* parity, uint32_t* first_seq,
+                        uint8_t* count) {
+  if (count_ == 0) {
+    first_seq_ = seq;
+    xor_.assign(2, 0);
+  }
+  if (xor_.size() < length + 2) xor_.resize(length + 2, 0);
+  xor_[0] ^= static_cast<uint8_t>(length);
+  xor_[1] ^= static_cast<uint8_t>(length >> 8);
+  for (size_t i = 0; i < length; i++) xor_[i + 2] ^= payload[i];
+
+  if (++count_ < kFecGroup) return false;
+  return Flush(parity, first_seq, count);
+}
+
+bool ParityBuilder::Flush(std::vector<uint8_t>* parity, uint32_t* first_seq,
+                          uint8_t* count) {
+  if (count_ == 0) return false;
+  parity->swap(xor_);
+  *first_seq = first_seq_;
+  *count = static_cast<uint8_t>(count_);
+  count_ = 0;
+  return true;
+}
+
+void ParityBuilder::Reset() {
+  xor_.clear();
+  count_ = 0;
+}
+
+}  // namespace uplink
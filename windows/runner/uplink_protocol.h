@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Wire format of the datagram audio uplink (see server/src/udpAudio.ts for
+// the receiving side). All integers little-endian.
+//
+//   0  "HU"           magic
+//   2  u8 version     1
+//   3  u8 type        Hello, Welcome, Audio, Parity, Report, Bye, Finalize
+//   4  u32 session    from the relay's udp_ready message
+//   8  u8 stream      0 mic, 1 system
+//   9  u8 count       Parity: packets covered (group starts at seq)
+//  10  u16 length     payload bytes
+//  12  u32 seq        per-stream packet number
+//  16  u32 time_ms    sender clock, for delay and jitter stats
+//  20  payload
+//  ..  8-byte tag     HMAC-SHA256(key, header + payload), truncated
+//
+// The key is HMAC-SHA256(token, "hearnow-udp" + nonce): the client's existing
+// auth token and a per-session nonce the relay sends over the authenticated
+// WebSocket, so neither the token nor the key crosses the datagram path.
+//
+// Audio packets carry up to kMaxAudioPayload bytes of 16kHz mono PCM16. After
+// every kFecGroup audio packets of a stream the sender adds a Parity packet:
+// the XOR of the group's [u16 length][payload, zero-padded] records, which
+// lets the receiver rebuild any single lost packet of the group.
+//
+// Finalize has no payload and the seq of the stream's next audio packet: the
+// utterance ends before it. It goes through the same jitter buffer as the
+// audio, so the relay flushes the recognizer only after that audio was
+// forwarded (or given up as lost). Before it the sender closes the partial
+// FEC group with a shorter Parity packet, so the utterance's tail is covered
+// too.
+namespace uplink {
+
+enum PacketType : uint8_t {
+  kHello = 1,
+  kWelcome = 2,
+  kAudio = 3,
+  kParity = 4,
+  kReport = 5,
+  kBye = 6,
+  kFinalize = 7,
+};
+
+constexpr uint8_t kVersion = 1;
+constexpr size_t kHeaderBytes = 20;
+constexpr size_t kTagBytes = 8;
+constexpr size_t kMaxAudioPayload = 1024;  // 32 ms, well under any MTU
+constexpr int kFecGroup = 4;
+
+using Key = std::array<uint8_t, 32>;
+
+struct Header {
+  PacketType type = kAudio;
+  uint32_t session = 0;
+  uint8_t stream = 0;
+  uint8_t count = 0;
+  uint32_t seq = 0;
+  uint32_t time_ms = 0;
+};
+
+void HmacSha256(const uint8_t* key, size_t key_length,
+                const uint8_t* data, size_t length,
+                uint8_t out[32]);
+
+Key DeriveKey(const std::string& token, const uint8_t* nonce, size_t nonce_length);
+
+// Builds a tagged datagram into |out|.
+void BuildPacket(const Key& key, const Header& header,
+                 const uint8_t* payload, size_t length,
+                 std::vector<uint8_t>* out);
+
+// Checks magic, version, length and tag; fills |header| and the payload span.
+bool ParsePacket(const Key& key, const uint8_t* data, size_t length,
+                 Header* header, const uint8_t** payload, size_t* payload_length);
+
+// Accumulates the parity of one stream's current FEC group.
+class ParityBuilder {
+ public:
+  // Adds an audio packet; returns true when the group is complete and
+  // |parity| holds its payload (group start is |first_seq|).
+  bool Add(uint32_t seq, const uint8_t* payload, size_t length,
+           std::vector<uint8_t>* parity, uint32_t* first_seq, uint8_t* count);
+  // Closes a partial group early; false when it is empty.
+  bool Flush(std::vector<uint8_t>* parity, uint32_t* first_seq, uint8_t* count);
+  void Reset();
+
+ private:
+  std::vector<uint8_t> xor_;
+  uint32_t first_seq_ = 0;
+  int count_ = 0;
+};
+
+}  // namespace uplink
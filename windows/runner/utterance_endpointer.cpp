@@ -0,0 +1,240 @@
+#include "utterance_endpointer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int kFrameSamples = 160;  // 10 ms at 16 kHz
+constexpr int kFrameMs = 10;
+constexpr int kPitchWindow = 256;   // 32 ms at 8 kHz
+constexpr int kMinLag = 20;         // 400 Hz at 8 kHz
+constexpr int kMaxLag = 160;        // 50 Hz
+constexpr float kVoicedCorrelation = 0.5f;
+constexpr size_t kRecentFrames = 40;
+// Speech shorter than this (a click, a cough) never ends an utterance.
+constexpr int kMinSpeechFrames = 15;
+// Speech this long while trailing resumes the utterance; shorter blips are
+// counted as part of the pause.
+constexpr int kResumeFrames = 3;
+
+// Silence waited after a continuation-like ending and after a clearly final
+// one, per aggressiveness level.
+struct WaitRange {
+  int max_ms;
+  int min_ms;
+};
+constexpr WaitRange kWaits[UtteranceEndpointer::kMaxAggressiveness + 1] = {
+    {0, 0}, {1000, 450}, {800, 300}, {600, 200}};
+
+static float Clamp01(float v) {
+  return (std::min)(1.0f, (std::max)(0.0f, v));
+}
+
+// Least-squares slope of |y| against the index, per index step.
+static float Slope(const float* y, int count) {
+  if (count < 2) return 0.0f;
+  const float mean_x = (count - 1) / 2.0f;
+  float mean_y = 0.0f;
+  for (int i = 0; i < count; i++) mean_y += y[i];
+  mean_y /= count;
+  float num = 0.0f;
+  float den = 0.0f;
+  for (int i = 0; i < count; i++) {
+    num += (i - mean_x) * (y[i] - mean_y);
+    den += (i - mean_x) * (i - mean_x);
+  }
+  return num / den;
+}
+
+}  // namespace
+
+UtteranceEndpointer::UtteranceEndpointer(int aggressiveness)
+    : pending_(kFrameSamples, 0.0f),
+      decimated_(kPitchWindow, 0.0f),
+      pitch_scratch_(kPitchWindow, 0.0f),
+      recent_(kRecentFrames, SpeechFrame{0.0f, 0.0f}) {
+  set_aggressiveness(aggressiveness);
+}
+
+void UtteranceEndpointer::set_aggressiveness(int aggressiveness) {
+  aggressiveness_ = (std::min)(kMaxAggressiveness, (std::max)(0, aggressiveness));
+}
+
+void UtteranceEndpointer::Reset() {
+  vad_.Reset();
+  pending_count_ = 0;
+  samples_seen_ = 0;
+  end_lag_samples_ = 0;
+  std::fill(decimated_.begin(), decimated_.end(), 0.0f);
+  decimated_pos_ = 0;
+  state_ = State::kIdle;
+  speech_frames_ = 0;
+  silence_frames_ = 0;
+  resume_frames_ = 0;
+  required_silence_ = 0;
+  recent_pos_ = 0;
+  recent_count_ = 0;
+}
+
+bool UtteranceEndpointer::Process(const float* samples, size_t count) {
+  if (aggressiveness_ == 0) {
+    samples_seen_ += count;
+    return false;
+  }
+  bool ended = false;
+  for (size_t i = 0; i < count; i++) {
+    pending_[pending_count_++] = samples[i];
+    samples_seen_++;
+    if (pending_count_ == pending_.size()) {
+      pending_count_ = 0;
+      ended = ProcessFrame(pending_.data()) || ended;
+    }
+  }
+  return ended;
+}
+
+bool UtteranceEndpointer::ProcessFrame(const float* frame) {
+  for (int i = 0; i < kFrameSamples; i += 2) {
+    decimated_[decimated_pos_] = 0.5f * (frame[i] + frame[i + 1]);
+    decimated_pos_ = (decimated_pos_ + 1) % decimated_.size();
+  }
+
+  const bool speech = vad_.ProcessFrame(frame);
+  if (speech) {
+    recent_[recent_pos_] = {vad_.level_db(), EstimatePitch()};
+    recent_pos_ = (recent_pos_ + 1) % recent_.size();
+    recent_count_ = (std::min)(recent_count_ + 1, recent_.size());
+  }
+
+  switch (state_) {
+    case State::kIdle:
+      if (speech) {
+        state_ = State::kSpeaking;
+        speech_frames_ = 1;
+      }
+      return false;
+
+    case State::kSpeaking:
+      if (speech) {
+        speech_frames_++;
+        return false;
+      }
+      state_ = State::kTrailing;
+      silence_frames_ = 1;
+      resume_frames_ = 0;
+      required_silence_ = RequiredSilenceFrames();
+      return false;
+
+    case State::kTrailing:
+      if (speech) {
+        if (++resume_frames_ >= kResumeFrames) {
+          state_ = State::kSpeaking;
+          speech_frames_ += resume_frames_;
+          return false;
+        }
+      } else {
+        resume_frames_ = 0;
+      }
+      silence_frames_++;
+      if (silence_frames_ < required_silence_) return false;
+      state_ = State::kIdle;
+      recent_count_ = 0;
+      if (speech_frames_ < kMinSpeechFrames) return false;
+      end_lag_samples_ = static_cast<uint64_t>(silence_frames_) * kFrameSamples +
+                         pending_count_;
+      return true;
+  }
+  return false;
+}
+
+float UtteranceEndpointer::EstimatePitch() {
+  // Unroll the ring so the window is contiguous, oldest first.
+  const size_t n = decimated_.size();
+  float mean = 0.0f;
+  for (size_t i = 0; i < n; i++) {
+    pitch_scratch_[i] = decimated_[(decimated_pos_ + i) % n];
+    mean += pitch_scratch_[i];
+  }
+  mean /= n;
+  for (auto& v : pitch_scratch_) v -= mean;
+
+  const float* x = pitch_scratch_.data();
+  const int length = kPitchWindow - kMaxLag;
+  float energy0 = 0.0f;
+  for (int i = 0; i < length; i++) energy0 += x[i] * x[i];
+  if (energy0 <= 1e-9f) return 0.0f;
+
+  float correlations[kMaxLag + 1] = {};
+  float best = 0.0f;
+  for (int lag = kMinLag; lag <= kMaxLag; lag++) {
+    float dot = 0.0f;
+    float energy = 0.0f;
+    for (int i = 0; i < length; i++) {
+      dot += x[i] * x[i + lag];
+      energy += x[i + lag] * x[i + lag];
+    }
+    correlations[lag] = energy > 1e-9f ? dot / std::sqrt(energy0 * energy) : 0.0f;
+    best = (std::max)(best, correlations[lag]);
+  }
+  if (best < kVoicedCorrelation) return 0.0f;
+
+  // The shortest lag at a local peak close to the best one, so a strong
+  // second period does not halve the estimate.
+  for (int lag = kMinLag + 1; lag < kMaxLag; lag++) {
+    const float r = correlations[lag];
+    if (r < 0.9f * best || r < correlations[lag - 1] || r < correlations[lag + 1]) continue;
+    const float prev = correlations[lag - 1];
+    const float next = correlations[lag + 1];
+    const float curvature = prev - 2.0f * r + next;
+    const float offset = curvature < 0.0f ? 0.5f * (prev - next) / curvature : 0.0f;
+    return 8000.0f / (static_cast<float>(lag) + offset);
+  }
+  return 0.0f;
+}
+
+int UtteranceEndpointer::RequiredSilenceFrames() const {
+  const WaitRange& wait = kWaits[aggressiveness_];
+  const int max_frames = wait.max_ms / kFrameMs;
+  const int min_frames = wait.min_ms / kFrameMs;
+
+  // The last speech frames, oldest first.
+  float levels[kRecentFrames];
+  float semitones[kRecentFrames];
+  int voiced = 0;
+  const size_t count = recent_count_;
+  for (size_t i = 0; i < count; i++) {
+    const SpeechFrame& f =
+        recent_[(recent_pos_ + recent_.size() - count + i) % recent_.size()];
+    levels[i] = f.level_db;
+    if (f.pitch_hz > 0.0f) semitones[voiced++] = 12.0f * std::log2(f.pitch_hz);
+  }
+
+  // Energy decay: the last 50 ms against the loudest 50 ms of the last
+  // 400 ms. Speech cut off at full level scores zero.
+  float decay_cue = 0.0f;
+  if (count >= 10) {
+    float window = 0.0f;
+    for (size_t i = 0; i < 5; i++) window += levels[i];
+    float peak = window;
+    for (size_t i = 5; i < count; i++) {
+      window += levels[i] - levels[i - 5];
+      peak = (std::max)(peak, window);
+    }
+    decay_cue = Clamp01(((peak - window) / 5.0f - 4.0f) / 8.0f);
+  }
+
+  // Pitch contour over the last voiced frames, in semitones per second: a
+  // fall ends statements, a steep rise ends questions; a level pitch is a
+  // hesitation or a speaker holding the turn.
+  float pitch_cue = 0.0f;
+  if (voiced >= 6) {
+    const int used = (std::min)(voiced, 25);
+    const float slope = Slope(semitones + voiced - used, used) * (1000.0f / kFrameMs);
+    pitch_cue = (std::max)(Clamp01((-slope - 4.0f) / 12.0f), Clamp01((slope - 10.0f) / 20.0f));
+  }
+
+  const float cue = Clamp01(0.5f * decay_cue + 0.5f * pitch_cue +
+                            0.25f * (std::min)(decay_cue, pitch_cue));
+  return max_frames - static_cast<int>(std::lround(cue * (max_frames - min_frames)));
+}
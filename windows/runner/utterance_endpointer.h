@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "speech_activity.h"
+
+// End-of-utterance detector for 16kHz mono float audio, run on each stream so
+// the client can ask the upstream recognizer to finalize as soon as a speaker
+// is done instead of waiting for its own (conservative) endpointing.
+//
+// A frame-level VAD without hangover finds the silence after speech. How long
+// that silence must last depends on how the speech ended: an utterance whose
+// energy decays into the pause and whose pitch falls (or rises sharply, as
+// questions do) is declared finished after a short silence, while one that
+// stops at full level on a flat pitch (a breath, a hesitation) has to stay
+// silent for the full wait. Pitch is an autocorrelation estimate on audio
+// decimated to 8 kHz. No allocation after construction.
+class UtteranceEndpointer {
+ public:
+  // 0 disables detection; 1..3 trade premature cuts for earlier finals.
+  static constexpr int kMaxAggressiveness = 3;
+
+  explicit UtteranceEndpointer(int aggressiveness = 2);
+
+  void set_aggressiveness(int aggressiveness);
+  int aggressiveness() const { return aggressiveness_; }
+
+  // Splits |samples| into 10 ms frames (carrying the remainder over between
+  // calls). Returns true when an utterance ended within these samples; its
+  // end is then samples_seen() - end_lag_samples().
+  bool Process(const float* samples, size_t count);
+
+  // Samples processed since the last Reset().
+  uint64_t samples_seen() const { return samples_seen_; }
+  // Samples between the last detected end of speech and the detection.
+  uint64_t end_lag_samples() const { return end_lag_samples_; }
+
+  void Reset();
+
+ private:
+  enum class State { kIdle, kSpeaking, kTrailing };
+
+  // One 10 ms frame of speech, kept for the cues at the end of an utterance.
+  struct SpeechFrame {
+    float level_db;
+    float pitch_hz;  // 0 when unvoiced
+  };
+
+  bool ProcessFrame(const float* frame);
+  float EstimatePitch();
+  // Silence needed before the utterance that just paused counts as ended.
+  int RequiredSilenceFrames() const;
+
+  int aggressiveness_;
+  EnergyVad vad_{16000, 10, 9.0f, 0};
+  std::vector<float> pending_;
+  size_t pending_count_ = 0;
+  uint64_t samples_seen_ = 0;
+  uint64_t end_lag_samples_ = 0;
+
+  // 8 kHz history for the pitch estimate (kPitchWindow samples, ring).
+  std::vector<float> decimated_;
+  size_t decimated_pos_ = 0;
+  std::vector<float> pitch_scratch_;
+
+  State state_ = State::kIdle;
+  int speech_frames_ = 0;      // Of the current utterance
+  int silence_frames_ = 0;     // Since speech last stopped
+  int resume_frames_ = 0;      // Consecutive speech frames while trailing
+  int required_silence_ = 0;   // Set when speech stops
+  std::vector<SpeechFrame> recent_;  // Ring of the last speech frames
+  size_t recent_pos_ = 0;
+  size_t recent_count_ = 0;
+};
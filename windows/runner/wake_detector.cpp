@@ -0,0 +1,166 @@
+#include "wake_detector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Below this the gate never wakes, however quiet the floor.
+constexpr float kMinSpeechDb = -55.0f;
+// Windows with more crossings than this per sample are treated as noise.
+constexpr float kMaxSpeechZcr = 0.4f;
+// Speech-like windows in a row needed to wake.
+constexpr int kWakeRun = 2;
+
+}  // namespace
+
+WakeDetector::WakeDetector(float threshold_db,
+                           int hangover_ms,
+                           int decimated_rate,
+                           int window_ms)
+    : threshold_db_(threshold_db),
+      hangover_ms_(hangover_ms),
+      decimated_rate_((std::max)(1, decimated_rate)),
+      window_ms_((std::max)(1, window_ms)) {}
+
+void WakeDetector::Configure(SampleFormat format, int channels, int sample_rate) {
+  format_ = format;
+  channels_ = (std::max)(0, channels);
+  stride_ = static_cast<size_t>((std::max)(1, sample_rate / decimated_rate_));
+  const int effective_rate = sample_rate > 0 ? sample_rate / static_cast<int>(stride_) : 0;
+  window_samples_ = (std::max)(1, effective_rate * window_ms_ / 1000);
+  hangover_windows_ = (std::max)(0, hangover_ms_ / window_ms_);
+  Reset();
+}
+
+void WakeDetector::Reset() {
+  phase_ = 0;
+  sum_sq_ = 0.0;
+  crossings_ = 0;
+  count_ = 0;
+  last_positive_ = false;
+  level_db_ = -100.0f;
+  noise_db_ = -60.0f;
+  noise_ready_ = false;
+  speech_run_ = 0;
+  hangover_left_ = 0;
+  awake_ = false;
+}
+
+bool WakeDetector::Process(const uint8_t* data, size_t frames) {
+  if (!data || format_ == kUnknownFormat || channels_ == 0) {
+    // Nothing to judge by; keep the full pipeline running.
+    awake_ = true;
+    return awake_;
+  }
+
+  size_t i = phase_;
+  for (; i < frames; i += stride_) {
+    float sample = 0.0f;
+    if (format_ == kFloat32) {
+      const float* f = reinterpret_cast<const float*>(data) + i * static_cast<size_t>(channels_);
+      for (int ch = 0; ch < channels_; ch++) sample += f[ch];
+    } else {
+      const int16_t* s = reinterpret_cast<const int16_t*>(data) + i * static_cast<size_t>(channels_);
+      for (int ch = 0; ch < channels_; ch++) sample += s[ch] / 32768.0f;
+    }
+    AddSample(sample / static_cast<float>(channels_));
+  }
+  phase_ = i - frames;
+  return awake_;
+}
+
+bool WakeDetector::ProcessSilence(size_t frames) {
+  if (format_ == kUnknownFormat || channels_ == 0) {
+    awake_ = true;
+    return awake_;
+  }
+  size_t i = phase_;
+  for (; i < frames; i += stride_) {
+    AddSample(0.0f);
+  }
+  phase_ = i - frames;
+  return awake_;
+}
+
+void WakeDetector::AddSample(float sample) {
+  sum_sq_ += static_cast<double>(sample) * sample;
+  const bool positive = sample > 0.0f;
+  if (count_ > 0 && positive != last_positive_) crossings_++;
+  last_positive_ = positive;
+  if (++count_ >= window_samples_) EndWindow();
+}
+
+void WakeDetector::EndWindow() {
+  const double energy = sum_sq_ / count_;
+  const float zcr = static_cast<float>(crossings_) / count_;
+  sum_sq_ = 0.0;
+  crossings_ = 0;
+  count_ = 0;
+
+  level_db_ = static_cast<float>(10.0 * std::log10(energy + 1e-10));
+  // Same floor tracking as EnergyVad: down at once, up about 3 dB/s.
+  if (!noise_ready_) {
+    noise_db_ = level_db_;
+    noise_ready_ = true;
+  } else if (level_db_ < noise_db_) {
+    noise_db_ = level_db_;
+  } else {
+    noise_db_ += 0.03f * window_ms_ / 10.0f;
+  }
+  noise_db_ = (std::max)(noise_db_, -75.0f);
+
+  const bool speech_like = level_db_ > noise_db_ + threshold_db_ &&
+                           level_db_ > kMinSpeechDb && zcr < kMaxSpeechZcr;
+  speech_run_ = speech_like ? speech_run_ + 1 : 0;
+
+  if (speech_run_ >= kWakeRun || (awake_ && speech_like)) {
+    awake_ = true;
+    hangover_left_ = hangover_windows_;
+  } else if (hangover_left_ > 0) {
+    hangover_left_--;
+  } else {
+    awake_ = false;
+  }
+}
+
+void PreRollRing::Configure(size_t capacity_bytes, size_t block_align) {
+  block_align_ = (std::max)(size_t{1}, block_align);
+  buffer_.assign(capacity_bytes / block_align_ * block_align_, 0);
+  Clear();
+}
+
+void PreRollRing::Push(const uint8_t* data, size_t length) {
+  const size_t capacity = buffer_.size();
+  if (capacity == 0 || length == 0) return;
+  if (length > capacity) {
+    // Only the newest |capacity| bytes survive.
+    if (data) data += length - capacity;
+    length = capacity;
+  }
+  size_t written = 0;
+  while (written < length) {
+    const size_t chunk = (std::min)(length - written, capacity - head_);
+    if (data) {
+      std::memcpy(buffer_.data() + head_, data + written, chunk);
+    } else {
+      std::memset(buffer_.data() + head_, 0, chunk);
+    }
+    head_ = (head_ + chunk) % capacity;
+    written += chunk;
+  }
+  size_ = (std::min)(capacity, size_ + length);
+}
+
+void PreRollRing::Drain(std::vector<uint8_t>* out) {
+  out->clear();
+  if (size_ == 0) return;
+  const size_t capacity = buffer_.size();
+  const size_t start = (head_ + capacity - size_) % capacity;
+  out->resize(size_);
+  const size_t first = (std::min)(size_, capacity - start);
+  std::memcpy(out->data(), buffer_.data() + start, first);
+  std::memcpy(out->data() + first, buffer_.data(), size_ - first);
+  Clear();
+}
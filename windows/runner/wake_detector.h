@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Low-power speech gate for raw capture packets.
+//
+// Looks at the endpoint's interleaved mix-format samples directly, decimated
+// to about |decimated_rate| Hz, and tracks per-window energy against an
+// adaptive floor plus the zero-crossing rate (voiced speech crosses rarely at
+// that rate; broadband hiss aliases to ~0.5). Two speech-like windows in a
+// row wake the full pipeline, which then stays up until |hangover_ms| passes
+// without another one. Costs a few dozen multiply-adds per 10 ms packet.
+class WakeDetector {
+ public:
+  enum SampleFormat { kUnknownFormat, kFloat32, kPcm16 };
+
+  explicit WakeDetector(float threshold_db = 10.0f,
+                        int hangover_ms = 2000,
+                        int decimated_rate = 2000,
+                        int window_ms = 20);
+
+  void Configure(SampleFormat format, int channels, int sample_rate);
+
+  // Feeds |frames| interleaved frames; returns whether the full pipeline
+  // should be running after this packet.
+  bool Process(const uint8_t* data, size_t frames);
+  // Same, for a packet flagged silent by the device.
+  bool ProcessSilence(size_t frames);
+
+  bool awake() const { return awake_; }
+  float level_db() const { return level_db_; }
+  float noise_db() const { return noise_db_; }
+
+  void Reset();
+
+ private:
+  void EndWindow();
+  void AddSample(float sample);
+
+  const float threshold_db_;
+  const int hangover_ms_;
+  const int decimated_rate_;
+  const int window_ms_;
+
+  SampleFormat format_ = kUnknownFormat;
+  int channels_ = 0;
+  size_t stride_ = 1;
+  int window_samples_ = 1;
+  int hangover_windows_ = 0;
+
+  size_t phase_ = 0;  // Source frames to skip before the next sample
+  double sum_sq_ = 0.0;
+  int crossings_ = 0;
+  int count_ = 0;
+  bool last_positive_ = false;
+
+  float level_db_ = -100.0f;
+  float noise_db_ = -60.0f;
+  bool noise_ready_ = false;
+  int speech_run_ = 0;
+  int hangover_left_ = 0;
+  bool awake_ = false;
+};
+
+// Fixed-size ring of the most recent raw packet bytes, replayed through the
+// full pipeline on wake so the start of the first word is not lost.
+class PreRollRing {
+ public:
+  // |capacity_bytes| is rounded down to whole frames of |block_align| bytes.
+  void Configure(size_t capacity_bytes, size_t block_align);
+
+  // Appends |length| bytes, or zeros when |data| is null.
+  void Push(const uint8_t* data, size_t length);
+  // Moves the buffered bytes, oldest first, into |out| and empties the ring.
+  void Drain(std::vector<uint8_t>* out);
+
+  size_t size() const { return size_; }
+  void Clear() { head_ = size_ = 0; }
+
+ private:
+  std::vector<uint8_t> buffer_;
+  size_t block_align_ = 1;
+  size_t head_ = 0;  // Next write position
+  size_t size_ = 0;
+};
@@ -0,0 +1,217 @@
+#include "wasapi_device_backend.h"
+
+#include <mmreg.h>
+
+#include <iostream>
+
+#include "utils.h"
+
+#pragma comment(lib, "ole32.lib")
+
+namespace {
+
+// PKEY_Device_FriendlyName and PKEY_AudioEngine_DeviceFormat, spelled out so
+// this file needs no INITGUID translation unit.
+const PROPERTYKEY kFriendlyNameKey = {
+    {0xa45c254e, 0xdf1c, 0x4efd, {0x80, 0x20, 0x67, 0xd1, 0x46, 0xa8, 0x50, 0xe0}}, 14};
+const PROPERTYKEY kDeviceFormatKey = {
+    {0xf19f064d, 0x082c, 0x4e27, {0xbc, 0x73, 0x68, 0x82, 0xa1, 0xbb, 0x8e, 0x4c}}, 0};
+
+static bool SameKey(const PROPERTYKEY& a, const PROPERTYKEY& b) {
+  return a.pid == b.pid && IsEqualGUID(a.fmtid, b.fmtid);
+}
+
+static AudioDeviceFormat FormatFromWave(const WAVEFORMATEX* wave, size_t size) {
+  AudioDeviceFormat format;
+  if (wave == nullptr || size < sizeof(WAVEFORMATEX)) return format;
+  format.sample_rate = static_cast<int>(wave->nSamplesPerSec);
+  format.channels = wave->nChannels;
+  format.bits_per_sample = wave->wBitsPerSample;
+  WORD tag = wave->wFormatTag;
+  if (tag == WAVE_FORMAT_EXTENSIBLE && size >= sizeof(WAVEFORMATEXTENSIBLE)) {
+    // KSDATAFORMAT_SUBTYPE_* GUIDs carry the plain format tag in Data1.
+    tag = static_cast<WORD>(
+        reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(wave)->SubFormat.Data1);
+  }
+  format.is_float = tag == WAVE_FORMAT_IEEE_FLOAT;
+  return format;
+}
+
+}  // namespace
+
+WasapiDeviceBackend::WasapiDeviceBackend() {}
+
+WasapiDeviceBackend::~WasapiDeviceBackend() { Unsubscribe(); }
+
+bool WasapiDeviceBackend::EnsureEnumerator() {
+  if (enumerator_) return true;
+  const HRESULT hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL,
+                                      __uuidof(IMMDeviceEnumerator),
+                                      reinterpret_cast<void**>(&enumerator_));
+  if (FAILED(hr)) {
+    std::cerr << "[WasapiDeviceBackend] Failed to create device enumerator" << std::endl;
+    enumerator_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool WasapiDeviceBackend::Describe(IMMDevice* device, AudioDeviceInfo* info) {
+  DWORD state = 0;
+  if (FAILED(device->GetState(&state)) || state != DEVICE_STATE_ACTIVE) return false;
+
+  LPWSTR id = nullptr;
+  if (FAILED(device->GetId(&id))) return false;
+  info->id = Utf8FromUtf16(id);
+  CoTaskMemFree(id);
+
+  IMMEndpoint* endpoint = nullptr;
+  EDataFlow flow = eCapture;
+  if (SUCCEEDED(device->QueryInterface(__uuidof(IMMEndpoint),
+                                       reinterpret_cast<void**>(&endpoint)))) {
+    endpoint->GetDataFlow(&flow);
+    endpoint->Release();
+  }
+  info->flow = flow == eRender ? AudioDeviceFlow::kRender : AudioDeviceFlow::kCapture;
+
+  IPropertyStore* store = nullptr;
+  if (SUCCEEDED(device->OpenPropertyStore(STGM_READ, &store))) {
+    PROPVARIANT value;
+    PropVariantInit(&value);
+    if (SUCCEEDED(store->GetValue(kFriendlyNameKey, &value)) && value.vt == VT_LPWSTR) {
+      info->name = Utf8FromUtf16(value.pwszVal);
+    }
+    PropVariantClear(&value);
+    if (SUCCEEDED(store->GetValue(kDeviceFormatKey, &value)) && value.vt == VT_BLOB) {
+      info->format = FormatFromWave(reinterpret_cast<const WAVEFORMATEX*>(value.blob.pBlobData),
+                                    value.blob.cbSize);
+    }
+    PropVariantClear(&value);
+    store->Release();
+  }
+  return true;
+}
+
+std::string WasapiDeviceBackend::DefaultId(EDataFlow flow) {
+  IMMDevice* device = nullptr;
+  if (FAILED(enumerator_->GetDefaultAudioEndpoint(flow, eConsole, &device))) {
+    return std::string();  // No device of this kind
+  }
+  std::string result;
+  LPWSTR id = nullptr;
+  if (SUCCEEDED(device->GetId(&id))) {
+    result = Utf8FromUtf16(id);
+    CoTaskMemFree(id);
+  }
+  device->Release();
+  return result;
+}
+
+bool WasapiDeviceBackend::Enumerate(std::vector<AudioDeviceInfo>* devices,
+                                    std::string* default_capture,
+                                    std::string* default_render) {
+  if (!EnsureEnumerator()) return false;
+  IMMDeviceCollection* collection = nullptr;
+  if (FAILED(enumerator_->EnumAudioEndpoints(eAll, DEVICE_STATE_ACTIVE, &collection))) {
+    std::cerr << "[WasapiDeviceBackend] Failed to enumerate endpoints" << std::endl;
+    return false;
+  }
+  UINT count = 0;
+  collection->GetCount(&count);
+  devices->reserve(count);
+  for (UINT i = 0; i < count; i++) {
+    IMMDevice* device = nullptr;
+    if (FAILED(collection->Item(i, &device))) continue;
+    AudioDeviceInfo info;
+    if (Describe(device, &info)) devices->push_back(std::move(info));
+    device->Release();
+  }
+  collection->Release();
+  *default_capture = DefaultId(eCapture);
+  *default_render = DefaultId(eRender);
+  return true;
+}
+
+bool WasapiDeviceBackend::Query(const std::string& id, AudioDeviceInfo* device) {
+  if (!EnsureEnumerator()) return false;
+  const int length = MultiByteToWideChar(CP_UTF8, 0, id.c_str(), -1, nullptr, 0);
+  if (length <= 0) return false;
+  std::wstring wide(static_cast<size_t>(length), L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, id.c_str(), -1, &wide[0], length);
+
+  IMMDevice* endpoint = nullptr;
+  if (FAILED(enumerator_->GetDevice(wide.c_str(), &endpoint))) return false;
+  const bool ok = Describe(endpoint, device);
+  endpoint->Release();
+  return ok;
+}
+
+bool WasapiDeviceBackend::Subscribe(Observer* observer) {
+  if (!EnsureEnumerator()) return false;
+  observer_ = observer;
+  if (!registered_) {
+    if (FAILED(enumerator_->RegisterEndpointNotificationCallback(this))) {
+      observer_ = nullptr;
+      return false;
+    }
+    registered_ = true;
+  }
+  return true;
+}
+
+void WasapiDeviceBackend::Unsubscribe() {
+  observer_ = nullptr;
+  if (registered_ && enumerator_) {
+    enumerator_->UnregisterEndpointNotificationCallback(this);
+  }
+  registered_ = false;
+  // The registry stops from OnDestroy, before main calls CoUninitialize;
+  // the backend itself may be destroyed after it.
+  if (enumerator_) {
+    enumerator_->Release();
+    enumerator_ = nullptr;
+  }
+}
+
+HRESULT WasapiDeviceBackend::QueryInterface(REFIID iid, void** object) {
+  if (iid == __uuidof(IUnknown) || iid == __uuidof(IMMNotificationClient)) {
+    *object = static_cast<IMMNotificationClient*>(this);
+    return S_OK;
+  }
+  *object = nullptr;
+  return E_NOINTERFACE;
+}
+
+HRESULT WasapiDeviceBackend::OnDeviceStateChanged(LPCWSTR id, DWORD) {
+  if (Observer* observer = observer_.load()) observer->OnDeviceChanged(Utf8FromUtf16(id));
+  return S_OK;
+}
+
+HRESULT WasapiDeviceBackend::OnDeviceAdded(LPCWSTR id) {
+  if (Observer* observer = observer_.load()) observer->OnDeviceChanged(Utf8FromUtf16(id));
+  return S_OK;
+}
+
+HRESULT WasapiDeviceBackend::OnDeviceRemoved(LPCWSTR id) {
+  if (Observer* observer = observer_.load()) observer->OnDeviceChanged(Utf8FromUtf16(id));
+  return S_OK;
+}
+
+HRESULT WasapiDeviceBackend::OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR id) {
+  // Capture and playback follow the console role, as GetDefaultAudioEndpoint
+  // is called with elsewhere.
+  if (role != eConsole || flow == eAll) return S_OK;
+  if (Observer* observer = observer_.load()) {
+    observer->OnDefaultChanged(flow == eRender ? AudioDeviceFlow::kRender
+                                               : AudioDeviceFlow::kCapture,
+                               id ? Utf8FromUtf16(id) : std::string());
+  }
+  return S_OK;
+}
+
+HRESULT WasapiDeviceBackend::OnPropertyValueChanged(LPCWSTR id, const PROPERTYKEY key) {
+  // Only what the registry keeps; volume and jack changes fire here too.
+  if (!SameKey(key, kFriendlyNameKey) && !SameKey(key, kDeviceFormatKey)) return S_OK;
+  if (Observer* observer = observer_.load()) observer->OnDeviceChanged(Utf8FromUtf16(id));
+  return S_OK;
+}
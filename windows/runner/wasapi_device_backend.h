@@ -0,0 +1,50 @@
+#pragma once
+
+#include <windows.h>
+#include <mmdeviceapi.h>
+
+#include <atomic>
+
+#include "audio_device_registry.h"
+
+// AudioDeviceBackend over the MMDevice API. Names and engine formats come
+// from the endpoint property store, so listing a device never activates an
+// audio client. Change notifications arrive on a system thread through
+// IMMNotificationClient.
+class WasapiDeviceBackend : public AudioDeviceBackend, private IMMNotificationClient {
+ public:
+  WasapiDeviceBackend();
+  ~WasapiDeviceBackend() override;
+
+  // AudioDeviceBackend:
+  bool Enumerate(std::vector<AudioDeviceInfo>* devices,
+                 std::string* default_capture,
+                 std::string* default_render) override;
+  bool Query(const std::string& id, AudioDeviceInfo* device) override;
+  bool Subscribe(Observer* observer) override;
+  // Also releases the enumerator; the next call creates it again.
+  void Unsubscribe() override;
+
+ private:
+  bool EnsureEnumerator();
+  bool Describe(IMMDevice* device, AudioDeviceInfo* info);
+  std::string DefaultId(EDataFlow flow);
+
+  // IUnknown: the backend owns itself, so reference counting is a no-op.
+  ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+  ULONG STDMETHODCALLTYPE Release() override { return 1; }
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** object) override;
+
+  // IMMNotificationClient:
+  HRESULT STDMETHODCALLTYPE OnDeviceStateChanged(LPCWSTR id, DWORD state) override;
+  HRESULT STDMETHODCALLTYPE OnDeviceAdded(LPCWSTR id) override;
+  HRESULT STDMETHODCALLTYPE OnDeviceRemoved(LPCWSTR id) override;
+  HRESULT STDMETHODCALLTYPE OnDefaultDeviceChanged(EDataFlow flow, ERole role,
+                                                   LPCWSTR id) override;
+  HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR id,
+                                                   const PROPERTYKEY key) override;
+
+  IMMDeviceEnumerator* enumerator_ = nullptr;
+  std::atomic<Observer*> observer_{nullptr};
+  bool registered_ = false;
+};
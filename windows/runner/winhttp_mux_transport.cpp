@@ -0,0 +1,177 @@
+#include "winhttp_mux_transport.h"
+
+#include <iostream>
+#include <string>
+
+#pragma comment(lib, "winhttp.lib")
+
+namespace {
+
+constexpr int kHandshakeTimeoutMs = 10000;
+// WinHTTP pings an idle socket at this interval (its minimum is 15 s).
+constexpr DWORD kKeepAliveMs = 15000;
+constexpr DWORD kReceiveChunk = 16 * 1024;
+
+static std::wstring ToWide(const std::string& utf8) {
+  const int length = MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), -1, nullptr, 0);
+  if (length <= 0) return std::wstring();
+  std::wstring wide(length, L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), -1, &wide[0], length);
+  wide.resize(length - 1);
+  return wide;
+}
+
+}  // namespace
+
+WinHttpMuxTransport::WinHttpMuxTransport() {}
+
+WinHttpMuxTransport::~WinHttpMuxTransport() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CloseHandlesLocked();
+  if (session_) {
+    WinHttpCloseHandle(session_);
+    session_ = nullptr;
+  }
+}
+
+bool WinHttpMuxTransport::Connect(const std::string& url) {
+  // WinHttpCrackUrl only knows the HTTP schemes.
+  std::string http_url = url;
+  if (http_url.rfind("ws://", 0) == 0) {
+    http_url.replace(0, 2, "http");
+  } else if (http_url.rfind("wss://", 0) == 0) {
+    http_url.replace(0, 3, "https");
+  }
+  const std::wstring wide_url = ToWide(http_url);
+  URL_COMPONENTS parts = {};
+  parts.dwStructSize = sizeof(parts);
+  parts.dwHostNameLength = static_cast<DWORD>(-1);
+  parts.dwUrlPathLength = static_cast<DWORD>(-1);
+  parts.dwExtraInfoLength = static_cast<DWORD>(-1);
+  if (!WinHttpCrackUrl(wide_url.c_str(), 0, 0, &parts)) {
+    std::cerr << "[WinHttpMuxTransport] Invalid URL" << std::endl;
+    return false;
+  }
+  const std::wstring host(parts.lpszHostName, parts.dwHostNameLength);
+  std::wstring path(parts.lpszUrlPath, parts.dwUrlPathLength);
+  path.append(parts.lpszExtraInfo, parts.dwExtraInfoLength);
+  const bool secure = parts.nScheme == INTERNET_SCHEME_HTTPS;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  CloseHandlesLocked();
+  if (!session_) {
+    session_ = WinHttpOpen(L"HearNow", WINHTTP_ACCESS_TYPE_AUTOMATIC_PROXY,
+                           WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
+    if (!session_) {
+      std::cerr << "[WinHttpMuxTransport] WinHttpOpen failed: " << GetLastError() << std::endl;
+      return false;
+    }
+    DWORD keepalive = kKeepAliveMs;
+    WinHttpSetOption(session_, WINHTTP_OPTION_WEB_SOCKET_KEEPALIVE_INTERVAL, &keepalive,
+                     sizeof(keepalive));
+  }
+  connection_ = WinHttpConnect(session_, host.c_str(), parts.nPort, 0);
+  if (connection_) {
+    request_ = WinHttpOpenRequest(connection_, L"GET", path.c_str(), nullptr,
+                                  WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES,
+                                  secure ? WINHTTP_FLAG_SECURE : 0);
+  }
+  if (!request_ || !WinHttpSetOption(request_, WINHTTP_OPTION_UPGRADE_TO_WEB_SOCKET, nullptr, 0)) {
+    CloseHandlesLocked();
+    return false;
+  }
+  WinHttpSetTimeouts(request_, 0, kHandshakeTimeoutMs, kHandshakeTimeoutMs, kHandshakeTimeoutMs);
+  const HINTERNET request = request_;
+  lock.unlock();
+
+  // Unlocked so Close() can cancel the handshake by closing the handle.
+  DWORD status = 0;
+  DWORD status_size = sizeof(status);
+  const bool upgraded =
+      WinHttpSendRequest(request, WINHTTP_NO_ADDITIONAL_HEADERS, 0, WINHTTP_NO_REQUEST_DATA, 0,
+                         0, 0) &&
+      WinHttpReceiveResponse(request, nullptr) &&
+      WinHttpQueryHeaders(request, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+                          WINHTTP_HEADER_NAME_BY_INDEX, &status, &status_size,
+                          WINHTTP_NO_HEADER_INDEX) &&
+      status == HTTP_STATUS_SWITCH_PROTOCOLS;
+
+  lock.lock();
+  if (request_ != request) return false;  // Closed meanwhile
+  if (!upgraded) {
+    std::cerr << "[WinHttpMuxTransport] Upgrade failed (status " << status << ", error "
+              << GetLastError() << ")" << std::endl;
+    CloseHandlesLocked();
+    return false;
+  }
+  socket_ = WinHttpWebSocketCompleteUpgrade(request_, 0);
+  WinHttpCloseHandle(request_);
+  request_ = nullptr;
+  if (!socket_) {
+    CloseHandlesLocked();
+    return false;
+  }
+  // The handshake timeouts carry over; an idle stream must not time out.
+  DWORD no_timeout = 0;
+  WinHttpSetOption(socket_, WINHTTP_OPTION_RECEIVE_TIMEOUT, &no_timeout, sizeof(no_timeout));
+  return true;
+}
+
+bool WinHttpMuxTransport::Send(const uint8_t* data, size_t length) {
+  HINTERNET socket = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    socket = socket_;
+  }
+  if (!socket) return false;
+  return WinHttpWebSocketSend(socket, WINHTTP_WEB_SOCKET_BINARY_MESSAGE_BUFFER_TYPE,
+                              const_cast<uint8_t*>(data),
+                              static_cast<DWORD>(length)) == NO_ERROR;
+}
+
+bool WinHttpMuxTransport::Receive(std::vector<uint8_t>* message) {
+  HINTERNET socket = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    socket = socket_;
+  }
+  if (!socket) return false;
+  message->clear();
+  for (;;) {
+    const size_t offset = message->size();
+    message->resize(offset + kReceiveChunk);
+    DWORD read = 0;
+    WINHTTP_WEB_SOCKET_BUFFER_TYPE type = WINHTTP_WEB_SOCKET_BINARY_MESSAGE_BUFFER_TYPE;
+    const DWORD error =
+        WinHttpWebSocketReceive(socket, message->data() + offset, kReceiveChunk, &read, &type);
+    if (error != NO_ERROR) return false;
+    message->resize(offset + read);
+    switch (type) {
+      case WINHTTP_WEB_SOCKET_BINARY_MESSAGE_BUFFER_TYPE:
+        return true;
+      case WINHTTP_WEB_SOCKET_BINARY_FRAGMENT_BUFFER_TYPE:
+        break;
+      case WINHTTP_WEB_SOCKET_CLOSE_BUFFER_TYPE:
+        return false;
+      default:
+        // Text messages are not part of the protocol.
+        message->clear();
+        break;
+    }
+  }
+}
+
+void WinHttpMuxTransport::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CloseHandlesLocked();
+}
+
+void WinHttpMuxTransport::CloseHandlesLocked() {
+  // Closing a handle also cancels a call blocked on it in another thread.
+  for (HINTERNET* handle : {&socket_, &request_, &connection_}) {
+    if (*handle) {
+      WinHttpCloseHandle(*handle);
+      *handle = nullptr;
+    }
+  }
+}
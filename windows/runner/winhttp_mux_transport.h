@@ -0,0 +1,33 @@
+#pragma once
+
+#include <windows.h>
+#include <winhttp.h>
+
+#include <mutex>
+
+#include "mux_connection.h"
+
+// MuxTransport over the WinHTTP WebSocket API, so wss:// uses the system TLS
+// stack and proxy settings. The session handle is kept across reconnects, so
+// a reconnect can resume the cached TLS session instead of a full handshake.
+class WinHttpMuxTransport : public MuxTransport {
+ public:
+  WinHttpMuxTransport();
+  ~WinHttpMuxTransport() override;
+
+  // MuxTransport:
+  bool Connect(const std::string& url) override;
+  bool Send(const uint8_t* data, size_t length) override;
+  bool Receive(std::vector<uint8_t>* message) override;
+  void Close() override;
+
+ private:
+  // Closes the connection and request handles. Requires mutex_.
+  void CloseHandlesLocked();
+
+  std::mutex mutex_;
+  HINTERNET session_ = nullptr;
+  HINTERNET connection_ = nullptr;
+  HINTERNET request_ = nullptr;  // Only while upgrading
+  HINTERNET socket_ = nullptr;
+};